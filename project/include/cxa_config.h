@@ -28,7 +28,7 @@
 
 #define CXA_NETWORK_WIFIMGR_MAXNUM_LISTENERS			3
 
-#define CXA_RUNLOOP_MAXNUM_ENTRIES 					30
+#define CXA_RUNLOOP_MAXNUM_ENTRIES 					40
 #define CXA_RUNLOOP_INFOPRINT_PERIOD_MS				0
 
 //#define CXA_STATE_MACHINE_ENABLE_LOGGING
@@ -0,0 +1,179 @@
+/**
+ * @file
+ * Bounded window of publishes awaiting confirmation that the broker has
+ * them. The mqtt client doesn't report PUBACKs, so confirmation comes from
+ * the keepalive instead: a PINGRESP proves the broker has read everything
+ * sent before the PINGREQ it answers. The first PINGRESP after a send may
+ * answer a PINGREQ that went out ahead of it, but the client only has one
+ * PINGREQ outstanding at a time, so the second one can't.
+ *
+ * Until it's confirmed, a slot is resent whenever its ack times out or the
+ * connection comes back (at-least-once, so receivers must tolerate
+ * duplicates). Only as many publishes as the window size can be outstanding
+ * at once.
+ *
+ * Usage: ovr_ackWindow_open after the first send, ovr_ackWindow_getNextResend
+ * from the sending loop, ovr_ackWindow_onPingResp and then
+ * ovr_ackWindow_getNextAcked when a PINGRESP arrives.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_ACKWINDOW_H_
+#define OVR_ACKWINDOW_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_ACKWINDOW_MAXSIZE
+	#define OVR_ACKWINDOW_MAXSIZE					16
+#endif
+
+#ifndef OVR_ACKWINDOW_MAXNUM_SENDS
+	#define OVR_ACKWINDOW_MAXNUM_SENDS				8
+#endif
+
+// PINGRESPs after its last send that confirm a publish (see above)
+#define OVR_ACKWINDOW_NUM_CONFIRMING_PINGRESPS		2
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_ackWindow ovr_ackWindow_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t numOpened;
+	uint32_t numAcked;
+	uint32_t numResends;
+	uint32_t numExpired;				///< gave up after OVR_ACKWINDOW_MAXNUM_SENDS
+	uint32_t ackTime_max_ms;			///< first send to confirmation
+}ovr_ackWindow_stats_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	bool isUsed;
+	bool isResendNeeded;
+	uint8_t numSends;
+	uint32_t lastSendPingResp;			///< numPingResps when last sent
+	uint32_t firstSendTime_ms;
+	uint32_t lastSendTime_ms;
+	void* userVar;
+}ovr_ackWindow_slot_t;
+
+
+/**
+ * @private
+ */
+struct ovr_ackWindow
+{
+	ovr_ackWindow_slot_t slots[OVR_ACKWINDOW_MAXSIZE];
+	size_t size;
+	size_t numInFlight;
+
+	uint32_t ackTimeout_ms;
+	uint32_t numPingResps;
+
+	ovr_ackWindow_stats_t stats;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ */
+void ovr_ackWindow_init(ovr_ackWindow_t *const awIn, size_t sizeIn, uint32_t ackTimeout_msIn);
+
+
+/**
+ * @public
+ * Shrinking below the number in flight only takes effect as slots are acked
+ * @return false if either parameter is out of range
+ */
+bool ovr_ackWindow_configure(ovr_ackWindow_t *const awIn, size_t sizeIn, uint32_t ackTimeout_msIn);
+
+
+/**
+ * @public
+ */
+size_t ovr_ackWindow_getSize(ovr_ackWindow_t *const awIn);
+uint32_t ovr_ackWindow_getAckTimeout_ms(ovr_ackWindow_t *const awIn);
+size_t ovr_ackWindow_getNumInFlight(ovr_ackWindow_t *const awIn);
+ovr_ackWindow_stats_t ovr_ackWindow_getStats(ovr_ackWindow_t *const awIn);
+
+
+/**
+ * @public
+ */
+bool ovr_ackWindow_hasRoom(ovr_ackWindow_t *const awIn);
+
+
+/**
+ * @public
+ * Claims a slot for a publish that was just sent for the first time
+ * @return false if the window is full
+ */
+bool ovr_ackWindow_open(ovr_ackWindow_t *const awIn, void* userVarIn, uint32_t now_msIn);
+
+
+/**
+ * @public
+ * Called for every PINGRESP the mqtt client receives
+ */
+void ovr_ackWindow_onPingResp(ovr_ackWindow_t *const awIn);
+
+
+/**
+ * @public
+ * Releases a slot that the PINGRESPs received so far confirm (call until
+ * it returns NULL)
+ * @return the confirmed slot's userVar (NULL if there is none)
+ */
+void* ovr_ackWindow_getNextAcked(ovr_ackWindow_t *const awIn, uint32_t now_msIn);
+
+
+/**
+ * @public
+ * Finds a slot that should be sent again and counts it as sent. A slot that
+ * has used all its sends is released and returned through expiredUserVarOut
+ * instead (the caller owns whatever it refers to).
+ *
+ * @return the userVar of the slot to resend (NULL if there is none)
+ */
+void* ovr_ackWindow_getNextResend(ovr_ackWindow_t *const awIn, uint32_t now_msIn, void** expiredUserVarOut);
+
+
+/**
+ * @public
+ * Called on reconnect...everything in flight is resent without waiting
+ */
+void ovr_ackWindow_markAllForResend(ovr_ackWindow_t *const awIn);
+
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * @file
+ * Records beacon adverts into a RAM ring so they can be dumped over the
+ * console ('cap_start', 'cap_stop', 'cap_dump') and replayed back through
+ * the beacon manager at real time or compressed time (see the host tests).
+ *
+ * Each record is stored as:
+ *   [rxTime_ms: uint32 LE, relative to capture start][rssi_dBm: int8][numBytes: uint8][manufacturer data...]
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_ADVERTCAPTURE_H_
+#define OVR_ADVERTCAPTURE_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cxa_logger_header.h>
+#include <cxa_timeDiff.h>
+
+#include <ovr_beaconManager.h>
+#include <ovr_memArena.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_ADVERTCAPTURE_BUFFERSIZE_BYTES
+	#define OVR_ADVERTCAPTURE_BUFFERSIZE_BYTES		4096
+#endif
+
+// used instead when the board has PSRAM
+#ifndef OVR_ADVERTCAPTURE_BUFFERSIZE_PSRAM_BYTES
+	#define OVR_ADVERTCAPTURE_BUFFERSIZE_PSRAM_BYTES	262144
+#endif
+
+#define OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES	6
+#define OVR_ADVERTCAPTURE_MAXDATA_SIZE_BYTES		31
+
+// speed factor used to replay as fast as the pipeline will accept
+#define OVR_ADVERTCAPTURE_SPEED_MAX					0
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_advertCapture ovr_advertCapture_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t numRecords;
+	uint32_t numInjected;
+	uint32_t numRejected;				///< unparseable, filtered or dropped by the manager
+	uint32_t duration_ms;
+
+	ovr_beaconManager_pipelineStats_t pipeline;	///< manager counters accumulated over the replay
+}ovr_advertCapture_replayReport_t;
+
+
+/**
+ * @private
+ */
+struct ovr_advertCapture
+{
+	ovr_beaconManager_t* bm;
+
+	bool isCapturing;
+	cxa_timeDiff_t td_capture;
+	uint32_t numRecordsOverwritten;
+
+	ovr_memArena_t memArena;
+	uint8_t* buffer;
+	size_t bufferSize_bytes;
+	size_t readIndex;
+	size_t size_bytes;
+	uint32_t numRecords;
+
+	bool isReplaying;
+	uint16_t replaySpeed;
+	cxa_timeDiff_t td_replay;
+	size_t replayOffset;
+	uint32_t replayRecordIndex;
+	uint32_t replayFirstRxTime_ms;
+	ovr_beaconManager_pipelineStats_t replayStartStats;
+	ovr_advertCapture_replayReport_t lastReport;
+
+	cxa_logger_t logger;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Registers the 'cap_start', 'cap_stop' and 'cap_dump' console commands
+ * @param threadIdIn runLoop thread on which the beacon manager ingests adverts
+ */
+void ovr_advertCapture_init(ovr_advertCapture_t *const capIn, ovr_beaconManager_t *const bmIn, int threadIdIn);
+
+
+/**
+ * @public
+ * Clears any previous capture and starts recording
+ */
+void ovr_advertCapture_start(ovr_advertCapture_t *const capIn);
+
+
+/**
+ * @public
+ */
+void ovr_advertCapture_stop(ovr_advertCapture_t *const capIn);
+
+
+/**
+ * @public
+ * Appends a record as if it had just been captured (eg. to load a dump),
+ * overwriting the oldest records if the ring is full
+ * @param rxTime_msIn relative to the start of the capture
+ * @return false if the data is too large or a replay is running
+ */
+bool ovr_advertCapture_addRecord(ovr_advertCapture_t *const capIn, uint32_t rxTime_msIn, int8_t rssi_dBmIn, uint8_t *const dataIn, size_t dataSize_bytesIn);
+
+
+/**
+ * @public
+ */
+uint32_t ovr_advertCapture_getNumRecords(ovr_advertCapture_t *const capIn);
+
+
+/**
+ * @public
+ * Writes the capture, one hex-encoded record per line
+ */
+void ovr_advertCapture_dump(ovr_advertCapture_t *const capIn, cxa_ioStream_t *const ioStreamIn);
+
+
+/**
+ * @public
+ * Replays the current capture through the beacon manager. Recording is
+ * stopped for the duration of the replay.
+ * @param speedIn time compression factor (1 == real time) or OVR_ADVERTCAPTURE_SPEED_MAX
+ */
+bool ovr_advertCapture_startReplay(ovr_advertCapture_t *const capIn, uint16_t speedIn);
+
+
+/**
+ * @public
+ */
+bool ovr_advertCapture_isReplaying(ovr_advertCapture_t *const capIn);
+
+
+/**
+ * @public
+ * @return the report from the most recently completed replay
+ */
+ovr_advertCapture_replayReport_t ovr_advertCapture_getLastReplayReport(ovr_advertCapture_t *const capIn);
+
+
+/**
+ * @public
+ * @return the arena holding the capture buffer (for usage reporting)
+ */
+ovr_memArena_t* ovr_advertCapture_getMemArena(ovr_advertCapture_t *const capIn);
+
+#endif
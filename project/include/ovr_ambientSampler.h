@@ -0,0 +1,165 @@
+/**
+ * @file
+ * Samples the gateway's own temp and light sensors. Rather than one raw
+ * read of each per period, every period is split into
+ * OVR_AMBIENTSAMPLER_NUMSAMPLES slots; each slot reads temp then light
+ * back-to-back (so the btle client's bus is claimed once per slot) and the
+ * median of each sensor's samples becomes that period's reading.
+ *
+ * A reading is only passed on when it moves past its deadband from the last
+ * one passed on (or after OVR_AMBIENTSAMPLER_MAXNUM_SILENT_READINGS without).
+ * The time each slot holds the bus is measured, since sensor transactions
+ * share the btle client's uart with scan traffic.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_AMBIENTSAMPLER_H_
+#define OVR_AMBIENTSAMPLER_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cxa_btle_client.h>
+#include <cxa_lightSensor.h>
+#include <cxa_logger_header.h>
+#include <cxa_tempSensor.h>
+#include <cxa_timeDiff.h>
+
+
+// ******** global macro definitions ********
+// per reading (odd so the median is always a real sample)
+#ifndef OVR_AMBIENTSAMPLER_NUMSAMPLES
+	#define OVR_AMBIENTSAMPLER_NUMSAMPLES				5
+#endif
+
+#ifndef OVR_AMBIENTSAMPLER_TEMP_DEADBAND_C
+	#define OVR_AMBIENTSAMPLER_TEMP_DEADBAND_C			0.5
+#endif
+
+#ifndef OVR_AMBIENTSAMPLER_LIGHT_DEADBAND_255
+	#define OVR_AMBIENTSAMPLER_LIGHT_DEADBAND_255		8
+#endif
+
+// pass a reading on regardless so the backend knows the sensor is still alive
+#ifndef OVR_AMBIENTSAMPLER_MAXNUM_SILENT_READINGS
+	#define OVR_AMBIENTSAMPLER_MAXNUM_SILENT_READINGS	15
+#endif
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_ambientSampler ovr_ambientSampler_t;
+
+
+/**
+ * @public
+ */
+typedef void (*ovr_ambientSampler_cb_onTempChanged_t)(float newTemp_degCIn, void* userVarIn);
+typedef void (*ovr_ambientSampler_cb_onLightChanged_t)(uint8_t newLight_255In, void* userVarIn);
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t numSamples;
+	uint32_t numFailures;				///< failed or refused sensor transactions
+	uint32_t numReadings;
+	uint32_t numNotifications;
+	uint32_t busTime_total_ms;			///< from the first request of a slot to its last callback
+	uint32_t busTime_max_us;			///< longest single slot
+}ovr_ambientSampler_stats_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	bool hasReported;
+	float lastReported;
+	uint8_t numSilentReadings;
+}ovr_ambientSampler_deadband_t;
+
+
+/**
+ * @private
+ */
+struct ovr_ambientSampler
+{
+	cxa_btle_client_t* btleClient;
+	cxa_tempSensor_t* tempSensor;
+	cxa_lightSensor_t* lightSensor;
+
+	ovr_ambientSampler_cb_onTempChanged_t cb_onTempChanged;
+	ovr_ambientSampler_cb_onLightChanged_t cb_onLightChanged;
+	void* userVar;
+
+	cxa_timeDiff_t td_slot;
+	bool isSlotInProgress;
+	uint32_t slotStartTime_us;
+	uint64_t busTime_total_us;
+	size_t numSlots;
+
+	float tempSamples[OVR_AMBIENTSAMPLER_NUMSAMPLES];
+	size_t numTempSamples;
+	float lightSamples[OVR_AMBIENTSAMPLER_NUMSAMPLES];
+	size_t numLightSamples;
+
+	float lastTemp_degC;
+	uint8_t lastLight_255;
+	ovr_ambientSampler_deadband_t tempDeadband;
+	ovr_ambientSampler_deadband_t lightDeadband;
+
+	ovr_ambientSampler_stats_t stats;
+
+	cxa_logger_t logger;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * @param tempSensorIn may be NULL
+ * @param lightSensorIn may be NULL
+ * @param threadIdIn runLoop thread on which the btle client runs
+ */
+void ovr_ambientSampler_init(ovr_ambientSampler_t *const asIn, cxa_btle_client_t *const btleClientIn,
+							 cxa_tempSensor_t *const tempSensorIn, cxa_lightSensor_t *const lightSensorIn,
+							 ovr_ambientSampler_cb_onTempChanged_t cb_onTempChangedIn,
+							 ovr_ambientSampler_cb_onLightChanged_t cb_onLightChangedIn,
+							 void* userVarIn, int threadIdIn);
+
+
+/**
+ * @public
+ * @return the most recent filtered reading (NAN / 0 before the first one)
+ */
+float ovr_ambientSampler_getLastTemp_degC(ovr_ambientSampler_t *const asIn);
+uint8_t ovr_ambientSampler_getLastLight_255(ovr_ambientSampler_t *const asIn);
+
+
+/**
+ * @public
+ */
+ovr_ambientSampler_stats_t ovr_ambientSampler_getStats(ovr_ambientSampler_t *const asIn);
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file
+ * Allow/deny list of beacon ids consulted for every received advert.
+ *
+ * Ids are stored as sorted 4-byte hashes rather than full EUI-48s so large
+ * lists stay small (4 bytes per entry, sized to what's actually listed). An
+ * unlisted id collides with a listed one with probability of roughly
+ * numEntries / 2^32 (~2e-6 for 10k entries).
+ *
+ * Updates build a new table off to the side and swap it in, so the receive
+ * path always sees either the complete old or the complete new list.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_BEACONFILTER_H_
+#define OVR_BEACONFILTER_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <cxa_eui48.h>
+#include <cxa_logger_header.h>
+
+#include <ovr_memArena.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_BEACONFILTER_MAXNUM_ENTRIES
+	#define OVR_BEACONFILTER_MAXNUM_ENTRIES			16384
+#endif
+
+#ifndef OVR_BEACONFILTER_TABLE_REGION
+	#define OVR_BEACONFILTER_TABLE_REGION			OVR_MEMARENA_REGION_PSRAM
+#endif
+
+// NVS blobs are limited in size, so entries are persisted in chunks
+#ifndef OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK
+	#define OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK	256
+#endif
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_beaconFilter ovr_beaconFilter_t;
+
+
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_BEACONFILTER_MODE_DISABLED = 0,		///< all beacons are accepted
+	OVR_BEACONFILTER_MODE_ALLOW = 1,		///< only listed beacons are accepted
+	OVR_BEACONFILTER_MODE_DENY = 2			///< listed beacons are rejected
+}ovr_beaconFilter_mode_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	ovr_beaconFilter_mode_t mode;
+
+	// hashed ids, kept sorted for binary search
+	size_t numKeys;
+	uint32_t* keys;
+	ovr_memArena_t arena;
+}ovr_beaconFilter_table_t;
+
+
+/**
+ * @private
+ */
+struct ovr_beaconFilter
+{
+	// one is in use by the receive path, the other is free for the next update
+	ovr_beaconFilter_table_t tables[2];
+	ovr_beaconFilter_table_t* activeTable;
+
+	cxa_logger_t logger;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Initializes the filter and restores any previously saved
+ * mode and entries from NVS
+ */
+void ovr_beaconFilter_init(ovr_beaconFilter_t *const bfIn);
+
+
+/**
+ * @public
+ */
+ovr_beaconFilter_mode_t ovr_beaconFilter_getMode(ovr_beaconFilter_t *const bfIn);
+
+
+/**
+ * @public
+ * @return number of distinct (hashed) entries
+ */
+size_t ovr_beaconFilter_getNumEntries(ovr_beaconFilter_t *const bfIn);
+
+
+/**
+ * @public
+ * Replaces the current mode and entries. Changes are not
+ * persisted until ovr_beaconFilter_save is called.
+ *
+ * @param rawEntriesIn packed 6-byte EUI-48s
+ * @param numEntriesIn number of EUI-48s in rawEntriesIn
+ * @param shouldAppendIn if true, entries are merged with
+ * 		the existing entries rather than replacing them
+ *
+ * @return false if the resulting entries would not fit (the
+ * 		current mode and entries are left in place)
+ */
+bool ovr_beaconFilter_setEntries(ovr_beaconFilter_t *const bfIn, ovr_beaconFilter_mode_t modeIn,
+								 uint8_t *const rawEntriesIn, size_t numEntriesIn, bool shouldAppendIn);
+
+
+/**
+ * @public
+ * Persists the current mode and entries to NVS
+ */
+bool ovr_beaconFilter_save(ovr_beaconFilter_t *const bfIn);
+
+
+/**
+ * @public
+ * Determines whether a beacon with the given id should be tracked.
+ * Safe to call from the advert receive path while the entries are
+ * being updated on another thread (O(log n)).
+ */
+bool ovr_beaconFilter_isAccepted(ovr_beaconFilter_t *const bfIn, cxa_eui48_t *const idIn);
+
+#endif
@@ -22,19 +22,24 @@
 #include <cxa_led.h>
 #include <cxa_lightSensor.h>
 #include <cxa_logger_header.h>
-#include <cxa_rgbLed.h>
 #include <cxa_tempSensor.h>
 #include <cxa_timeDiff.h>
 
+#include <ovr_advertCapture.h>
+#include <ovr_ambientSampler.h>
 #include <ovr_beaconGateway_ui.h>
 #include <ovr_beaconGateway_rpcInterface.h>
 #include <ovr_beaconManager.h>
+#include <ovr_beaconRules.h>
+#include <ovr_ledcRgbLed.h>
+#include <ovr_logStream.h>
 
 
 // ******** global macro definitions ********
 #define OVR_GW_THREADID_NETWORK				1
 #define OVR_GW_THREADID_UI					2
 #define OVR_GW_THREADID_BLUETOOTH			3
+#define OVR_GW_NUM_THREADS					3
 
 
 // ******** global type definitions *********
@@ -57,6 +62,16 @@ typedef enum
 }ovr_beaconGateway_variant_t;
 
 
+/**
+ * @private
+ */
+typedef struct
+{
+	cxa_timeDiff_t td_sample;
+	uint32_t stackHighWater_bytes;
+}ovr_beaconGateway_threadStats_t;
+
+
 /**
  * @private
  */
@@ -66,14 +81,18 @@ struct ovr_beaconGateway
 
 	cxa_btle_client_t* btleClient;
 	ovr_beaconManager_t beaconManager;
+	ovr_advertCapture_t advertCapture;
 
 	ovr_beaconGateway_rpcInterface_t bgri;
+	ovr_beaconRules_t rules;
+	ovr_logStream_t logStream;
 
 	ovr_beaconGateway_ui_t bgui;
 
-	cxa_timeDiff_t td_readSensors;
-	cxa_lightSensor_t* lightSensor;
-	cxa_tempSensor_t* tempSensor;
+	ovr_ambientSampler_t ambientSampler;
+
+	// indexed by threadId-1
+	ovr_beaconGateway_threadStats_t threadStats[OVR_GW_NUM_THREADS];
 
 	cxa_logger_t logger;
 };
@@ -88,8 +107,8 @@ void ovr_beaconGateway_init(ovr_beaconGateway_t *const bgIn,
 							cxa_gpio_t *const gpio_swProvisionIn,
 							cxa_gpio_t *const gpio_variant_internalHighPowerIn,
 							cxa_gpio_t *const gpio_variant_externalIn,
-							cxa_rgbLed_t *const led_btleActIn,
-							cxa_rgbLed_t *const led_netActIn,
+							ovr_ledcRgbLed_t *const led_btleActIn,
+							ovr_ledcRgbLed_t *const led_netActIn,
 							cxa_lightSensor_t *const lightSensorIn,
 							cxa_tempSensor_t *const tempSensorIn,
 							cxa_mqtt_rpc_node_t *const rootNodeIn);
@@ -99,6 +118,14 @@ bool ovr_beaconGateway_isBeaconRadioReady(ovr_beaconGateway_t *const bgIn);
 float ovr_beaconGateway_getLastTemp_degC(ovr_beaconGateway_t *const bgIn);
 uint8_t ovr_beaconGateway_getLastLight_255(ovr_beaconGateway_t *const bgIn);
 ovr_beaconGateway_variant_t ovr_beaconGateway_getVariant(ovr_beaconGateway_t *const bgIn);
+ovr_beaconManager_t* ovr_beaconGateway_getBeaconManager(ovr_beaconGateway_t *const bgIn);
+ovr_ambientSampler_t* ovr_beaconGateway_getAmbientSampler(ovr_beaconGateway_t *const bgIn);
+
+/**
+ * @public
+ * @return minimum free stack ever seen on the given runLoop thread (0 if not yet sampled)
+ */
+uint32_t ovr_beaconGateway_getStackHighWater_bytes(ovr_beaconGateway_t *const bgIn, int threadIdIn);
 
 void ovr_beaconGateway_onAssert(ovr_beaconGateway_t *const bgIn);
 
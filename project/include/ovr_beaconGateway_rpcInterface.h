@@ -22,6 +22,8 @@
 #include <cxa_mqtt_rpc_node.h>
 #include <cxa_timeDiff.h>
 
+#include <ovr_beaconManager.h>
+
 
 // ******** global macro definitions ********
 
@@ -50,6 +52,18 @@ struct ovr_beaconGateway_rpcInterface
 	cxa_mqtt_rpc_node_t rpcNode_ambient_light;
 
 	cxa_timeDiff_t td_sendCheckin;
+
+	// our own publishes (the beacon manager counts its own)
+	uint32_t numPublishes;
+	uint32_t numPublishBytes;
+	uint32_t numPublishFailures;
+
+	// snapshots from the previous checkIn so we can report per-interval values
+	ovr_beaconManager_pipelineStats_t lastPipelineStats;
+	ovr_beaconManager_admissionStats_t lastAdmissionStats;
+	ovr_beaconManager_rpcInterface_publishStats_t lastPublishStats;
+	uint32_t lastSensorBusTime_ms;
+	uint32_t lastLinkChanges;
 };
 
 
@@ -21,8 +21,9 @@
 // ******** includes ********
 #include <cxa_btle_client.h>
 #include <cxa_gpio_longPressManager.h>
-#include <cxa_rgbLed.h>
+#include <cxa_timeDiff.h>
 #include <ovr_beaconManager.h>
+#include <ovr_ledcRgbLed.h>
 
 
 // ******** global macro definitions ********
@@ -40,19 +41,24 @@ typedef struct ovr_beaconGateway_ui ovr_beaconGateway_ui_t;
  */
 struct ovr_beaconGateway_ui
 {
-	cxa_rgbLed_t* led_btleAct;
-	cxa_rgbLed_t* led_netAct;
+	ovr_ledcRgbLed_t* led_btleAct;
+	ovr_ledcRgbLed_t* led_netAct;
 
 	cxa_gpio_longPressManager_t lpm_swProv;
 
 	bool networkError;
+
+	// counted from other threads, shown a few times a second on ours
+	uint32_t numBeaconUpdates;
+	uint32_t numPingResps;
+	cxa_timeDiff_t td_activity;
 };
 
 
 // ******** global function prototypes ********
 void ovr_beaconGateway_ui_init(ovr_beaconGateway_ui_t *const bguiIn,
 							   cxa_btle_client_t *const btleClientIn, ovr_beaconManager_t *const bmIn,
-							   cxa_rgbLed_t *const led_btleActIn, cxa_rgbLed_t *const led_netActIn,
+							   ovr_ledcRgbLed_t *const led_btleActIn, ovr_ledcRgbLed_t *const led_netActIn,
 							   cxa_gpio_t *const gpio_swProvIn);
 
 
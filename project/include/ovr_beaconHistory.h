@@ -0,0 +1,171 @@
+/**
+ * @file
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_BEACONHISTORY_H_
+#define OVR_BEACONHISTORY_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_BEACONHISTORY_SLICESIZE_BYTES
+	#define OVR_BEACONHISTORY_SLICESIZE_BYTES		128
+#endif
+
+#ifndef OVR_BEACONHISTORY_TIMERESOLUTION_MS
+	#define OVR_BEACONHISTORY_TIMERESOLUTION_MS		10
+#endif
+
+// worst-case header size of an encoded batch
+#define OVR_BEACONHISTORY_BATCHHEADER_MAXSIZE_BYTES	24
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_beaconHistory ovr_beaconHistory_t;
+
+
+/**
+ * @public
+ * Fixed-size slices of a shared byte buffer, one per beacon history
+ */
+typedef struct
+{
+	uint8_t* buffer;
+	bool* isSliceUsed;
+	size_t numSlices;
+}ovr_beaconHistory_arena_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	int8_t rssi_dBm;
+	uint16_t temp_deciDegC;
+	uint8_t light_255;
+	uint8_t batt_pcnt100;
+	uint16_t batt_mv;
+}ovr_beaconHistory_sample_t;
+
+
+/**
+ * @private
+ */
+struct ovr_beaconHistory
+{
+	ovr_beaconHistory_arena_t* arena;
+	uint8_t* buffer;
+
+	size_t readIndex;
+	size_t size_bytes;
+	size_t numSamples;
+	uint32_t pendingDt_units;
+
+	// value preceding the oldest record (records are delta-encoded)
+	ovr_beaconHistory_sample_t base;
+	// value of the newest record
+	ovr_beaconHistory_sample_t newest;
+
+	uint32_t numDropped;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * @param bufferIn must be numSlicesIn * OVR_BEACONHISTORY_SLICESIZE_BYTES
+ */
+void ovr_beaconHistory_arena_init(ovr_beaconHistory_arena_t *const arenaIn, uint8_t *const bufferIn, bool *const isSliceUsedIn, size_t numSlicesIn);
+
+
+/**
+ * @protected
+ * Claims a slice of the arena for this history. If the arena is
+ * exhausted, the history is still valid but will not record samples.
+ */
+void ovr_beaconHistory_init(ovr_beaconHistory_t *const histIn, ovr_beaconHistory_arena_t *const arenaIn, ovr_beaconHistory_sample_t *const firstSampleIn);
+
+
+/**
+ * @protected
+ * Returns the slice to the arena
+ */
+void ovr_beaconHistory_deinit(ovr_beaconHistory_t *const histIn);
+
+
+/**
+ * @protected
+ * Records a new sample, dropping the oldest samples if needed
+ *
+ * @param dt_msIn time since the previous sample
+ */
+void ovr_beaconHistory_append(ovr_beaconHistory_t *const histIn, ovr_beaconHistory_sample_t *const sampleIn, uint32_t dt_msIn);
+
+
+/**
+ * @public
+ */
+size_t ovr_beaconHistory_getNumSamples(ovr_beaconHistory_t *const histIn);
+
+
+/**
+ * @public
+ */
+uint32_t ovr_beaconHistory_getNumDropped(ovr_beaconHistory_t *const histIn);
+
+
+/**
+ * @public
+ * Removes as many of the oldest samples as will fit in bufOut and
+ * writes them as a self-contained batch:
+ *
+ * [numSamples][ageOfLast][base rssi,temp,light,batt_pcnt,batt_mv][records...]
+ *
+ * where each record is [dt][fieldMask][changed fields...]. All values are
+ * LEB128 varints; signed and delta values are zig-zag encoded. Times are
+ * in units of OVR_BEACONHISTORY_TIMERESOLUTION_MS.
+ *
+ * @param timeSinceNewest_msIn time since the newest sample was recorded,
+ * 		used to anchor the batch in time
+ *
+ * @return the number of bytes written (0 if there are no samples)
+ */
+size_t ovr_beaconHistory_drainBatch(ovr_beaconHistory_t *const histIn, uint32_t timeSinceNewest_msIn,
+									uint8_t *const bufOut, size_t maxSize_bytesIn, size_t *const numSamplesOut);
+
+
+/**
+ * @public
+ * Decodes a batch produced by ovr_beaconHistory_drainBatch
+ *
+ * @param dts_msOut optional, receives the time between each sample and the one before it
+ * @param ageOfLast_msOut optional, receives the age of the last sample at the time of draining
+ *
+ * @return the number of samples decoded
+ */
+size_t ovr_beaconHistory_decodeBatch(uint8_t *const bufIn, size_t size_bytesIn,
+									 ovr_beaconHistory_sample_t *const samplesOut, uint32_t *const dts_msOut, size_t maxNumSamplesIn,
+									 uint32_t *const ageOfLast_msOut);
+
+#endif
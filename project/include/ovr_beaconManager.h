@@ -27,12 +27,16 @@
 #include <cxa_logger_header.h>
 #include <cxa_timeDiff.h>
 
+#include <ovr_beaconFilter.h>
+#include <ovr_beaconHistory.h>
 #include <ovr_beaconManager_rpcInterface.h>
 #include <ovr_beaconProxy.h>
 #include <ovr_beaconUpdate.h>
+#include <ovr_memArena.h>
 
 
 // ******** global macro definitions ********
+// default capacities...may be overridden at boot from NVS (see ovr_beaconManager_saveCapacities)
 #ifndef OVR_BEACONMANAGER_MAXNUM_BEACONS
 	#define OVR_BEACONMANAGER_MAXNUM_BEACONS		16
 #endif
@@ -42,7 +46,59 @@
 #endif
 
 #ifndef OVR_BEACONMANAGER_MAXNUM_LISTENERS
-	#define OVR_BEACONMANAGER_MAXNUM_LISTENERS			4
+	#define OVR_BEACONMANAGER_MAXNUM_LISTENERS			6
+#endif
+
+// sanity limits on capacities loaded from NVS
+#define OVR_BEACONMANAGER_MAXNUM_BEACONS_LIMIT		1024
+#define OVR_BEACONMANAGER_MAXSIZE_RX_FIFO_LIMIT		64
+#define OVR_BEACONMANAGER_MAXNUM_LISTENERS_LIMIT	16
+
+// hot state (touched for every advert) vs cold state (history, only touched in batches)...
+// set both to internal for an all-internal layout
+#ifndef OVR_BEACONMANAGER_HOTARENA_REGION
+	#define OVR_BEACONMANAGER_HOTARENA_REGION		OVR_MEMARENA_REGION_INTERNAL
+#endif
+
+#ifndef OVR_BEACONMANAGER_COLDARENA_REGION
+	#define OVR_BEACONMANAGER_COLDARENA_REGION		OVR_MEMARENA_REGION_PSRAM
+#endif
+
+#ifndef OVR_BEACONMANAGER_EVICTPOLICY
+	#define OVR_BEACONMANAGER_EVICTPOLICY			OVR_BEACONMANAGER_EVICTPOLICY_WEAKEST
+#endif
+
+#ifndef OVR_BEACONMANAGER_EVICT_MINRSSIMARGIN_DBM
+	#define OVR_BEACONMANAGER_EVICT_MINRSSIMARGIN_DBM	6
+#endif
+
+#ifndef OVR_BEACONMANAGER_EVICT_MINSTALE_MS
+	#define OVR_BEACONMANAGER_EVICT_MINSTALE_MS		5000
+#endif
+
+// a new (or re-found) beacon must be heard this many times in a row before it's found
+#ifndef OVR_BEACONMANAGER_FOUND_NUMADVERTS
+	#define OVR_BEACONMANAGER_FOUND_NUMADVERTS		2
+#endif
+
+// beacons heard but not yet found, plus the cadence of recently lost ones
+#ifndef OVR_BEACONMANAGER_MAXNUM_PRESENCEENTRIES
+	#define OVR_BEACONMANAGER_MAXNUM_PRESENCEENTRIES	32
+#endif
+
+// the table is always checkpointed this often (keeps smoothed state fresh)...
+#ifndef OVR_BEACONMANAGER_CHECKPOINT_PERIOD_MS
+	#define OVR_BEACONMANAGER_CHECKPOINT_PERIOD_MS		900000
+#endif
+
+// ...and sooner after beacons come and go, but never more often than this (flash wear)
+#ifndef OVR_BEACONMANAGER_CHECKPOINT_MINPERIOD_MS
+	#define OVR_BEACONMANAGER_CHECKPOINT_MINPERIOD_MS	60000
+#endif
+
+// bounds the stack used while reading/writing the checkpoint
+#ifndef OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK
+	#define OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK	8
 #endif
 
 
@@ -53,6 +109,97 @@
 typedef struct ovr_beaconManager ovr_beaconManager_t;
 
 
+/**
+ * @public
+ * Determines what happens when a new beacon is heard while the
+ * known beacon table is full
+ */
+typedef enum
+{
+	OVR_BEACONMANAGER_EVICTPOLICY_NONE,			///< newcomers are dropped
+	OVR_BEACONMANAGER_EVICTPOLICY_WEAKEST,		///< weakest beacon is evicted if the newcomer is sufficiently stronger
+	OVR_BEACONMANAGER_EVICTPOLICY_STALEST		///< longest-unheard beacon is evicted if it has been quiet long enough
+}ovr_beaconManager_evictPolicy_t;
+
+
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_BEACONMANAGER_MEMTIER_HOT,				///< proxies, rssi index, presence entries, rx fifo and listeners
+	OVR_BEACONMANAGER_MEMTIER_COLD				///< history slices
+}ovr_beaconManager_memTier_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint16_t maxNumBeacons;
+	uint16_t rxFifoSize_elems;
+	uint16_t maxNumListeners;
+}ovr_beaconManager_capacities_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t numTableFull;
+	uint32_t numEvictions;
+	uint32_t numRejected;
+	uint32_t numDeferred;				///< adverts from unknown beacons while the table was held
+}ovr_beaconManager_admissionStats_t;
+
+
+/**
+ * @public
+ * Ingest pipeline counters, maintained on the btle thread(s) and
+ * updated atomically so they can be read from any thread.
+ * Times are cumulative and wrap, so compare snapshots by difference.
+ */
+typedef struct
+{
+	uint32_t numAdvertsRx;				///< adverts carrying our company id
+	uint32_t numAdvertsAccepted;		///< parsed and queued for processing
+	uint32_t numAdvertsFiltered;		///< rejected by the beacon filter
+	uint32_t numAdvertsDropped;			///< lost because the rx fifo was full
+	uint32_t numUpdatesProcessed;
+
+	uint32_t queueLatency_total_us;		///< advert rx to start of processing
+	uint32_t queueLatency_max_us;
+	uint32_t processTime_total_us;		///< time spent draining the rx fifo
+	uint32_t processTime_max_us;
+}ovr_beaconManager_pipelineStats_t;
+
+
+/**
+ * @public
+ * Warm-start checkpoint counters (btle thread)
+ */
+typedef struct
+{
+	uint32_t numCheckpoints;
+	uint32_t numFailures;
+	uint32_t numRestored;				///< beacons recreated from the checkpoint at boot
+
+	uint32_t lastNumEntries;
+	uint32_t lastSize_bytes;
+	uint32_t lastWriteTime_us;
+	uint32_t maxWriteTime_us;
+}ovr_beaconManager_checkpointStats_t;
+
+
+/**
+ * @public
+ * Called for every beacon advert before it is parsed
+ */
+typedef void (*ovr_beaconManager_cb_advertListener_t)(int8_t rssi_dBmIn, uint8_t *const dataIn, size_t dataSize_bytesIn, void* userVarIn);
+
+
 /**
  * @public
  */
@@ -72,6 +219,19 @@ typedef struct
 }ovr_beaconManager_listenerEntry_t;
 
 
+/**
+ * @private
+ * A beacon we've heard but haven't found yet (or have just lost)
+ */
+typedef struct
+{
+	cxa_eui48_t eui48;
+	uint8_t numAdverts;							///< heard in a row, towards OVR_BEACONMANAGER_FOUND_NUMADVERTS
+	uint32_t lastRx_us;
+	ovr_beaconProxy_cadence_t cadence;
+}ovr_beaconManager_presenceEntry_t;
+
+
 /**
  * @private
  */
@@ -81,14 +241,41 @@ struct ovr_beaconManager
 
 	cxa_btle_client_t* btleClient;
 
+	// all of our tables are carved from these at init
+	ovr_beaconManager_capacities_t capacities;
+	ovr_memArena_t memArena_hot;
+	ovr_memArena_t memArena_cold;
+
 	cxa_array_t knownBeacons;
-	ovr_beaconProxy_t knownBeacons_raw[OVR_BEACONMANAGER_MAXNUM_BEACONS];
+	ovr_beaconHistory_arena_t historyArena;
 
-	cxa_fixedFifo_t rxUpdates;
-	ovr_beaconUpdate_t rxUpdates_raw[OVR_BEACONMANAGER_MAXSIZE_RX_FIFO];
+	// other threads walking knownBeacons hold off additions and removals (btle thread)
+	uint8_t numTableHolds;
+	bool isTableChanging;
+
+	// indices into knownBeacons, sorted by ascending smoothed rssi
+	uint16_t* rssiIndex;
+	uint16_t* rssiIndexPos;						///< where each proxy currently sits in rssiIndex
+
+	cxa_array_t presenceEntries;
+
+	ovr_beaconManager_evictPolicy_t evictPolicy;
+	ovr_beaconManager_admissionStats_t admissionStats;
+	ovr_beaconManager_pipelineStats_t pipelineStats;
+	size_t rxFifo_highWater_elems;
+
+	ovr_beaconManager_cb_advertListener_t cb_onAdvert;
+	void* cb_onAdvert_userVar;
 
+	cxa_timeDiff_t td_checkpoint;
+	bool isCheckpointDirty;
+	bool isCheckpointRequested;
+	ovr_beaconManager_checkpointStats_t checkpointStats;
+
+	ovr_beaconFilter_t filter;
+
+	cxa_fixedFifo_t rxUpdates;
 	cxa_array_t listeners;
-	ovr_beaconManager_listenerEntry_t listeners_raw[OVR_BEACONMANAGER_MAXNUM_LISTENERS];
 
 	ovr_beaconManager_rpcInterface_t bmri;
 
@@ -99,10 +286,39 @@ struct ovr_beaconManager
 // ******** global function prototypes ********
 /**
  * @public
+ * Beacons checkpointed before a reboot are restored here without
+ * generating found events (they'll still be lost normally if they
+ * don't reappear within their lost timeout).
+ *
+ * @param rpcNodeIn node under which to publish beacon events (may be NULL)
+ * @param btleThreadIdIn runLoop thread on which the btleClient runs
+ * @param rpcThreadIdIn runLoop thread on which the rpcNode runs
  */
 void ovr_beaconManager_init(ovr_beaconManager_t *const bmIn,
 							cxa_btle_client_t *const btleClientIn,
-							cxa_mqtt_rpc_node_t *const rpcNodeIn);
+							cxa_mqtt_rpc_node_t *const rpcNodeIn,
+							int btleThreadIdIn, int rpcThreadIdIn);
+
+/**
+ * @public
+ */
+ovr_beaconManager_capacities_t ovr_beaconManager_getCapacities(ovr_beaconManager_t *const bmIn);
+
+
+/**
+ * @public
+ * Stores capacities to be used from the next boot
+ * @return false if any capacity is out of range or they couldn't be saved
+ */
+bool ovr_beaconManager_saveCapacities(ovr_beaconManager_t *const bmIn, ovr_beaconManager_capacities_t capacitiesIn);
+
+
+/**
+ * @public
+ * @return the arena holding the given tier of the manager's tables (for usage reporting)
+ */
+ovr_memArena_t* ovr_beaconManager_getMemArena(ovr_beaconManager_t *const bmIn, ovr_beaconManager_memTier_t tierIn);
+
 
 /**
  * @public
@@ -115,13 +331,103 @@ void ovr_beaconManager_addListener(ovr_beaconManager_t *const bmIn,
 
 /**
  * @public
+ * Proxies are added and removed on the btle thread, and removing one
+ * shifts every proxy after it. Any other thread must hold the table
+ * (see ovr_beaconManager_holdKnownBeacons) while it walks it.
  */
 cxa_array_t* ovr_beaconManager_getKnownBeacons(ovr_beaconManager_t *const bmIn);
 
 
+/**
+ * @public
+ * Holds off additions and removals while another thread walks the known
+ * beacons. Keep holds short: newcomers aren't admitted and lost beacons
+ * aren't pruned until the table is released.
+ *
+ * @return false if the btle thread is mid-change (try again later)
+ */
+bool ovr_beaconManager_holdKnownBeacons(ovr_beaconManager_t *const bmIn);
+
+
+/**
+ * @public
+ */
+void ovr_beaconManager_releaseKnownBeacons(ovr_beaconManager_t *const bmIn);
+
+
+/**
+ * @public
+ */
+ovr_beaconFilter_t* ovr_beaconManager_getFilter(ovr_beaconManager_t *const bmIn);
+
+
 /**
  * @public
  */
 bool ovr_beaconManager_isRadioReady(ovr_beaconManager_t *const bmIn);
 
+
+/**
+ * @public
+ */
+void ovr_beaconManager_setEvictPolicy(ovr_beaconManager_t *const bmIn, ovr_beaconManager_evictPolicy_t policyIn);
+
+
+/**
+ * @public
+ */
+ovr_beaconManager_admissionStats_t ovr_beaconManager_getAdmissionStats(ovr_beaconManager_t *const bmIn);
+
+
+/**
+ * @public
+ */
+ovr_beaconManager_pipelineStats_t ovr_beaconManager_getPipelineStats(ovr_beaconManager_t *const bmIn);
+
+
+/**
+ * @public
+ * @return the deepest the rx fifo has been since the last call
+ */
+size_t ovr_beaconManager_takeRxFifoHighWater_elems(ovr_beaconManager_t *const bmIn);
+
+
+/**
+ * @public
+ * @return zeroes if the manager was initialized without an rpcNode
+ */
+ovr_beaconManager_rpcInterface_publishStats_t ovr_beaconManager_getPublishStats(ovr_beaconManager_t *const bmIn);
+
+
+/**
+ * @public
+ * Asks for the beacon table to be checkpointed on the next btle thread
+ * iteration, regardless of the usual cadence (eg. before a controlled
+ * restart). Safe to call from any thread.
+ */
+void ovr_beaconManager_requestCheckpoint(ovr_beaconManager_t *const bmIn);
+
+
+/**
+ * @public
+ */
+ovr_beaconManager_checkpointStats_t ovr_beaconManager_getCheckpointStats(ovr_beaconManager_t *const bmIn);
+
+
+/**
+ * @public
+ * Sets a single listener which sees the raw manufacturer data of
+ * every beacon advert (used for capture)
+ */
+void ovr_beaconManager_setAdvertListener(ovr_beaconManager_t *const bmIn, ovr_beaconManager_cb_advertListener_t cbIn, void* userVarIn);
+
+
+/**
+ * @public
+ * Feeds beacon manufacturer data into the ingest pipeline exactly as if
+ * it had been received over the air. Must be called from the btle thread.
+ * @return false if the advert was unparseable, filtered or dropped
+ */
+bool ovr_beaconManager_injectAdvert(ovr_beaconManager_t *const bmIn, int8_t rssi_dBmIn, cxa_fixedByteBuffer_t *const manBytesIn);
+
 #endif
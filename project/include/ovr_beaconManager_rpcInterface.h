@@ -19,11 +19,35 @@
 
 
 // ******** includes ********
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <cxa_eui48.h>
 #include <cxa_mqtt_rpc_node.h>
 #include <cxa_timeDiff.h>
 
+#include <ovr_beaconUpdate.h>
+#include <ovr_memArena.h>
+#include <ovr_reportSelector.h>
+
 
 // ******** global macro definitions ********
+// found/lost events held until the wall clock is set (oldest are displaced when full)
+#ifndef OVR_BEACONMANAGER_RPCINTERFACE_MAXNUM_PENDING_PRESENCE
+	#define OVR_BEACONMANAGER_RPCINTERFACE_MAXNUM_PENDING_PRESENCE		64
+#endif
+
+// getBeacons fieldMask bits (the beaconId is always included)
+#define OVR_BEACONMANAGER_RPCINTERFACE_FIELD_RSSI				(1 << 0)
+#define OVR_BEACONMANAGER_RPCINTERFACE_FIELD_LASTSEEN			(1 << 1)
+#define OVR_BEACONMANAGER_RPCINTERFACE_FIELD_BATTERY			(1 << 2)
+#define OVR_BEACONMANAGER_RPCINTERFACE_FIELD_ISCHARGING			(1 << 3)
+#define OVR_BEACONMANAGER_RPCINTERFACE_FIELD_TEMP				(1 << 4)
+#define OVR_BEACONMANAGER_RPCINTERFACE_FIELD_LIGHT				(1 << 5)
+#define OVR_BEACONMANAGER_RPCINTERFACE_FIELD_EVENTS				(1 << 6)
+
+// getBeacons filter flags
+#define OVR_BEACONMANAGER_RPCINTERFACE_QUERYFLAG_HASEVENTS		(1 << 0)
 
 
 // ******** global type definitions *********
@@ -38,6 +62,86 @@ typedef struct ovr_beaconManager ovr_beaconManager_t;
 typedef struct ovr_beaconProxy ovr_beaconProxy_t;
 
 
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t numPublishes;
+	uint32_t numBytes;
+	uint32_t numFailures;
+}ovr_beaconManager_rpcInterface_publishStats_t;
+
+
+/**
+ * @public
+ * Outcome of the most recent periodic report cycle
+ */
+typedef struct
+{
+	uint16_t numReported;
+	uint16_t numDeferred;
+	uint32_t numBytes;
+}ovr_beaconManager_rpcInterface_reportStats_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	cxa_eui48_t eui48;
+	bool isFound;
+	uint32_t time_us;				///< monotonic (cxa_timeBase)
+}ovr_beaconManager_rpcInterface_presenceEvent_t;
+
+
+/**
+ * @private
+ */
+typedef enum
+{
+	OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_IDLE,
+	OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_SNAPSHOT_REQUESTED,		///< network -> btle thread
+	OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_STREAMING					///< btle -> network thread
+}ovr_beaconManager_rpcInterface_queryState_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	uint16_t queryId;
+	uint16_t maxNumBeacons;
+	uint16_t fieldMask;
+	int8_t minRssi;
+	uint16_t seenWithin_s;				///< 0 for any
+	uint8_t flags;
+	uint8_t idPrefixLen_bytes;
+	uint8_t idPrefix[6];
+}ovr_beaconManager_rpcInterface_query_t;
+
+
+/**
+ * @private
+ * What getBeacons reports of a beacon, copied out of the table on the btle thread
+ */
+typedef struct
+{
+	cxa_eui48_t eui48;
+	int8_t rssi;
+	uint8_t batt_pcnt100;
+	uint16_t batt_mv;
+	int16_t temp_c10;
+	uint8_t light_255;
+	bool isCharging;
+	ovr_beaconProxy_deviceStatus_t devStatus;
+	uint8_t pendingAccelEvents;			///< bit per ovr_beaconProxy_accelEventType_t
+	uint32_t lastSeen_ms;				///< age when the snapshot was taken
+}ovr_beaconManager_rpcInterface_beaconRecord_t;
+
+
 /**
  * @private
  */
@@ -47,10 +151,50 @@ struct ovr_beaconManager_rpcInterface
 	cxa_mqtt_rpc_node_t* rpcNode;
 
 	cxa_timeDiff_t td_sendUpdate;
+	bool isUpdatePending;						///< due, but the table was mid-change
+
+	// which beacons to report when they don't all fit in our uplink budget
+	ovr_reportSelector_t reportSelector;
+	uint16_t reportIndices[OVR_REPORTSELECTOR_MAXNUM_SLOTS];
+	ovr_beaconManager_rpcInterface_reportStats_t reportStats;
+
+	ovr_beaconManager_rpcInterface_publishStats_t publishStats;
+
+	// queued on the btle thread, published on the network thread (under a critical section)
+	ovr_beaconManager_rpcInterface_presenceEvent_t pendingPresence[OVR_BEACONMANAGER_RPCINTERFACE_MAXNUM_PENDING_PRESENCE];
+	size_t pendingPresence_first;
+	size_t pendingPresence_count;
+	uint32_t numPresenceDropped;
+
+	// the batch handed to the publish scheduler (its events stay queued until it's published)
+	bool isPresenceBatchInFlight;
+	size_t presenceBatch_numEvents;
+	uint32_t presenceBatch_numDropped;		///< numPresenceDropped when the batch was formed
+
+	// getBeacons: the snapshot is only written while requested and only read while streaming
+	ovr_memArena_t snapshotArena;
+	ovr_beaconManager_rpcInterface_beaconRecord_t* snapshot;
+	size_t snapshot_maxNumRecords;
+	size_t snapshot_numRecords;
+	uint16_t snapshotId;
+	uint32_t snapshotTime_us;			///< monotonic (cxa_timeBase)
+	uint16_t nextQueryId;
+	ovr_beaconManager_rpcInterface_query_t query;
+	size_t query_startIndex;
+	size_t query_currIndex;
+	uint8_t queryState;					///< ovr_beaconManager_rpcInterface_queryState_t (atomic)
 };
 
 
 // ******** global function prototypes ********
-void ovr_beaconManager_rpcInterface_init(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconManager_t *const bmIn, cxa_mqtt_rpc_node_t *const rpcNodeIn);
+/**
+ * @public
+ * @param btleThreadIdIn thread that owns the beacon table (getBeacons snapshots are taken there)
+ * @param threadIdIn thread on which the mqtt client runs
+ */
+void ovr_beaconManager_rpcInterface_init(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconManager_t *const bmIn, cxa_mqtt_rpc_node_t *const rpcNodeIn,
+										 int btleThreadIdIn, int threadIdIn);
+
+ovr_beaconManager_rpcInterface_publishStats_t ovr_beaconManager_rpcInterface_getPublishStats(ovr_beaconManager_rpcInterface_t *const bmriIn);
 
 #endif
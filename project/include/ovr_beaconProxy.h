@@ -25,10 +25,32 @@
 #include <cxa_timeDiff.h>
 #include <cxa_eui48.h>
 
+#include <ovr_beaconHistory.h>
 #include <ovr_beaconUpdate.h>
 
 
 // ******** global macro definitions ********
+#define OVR_BEACONPROXY_NUM_ACCELEVENTS			4
+
+// one byte of per-beacon state for each edge rule
+#ifndef OVR_BEACONPROXY_NUM_RULESTATES
+	#define OVR_BEACONPROXY_NUM_RULESTATES		32
+#endif
+
+// rssi quantile sketch: fixed-width bins starting at the floor (0 bins disables)
+#ifndef OVR_BEACONPROXY_RSSISKETCH_NUMBINS
+	#define OVR_BEACONPROXY_RSSISKETCH_NUMBINS	16
+#endif
+#define OVR_BEACONPROXY_RSSISKETCH_FLOOR_DBM	-100
+#define OVR_BEACONPROXY_RSSISKETCH_BINWIDTH_DB	4
+
+// smoothed rssi weights each advert by 1/(2^shift)
+#ifndef OVR_BEACONPROXY_RSSISMOOTHING_SHIFT
+	#define OVR_BEACONPROXY_RSSISMOOTHING_SHIFT	3
+#endif
+
+// last advert (as received) + rssi + advert interval stats + accel event counts
+#define OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES	(15 + 1 + 2 + 4 + 4 + (2 * OVR_BEACONPROXY_NUM_ACCELEVENTS))
 
 
 // ******** global type definitions *********
@@ -39,6 +61,96 @@
 typedef struct ovr_beaconProxy ovr_beaconProxy_t;
 
 
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_BEACONPROXY_ACCELEVENT_ACTIVITY = 0,
+	OVR_BEACONPROXY_ACCELEVENT_1TAP = 1,
+	OVR_BEACONPROXY_ACCELEVENT_2TAP = 2,
+	OVR_BEACONPROXY_ACCELEVENT_FREEFALL = 3
+}ovr_beaconProxy_accelEventType_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	// latched while the beacon reports the event (matches the previous boolean behavior)
+	bool hasOccurred;
+
+	// number of times the beacon newly reported the event
+	uint16_t count;
+	// cxa_timeBase counts, only valid when count > 0
+	uint32_t first_us;
+	uint32_t last_us;
+}ovr_beaconProxy_accelEventStats_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	ovr_beaconProxy_accelEventStats_t events[OVR_BEACONPROXY_NUM_ACCELEVENTS];
+}ovr_beaconProxy_accelEvents_t;
+
+
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_BEACONPROXY_AGGFIELD_RSSI = 0,
+	OVR_BEACONPROXY_AGGFIELD_TEMP = 1,
+	OVR_BEACONPROXY_AGGFIELD_LIGHT = 2,
+	OVR_BEACONPROXY_AGGFIELD_BATTMV = 3,
+	OVR_BEACONPROXY_NUM_AGGFIELDS
+}ovr_beaconProxy_aggField_t;
+
+
+/**
+ * @public
+ * Values are in the update's own fixed-point units (dBm, deciDegC, 0-255, mV)
+ */
+typedef struct
+{
+	int16_t min;
+	int16_t max;
+	int16_t last;
+	int32_t sum;
+}ovr_beaconProxy_aggregate_t;
+
+
+/**
+ * @public
+ * Everything received over one reporting window
+ */
+typedef struct
+{
+	uint16_t count;
+	ovr_beaconProxy_aggregate_t fields[OVR_BEACONPROXY_NUM_AGGFIELDS];
+#if OVR_BEACONPROXY_RSSISKETCH_NUMBINS > 0
+	uint16_t rssiBins[OVR_BEACONPROXY_RSSISKETCH_NUMBINS];
+#endif
+}ovr_beaconProxy_aggregates_t;
+
+
+/**
+ * @public
+ * What has been learned about a beacon's advertising cadence (outlives
+ * the proxy so a beacon that is lost and re-found doesn't start over)
+ */
+typedef struct
+{
+	uint16_t numIntervalSamples;
+	uint32_t advertInterval_avg_ms;
+	uint32_t advertInterval_dev_ms;
+}ovr_beaconProxy_cadence_t;
+
+
 /**
  * @private
  */
@@ -46,17 +158,44 @@ struct ovr_beaconProxy
 {
 	cxa_timeDiff_t td_lastUpdate;
 
+	ovr_beaconProxy_cadence_t cadence;
+	int16_t rssiSmoothed_q4;					///< EWMA in 1/16 dBm
+
 	ovr_beaconUpdate_t lastUpdate;
+	ovr_beaconHistory_t history;
+
+	// counted on the btle thread and taken on the network thread (critical section)
+	ovr_beaconProxy_accelEvents_t accelEvents;
+	ovr_beaconProxy_aggregates_t aggregates;
 
-	ovr_beaconProxy_accelStatus_t cachedAccelStatus;
+	// owned by the rules engine (btle thread only)
+	uint8_t ruleStates[OVR_BEACONPROXY_NUM_RULESTATES];
 };
 
 
 // ******** global function prototypes ********
 /**
  * @protected
+ * @param historyArenaIn arena from which to claim history storage (may be NULL)
  */
-bool ovr_beaconProxy_init(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpdate_t *const updateIn);
+bool ovr_beaconProxy_init(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpdate_t *const updateIn, ovr_beaconHistory_arena_t *const historyArenaIn);
+
+
+/**
+ * @protected
+ * Recreates a proxy from a record written by ovr_beaconProxy_writeCheckpoint.
+ * The proxy is treated as just heard (history starts fresh) but keeps its
+ * advertising cadence, latched accelerometer state and pending event counts.
+ * @return false if the record is malformed
+ */
+bool ovr_beaconProxy_initFromCheckpoint(ovr_beaconProxy_t *const beaconProxyIn, uint8_t *const recordIn, size_t recordSize_bytesIn, ovr_beaconHistory_arena_t *const historyArenaIn);
+
+
+/**
+ * @protected
+ * Releases any shared storage held by the proxy
+ */
+void ovr_beaconProxy_deinit(ovr_beaconProxy_t *const beaconProxyIn);
 
 
 /**
@@ -79,16 +218,81 @@ ovr_beaconUpdate_t* ovr_beaconProxy_getLastUpdate(ovr_beaconProxy_t *const beaco
 
 /**
  * @public
- * Returns whether the beacon has pending activity. If there is pending activity
- * AND the last update indicated activity, pending activity remains true. If there
- * is pending activity AND the last update indicates no activity, pending activity
- * becomes false.
+ * Exponentially-weighted average of every advert's rssi (so a single
+ * faded or reflected advert barely moves it)
+ */
+int8_t ovr_beaconProxy_getSmoothedRssi(ovr_beaconProxy_t *const beaconProxyIn);
+
+
+/**
+ * @public
+ * Returns the accelerometer events recorded since the last call and
+ * resets them. Event counts are cleared, while each hasOccurred flag
+ * is reset to whether the last update still indicates that event.
  *
  * @parameter beaconProxyIn pre-initialize beaconProxy
  *
- * @return whether the beacon has pending activity
+ * @return the accelerometer events since the last call
  */
-ovr_beaconProxy_accelStatus_t ovr_beaconProxy_checkAndResetAccelStatus(ovr_beaconProxy_t *const beaconProxyIn);
+ovr_beaconProxy_accelEvents_t ovr_beaconProxy_checkAndResetAccelEvents(ovr_beaconProxy_t *const beaconProxyIn);
+
+
+/**
+ * @public
+ * Returns whether the given event has been newly reported since the
+ * last call to ovr_beaconProxy_checkAndResetAccelEvents. Does not reset.
+ */
+bool ovr_beaconProxy_hasPendingAccelEvent(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconProxy_accelEventType_t typeIn);
+
+
+/**
+ * @public
+ * Returns the aggregates of every update since the last call and starts
+ * a new window. Safe to call from any thread.
+ */
+ovr_beaconProxy_aggregates_t ovr_beaconProxy_takeAggregates(ovr_beaconProxy_t *const beaconProxyIn);
+
+
+/**
+ * @public
+ * Returns the aggregates of the current window without resetting them
+ */
+ovr_beaconProxy_aggregates_t ovr_beaconProxy_getAggregates(ovr_beaconProxy_t *const beaconProxyIn);
+
+
+/**
+ * @public
+ * Estimates an rssi quantile from the aggregates' sketch (to within a bin)
+ * @param quantile_pcntIn 0-100
+ * @return the window's last rssi if there is no sketch or no samples
+ */
+int8_t ovr_beaconProxy_getRssiQuantile(ovr_beaconProxy_aggregates_t *const aggregatesIn, uint8_t quantile_pcntIn);
+
+
+/**
+ * @public
+ * Removes the oldest recorded samples (those received since the last
+ * drain) and encodes them into bufOut. See ovr_beaconHistory_drainBatch
+ * for the format.
+ *
+ * @return the number of bytes written (0 if there is no history)
+ */
+size_t ovr_beaconProxy_drainHistory(ovr_beaconProxy_t *const beaconProxyIn, uint8_t *const bufOut, size_t maxSize_bytesIn, size_t *const numSamplesOut);
+
+
+/**
+ * @protected
+ * Serializes the state needed to warm-start this proxy after a reboot
+ * @param recordOut must hold OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES
+ */
+void ovr_beaconProxy_writeCheckpoint(ovr_beaconProxy_t *const beaconProxyIn, uint8_t *const recordOut);
+
+
+/**
+ * @protected
+ * @return OVR_BEACONPROXY_NUM_RULESTATES bytes of state for the rules engine (zeroed at init)
+ */
+uint8_t* ovr_beaconProxy_getRuleStates(ovr_beaconProxy_t *const beaconProxyIn);
 
 
 /**
@@ -97,9 +301,56 @@ ovr_beaconProxy_accelStatus_t ovr_beaconProxy_checkAndResetAccelStatus(ovr_beaco
 void ovr_beaconProxy_update(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpdate_t *const updateIn);
 
 
+/**
+ * @public
+ */
+uint32_t ovr_beaconProxy_getTimeSinceLastUpdate_ms(ovr_beaconProxy_t *const beaconProxyIn);
+
+
+/**
+ * @public
+ * Returns the amount of time this beacon may go unheard before it is
+ * considered lost. Derived from the observed advertising cadence (which
+ * already reflects the reception ratio) and bounded between
+ * OVR_BEACONPROXY_LOSTTIMEOUT_MIN_MS and OVR_BEACONPROXY_LOSTTIMEOUT_MAX_MS.
+ *
+ * @parameter beaconProxyIn pre-initialized beaconProxy
+ *
+ * @return the current lost timeout, in milliseconds
+ */
+uint32_t ovr_beaconProxy_getLostTimeout_ms(ovr_beaconProxy_t *const beaconProxyIn);
+
+
 /**
  * @protected
  */
 bool ovr_beaconProxy_hasTimedOut(ovr_beaconProxy_t *const beaconProxyIn);
 
+
+/**
+ * @protected
+ */
+ovr_beaconProxy_cadence_t ovr_beaconProxy_getCadence(ovr_beaconProxy_t *const beaconProxyIn);
+
+
+/**
+ * @protected
+ * Replaces the (freshly initialized) proxy's cadence with one learned earlier
+ */
+void ovr_beaconProxy_setCadence(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconProxy_cadence_t *const cadenceIn);
+
+
+/**
+ * @protected
+ * Adds the time between two received adverts to the cadence
+ */
+void ovr_beaconProxy_cadence_addInterval(ovr_beaconProxy_cadence_t *const cadenceIn, uint32_t interval_msIn);
+
+
+/**
+ * @public
+ * @return the lost timeout for the given cadence (see ovr_beaconProxy_getLostTimeout_ms)
+ */
+uint32_t ovr_beaconProxy_cadence_getLostTimeout_ms(ovr_beaconProxy_cadence_t *const cadenceIn);
+
 #endif
@@ -0,0 +1,175 @@
+/**
+ * @file
+ * Gateway-side threshold alerts. Rules such as "temp_c > 8 for 2" or
+ * "freeFall" or "batt_pcnt100 < 10" are pushed via rpc, compiled into a
+ * small bytecode and evaluated against every beacon update on the btle
+ * thread. A match publishes an alert immediately rather than waiting for
+ * the next periodic beacon update.
+ *
+ * Rule text is a space-separated list of terms joined by 'and' / 'or'
+ * (evaluated left to right), each optionally preceded by 'not':
+ *     <field> <op> <number>      op: > >= < <= == !=
+ *     <flag>                     isCharging, activity, 1tap, 2tap, freeFall
+ * followed by an optional 'for <n>' requiring n consecutive matching
+ * updates before alerting. An alert fires once, then re-arms when the
+ * condition stops matching.
+ *
+ * Bytecode has no jumps so evaluation cost is bounded by its size.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_BEACONRULES_H_
+#define OVR_BEACONRULES_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <cxa_logger_header.h>
+#include <cxa_mqtt_rpc_node.h>
+
+#include <ovr_beaconProxy.h>
+#include <ovr_beaconUpdate.h>
+
+
+// ******** global macro definitions ********
+// each rule keeps one state byte in every beacon proxy
+#define OVR_BEACONRULES_MAXNUM_RULES				OVR_BEACONPROXY_NUM_RULESTATES
+
+#ifndef OVR_BEACONRULES_MAXSIZE_BYTECODE
+	#define OVR_BEACONRULES_MAXSIZE_BYTECODE		32
+#endif
+
+#define OVR_BEACONRULES_MAXLEN_TEXT					96
+#define OVR_BEACONRULES_MAXNUM_CONSECUTIVE			127
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_beaconRules ovr_beaconRules_t;
+
+
+// forward declaration to avoid include cycle
+typedef struct ovr_beaconManager ovr_beaconManager_t;
+
+
+/**
+ * @public
+ * A compiled rule (all bytes so it can be stored as-is)
+ */
+typedef struct
+{
+	uint8_t id;
+	uint8_t numConsecutive;
+	uint8_t codeSize_bytes;
+	uint8_t code[OVR_BEACONRULES_MAXSIZE_BYTECODE];
+}ovr_beaconRules_rule_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t numUpdates;
+	uint32_t numEvaluations;
+	uint32_t numAlerts;
+	uint32_t numPublishFailures;
+	uint32_t evalTime_total_us;
+	uint32_t evalTime_max_us;
+}ovr_beaconRules_stats_t;
+
+
+/**
+ * @private
+ */
+struct ovr_beaconRules
+{
+	ovr_beaconManager_t* bm;
+	cxa_mqtt_rpc_node_t rpcNode;
+
+	// written on the btle thread, read elsewhere under a critical section
+	ovr_beaconRules_rule_t rules[OVR_BEACONRULES_MAXNUM_RULES];
+	bool isRuleUsed[OVR_BEACONRULES_MAXNUM_RULES];
+
+	// a single change handed from the rpc thread to the btle thread
+	bool hasPendingChange;
+	bool isPendingRemoval;
+	ovr_beaconRules_rule_t pendingRule;
+
+	ovr_beaconRules_stats_t stats;
+
+	cxa_logger_t logger;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Loads any rules saved in nvs
+ * @param rootNodeIn node under which the 'rules' node is created
+ * @param btleThreadIdIn runLoop thread on which the beacon manager runs
+ */
+void ovr_beaconRules_init(ovr_beaconRules_t *const brIn, ovr_beaconManager_t *const bmIn, cxa_mqtt_rpc_node_t *const rootNodeIn, int btleThreadIdIn);
+
+
+/**
+ * @public
+ * Compiles and queues a rule to replace whatever is in the given slot.
+ * Applied (and saved) on the next btle thread iteration. Safe to call from any thread.
+ * @return false if the text doesn't compile or another change is still pending
+ */
+bool ovr_beaconRules_setRule(ovr_beaconRules_t *const brIn, uint8_t idIn, const char *const textIn);
+
+
+/**
+ * @public
+ * Safe to call from any thread.
+ * @return false if another change is still pending
+ */
+bool ovr_beaconRules_removeRule(ovr_beaconRules_t *const brIn, uint8_t idIn);
+
+
+/**
+ * @public
+ * Copies out the active rules. Safe to call from any thread.
+ * @return the number of rules copied
+ */
+size_t ovr_beaconRules_getRules(ovr_beaconRules_t *const brIn, ovr_beaconRules_rule_t *const rulesOut, size_t maxNumRulesIn);
+
+
+/**
+ * @public
+ */
+ovr_beaconRules_stats_t ovr_beaconRules_getStats(ovr_beaconRules_t *const brIn);
+
+
+/**
+ * @public
+ * @return false if the text is malformed or too long for the bytecode
+ */
+bool ovr_beaconRules_compile(const char *const textIn, uint8_t idIn, ovr_beaconRules_rule_t *const ruleOut);
+
+
+/**
+ * @public
+ * @return true if the rule's condition holds for this update (false for malformed bytecode)
+ */
+bool ovr_beaconRules_evaluate(ovr_beaconRules_rule_t *const ruleIn, ovr_beaconUpdate_t *const updateIn);
+
+#endif
@@ -76,6 +76,8 @@ typedef struct
 
 	uint16_t currTemp_deciDegC;
 	uint8_t light_255;
+
+	uint32_t rxTime_us;
 }ovr_beaconUpdate_t;
 
 
@@ -90,6 +92,7 @@ ovr_beaconProxy_deviceStatus_t ovr_beaconUpdate_getDeviceStatus(ovr_beaconUpdate
 uint8_t ovr_beaconUpdate_getStatusByte(ovr_beaconUpdate_t *const updateIn);
 
 ovr_beaconProxy_accelStatus_t ovr_beaconUpdate_getAccelStatus(ovr_beaconUpdate_t *const updateIn);
+uint8_t ovr_beaconUpdate_getAccelStatusByte(ovr_beaconUpdate_t *const updateIn);
 
 uint8_t ovr_beaconUpdate_getBattery_pcnt100(ovr_beaconUpdate_t *const updateIn);
 float ovr_beaconUpdate_getBattery_v(ovr_beaconUpdate_t *const updateIn);
@@ -0,0 +1,165 @@
+/**
+ * @file
+ * Deferred binary logger for hot paths. Callers store a format id and raw
+ * 32-bit arguments into a lock-free ring; formatting happens later on a
+ * low-priority runLoop thread (or on a host, using the same format table).
+ *
+ * Each module selects its level at compile time by defining OVR_BINLOG_LEVEL
+ * (using the CXA_LOG_LEVEL_* values) before including this file. Calls
+ * above that level compile to nothing.
+ *
+ * Format strings may only use integer conversions since every argument
+ * is stored as a uint32_t.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_BINLOG_H_
+#define OVR_BINLOG_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cxa_logger_header.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_BINLOG_LEVEL
+	#define OVR_BINLOG_LEVEL					CXA_LOG_LEVEL_INFO
+#endif
+
+#ifndef OVR_BINLOG_NUM_SLOTS
+	#define OVR_BINLOG_NUM_SLOTS				64		// must be a power of 2
+#endif
+
+#define OVR_BINLOG_MAXNUM_ARGS					10
+
+
+/**
+ * Table of every deferred format: X(id, module, format)
+ */
+#define OVR_BINLOG_FORMATS(X) \
+	X(BEACONUPDATED,	"beaconManager",	"updated '%04X%08X'  rssi: %d  ds: 0x%02X  as: 0x%02X  t: %d/10 C  b:%d%% (%d mV)  l: %d") \
+	X(BEACONQUEUED,		"beaconManager",	"queued '%04X%08X'  rssi: %d")
+
+
+// expands to two arguments for a '%04X%08X' conversion
+#define OVR_BINLOG_EUI48_ARGS(eui48In)			(((uint32_t)(eui48In)->bytes[0] << 8) | (eui48In)->bytes[1]), \
+												(((uint32_t)(eui48In)->bytes[2] << 24) | ((uint32_t)(eui48In)->bytes[3] << 16) | \
+												 ((uint32_t)(eui48In)->bytes[4] << 8) | (eui48In)->bytes[5])
+
+#define OVR_BINLOG_ARGS(...)					((const uint32_t[]){ __VA_ARGS__ })
+#define OVR_BINLOG_NUMARGS(...)					(sizeof(OVR_BINLOG_ARGS(__VA_ARGS__)) / sizeof(uint32_t))
+
+#define ovr_binLog_log(levelIn, fmtIdIn, ...) \
+	ovr_binLog_write((levelIn), OVR_BINLOG_FMTID_##fmtIdIn, OVR_BINLOG_ARGS(__VA_ARGS__), OVR_BINLOG_NUMARGS(__VA_ARGS__))
+
+#if OVR_BINLOG_LEVEL >= CXA_LOG_LEVEL_ERROR
+	#define ovr_binLog_error(fmtIdIn, ...)		ovr_binLog_log(CXA_LOG_LEVEL_ERROR, fmtIdIn, __VA_ARGS__)
+#else
+	#define ovr_binLog_error(fmtIdIn, ...)
+#endif
+
+#if OVR_BINLOG_LEVEL >= CXA_LOG_LEVEL_WARN
+	#define ovr_binLog_warn(fmtIdIn, ...)		ovr_binLog_log(CXA_LOG_LEVEL_WARN, fmtIdIn, __VA_ARGS__)
+#else
+	#define ovr_binLog_warn(fmtIdIn, ...)
+#endif
+
+#if OVR_BINLOG_LEVEL >= CXA_LOG_LEVEL_INFO
+	#define ovr_binLog_info(fmtIdIn, ...)		ovr_binLog_log(CXA_LOG_LEVEL_INFO, fmtIdIn, __VA_ARGS__)
+#else
+	#define ovr_binLog_info(fmtIdIn, ...)
+#endif
+
+#if OVR_BINLOG_LEVEL >= CXA_LOG_LEVEL_DEBUG
+	#define ovr_binLog_debug(fmtIdIn, ...)		ovr_binLog_log(CXA_LOG_LEVEL_DEBUG, fmtIdIn, __VA_ARGS__)
+#else
+	#define ovr_binLog_debug(fmtIdIn, ...)
+#endif
+
+#if OVR_BINLOG_LEVEL >= CXA_LOG_LEVEL_TRACE
+	#define ovr_binLog_trace(fmtIdIn, ...)		ovr_binLog_log(CXA_LOG_LEVEL_TRACE, fmtIdIn, __VA_ARGS__)
+#else
+	#define ovr_binLog_trace(fmtIdIn, ...)
+#endif
+
+
+// ******** global type definitions *********
+#define OVR_BINLOG_FMTID_ENUM(idIn, moduleIn, fmtIn)		OVR_BINLOG_FMTID_##idIn,
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_BINLOG_FORMATS(OVR_BINLOG_FMTID_ENUM)
+	OVR_BINLOG_NUM_FMTIDS
+}ovr_binLog_fmtId_t;
+
+
+/**
+ * @public
+ * One entry as stored in the ring
+ */
+typedef struct
+{
+	uint32_t timestamp_ms;
+	uint8_t fmtId;
+	uint8_t level;
+	uint8_t numArgs;
+	uint32_t args[OVR_BINLOG_MAXNUM_ARGS];
+}ovr_binLog_entry_t;
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * @param threadIdIn runLoop thread on which entries are formatted and written
+ *		to the logger's global ioStream (should be a low-priority thread)
+ */
+void ovr_binLog_init(int threadIdIn);
+
+
+/**
+ * @public
+ * Safe to call from any thread. Drops the entry if the ring is full.
+ * Use the level macros rather than calling this directly.
+ */
+void ovr_binLog_write(uint8_t levelIn, ovr_binLog_fmtId_t fmtIdIn, const uint32_t *const argsIn, size_t numArgsIn);
+
+
+/**
+ * @public
+ * Removes the oldest entry from the ring (single consumer)
+ * @return false if the ring is empty
+ */
+bool ovr_binLog_read(ovr_binLog_entry_t *const entryOut);
+
+
+/**
+ * @public
+ * Formats an entry into a human-readable line
+ */
+void ovr_binLog_format(ovr_binLog_entry_t *const entryIn, char *const bufferOut, size_t maxSize_bytesIn);
+
+
+/**
+ * @public
+ */
+uint32_t ovr_binLog_getNumDropped(void);
+
+#endif
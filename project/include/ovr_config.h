@@ -0,0 +1,129 @@
+/**
+ * @file
+ * Registry of the gateway's runtime-tunable periods and timeouts. Each entry
+ * has a default, a valid range and an nvs key; modules read their entries
+ * through ovr_config_get every time they use them so a change takes effect
+ * without a reboot.
+ *
+ * Profiles are named sets of values for every entry (eg. trading bandwidth
+ * for latency). Applying one validates, stores and persists all of its
+ * values together. Setting any single entry afterwards leaves the gateway on
+ * the custom profile.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_CONFIG_H_
+#define OVR_CONFIG_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cxa_mqtt_rpc_node.h>
+
+
+// ******** global macro definitions ********
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ * Values are stored in nvs by id so only ever append to this list
+ */
+typedef enum
+{
+	OVR_CONFIG_ID_UPDATE_PERIOD_MS = 0,			///< per-beacon updates
+	OVR_CONFIG_ID_CHECKIN_PERIOD_MS = 1,		///< gateway check-ins
+	OVR_CONFIG_ID_SENSORREAD_PERIOD_MS = 2,		///< on-board temp/light sensors
+	OVR_CONFIG_ID_SCANCHECK_PERIOD_MS = 3,		///< restarting a stalled btle scan
+	OVR_CONFIG_ID_LOSTTIMEOUT_MS = 4,			///< until a beacon's advert interval is known
+	OVR_CONFIG_NUM_IDS
+}ovr_config_id_t;
+
+
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_CONFIG_PROFILE_DEFAULT = 0,
+	OVR_CONFIG_PROFILE_LOWLATENCY = 1,
+	OVR_CONFIG_PROFILE_LOWBANDWIDTH = 2,
+	OVR_CONFIG_PROFILE_CUSTOM = 3				///< one or more entries set individually
+}ovr_config_profile_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	const char* name;
+	const char* nvsKey;
+	uint32_t min;
+	uint32_t max;
+	uint32_t profileValues[OVR_CONFIG_PROFILE_CUSTOM];
+}ovr_config_entryInfo_t;
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Loads any saved values. Call before anything that reads its config.
+ *
+ * @param rootNodeIn node under which the 'config' node is created (may be NULL)
+ */
+void ovr_config_init(cxa_mqtt_rpc_node_t *const rootNodeIn);
+
+
+/**
+ * @public
+ * Safe to call from any thread (and before ovr_config_init, which returns defaults)
+ */
+uint32_t ovr_config_get(ovr_config_id_t idIn);
+
+
+/**
+ * @public
+ * Validates every value before changing any of them, then saves them to nvs
+ * and switches to the custom profile
+ *
+ * @return false if an id or value is out of range or they couldn't be saved
+ */
+bool ovr_config_set(const ovr_config_id_t *const idsIn, const uint32_t *const valuesIn, size_t numValuesIn);
+
+
+/**
+ * @public
+ * @return false if the profile is unknown (or custom) or it couldn't be saved
+ */
+bool ovr_config_applyProfile(ovr_config_profile_t profileIn);
+
+
+/**
+ * @public
+ */
+ovr_config_profile_t ovr_config_getProfile(void);
+
+
+/**
+ * @public
+ * @return NULL if the id is out of range
+ */
+const ovr_config_entryInfo_t* ovr_config_getEntryInfo(ovr_config_id_t idIn);
+
+#endif
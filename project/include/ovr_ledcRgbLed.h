@@ -0,0 +1,145 @@
+/**
+ * @file
+ * RGB LED driven by three channels of the ESP32's LEDC peripheral. Colour
+ * changes may be requested from any thread; the LEDC itself is only touched
+ * from the owning runLoop thread, which also runs blinks and activity dips.
+ *
+ * Activity is shown as a periodic dip of the solid colour whose depth is
+ * set by the caller (eg. from an aggregated event rate). The dips are done
+ * with the peripheral's hardware fades, so the cost of showing activity is
+ * a few register writes per period regardless of how busy things are.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_LEDCRGBLED_H_
+#define OVR_LEDCRGBLED_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/ledc.h"
+
+#include <cxa_timeDiff.h>
+
+
+// ******** global macro definitions ********
+// every LED shares this timer
+#ifndef OVR_LEDCRGBLED_TIMER
+	#define OVR_LEDCRGBLED_TIMER					LEDC_TIMER_0
+#endif
+
+#ifndef OVR_LEDCRGBLED_FREQ_HZ
+	#define OVR_LEDCRGBLED_FREQ_HZ					5000
+#endif
+
+#define OVR_LEDCRGBLED_NUM_CHANNELS				3
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_ledcRgbLed ovr_ledcRgbLed_t;
+
+
+/**
+ * @private
+ */
+typedef enum
+{
+	OVR_LEDCRGBLED_MODE_SOLID,
+	OVR_LEDCRGBLED_MODE_BLINK
+}ovr_ledcRgbLed_mode_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	ovr_ledcRgbLed_mode_t mode;
+	uint8_t rgb[OVR_LEDCRGBLED_NUM_CHANNELS];
+	uint16_t onPeriod_ms;
+	uint16_t offPeriod_ms;
+
+	uint8_t activityDepth_255;
+	uint16_t activityPeriod_ms;
+}ovr_ledcRgbLed_request_t;
+
+
+/**
+ * @private
+ */
+struct ovr_ledcRgbLed
+{
+	ledc_channel_t channels[OVR_LEDCRGBLED_NUM_CHANNELS];
+	bool isInverted;
+
+	// written from any thread (under a critical section), applied on ours
+	ovr_ledcRgbLed_request_t request;
+	bool isRequestPending;
+
+	ovr_ledcRgbLed_request_t current;
+	cxa_timeDiff_t td_phase;
+	bool isPhaseOn;						///< blink on / activity dip fading back up
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Claims OVR_LEDCRGBLED_NUM_CHANNELS consecutive channels starting at firstChannelIn
+ *
+ * @param isInvertedIn true if the LED lights when its pin is low
+ * @return false if the peripheral couldn't be configured
+ */
+bool ovr_ledcRgbLed_init(ovr_ledcRgbLed_t *const ledIn, int gpioNum_rIn, int gpioNum_gIn, int gpioNum_bIn, bool isInvertedIn,
+						 ledc_channel_t firstChannelIn, int threadIdIn);
+
+
+/**
+ * @public
+ * Cancels any blink (the activity dip, if any, continues on the new colour)
+ */
+void ovr_ledcRgbLed_setRgb(ovr_ledcRgbLed_t *const ledIn, uint8_t rIn, uint8_t gIn, uint8_t bIn);
+
+
+/**
+ * @public
+ * Alternates between the given colour and off
+ */
+void ovr_ledcRgbLed_blink(ovr_ledcRgbLed_t *const ledIn, uint8_t rIn, uint8_t gIn, uint8_t bIn, uint16_t onPeriod_msIn, uint16_t offPeriod_msIn);
+
+
+/**
+ * @public
+ * Dims the solid colour by depthIn then fades it back, once every periodIn.
+ * Ignored while blinking.
+ *
+ * @param depthIn 0 for no dip, 255 to dip all the way to off
+ */
+void ovr_ledcRgbLed_setActivity(ovr_ledcRgbLed_t *const ledIn, uint8_t depthIn, uint16_t period_msIn);
+
+
+/**
+ * @public
+ * Writes the colour straight to the peripheral from the calling thread
+ * (for use when the runLoop has stopped, eg. on assert)
+ */
+void ovr_ledcRgbLed_forceRgb(ovr_ledcRgbLed_t *const ledIn, uint8_t rIn, uint8_t gIn, uint8_t bIn);
+
+#endif
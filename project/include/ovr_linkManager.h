@@ -0,0 +1,73 @@
+/**
+ * @file
+ * Coordinates the gateway's ethernet and wifi uplinks. Link and address
+ * events from the esp event loop are queued to our runLoop thread where an
+ * ovr_linkSelector decides which link should carry traffic. When that
+ * changes we move the default route and drop the mqtt connection so it is
+ * re-established over the new link straight away (rather than after
+ * keepalives time out on the old one).
+ *
+ * Both links are left running so the standby link is already addressed
+ * when it's needed.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_LINKMANAGER_H_
+#define OVR_LINKMANAGER_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <ovr_linkSelector.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_LINKMANAGER_PREFERRED_LINK
+	#define OVR_LINKMANAGER_PREFERRED_LINK			OVR_LINKSELECTOR_LINK_ETH
+#endif
+
+#ifndef OVR_LINKMANAGER_MAXNUM_QUEUED_EVENTS
+	#define OVR_LINKMANAGER_MAXNUM_QUEUED_EVENTS	16
+#endif
+
+
+// ******** global type definitions *********
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Call once the esp event loop has been started and before either interface
+ * is brought up (so we see their first events)
+ */
+void ovr_linkManager_init(int threadIdIn);
+
+
+/**
+ * @public
+ * Safe to call from any thread
+ */
+ovr_linkSelector_link_t ovr_linkManager_getActiveLink(void);
+
+
+/**
+ * @public
+ * Safe to call from any thread
+ */
+ovr_linkSelector_stats_t ovr_linkManager_getStats(void);
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file
+ * Decides which uplink (ethernet or wifi) the gateway should be using. It
+ * is fed link up/down and ip events as they happen and has no dependencies
+ * on the network stack (the current time is passed in), so the decisions
+ * can be exercised off-target by replaying events.
+ *
+ * A link is usable once it's up and has an address. The preferred link is
+ * used whenever it's usable; if the active link is lost we move straight to
+ * the other one if it's usable (or as soon as it becomes so). Moving back to
+ * the preferred link waits until it has stayed usable for
+ * OVR_LINKSELECTOR_FAILBACK_HOLDOFF_MS so a flapping cable doesn't bounce
+ * the uplink.
+ *
+ * Failover latency is measured from losing the active link to having a
+ * replacement selected.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_LINKSELECTOR_H_
+#define OVR_LINKSELECTOR_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_LINKSELECTOR_FAILBACK_HOLDOFF_MS
+	#define OVR_LINKSELECTOR_FAILBACK_HOLDOFF_MS		5000
+#endif
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_linkSelector ovr_linkSelector_t;
+
+
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_LINKSELECTOR_LINK_ETH = 0,
+	OVR_LINKSELECTOR_LINK_WIFI = 1,
+	OVR_LINKSELECTOR_NUM_LINKS,
+	OVR_LINKSELECTOR_LINK_NONE = OVR_LINKSELECTOR_NUM_LINKS
+}ovr_linkSelector_link_t;
+
+
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_LINKSELECTOR_EVENT_LINKUP,
+	OVR_LINKSELECTOR_EVENT_LINKDOWN,			///< also loses the address
+	OVR_LINKSELECTOR_EVENT_GOTIP,
+	OVR_LINKSELECTOR_EVENT_LOSTIP
+}ovr_linkSelector_event_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t numEvents;
+	uint32_t numLinkChanges;					///< any change of active link (including to/from none)
+	uint32_t numFailovers;						///< active link lost and a replacement selected
+	uint32_t numOutages;						///< active link lost with nothing to replace it
+	uint32_t lastFailoverLatency_ms;
+	uint32_t maxFailoverLatency_ms;
+}ovr_linkSelector_stats_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	bool isUp;
+	bool hasIp;
+	uint32_t usableSince_ms;
+}ovr_linkSelector_linkState_t;
+
+
+/**
+ * @private
+ */
+struct ovr_linkSelector
+{
+	ovr_linkSelector_link_t preferredLink;
+	ovr_linkSelector_link_t activeLink;
+	ovr_linkSelector_linkState_t links[OVR_LINKSELECTOR_NUM_LINKS];
+
+	bool isFailingOver;
+	ovr_linkSelector_link_t lostLink;
+	uint32_t lostTime_ms;
+
+	ovr_linkSelector_stats_t stats;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Starts with every link down
+ */
+void ovr_linkSelector_init(ovr_linkSelector_t *const lsIn, ovr_linkSelector_link_t preferredLinkIn);
+
+
+/**
+ * @public
+ * @return true if the active link changed
+ */
+bool ovr_linkSelector_onEvent(ovr_linkSelector_t *const lsIn, ovr_linkSelector_link_t linkIn, ovr_linkSelector_event_t eventIn, uint32_t now_msIn);
+
+
+/**
+ * @public
+ * Call periodically (to fail back once the holdoff expires)
+ *
+ * @return true if the active link changed
+ */
+bool ovr_linkSelector_update(ovr_linkSelector_t *const lsIn, uint32_t now_msIn);
+
+
+/**
+ * @public
+ */
+ovr_linkSelector_link_t ovr_linkSelector_getActiveLink(ovr_linkSelector_t *const lsIn);
+
+
+/**
+ * @public
+ */
+bool ovr_linkSelector_isLinkUsable(ovr_linkSelector_t *const lsIn, ovr_linkSelector_link_t linkIn);
+
+
+/**
+ * @public
+ */
+ovr_linkSelector_stats_t ovr_linkSelector_getStats(ovr_linkSelector_t *const lsIn);
+
+
+/**
+ * @public
+ */
+const char* ovr_linkSelector_getLinkName(ovr_linkSelector_link_t linkIn);
+
+#endif
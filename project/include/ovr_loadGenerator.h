@@ -0,0 +1,180 @@
+/**
+ * @file
+ * Synthesizes a fleet of beacons and drives their adverts through the
+ * beacon manager's ingest path. Scenarios are seeded so the sequence of
+ * adverts is repeatable. Scenario time is the time base the manager's own
+ * timers run on, so on the host the stub's virtual clock drives both (see
+ * test_loadGenerator).
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_LOADGENERATOR_H_
+#define OVR_LOADGENERATOR_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <cxa_eui48.h>
+#include <cxa_logger_header.h>
+#include <cxa_timeDiff.h>
+
+#include <ovr_beaconManager.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_LOADGENERATOR_MAXNUM_BEACONS
+	#define OVR_LOADGENERATOR_MAXNUM_BEACONS		64
+#endif
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_loadGenerator ovr_loadGenerator_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t seed;
+	uint16_t numBeacons;
+	uint32_t duration_ms;
+
+	uint16_t advertInterval_min_ms;
+	uint16_t advertInterval_max_ms;
+	uint8_t rssiWalkStep_dBm;
+
+	uint32_t meanDwell_ms;				///< 0 disables join/leave churn
+	uint32_t meanAbsence_ms;
+
+	uint16_t accelEventRate_perMille;	///< chance per advert of a new accel event
+	uint16_t noiseRate_perSec;			///< unparseable adverts per second
+}ovr_loadGenerator_scenario_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t duration_ms;
+
+	uint32_t numAdverts;
+	uint32_t numNoiseAdverts;
+	uint32_t numAccepted;
+	uint32_t numJoins;
+	uint32_t numLeaves;
+
+	uint32_t numFound;
+	uint32_t numLost;
+
+	ovr_beaconManager_pipelineStats_t pipeline;
+	ovr_beaconManager_rpcInterface_publishStats_t publish;
+}ovr_loadGenerator_report_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	cxa_eui48_t uuid;
+	bool isPresent;
+
+	uint32_t nextAdvert_ms;
+	uint32_t nextChurn_ms;
+	uint16_t advertInterval_ms;
+
+	int8_t rssi_dBm;
+	uint8_t accelStatus;
+}ovr_loadGenerator_beacon_t;
+
+
+/**
+ * @private
+ */
+struct ovr_loadGenerator
+{
+	ovr_beaconManager_t* bm;
+
+	bool isRunning;
+	ovr_loadGenerator_scenario_t scenario;
+	uint32_t rngState;
+
+	cxa_timeDiff_t td_run;
+	uint32_t scenarioTime_ms;
+	uint32_t numNoiseDue;
+
+	ovr_loadGenerator_beacon_t beacons[OVR_LOADGENERATOR_MAXNUM_BEACONS];
+
+	ovr_beaconManager_pipelineStats_t startPipelineStats;
+	ovr_beaconManager_rpcInterface_publishStats_t startPublishStats;
+	ovr_loadGenerator_report_t report;
+
+	cxa_logger_t logger;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * @param threadIdIn runLoop thread on which the beacon manager ingests adverts
+ */
+void ovr_loadGenerator_init(ovr_loadGenerator_t *const lgIn, ovr_beaconManager_t *const bmIn, int threadIdIn);
+
+
+/**
+ * @public
+ */
+void ovr_loadGenerator_getDefaultScenario(ovr_loadGenerator_scenario_t *const scenarioOut);
+
+
+/**
+ * @public
+ */
+bool ovr_loadGenerator_start(ovr_loadGenerator_t *const lgIn, ovr_loadGenerator_scenario_t *const scenarioIn);
+
+
+/**
+ * @public
+ */
+void ovr_loadGenerator_stop(ovr_loadGenerator_t *const lgIn);
+
+
+/**
+ * @public
+ */
+bool ovr_loadGenerator_isRunning(ovr_loadGenerator_t *const lgIn);
+
+
+/**
+ * @public
+ * @return report for the current (or most recently completed) run
+ */
+ovr_loadGenerator_report_t ovr_loadGenerator_getReport(ovr_loadGenerator_t *const lgIn);
+
+
+/**
+ * @public
+ * Writes the report as a single line of JSON
+ */
+void ovr_loadGenerator_writeReport(ovr_loadGenerator_t *const lgIn, cxa_ioStream_t *const ioStreamIn);
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * @file
+ * Streams log lines over MQTT. Sits between the logger and its original
+ * global ioStream: every line is still echoed locally and is also held in
+ * a small RAM ring, which is published under a 'diagnostics' rpc node at
+ * a rate-limited cadence.
+ *
+ * When the ring fills (or the uplink is failing) the least important lines
+ * are discarded first so warnings and errors survive congestion.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_LOGSTREAM_H_
+#define OVR_LOGSTREAM_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <cxa_ioStream.h>
+#include <cxa_mqtt_rpc_node.h>
+#include <cxa_timeDiff.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_LOGSTREAM_NUM_SLOTS
+	#define OVR_LOGSTREAM_NUM_SLOTS					32
+#endif
+
+#ifndef OVR_LOGSTREAM_LINE_MAXSIZE_BYTES
+	#define OVR_LOGSTREAM_LINE_MAXSIZE_BYTES		120
+#endif
+
+#ifndef OVR_LOGSTREAM_PUBLISH_PERIOD_MS
+	#define OVR_LOGSTREAM_PUBLISH_PERIOD_MS			2000
+#endif
+
+#ifndef OVR_LOGSTREAM_MAXBYTES_PER_PERIOD
+	#define OVR_LOGSTREAM_MAXBYTES_PER_PERIOD		480
+#endif
+
+#ifndef OVR_LOGSTREAM_MAXNUM_BACKOFF_PERIODS
+	#define OVR_LOGSTREAM_MAXNUM_BACKOFF_PERIODS	16
+#endif
+
+#define OVR_LOGSTREAM_MODULEFILTER_MAXLEN			24
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_logStream ovr_logStream_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	bool isUsed;
+	uint8_t level;
+	uint8_t len;
+	uint32_t sequence;
+	char text[OVR_LOGSTREAM_LINE_MAXSIZE_BYTES];
+}ovr_logStream_slot_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint32_t numLinesQueued;
+	uint32_t numLinesFiltered;
+	uint32_t numLinesDropped;
+	uint32_t numLinesPublished;
+	uint32_t numPublishFailures;
+}ovr_logStream_stats_t;
+
+
+/**
+ * @private
+ */
+struct ovr_logStream
+{
+	cxa_ioStream_t ioStream;
+	cxa_ioStream_t* ioStream_downstream;
+
+	cxa_mqtt_rpc_node_t rpcNode;
+
+	// runtime filters
+	bool isEnabled;
+	uint8_t minLevel;
+	char moduleFilter[OVR_LOGSTREAM_MODULEFILTER_MAXLEN+1];
+
+	// line currently being assembled
+	char lineBuffer[OVR_LOGSTREAM_LINE_MAXSIZE_BYTES];
+	size_t lineBuffer_len;
+
+	ovr_logStream_slot_t slots[OVR_LOGSTREAM_NUM_SLOTS];
+	uint32_t nextSequence;
+
+	cxa_timeDiff_t td_publish;
+	uint8_t numBackoffPeriods;
+	uint8_t numPeriodsToSkip;
+
+	ovr_logStream_stats_t stats;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Interposes on the logger's current global ioStream
+ * @param rootNodeIn node under which the 'diagnostics' node is created
+ */
+void ovr_logStream_init(ovr_logStream_t *const lsIn, cxa_mqtt_rpc_node_t *const rootNodeIn, int threadIdIn);
+
+
+/**
+ * @public
+ * @param moduleFilterIn only lines from this logger name are streamed (NULL or "" for all)
+ */
+void ovr_logStream_setFilter(ovr_logStream_t *const lsIn, bool isEnabledIn, uint8_t minLevelIn, const char *const moduleFilterIn);
+
+
+/**
+ * @public
+ */
+ovr_logStream_stats_t ovr_logStream_getStats(ovr_logStream_t *const lsIn);
+
+#endif
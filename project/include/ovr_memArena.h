@@ -0,0 +1,132 @@
+/**
+ * @file
+ * A single block of memory claimed from the heap at boot and carved into
+ * long-lived allocations. Once sealed, nothing more may be carved so the
+ * footprint is fixed for the life of the firmware.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_MEMARENA_H_
+#define OVR_MEMARENA_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#define OVR_MEMARENA_ALIGNMENT_BYTES				8
+#define OVR_MEMARENA_ALIGN(sizeIn)					(((sizeIn) + (OVR_MEMARENA_ALIGNMENT_BYTES - 1)) & ~(size_t)(OVR_MEMARENA_ALIGNMENT_BYTES - 1))
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_memArena ovr_memArena_t;
+
+
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_MEMARENA_REGION_INTERNAL,
+	OVR_MEMARENA_REGION_PSRAM				///< falls back to internal RAM if there is no PSRAM
+}ovr_memArena_region_t;
+
+
+/**
+ * @private
+ */
+struct ovr_memArena
+{
+	uint8_t* buffer;
+	size_t size_bytes;
+	size_t used_bytes;
+
+	ovr_memArena_region_t region;
+	bool isSealed;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Claims the arena's memory from the heap
+ * @param size_bytesIn should be the sum of OVR_MEMARENA_ALIGN(x) for every allocation
+ * @return false if the memory isn't available
+ */
+bool ovr_memArena_init(ovr_memArena_t *const arenaIn, size_t size_bytesIn, ovr_memArena_region_t preferredRegionIn);
+
+
+/**
+ * @public
+ * Returns the arena's memory to the heap. Anything carved from it is invalid.
+ * Only meant for unwinding a failed init (or for scratch arenas).
+ */
+void ovr_memArena_deinit(ovr_memArena_t *const arenaIn);
+
+
+/**
+ * @public
+ * Carves a zeroed, aligned allocation from the arena
+ * @return NULL if the arena is exhausted
+ */
+void* ovr_memArena_alloc(ovr_memArena_t *const arenaIn, size_t size_bytesIn);
+
+
+/**
+ * @public
+ * Prevents any further allocations
+ */
+void ovr_memArena_seal(ovr_memArena_t *const arenaIn);
+
+
+/**
+ * @public
+ */
+size_t ovr_memArena_getSize_bytes(ovr_memArena_t *const arenaIn);
+
+
+/**
+ * @public
+ */
+size_t ovr_memArena_getUsed_bytes(ovr_memArena_t *const arenaIn);
+
+
+/**
+ * @public
+ * @return where the memory actually came from
+ */
+ovr_memArena_region_t ovr_memArena_getRegion(ovr_memArena_t *const arenaIn);
+
+
+/**
+ * @public
+ * @return the number of free bytes in the given region (0 for PSRAM if there is none)
+ */
+size_t ovr_memArena_getFreeHeap_bytes(ovr_memArena_region_t regionIn);
+
+
+/**
+ * @public
+ * @return the largest single arena that could currently be claimed from the region
+ */
+size_t ovr_memArena_getLargestFreeBlock_bytes(ovr_memArena_region_t regionIn);
+
+#endif
@@ -0,0 +1,208 @@
+/**
+ * @file
+ * Outbound notification scheduler. Every module hands its notifications
+ * here instead of publishing them the moment they fire; they are queued by
+ * priority class and released on the network thread through a token bucket
+ * so bursts (eg. a bus full of tagged assets pulling in) don't overrun the
+ * socket or the broker's per-client limits.
+ *
+ * Telemetry given a coalesce key replaces any still-queued notification
+ * with the same node, name and key rather than queueing behind it. When the
+ * queue is full, the newest entry of a lower priority class is displaced.
+ *
+ * Every notification has to fit in a single mqtt message
+ * (CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES, which includes the topic) so
+ * anything larger is refused up front and stays with its producer.
+ *
+ * Classes can optionally be delivered at-least-once: they are published at
+ * QoS1 and stay queued until the mqtt keepalive confirms the broker has
+ * read them (the client doesn't report PUBACKs, see ovr_ackWindow).
+ * Unconfirmed notifications are resent when their ack times out and
+ * whenever the mqtt connection comes back, with at most the window size
+ * outstanding at once.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_PUBLISHSCHEDULER_H_
+#define OVR_PUBLISHSCHEDULER_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cxa_eui48.h>
+#include <cxa_mqtt_rpc_node.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES
+	#define OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES			32
+#endif
+
+// fixed header (2-byte remaining length) + topic length + packet id
+#define OVR_PUBLISHSCHEDULER_MESSAGE_OVERHEAD_BYTES		7
+
+// before the topic is taken into account (see ovr_publishScheduler_getMaxPayloadSize_bytes)
+#define OVR_PUBLISHSCHEDULER_MAXSIZE_PAYLOAD_BYTES		(CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES - OVR_PUBLISHSCHEDULER_MESSAGE_OVERHEAD_BYTES)
+
+#ifndef OVR_PUBLISHSCHEDULER_RATE_BYTESPERSEC
+	#define OVR_PUBLISHSCHEDULER_RATE_BYTESPERSEC		4096
+#endif
+
+#ifndef OVR_PUBLISHSCHEDULER_BURST_BYTES
+	#define OVR_PUBLISHSCHEDULER_BURST_BYTES			2048
+#endif
+
+#ifndef OVR_PUBLISHSCHEDULER_ACKWINDOW_SIZE
+	#define OVR_PUBLISHSCHEDULER_ACKWINDOW_SIZE			8
+#endif
+
+// confirming a notification can take two keepalive periods plus a round trip (sized for a 60s keepalive)
+#ifndef OVR_PUBLISHSCHEDULER_ACKTIMEOUT_MS
+	#define OVR_PUBLISHSCHEDULER_ACKTIMEOUT_MS			150000
+#endif
+
+#define OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE			0
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ * In order of priority
+ */
+typedef enum
+{
+	OVR_PUBLISHSCHEDULER_CLASS_ALERT = 0,
+	OVR_PUBLISHSCHEDULER_CLASS_PRESENCE = 1,
+	OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY = 2,
+	OVR_PUBLISHSCHEDULER_CLASS_DIAGNOSTICS = 3,
+	OVR_PUBLISHSCHEDULER_NUM_CLASSES
+}ovr_publishScheduler_class_t;
+
+
+/**
+ * @public
+ */
+typedef struct
+{
+	uint16_t depth;						///< includes those awaiting an ack
+	uint32_t numEnqueued;
+	uint32_t numPublished;
+	uint32_t numCoalesced;
+	uint32_t numDropped;				///< refused or displaced while queued
+	uint32_t numFailed;					///< gave up after repeated publish failures
+	uint32_t delay_total_ms;			///< time spent queued, over every published notification
+	uint32_t delay_max_ms;
+}ovr_publishScheduler_classStats_t;
+
+
+/**
+ * @public
+ * Called once a notification has left the queue
+ * @param wasPublishedIn true if it was published (and confirmed, for acked classes),
+ *		false if it was displaced or given up on
+ */
+typedef void (*ovr_publishScheduler_cb_onDone_t)(bool wasPublishedIn, void* userVarIn);
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * @param rootNodeIn node under which the 'publisher' node is created
+ * @param threadIdIn runLoop thread on which the mqtt client runs
+ */
+void ovr_publishScheduler_init(cxa_mqtt_rpc_node_t *const rootNodeIn, int threadIdIn);
+
+
+/**
+ * @public
+ * Queues a QoS0 notification. Safe to call from any thread. Publishes
+ * immediately if the scheduler was never initialized.
+ *
+ * @param nameIn must outlive the notification (use a literal)
+ * @param coalesceKeyIn OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE if this notification
+ *		must not replace or be replaced by another. A replaced notification is
+ *		discarded, so anything carrying one-shot state (counts, windows,
+ *		latched events) must not be coalesced.
+ * @return false if the notification was refused (including when it's larger
+ *		than ovr_publishScheduler_getMaxPayloadSize_bytes)
+ */
+bool ovr_publishScheduler_publish(cxa_mqtt_rpc_node_t *const nodeIn, const char *const nameIn,
+								  ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn,
+								  void *const payloadIn, size_t payloadSize_bytesIn);
+
+
+/**
+ * @public
+ * As ovr_publishScheduler_publish, but cbIn is called (on whichever thread
+ * releases the notification, from outside any critical section) once the
+ * notification is done with. Not called if the notification is refused.
+ * A notification with a callback is never replaced by a coalescing one.
+ */
+bool ovr_publishScheduler_publish_withCallback(cxa_mqtt_rpc_node_t *const nodeIn, const char *const nameIn,
+											   ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn,
+											   void *const payloadIn, size_t payloadSize_bytesIn,
+											   ovr_publishScheduler_cb_onDone_t cbIn, void* userVarIn);
+
+
+/**
+ * @public
+ * @return the largest payload that fits in one mqtt message alongside the
+ *		topic the notification will be published on
+ */
+size_t ovr_publishScheduler_getMaxPayloadSize_bytes(cxa_mqtt_rpc_node_t *const nodeIn, const char *const nameIn);
+
+
+/**
+ * @public
+ * @return a coalesce key unique to the given beacon
+ */
+uint64_t ovr_publishScheduler_getCoalesceKey(cxa_eui48_t *const eui48In);
+
+
+/**
+ * @public
+ * @param rate_bytesPerSecIn 0 disables shaping
+ */
+void ovr_publishScheduler_setShaping(uint32_t rate_bytesPerSecIn, uint32_t burst_bytesIn);
+
+
+/**
+ * @public
+ * Settings are saved to nvs
+ * @param ackedClassMaskIn bit per ovr_publishScheduler_class_t to deliver at-least-once (0 for none)
+ * @param ackTimeout_msIn should comfortably exceed two mqtt keepalive periods,
+ *		since that's how long confirming a notification can take
+ * @return false if any parameter is out of range
+ */
+bool ovr_publishScheduler_setDelivery(uint8_t ackedClassMaskIn, size_t windowSizeIn, uint32_t ackTimeout_msIn);
+
+
+/**
+ * @public
+ */
+ovr_publishScheduler_classStats_t ovr_publishScheduler_getClassStats(ovr_publishScheduler_class_t classIn);
+
+
+/**
+ * @public
+ * @param maxDepthOut deepest the queue has been since the last call
+ * @param maxDelay_msOut longest any notification waited since the last call
+ */
+void ovr_publishScheduler_takeHighWater(uint16_t *const maxDepthOut, uint32_t *const maxDelay_msOut);
+
+#endif
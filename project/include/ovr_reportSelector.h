@@ -0,0 +1,160 @@
+/**
+ * @file
+ * Chooses which beacons get a periodic report when the uplink can't carry
+ * all of them. Each cycle the byte budget is turned into a number of report
+ * slots (using a running average of report size). Most slots go to the
+ * highest-scoring beacons (a bounded min-heap over the table), the rest
+ * rotate round-robin through everyone else so every beacon is eventually
+ * reported.
+ *
+ * Usage per cycle: ovr_reportSelector_beginCycle, ovr_reportSelector_offer
+ * for every beacon, then ovr_reportSelector_endCycle for the report order.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef OVR_REPORTSELECTOR_H_
+#define OVR_REPORTSELECTOR_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#ifndef OVR_REPORTSELECTOR_MAXNUM_SLOTS
+	#define OVR_REPORTSELECTOR_MAXNUM_SLOTS				128
+#endif
+
+#ifndef OVR_REPORTSELECTOR_INITIAL_REPORTSIZE_BYTES
+	#define OVR_REPORTSELECTOR_INITIAL_REPORTSIZE_BYTES	512
+#endif
+
+#define OVR_REPORTSELECTOR_DEFAULT_RRSHARE_PCNT			25
+
+
+// ******** global type definitions *********
+/**
+ * @public
+ */
+typedef struct ovr_reportSelector ovr_reportSelector_t;
+
+
+/**
+ * @public
+ */
+typedef enum
+{
+	OVR_REPORTSELECTOR_POLICY_ROUNDROBIN = 0,		///< no priority, every slot rotates
+	OVR_REPORTSELECTOR_POLICY_CLOSEST = 1,			///< score is rssi
+	OVR_REPORTSELECTOR_POLICY_MOSTCHANGED = 2		///< score is how much the beacon's readings moved this window
+}ovr_reportSelector_policy_t;
+
+
+/**
+ * @private
+ */
+typedef struct
+{
+	int32_t score;
+	uint16_t index;
+}ovr_reportSelector_candidate_t;
+
+
+/**
+ * @private
+ */
+struct ovr_reportSelector
+{
+	ovr_reportSelector_policy_t policy;
+	uint32_t budget_bytes;
+	uint8_t rrShare_pcnt;
+
+	uint32_t reportSize_avg_bytes;
+	size_t rrCursor;
+
+	// current cycle
+	size_t numBeacons;
+	size_t numTopKSlots;
+	size_t numRrSlots;
+
+	// min-heap on score (root is the weakest of the current top-K)
+	ovr_reportSelector_candidate_t heap[OVR_REPORTSELECTOR_MAXNUM_SLOTS];
+	size_t heapSize;
+};
+
+
+// ******** global function prototypes ********
+/**
+ * @public
+ * Starts unlimited (budget of 0)
+ */
+void ovr_reportSelector_init(ovr_reportSelector_t *const rsIn);
+
+
+/**
+ * @public
+ * @param budget_bytesIn bytes per cycle (0 for unlimited)
+ * @param rrShare_pcntIn share of slots reserved for round-robin (ignored for POLICY_ROUNDROBIN)
+ * @return false if any parameter is out of range
+ */
+bool ovr_reportSelector_setPolicy(ovr_reportSelector_t *const rsIn, ovr_reportSelector_policy_t policyIn, uint32_t budget_bytesIn, uint8_t rrShare_pcntIn);
+
+
+/**
+ * @public
+ */
+ovr_reportSelector_policy_t ovr_reportSelector_getPolicy(ovr_reportSelector_t *const rsIn);
+uint32_t ovr_reportSelector_getBudget_bytes(ovr_reportSelector_t *const rsIn);
+uint8_t ovr_reportSelector_getRrShare_pcnt(ovr_reportSelector_t *const rsIn);
+
+
+/**
+ * @public
+ * @return true if every beacon should simply be reported in table order
+ */
+bool ovr_reportSelector_isUnlimited(ovr_reportSelector_t *const rsIn);
+
+
+/**
+ * @public
+ */
+void ovr_reportSelector_beginCycle(ovr_reportSelector_t *const rsIn, size_t numBeaconsIn);
+
+
+/**
+ * @public
+ * @param indexIn the beacon's index in the table (must be < numBeaconsIn)
+ */
+void ovr_reportSelector_offer(ovr_reportSelector_t *const rsIn, uint16_t indexIn, int32_t scoreIn);
+
+
+/**
+ * @public
+ * @param indicesOut table indices in the order they should be reported
+ *		(best scores first, then the round-robin share)
+ * @return the number of indices written
+ */
+size_t ovr_reportSelector_endCycle(ovr_reportSelector_t *const rsIn, uint16_t *const indicesOut, size_t maxNumIndicesIn);
+
+
+/**
+ * @public
+ * Feeds the size of an actual report back into the slot estimate
+ */
+void ovr_reportSelector_recordReportSize(ovr_reportSelector_t *const rsIn, size_t size_bytesIn);
+
+#endif
@@ -31,14 +31,11 @@
 #include <cxa_esp32_timeBase.h>
 #include <cxa_esp32_usart.h>
 #include <cxa_ioStream_bridge.h>
-#include <cxa_led_gpio.h>
 #include <cxa_lightSensor_ltr329.h>
 #include <cxa_mqtt_connectionManager.h>
 #include <cxa_mqtt_rpc_node_root.h>
 #include <cxa_network_wifiManager.h>
 #include <cxa_nvsManager.h>
-#include <cxa_rgbLed.h>
-#include <cxa_rgbLed_triLed.h>
 #include <cxa_runLoop.h>
 #include <cxa_sntpClient.h>
 #include <cxa_tempSensor_si7050.h>
@@ -48,6 +45,9 @@
 #include <ota_logging.h>
 
 #include <ovr_beaconGateway.h>
+#include <ovr_binLog.h>
+#include <ovr_ledcRgbLed.h>
+#include <ovr_linkManager.h>
 
 #define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
 #include <cxa_logger_implementation.h>
@@ -88,26 +88,12 @@ static void otaUpdate_log(void *userVarIn, int otaLogLevelIn, const char *const
 
 
 static void eth_gpio_config_rmii(void);
-static void eth_task(void *pvParameter);
 
 
 
 // ******** local variable declarations ********
-static cxa_esp32_gpio_t gpio_led_btleAct_r;
-static cxa_esp32_gpio_t gpio_led_btleAct_g;
-static cxa_esp32_gpio_t gpio_led_btleAct_b;
-static cxa_led_gpio_t led_btleAct_r;
-static cxa_led_gpio_t led_btleAct_g;
-static cxa_led_gpio_t led_btleAct_b;
-static cxa_rgbLed_triLed_t led_btleAct;
-
-static cxa_esp32_gpio_t gpio_led_netAct_r;
-static cxa_esp32_gpio_t gpio_led_netAct_g;
-static cxa_esp32_gpio_t gpio_led_netAct_b;
-static cxa_led_gpio_t led_netAct_r;
-static cxa_led_gpio_t led_netAct_g;
-static cxa_led_gpio_t led_netAct_b;
-static cxa_rgbLed_triLed_t led_netAct;
+static ovr_ledcRgbLed_t led_btleAct;
+static ovr_ledcRgbLed_t led_netAct;
 
 static cxa_esp32_gpio_t gpio_btleReset;
 static cxa_esp32_gpio_t gpio_swProvision;
@@ -152,6 +138,7 @@ static void sysInit()
 	// setup our console and logger
 	cxa_console_init("ovrBeacon Gateway", cxa_usart_getIoStream(&usart_debug.super), OVR_GW_THREADID_UI);
 	cxa_logger_setGlobalIoStream(cxa_usart_getIoStream(&usart_debug.super));
+	ovr_binLog_init(OVR_GW_THREADID_UI);
 
 	// setup our networking
 	cxa_network_wifiManager_init(OVR_GW_THREADID_NETWORK);
@@ -161,21 +148,8 @@ static void sysInit()
 //	cxa_mqtt_rpc_node_root_init(&rpcNode_root, cxa_mqtt_connManager_getMqttClient(), true, cxa_uniqueId_getHexString());
 //
 //	// setup our application-specific peripherals
-//	cxa_esp32_gpio_init_output(&gpio_led_btleAct_r, GPIO_NUM_32, CXA_GPIO_POLARITY_INVERTED, 0);
-//	cxa_esp32_gpio_init_output(&gpio_led_btleAct_g, GPIO_NUM_23, CXA_GPIO_POLARITY_INVERTED, 0);
-//	cxa_esp32_gpio_init_output(&gpio_led_btleAct_b, GPIO_NUM_22, CXA_GPIO_POLARITY_INVERTED, 0);
-//	cxa_led_gpio_init(&led_btleAct_r, &gpio_led_btleAct_r.super, true);
-//	cxa_led_gpio_init(&led_btleAct_g, &gpio_led_btleAct_g.super, true);
-//	cxa_led_gpio_init(&led_btleAct_b, &gpio_led_btleAct_b.super, true);
-//	cxa_rgbLed_triLed_init(&led_btleAct, &led_btleAct_r.super, &led_btleAct_g.super, &led_btleAct_b.super, OVR_GW_THREADID_UI);
-//
-//	cxa_esp32_gpio_init_output(&gpio_led_netAct_r, GPIO_NUM_26, CXA_GPIO_POLARITY_INVERTED, 0);
-//	cxa_esp32_gpio_init_output(&gpio_led_netAct_g, GPIO_NUM_33, CXA_GPIO_POLARITY_INVERTED, 0);
-//	cxa_esp32_gpio_init_output(&gpio_led_netAct_b, GPIO_NUM_25, CXA_GPIO_POLARITY_INVERTED, 0);
-//	cxa_led_gpio_init(&led_netAct_r, &gpio_led_netAct_r.super, true);
-//	cxa_led_gpio_init(&led_netAct_g, &gpio_led_netAct_g.super, true);
-//	cxa_led_gpio_init(&led_netAct_b, &gpio_led_netAct_b.super, true);
-//	cxa_rgbLed_triLed_init(&led_netAct, &led_netAct_r.super, &led_netAct_g.super, &led_netAct_b.super, OVR_GW_THREADID_UI);
+//	ovr_ledcRgbLed_init(&led_btleAct, GPIO_NUM_32, GPIO_NUM_23, GPIO_NUM_22, true, LEDC_CHANNEL_0, OVR_GW_THREADID_UI);
+//	ovr_ledcRgbLed_init(&led_netAct, GPIO_NUM_26, GPIO_NUM_33, GPIO_NUM_25, true, LEDC_CHANNEL_3, OVR_GW_THREADID_UI);
 //
 //	cxa_esp32_gpio_init_input(&gpio_swProvision, GPIO_NUM_27, CXA_GPIO_POLARITY_INVERTED);
 //	cxa_esp32_gpio_init_output(&gpio_btleReset, GPIO_NUM_4, CXA_GPIO_POLARITY_INVERTED, 0);
@@ -193,7 +167,7 @@ static void sysInit()
 //	cxa_tempSensor_si7050_init(&tempSensor, cxa_blueGiga_btle_client_getI2cMaster(&btleClient));
 //	ovr_beaconGateway_init(&beaconGateway, &btleClient.super, &gpio_swProvision.super,
 //						   &gpio_variant_internalHighPower.super, &gpio_variant_external.super,
-//						   &led_btleAct.super, &led_netAct.super,
+//						   &led_btleAct, &led_netAct,
 //						   &lightSensor.super, &tempSensor.super, &rpcNode_root.super);
 //
 //	// initialize our otaUpdate client
@@ -211,6 +185,9 @@ static void sysInit()
 	tcpip_adapter_init();
 	esp_event_loop_init(NULL, NULL);
 
+	// must see the interfaces' first events
+	ovr_linkManager_init(OVR_GW_THREADID_NETWORK);
+
 	eth_config_t config = DEFAULT_ETHERNET_PHY_CONFIG;
 	config.phy_addr = CONFIG_PHY_ADDRESS;
 	config.gpio_config = eth_gpio_config_rmii;
@@ -221,7 +198,6 @@ static void sysInit()
 	if(ret == ESP_OK)
 	{
 		esp_eth_enable();
-		xTaskCreate(eth_task, "eth_task", 2048, NULL, (tskIDLE_PRIORITY + 2), NULL);
 	}
 }
 
@@ -310,32 +286,3 @@ static void eth_gpio_config_rmii(void)
     // MDC is GPIO 23, MDIO is GPIO 18
     phy_rmii_smi_configure_pins(PIN_SMI_MDC, PIN_SMI_MDIO);
 }
-
-
-static void eth_task(void *pvParameter)
-{
-    tcpip_adapter_ip_info_t ip;
-    memset(&ip, 0, sizeof(tcpip_adapter_ip_info_t));
-    vTaskDelay(2000 / portTICK_PERIOD_MS);
-
-//    tcpip_adapter_dhcps_stop(ESP_IF_ETH);
-//
-//    tcpip_adapter_ip_info_t ip_info;
-//    IP4_ADDR(&ip_info.ip, 192, 168, 1, 67);
-//    IP4_ADDR(&ip_info.gw, 192, 168, 1, 1);
-//    IP4_ADDR(&ip_info.netmask, 255, 255, 255, 0);
-//    tcpip_adapter_set_ip_info(ESP_IF_ETH, &ip_info);
-
-    while (1)
-    {
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
-
-        if (tcpip_adapter_get_ip_info(ESP_IF_ETH, &ip) == 0) {
-        		cxa_logger_debug(cxa_logger_getSysLog(), "~~~~~~~~~~~");
-        		cxa_logger_debug(cxa_logger_getSysLog(), "ETHIP:"IPSTR, IP2STR(&ip.ip));
-        		cxa_logger_debug(cxa_logger_getSysLog(), "ETHPMASK:"IPSTR, IP2STR(&ip.netmask));
-        		cxa_logger_debug(cxa_logger_getSysLog(), "ETHPGW:"IPSTR, IP2STR(&ip.gw));
-        		cxa_logger_debug(cxa_logger_getSysLog(), "~~~~~~~~~~~");
-        }
-    }
-}
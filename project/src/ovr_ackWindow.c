@@ -0,0 +1,212 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_ackWindow.h"
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_assert.h>
+
+
+// ******** local macro definitions ********
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void ovr_ackWindow_init(ovr_ackWindow_t *const awIn, size_t sizeIn, uint32_t ackTimeout_msIn)
+{
+	cxa_assert(awIn);
+
+	memset(awIn->slots, 0, sizeof(awIn->slots));
+	awIn->numInFlight = 0;
+	awIn->numPingResps = 0;
+	memset(&awIn->stats, 0, sizeof(awIn->stats));
+
+	bool isConfigured = ovr_ackWindow_configure(awIn, sizeIn, ackTimeout_msIn);
+	cxa_assert(isConfigured);
+}
+
+
+bool ovr_ackWindow_configure(ovr_ackWindow_t *const awIn, size_t sizeIn, uint32_t ackTimeout_msIn)
+{
+	cxa_assert(awIn);
+
+	if( (sizeIn == 0) || (sizeIn > OVR_ACKWINDOW_MAXSIZE) || (ackTimeout_msIn == 0) ) return false;
+
+	awIn->size = sizeIn;
+	awIn->ackTimeout_ms = ackTimeout_msIn;
+	return true;
+}
+
+
+size_t ovr_ackWindow_getSize(ovr_ackWindow_t *const awIn)
+{
+	cxa_assert(awIn);
+	return awIn->size;
+}
+
+
+uint32_t ovr_ackWindow_getAckTimeout_ms(ovr_ackWindow_t *const awIn)
+{
+	cxa_assert(awIn);
+	return awIn->ackTimeout_ms;
+}
+
+
+size_t ovr_ackWindow_getNumInFlight(ovr_ackWindow_t *const awIn)
+{
+	cxa_assert(awIn);
+	return awIn->numInFlight;
+}
+
+
+ovr_ackWindow_stats_t ovr_ackWindow_getStats(ovr_ackWindow_t *const awIn)
+{
+	cxa_assert(awIn);
+	return awIn->stats;
+}
+
+
+bool ovr_ackWindow_hasRoom(ovr_ackWindow_t *const awIn)
+{
+	cxa_assert(awIn);
+	return (awIn->numInFlight < awIn->size);
+}
+
+
+bool ovr_ackWindow_open(ovr_ackWindow_t *const awIn, void* userVarIn, uint32_t now_msIn)
+{
+	cxa_assert(awIn);
+
+	if( !ovr_ackWindow_hasRoom(awIn) ) return false;
+
+	ovr_ackWindow_slot_t* targetSlot = NULL;
+	for( size_t i = 0; i < OVR_ACKWINDOW_MAXSIZE; i++ )
+	{
+		if( !awIn->slots[i].isUsed )
+		{
+			targetSlot = &awIn->slots[i];
+			break;
+		}
+	}
+	cxa_assert(targetSlot);
+
+	targetSlot->isUsed = true;
+	targetSlot->isResendNeeded = false;
+	targetSlot->numSends = 1;
+	targetSlot->lastSendPingResp = awIn->numPingResps;
+	targetSlot->firstSendTime_ms = now_msIn;
+	targetSlot->lastSendTime_ms = now_msIn;
+	targetSlot->userVar = userVarIn;
+
+	awIn->numInFlight++;
+	awIn->stats.numOpened++;
+	return true;
+}
+
+
+void ovr_ackWindow_onPingResp(ovr_ackWindow_t *const awIn)
+{
+	cxa_assert(awIn);
+
+	awIn->numPingResps++;
+}
+
+
+void* ovr_ackWindow_getNextAcked(ovr_ackWindow_t *const awIn, uint32_t now_msIn)
+{
+	cxa_assert(awIn);
+
+	for( size_t i = 0; i < OVR_ACKWINDOW_MAXSIZE; i++ )
+	{
+		ovr_ackWindow_slot_t* currSlot = &awIn->slots[i];
+
+		// anything waiting to be resent may never have reached the broker
+		if( !currSlot->isUsed || currSlot->isResendNeeded ) continue;
+		if( (awIn->numPingResps - currSlot->lastSendPingResp) < OVR_ACKWINDOW_NUM_CONFIRMING_PINGRESPS ) continue;
+
+		uint32_t ackTime_ms = now_msIn - currSlot->firstSendTime_ms;
+		if( ackTime_ms > awIn->stats.ackTime_max_ms ) awIn->stats.ackTime_max_ms = ackTime_ms;
+
+		currSlot->isUsed = false;
+		awIn->numInFlight--;
+		awIn->stats.numAcked++;
+		return currSlot->userVar;
+	}
+
+	return NULL;
+}
+
+
+void* ovr_ackWindow_getNextResend(ovr_ackWindow_t *const awIn, uint32_t now_msIn, void** expiredUserVarOut)
+{
+	cxa_assert(awIn);
+	cxa_assert(expiredUserVarOut);
+
+	*expiredUserVarOut = NULL;
+
+	// oldest first so one slow ack doesn't hold up the rest
+	ovr_ackWindow_slot_t* targetSlot = NULL;
+	for( size_t i = 0; i < OVR_ACKWINDOW_MAXSIZE; i++ )
+	{
+		ovr_ackWindow_slot_t* currSlot = &awIn->slots[i];
+		if( !currSlot->isUsed ) continue;
+		if( !currSlot->isResendNeeded && ((now_msIn - currSlot->lastSendTime_ms) < awIn->ackTimeout_ms) ) continue;
+
+		if( (targetSlot == NULL) || ((int32_t)(currSlot->firstSendTime_ms - targetSlot->firstSendTime_ms) < 0) ) targetSlot = currSlot;
+	}
+	if( targetSlot == NULL ) return NULL;
+
+	if( targetSlot->numSends >= OVR_ACKWINDOW_MAXNUM_SENDS )
+	{
+		targetSlot->isUsed = false;
+		awIn->numInFlight--;
+		awIn->stats.numExpired++;
+		*expiredUserVarOut = targetSlot->userVar;
+		return NULL;
+	}
+
+	targetSlot->isResendNeeded = false;
+	targetSlot->numSends++;
+	targetSlot->lastSendPingResp = awIn->numPingResps;
+	targetSlot->lastSendTime_ms = now_msIn;
+	awIn->stats.numResends++;
+
+	return targetSlot->userVar;
+}
+
+
+void ovr_ackWindow_markAllForResend(ovr_ackWindow_t *const awIn)
+{
+	cxa_assert(awIn);
+
+	for( size_t i = 0; i < OVR_ACKWINDOW_MAXSIZE; i++ )
+	{
+		if( awIn->slots[i].isUsed ) awIn->slots[i].isResendNeeded = true;
+	}
+}
+
+
+// ******** local function implementations ********
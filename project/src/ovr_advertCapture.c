@@ -0,0 +1,425 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_advertCapture.h"
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_console.h>
+#include <cxa_fixedByteBuffer.h>
+#include <cxa_runLoop.h>
+
+#define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
+#include <cxa_logger_implementation.h>
+
+
+// ******** local macro definitions ********
+#define CAPTURE_FORMAT_VERSION				1
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	uint32_t rxTime_ms;
+	int8_t rssi_dBm;
+	uint8_t numBytes;
+	uint8_t data[OVR_ADVERTCAPTURE_MAXDATA_SIZE_BYTES];
+}record_t;
+
+
+// ******** local function prototypes ********
+static void copyFromRing(ovr_advertCapture_t *const capIn, size_t offsetIn, uint8_t *const bufOut, size_t numBytesIn);
+static void copyToRing(ovr_advertCapture_t *const capIn, size_t offsetIn, uint8_t *const bufIn, size_t numBytesIn);
+static uint8_t peekByte(ovr_advertCapture_t *const capIn, size_t offsetIn);
+static size_t readRecord(ovr_advertCapture_t *const capIn, size_t offsetIn, record_t *const recordOut);
+static void dropOldestRecord(ovr_advertCapture_t *const capIn);
+static void finishReplay(ovr_advertCapture_t *const capIn);
+
+static void cb_onRunLoopUpdate(void* userVarIn);
+static void bmCb_onAdvert(int8_t rssi_dBmIn, uint8_t *const dataIn, size_t dataSize_bytesIn, void* userVarIn);
+
+static void consoleCb_start(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn);
+static void consoleCb_stop(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn);
+static void consoleCb_dump(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void ovr_advertCapture_init(ovr_advertCapture_t *const capIn, ovr_beaconManager_t *const bmIn, int threadIdIn)
+{
+	cxa_assert(capIn);
+	cxa_assert(bmIn);
+
+	capIn->bm = bmIn;
+	capIn->isCapturing = false;
+	capIn->isReplaying = false;
+	capIn->readIndex = 0;
+	capIn->size_bytes = 0;
+	capIn->numRecords = 0;
+	capIn->numRecordsOverwritten = 0;
+	cxa_timeDiff_init(&capIn->td_capture);
+	cxa_timeDiff_init(&capIn->td_replay);
+	memset(&capIn->lastReport, 0, sizeof(capIn->lastReport));
+
+	cxa_logger_init(&capIn->logger, "advertCapture");
+
+	// captures are only touched a record at a time so they're happy in PSRAM
+	// (the small buffer falls back to internal RAM if there's no PSRAM)
+	capIn->bufferSize_bytes = OVR_ADVERTCAPTURE_BUFFERSIZE_BYTES;
+	if( ovr_memArena_getLargestFreeBlock_bytes(OVR_MEMARENA_REGION_PSRAM) >= OVR_ADVERTCAPTURE_BUFFERSIZE_PSRAM_BYTES )
+	{
+		capIn->bufferSize_bytes = OVR_ADVERTCAPTURE_BUFFERSIZE_PSRAM_BYTES;
+	}
+	cxa_assert(ovr_memArena_init(&capIn->memArena, capIn->bufferSize_bytes, OVR_MEMARENA_REGION_PSRAM));
+	capIn->buffer = ovr_memArena_alloc(&capIn->memArena, capIn->bufferSize_bytes);
+	cxa_assert(capIn->buffer);
+	ovr_memArena_seal(&capIn->memArena);
+
+	ovr_beaconManager_setAdvertListener(capIn->bm, bmCb_onAdvert, (void*)capIn);
+
+	cxa_console_addCommand("cap_start", "starts a new advert capture", NULL, 0, consoleCb_start, (void*)capIn);
+	cxa_console_addCommand("cap_stop", "stops the advert capture", NULL, 0, consoleCb_stop, (void*)capIn);
+	cxa_console_addCommand("cap_dump", "dumps captured adverts", NULL, 0, consoleCb_dump, (void*)capIn);
+
+	// must run on the same thread as the manager's ingest
+	cxa_runLoop_addEntry(threadIdIn, cb_onRunLoopUpdate, (void*)capIn);
+}
+
+
+void ovr_advertCapture_start(ovr_advertCapture_t *const capIn)
+{
+	cxa_assert(capIn);
+
+	if( capIn->isReplaying ) return;
+
+	capIn->readIndex = 0;
+	capIn->size_bytes = 0;
+	capIn->numRecords = 0;
+	capIn->numRecordsOverwritten = 0;
+	cxa_timeDiff_setStartTime_now(&capIn->td_capture);
+	capIn->isCapturing = true;
+
+	cxa_logger_info(&capIn->logger, "capture started");
+}
+
+
+void ovr_advertCapture_stop(ovr_advertCapture_t *const capIn)
+{
+	cxa_assert(capIn);
+
+	if( !capIn->isCapturing ) return;
+
+	capIn->isCapturing = false;
+	cxa_logger_info(&capIn->logger, "capture stopped  records: %d  overwritten: %d", (int)capIn->numRecords, (int)capIn->numRecordsOverwritten);
+}
+
+
+bool ovr_advertCapture_addRecord(ovr_advertCapture_t *const capIn, uint32_t rxTime_msIn, int8_t rssi_dBmIn, uint8_t *const dataIn, size_t dataSize_bytesIn)
+{
+	cxa_assert(capIn);
+	cxa_assert(dataIn || (dataSize_bytesIn == 0));
+
+	if( capIn->isReplaying || (dataSize_bytesIn > OVR_ADVERTCAPTURE_MAXDATA_SIZE_BYTES) ) return false;
+
+	// make room by overwriting the oldest records
+	size_t recordSize_bytes = OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES + dataSize_bytesIn;
+	while( (capIn->bufferSize_bytes - capIn->size_bytes) < recordSize_bytes ) dropOldestRecord(capIn);
+
+	uint8_t header[OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES] = {
+			(uint8_t)(rxTime_msIn >> 0), (uint8_t)(rxTime_msIn >> 8),
+			(uint8_t)(rxTime_msIn >> 16), (uint8_t)(rxTime_msIn >> 24),
+			(uint8_t)rssi_dBmIn, (uint8_t)dataSize_bytesIn
+	};
+
+	copyToRing(capIn, capIn->size_bytes, header, sizeof(header));
+	copyToRing(capIn, capIn->size_bytes + sizeof(header), dataIn, dataSize_bytesIn);
+	capIn->size_bytes += recordSize_bytes;
+	capIn->numRecords++;
+
+	return true;
+}
+
+
+uint32_t ovr_advertCapture_getNumRecords(ovr_advertCapture_t *const capIn)
+{
+	cxa_assert(capIn);
+
+	return capIn->numRecords;
+}
+
+
+void ovr_advertCapture_dump(ovr_advertCapture_t *const capIn, cxa_ioStream_t *const ioStreamIn)
+{
+	cxa_assert(capIn);
+	cxa_assert(ioStreamIn);
+
+	char line[2 * (OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES + OVR_ADVERTCAPTURE_MAXDATA_SIZE_BYTES) + 1];
+
+	snprintf(line, sizeof(line), "ovrCapture v%d %d", CAPTURE_FORMAT_VERSION, (int)capIn->numRecords);
+	cxa_ioStream_writeLine(ioStreamIn, line);
+
+	// each record is dumped exactly as stored
+	size_t offset = 0;
+	for( uint32_t i = 0; i < capIn->numRecords; i++ )
+	{
+		uint8_t record[OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES + OVR_ADVERTCAPTURE_MAXDATA_SIZE_BYTES];
+		size_t recordSize_bytes = OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES + peekByte(capIn, offset + 5);
+		copyFromRing(capIn, offset, record, recordSize_bytes);
+		for( size_t j = 0; j < recordSize_bytes; j++ )
+		{
+			snprintf(&line[2*j], 3, "%02X", record[j]);
+		}
+		cxa_ioStream_writeLine(ioStreamIn, line);
+		offset += recordSize_bytes;
+	}
+}
+
+
+bool ovr_advertCapture_startReplay(ovr_advertCapture_t *const capIn, uint16_t speedIn)
+{
+	cxa_assert(capIn);
+
+	if( capIn->isReplaying || (capIn->numRecords == 0) ) return false;
+
+	ovr_advertCapture_stop(capIn);
+
+	record_t firstRecord;
+	readRecord(capIn, 0, &firstRecord);
+
+	capIn->replaySpeed = speedIn;
+	capIn->replayOffset = 0;
+	capIn->replayRecordIndex = 0;
+	capIn->replayFirstRxTime_ms = firstRecord.rxTime_ms;
+	capIn->replayStartStats = ovr_beaconManager_getPipelineStats(capIn->bm);
+	memset(&capIn->lastReport, 0, sizeof(capIn->lastReport));
+	capIn->lastReport.numRecords = capIn->numRecords;
+	cxa_timeDiff_setStartTime_now(&capIn->td_replay);
+	capIn->isReplaying = true;
+
+	cxa_logger_info(&capIn->logger, "replay started  records: %d  speed: %dx", (int)capIn->numRecords, speedIn);
+	return true;
+}
+
+
+bool ovr_advertCapture_isReplaying(ovr_advertCapture_t *const capIn)
+{
+	cxa_assert(capIn);
+
+	return capIn->isReplaying;
+}
+
+
+ovr_advertCapture_replayReport_t ovr_advertCapture_getLastReplayReport(ovr_advertCapture_t *const capIn)
+{
+	cxa_assert(capIn);
+
+	return capIn->lastReport;
+}
+
+
+ovr_memArena_t* ovr_advertCapture_getMemArena(ovr_advertCapture_t *const capIn)
+{
+	cxa_assert(capIn);
+
+	return &capIn->memArena;
+}
+
+
+// ******** local function implementations ********
+static void copyFromRing(ovr_advertCapture_t *const capIn, size_t offsetIn, uint8_t *const bufOut, size_t numBytesIn)
+{
+	cxa_assert(capIn);
+	cxa_assert(bufOut);
+
+	// at most two contiguous copies (cheaper than byte-wise access when the buffer is in PSRAM)
+	size_t startIndex = (capIn->readIndex + offsetIn) % capIn->bufferSize_bytes;
+	size_t numFirst_bytes = capIn->bufferSize_bytes - startIndex;
+	if( numFirst_bytes > numBytesIn ) numFirst_bytes = numBytesIn;
+
+	memcpy(bufOut, &capIn->buffer[startIndex], numFirst_bytes);
+	memcpy(&bufOut[numFirst_bytes], capIn->buffer, numBytesIn - numFirst_bytes);
+}
+
+
+static void copyToRing(ovr_advertCapture_t *const capIn, size_t offsetIn, uint8_t *const bufIn, size_t numBytesIn)
+{
+	cxa_assert(capIn);
+	cxa_assert(bufIn);
+
+	size_t startIndex = (capIn->readIndex + offsetIn) % capIn->bufferSize_bytes;
+	size_t numFirst_bytes = capIn->bufferSize_bytes - startIndex;
+	if( numFirst_bytes > numBytesIn ) numFirst_bytes = numBytesIn;
+
+	memcpy(&capIn->buffer[startIndex], bufIn, numFirst_bytes);
+	memcpy(capIn->buffer, &bufIn[numFirst_bytes], numBytesIn - numFirst_bytes);
+}
+
+
+static uint8_t peekByte(ovr_advertCapture_t *const capIn, size_t offsetIn)
+{
+	cxa_assert(capIn);
+
+	return capIn->buffer[(capIn->readIndex + offsetIn) % capIn->bufferSize_bytes];
+}
+
+
+static size_t readRecord(ovr_advertCapture_t *const capIn, size_t offsetIn, record_t *const recordOut)
+{
+	cxa_assert(capIn);
+	cxa_assert(recordOut);
+
+	uint8_t header[OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES];
+	copyFromRing(capIn, offsetIn, header, sizeof(header));
+
+	recordOut->rxTime_ms = ((uint32_t)header[0] << 0) |
+						   ((uint32_t)header[1] << 8) |
+						   ((uint32_t)header[2] << 16) |
+						   ((uint32_t)header[3] << 24);
+	recordOut->rssi_dBm = (int8_t)header[4];
+	recordOut->numBytes = header[5];
+	copyFromRing(capIn, offsetIn + OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES, recordOut->data, recordOut->numBytes);
+
+	return OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES + recordOut->numBytes;
+}
+
+
+static void dropOldestRecord(ovr_advertCapture_t *const capIn)
+{
+	cxa_assert(capIn);
+
+	if( capIn->numRecords == 0 ) return;
+
+	size_t recordSize_bytes = OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES + peekByte(capIn, 5);
+	capIn->readIndex = (capIn->readIndex + recordSize_bytes) % capIn->bufferSize_bytes;
+	capIn->size_bytes -= recordSize_bytes;
+	capIn->numRecords--;
+	capIn->numRecordsOverwritten++;
+}
+
+
+static void finishReplay(ovr_advertCapture_t *const capIn)
+{
+	cxa_assert(capIn);
+
+	capIn->isReplaying = false;
+
+	// all manager counters are wrapping, so differences are still valid
+	ovr_beaconManager_pipelineStats_t endStats = ovr_beaconManager_getPipelineStats(capIn->bm);
+	ovr_advertCapture_replayReport_t* report = &capIn->lastReport;
+	report->duration_ms = cxa_timeDiff_getElapsedTime_ms(&capIn->td_replay);
+	report->pipeline.numAdvertsRx = endStats.numAdvertsRx - capIn->replayStartStats.numAdvertsRx;
+	report->pipeline.numAdvertsAccepted = endStats.numAdvertsAccepted - capIn->replayStartStats.numAdvertsAccepted;
+	report->pipeline.numAdvertsFiltered = endStats.numAdvertsFiltered - capIn->replayStartStats.numAdvertsFiltered;
+	report->pipeline.numAdvertsDropped = endStats.numAdvertsDropped - capIn->replayStartStats.numAdvertsDropped;
+	report->pipeline.numUpdatesProcessed = endStats.numUpdatesProcessed - capIn->replayStartStats.numUpdatesProcessed;
+	report->pipeline.queueLatency_total_us = endStats.queueLatency_total_us - capIn->replayStartStats.queueLatency_total_us;
+	report->pipeline.processTime_total_us = endStats.processTime_total_us - capIn->replayStartStats.processTime_total_us;
+	// maximums can't be windowed...report the all-time values
+	report->pipeline.queueLatency_max_us = endStats.queueLatency_max_us;
+	report->pipeline.processTime_max_us = endStats.processTime_max_us;
+
+	cxa_logger_info(&capIn->logger, "replay done  injected: %d  rejected: %d  dropped: %d  processed: %d  %d ms",
+					(int)report->numInjected, (int)report->numRejected,
+					(int)report->pipeline.numAdvertsDropped, (int)report->pipeline.numUpdatesProcessed,
+					(int)report->duration_ms);
+}
+
+
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	ovr_advertCapture_t* capIn = (ovr_advertCapture_t*)userVarIn;
+	cxa_assert(capIn);
+
+	if( !capIn->isReplaying ) return;
+
+	// at max speed, offer half a fifo per iteration so the manager gets a
+	// chance to drain between batches (each pass only drains up to the end
+	// of its ring, so up to a batch may still be queued when the next arrives)
+	uint32_t elapsedCaptureTime_ms = UINT32_MAX;
+	size_t maxNumToInject = ovr_beaconManager_getCapacities(capIn->bm).rxFifoSize_elems / 2;
+	if( maxNumToInject == 0 ) maxNumToInject = 1;
+	if( capIn->replaySpeed != OVR_ADVERTCAPTURE_SPEED_MAX )
+	{
+		elapsedCaptureTime_ms = cxa_timeDiff_getElapsedTime_ms(&capIn->td_replay) * capIn->replaySpeed;
+		maxNumToInject = SIZE_MAX;
+	}
+
+	for( size_t i = 0; (i < maxNumToInject) && (capIn->replayRecordIndex < capIn->numRecords); i++ )
+	{
+		record_t currRecord;
+		size_t recordSize_bytes = readRecord(capIn, capIn->replayOffset, &currRecord);
+		if( (currRecord.rxTime_ms - capIn->replayFirstRxTime_ms) > elapsedCaptureTime_ms ) break;
+
+		cxa_fixedByteBuffer_t fbb_manBytes;
+		cxa_fixedByteBuffer_init_inPlace(&fbb_manBytes, currRecord.numBytes, currRecord.data, sizeof(currRecord.data));
+		if( ovr_beaconManager_injectAdvert(capIn->bm, currRecord.rssi_dBm, &fbb_manBytes) )
+		{
+			capIn->lastReport.numInjected++;
+		}
+		else
+		{
+			capIn->lastReport.numRejected++;
+		}
+
+		capIn->replayOffset += recordSize_bytes;
+		capIn->replayRecordIndex++;
+	}
+
+	if( capIn->replayRecordIndex >= capIn->numRecords ) finishReplay(capIn);
+}
+
+
+static void bmCb_onAdvert(int8_t rssi_dBmIn, uint8_t *const dataIn, size_t dataSize_bytesIn, void* userVarIn)
+{
+	ovr_advertCapture_t* capIn = (ovr_advertCapture_t*)userVarIn;
+	cxa_assert(capIn);
+
+	if( !capIn->isCapturing || (dataIn == NULL) ) return;
+
+	ovr_advertCapture_addRecord(capIn, cxa_timeDiff_getElapsedTime_ms(&capIn->td_capture), rssi_dBmIn, dataIn, dataSize_bytesIn);
+}
+
+
+static void consoleCb_start(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn)
+{
+	ovr_advertCapture_t* capIn = (ovr_advertCapture_t*)userVarIn;
+	cxa_assert(capIn);
+
+	ovr_advertCapture_start(capIn);
+}
+
+
+static void consoleCb_stop(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn)
+{
+	ovr_advertCapture_t* capIn = (ovr_advertCapture_t*)userVarIn;
+	cxa_assert(capIn);
+
+	ovr_advertCapture_stop(capIn);
+}
+
+
+static void consoleCb_dump(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn)
+{
+	ovr_advertCapture_t* capIn = (ovr_advertCapture_t*)userVarIn;
+	cxa_assert(capIn);
+
+	ovr_advertCapture_dump(capIn, ioStreamIn);
+}
@@ -0,0 +1,304 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_ambientSampler.h"
+
+
+// ******** includes ********
+#include <math.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_runLoop.h>
+#include <cxa_timeBase.h>
+
+#include <ovr_config.h>
+
+#define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
+#include <cxa_logger_implementation.h>
+
+
+// ******** local macro definitions ********
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void cb_onRunLoopUpdate(void* userVarIn);
+
+static void startSlot(ovr_ambientSampler_t *const asIn);
+static void readLight(ovr_ambientSampler_t *const asIn);
+static void finishSlot(ovr_ambientSampler_t *const asIn);
+static void finishReading(ovr_ambientSampler_t *const asIn);
+static bool isPastDeadband(ovr_ambientSampler_deadband_t *const dbIn, float valueIn, float deadbandIn);
+static float getMedian(float *const samplesIn, size_t numSamplesIn);
+
+static void tempCb_onUpdated(cxa_tempSensor_t *const tmpSnsIn, bool wasSuccessfulIn, bool valueDidChangeIn, float newTemp_degCIn, void* userVarIn);
+static void lightCb_onUpdated(cxa_lightSensor_t *const lightSnsIn, bool wasSuccessfulIn, bool valueDidChangeIn, uint8_t newLight_255In, void* userVarIn);
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void ovr_ambientSampler_init(ovr_ambientSampler_t *const asIn, cxa_btle_client_t *const btleClientIn,
+							 cxa_tempSensor_t *const tempSensorIn, cxa_lightSensor_t *const lightSensorIn,
+							 ovr_ambientSampler_cb_onTempChanged_t cb_onTempChangedIn,
+							 ovr_ambientSampler_cb_onLightChanged_t cb_onLightChangedIn,
+							 void* userVarIn, int threadIdIn)
+{
+	cxa_assert(asIn);
+	cxa_assert(btleClientIn);
+
+	// save our references
+	asIn->btleClient = btleClientIn;
+	asIn->tempSensor = tempSensorIn;
+	asIn->lightSensor = lightSensorIn;
+	asIn->cb_onTempChanged = cb_onTempChangedIn;
+	asIn->cb_onLightChanged = cb_onLightChangedIn;
+	asIn->userVar = userVarIn;
+
+	// setup our internal state
+	cxa_timeDiff_init(&asIn->td_slot);
+	asIn->isSlotInProgress = false;
+	asIn->busTime_total_us = 0;
+	asIn->numSlots = 0;
+	asIn->numTempSamples = 0;
+	asIn->numLightSamples = 0;
+	asIn->lastTemp_degC = NAN;
+	asIn->lastLight_255 = 0;
+	memset(&asIn->tempDeadband, 0, sizeof(asIn->tempDeadband));
+	memset(&asIn->lightDeadband, 0, sizeof(asIn->lightDeadband));
+	memset(&asIn->stats, 0, sizeof(asIn->stats));
+
+	cxa_logger_init(&asIn->logger, "ambientSampler");
+
+	cxa_runLoop_addEntry(threadIdIn, cb_onRunLoopUpdate, (void*)asIn);
+}
+
+
+float ovr_ambientSampler_getLastTemp_degC(ovr_ambientSampler_t *const asIn)
+{
+	cxa_assert(asIn);
+
+	return asIn->lastTemp_degC;
+}
+
+
+uint8_t ovr_ambientSampler_getLastLight_255(ovr_ambientSampler_t *const asIn)
+{
+	cxa_assert(asIn);
+
+	return asIn->lastLight_255;
+}
+
+
+ovr_ambientSampler_stats_t ovr_ambientSampler_getStats(ovr_ambientSampler_t *const asIn)
+{
+	cxa_assert(asIn);
+
+	// updated on the btle thread
+	ovr_ambientSampler_stats_t retVal;
+	retVal.numSamples = __atomic_load_n(&asIn->stats.numSamples, __ATOMIC_RELAXED);
+	retVal.numFailures = __atomic_load_n(&asIn->stats.numFailures, __ATOMIC_RELAXED);
+	retVal.numReadings = __atomic_load_n(&asIn->stats.numReadings, __ATOMIC_RELAXED);
+	retVal.numNotifications = __atomic_load_n(&asIn->stats.numNotifications, __ATOMIC_RELAXED);
+	retVal.busTime_total_ms = __atomic_load_n(&asIn->stats.busTime_total_ms, __ATOMIC_RELAXED);
+	retVal.busTime_max_us = __atomic_load_n(&asIn->stats.busTime_max_us, __ATOMIC_RELAXED);
+	return retVal;
+}
+
+
+// ******** local function implementations ********
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	ovr_ambientSampler_t* asIn = (ovr_ambientSampler_t*)userVarIn;
+	cxa_assert(asIn);
+
+	if( (asIn->tempSensor == NULL) && (asIn->lightSensor == NULL) ) return;
+	if( asIn->isSlotInProgress || !cxa_btle_client_isReady(asIn->btleClient) ) return;
+
+	// spread the samples over the period instead of holding the bus for all of them at once
+	uint32_t slotPeriod_ms = ovr_config_get(OVR_CONFIG_ID_SENSORREAD_PERIOD_MS) / OVR_AMBIENTSAMPLER_NUMSAMPLES;
+	if( cxa_timeDiff_isElapsed_recurring_ms(&asIn->td_slot, slotPeriod_ms) ) startSlot(asIn);
+}
+
+
+static void startSlot(ovr_ambientSampler_t *const asIn)
+{
+	cxa_assert(asIn);
+
+	asIn->isSlotInProgress = true;
+	asIn->slotStartTime_us = cxa_timeBase_getCount_us();
+
+	if( asIn->tempSensor == NULL )
+	{
+		readLight(asIn);
+		return;
+	}
+
+	if( !cxa_tempSensor_getValue_withCallback(asIn->tempSensor, tempCb_onUpdated, (void*)asIn) )
+	{
+		__atomic_fetch_add(&asIn->stats.numFailures, 1, __ATOMIC_RELAXED);
+		readLight(asIn);
+	}
+}
+
+
+static void readLight(ovr_ambientSampler_t *const asIn)
+{
+	cxa_assert(asIn);
+
+	if( asIn->lightSensor == NULL )
+	{
+		finishSlot(asIn);
+		return;
+	}
+
+	// queued straight behind the temp read so both go out in one burst
+	if( !cxa_lightSensor_getValue_withCallback(asIn->lightSensor, lightCb_onUpdated, (void*)asIn) )
+	{
+		__atomic_fetch_add(&asIn->stats.numFailures, 1, __ATOMIC_RELAXED);
+		finishSlot(asIn);
+	}
+}
+
+
+static void finishSlot(ovr_ambientSampler_t *const asIn)
+{
+	cxa_assert(asIn);
+
+	uint32_t busTime_us = cxa_timeBase_getCount_us() - asIn->slotStartTime_us;
+	asIn->busTime_total_us += busTime_us;
+	__atomic_store_n(&asIn->stats.busTime_total_ms, (uint32_t)(asIn->busTime_total_us / 1000), __ATOMIC_RELAXED);
+	if( busTime_us > asIn->stats.busTime_max_us ) __atomic_store_n(&asIn->stats.busTime_max_us, busTime_us, __ATOMIC_RELAXED);
+
+	asIn->isSlotInProgress = false;
+	if( ++asIn->numSlots >= OVR_AMBIENTSAMPLER_NUMSAMPLES ) finishReading(asIn);
+}
+
+
+static void finishReading(ovr_ambientSampler_t *const asIn)
+{
+	cxa_assert(asIn);
+
+	asIn->numSlots = 0;
+	__atomic_fetch_add(&asIn->stats.numReadings, 1, __ATOMIC_RELAXED);
+
+	if( asIn->tempSensor != NULL )
+	{
+		if( asIn->numTempSamples > 0 )
+		{
+			asIn->lastTemp_degC = getMedian(asIn->tempSamples, asIn->numTempSamples);
+			if( isPastDeadband(&asIn->tempDeadband, asIn->lastTemp_degC, OVR_AMBIENTSAMPLER_TEMP_DEADBAND_C) && (asIn->cb_onTempChanged != NULL) )
+			{
+				__atomic_fetch_add(&asIn->stats.numNotifications, 1, __ATOMIC_RELAXED);
+				asIn->cb_onTempChanged(asIn->lastTemp_degC, asIn->userVar);
+			}
+		}
+		else cxa_logger_warn(&asIn->logger, "failed to read gwTemp");
+	}
+
+	if( asIn->lightSensor != NULL )
+	{
+		if( asIn->numLightSamples > 0 )
+		{
+			asIn->lastLight_255 = (uint8_t)lroundf(getMedian(asIn->lightSamples, asIn->numLightSamples));
+			if( isPastDeadband(&asIn->lightDeadband, asIn->lastLight_255, OVR_AMBIENTSAMPLER_LIGHT_DEADBAND_255) && (asIn->cb_onLightChanged != NULL) )
+			{
+				__atomic_fetch_add(&asIn->stats.numNotifications, 1, __ATOMIC_RELAXED);
+				asIn->cb_onLightChanged(asIn->lastLight_255, asIn->userVar);
+			}
+		}
+		else cxa_logger_warn(&asIn->logger, "failed to read gwLux");
+	}
+
+	asIn->numTempSamples = 0;
+	asIn->numLightSamples = 0;
+}
+
+
+static bool isPastDeadband(ovr_ambientSampler_deadband_t *const dbIn, float valueIn, float deadbandIn)
+{
+	cxa_assert(dbIn);
+
+	if( dbIn->hasReported &&
+		(fabsf(valueIn - dbIn->lastReported) < deadbandIn) &&
+		(++dbIn->numSilentReadings < OVR_AMBIENTSAMPLER_MAXNUM_SILENT_READINGS) ) return false;
+
+	dbIn->hasReported = true;
+	dbIn->lastReported = valueIn;
+	dbIn->numSilentReadings = 0;
+	return true;
+}
+
+
+static float getMedian(float *const samplesIn, size_t numSamplesIn)
+{
+	cxa_assert(samplesIn);
+	cxa_assert(numSamplesIn > 0);
+
+	// few enough that an insertion sort in place is fine
+	for( size_t i = 1; i < numSamplesIn; i++ )
+	{
+		float currSample = samplesIn[i];
+		size_t j = i;
+		for( ; (j > 0) && (samplesIn[j-1] > currSample); j-- ) samplesIn[j] = samplesIn[j-1];
+		samplesIn[j] = currSample;
+	}
+
+	// an even count (after a failed sample) takes the mean of the middle two
+	size_t mid = numSamplesIn / 2;
+	return (numSamplesIn & 0x01) ? samplesIn[mid] : ((samplesIn[mid-1] + samplesIn[mid]) / 2.0);
+}
+
+
+static void tempCb_onUpdated(cxa_tempSensor_t *const tmpSnsIn, bool wasSuccessfulIn, bool valueDidChangeIn, float newTemp_degCIn, void* userVarIn)
+{
+	ovr_ambientSampler_t* asIn = (ovr_ambientSampler_t*)userVarIn;
+	cxa_assert(asIn);
+
+	if( wasSuccessfulIn && (asIn->numTempSamples < OVR_AMBIENTSAMPLER_NUMSAMPLES) )
+	{
+		asIn->tempSamples[asIn->numTempSamples++] = newTemp_degCIn;
+		__atomic_fetch_add(&asIn->stats.numSamples, 1, __ATOMIC_RELAXED);
+	}
+	else if( !wasSuccessfulIn )
+	{
+		__atomic_fetch_add(&asIn->stats.numFailures, 1, __ATOMIC_RELAXED);
+	}
+
+	readLight(asIn);
+}
+
+
+static void lightCb_onUpdated(cxa_lightSensor_t *const lightSnsIn, bool wasSuccessfulIn, bool valueDidChangeIn, uint8_t newLight_255In, void* userVarIn)
+{
+	ovr_ambientSampler_t* asIn = (ovr_ambientSampler_t*)userVarIn;
+	cxa_assert(asIn);
+
+	if( wasSuccessfulIn && (asIn->numLightSamples < OVR_AMBIENTSAMPLER_NUMSAMPLES) )
+	{
+		asIn->lightSamples[asIn->numLightSamples++] = newLight_255In;
+		__atomic_fetch_add(&asIn->stats.numSamples, 1, __ATOMIC_RELAXED);
+	}
+	else if( !wasSuccessfulIn )
+	{
+		__atomic_fetch_add(&asIn->stats.numFailures, 1, __ATOMIC_RELAXED);
+	}
+
+	finishSlot(asIn);
+}
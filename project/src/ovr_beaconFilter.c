@@ -0,0 +1,325 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_beaconFilter.h"
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_criticalSection.h>
+#include <cxa_nvsManager.h>
+
+#define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
+#include <cxa_logger_implementation.h>
+
+
+// ******** local macro definitions ********
+#define NVS_KEY_MODE					"bf_mode"
+#define NVS_KEY_NUMKEYS					"bf_numKeys"
+#define NVS_KEY_KEYS_FMT				"bf_keys%d"
+#define NVS_KEY_MAXLEN					16
+
+#define EUI48_SIZE_BYTES				6
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void loadFromNvs(ovr_beaconFilter_t *const bfIn);
+static ovr_beaconFilter_table_t* getInactiveTable(ovr_beaconFilter_t *const bfIn);
+static bool table_reserve(ovr_beaconFilter_table_t *const tableIn, size_t numKeysIn);
+static void table_sortAndDedupe(ovr_beaconFilter_table_t *const tableIn);
+static bool table_contains(ovr_beaconFilter_table_t *const tableIn, uint32_t keyIn);
+static void swapTables(ovr_beaconFilter_t *const bfIn);
+static uint32_t hashEui48(const uint8_t *const bytesIn);
+static int compareKeys(const void* lhsIn, const void* rhsIn);
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void ovr_beaconFilter_init(ovr_beaconFilter_t *const bfIn)
+{
+	cxa_assert(bfIn);
+
+	// setup our internal state
+	for( size_t i = 0; i < (sizeof(bfIn->tables) / sizeof(*bfIn->tables)); i++ )
+	{
+		bfIn->tables[i].mode = OVR_BEACONFILTER_MODE_DISABLED;
+		bfIn->tables[i].numKeys = 0;
+		bfIn->tables[i].keys = NULL;
+	}
+	bfIn->activeTable = &bfIn->tables[0];
+
+	cxa_logger_init(&bfIn->logger, "beaconFilter");
+
+	loadFromNvs(bfIn);
+}
+
+
+ovr_beaconFilter_mode_t ovr_beaconFilter_getMode(ovr_beaconFilter_t *const bfIn)
+{
+	cxa_assert(bfIn);
+
+	return bfIn->activeTable->mode;
+}
+
+
+size_t ovr_beaconFilter_getNumEntries(ovr_beaconFilter_t *const bfIn)
+{
+	cxa_assert(bfIn);
+
+	return bfIn->activeTable->numKeys;
+}
+
+
+bool ovr_beaconFilter_setEntries(ovr_beaconFilter_t *const bfIn, ovr_beaconFilter_mode_t modeIn,
+								 uint8_t *const rawEntriesIn, size_t numEntriesIn, bool shouldAppendIn)
+{
+	cxa_assert(bfIn);
+	cxa_assert( (rawEntriesIn != NULL) || (numEntriesIn == 0) );
+
+	// the receive path keeps using the active table while we build its replacement
+	ovr_beaconFilter_table_t* currTable = bfIn->activeTable;
+	ovr_beaconFilter_table_t* newTable = getInactiveTable(bfIn);
+
+	size_t numPrevKeys = shouldAppendIn ? currTable->numKeys : 0;
+	if( (numPrevKeys + numEntriesIn) > OVR_BEACONFILTER_MAXNUM_ENTRIES )
+	{
+		cxa_logger_warn(&bfIn->logger, "too many entries (%d)", (int)(numPrevKeys + numEntriesIn));
+		return false;
+	}
+	if( !table_reserve(newTable, numPrevKeys + numEntriesIn) )
+	{
+		cxa_logger_warn(&bfIn->logger, "no memory for %d entries", (int)(numPrevKeys + numEntriesIn));
+		return false;
+	}
+
+	if( numPrevKeys > 0 ) memcpy(newTable->keys, currTable->keys, numPrevKeys * sizeof(*newTable->keys));
+	for( size_t i = 0; i < numEntriesIn; i++ )
+	{
+		newTable->keys[numPrevKeys + i] = hashEui48(&rawEntriesIn[i * EUI48_SIZE_BYTES]);
+	}
+	newTable->numKeys = numPrevKeys + numEntriesIn;
+	newTable->mode = modeIn;
+	table_sortAndDedupe(newTable);
+
+	swapTables(bfIn);
+
+	cxa_logger_info(&bfIn->logger, "mode: %d  numEntries: %d", newTable->mode, (int)newTable->numKeys);
+
+	return true;
+}
+
+
+bool ovr_beaconFilter_save(ovr_beaconFilter_t *const bfIn)
+{
+	cxa_assert(bfIn);
+
+	// only ever swapped on this (the caller's) thread so it can't change under us
+	ovr_beaconFilter_table_t* table = bfIn->activeTable;
+
+	if( !cxa_nvsManager_set_uint32(NVS_KEY_MODE, table->mode) ) return false;
+	if( !cxa_nvsManager_set_uint32(NVS_KEY_NUMKEYS, table->numKeys) ) return false;
+
+	for( size_t i = 0; i < table->numKeys; i += OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK )
+	{
+		size_t numChunkKeys = table->numKeys - i;
+		if( numChunkKeys > OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK ) numChunkKeys = OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK;
+
+		char key[NVS_KEY_MAXLEN];
+		snprintf(key, sizeof(key), NVS_KEY_KEYS_FMT, (int)(i / OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK));
+		key[sizeof(key)-1] = 0;
+
+		if( !cxa_nvsManager_set_blob(key, (uint8_t*)&table->keys[i], numChunkKeys * sizeof(*table->keys)) ) return false;
+	}
+
+	if( !cxa_nvsManager_commit() ) return false;
+
+	cxa_logger_info(&bfIn->logger, "saved %d entries", (int)table->numKeys);
+	return true;
+}
+
+
+bool ovr_beaconFilter_isAccepted(ovr_beaconFilter_t *const bfIn, cxa_eui48_t *const idIn)
+{
+	cxa_assert(bfIn);
+	cxa_assert(idIn);
+
+	uint32_t key = hashEui48(idIn->bytes);
+
+	// tables are only swapped inside a critical section so holding one for the
+	// (short) lookup means the table we picked can't be rebuilt underneath us
+	cxa_criticalSection_enter();
+	ovr_beaconFilter_table_t* table = bfIn->activeTable;
+	bool retVal = true;
+	if( table->mode != OVR_BEACONFILTER_MODE_DISABLED )
+	{
+		bool isListed = table_contains(table, key);
+		retVal = (table->mode == OVR_BEACONFILTER_MODE_ALLOW) ? isListed : !isListed;
+	}
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+// ******** local function implementations ********
+static void loadFromNvs(ovr_beaconFilter_t *const bfIn)
+{
+	cxa_assert(bfIn);
+
+	uint32_t mode_raw;
+	uint32_t numKeys_raw;
+	if( !cxa_nvsManager_get_uint32(NVS_KEY_MODE, &mode_raw) ||
+		!cxa_nvsManager_get_uint32(NVS_KEY_NUMKEYS, &numKeys_raw) ) return;
+	if( (mode_raw > OVR_BEACONFILTER_MODE_DENY) || (numKeys_raw > OVR_BEACONFILTER_MAXNUM_ENTRIES) ) return;
+
+	ovr_beaconFilter_table_t* newTable = getInactiveTable(bfIn);
+	if( !table_reserve(newTable, numKeys_raw) ) return;
+
+	for( size_t i = 0; i < numKeys_raw; i += OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK )
+	{
+		size_t numChunkKeys = numKeys_raw - i;
+		if( numChunkKeys > OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK ) numChunkKeys = OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK;
+
+		char key[NVS_KEY_MAXLEN];
+		snprintf(key, sizeof(key), NVS_KEY_KEYS_FMT, (int)(i / OVR_BEACONFILTER_NVS_ENTRIESPERCHUNK));
+		key[sizeof(key)-1] = 0;
+
+		size_t actualSize_bytes = 0;
+		if( !cxa_nvsManager_get_blob(key, (uint8_t*)&newTable->keys[i], numChunkKeys * sizeof(*newTable->keys), &actualSize_bytes) ||
+			(actualSize_bytes != (numChunkKeys * sizeof(*newTable->keys))) )
+		{
+			cxa_logger_warn(&bfIn->logger, "failed to load entries");
+			return;
+		}
+	}
+
+	newTable->mode = mode_raw;
+	newTable->numKeys = numKeys_raw;
+	table_sortAndDedupe(newTable);
+	swapTables(bfIn);
+
+	cxa_logger_info(&bfIn->logger, "loaded mode: %d  numEntries: %d", newTable->mode, (int)newTable->numKeys);
+}
+
+
+static ovr_beaconFilter_table_t* getInactiveTable(ovr_beaconFilter_t *const bfIn)
+{
+	cxa_assert(bfIn);
+
+	return (bfIn->activeTable == &bfIn->tables[0]) ? &bfIn->tables[1] : &bfIn->tables[0];
+}
+
+
+static bool table_reserve(ovr_beaconFilter_table_t *const tableIn, size_t numKeysIn)
+{
+	cxa_assert(tableIn);
+
+	// nobody is reading the inactive table so its storage can be replaced outright
+	if( tableIn->keys != NULL ) ovr_memArena_deinit(&tableIn->arena);
+	tableIn->keys = NULL;
+	tableIn->numKeys = 0;
+	if( numKeysIn == 0 ) return true;
+
+	size_t keys_size_bytes = numKeysIn * sizeof(*tableIn->keys);
+	if( !ovr_memArena_init(&tableIn->arena, OVR_MEMARENA_ALIGN(keys_size_bytes), OVR_BEACONFILTER_TABLE_REGION) ) return false;
+	tableIn->keys = ovr_memArena_alloc(&tableIn->arena, keys_size_bytes);
+	cxa_assert(tableIn->keys);
+	ovr_memArena_seal(&tableIn->arena);
+
+	return true;
+}
+
+
+static void table_sortAndDedupe(ovr_beaconFilter_table_t *const tableIn)
+{
+	cxa_assert(tableIn);
+
+	if( tableIn->numKeys < 2 ) return;
+
+	qsort(tableIn->keys, tableIn->numKeys, sizeof(*tableIn->keys), compareKeys);
+
+	size_t writeIndex = 1;
+	for( size_t readIndex = 1; readIndex < tableIn->numKeys; readIndex++ )
+	{
+		if( tableIn->keys[readIndex] == tableIn->keys[writeIndex-1] ) continue;
+		tableIn->keys[writeIndex++] = tableIn->keys[readIndex];
+	}
+	tableIn->numKeys = writeIndex;
+}
+
+
+static bool table_contains(ovr_beaconFilter_table_t *const tableIn, uint32_t keyIn)
+{
+	cxa_assert(tableIn);
+
+	size_t lo = 0, hi = tableIn->numKeys;
+	while( lo < hi )
+	{
+		size_t mid = (lo + hi) / 2;
+		uint32_t currKey = tableIn->keys[mid];
+		if( currKey == keyIn ) return true;
+		if( currKey < keyIn ) lo = mid + 1;
+		else hi = mid;
+	}
+	return false;
+}
+
+
+static void swapTables(ovr_beaconFilter_t *const bfIn)
+{
+	cxa_assert(bfIn);
+
+	cxa_criticalSection_enter();
+	bfIn->activeTable = getInactiveTable(bfIn);
+	cxa_criticalSection_exit();
+}
+
+
+static uint32_t hashEui48(const uint8_t *const bytesIn)
+{
+	// persisted...don't change without moving the NVS keys
+	// FNV-1a, then murmur3's finalizer so neighbouring ids spread out
+	uint32_t hash = 2166136261u;
+	for( size_t i = 0; i < EUI48_SIZE_BYTES; i++ )
+	{
+		hash ^= bytesIn[i];
+		hash *= 16777619u;
+	}
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35u;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+
+static int compareKeys(const void* lhsIn, const void* rhsIn)
+{
+	uint32_t lhs = *(const uint32_t*)lhsIn;
+	uint32_t rhs = *(const uint32_t*)rhsIn;
+
+	return (lhs < rhs) ? -1 : ((lhs > rhs) ? 1 : 0);
+}
@@ -17,7 +17,8 @@
 
 
 // ******** includes ********
-#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #include <cxa_assert.h>
 #include <cxa_console.h>
@@ -25,24 +26,27 @@
 #include <cxa_runLoop.h>
 #include <cxa_uniqueId.h>
 
+#include <ovr_config.h>
+#include <ovr_publishScheduler.h>
+
 #define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
 #include <cxa_logger_implementation.h>
 
 
 // ******** local macro definitions ********
-#define SENSOR_READ_PERIOD_MS		60000
+#define STACK_SAMPLE_PERIOD_MS		5000
 
 
 // ******** local type definitions ********
 
 
 // ******** local function prototypes ********
-static void cb_onRunLoopUpdate(void* userVarIn);
+static void cb_onRunLoopUpdate_sampleStack(void* userVarIn);
 
 static void consoleCb_getUuid(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn);
 
-static void tempCb_onUpdated(cxa_tempSensor_t *const tmpSnsIn, bool wasSuccessfulIn, bool valueDidChangeIn, float newTemp_degCIn, void* userVarIn);
-static void lightCb_onUpdated(cxa_lightSensor_t *const lightSnsIn, bool wasSuccessfulIn, bool valueDidChangeIn, uint8_t newLight_255In, void* userVarIn);
+static void ambientCb_onTempChanged(float newTemp_degCIn, void* userVarIn);
+static void ambientCb_onLightChanged(uint8_t newLight_255In, void* userVarIn);
 
 
 // ********  local variable declarations *********
@@ -54,8 +58,8 @@ void ovr_beaconGateway_init(ovr_beaconGateway_t *const bgIn,
 							cxa_gpio_t *const gpio_swProvisionIn,
 							cxa_gpio_t *const gpio_variant_internalHighPowerIn,
 							cxa_gpio_t *const gpio_variant_externalIn,
-							cxa_rgbLed_t *const led_btleActIn,
-							cxa_rgbLed_t *const led_netActIn,
+							ovr_ledcRgbLed_t *const led_btleActIn,
+							ovr_ledcRgbLed_t *const led_netActIn,
 							cxa_lightSensor_t *const lightSensorIn,
 							cxa_tempSensor_t *const tempSensorIn,
 							cxa_mqtt_rpc_node_t *const rootNodeIn)
@@ -68,9 +72,14 @@ void ovr_beaconGateway_init(ovr_beaconGateway_t *const bgIn,
 	bgIn->btleClient = btleClientIn;
 	cxa_logger_init(&bgIn->logger, "beaconGateway");
 
-	bgIn->lightSensor = lightSensorIn;
-	bgIn->tempSensor = tempSensorIn;
-	cxa_timeDiff_init(&bgIn->td_readSensors);
+	// runtime-tunable periods (read by most of what follows)
+	ovr_config_init(rootNodeIn);
+
+	// everything we publish is queued through here
+	if( rootNodeIn != NULL ) ovr_publishScheduler_init(rootNodeIn, OVR_GW_THREADID_NETWORK);
+
+	// remote log streaming (interposes on the logger so do this early)
+	if( rootNodeIn != NULL ) ovr_logStream_init(&bgIn->logStream, rootNodeIn, OVR_GW_THREADID_NETWORK);
 
 	// determine our variant (gpios should be inverted)
 	if( cxa_gpio_getValue(gpio_variant_internalHighPowerIn) && !cxa_gpio_getValue(gpio_variant_externalIn) )
@@ -93,19 +102,32 @@ void ovr_beaconGateway_init(ovr_beaconGateway_t *const bgIn,
 
 
 	// setup our beacon manager
-	ovr_beaconManager_init(&bgIn->beaconManager, btleClientIn, rootNodeIn);
+	ovr_beaconManager_init(&bgIn->beaconManager, btleClientIn, rootNodeIn, OVR_GW_THREADID_BLUETOOTH, OVR_GW_THREADID_NETWORK);
+	ovr_advertCapture_init(&bgIn->advertCapture, &bgIn->beaconManager, OVR_GW_THREADID_BLUETOOTH);
 
 	// setup our rpc interface
 	if( rootNodeIn != NULL ) ovr_beaconGateway_rpcInterface_init(&bgIn->bgri, bgIn, rootNodeIn);
 
+	// sample our on-board sensors (they share the btle client's uart)
+	ovr_ambientSampler_init(&bgIn->ambientSampler, btleClientIn, tempSensorIn, lightSensorIn,
+							ambientCb_onTempChanged, ambientCb_onLightChanged, (void*)bgIn, OVR_GW_THREADID_BLUETOOTH);
+
+	// setup our edge alerts
+	if( rootNodeIn != NULL ) ovr_beaconRules_init(&bgIn->rules, &bgIn->beaconManager, rootNodeIn, OVR_GW_THREADID_BLUETOOTH);
+
 	// setup our UI
 	ovr_beaconGateway_ui_init(&bgIn->bgui, btleClientIn, &bgIn->beaconManager, led_btleActIn, led_netActIn, gpio_swProvisionIn);
 
 	// register our console method
 	cxa_console_addCommand("gw_getUuid", "returns gateway's UUID", NULL, 0, consoleCb_getUuid, (void*)bgIn);
 
-	// schedule for repeated execution
-	cxa_runLoop_addEntry(OVR_GW_THREADID_BLUETOOTH, cb_onRunLoopUpdate, (void*)bgIn);
+	// stack usage can only be sampled from within each thread
+	for( int i = 0; i < OVR_GW_NUM_THREADS; i++ )
+	{
+		cxa_timeDiff_init(&bgIn->threadStats[i].td_sample);
+		bgIn->threadStats[i].stackHighWater_bytes = 0;
+		cxa_runLoop_addEntry(i+1, cb_onRunLoopUpdate_sampleStack, (void*)&bgIn->threadStats[i]);
+	}
 }
 
 
@@ -120,7 +142,7 @@ float ovr_beaconGateway_getLastTemp_degC(ovr_beaconGateway_t *const bgIn)
 {
 	cxa_assert(bgIn);
 
-	return (bgIn->tempSensor != NULL) ? cxa_tempSensor_getLastValue_degC(bgIn->tempSensor) : NAN;
+	return ovr_ambientSampler_getLastTemp_degC(&bgIn->ambientSampler);
 }
 
 
@@ -128,7 +150,15 @@ uint8_t ovr_beaconGateway_getLastLight_255(ovr_beaconGateway_t *const bgIn)
 {
 	cxa_assert(bgIn);
 
-	return (bgIn->lightSensor != NULL) ? cxa_lightSensor_getLastValue_255(bgIn->lightSensor) : 0;
+	return ovr_ambientSampler_getLastLight_255(&bgIn->ambientSampler);
+}
+
+
+ovr_ambientSampler_t* ovr_beaconGateway_getAmbientSampler(ovr_beaconGateway_t *const bgIn)
+{
+	cxa_assert(bgIn);
+
+	return &bgIn->ambientSampler;
 }
 
 
@@ -140,6 +170,23 @@ ovr_beaconGateway_variant_t ovr_beaconGateway_getVariant(ovr_beaconGateway_t *co
 }
 
 
+ovr_beaconManager_t* ovr_beaconGateway_getBeaconManager(ovr_beaconGateway_t *const bgIn)
+{
+	cxa_assert(bgIn);
+
+	return &bgIn->beaconManager;
+}
+
+
+uint32_t ovr_beaconGateway_getStackHighWater_bytes(ovr_beaconGateway_t *const bgIn, int threadIdIn)
+{
+	cxa_assert(bgIn);
+
+	if( (threadIdIn < 1) || (threadIdIn > OVR_GW_NUM_THREADS) ) return 0;
+	return __atomic_load_n(&bgIn->threadStats[threadIdIn-1].stackHighWater_bytes, __ATOMIC_RELAXED);
+}
+
+
 void ovr_beaconGateway_onAssert(ovr_beaconGateway_t *const bgIn)
 {
 	ovr_beaconGateway_ui_onAssert(&bgIn->bgui);
@@ -147,22 +194,15 @@ void ovr_beaconGateway_onAssert(ovr_beaconGateway_t *const bgIn)
 
 
 // ******** local function implementations ********
-static void cb_onRunLoopUpdate(void* userVarIn)
+static void cb_onRunLoopUpdate_sampleStack(void* userVarIn)
 {
-	ovr_beaconGateway_t* bgIn = (ovr_beaconGateway_t*)userVarIn;
-	cxa_assert(bgIn);
+	ovr_beaconGateway_threadStats_t* threadStatsIn = (ovr_beaconGateway_threadStats_t*)userVarIn;
+	cxa_assert(threadStatsIn);
 
-	// read one sensor at a time
-	if( cxa_btle_client_isReady(bgIn->btleClient) && cxa_timeDiff_isElapsed_recurring_ms(&bgIn->td_readSensors, SENSOR_READ_PERIOD_MS) )
+	// the watermark scan isn't free...don't do it every iteration
+	if( cxa_timeDiff_isElapsed_recurring_ms(&threadStatsIn->td_sample, STACK_SAMPLE_PERIOD_MS) )
 	{
-		if( bgIn->tempSensor != NULL )
-		{
-			cxa_tempSensor_getValue_withCallback(bgIn->tempSensor, tempCb_onUpdated, (void*)bgIn);
-		}
-		else if( bgIn->lightSensor != NULL )
-		{
-			cxa_lightSensor_getValue_withCallback(bgIn->lightSensor, lightCb_onUpdated, (void*)bgIn);
-		}
+		__atomic_store_n(&threadStatsIn->stackHighWater_bytes, (uint32_t)uxTaskGetStackHighWaterMark(NULL), __ATOMIC_RELAXED);
 	}
 }
 
@@ -176,38 +216,19 @@ static void consoleCb_getUuid(cxa_array_t *const argsIn, cxa_ioStream_t *const i
 }
 
 
-static void tempCb_onUpdated(cxa_tempSensor_t *const tmpSnsIn, bool wasSuccessfulIn, bool valueDidChangeIn, float newTemp_degCIn, void* userVarIn)
+static void ambientCb_onTempChanged(float newTemp_degCIn, void* userVarIn)
 {
 	ovr_beaconGateway_t* bgIn = (ovr_beaconGateway_t*)userVarIn;
 	cxa_assert(bgIn);
 
-	if( wasSuccessfulIn )
-	{
-		// always send data
-		ovr_beaconGateway_rpcInterface_notifyTempChanged(&bgIn->bgri, newTemp_degCIn);
-	}
-	else
-	{
-		cxa_logger_warn(&bgIn->logger, "failed to read gwTemp");
-	}
-
-	// now read our light sensor
-	cxa_lightSensor_getValue_withCallback(bgIn->lightSensor, lightCb_onUpdated, (void*)bgIn);
+	ovr_beaconGateway_rpcInterface_notifyTempChanged(&bgIn->bgri, newTemp_degCIn);
 }
 
 
-static void lightCb_onUpdated(cxa_lightSensor_t *const lightSnsIn, bool wasSuccessfulIn, bool valueDidChangeIn, uint8_t newLight_255In, void* userVarIn)
+static void ambientCb_onLightChanged(uint8_t newLight_255In, void* userVarIn)
 {
 	ovr_beaconGateway_t* bgIn = (ovr_beaconGateway_t*)userVarIn;
 	cxa_assert(bgIn);
 
-	if( wasSuccessfulIn )
-	{
-		// always send data
-		ovr_beaconGateway_rpcInterface_notifyLightChanged(&bgIn->bgri, newLight_255In);
-	}
-	else
-	{
-		cxa_logger_warn(&bgIn->logger, "failed to read gwLux");
-	}
+	ovr_beaconGateway_rpcInterface_notifyLightChanged(&bgIn->bgri, newLight_255In);
 }
@@ -18,6 +18,9 @@
 
 // ******** includes ********
 #include <math.h>
+#include <string.h>
+
+#include "esp_system.h"
 
 #include <cxa_assert.h>
 #include <cxa_runLoop.h>
@@ -26,6 +29,9 @@
 #include <cxa_uniqueId.h>
 
 #include <ovr_beaconGateway.h>
+#include <ovr_config.h>
+#include <ovr_linkManager.h>
+#include <ovr_publishScheduler.h>
 
 
 #define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
@@ -33,15 +39,32 @@
 
 
 // ******** local macro definitions ********
-#define UPDATE_MAX_PAYLOAD_BYTES				256
-#define CHECKIN_PERIOD_MS					60000
+// every notification has to fit in a single mqtt message (the scheduler
+// further trims this by the length of each topic)
+#define UPDATE_MAX_PAYLOAD_BYTES				OVR_PUBLISHSCHEDULER_MAXSIZE_PAYLOAD_BYTES
+
+_Static_assert((UPDATE_MAX_PAYLOAD_BYTES + OVR_PUBLISHSCHEDULER_MESSAGE_OVERHEAD_BYTES) <= CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES, "checkIn payloads must fit a single mqtt message");
+
+// temp and light each have their own node so one key serves both
+#define AMBIENT_COALESCEKEY					1
 
 
 // ******** local type definitions ********
+typedef struct
+{
+	ovr_beaconManager_pipelineStats_t pipelineStats;
+	ovr_beaconManager_admissionStats_t admissionStats;
+	ovr_beaconManager_rpcInterface_publishStats_t publishStats;
+	uint32_t sensorBusTime_ms;
+	uint32_t linkChanges;
+}metricsSnapshot_t;
 
 
 // ******** local function prototypes ********
 static void cb_onRunLoopUpdate(void* userVarIn);
+static bool appendMetrics(ovr_beaconGateway_rpcInterface_t *const bgriIn, char *const payloadIn, size_t maxSize_bytesIn, metricsSnapshot_t *const snapshotOut);
+static void commitMetrics(ovr_beaconGateway_rpcInterface_t *const bgriIn, metricsSnapshot_t *const snapshotIn);
+static bool publish(ovr_beaconGateway_rpcInterface_t *const bgriIn, cxa_mqtt_rpc_node_t *const nodeIn, char *const nameIn, uint64_t coalesceKeyIn, char *const payloadIn);
 
 
 // ********  local variable declarations *********
@@ -60,6 +83,15 @@ void ovr_beaconGateway_rpcInterface_init(ovr_beaconGateway_rpcInterface_t *const
 
 	cxa_timeDiff_init(&bgriIn->td_sendCheckin);
 
+	bgriIn->numPublishes = 0;
+	bgriIn->numPublishBytes = 0;
+	bgriIn->numPublishFailures = 0;
+	memset(&bgriIn->lastPipelineStats, 0, sizeof(bgriIn->lastPipelineStats));
+	memset(&bgriIn->lastAdmissionStats, 0, sizeof(bgriIn->lastAdmissionStats));
+	memset(&bgriIn->lastPublishStats, 0, sizeof(bgriIn->lastPublishStats));
+	bgriIn->lastSensorBusTime_ms = 0;
+	bgriIn->lastLinkChanges = 0;
+
 	// initialize our RPC nodes
 	cxa_mqtt_rpc_node_init_formattedString(&bgriIn->rpcNode_ambient, bgriIn->rpcNode_root, "ambient");
 	cxa_mqtt_rpc_node_init_formattedString(&bgriIn->rpcNode_ambient_light, &bgriIn->rpcNode_ambient, "light_255");
@@ -90,7 +122,7 @@ void ovr_beaconGateway_rpcInterface_notifyTempChanged(ovr_beaconGateway_rpcInter
 	if( !cxa_stringUtils_concat(notiPayload, value_str, sizeof(notiPayload)) ) return;
 	if( !cxa_stringUtils_concat(notiPayload, "}", sizeof(notiPayload)) ) return;
 
-	cxa_mqtt_rpc_node_publishNotification(&bgriIn->rpcNode_ambient_temp, "onChange", CXA_MQTT_QOS_ATMOST_ONCE, notiPayload, strlen(notiPayload));
+	publish(bgriIn, &bgriIn->rpcNode_ambient_temp, "onChange", AMBIENT_COALESCEKEY, notiPayload);
 }
 
 
@@ -113,7 +145,7 @@ void ovr_beaconGateway_rpcInterface_notifyLightChanged(ovr_beaconGateway_rpcInte
 	if( !cxa_stringUtils_concat(notiPayload, value_str, sizeof(notiPayload)) ) return;
 	if( !cxa_stringUtils_concat(notiPayload, "}", sizeof(notiPayload)) ) return;
 
-	cxa_mqtt_rpc_node_publishNotification(&bgriIn->rpcNode_ambient_light, "onChange", CXA_MQTT_QOS_ATMOST_ONCE, notiPayload, strlen(notiPayload));
+	publish(bgriIn, &bgriIn->rpcNode_ambient_light, "onChange", AMBIENT_COALESCEKEY, notiPayload);
 }
 
 
@@ -123,7 +155,7 @@ static void cb_onRunLoopUpdate(void* userVarIn)
 	ovr_beaconGateway_rpcInterface_t* bgriIn = (ovr_beaconGateway_rpcInterface_t*)userVarIn;
 	cxa_assert(bgriIn);
 
-	if( cxa_timeDiff_isElapsed_recurring_ms(&bgriIn->td_sendCheckin, CHECKIN_PERIOD_MS) )
+	if( cxa_timeDiff_isElapsed_recurring_ms(&bgriIn->td_sendCheckin, ovr_config_get(OVR_CONFIG_ID_CHECKIN_PERIOD_MS)) )
 	{
 		char timestamp_str[11];
 		snprintf(timestamp_str, sizeof(timestamp_str), "%d", cxa_sntpClient_getUnixTimeStamp());
@@ -137,16 +169,126 @@ static void cb_onRunLoopUpdate(void* userVarIn)
 		snprintf(isRadioReady_str, sizeof(isRadioReady_str), "%d", ovr_beaconGateway_isBeaconRadioReady(bgriIn->bg));
 		isRadioReady_str[sizeof(isRadioReady_str)-1] = 0;
 
-		// combine into one payload string
+		// combine into one payload string (sized for our topic so the scheduler can't refuse it)
 		char notiPayload[UPDATE_MAX_PAYLOAD_BYTES] = "";
-		if( !cxa_stringUtils_concat(notiPayload, "{\"variant\":", sizeof(notiPayload)) ) return;
-		if( !cxa_stringUtils_concat(notiPayload, variant_str, sizeof(notiPayload)) ) return;
-		if( !cxa_stringUtils_concat(notiPayload, ",\"timestamp_s_local\":", sizeof(notiPayload)) ) return;
-		if( !cxa_stringUtils_concat(notiPayload, timestamp_str, sizeof(notiPayload)) ) return;
-		if( !cxa_stringUtils_concat(notiPayload, ",\"isBeaconRadioReady\":", sizeof(notiPayload)) ) return;
-		if( !cxa_stringUtils_concat(notiPayload, isRadioReady_str, sizeof(notiPayload)) ) return;
-		if( !cxa_stringUtils_concat(notiPayload, "}", sizeof(notiPayload)) ) return;
-
-		cxa_mqtt_rpc_node_publishNotification(bgriIn->rpcNode_root, "checkIn", CXA_MQTT_QOS_ATMOST_ONCE, notiPayload, strlen(notiPayload));
+		size_t maxSize_bytes = ovr_publishScheduler_getMaxPayloadSize_bytes(bgriIn->rpcNode_root, "checkIn") + 1;
+		if( maxSize_bytes > sizeof(notiPayload) ) maxSize_bytes = sizeof(notiPayload);
+		if( !cxa_stringUtils_concat(notiPayload, "{\"variant\":", maxSize_bytes) ) return;
+		if( !cxa_stringUtils_concat(notiPayload, variant_str, maxSize_bytes) ) return;
+		if( !cxa_stringUtils_concat(notiPayload, ",\"timestamp_s_local\":", maxSize_bytes) ) return;
+		if( !cxa_stringUtils_concat(notiPayload, timestamp_str, maxSize_bytes) ) return;
+		if( !cxa_stringUtils_concat(notiPayload, ",\"isBeaconRadioReady\":", maxSize_bytes) ) return;
+		if( !cxa_stringUtils_concat(notiPayload, isRadioReady_str, maxSize_bytes) ) return;
+
+		// leaving room to close the object...if the metrics don't fit we still check in, and
+		// the next checkIn reports the change since the last one that carried them
+		size_t headerLen_bytes = strlen(notiPayload);
+		metricsSnapshot_t currMetrics;
+		bool hasMetrics = appendMetrics(bgriIn, notiPayload, maxSize_bytes - 1, &currMetrics);
+		if( !hasMetrics ) notiPayload[headerLen_bytes] = 0;
+		if( !cxa_stringUtils_concat(notiPayload, "}", maxSize_bytes) ) return;
+
+		if( publish(bgriIn, bgriIn->rpcNode_root, "checkIn", OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, notiPayload) && hasMetrics )
+		{
+			commitMetrics(bgriIn, &currMetrics);
+		}
 	}
 }
+
+
+static bool appendMetrics(ovr_beaconGateway_rpcInterface_t *const bgriIn, char *const payloadIn, size_t maxSize_bytesIn, metricsSnapshot_t *const snapshotOut)
+{
+	cxa_assert(bgriIn);
+	cxa_assert(payloadIn);
+	cxa_assert(snapshotOut);
+
+	ovr_beaconManager_t* bm = ovr_beaconGateway_getBeaconManager(bgriIn->bg);
+
+	// counters are free-running, we report the change since the last checkIn that went out
+	ovr_beaconManager_pipelineStats_t currPipelineStats = ovr_beaconManager_getPipelineStats(bm);
+	ovr_beaconManager_admissionStats_t currAdmissionStats = ovr_beaconManager_getAdmissionStats(bm);
+	ovr_beaconManager_rpcInterface_publishStats_t currPublishStats = ovr_beaconManager_getPublishStats(bm);
+	currPublishStats.numPublishes += __atomic_load_n(&bgriIn->numPublishes, __ATOMIC_RELAXED);
+	currPublishStats.numBytes += __atomic_load_n(&bgriIn->numPublishBytes, __ATOMIC_RELAXED);
+	currPublishStats.numFailures += __atomic_load_n(&bgriIn->numPublishFailures, __ATOMIC_RELAXED);
+
+	uint16_t publishQueue_depth = 0;
+	for( size_t i = 0; i < OVR_PUBLISHSCHEDULER_NUM_CLASSES; i++ ) publishQueue_depth += ovr_publishScheduler_getClassStats(i).depth;
+	uint16_t publishQueue_highWater;
+	uint32_t publishDelay_max_ms;
+	ovr_publishScheduler_takeHighWater(&publishQueue_highWater, &publishDelay_max_ms);
+	uint32_t currSensorBusTime_ms = ovr_ambientSampler_getStats(ovr_beaconGateway_getAmbientSampler(bgriIn->bg)).busTime_total_ms;
+	ovr_linkSelector_stats_t currLinkStats = ovr_linkManager_getStats();
+
+	// positional to fit within a single message:
+	// [rx, accepted, filtered, dropped, rxFifoHighWater, numKnown, tableFull,
+	//  publishes, publishBytes, publishFailures, freeHeap, minFreeHeap,
+	//  stackHighWater_net, stackHighWater_ui, stackHighWater_bt,
+	//  publishQueueDepth, publishQueueHighWater, publishDelayMax_ms, sensorBusTime_ms,
+	//  activeLink, linkChanges, lastFailoverLatency_ms]
+	if( !cxa_stringUtils_concat_formattedString(payloadIn, maxSize_bytesIn,
+			",\"metrics\":[%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u]",
+			(unsigned)(currPipelineStats.numAdvertsRx - bgriIn->lastPipelineStats.numAdvertsRx),
+			(unsigned)(currPipelineStats.numAdvertsAccepted - bgriIn->lastPipelineStats.numAdvertsAccepted),
+			(unsigned)(currPipelineStats.numAdvertsFiltered - bgriIn->lastPipelineStats.numAdvertsFiltered),
+			(unsigned)(currPipelineStats.numAdvertsDropped - bgriIn->lastPipelineStats.numAdvertsDropped),
+			(unsigned)ovr_beaconManager_takeRxFifoHighWater_elems(bm),
+			(unsigned)cxa_array_getSize_elems(ovr_beaconManager_getKnownBeacons(bm)),
+			(unsigned)(currAdmissionStats.numTableFull - bgriIn->lastAdmissionStats.numTableFull),
+			(unsigned)(currPublishStats.numPublishes - bgriIn->lastPublishStats.numPublishes),
+			(unsigned)(currPublishStats.numBytes - bgriIn->lastPublishStats.numBytes),
+			(unsigned)(currPublishStats.numFailures - bgriIn->lastPublishStats.numFailures),
+			(unsigned)esp_get_free_heap_size(),
+			(unsigned)esp_get_minimum_free_heap_size(),
+			(unsigned)ovr_beaconGateway_getStackHighWater_bytes(bgriIn->bg, OVR_GW_THREADID_NETWORK),
+			(unsigned)ovr_beaconGateway_getStackHighWater_bytes(bgriIn->bg, OVR_GW_THREADID_UI),
+			(unsigned)ovr_beaconGateway_getStackHighWater_bytes(bgriIn->bg, OVR_GW_THREADID_BLUETOOTH),
+			(unsigned)publishQueue_depth,
+			(unsigned)publishQueue_highWater,
+			(unsigned)publishDelay_max_ms,
+			(unsigned)(currSensorBusTime_ms - bgriIn->lastSensorBusTime_ms),
+			(unsigned)ovr_linkManager_getActiveLink(),
+			(unsigned)(currLinkStats.numLinkChanges - bgriIn->lastLinkChanges),
+			(unsigned)currLinkStats.lastFailoverLatency_ms) ) return false;
+
+	// only becomes our baseline once it's actually been published
+	snapshotOut->pipelineStats = currPipelineStats;
+	snapshotOut->admissionStats = currAdmissionStats;
+	snapshotOut->publishStats = currPublishStats;
+	snapshotOut->sensorBusTime_ms = currSensorBusTime_ms;
+	snapshotOut->linkChanges = currLinkStats.numLinkChanges;
+
+	return true;
+}
+
+
+static void commitMetrics(ovr_beaconGateway_rpcInterface_t *const bgriIn, metricsSnapshot_t *const snapshotIn)
+{
+	cxa_assert(bgriIn);
+	cxa_assert(snapshotIn);
+
+	bgriIn->lastPipelineStats = snapshotIn->pipelineStats;
+	bgriIn->lastAdmissionStats = snapshotIn->admissionStats;
+	bgriIn->lastPublishStats = snapshotIn->publishStats;
+	bgriIn->lastSensorBusTime_ms = snapshotIn->sensorBusTime_ms;
+	bgriIn->lastLinkChanges = snapshotIn->linkChanges;
+}
+
+
+static bool publish(ovr_beaconGateway_rpcInterface_t *const bgriIn, cxa_mqtt_rpc_node_t *const nodeIn, char *const nameIn, uint64_t coalesceKeyIn, char *const payloadIn)
+{
+	cxa_assert(bgriIn);
+	cxa_assert(nodeIn);
+
+	// ambient notifications come from the bluetooth thread
+	size_t payloadSize_bytes = strlen(payloadIn);
+	if( ovr_publishScheduler_publish(nodeIn, nameIn, OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, coalesceKeyIn, payloadIn, payloadSize_bytes) )
+	{
+		__atomic_fetch_add(&bgriIn->numPublishes, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&bgriIn->numPublishBytes, payloadSize_bytes, __ATOMIC_RELAXED);
+		return true;
+	}
+
+	__atomic_fetch_add(&bgriIn->numPublishFailures, 1, __ATOMIC_RELAXED);
+	return false;
+}
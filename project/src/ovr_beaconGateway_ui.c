@@ -21,6 +21,7 @@
 #include <cxa_mqtt_client.h>
 #include <cxa_mqtt_connectionManager.h>
 #include <cxa_network_wifiManager.h>
+#include <cxa_runLoop.h>
 #include <ovr_beaconGateway.h>
 
 
@@ -31,25 +32,29 @@
 #define WIFI_RGBCOLOR_WAIT_CREDS			255, 0,   255
 #define WIFI_RGBCOLOR_CONNECTING			0,   0,   255
 #define WIFI_RGBCOLOR_CONNECTED				0,   0,   255
-#define WIFI_RGBCOLOR_CONNECTED_ACT			0,   0,   0
 
 #define BTLE_RGBCOLOR_IDLE  				0,   0,   255
 #define BTLE_RGBCOLOR_ERROR					255, 0,   0
-#define BTLE_RGBCOLOR_CONNECTED_ACT  		0,   0,   0
 
 #define BLINKRATE_ERROR						100,  100
 #define BLINKRATE_PROVISION					100,  100
 #define BLINKRATE_WAIT_CREDS				100,  100
 #define BLINKRATE_CONNECTING				250,  250
 
-#define FLASHPERIOD_ACT_MS					100
+// activity is shown as a dip in brightness, once per period, deeper as the rate goes up
+#define ACTIVITY_PERIOD_MS					250
+#define ACTIVITY_MINDEPTH_255				64
+#define BTLE_ACTIVITY_FULLSCALE_PER_S		50
 
 
 // ******** local type definitions ********
 
 
 // ******** local function prototypes ********
+static void cb_onRunLoopUpdate(void* userVarIn);
+
 static void updateNetLed(ovr_beaconGateway_ui_t *const bguiIn);
+static uint8_t getActivityDepth(uint32_t numEventsIn, uint32_t fullScale_perSIn);
 
 static void wifiCb_onProvisioning(void* userVarIn);
 static void wifiCb_onAssociating(const char *const ssidIn, void* userVarIn);
@@ -76,7 +81,7 @@ static void beaconManagerCb_onBeaconUpdate(ovr_beaconProxy_t *const beaconProxyI
 // ******** global function implementations ********
 void ovr_beaconGateway_ui_init(ovr_beaconGateway_ui_t *const bguiIn,
 							   cxa_btle_client_t *const btleClientIn, ovr_beaconManager_t *const bmIn,
-							   cxa_rgbLed_t *const led_btleActIn, cxa_rgbLed_t *const led_netActIn,
+							   ovr_ledcRgbLed_t *const led_btleActIn, ovr_ledcRgbLed_t *const led_netActIn,
 							   cxa_gpio_t *const gpio_swProvIn)
 {
 	cxa_assert(bguiIn);
@@ -90,8 +95,11 @@ void ovr_beaconGateway_ui_init(ovr_beaconGateway_ui_t *const bguiIn,
 
 	// set our initial state
 	bguiIn->networkError = false;
-	cxa_rgbLed_setRgb(bguiIn->led_btleAct, WIFI_RGBCOLOR_UNKNOWN);
-	cxa_rgbLed_setRgb(bguiIn->led_netAct, WIFI_RGBCOLOR_UNKNOWN);
+	bguiIn->numBeaconUpdates = 0;
+	bguiIn->numPingResps = 0;
+	cxa_timeDiff_init(&bguiIn->td_activity);
+	if( bguiIn->led_btleAct ) ovr_ledcRgbLed_setRgb(bguiIn->led_btleAct, WIFI_RGBCOLOR_UNKNOWN);
+	if( bguiIn->led_netAct ) ovr_ledcRgbLed_setRgb(bguiIn->led_netAct, WIFI_RGBCOLOR_UNKNOWN);
 
 	// setup our long press manager
 	cxa_gpio_longPressManager_init(&bguiIn->lpm_swProv, gpio_swProvIn, OVR_GW_THREADID_UI);
@@ -115,17 +123,36 @@ void ovr_beaconGateway_ui_init(ovr_beaconGateway_ui_t *const bguiIn,
 
 	// register for beacon activity callbacks
 	ovr_beaconManager_addListener(bmIn, NULL, beaconManagerCb_onBeaconUpdate, NULL, (void*)bguiIn);
+
+	cxa_runLoop_addEntry(OVR_GW_THREADID_UI, cb_onRunLoopUpdate, (void*)bguiIn);
 }
 
 
 void ovr_beaconGateway_ui_onAssert(ovr_beaconGateway_ui_t *const bguiIn)
 {
-	cxa_rgbLed_setRgb(bguiIn->led_btleAct, 255, 0, 0);
-	cxa_rgbLed_setRgb(bguiIn->led_netAct, 255, 0, 0);
+	// the ui runLoop won't get another chance to apply these
+	if( bguiIn->led_btleAct ) ovr_ledcRgbLed_forceRgb(bguiIn->led_btleAct, 255, 0, 0);
+	if( bguiIn->led_netAct ) ovr_ledcRgbLed_forceRgb(bguiIn->led_netAct, 255, 0, 0);
 }
 
 
 // ******** local function implementations ********
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	ovr_beaconGateway_ui_t* bguiIn = (ovr_beaconGateway_ui_t*)userVarIn;
+	cxa_assert(bguiIn);
+
+	if( !cxa_timeDiff_isElapsed_recurring_ms(&bguiIn->td_activity, ACTIVITY_PERIOD_MS) ) return;
+
+	// pings are rare enough that any at all deserve a full dip
+	uint32_t numBeaconUpdates = __atomic_exchange_n(&bguiIn->numBeaconUpdates, 0, __ATOMIC_RELAXED);
+	uint32_t numPingResps = __atomic_exchange_n(&bguiIn->numPingResps, 0, __ATOMIC_RELAXED);
+
+	if( bguiIn->led_btleAct ) ovr_ledcRgbLed_setActivity(bguiIn->led_btleAct, getActivityDepth(numBeaconUpdates, BTLE_ACTIVITY_FULLSCALE_PER_S), ACTIVITY_PERIOD_MS);
+	if( bguiIn->led_netAct ) ovr_ledcRgbLed_setActivity(bguiIn->led_netAct, (numPingResps > 0) ? 255 : 0, ACTIVITY_PERIOD_MS);
+}
+
+
 static void updateNetLed(ovr_beaconGateway_ui_t *const bguiIn)
 {
 	cxa_assert(bguiIn);
@@ -137,27 +164,38 @@ static void updateNetLed(ovr_beaconGateway_ui_t *const bguiIn)
 	// if we made it here, our button is not pressed...
 	if( cxa_network_wifiManager_getState() == CXA_NETWORK_WIFISTATE_PROVISIONING )
 	{
-		cxa_rgbLed_blink(bguiIn->led_netAct, WIFI_RGBCOLOR_PROVISION, BLINKRATE_PROVISION);
+		ovr_ledcRgbLed_blink(bguiIn->led_netAct, WIFI_RGBCOLOR_PROVISION, BLINKRATE_PROVISION);
 	}
 	else if( cxa_mqtt_client_isConnected(cxa_mqtt_connManager_getMqttClient()) )
 	{
-		cxa_rgbLed_setRgb(bguiIn->led_netAct, WIFI_RGBCOLOR_CONNECTED);
+		ovr_ledcRgbLed_setRgb(bguiIn->led_netAct, WIFI_RGBCOLOR_CONNECTED);
 	}
 	else if( bguiIn->networkError )
 	{
-		cxa_rgbLed_blink(bguiIn->led_netAct, WIFI_RGBCOLOR_ERROR, BLINKRATE_ERROR);
+		ovr_ledcRgbLed_blink(bguiIn->led_netAct, WIFI_RGBCOLOR_ERROR, BLINKRATE_ERROR);
 	}
 	else if( !cxa_mqtt_connManager_areCredentialsSet() )
 	{
-		cxa_rgbLed_blink(bguiIn->led_netAct, WIFI_RGBCOLOR_WAIT_CREDS, BLINKRATE_WAIT_CREDS);
+		ovr_ledcRgbLed_blink(bguiIn->led_netAct, WIFI_RGBCOLOR_WAIT_CREDS, BLINKRATE_WAIT_CREDS);
 	}
 	else
 	{
-		cxa_rgbLed_blink(bguiIn->led_netAct, WIFI_RGBCOLOR_CONNECTING, BLINKRATE_CONNECTING);
+		ovr_ledcRgbLed_blink(bguiIn->led_netAct, WIFI_RGBCOLOR_CONNECTING, BLINKRATE_CONNECTING);
 	}
 }
 
 
+static uint8_t getActivityDepth(uint32_t numEventsIn, uint32_t fullScale_perSIn)
+{
+	if( numEventsIn == 0 ) return 0;
+
+	uint32_t rate_perS = (numEventsIn * 1000) / ACTIVITY_PERIOD_MS;
+	if( rate_perS > fullScale_perSIn ) rate_perS = fullScale_perSIn;
+
+	return ACTIVITY_MINDEPTH_255 + (((255 - ACTIVITY_MINDEPTH_255) * rate_perS) / fullScale_perSIn);
+}
+
+
 static void wifiCb_onProvisioning(void* userVarIn)
 {
 	ovr_beaconGateway_ui_t* bguiIn = (ovr_beaconGateway_ui_t*)userVarIn;
@@ -191,7 +229,7 @@ static void lpmCb_onEnter_provision(void* userVarIn)
 	ovr_beaconGateway_ui_t* bguiIn = (ovr_beaconGateway_ui_t*)userVarIn;
 	cxa_assert(bguiIn);
 
-	cxa_rgbLed_setRgb(bguiIn->led_netAct, WIFI_RGBCOLOR_PROVISION);
+	ovr_ledcRgbLed_setRgb(bguiIn->led_netAct, WIFI_RGBCOLOR_PROVISION);
 }
 
 
@@ -247,7 +285,7 @@ static void mqttCb_onPingRespRx(cxa_mqtt_client_t *const clientIn, void* userVar
 	ovr_beaconGateway_ui_t* bguiIn = (ovr_beaconGateway_ui_t*)userVarIn;
 	cxa_assert(bguiIn);
 
-	if( bguiIn->led_netAct ) cxa_rgbLed_flashOnce(bguiIn->led_netAct, WIFI_RGBCOLOR_CONNECTED_ACT, FLASHPERIOD_ACT_MS);
+	__atomic_add_fetch(&bguiIn->numPingResps, 1, __ATOMIC_RELAXED);
 }
 
 
@@ -256,7 +294,7 @@ static void btleCb_onReady(cxa_btle_client_t *const btlecIn, void* userVarIn)
 	ovr_beaconGateway_ui_t* bguiIn = (ovr_beaconGateway_ui_t*)userVarIn;
 	cxa_assert(bguiIn);
 
-	if( bguiIn->led_btleAct ) cxa_rgbLed_setRgb(bguiIn->led_btleAct, BTLE_RGBCOLOR_IDLE);
+	if( bguiIn->led_btleAct ) ovr_ledcRgbLed_setRgb(bguiIn->led_btleAct, BTLE_RGBCOLOR_IDLE);
 }
 
 
@@ -265,7 +303,7 @@ static void btleCb_onFailedInit(cxa_btle_client_t *const btlecIn, bool willAutoR
 	ovr_beaconGateway_ui_t* bguiIn = (ovr_beaconGateway_ui_t*)userVarIn;
 	cxa_assert(bguiIn);
 
-	if( bguiIn->led_btleAct ) cxa_rgbLed_blink(bguiIn->led_btleAct, BTLE_RGBCOLOR_ERROR, BLINKRATE_ERROR);
+	if( bguiIn->led_btleAct ) ovr_ledcRgbLed_blink(bguiIn->led_btleAct, BTLE_RGBCOLOR_ERROR, BLINKRATE_ERROR);
 }
 
 
@@ -274,5 +312,6 @@ static void beaconManagerCb_onBeaconUpdate(ovr_beaconProxy_t *const beaconProxyI
 	ovr_beaconGateway_ui_t* bguiIn = (ovr_beaconGateway_ui_t*)userVarIn;
 	cxa_assert(bguiIn);
 
-	if( bguiIn->led_btleAct ) cxa_rgbLed_flashOnce(bguiIn->led_btleAct, BTLE_RGBCOLOR_CONNECTED_ACT, FLASHPERIOD_ACT_MS);
+	// called for every advert, so just count it
+	__atomic_add_fetch(&bguiIn->numBeaconUpdates, 1, __ATOMIC_RELAXED);
 }
@@ -0,0 +1,451 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_beaconHistory.h"
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_assert.h>
+
+
+// ******** local macro definitions ********
+#define RECORD_MAXSIZE_BYTES			24
+
+#define FIELDMASK_RSSI					(1 << 0)
+#define FIELDMASK_TEMP					(1 << 1)
+#define FIELDMASK_LIGHT					(1 << 2)
+#define FIELDMASK_BATT_PCNT				(1 << 3)
+#define FIELDMASK_BATT_MV				(1 << 4)
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	uint8_t* buffer;
+	size_t bufferSize_bytes;
+	size_t startIndex;
+	size_t length_bytes;
+	size_t pos;
+}reader_t;
+
+
+// ******** local function prototypes ********
+static void dropOldest(ovr_beaconHistory_t *const histIn);
+static void reader_initRing(reader_t *const readerIn, ovr_beaconHistory_t *const histIn);
+
+static size_t encodeRecord(ovr_beaconHistory_sample_t *const prevIn, ovr_beaconHistory_sample_t *const currIn, uint32_t dt_unitsIn, uint8_t *const bufOut);
+static bool decodeRecord(reader_t *const readerIn, ovr_beaconHistory_sample_t *const sampleInOut, uint32_t *const dt_unitsOut);
+
+static bool readByte(reader_t *const readerIn, uint8_t *const byteOut);
+static bool readVarint(reader_t *const readerIn, uint32_t *const valOut);
+static size_t writeVarint(uint8_t *const bufOut, uint32_t valIn);
+
+static inline uint32_t zigzagEncode(int32_t valIn) { return ((uint32_t)valIn << 1) ^ (uint32_t)(valIn >> 31); }
+static inline int32_t zigzagDecode(uint32_t valIn) { return (int32_t)(valIn >> 1) ^ -(int32_t)(valIn & 1); }
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void ovr_beaconHistory_arena_init(ovr_beaconHistory_arena_t *const arenaIn, uint8_t *const bufferIn, bool *const isSliceUsedIn, size_t numSlicesIn)
+{
+	cxa_assert(arenaIn);
+	cxa_assert(bufferIn);
+	cxa_assert(isSliceUsedIn);
+
+	arenaIn->buffer = bufferIn;
+	arenaIn->isSliceUsed = isSliceUsedIn;
+	arenaIn->numSlices = numSlicesIn;
+
+	memset(arenaIn->isSliceUsed, 0, numSlicesIn * sizeof(*arenaIn->isSliceUsed));
+}
+
+
+void ovr_beaconHistory_init(ovr_beaconHistory_t *const histIn, ovr_beaconHistory_arena_t *const arenaIn, ovr_beaconHistory_sample_t *const firstSampleIn)
+{
+	cxa_assert(histIn);
+	cxa_assert(firstSampleIn);
+
+	// setup our internal state
+	histIn->arena = arenaIn;
+	histIn->buffer = NULL;
+	histIn->readIndex = 0;
+	histIn->size_bytes = 0;
+	histIn->numSamples = 0;
+	histIn->pendingDt_units = 0;
+	histIn->base = *firstSampleIn;
+	histIn->newest = *firstSampleIn;
+	histIn->numDropped = 0;
+
+	// claim a slice
+	if( arenaIn == NULL ) return;
+	for( size_t i = 0; i < arenaIn->numSlices; i++ )
+	{
+		if( arenaIn->isSliceUsed[i] ) continue;
+
+		arenaIn->isSliceUsed[i] = true;
+		histIn->buffer = &arenaIn->buffer[i * OVR_BEACONHISTORY_SLICESIZE_BYTES];
+		return;
+	}
+}
+
+
+void ovr_beaconHistory_deinit(ovr_beaconHistory_t *const histIn)
+{
+	cxa_assert(histIn);
+
+	if( (histIn->arena == NULL) || (histIn->buffer == NULL) ) return;
+
+	size_t sliceIndex = (histIn->buffer - histIn->arena->buffer) / OVR_BEACONHISTORY_SLICESIZE_BYTES;
+	cxa_assert(sliceIndex < histIn->arena->numSlices);
+
+	histIn->arena->isSliceUsed[sliceIndex] = false;
+	histIn->buffer = NULL;
+}
+
+
+void ovr_beaconHistory_append(ovr_beaconHistory_t *const histIn, ovr_beaconHistory_sample_t *const sampleIn, uint32_t dt_msIn)
+{
+	cxa_assert(histIn);
+	cxa_assert(sampleIn);
+
+	if( histIn->buffer == NULL ) return;
+
+	uint32_t dt_units = dt_msIn / OVR_BEACONHISTORY_TIMERESOLUTION_MS;
+
+	uint8_t record[RECORD_MAXSIZE_BYTES];
+	size_t recordSize_bytes = encodeRecord(&histIn->newest, sampleIn, dt_units, record);
+
+	// make room if needed
+	while( (OVR_BEACONHISTORY_SLICESIZE_BYTES - histIn->size_bytes) < recordSize_bytes ) dropOldest(histIn);
+
+	for( size_t i = 0; i < recordSize_bytes; i++ )
+	{
+		histIn->buffer[(histIn->readIndex + histIn->size_bytes + i) % OVR_BEACONHISTORY_SLICESIZE_BYTES] = record[i];
+	}
+	histIn->size_bytes += recordSize_bytes;
+	histIn->numSamples++;
+	histIn->pendingDt_units += dt_units;
+	histIn->newest = *sampleIn;
+}
+
+
+size_t ovr_beaconHistory_getNumSamples(ovr_beaconHistory_t *const histIn)
+{
+	cxa_assert(histIn);
+
+	return histIn->numSamples;
+}
+
+
+uint32_t ovr_beaconHistory_getNumDropped(ovr_beaconHistory_t *const histIn)
+{
+	cxa_assert(histIn);
+
+	return histIn->numDropped;
+}
+
+
+size_t ovr_beaconHistory_drainBatch(ovr_beaconHistory_t *const histIn, uint32_t timeSinceNewest_msIn,
+									uint8_t *const bufOut, size_t maxSize_bytesIn, size_t *const numSamplesOut)
+{
+	cxa_assert(histIn);
+	cxa_assert(bufOut);
+
+	if( numSamplesOut != NULL ) *numSamplesOut = 0;
+	if( (histIn->buffer == NULL) || (histIn->numSamples == 0) ) return 0;
+	if( maxSize_bytesIn <= OVR_BEACONHISTORY_BATCHHEADER_MAXSIZE_BYTES ) return 0;
+
+	// figure out how many whole records will fit (and what our new base will be)
+	reader_t reader;
+	reader_initRing(&reader, histIn);
+
+	ovr_beaconHistory_sample_t newBase = histIn->base;
+	uint32_t drainedDt_units = 0;
+	size_t numDrained = 0;
+	while( numDrained < histIn->numSamples )
+	{
+		size_t prevPos = reader.pos;
+		ovr_beaconHistory_sample_t prevBase = newBase;
+
+		uint32_t currDt_units;
+		if( !decodeRecord(&reader, &newBase, &currDt_units) ) break;
+		if( (OVR_BEACONHISTORY_BATCHHEADER_MAXSIZE_BYTES + reader.pos) > maxSize_bytesIn )
+		{
+			reader.pos = prevPos;
+			newBase = prevBase;
+			break;
+		}
+
+		numDrained++;
+		drainedDt_units += currDt_units;
+	}
+	if( numDrained == 0 ) return 0;
+
+	// header
+	uint32_t ageOfLast_units = (histIn->pendingDt_units - drainedDt_units) + (timeSinceNewest_msIn / OVR_BEACONHISTORY_TIMERESOLUTION_MS);
+
+	size_t pos = 0;
+	pos += writeVarint(&bufOut[pos], numDrained);
+	pos += writeVarint(&bufOut[pos], ageOfLast_units);
+	pos += writeVarint(&bufOut[pos], zigzagEncode(histIn->base.rssi_dBm));
+	pos += writeVarint(&bufOut[pos], histIn->base.temp_deciDegC);
+	pos += writeVarint(&bufOut[pos], histIn->base.light_255);
+	pos += writeVarint(&bufOut[pos], histIn->base.batt_pcnt100);
+	pos += writeVarint(&bufOut[pos], histIn->base.batt_mv);
+
+	// records are already relative to our base...copy them verbatim
+	for( size_t i = 0; i < reader.pos; i++ )
+	{
+		bufOut[pos++] = histIn->buffer[(histIn->readIndex + i) % OVR_BEACONHISTORY_SLICESIZE_BYTES];
+	}
+
+	// consume what we've drained
+	histIn->readIndex = (histIn->readIndex + reader.pos) % OVR_BEACONHISTORY_SLICESIZE_BYTES;
+	histIn->size_bytes -= reader.pos;
+	histIn->numSamples -= numDrained;
+	histIn->pendingDt_units -= drainedDt_units;
+	histIn->base = newBase;
+
+	if( numSamplesOut != NULL ) *numSamplesOut = numDrained;
+	return pos;
+}
+
+
+size_t ovr_beaconHistory_decodeBatch(uint8_t *const bufIn, size_t size_bytesIn,
+									 ovr_beaconHistory_sample_t *const samplesOut, uint32_t *const dts_msOut, size_t maxNumSamplesIn,
+									 uint32_t *const ageOfLast_msOut)
+{
+	cxa_assert(bufIn);
+	cxa_assert(samplesOut);
+
+	reader_t reader = {
+			.buffer = bufIn,
+			.bufferSize_bytes = size_bytesIn,
+			.startIndex = 0,
+			.length_bytes = size_bytesIn,
+			.pos = 0
+	};
+
+	uint32_t numSamples, ageOfLast_units, rssi_zz, temp, light, battPcnt, battMv;
+	if( !readVarint(&reader, &numSamples) ||
+		!readVarint(&reader, &ageOfLast_units) ||
+		!readVarint(&reader, &rssi_zz) ||
+		!readVarint(&reader, &temp) ||
+		!readVarint(&reader, &light) ||
+		!readVarint(&reader, &battPcnt) ||
+		!readVarint(&reader, &battMv) ) return 0;
+
+	if( ageOfLast_msOut != NULL ) *ageOfLast_msOut = ageOfLast_units * OVR_BEACONHISTORY_TIMERESOLUTION_MS;
+
+	ovr_beaconHistory_sample_t currSample = {
+			.rssi_dBm = (int8_t)zigzagDecode(rssi_zz),
+			.temp_deciDegC = (uint16_t)temp,
+			.light_255 = (uint8_t)light,
+			.batt_pcnt100 = (uint8_t)battPcnt,
+			.batt_mv = (uint16_t)battMv
+	};
+
+	size_t numDecoded = 0;
+	while( (numDecoded < numSamples) && (numDecoded < maxNumSamplesIn) )
+	{
+		uint32_t currDt_units;
+		if( !decodeRecord(&reader, &currSample, &currDt_units) ) break;
+
+		samplesOut[numDecoded] = currSample;
+		if( dts_msOut != NULL ) dts_msOut[numDecoded] = currDt_units * OVR_BEACONHISTORY_TIMERESOLUTION_MS;
+		numDecoded++;
+	}
+
+	return numDecoded;
+}
+
+
+// ******** local function implementations ********
+static void dropOldest(ovr_beaconHistory_t *const histIn)
+{
+	cxa_assert(histIn);
+
+	reader_t reader;
+	reader_initRing(&reader, histIn);
+
+	uint32_t dt_units;
+	if( (histIn->numSamples == 0) || !decodeRecord(&reader, &histIn->base, &dt_units) )
+	{
+		// shouldn't happen...but start fresh rather than spin
+		histIn->numDropped += histIn->numSamples;
+		histIn->size_bytes = 0;
+		histIn->numSamples = 0;
+		histIn->pendingDt_units = 0;
+		histIn->base = histIn->newest;
+		return;
+	}
+
+	histIn->readIndex = (histIn->readIndex + reader.pos) % OVR_BEACONHISTORY_SLICESIZE_BYTES;
+	histIn->size_bytes -= reader.pos;
+	histIn->numSamples--;
+	histIn->pendingDt_units -= dt_units;
+	histIn->numDropped++;
+}
+
+
+static void reader_initRing(reader_t *const readerIn, ovr_beaconHistory_t *const histIn)
+{
+	cxa_assert(readerIn);
+	cxa_assert(histIn);
+
+	readerIn->buffer = histIn->buffer;
+	readerIn->bufferSize_bytes = OVR_BEACONHISTORY_SLICESIZE_BYTES;
+	readerIn->startIndex = histIn->readIndex;
+	readerIn->length_bytes = histIn->size_bytes;
+	readerIn->pos = 0;
+}
+
+
+static size_t encodeRecord(ovr_beaconHistory_sample_t *const prevIn, ovr_beaconHistory_sample_t *const currIn, uint32_t dt_unitsIn, uint8_t *const bufOut)
+{
+	cxa_assert(prevIn);
+	cxa_assert(currIn);
+	cxa_assert(bufOut);
+
+	size_t pos = writeVarint(bufOut, dt_unitsIn);
+
+	// only fields that changed are written
+	size_t fieldMaskPos = pos++;
+	uint8_t fieldMask = 0;
+
+	if( currIn->rssi_dBm != prevIn->rssi_dBm )
+	{
+		fieldMask |= FIELDMASK_RSSI;
+		pos += writeVarint(&bufOut[pos], zigzagEncode((int32_t)currIn->rssi_dBm - (int32_t)prevIn->rssi_dBm));
+	}
+	if( currIn->temp_deciDegC != prevIn->temp_deciDegC )
+	{
+		fieldMask |= FIELDMASK_TEMP;
+		pos += writeVarint(&bufOut[pos], zigzagEncode((int32_t)currIn->temp_deciDegC - (int32_t)prevIn->temp_deciDegC));
+	}
+	if( currIn->light_255 != prevIn->light_255 )
+	{
+		fieldMask |= FIELDMASK_LIGHT;
+		pos += writeVarint(&bufOut[pos], zigzagEncode((int32_t)currIn->light_255 - (int32_t)prevIn->light_255));
+	}
+	if( currIn->batt_pcnt100 != prevIn->batt_pcnt100 )
+	{
+		fieldMask |= FIELDMASK_BATT_PCNT;
+		pos += writeVarint(&bufOut[pos], zigzagEncode((int32_t)currIn->batt_pcnt100 - (int32_t)prevIn->batt_pcnt100));
+	}
+	if( currIn->batt_mv != prevIn->batt_mv )
+	{
+		fieldMask |= FIELDMASK_BATT_MV;
+		pos += writeVarint(&bufOut[pos], zigzagEncode((int32_t)currIn->batt_mv - (int32_t)prevIn->batt_mv));
+	}
+
+	bufOut[fieldMaskPos] = fieldMask;
+	return pos;
+}
+
+
+static bool decodeRecord(reader_t *const readerIn, ovr_beaconHistory_sample_t *const sampleInOut, uint32_t *const dt_unitsOut)
+{
+	cxa_assert(readerIn);
+	cxa_assert(sampleInOut);
+	cxa_assert(dt_unitsOut);
+
+	uint8_t fieldMask;
+	if( !readVarint(readerIn, dt_unitsOut) ) return false;
+	if( !readByte(readerIn, &fieldMask) ) return false;
+
+	uint32_t delta_zz;
+	if( fieldMask & FIELDMASK_RSSI )
+	{
+		if( !readVarint(readerIn, &delta_zz) ) return false;
+		sampleInOut->rssi_dBm = (int8_t)(sampleInOut->rssi_dBm + zigzagDecode(delta_zz));
+	}
+	if( fieldMask & FIELDMASK_TEMP )
+	{
+		if( !readVarint(readerIn, &delta_zz) ) return false;
+		sampleInOut->temp_deciDegC = (uint16_t)(sampleInOut->temp_deciDegC + zigzagDecode(delta_zz));
+	}
+	if( fieldMask & FIELDMASK_LIGHT )
+	{
+		if( !readVarint(readerIn, &delta_zz) ) return false;
+		sampleInOut->light_255 = (uint8_t)(sampleInOut->light_255 + zigzagDecode(delta_zz));
+	}
+	if( fieldMask & FIELDMASK_BATT_PCNT )
+	{
+		if( !readVarint(readerIn, &delta_zz) ) return false;
+		sampleInOut->batt_pcnt100 = (uint8_t)(sampleInOut->batt_pcnt100 + zigzagDecode(delta_zz));
+	}
+	if( fieldMask & FIELDMASK_BATT_MV )
+	{
+		if( !readVarint(readerIn, &delta_zz) ) return false;
+		sampleInOut->batt_mv = (uint16_t)(sampleInOut->batt_mv + zigzagDecode(delta_zz));
+	}
+
+	return true;
+}
+
+
+static bool readByte(reader_t *const readerIn, uint8_t *const byteOut)
+{
+	cxa_assert(readerIn);
+	cxa_assert(byteOut);
+
+	if( readerIn->pos >= readerIn->length_bytes ) return false;
+
+	*byteOut = readerIn->buffer[(readerIn->startIndex + readerIn->pos) % readerIn->bufferSize_bytes];
+	readerIn->pos++;
+	return true;
+}
+
+
+static bool readVarint(reader_t *const readerIn, uint32_t *const valOut)
+{
+	cxa_assert(readerIn);
+	cxa_assert(valOut);
+
+	*valOut = 0;
+	for( uint8_t shift = 0; shift < 35; shift += 7 )
+	{
+		uint8_t currByte;
+		if( !readByte(readerIn, &currByte) ) return false;
+
+		*valOut |= ((uint32_t)(currByte & 0x7F)) << shift;
+		if( !(currByte & 0x80) ) return true;
+	}
+
+	// too many continuation bytes
+	return false;
+}
+
+
+static size_t writeVarint(uint8_t *const bufOut, uint32_t valIn)
+{
+	cxa_assert(bufOut);
+
+	size_t numBytes = 0;
+	do
+	{
+		uint8_t currByte = valIn & 0x7F;
+		valIn >>= 7;
+		if( valIn != 0 ) currByte |= 0x80;
+		bufOut[numBytes++] = currByte;
+	} while( valIn != 0 );
+
+	return numBytes;
+}
@@ -17,28 +17,76 @@
 
 
 // ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
 #include <cxa_assert.h>
+#include <cxa_criticalSection.h>
+#include <cxa_nvsManager.h>
 #include <cxa_runLoop.h>
-#include <cxa_tempSensor.h>
+#include <cxa_timeBase.h>
 
 #include <ovr_beaconProxy.h>
-#include <ovr_beaconGateway.h>
+#include <ovr_config.h>
 
 #define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
 #include <cxa_logger_implementation.h>
 
+#define OVR_BINLOG_LEVEL		CXA_LOG_LEVEL_DEBUG
+#include <ovr_binLog.h>
+
 
 // ******** local macro definitions ********
 #define COMPANY_ID						0x04A2
-#define SCAN_CHECK_PERIOD_MS			10000
+
+#define CHECKPOINT_VERSION				1
+#define NVS_KEY_CKPT_VERSION			"bm_ckptVer"
+#define NVS_KEY_CKPT_NUMENTRIES			"bm_ckptNum"
+#define NVS_KEY_CKPT_ENTRIES_PREFIX		"bm_ckpt"
+#define NVS_KEY_CKPT_ENTRIES_FMT		NVS_KEY_CKPT_ENTRIES_PREFIX "%u"
+// nvs keys are at most 15 characters (plus the terminator)
+#define NVS_KEY_MAXLEN					16
+
+// chunk keys are the prefix plus a uint8_t index (at most 3 digits)
+_Static_assert(((OVR_BEACONMANAGER_MAXNUM_BEACONS_LIMIT - 1) / OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK) <= UINT8_MAX, "checkpoint chunk index must fit a uint8_t");
+_Static_assert((sizeof(NVS_KEY_CKPT_ENTRIES_PREFIX) - 1 + 3) < NVS_KEY_MAXLEN, "checkpoint chunk keys must fit the nvs key limit");
+
+#define NVS_KEY_CAP_MAXNUMBEACONS		"bm_capBeacons"
+#define NVS_KEY_CAP_RXFIFOSIZE			"bm_capRxFifo"
+#define NVS_KEY_CAP_MAXNUMLISTENERS		"bm_capListeners"
 
 
 // ******** local type definitions ********
 
 
 // ******** local function prototypes ********
+static void loadCapacities(ovr_beaconManager_t *const bmIn);
+static bool areCapacitiesValid(ovr_beaconManager_capacities_t *const capacitiesIn);
+static void setDefaultCapacities(ovr_beaconManager_t *const bmIn);
+static bool allocateTables(ovr_beaconManager_t *const bmIn);
+
 static void processRxUpdateFifo(ovr_beaconManager_t *const bmIn);
+static void admitProxy(ovr_beaconManager_t *const bmIn, ovr_beaconUpdate_t *const updateIn);
 static void pruneLostProxies(ovr_beaconManager_t *const bmIn);
+static void removeProxy(ovr_beaconManager_t *const bmIn, ovr_beaconProxy_t *const beaconProxyIn);
+static bool beginTableChange(ovr_beaconManager_t *const bmIn);
+static void endTableChange(ovr_beaconManager_t *const bmIn);
+
+static bool presence_onAdvert(ovr_beaconManager_t *const bmIn, ovr_beaconUpdate_t *const updateIn, ovr_beaconProxy_cadence_t *const cadenceOut);
+static void presence_remember(ovr_beaconManager_t *const bmIn, ovr_beaconProxy_t *const beaconProxyIn);
+static ovr_beaconManager_presenceEntry_t* presence_getEntry(ovr_beaconManager_t *const bmIn, cxa_eui48_t *const eui48In, uint32_t now_usIn);
+
+static void restoreCheckpoint(ovr_beaconManager_t *const bmIn);
+static void checkpointIfNeeded(ovr_beaconManager_t *const bmIn);
+static bool writeCheckpoint(ovr_beaconManager_t *const bmIn);
+
+static ovr_beaconProxy_t* getEvictionCandidate(ovr_beaconManager_t *const bmIn, ovr_beaconUpdate_t *const newcomerIn);
+
+static uint16_t getProxyIndex(ovr_beaconManager_t *const bmIn, ovr_beaconProxy_t *const beaconProxyIn);
+static int8_t getRssiAtIndexPos(ovr_beaconManager_t *const bmIn, size_t posIn);
+static void rssiIndex_insert(ovr_beaconManager_t *const bmIn, uint16_t proxyIndexIn);
+static void rssiIndex_update(ovr_beaconManager_t *const bmIn, uint16_t proxyIndexIn);
+static void rssiIndex_remove(ovr_beaconManager_t *const bmIn, uint16_t proxyIndexIn);
 
 static void notifyListeners_onFound(ovr_beaconManager_t *const bmIn, ovr_beaconProxy_t *const beaconProxyIn);
 static void notifyListeners_onUpdate(ovr_beaconManager_t *const bmIn, ovr_beaconProxy_t *const beaconProxyIn);
@@ -51,6 +99,8 @@ static void btleCb_onFailedInit(cxa_btle_client_t *const btlecIn, bool willAutoR
 static void btleCb_onScanStart(bool wasSuccessfulIn, void* userVarIn);
 static void btleCb_onAdvertRx(cxa_btle_advPacket_t* packetIn, void* userVarIn);
 
+static bool ingestBeaconData(ovr_beaconManager_t *const bmIn, int8_t rssi_dBmIn, cxa_fixedByteBuffer_t *const manBytesIn);
+
 static cxa_btle_advField_t* findBeaconFieldInPacket(cxa_btle_advPacket_t* packetIn);
 
 
@@ -60,7 +110,8 @@ static cxa_btle_advField_t* findBeaconFieldInPacket(cxa_btle_advPacket_t* packet
 // ******** global function implementations ********
 void ovr_beaconManager_init(ovr_beaconManager_t *const bmIn,
 							cxa_btle_client_t *const btleClientIn,
-							cxa_mqtt_rpc_node_t *const rpcNodeIn)
+							cxa_mqtt_rpc_node_t *const rpcNodeIn,
+							int btleThreadIdIn, int rpcThreadIdIn)
 {
 	cxa_assert(bmIn);
 	cxa_assert(btleClientIn);
@@ -71,19 +122,84 @@ void ovr_beaconManager_init(ovr_beaconManager_t *const bmIn,
 	// initialize our logger
 	cxa_logger_init(&bmIn->logger, "beaconManager");
 
-	cxa_array_initStd(&bmIn->knownBeacons, bmIn->knownBeacons_raw);
-	cxa_fixedFifo_initStd(&bmIn->rxUpdates, CXA_FF_ON_FULL_DROP, bmIn->rxUpdates_raw);
-	cxa_array_initStd(&bmIn->listeners, bmIn->listeners_raw);
+	// size our tables then carve them out of a single arena...nothing is allocated after this
+	loadCapacities(bmIn);
+	if( !allocateTables(bmIn) )
+	{
+		cxa_logger_warn(&bmIn->logger, "not enough memory for %d beacons...using defaults", bmIn->capacities.maxNumBeacons);
+		setDefaultCapacities(bmIn);
+		cxa_assert(allocateTables(bmIn));
+	}
+	ovr_memArena_seal(&bmIn->memArena_hot);
+	ovr_memArena_seal(&bmIn->memArena_cold);
+	cxa_logger_info(&bmIn->logger, "beacons: %d  rxFifo: %d  listeners: %d  hot: %d bytes (%s)  cold: %d bytes (%s)",
+					bmIn->capacities.maxNumBeacons, bmIn->capacities.rxFifoSize_elems, bmIn->capacities.maxNumListeners,
+					(int)ovr_memArena_getUsed_bytes(&bmIn->memArena_hot),
+					(ovr_memArena_getRegion(&bmIn->memArena_hot) == OVR_MEMARENA_REGION_PSRAM) ? "psram" : "internal",
+					(int)ovr_memArena_getUsed_bytes(&bmIn->memArena_cold),
+					(ovr_memArena_getRegion(&bmIn->memArena_cold) == OVR_MEMARENA_REGION_PSRAM) ? "psram" : "internal");
+
+	ovr_beaconFilter_init(&bmIn->filter);
+
+	bmIn->numTableHolds = 0;
+	bmIn->isTableChanging = false;
+	bmIn->evictPolicy = OVR_BEACONMANAGER_EVICTPOLICY;
+	memset(&bmIn->admissionStats, 0, sizeof(bmIn->admissionStats));
+	memset(&bmIn->pipelineStats, 0, sizeof(bmIn->pipelineStats));
+	bmIn->rxFifo_highWater_elems = 0;
+	bmIn->cb_onAdvert = NULL;
+	bmIn->cb_onAdvert_userVar = NULL;
+
+	// warm start (before anyone can listen...restored beacons aren't "found")
+	cxa_timeDiff_init(&bmIn->td_checkpoint);
+	bmIn->isCheckpointDirty = false;
+	bmIn->isCheckpointRequested = false;
+	memset(&bmIn->checkpointStats, 0, sizeof(bmIn->checkpointStats));
+	restoreCheckpoint(bmIn);
 
 	// setup our BTLE
 	bmIn->btleClient = btleClientIn;
 	cxa_btle_client_addListener(bmIn->btleClient, btleCb_onReady, btleCb_onFailedInit, (void*)bmIn);
 
 	// setup our RPC interface if needed
-	if( rpcNodeIn ) ovr_beaconManager_rpcInterface_init(&bmIn->bmri, bmIn, rpcNodeIn);
+	memset(&bmIn->bmri, 0, sizeof(bmIn->bmri));
+	if( rpcNodeIn ) ovr_beaconManager_rpcInterface_init(&bmIn->bmri, bmIn, rpcNodeIn, btleThreadIdIn, rpcThreadIdIn);
 
 	// add ourselves to the runloop
-	cxa_runLoop_addEntry(OVR_GW_THREADID_BLUETOOTH, cb_onRunLoopUpdate, (void*)bmIn);
+	cxa_runLoop_addEntry(btleThreadIdIn, cb_onRunLoopUpdate, (void*)bmIn);
+}
+
+
+ovr_beaconManager_capacities_t ovr_beaconManager_getCapacities(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	return bmIn->capacities;
+}
+
+
+bool ovr_beaconManager_saveCapacities(ovr_beaconManager_t *const bmIn, ovr_beaconManager_capacities_t capacitiesIn)
+{
+	cxa_assert(bmIn);
+
+	if( !areCapacitiesValid(&capacitiesIn) ) return false;
+
+	if( !cxa_nvsManager_set_uint32(NVS_KEY_CAP_MAXNUMBEACONS, capacitiesIn.maxNumBeacons) ) return false;
+	if( !cxa_nvsManager_set_uint32(NVS_KEY_CAP_RXFIFOSIZE, capacitiesIn.rxFifoSize_elems) ) return false;
+	if( !cxa_nvsManager_set_uint32(NVS_KEY_CAP_MAXNUMLISTENERS, capacitiesIn.maxNumListeners) ) return false;
+	if( !cxa_nvsManager_commit() ) return false;
+
+	cxa_logger_info(&bmIn->logger, "saved capacities (beacons: %d  rxFifo: %d  listeners: %d)...takes effect on reboot",
+					capacitiesIn.maxNumBeacons, capacitiesIn.rxFifoSize_elems, capacitiesIn.maxNumListeners);
+	return true;
+}
+
+
+ovr_memArena_t* ovr_beaconManager_getMemArena(ovr_beaconManager_t *const bmIn, ovr_beaconManager_memTier_t tierIn)
+{
+	cxa_assert(bmIn);
+
+	return (tierIn == OVR_BEACONMANAGER_MEMTIER_COLD) ? &bmIn->memArena_cold : &bmIn->memArena_hot;
 }
 
 
@@ -116,6 +232,38 @@ cxa_array_t* ovr_beaconManager_getKnownBeacons(ovr_beaconManager_t *const bmIn)
 }
 
 
+bool ovr_beaconManager_holdKnownBeacons(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	cxa_criticalSection_enter();
+	bool retVal = !bmIn->isTableChanging;
+	if( retVal ) bmIn->numTableHolds++;
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+void ovr_beaconManager_releaseKnownBeacons(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	cxa_criticalSection_enter();
+	cxa_assert(bmIn->numTableHolds > 0);
+	bmIn->numTableHolds--;
+	cxa_criticalSection_exit();
+}
+
+
+ovr_beaconFilter_t* ovr_beaconManager_getFilter(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	return &bmIn->filter;
+}
+
+
 bool ovr_beaconManager_isRadioReady(ovr_beaconManager_t *const bmIn)
 {
 	cxa_assert(bmIn);
@@ -124,40 +272,231 @@ bool ovr_beaconManager_isRadioReady(ovr_beaconManager_t *const bmIn)
 }
 
 
+void ovr_beaconManager_setEvictPolicy(ovr_beaconManager_t *const bmIn, ovr_beaconManager_evictPolicy_t policyIn)
+{
+	cxa_assert(bmIn);
+
+	bmIn->evictPolicy = policyIn;
+}
+
+
+ovr_beaconManager_admissionStats_t ovr_beaconManager_getAdmissionStats(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	return bmIn->admissionStats;
+}
+
+
+ovr_beaconManager_pipelineStats_t ovr_beaconManager_getPipelineStats(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	// counted from the btle callbacks and runloop, read from anywhere
+	ovr_beaconManager_pipelineStats_t retVal;
+	retVal.numAdvertsRx = __atomic_load_n(&bmIn->pipelineStats.numAdvertsRx, __ATOMIC_RELAXED);
+	retVal.numAdvertsAccepted = __atomic_load_n(&bmIn->pipelineStats.numAdvertsAccepted, __ATOMIC_RELAXED);
+	retVal.numAdvertsFiltered = __atomic_load_n(&bmIn->pipelineStats.numAdvertsFiltered, __ATOMIC_RELAXED);
+	retVal.numAdvertsDropped = __atomic_load_n(&bmIn->pipelineStats.numAdvertsDropped, __ATOMIC_RELAXED);
+	retVal.numUpdatesProcessed = __atomic_load_n(&bmIn->pipelineStats.numUpdatesProcessed, __ATOMIC_RELAXED);
+	retVal.queueLatency_total_us = __atomic_load_n(&bmIn->pipelineStats.queueLatency_total_us, __ATOMIC_RELAXED);
+	retVal.queueLatency_max_us = __atomic_load_n(&bmIn->pipelineStats.queueLatency_max_us, __ATOMIC_RELAXED);
+	retVal.processTime_total_us = __atomic_load_n(&bmIn->pipelineStats.processTime_total_us, __ATOMIC_RELAXED);
+	retVal.processTime_max_us = __atomic_load_n(&bmIn->pipelineStats.processTime_max_us, __ATOMIC_RELAXED);
+	return retVal;
+}
+
+
+size_t ovr_beaconManager_takeRxFifoHighWater_elems(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	return __atomic_exchange_n(&bmIn->rxFifo_highWater_elems, 0, __ATOMIC_RELAXED);
+}
+
+
+ovr_beaconManager_rpcInterface_publishStats_t ovr_beaconManager_getPublishStats(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	return ovr_beaconManager_rpcInterface_getPublishStats(&bmIn->bmri);
+}
+
+
+void ovr_beaconManager_requestCheckpoint(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	__atomic_store_n(&bmIn->isCheckpointRequested, true, __ATOMIC_RELAXED);
+}
+
+
+ovr_beaconManager_checkpointStats_t ovr_beaconManager_getCheckpointStats(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	return bmIn->checkpointStats;
+}
+
+
+void ovr_beaconManager_setAdvertListener(ovr_beaconManager_t *const bmIn, ovr_beaconManager_cb_advertListener_t cbIn, void* userVarIn)
+{
+	cxa_assert(bmIn);
+
+	bmIn->cb_onAdvert = cbIn;
+	bmIn->cb_onAdvert_userVar = userVarIn;
+}
+
+
+bool ovr_beaconManager_injectAdvert(ovr_beaconManager_t *const bmIn, int8_t rssi_dBmIn, cxa_fixedByteBuffer_t *const manBytesIn)
+{
+	cxa_assert(bmIn);
+	cxa_assert(manBytesIn);
+
+	return ingestBeaconData(bmIn, rssi_dBmIn, manBytesIn);
+}
+
+
 // ******** local function implementations ********
+static void loadCapacities(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	setDefaultCapacities(bmIn);
+
+	uint32_t maxNumBeacons_raw;
+	uint32_t rxFifoSize_raw;
+	uint32_t maxNumListeners_raw;
+	if( !cxa_nvsManager_get_uint32(NVS_KEY_CAP_MAXNUMBEACONS, &maxNumBeacons_raw) ||
+		!cxa_nvsManager_get_uint32(NVS_KEY_CAP_RXFIFOSIZE, &rxFifoSize_raw) ||
+		!cxa_nvsManager_get_uint32(NVS_KEY_CAP_MAXNUMLISTENERS, &maxNumListeners_raw) ) return;
+
+	ovr_beaconManager_capacities_t loadedCaps = {
+			.maxNumBeacons = (maxNumBeacons_raw <= UINT16_MAX) ? maxNumBeacons_raw : 0,
+			.rxFifoSize_elems = (rxFifoSize_raw <= UINT16_MAX) ? rxFifoSize_raw : 0,
+			.maxNumListeners = (maxNumListeners_raw <= UINT16_MAX) ? maxNumListeners_raw : 0
+	};
+	if( !areCapacitiesValid(&loadedCaps) )
+	{
+		cxa_logger_warn(&bmIn->logger, "ignoring invalid capacities");
+		return;
+	}
+
+	bmIn->capacities = loadedCaps;
+}
+
+
+static bool areCapacitiesValid(ovr_beaconManager_capacities_t *const capacitiesIn)
+{
+	cxa_assert(capacitiesIn);
+
+	// listeners are registered by our own modules...never go below what they need
+	return (capacitiesIn->maxNumBeacons > 0) && (capacitiesIn->maxNumBeacons <= OVR_BEACONMANAGER_MAXNUM_BEACONS_LIMIT) &&
+		   (capacitiesIn->rxFifoSize_elems > 0) && (capacitiesIn->rxFifoSize_elems <= OVR_BEACONMANAGER_MAXSIZE_RX_FIFO_LIMIT) &&
+		   (capacitiesIn->maxNumListeners >= OVR_BEACONMANAGER_MAXNUM_LISTENERS) && (capacitiesIn->maxNumListeners <= OVR_BEACONMANAGER_MAXNUM_LISTENERS_LIMIT);
+}
+
+
+static void setDefaultCapacities(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	bmIn->capacities.maxNumBeacons = OVR_BEACONMANAGER_MAXNUM_BEACONS;
+	bmIn->capacities.rxFifoSize_elems = OVR_BEACONMANAGER_MAXSIZE_RX_FIFO;
+	bmIn->capacities.maxNumListeners = OVR_BEACONMANAGER_MAXNUM_LISTENERS;
+}
+
+
+static bool allocateTables(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	ovr_beaconManager_capacities_t* caps = &bmIn->capacities;
+
+	size_t knownBeacons_size_bytes = caps->maxNumBeacons * sizeof(ovr_beaconProxy_t);
+	size_t history_size_bytes = caps->maxNumBeacons * OVR_BEACONHISTORY_SLICESIZE_BYTES;
+	size_t isSliceUsed_size_bytes = caps->maxNumBeacons * sizeof(bool);
+	size_t rssiIndex_size_bytes = caps->maxNumBeacons * sizeof(*bmIn->rssiIndex);
+	size_t rssiIndexPos_size_bytes = caps->maxNumBeacons * sizeof(*bmIn->rssiIndexPos);
+	size_t rxUpdates_size_bytes = caps->rxFifoSize_elems * sizeof(ovr_beaconUpdate_t);
+	size_t listeners_size_bytes = caps->maxNumListeners * sizeof(ovr_beaconManager_listenerEntry_t);
+	size_t presenceEntries_size_bytes = OVR_BEACONMANAGER_MAXNUM_PRESENCEENTRIES * sizeof(ovr_beaconManager_presenceEntry_t);
+
+	// history is only appended once per advert and drained in bulk so it
+	// tolerates slower (PSRAM) memory...everything else is searched per advert
+	size_t coldSize_bytes = OVR_MEMARENA_ALIGN(history_size_bytes);
+	size_t hotSize_bytes = OVR_MEMARENA_ALIGN(knownBeacons_size_bytes) + OVR_MEMARENA_ALIGN(isSliceUsed_size_bytes) +
+						   OVR_MEMARENA_ALIGN(rssiIndex_size_bytes) + OVR_MEMARENA_ALIGN(rssiIndexPos_size_bytes) + OVR_MEMARENA_ALIGN(rxUpdates_size_bytes) +
+						   OVR_MEMARENA_ALIGN(listeners_size_bytes) + OVR_MEMARENA_ALIGN(presenceEntries_size_bytes);
+	if( !ovr_memArena_init(&bmIn->memArena_cold, coldSize_bytes, OVR_BEACONMANAGER_COLDARENA_REGION) ) return false;
+	if( !ovr_memArena_init(&bmIn->memArena_hot, hotSize_bytes, OVR_BEACONMANAGER_HOTARENA_REGION) )
+	{
+		ovr_memArena_deinit(&bmIn->memArena_cold);
+		return false;
+	}
+
+	// sized exactly above so these can't fail
+	uint8_t* history_raw = ovr_memArena_alloc(&bmIn->memArena_cold, history_size_bytes);
+	void* knownBeacons_raw = ovr_memArena_alloc(&bmIn->memArena_hot, knownBeacons_size_bytes);
+	bool* isSliceUsed_raw = ovr_memArena_alloc(&bmIn->memArena_hot, isSliceUsed_size_bytes);
+	bmIn->rssiIndex = ovr_memArena_alloc(&bmIn->memArena_hot, rssiIndex_size_bytes);
+	bmIn->rssiIndexPos = ovr_memArena_alloc(&bmIn->memArena_hot, rssiIndexPos_size_bytes);
+	void* rxUpdates_raw = ovr_memArena_alloc(&bmIn->memArena_hot, rxUpdates_size_bytes);
+	void* listeners_raw = ovr_memArena_alloc(&bmIn->memArena_hot, listeners_size_bytes);
+	void* presenceEntries_raw = ovr_memArena_alloc(&bmIn->memArena_hot, presenceEntries_size_bytes);
+	cxa_assert(knownBeacons_raw && history_raw && isSliceUsed_raw && bmIn->rssiIndex && bmIn->rssiIndexPos && rxUpdates_raw && listeners_raw && presenceEntries_raw);
+
+	cxa_array_init(&bmIn->knownBeacons, sizeof(ovr_beaconProxy_t), knownBeacons_raw, knownBeacons_size_bytes);
+	ovr_beaconHistory_arena_init(&bmIn->historyArena, history_raw, isSliceUsed_raw, caps->maxNumBeacons);
+	cxa_fixedFifo_init(&bmIn->rxUpdates, CXA_FF_ON_FULL_DROP, sizeof(ovr_beaconUpdate_t), rxUpdates_raw, rxUpdates_size_bytes);
+	cxa_array_init(&bmIn->listeners, sizeof(ovr_beaconManager_listenerEntry_t), listeners_raw, listeners_size_bytes);
+	cxa_array_init(&bmIn->presenceEntries, sizeof(ovr_beaconManager_presenceEntry_t), presenceEntries_raw, presenceEntries_size_bytes);
+
+	return true;
+}
+
+
 static void processRxUpdateFifo(ovr_beaconManager_t *const bmIn)
 {
 	cxa_assert(bmIn);
 
+	uint32_t startTime_us = cxa_timeBase_getCount_us();
+
 	ovr_beaconUpdate_t* updates = NULL;
 	size_t numUpdates = cxa_fixedFifo_bulkDequeue_peek(&bmIn->rxUpdates, (void**)&updates);
+	if( numUpdates == 0 ) return;
 	for( size_t i = 0; i < numUpdates; i++ )
 	{
 		ovr_beaconUpdate_t* currUpdate = &updates[i];
 
+		uint32_t queueLatency_us = startTime_us - currUpdate->rxTime_us;
+		__atomic_fetch_add(&bmIn->pipelineStats.queueLatency_total_us, queueLatency_us, __ATOMIC_RELAXED);
+		if( queueLatency_us > __atomic_load_n(&bmIn->pipelineStats.queueLatency_max_us, __ATOMIC_RELAXED) )
+		{
+			__atomic_store_n(&bmIn->pipelineStats.queueLatency_max_us, queueLatency_us, __ATOMIC_RELAXED);
+		}
+		__atomic_fetch_add(&bmIn->pipelineStats.numUpdatesProcessed, 1, __ATOMIC_RELAXED);
+
 		// search for this proxy in our known proxy list
 		bool isKnownProxy = false;
 		cxa_array_iterate(&bmIn->knownBeacons, currProxy, ovr_beaconProxy_t)
 		{
 			if( currProxy == NULL ) continue;
 
-			cxa_eui48_string_t uuid_str_proxy, uuid_str_update;
-			cxa_eui48_toString(ovr_beaconProxy_getEui48(currProxy), &uuid_str_proxy);
-			cxa_eui48_toString(ovr_beaconUpdate_getEui48(currUpdate), &uuid_str_update);
-
 			if( cxa_eui48_isEqual(ovr_beaconProxy_getEui48(currProxy), ovr_beaconUpdate_getEui48(currUpdate)) )
 			{
 				isKnownProxy = true;
 				ovr_beaconProxy_update(currProxy, currUpdate);
+				rssiIndex_update(bmIn, getProxyIndex(bmIn, currProxy));
 
-				cxa_eui48_string_t uuid_str;
-				cxa_eui48_toShortString(ovr_beaconProxy_getEui48(currProxy), &uuid_str);
-				cxa_logger_debug(&bmIn->logger, "updated '%s'  rssi: %d  ds: 0x%02X  as: 0x%02X  t: %.1f  b:%d%% (%.02fV)  l: %d",
-						uuid_str.str, currUpdate->rssi_dBm,
+				// deferred...formatting every advert here starves the btle thread
+				ovr_binLog_debug(BEACONUPDATED,
+						OVR_BINLOG_EUI48_ARGS(ovr_beaconProxy_getEui48(currProxy)),
+						(uint32_t)currUpdate->rssi_dBm,
 						ovr_beaconUpdate_getStatusByte(currUpdate),
-						ovr_beaconUpdate_getAccelStatus(currUpdate),
-						CXA_TEMPSENSE_CTOF(ovr_beaconUpdate_getTemp_c(currUpdate)),
-						currUpdate->batt_pcnt100, (float)currUpdate->batt_mv/1000.0,
+						ovr_beaconUpdate_getAccelStatusByte(currUpdate),
+						currUpdate->currTemp_deciDegC,
+						currUpdate->batt_pcnt100, currUpdate->batt_mv,
 						currUpdate->light_255);
 
 				// notify our listeners
@@ -168,28 +507,75 @@ static void processRxUpdateFifo(ovr_beaconManager_t *const bmIn)
 		}
 		if( isKnownProxy ) continue;
 
-		// if we made it here, we have a new proxy...allocate directly in the array
-		// so we can maintain the pointer for the listener
-		ovr_beaconProxy_t* proxyInArray = (ovr_beaconProxy_t*)cxa_array_append_empty(&bmIn->knownBeacons);
-		if( proxyInArray == NULL )
+		// another thread is walking the table...this one gets another chance on its next advert
+		if( !beginTableChange(bmIn) )
 		{
-			cxa_logger_warn(&bmIn->logger, "too many beacons in range...dropping");
-			return;
+			bmIn->admissionStats.numDeferred++;
+			continue;
 		}
-		if( !ovr_beaconProxy_init(proxyInArray, currUpdate) )
+		admitProxy(bmIn, currUpdate);
+		endTableChange(bmIn);
+	}
+	cxa_fixedFifo_bulkDequeue(&bmIn->rxUpdates, numUpdates);
+
+	uint32_t processTime_us = cxa_timeBase_getCount_us() - startTime_us;
+	__atomic_fetch_add(&bmIn->pipelineStats.processTime_total_us, processTime_us, __ATOMIC_RELAXED);
+	if( processTime_us > __atomic_load_n(&bmIn->pipelineStats.processTime_max_us, __ATOMIC_RELAXED) )
+	{
+		__atomic_store_n(&bmIn->pipelineStats.processTime_max_us, processTime_us, __ATOMIC_RELAXED);
+	}
+}
+
+
+static void admitProxy(ovr_beaconManager_t *const bmIn, ovr_beaconUpdate_t *const updateIn)
+{
+	cxa_assert(bmIn);
+	cxa_assert(updateIn);
+
+	// one stray advert isn't enough to call a beacon found
+	ovr_beaconProxy_cadence_t learnedCadence;
+	if( !presence_onAdvert(bmIn, updateIn, &learnedCadence) ) return;
+
+	// if we made it here, we have a new proxy...make room if we need to
+	if( cxa_array_getSize_elems(&bmIn->knownBeacons) >= cxa_array_getMaxSize_elems(&bmIn->knownBeacons) )
+	{
+		bmIn->admissionStats.numTableFull++;
+
+		ovr_beaconProxy_t* evictedProxy = getEvictionCandidate(bmIn, updateIn);
+		if( evictedProxy == NULL )
 		{
-			cxa_array_remove(&bmIn->knownBeacons, proxyInArray);
+			bmIn->admissionStats.numRejected++;
+			cxa_logger_warn(&bmIn->logger, "too many beacons in range...dropping");
 			return;
 		}
 
 		cxa_eui48_string_t uuid_str;
-		cxa_eui48_toString(ovr_beaconProxy_getEui48(proxyInArray), &uuid_str);
-		cxa_logger_debug(&bmIn->logger, "new proxy '%s'", uuid_str.str);
+		cxa_eui48_toString(ovr_beaconProxy_getEui48(evictedProxy), &uuid_str);
+		cxa_logger_debug(&bmIn->logger, "evicting proxy '%s'", uuid_str.str);
 
-		// notify our listeners
-		notifyListeners_onFound(bmIn, proxyInArray);
+		bmIn->admissionStats.numEvictions++;
+		removeProxy(bmIn, evictedProxy);
 	}
-	cxa_fixedFifo_bulkDequeue(&bmIn->rxUpdates, numUpdates);
+
+	// allocate directly in the array so we can maintain the pointer for the listener
+	ovr_beaconProxy_t* proxyInArray = (ovr_beaconProxy_t*)cxa_array_append_empty(&bmIn->knownBeacons);
+	if( proxyInArray == NULL ) return;
+	if( !ovr_beaconProxy_init(proxyInArray, updateIn, &bmIn->historyArena) )
+	{
+		ovr_beaconProxy_deinit(proxyInArray);
+		cxa_array_remove(&bmIn->knownBeacons, proxyInArray);
+		return;
+	}
+	ovr_beaconProxy_setCadence(proxyInArray, &learnedCadence);
+	rssiIndex_insert(bmIn, getProxyIndex(bmIn, proxyInArray));
+
+	cxa_eui48_string_t uuid_str;
+	cxa_eui48_toString(ovr_beaconProxy_getEui48(proxyInArray), &uuid_str);
+	cxa_logger_debug(&bmIn->logger, "new proxy '%s'", uuid_str.str);
+	bmIn->isCheckpointDirty = true;
+
+	// notify our listeners
+	notifyListeners_onFound(bmIn, proxyInArray);
 }
 
 
@@ -197,36 +583,411 @@ static void pruneLostProxies(ovr_beaconManager_t *const bmIn)
 {
 	cxa_assert(bmIn);
 
-	// can't remove whilst iterating...so setup a temporary array
-	cxa_array_t timedOutProxies;
-	ovr_beaconProxy_t* timedOutProxies_raw[cxa_array_getMaxSize_elems(&bmIn->knownBeacons)];
-	cxa_array_initStd(&timedOutProxies, timedOutProxies_raw);
+	// iterate through our beacons and see if we've "lost" any...back to front since
+	// removal shifts every proxy after the removed one (and the table may be too large
+	// to collect them on the stack first)
+	bool isChanging = false;
+	for( size_t i = cxa_array_getSize_elems(&bmIn->knownBeacons); i > 0; i-- )
+	{
+		ovr_beaconProxy_t* currProxy = (ovr_beaconProxy_t*)cxa_array_get(&bmIn->knownBeacons, i-1);
+		if( (currProxy == NULL) || !ovr_beaconProxy_hasTimedOut(currProxy) ) continue;
+
+		// another thread is walking the table...we'll catch them on the next pass
+		if( !isChanging && !beginTableChange(bmIn) ) return;
+		isChanging = true;
+
+		cxa_eui48_string_t uuid_str;
+		cxa_eui48_toString(ovr_beaconProxy_getEui48(currProxy), &uuid_str);
+		cxa_logger_debug(&bmIn->logger, "lost proxy '%s'  timeout: %d ms", uuid_str.str, ovr_beaconProxy_getLostTimeout_ms(currProxy));
 
-	// iterate through our beacons and see if we've "lost" any
-	cxa_array_iterate(&bmIn->knownBeacons, currProxy, ovr_beaconProxy_t)
+		removeProxy(bmIn, currProxy);
+	}
+	if( isChanging ) endTableChange(bmIn);
+}
+
+
+static void removeProxy(ovr_beaconManager_t *const bmIn, ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(bmIn);
+	cxa_assert(beaconProxyIn);
+
+	// gotta notify before they're actually removed...otherwise
+	// the memory in the array will be freed
+	notifyListeners_onLost(bmIn, beaconProxyIn);
+	presence_remember(bmIn, beaconProxyIn);
+
+	rssiIndex_remove(bmIn, getProxyIndex(bmIn, beaconProxyIn));
+	ovr_beaconProxy_deinit(beaconProxyIn);
+	cxa_array_remove(&bmIn->knownBeacons, beaconProxyIn);
+	bmIn->isCheckpointDirty = true;
+}
+
+
+static bool beginTableChange(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	cxa_criticalSection_enter();
+	bool retVal = (bmIn->numTableHolds == 0);
+	if( retVal ) bmIn->isTableChanging = true;
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+static void endTableChange(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	cxa_criticalSection_enter();
+	bmIn->isTableChanging = false;
+	cxa_criticalSection_exit();
+}
+
+
+static bool presence_onAdvert(ovr_beaconManager_t *const bmIn, ovr_beaconUpdate_t *const updateIn, ovr_beaconProxy_cadence_t *const cadenceOut)
+{
+	cxa_assert(bmIn);
+	cxa_assert(updateIn);
+	cxa_assert(cadenceOut);
+
+	ovr_beaconManager_presenceEntry_t* entry = presence_getEntry(bmIn, ovr_beaconUpdate_getEui48(updateIn), updateIn->rxTime_us);
+
+	// adverts only count towards being found if they're no further apart than we'd allow before losing it
+	if( entry->numAdverts > 0 )
+	{
+		uint32_t interval_ms = (updateIn->rxTime_us - entry->lastRx_us) / 1000;
+		if( interval_ms > ovr_beaconProxy_cadence_getLostTimeout_ms(&entry->cadence) ) entry->numAdverts = 0;
+		else ovr_beaconProxy_cadence_addInterval(&entry->cadence, interval_ms);
+	}
+	entry->numAdverts++;
+	entry->lastRx_us = updateIn->rxTime_us;
+	if( entry->numAdverts < OVR_BEACONMANAGER_FOUND_NUMADVERTS ) return false;
+
+	// found...the proxy takes it from here
+	*cadenceOut = entry->cadence;
+	cxa_array_remove(&bmIn->presenceEntries, entry);
+	return true;
+}
+
+
+static void presence_remember(ovr_beaconManager_t *const bmIn, ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(bmIn);
+	cxa_assert(beaconProxyIn);
+
+	// if it comes back it shouldn't have to re-learn its cadence
+	ovr_beaconManager_presenceEntry_t* entry = presence_getEntry(bmIn, ovr_beaconProxy_getEui48(beaconProxyIn), cxa_timeBase_getCount_us());
+	entry->numAdverts = 0;
+	entry->cadence = ovr_beaconProxy_getCadence(beaconProxyIn);
+}
+
+
+static ovr_beaconManager_presenceEntry_t* presence_getEntry(ovr_beaconManager_t *const bmIn, cxa_eui48_t *const eui48In, uint32_t now_usIn)
+{
+	cxa_assert(bmIn);
+	cxa_assert(eui48In);
+
+	ovr_beaconManager_presenceEntry_t* oldestEntry = NULL;
+	cxa_array_iterate(&bmIn->presenceEntries, currEntry, ovr_beaconManager_presenceEntry_t)
+	{
+		if( currEntry == NULL ) continue;
+		if( cxa_eui48_isEqual(&currEntry->eui48, eui48In) ) return currEntry;
+
+		if( (oldestEntry == NULL) || ((now_usIn - currEntry->lastRx_us) > (now_usIn - oldestEntry->lastRx_us)) ) oldestEntry = currEntry;
+	}
+
+	// make room by forgetting whoever we heard from longest ago
+	if( (cxa_array_getSize_elems(&bmIn->presenceEntries) >= cxa_array_getMaxSize_elems(&bmIn->presenceEntries)) && (oldestEntry != NULL) )
+	{
+		cxa_array_remove(&bmIn->presenceEntries, oldestEntry);
+	}
+
+	ovr_beaconManager_presenceEntry_t* newEntry = (ovr_beaconManager_presenceEntry_t*)cxa_array_append_empty(&bmIn->presenceEntries);
+	cxa_assert(newEntry);
+	memset(newEntry, 0, sizeof(*newEntry));
+	newEntry->eui48 = *eui48In;
+	newEntry->lastRx_us = now_usIn;
+
+	return newEntry;
+}
+
+
+static void restoreCheckpoint(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	uint32_t version;
+	uint32_t numEntries;
+	if( !cxa_nvsManager_get_uint32(NVS_KEY_CKPT_VERSION, &version) ||
+		!cxa_nvsManager_get_uint32(NVS_KEY_CKPT_NUMENTRIES, &numEntries) ) return;
+	if( version != CHECKPOINT_VERSION )
 	{
-		if( currProxy == NULL ) continue;
+		cxa_logger_info(&bmIn->logger, "ignoring checkpoint v%d", (int)version);
+		return;
+	}
 
-		if( ovr_beaconProxy_hasTimedOut(currProxy) )
+	for( size_t i = 0; i < numEntries; i += OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK )
+	{
+		size_t numChunkEntries = numEntries - i;
+		if( numChunkEntries > OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK ) numChunkEntries = OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK;
+
+		char key[NVS_KEY_MAXLEN];
+		uint8_t chunkIndex = i / OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK;
+		snprintf(key, sizeof(key), NVS_KEY_CKPT_ENTRIES_FMT, chunkIndex);
+		key[sizeof(key)-1] = 0;
+
+		uint8_t chunk[OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK * OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES];
+		size_t actualSize_bytes = 0;
+		if( !cxa_nvsManager_get_blob(key, chunk, numChunkEntries * OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES, &actualSize_bytes) ||
+			(actualSize_bytes != (numChunkEntries * OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES)) )
 		{
-			cxa_eui48_string_t uuid_str;
-			cxa_eui48_toString(ovr_beaconProxy_getEui48(currProxy), &uuid_str);
-			cxa_logger_debug(&bmIn->logger, "lost proxy '%s'", uuid_str.str);
+			cxa_logger_warn(&bmIn->logger, "checkpoint truncated");
+			break;
+		}
 
-			cxa_array_append(&timedOutProxies, &currProxy);
+		for( size_t j = 0; j < numChunkEntries; j++ )
+		{
+			// the table may have been made smaller since the checkpoint
+			ovr_beaconProxy_t* proxyInArray = (ovr_beaconProxy_t*)cxa_array_append_empty(&bmIn->knownBeacons);
+			if( proxyInArray == NULL ) break;
+
+			// ...or the filter changed
+			if( !ovr_beaconProxy_initFromCheckpoint(proxyInArray, &chunk[j * OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES],
+													OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES, &bmIn->historyArena) ||
+				!ovr_beaconFilter_isAccepted(&bmIn->filter, ovr_beaconProxy_getEui48(proxyInArray)) )
+			{
+				ovr_beaconProxy_deinit(proxyInArray);
+				cxa_array_remove(&bmIn->knownBeacons, proxyInArray);
+				continue;
+			}
+			rssiIndex_insert(bmIn, getProxyIndex(bmIn, proxyInArray));
+			bmIn->checkpointStats.numRestored++;
 		}
 	}
 
-	// now do the actual removal
-	cxa_array_iterate(&timedOutProxies, currProxyPtr, ovr_beaconProxy_t*)
+	// the stored checkpoint is now stale...replace it soon
+	bmIn->isCheckpointDirty = true;
+
+	cxa_logger_info(&bmIn->logger, "restored %d of %d beacons", (int)bmIn->checkpointStats.numRestored, (int)numEntries);
+}
+
+
+static void checkpointIfNeeded(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	bool isRequested = __atomic_exchange_n(&bmIn->isCheckpointRequested, false, __ATOMIC_RELAXED);
+	bool isDue = cxa_timeDiff_isElapsed_ms(&bmIn->td_checkpoint, OVR_BEACONMANAGER_CHECKPOINT_PERIOD_MS) ||
+				 (bmIn->isCheckpointDirty && cxa_timeDiff_isElapsed_ms(&bmIn->td_checkpoint, OVR_BEACONMANAGER_CHECKPOINT_MINPERIOD_MS));
+	if( !isRequested && !isDue ) return;
+
+	// on failure we wait a full period before trying again
+	if( writeCheckpoint(bmIn) ) bmIn->isCheckpointDirty = false;
+	cxa_timeDiff_setStartTime_now(&bmIn->td_checkpoint);
+}
+
+
+static bool writeCheckpoint(ovr_beaconManager_t *const bmIn)
+{
+	cxa_assert(bmIn);
+
+	uint32_t startTime_us = cxa_timeBase_getCount_us();
+
+	// entries first so a count never refers to chunks that weren't written
+	size_t numEntries = cxa_array_getSize_elems(&bmIn->knownBeacons);
+	bool wasSuccessful = true;
+	for( size_t i = 0; wasSuccessful && (i < numEntries); i += OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK )
 	{
-		if( currProxyPtr == NULL ) continue;
+		size_t numChunkEntries = numEntries - i;
+		if( numChunkEntries > OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK ) numChunkEntries = OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK;
 
-		// gotta notify before they're actually removed...otherwise
-		// the memory in the array will be freed
-		notifyListeners_onLost(bmIn, *currProxyPtr);
+		uint8_t chunk[OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK * OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES];
+		for( size_t j = 0; j < numChunkEntries; j++ )
+		{
+			ovr_beaconProxy_t* currProxy = (ovr_beaconProxy_t*)cxa_array_get(&bmIn->knownBeacons, i + j);
+			cxa_assert(currProxy);
+			ovr_beaconProxy_writeCheckpoint(currProxy, &chunk[j * OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES]);
+		}
+
+		char key[NVS_KEY_MAXLEN];
+		uint8_t chunkIndex = i / OVR_BEACONMANAGER_CHECKPOINT_ENTRIESPERCHUNK;
+		snprintf(key, sizeof(key), NVS_KEY_CKPT_ENTRIES_FMT, chunkIndex);
+		key[sizeof(key)-1] = 0;
 
-		cxa_array_remove(&bmIn->knownBeacons, *currProxyPtr);
+		wasSuccessful = cxa_nvsManager_set_blob(key, chunk, numChunkEntries * OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES);
+	}
+	wasSuccessful = wasSuccessful &&
+					cxa_nvsManager_set_uint32(NVS_KEY_CKPT_VERSION, CHECKPOINT_VERSION) &&
+					cxa_nvsManager_set_uint32(NVS_KEY_CKPT_NUMENTRIES, numEntries) &&
+					cxa_nvsManager_commit();
+
+	// flash writes block the btle thread...keep an eye on how long
+	uint32_t writeTime_us = cxa_timeBase_getCount_us() - startTime_us;
+	if( !wasSuccessful )
+	{
+		bmIn->checkpointStats.numFailures++;
+		cxa_logger_warn(&bmIn->logger, "checkpoint failed");
+		return false;
+	}
+
+	bmIn->checkpointStats.numCheckpoints++;
+	bmIn->checkpointStats.lastNumEntries = numEntries;
+	bmIn->checkpointStats.lastSize_bytes = numEntries * OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES;
+	bmIn->checkpointStats.lastWriteTime_us = writeTime_us;
+	if( writeTime_us > bmIn->checkpointStats.maxWriteTime_us ) bmIn->checkpointStats.maxWriteTime_us = writeTime_us;
+
+	cxa_logger_debug(&bmIn->logger, "checkpointed %d beacons (%d bytes) in %d us",
+					 (int)numEntries, (int)bmIn->checkpointStats.lastSize_bytes, (int)writeTime_us);
+	return true;
+}
+
+
+static ovr_beaconProxy_t* getEvictionCandidate(ovr_beaconManager_t *const bmIn, ovr_beaconUpdate_t *const newcomerIn)
+{
+	cxa_assert(bmIn);
+	cxa_assert(newcomerIn);
+
+	if( cxa_array_getSize_elems(&bmIn->knownBeacons) == 0 ) return NULL;
+
+	switch( bmIn->evictPolicy )
+	{
+		case OVR_BEACONMANAGER_EVICTPOLICY_WEAKEST:
+		{
+			// only displace the weakest if the newcomer is clearly stronger (avoids churn)
+			int8_t weakestRssi = getRssiAtIndexPos(bmIn, 0);
+			if( ovr_beaconUpdate_getRssi(newcomerIn) < (weakestRssi + OVR_BEACONMANAGER_EVICT_MINRSSIMARGIN_DBM) ) return NULL;
+
+			return (ovr_beaconProxy_t*)cxa_array_get(&bmIn->knownBeacons, bmIn->rssiIndex[0]);
+		}
+
+		case OVR_BEACONMANAGER_EVICTPOLICY_STALEST:
+		{
+			ovr_beaconProxy_t* stalestProxy = NULL;
+			uint32_t stalestTime_ms = OVR_BEACONMANAGER_EVICT_MINSTALE_MS;
+			cxa_array_iterate(&bmIn->knownBeacons, currProxy, ovr_beaconProxy_t)
+			{
+				if( currProxy == NULL ) continue;
+
+				uint32_t currTime_ms = ovr_beaconProxy_getTimeSinceLastUpdate_ms(currProxy);
+				if( currTime_ms >= stalestTime_ms )
+				{
+					stalestProxy = currProxy;
+					stalestTime_ms = currTime_ms;
+				}
+			}
+			return stalestProxy;
+		}
+
+		case OVR_BEACONMANAGER_EVICTPOLICY_NONE:
+		default:
+			return NULL;
+	}
+}
+
+
+static uint16_t getProxyIndex(ovr_beaconManager_t *const bmIn, ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(bmIn);
+	cxa_assert(beaconProxyIn);
+
+	ovr_beaconProxy_t* firstProxy = (ovr_beaconProxy_t*)cxa_array_get(&bmIn->knownBeacons, 0);
+	cxa_assert(firstProxy);
+
+	return (uint16_t)(beaconProxyIn - firstProxy);
+}
+
+
+static int8_t getRssiAtIndexPos(ovr_beaconManager_t *const bmIn, size_t posIn)
+{
+	cxa_assert(bmIn);
+
+	ovr_beaconProxy_t* proxy = (ovr_beaconProxy_t*)cxa_array_get(&bmIn->knownBeacons, bmIn->rssiIndex[posIn]);
+	cxa_assert(proxy);
+
+	return ovr_beaconProxy_getSmoothedRssi(proxy);
+}
+
+
+static void rssiIndex_insert(ovr_beaconManager_t *const bmIn, uint16_t proxyIndexIn)
+{
+	cxa_assert(bmIn);
+
+	// proxy has already been appended to knownBeacons...
+	// place it at the end of the index then sort it into place
+	size_t lastPos = cxa_array_getSize_elems(&bmIn->knownBeacons) - 1;
+	bmIn->rssiIndex[lastPos] = proxyIndexIn;
+	bmIn->rssiIndexPos[proxyIndexIn] = lastPos;
+	rssiIndex_update(bmIn, proxyIndexIn);
+}
+
+
+static void rssiIndex_update(ovr_beaconManager_t *const bmIn, uint16_t proxyIndexIn)
+{
+	cxa_assert(bmIn);
+
+	size_t numProxies = cxa_array_getSize_elems(&bmIn->knownBeacons);
+	size_t pos = bmIn->rssiIndexPos[proxyIndexIn];
+	cxa_assert((pos < numProxies) && (bmIn->rssiIndex[pos] == proxyIndexIn));
+
+	// everyone else is still in order so we can binary search for our new spot
+	int8_t rssi = getRssiAtIndexPos(bmIn, pos);
+	size_t newPos;
+	if( (pos > 0) && (getRssiAtIndexPos(bmIn, pos-1) > rssi) )
+	{
+		// first position below us that's stronger
+		size_t lo = 0, hi = pos - 1;
+		while( lo < hi )
+		{
+			size_t mid = (lo + hi) / 2;
+			if( getRssiAtIndexPos(bmIn, mid) > rssi ) hi = mid;
+			else lo = mid + 1;
+		}
+		newPos = lo;
+		memmove(&bmIn->rssiIndex[newPos+1], &bmIn->rssiIndex[newPos], (pos - newPos) * sizeof(*bmIn->rssiIndex));
+	}
+	else if( ((pos+1) < numProxies) && (getRssiAtIndexPos(bmIn, pos+1) < rssi) )
+	{
+		// last position above us that's weaker
+		size_t lo = pos + 1, hi = numProxies - 1;
+		while( lo < hi )
+		{
+			size_t mid = (lo + hi + 1) / 2;
+			if( getRssiAtIndexPos(bmIn, mid) < rssi ) lo = mid;
+			else hi = mid - 1;
+		}
+		newPos = lo;
+		memmove(&bmIn->rssiIndex[pos], &bmIn->rssiIndex[pos+1], (newPos - pos) * sizeof(*bmIn->rssiIndex));
+	}
+	else return;
+	bmIn->rssiIndex[newPos] = proxyIndexIn;
+
+	// (smoothing keeps this span short)
+	size_t firstPos = (newPos < pos) ? newPos : pos;
+	size_t lastPos = (newPos < pos) ? pos : newPos;
+	for( size_t i = firstPos; i <= lastPos; i++ ) bmIn->rssiIndexPos[bmIn->rssiIndex[i]] = i;
+}
+
+
+static void rssiIndex_remove(ovr_beaconManager_t *const bmIn, uint16_t proxyIndexIn)
+{
+	cxa_assert(bmIn);
+
+	// proxy is still in knownBeacons at this point
+	size_t numProxies = cxa_array_getSize_elems(&bmIn->knownBeacons);
+
+	size_t writePos = 0;
+	for( size_t readPos = 0; readPos < numProxies; readPos++ )
+	{
+		uint16_t currIndex = bmIn->rssiIndex[readPos];
+		if( currIndex == proxyIndexIn ) continue;
+
+		// everything after the removed proxy will shift down by one
+		uint16_t newIndex = (currIndex > proxyIndexIn) ? (currIndex - 1) : currIndex;
+		bmIn->rssiIndex[writePos] = newIndex;
+		bmIn->rssiIndexPos[newIndex] = writePos;
+		writePos++;
 	}
 }
 
@@ -283,7 +1044,7 @@ static void cb_onRunLoopUpdate(void* userVarIn)
 
 	// make sure we're always scanning
 	if( cxa_btle_client_isReady(bmIn->btleClient) &&
-		cxa_timeDiff_isElapsed_recurring_ms(&bmIn->td_scanningCheck, SCAN_CHECK_PERIOD_MS) &&
+		cxa_timeDiff_isElapsed_recurring_ms(&bmIn->td_scanningCheck, ovr_config_get(OVR_CONFIG_ID_SCANCHECK_PERIOD_MS)) &&
 		!cxa_btle_client_isScanning(bmIn->btleClient) )
 
 	{
@@ -294,6 +1055,7 @@ static void cb_onRunLoopUpdate(void* userVarIn)
 	// do the real business
 	processRxUpdateFifo(bmIn);
 	pruneLostProxies(bmIn);
+	checkpointIfNeeded(bmIn);
 }
 
 
@@ -338,12 +1100,7 @@ static void btleCb_onAdvertRx(cxa_btle_advPacket_t* packetIn, void* userVarIn)
 //								 cxa_fixedByteBuffer_get_pointerToIndex(&beaconField->asManufacturerData.manBytes, 0),
 //								 cxa_fixedByteBuffer_getSize_bytes(&beaconField->asManufacturerData.manBytes));
 
-	// parse our information from the packet
-	ovr_beaconUpdate_t parsedUpdate;
-	if( !ovr_beaconUpdate_init(&parsedUpdate, packetIn->rssi, &beaconField->asManufacturerData.manBytes) ) return;
-
-	// send it to the runLoop for processing...
-	cxa_fixedFifo_queue(&bmIn->rxUpdates, &parsedUpdate);
+	ingestBeaconData(bmIn, packetIn->rssi, &beaconField->asManufacturerData.manBytes);
 }
 
 
@@ -363,3 +1120,48 @@ static cxa_btle_advField_t* findBeaconFieldInPacket(cxa_btle_advPacket_t* packet
 
 	return NULL;
 }
+
+
+static bool ingestBeaconData(ovr_beaconManager_t *const bmIn, int8_t rssi_dBmIn, cxa_fixedByteBuffer_t *const manBytesIn)
+{
+	cxa_assert(bmIn);
+	cxa_assert(manBytesIn);
+
+	__atomic_fetch_add(&bmIn->pipelineStats.numAdvertsRx, 1, __ATOMIC_RELAXED);
+	if( bmIn->cb_onAdvert != NULL )
+	{
+		bmIn->cb_onAdvert(rssi_dBmIn,
+						  cxa_fixedByteBuffer_get_pointerToIndex(manBytesIn, 0),
+						  cxa_fixedByteBuffer_getSize_bytes(manBytesIn),
+						  bmIn->cb_onAdvert_userVar);
+	}
+
+	// parse our information from the packet
+	ovr_beaconUpdate_t parsedUpdate;
+	if( !ovr_beaconUpdate_init(&parsedUpdate, rssi_dBmIn, manBytesIn) ) return false;
+	parsedUpdate.rxTime_us = cxa_timeBase_getCount_us();
+
+	// drop beacons we've been told to ignore before they take up any space
+	if( !ovr_beaconFilter_isAccepted(&bmIn->filter, ovr_beaconUpdate_getEui48(&parsedUpdate)) )
+	{
+		__atomic_fetch_add(&bmIn->pipelineStats.numAdvertsFiltered, 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	// send it to the runLoop for processing...
+	if( !cxa_fixedFifo_queue(&bmIn->rxUpdates, &parsedUpdate) )
+	{
+		__atomic_fetch_add(&bmIn->pipelineStats.numAdvertsDropped, 1, __ATOMIC_RELAXED);
+		return false;
+	}
+	__atomic_fetch_add(&bmIn->pipelineStats.numAdvertsAccepted, 1, __ATOMIC_RELAXED);
+
+	ovr_binLog_trace(BEACONQUEUED, OVR_BINLOG_EUI48_ARGS(ovr_beaconUpdate_getEui48(&parsedUpdate)), (uint32_t)rssi_dBmIn);
+
+	size_t fifoDepth_elems = cxa_fixedFifo_getSize_elems(&bmIn->rxUpdates);
+	if( fifoDepth_elems > __atomic_load_n(&bmIn->rxFifo_highWater_elems, __ATOMIC_RELAXED) )
+	{
+		__atomic_store_n(&bmIn->rxFifo_highWater_elems, fifoDepth_elems, __ATOMIC_RELAXED);
+	}
+	return true;
+}
@@ -17,17 +17,24 @@
 
 
 // ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
 #include <cxa_assert.h>
+#include <cxa_criticalSection.h>
+#include <cxa_nvsManager.h>
 #include <cxa_runLoop.h>
 #include <cxa_sntpClient.h>
 #include <cxa_stringUtils.h>
+#include <cxa_timeBase.h>
 #include <cxa_uniqueId.h>
 #include <cxa_uuid128.h>
 
-#include <ovr_beaconGateway.h>
 #include <ovr_beaconManager.h>
 #include <ovr_beaconProxy.h>
 #include <ovr_beaconUpdate.h>
+#include <ovr_config.h>
+#include <ovr_publishScheduler.h>
 
 
 #define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
@@ -35,9 +42,41 @@
 
 
 // ******** local macro definitions ********
-#define UPDATE_MAX_PAYLOAD_BYTES				256
-#define UPDATE_PERIOD_MS						60000
+// every notification has to fit in a single mqtt message (the scheduler
+// further trims this by the length of each topic)
+#define UPDATE_MAX_PAYLOAD_BYTES				OVR_PUBLISHSCHEDULER_MAXSIZE_PAYLOAD_BYTES
+
+#ifndef OVR_BEACONMANAGER_RPCINTERFACE_PUBLISH_ON_FREEFALL
+	#define OVR_BEACONMANAGER_RPCINTERFACE_PUBLISH_ON_FREEFALL		1
+#endif
+
+// leaves room for the topic within a single mqtt message
+#define HISTORY_MAX_PAYLOAD_BYTES				160
+#define HISTORY_MAXNUM_BATCHES_PER_UPDATE		4
+
+_Static_assert((UPDATE_MAX_PAYLOAD_BYTES + OVR_PUBLISHSCHEDULER_MESSAGE_OVERHEAD_BYTES) <= CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES, "update payloads must fit a single mqtt message");
+_Static_assert(HISTORY_MAX_PAYLOAD_BYTES <= UPDATE_MAX_PAYLOAD_BYTES, "history payloads must fit a single mqtt message");
+
+#define PRESENCE_MAXNUM_EVENTS_PER_BATCH		8
+// room left at the end of a presence batch for the closing brackets
+#define PRESENCE_TRAILER_SIZE_BYTES				2
+#define PRESENCE_EVENT_MAXSIZE_BYTES			48
+
+// getBeacons params: [cursor:4][maxNumBeacons:2][fieldMask:2][minRssi:1][seenWithin_s:2][flags:1][idPrefix:0-6]
+#define QUERY_HEADER_SIZE_BYTES					12
+#define QUERY_MAXNUM_PAGES_PER_ITERATION		4
+// room left at the end of a page for the closing members: ],"isLast":1,"nextCursor":4294967295}
+#define QUERY_TRAILER_SIZE_BYTES				37
+#define QUERY_RECORD_MAXSIZE_BYTES				80
+
+#define SETFILTER_FLAG_APPEND					(1 << 0)
+#define SETFILTER_FLAG_SAVE						(1 << 1)
+#define SETFILTER_HEADER_SIZE_BYTES				2
+#define EUI48_SIZE_BYTES						6
 
+#define NVS_KEY_REPORT_POLICY					"bmri_rptPolicy"
+#define NVS_KEY_REPORT_BUDGET					"bmri_rptBudget"
+#define NVS_KEY_REPORT_RRSHARE					"bmri_rptRrShare"
 
 
 // ******** local type definitions ********
@@ -45,15 +84,45 @@
 
 // ******** local function prototypes ********
 static void cb_onRunLoopUpdate(void* userVarIn);
+static void cb_onBtleRunLoopUpdate(void* userVarIn);
+static void publishBudgetedUpdates(ovr_beaconManager_rpcInterface_t *const bmriIn);
+static int32_t getReportScore(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn);
+static void loadReportPolicy(ovr_beaconManager_rpcInterface_t *const bmriIn);
+static size_t publish(ovr_beaconManager_rpcInterface_t *const bmriIn, char *const nameIn, ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn, void *const payloadIn, size_t payloadSize_bytesIn);
+static size_t publish_withCallback(ovr_beaconManager_rpcInterface_t *const bmriIn, char *const nameIn, ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn,
+								   void *const payloadIn, size_t payloadSize_bytesIn, ovr_publishScheduler_cb_onDone_t cbIn, void* userVarIn);
+static size_t publishBeaconUpdate(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn);
+static size_t publishAccelEvents(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconProxy_accelEvents_t *const eventsIn);
+static size_t publishHistory(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn);
+static bool appendAggregates(char *const payloadIn, size_t maxSize_bytesIn, ovr_beaconProxy_aggregates_t *const aggsIn, ovr_beaconProxy_deviceStatus_t devStatusIn);
+static int32_t getMean(ovr_beaconProxy_aggregate_t *const aggIn, uint16_t countIn);
+static bool queuePresence(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn, bool isFoundIn);
+static void publishPendingPresence(ovr_beaconManager_rpcInterface_t *const bmriIn);
+static void cb_onPresenceBatchDone(bool wasPublishedIn, void* userVarIn);
+static bool isQueryMatch(ovr_beaconManager_rpcInterface_query_t *const queryIn, ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpdate_t *const lastUpdateIn);
+static void takeSnapshot(ovr_beaconManager_rpcInterface_t *const bmriIn);
+static void publishQueryResults(ovr_beaconManager_rpcInterface_t *const bmriIn);
+static bool formatRecord(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconManager_rpcInterface_beaconRecord_t *const recordIn, bool isFirstIn,
+						 uint32_t snapshotTime_unixIn, char *const recordOut, size_t maxSize_bytesIn);
 static void beaconCb_onBeaconFound(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn);
 static void beaconCb_onBeaconLost(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn);
 
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setFilter(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getFilter(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setCapacities(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getCapacities(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setReportPolicy(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getReportPolicy(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getBeacons(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+
+
 
 // ********  local variable declarations *********
 
 
 // ******** global function implementations ********
-void ovr_beaconManager_rpcInterface_init(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconManager_t *const bmIn, cxa_mqtt_rpc_node_t *const rpcNodeIn)
+void ovr_beaconManager_rpcInterface_init(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconManager_t *const bmIn, cxa_mqtt_rpc_node_t *const rpcNodeIn,
+										 int btleThreadIdIn, int threadIdIn)
 {
 	cxa_assert(bmriIn);
 	cxa_assert(bmIn);
@@ -64,12 +133,62 @@ void ovr_beaconManager_rpcInterface_init(ovr_beaconManager_rpcInterface_t *const
 	bmriIn->rpcNode = rpcNodeIn;
 
 	cxa_timeDiff_init(&bmriIn->td_sendUpdate);
+	bmriIn->isUpdatePending = false;
+	memset(&bmriIn->publishStats, 0, sizeof(bmriIn->publishStats));
+	memset(&bmriIn->reportStats, 0, sizeof(bmriIn->reportStats));
+	bmriIn->pendingPresence_first = 0;
+	bmriIn->pendingPresence_count = 0;
+	bmriIn->numPresenceDropped = 0;
+	bmriIn->isPresenceBatchInFlight = false;
+	bmriIn->presenceBatch_numEvents = 0;
+	bmriIn->presenceBatch_numDropped = 0;
+
+	ovr_reportSelector_init(&bmriIn->reportSelector);
+	loadReportPolicy(bmriIn);
+
+	// room to snapshot the whole table (getBeacons is unavailable without it)
+	bmriIn->snapshot = NULL;
+	bmriIn->snapshot_maxNumRecords = 0;
+	bmriIn->snapshot_numRecords = 0;
+	bmriIn->snapshotId = 0;
+	bmriIn->nextQueryId = 1;
+	bmriIn->queryState = OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_IDLE;
+	size_t maxNumRecords = ovr_beaconManager_getCapacities(bmriIn->bm).maxNumBeacons;
+	size_t snapshotSize_bytes = maxNumRecords * sizeof(*bmriIn->snapshot);
+	if( ovr_memArena_init(&bmriIn->snapshotArena, snapshotSize_bytes, OVR_MEMARENA_REGION_PSRAM) )
+	{
+		bmriIn->snapshot = ovr_memArena_alloc(&bmriIn->snapshotArena, snapshotSize_bytes);
+		bmriIn->snapshot_maxNumRecords = maxNumRecords;
+		ovr_memArena_seal(&bmriIn->snapshotArena);
+	}
 
 	// register for beacon events
 	ovr_beaconManager_addListener(bmriIn->bm, beaconCb_onBeaconFound, NULL, beaconCb_onBeaconLost, (void*)bmriIn);
 
+	// register our RPC methods
+	cxa_mqtt_rpc_node_addMethod(bmriIn->rpcNode, "setFilter", rpcMethodCb_setFilter, (void*)bmriIn);
+	cxa_mqtt_rpc_node_addMethod(bmriIn->rpcNode, "getFilter", rpcMethodCb_getFilter, (void*)bmriIn);
+	cxa_mqtt_rpc_node_addMethod(bmriIn->rpcNode, "setCapacities", rpcMethodCb_setCapacities, (void*)bmriIn);
+	cxa_mqtt_rpc_node_addMethod(bmriIn->rpcNode, "getCapacities", rpcMethodCb_getCapacities, (void*)bmriIn);
+	cxa_mqtt_rpc_node_addMethod(bmriIn->rpcNode, "setReportPolicy", rpcMethodCb_setReportPolicy, (void*)bmriIn);
+	cxa_mqtt_rpc_node_addMethod(bmriIn->rpcNode, "getReportPolicy", rpcMethodCb_getReportPolicy, (void*)bmriIn);
+	cxa_mqtt_rpc_node_addMethod(bmriIn->rpcNode, "getBeacons", rpcMethodCb_getBeacons, (void*)bmriIn);
+
 	// register for runloop updates
-	cxa_runLoop_addEntry(OVR_GW_THREADID_NETWORK, cb_onRunLoopUpdate, (void*)bmriIn);
+	cxa_runLoop_addEntry(threadIdIn, cb_onRunLoopUpdate, (void*)bmriIn);
+	cxa_runLoop_addEntry(btleThreadIdIn, cb_onBtleRunLoopUpdate, (void*)bmriIn);
+}
+
+
+ovr_beaconManager_rpcInterface_publishStats_t ovr_beaconManager_rpcInterface_getPublishStats(ovr_beaconManager_rpcInterface_t *const bmriIn)
+{
+	cxa_assert(bmriIn);
+
+	ovr_beaconManager_rpcInterface_publishStats_t retVal;
+	retVal.numPublishes = __atomic_load_n(&bmriIn->publishStats.numPublishes, __ATOMIC_RELAXED);
+	retVal.numBytes = __atomic_load_n(&bmriIn->publishStats.numBytes, __ATOMIC_RELAXED);
+	retVal.numFailures = __atomic_load_n(&bmriIn->publishStats.numFailures, __ATOMIC_RELAXED);
+	return retVal;
 }
 
 
@@ -79,74 +198,717 @@ static void cb_onRunLoopUpdate(void* userVarIn)
 	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
 	cxa_assert(bmriIn);
 
-	if( cxa_sntpClient_isClockSet() && cxa_timeDiff_isElapsed_recurring_ms(&bmriIn->td_sendUpdate, UPDATE_PERIOD_MS) )
+	if( !cxa_sntpClient_isClockSet() ) return;
+
+	// anything found or lost before the clock was set goes out first
+	publishPendingPresence(bmriIn);
+
+	// on-demand queries don't wait for the next period
+	publishQueryResults(bmriIn);
+
+	if( cxa_timeDiff_isElapsed_recurring_ms(&bmriIn->td_sendUpdate, ovr_config_get(OVR_CONFIG_ID_UPDATE_PERIOD_MS)) ) bmriIn->isUpdatePending = true;
+
+#if !OVR_BEACONMANAGER_RPCINTERFACE_PUBLISH_ON_FREEFALL
+	if( !bmriIn->isUpdatePending ) return;
+#endif
+
+	// the btle thread adds and removes beacons...it holds off while we walk the table
+	// (if it's mid-change, we'll catch up on a later pass)
+	if( !ovr_beaconManager_holdKnownBeacons(bmriIn->bm) ) return;
+
+	if( bmriIn->isUpdatePending )
+	{
+		bmriIn->isUpdatePending = false;
+
+		if( !ovr_reportSelector_isUnlimited(&bmriIn->reportSelector) )
+		{
+			publishBudgetedUpdates(bmriIn);
+		}
+		else
+		{
+			// iterate over our beacons and send last-known values
+			uint32_t numBytes = 0;
+			uint16_t numReported = 0;
+			cxa_array_iterate(ovr_beaconManager_getKnownBeacons(bmriIn->bm), currBeacon, ovr_beaconProxy_t)
+			{
+				if( currBeacon == NULL ) continue;
+
+				numBytes += publishBeaconUpdate(bmriIn, currBeacon);
+				numReported++;
+			}
+			bmriIn->reportStats.numReported = numReported;
+			bmriIn->reportStats.numDeferred = 0;
+			bmriIn->reportStats.numBytes = numBytes;
+		}
+	}
+#if OVR_BEACONMANAGER_RPCINTERFACE_PUBLISH_ON_FREEFALL
+	else
 	{
-		// iterate over our beacons and send last-known values
+		// don't make the backend wait for a free fall
 		cxa_array_iterate(ovr_beaconManager_getKnownBeacons(bmriIn->bm), currBeacon, ovr_beaconProxy_t)
 		{
 			if( currBeacon == NULL ) continue;
 
-			ovr_beaconUpdate_t* lastUpdate = ovr_beaconProxy_getLastUpdate(currBeacon);
-			if( lastUpdate == NULL ) continue;
-			ovr_beaconProxy_deviceStatus_t devStatus = ovr_beaconUpdate_getDeviceStatus(lastUpdate);
+			if( ovr_beaconProxy_hasPendingAccelEvent(currBeacon, OVR_BEACONPROXY_ACCELEVENT_FREEFALL) ) publishBeaconUpdate(bmriIn, currBeacon);
+		}
+	}
+#endif
 
-			// form our notification payload string
-			char notiPayload[UPDATE_MAX_PAYLOAD_BYTES] = "{";
+	ovr_beaconManager_releaseKnownBeacons(bmriIn->bm);
+}
 
-			char* gatewayUniqueId = cxa_uniqueId_getHexString();
-			if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), "\"gatewayId\":\"%s\"", gatewayUniqueId) ) return;
 
-			if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"timestamp\":%d", cxa_sntpClient_getUnixTimeStamp()) ) return;
+static void cb_onBtleRunLoopUpdate(void* userVarIn)
+{
+	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
+	cxa_assert(bmriIn);
 
-			cxa_eui48_string_t uuid_str;
-			cxa_eui48_toString(ovr_beaconProxy_getEui48(currBeacon), &uuid_str);
-			if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"beaconId\":\"%s\"", uuid_str.str) ) return;
+	// the table is only consistent from the thread that updates it
+	if( __atomic_load_n(&bmriIn->queryState, __ATOMIC_ACQUIRE) == OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_SNAPSHOT_REQUESTED ) takeSnapshot(bmriIn);
+}
 
-			if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"rssi\":%d", ovr_beaconUpdate_getRssi(lastUpdate)) ) return;
-			if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"isCharging\":%d", ovr_beaconUpdate_getIsCharging(lastUpdate)) ) return;
 
-			if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"batt_pcnt100\":%d", ovr_beaconUpdate_getBattery_pcnt100(lastUpdate)) ) return;
-			if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"batt_v\":%0.2f", ovr_beaconUpdate_getBattery_v(lastUpdate)) ) return;
+static void publishBudgetedUpdates(ovr_beaconManager_rpcInterface_t *const bmriIn)
+{
+	cxa_assert(bmriIn);
 
-			if( devStatus.isAccelEnabled )
-			{
-				ovr_beaconProxy_accelStatus_t accelStatus = ovr_beaconProxy_checkAndResetAccelStatus(currBeacon);
-				if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"activity\":%d", accelStatus.hasOccurred_activity) ) return;
-				if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"1tap\":%d", accelStatus.hasOccurred_1tap) ) return;
-				if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"2tap\":%d", accelStatus.hasOccurred_2tap) ) return;
-				if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"freeFall\":%d", accelStatus.hasOccurred_freeFall) ) return;
-			}
+	// the caller holds the table, so the indices we select still point at
+	// the same beacons when we publish them
+	cxa_array_t* knownBeacons = ovr_beaconManager_getKnownBeacons(bmriIn->bm);
+	size_t numBeacons = cxa_array_getSize_elems(knownBeacons);
 
-			if( devStatus.isTempEnabled )
-			{
-				if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"temp_c\":%.1f", ovr_beaconUpdate_getTemp_c(lastUpdate)) ) return;
-			}
+	ovr_reportSelector_beginCycle(&bmriIn->reportSelector, numBeacons);
+	for( size_t i = 0; i < numBeacons; i++ )
+	{
+		ovr_beaconProxy_t* currBeacon = (ovr_beaconProxy_t*)cxa_array_get(knownBeacons, i);
+		if( currBeacon == NULL ) continue;
 
-			if( devStatus.isLightEnabled )
-			{
-				if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"light_255\":%d", ovr_beaconUpdate_getLight_255(lastUpdate)) ) return;
-			}
+		ovr_reportSelector_offer(&bmriIn->reportSelector, i, getReportScore(bmriIn, currBeacon));
+	}
+	size_t numIndices = ovr_reportSelector_endCycle(&bmriIn->reportSelector, bmriIn->reportIndices, OVR_REPORTSELECTOR_MAXNUM_SLOTS);
+
+	// the slot count is only an estimate...the budget is what's enforced
+	uint32_t budget_bytes = ovr_reportSelector_getBudget_bytes(&bmriIn->reportSelector);
+	uint32_t numBytes = 0;
+	uint16_t numReported = 0;
+	for( size_t i = 0; (i < numIndices) && (numBytes < budget_bytes); i++ )
+	{
+		ovr_beaconProxy_t* currBeacon = (ovr_beaconProxy_t*)cxa_array_get(knownBeacons, bmriIn->reportIndices[i]);
+		if( currBeacon == NULL ) continue;
+
+		size_t reportSize_bytes = publishBeaconUpdate(bmriIn, currBeacon);
+		if( reportSize_bytes > 0 ) ovr_reportSelector_recordReportSize(&bmriIn->reportSelector, reportSize_bytes);
+		numBytes += reportSize_bytes;
+		numReported++;
+	}
+
+	bmriIn->reportStats.numReported = numReported;
+	bmriIn->reportStats.numDeferred = numBeacons - numReported;
+	bmriIn->reportStats.numBytes = numBytes;
+}
+
+
+static int32_t getReportScore(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(bmriIn);
+	cxa_assert(beaconProxyIn);
+
+	if( ovr_reportSelector_getPolicy(&bmriIn->reportSelector) == OVR_REPORTSELECTOR_POLICY_MOSTCHANGED )
+	{
+		// spread over this window (a dB of rssi weighs the same as a tenth of a degree)
+		ovr_beaconProxy_aggregates_t aggs = ovr_beaconProxy_getAggregates(beaconProxyIn);
+		if( aggs.count == 0 ) return 0;
+
+		ovr_beaconProxy_aggregate_t* rssiAgg = &aggs.fields[OVR_BEACONPROXY_AGGFIELD_RSSI];
+		ovr_beaconProxy_aggregate_t* tempAgg = &aggs.fields[OVR_BEACONPROXY_AGGFIELD_TEMP];
+		return (rssiAgg->max - rssiAgg->min) + (tempAgg->max - tempAgg->min);
+	}
+
+	// closest first (also used to break up round-robin-only cycles, harmlessly)
+	ovr_beaconUpdate_t* lastUpdate = ovr_beaconProxy_getLastUpdate(beaconProxyIn);
+	return (lastUpdate != NULL) ? ovr_beaconUpdate_getRssi(lastUpdate) : INT8_MIN;
+}
+
+
+static void loadReportPolicy(ovr_beaconManager_rpcInterface_t *const bmriIn)
+{
+	cxa_assert(bmriIn);
+
+	uint32_t policy_raw;
+	uint32_t budget_raw;
+	uint32_t rrShare_raw;
+	if( !cxa_nvsManager_get_uint32(NVS_KEY_REPORT_POLICY, &policy_raw) ||
+		!cxa_nvsManager_get_uint32(NVS_KEY_REPORT_BUDGET, &budget_raw) ||
+		!cxa_nvsManager_get_uint32(NVS_KEY_REPORT_RRSHARE, &rrShare_raw) ) return;
+
+	// an invalid policy leaves us unlimited
+	if( rrShare_raw > UINT8_MAX ) return;
+	ovr_reportSelector_setPolicy(&bmriIn->reportSelector, (ovr_reportSelector_policy_t)policy_raw, budget_raw, rrShare_raw);
+}
+
+
+static size_t publish(ovr_beaconManager_rpcInterface_t *const bmriIn, char *const nameIn, ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn, void *const payloadIn, size_t payloadSize_bytesIn)
+{
+	return publish_withCallback(bmriIn, nameIn, classIn, coalesceKeyIn, payloadIn, payloadSize_bytesIn, NULL, NULL);
+}
+
+
+static size_t publish_withCallback(ovr_beaconManager_rpcInterface_t *const bmriIn, char *const nameIn, ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn,
+								   void *const payloadIn, size_t payloadSize_bytesIn, ovr_publishScheduler_cb_onDone_t cbIn, void* userVarIn)
+{
+	cxa_assert(bmriIn);
+
+	// we publish from both the btle and network threads (the scheduler takes a copy)
+	if( ovr_publishScheduler_publish_withCallback(bmriIn->rpcNode, nameIn, classIn, coalesceKeyIn, payloadIn, payloadSize_bytesIn, cbIn, userVarIn) )
+	{
+		__atomic_fetch_add(&bmriIn->publishStats.numPublishes, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&bmriIn->publishStats.numBytes, payloadSize_bytesIn, __ATOMIC_RELAXED);
+		return payloadSize_bytesIn;
+	}
+
+	__atomic_fetch_add(&bmriIn->publishStats.numFailures, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+
+static size_t publishBeaconUpdate(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(bmriIn);
+	cxa_assert(beaconProxyIn);
 
-			if( !cxa_stringUtils_concat(notiPayload, "}", sizeof(notiPayload))  )return;
+	ovr_beaconUpdate_t* lastUpdate = ovr_beaconProxy_getLastUpdate(beaconProxyIn);
+	if( lastUpdate == NULL ) return 0;
+	ovr_beaconProxy_deviceStatus_t devStatus = ovr_beaconUpdate_getDeviceStatus(lastUpdate);
+
+	// form our notification payload string (the topic already carries our gatewayId)
+	char notiPayload[UPDATE_MAX_PAYLOAD_BYTES] = "{";
+
+	if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), "\"timestamp\":%d", cxa_sntpClient_getUnixTimeStamp()) ) return 0;
+
+	cxa_eui48_string_t uuid_str;
+	cxa_eui48_toString(ovr_beaconProxy_getEui48(beaconProxyIn), &uuid_str);
+	if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"beaconId\":\"%s\"", uuid_str.str) ) return 0;
+
+	if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"rssi\":%d", ovr_beaconUpdate_getRssi(lastUpdate)) ) return 0;
+	if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"isCharging\":%d", ovr_beaconUpdate_getIsCharging(lastUpdate)) ) return 0;
+	if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"batt_pcnt100\":%d", ovr_beaconUpdate_getBattery_pcnt100(lastUpdate)) ) return 0;
 
-			cxa_mqtt_rpc_node_publishNotification(bmriIn->rpcNode, "onBeaconUpdate", CXA_MQTT_QOS_ATMOST_ONCE, notiPayload, strlen(notiPayload));
+	// always consume our events and window (even if we don't report them)
+	ovr_beaconProxy_accelEvents_t accelEvents = ovr_beaconProxy_checkAndResetAccelEvents(beaconProxyIn);
+	ovr_beaconProxy_aggregates_t aggregates = ovr_beaconProxy_takeAggregates(beaconProxyIn);
+	if( devStatus.isAccelEnabled )
+	{
+		// bit per ovr_beaconProxy_accelEventType_t: activity, 1tap, 2tap, freeFall
+		unsigned int accelFlags = 0;
+		for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
+		{
+			if( accelEvents.events[i].hasOccurred ) accelFlags |= (1 << i);
 		}
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"accel\":%u", accelFlags) ) return 0;
+	}
+
+	if( devStatus.isTempEnabled )
+	{
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"temp_c\":%.1f", ovr_beaconUpdate_getTemp_c(lastUpdate)) ) return 0;
 	}
+
+	if( devStatus.isLightEnabled )
+	{
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"light_255\":%d", ovr_beaconUpdate_getLight_255(lastUpdate)) ) return 0;
+	}
+
+	// nothing heard this window...the last-known values above say it all
+	if( aggregates.count > 0 )
+	{
+		if( !appendAggregates(notiPayload, sizeof(notiPayload), &aggregates, devStatus) ) return 0;
+	}
+
+	if( !cxa_stringUtils_concat(notiPayload, "}", sizeof(notiPayload))  )return 0;
+
+	// a newer update for this beacon may replace one still waiting to go out, but only if
+	// it doesn't carry a window or an accelerometer event (which would then be lost)
+	bool hasAccelEvent = false;
+	for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
+	{
+		if( accelEvents.events[i].hasOccurred || (accelEvents.events[i].count > 0) ) hasAccelEvent = true;
+	}
+	uint64_t coalesceKey = (hasAccelEvent || (aggregates.count > 0)) ? OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE : ovr_publishScheduler_getCoalesceKey(ovr_beaconProxy_getEui48(beaconProxyIn));
+	size_t numBytesPublished = publish(bmriIn, "onBeaconUpdate", OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, coalesceKey, notiPayload, strlen(notiPayload));
+
+	// the window's accelerometer counts and timing don't fit in the update itself
+	if( devStatus.isAccelEnabled ) numBytesPublished += publishAccelEvents(bmriIn, beaconProxyIn, &accelEvents);
+
+	// follow up with every sample received since our last update
+	numBytesPublished += publishHistory(bmriIn, beaconProxyIn);
+
+	return numBytesPublished;
 }
 
 
-static void beaconCb_onBeaconFound(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn)
+static size_t publishAccelEvents(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconProxy_accelEvents_t *const eventsIn)
+{
+	cxa_assert(bmriIn);
+	cxa_assert(beaconProxyIn);
+	cxa_assert(eventsIn);
+
+	static const char* eventNames[OVR_BEACONPROXY_NUM_ACCELEVENTS] = { "activity", "1tap", "2tap", "freeFall" };
+
+	bool hasAnyEvents = false;
+	for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
+	{
+		if( eventsIn->events[i].count > 0 ) hasAnyEvents = true;
+	}
+	if( !hasAnyEvents ) return 0;
+
+	uint32_t timestamp = cxa_sntpClient_getUnixTimeStamp();
+	uint32_t now_us = cxa_timeBase_getCount_us();
+
+	char notiPayload[UPDATE_MAX_PAYLOAD_BYTES] = "{";
+
+	char* gatewayUniqueId = cxa_uniqueId_getHexString();
+	if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), "\"gatewayId\":\"%s\"", gatewayUniqueId) ) return 0;
+	if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"timestamp\":%d", timestamp) ) return 0;
+
+	cxa_eui48_string_t uuid_str;
+	cxa_eui48_toString(ovr_beaconProxy_getEui48(beaconProxyIn), &uuid_str);
+	if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"beaconId\":\"%s\"", uuid_str.str) ) return 0;
+
+	// each event: [count, seconds before timestamp of the first, seconds before timestamp of the last]
+	// (ages rather than timestamps so all four events fit in a single message)
+	for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
+	{
+		ovr_beaconProxy_accelEventStats_t* currStats = &eventsIn->events[i];
+		if( currStats->count == 0 ) continue;
+
+		uint32_t firstAge_s = (now_us - currStats->first_us) / 1000000;
+		uint32_t lastAge_s = (now_us - currStats->last_us) / 1000000;
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"%s\":[%d,%d,%d]", eventNames[i], currStats->count, firstAge_s, lastAge_s) ) return 0;
+	}
+
+	if( !cxa_stringUtils_concat(notiPayload, "}", sizeof(notiPayload))  )return 0;
+
+	return publish(bmriIn, "onBeaconAccelEvents", OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, notiPayload, strlen(notiPayload));
+}
+
+
+static size_t publishHistory(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(bmriIn);
+	cxa_assert(beaconProxyIn);
+
+	// payload: [beaconId:6][timestamp:4 LE][history batch]
+	cxa_eui48_t* beaconId = ovr_beaconProxy_getEui48(beaconProxyIn);
+	uint32_t timestamp = cxa_sntpClient_getUnixTimeStamp();
+
+	size_t numBytesPublished = 0;
+	for( size_t i = 0; i < HISTORY_MAXNUM_BATCHES_PER_UPDATE; i++ )
+	{
+		uint8_t notiPayload[HISTORY_MAX_PAYLOAD_BYTES];
+		size_t headerSize_bytes = 0;
+		memcpy(notiPayload, beaconId->bytes, EUI48_SIZE_BYTES);
+		headerSize_bytes += EUI48_SIZE_BYTES;
+		for( size_t j = 0; j < sizeof(timestamp); j++ ) notiPayload[headerSize_bytes++] = (timestamp >> (8*j)) & 0xFF;
+
+		size_t numSamples;
+		size_t batchSize_bytes = ovr_beaconProxy_drainHistory(beaconProxyIn, &notiPayload[headerSize_bytes], sizeof(notiPayload) - headerSize_bytes, &numSamples);
+		if( batchSize_bytes == 0 ) break;
+
+		numBytesPublished += publish(bmriIn, "onBeaconHistory", OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, notiPayload, headerSize_bytes + batchSize_bytes);
+	}
+
+	return numBytesPublished;
+}
+
+
+static bool appendAggregates(char *const payloadIn, size_t maxSize_bytesIn, ovr_beaconProxy_aggregates_t *const aggsIn, ovr_beaconProxy_deviceStatus_t devStatusIn)
+{
+	cxa_assert(payloadIn);
+	cxa_assert(aggsIn);
+
+	// positional to fit alongside the last-known values within a single message:
+	// [n, rssiMin, rssiMax, rssiMean, rssiMedian, battMin_mv, battMax_mv, battMean_mv,
+	//  tempMin_c10, tempMax_c10, tempMean_c10, lightMin, lightMax, lightMean]
+	// (null for a disabled sensor or without an rssi sketch)
+	ovr_beaconProxy_aggregate_t* currAgg = &aggsIn->fields[OVR_BEACONPROXY_AGGFIELD_RSSI];
+	if( !cxa_stringUtils_concat_formattedString(payloadIn, maxSize_bytesIn, ",\"agg\":[%u,%d,%d,%d",
+			aggsIn->count, currAgg->min, currAgg->max, (int)getMean(currAgg, aggsIn->count)) ) return false;
+#if OVR_BEACONPROXY_RSSISKETCH_NUMBINS > 0
+	if( !cxa_stringUtils_concat_formattedString(payloadIn, maxSize_bytesIn, ",%d", ovr_beaconProxy_getRssiQuantile(aggsIn, 50)) ) return false;
+#else
+	if( !cxa_stringUtils_concat(payloadIn, ",null", maxSize_bytesIn) ) return false;
+#endif
+
+	currAgg = &aggsIn->fields[OVR_BEACONPROXY_AGGFIELD_BATTMV];
+	if( !cxa_stringUtils_concat_formattedString(payloadIn, maxSize_bytesIn, ",%d,%d,%d",
+			currAgg->min, currAgg->max, (int)getMean(currAgg, aggsIn->count)) ) return false;
+
+	currAgg = &aggsIn->fields[OVR_BEACONPROXY_AGGFIELD_TEMP];
+	if( devStatusIn.isTempEnabled )
+	{
+		if( !cxa_stringUtils_concat_formattedString(payloadIn, maxSize_bytesIn, ",%d,%d,%d",
+				currAgg->min, currAgg->max, (int)getMean(currAgg, aggsIn->count)) ) return false;
+	}
+	else if( !cxa_stringUtils_concat(payloadIn, ",null,null,null", maxSize_bytesIn) ) return false;
+
+	currAgg = &aggsIn->fields[OVR_BEACONPROXY_AGGFIELD_LIGHT];
+	if( devStatusIn.isLightEnabled )
+	{
+		if( !cxa_stringUtils_concat_formattedString(payloadIn, maxSize_bytesIn, ",%d,%d,%d",
+				currAgg->min, currAgg->max, (int)getMean(currAgg, aggsIn->count)) ) return false;
+	}
+	else if( !cxa_stringUtils_concat(payloadIn, ",null,null,null", maxSize_bytesIn) ) return false;
+
+	return cxa_stringUtils_concat(payloadIn, "]", maxSize_bytesIn);
+}
+
+
+static int32_t getMean(ovr_beaconProxy_aggregate_t *const aggIn, uint16_t countIn)
+{
+	cxa_assert(aggIn);
+	if( countIn == 0 ) return aggIn->last;
+
+	// round half away from zero (rssi is negative)
+	int32_t halfCount = countIn / 2;
+	return (aggIn->sum >= 0) ? ((aggIn->sum + halfCount) / countIn) : ((aggIn->sum - halfCount) / countIn);
+}
+
+
+static bool queuePresence(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconProxy_t *const beaconProxyIn, bool isFoundIn)
+{
+	cxa_assert(bmriIn);
+	cxa_assert(beaconProxyIn);
+
+	bool isClockSet = cxa_sntpClient_isClockSet();
+
+	cxa_criticalSection_enter();
+
+	// once anything is queued, later events queue behind it to keep their order
+	if( isClockSet && (bmriIn->pendingPresence_count == 0) )
+	{
+		cxa_criticalSection_exit();
+		return false;
+	}
+
+	if( bmriIn->pendingPresence_count == OVR_BEACONMANAGER_RPCINTERFACE_MAXNUM_PENDING_PRESENCE )
+	{
+		bmriIn->pendingPresence_first = (bmriIn->pendingPresence_first + 1) % OVR_BEACONMANAGER_RPCINTERFACE_MAXNUM_PENDING_PRESENCE;
+		bmriIn->pendingPresence_count--;
+		bmriIn->numPresenceDropped++;
+	}
+
+	size_t index = (bmriIn->pendingPresence_first + bmriIn->pendingPresence_count) % OVR_BEACONMANAGER_RPCINTERFACE_MAXNUM_PENDING_PRESENCE;
+	ovr_beaconManager_rpcInterface_presenceEvent_t* event = &bmriIn->pendingPresence[index];
+	event->eui48 = *ovr_beaconProxy_getEui48(beaconProxyIn);
+	event->isFound = isFoundIn;
+	event->time_us = cxa_timeBase_getCount_us();
+	bmriIn->pendingPresence_count++;
+
+	cxa_criticalSection_exit();
+	return true;
+}
+
+
+static void publishPendingPresence(ovr_beaconManager_rpcInterface_t *const bmriIn)
+{
+	cxa_assert(bmriIn);
+
+	// copy out the oldest events (more may be queued behind them meanwhile)
+	ovr_beaconManager_rpcInterface_presenceEvent_t events[PRESENCE_MAXNUM_EVENTS_PER_BATCH];
+	cxa_criticalSection_enter();
+	// one batch at a time...its events are only released once it has been published
+	if( bmriIn->isPresenceBatchInFlight )
+	{
+		cxa_criticalSection_exit();
+		return;
+	}
+	size_t numEvents = (bmriIn->pendingPresence_count < PRESENCE_MAXNUM_EVENTS_PER_BATCH) ? bmriIn->pendingPresence_count : PRESENCE_MAXNUM_EVENTS_PER_BATCH;
+	for( size_t j = 0; j < numEvents; j++ )
+	{
+		events[j] = bmriIn->pendingPresence[(bmriIn->pendingPresence_first + j) % OVR_BEACONMANAGER_RPCINTERFACE_MAXNUM_PENDING_PRESENCE];
+	}
+	uint32_t numDropped = bmriIn->numPresenceDropped;
+	cxa_criticalSection_exit();
+
+	if( numEvents == 0 ) return;
+
+	// rebase the monotonic stamps onto the wall clock
+	// (stamps older than a cxa_timeBase wrap, ~71 minutes, can't be told apart)
+	uint32_t now_us = cxa_timeBase_getCount_us();
+	uint32_t now_unix = cxa_sntpClient_getUnixTimeStamp();
+
+	// whatever is left of the message once the topic is accounted for
+	size_t maxSize_bytes = ovr_publishScheduler_getMaxPayloadSize_bytes(bmriIn->rpcNode, "onBeaconPresenceBatch");
+
+	char notiPayload[UPDATE_MAX_PAYLOAD_BYTES] = "";
+	if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), "{\"gatewayId\":\"%s\",\"numDropped\":%u,\"events\":[",
+												cxa_uniqueId_getHexString(), (unsigned)numDropped) ) return;
+
+	size_t numInBatch = 0;
+	for( ; numInBatch < numEvents; numInBatch++ )
+	{
+		cxa_eui48_string_t uuid_str;
+		cxa_eui48_toString(&events[numInBatch].eui48, &uuid_str);
+
+		char event_str[PRESENCE_EVENT_MAXSIZE_BYTES];
+		// each event: [beaconId, "found"|"lost", timestamp] (positional so a few fit in each message)
+		snprintf(event_str, sizeof(event_str), "%s[\"%s\",\"%s\",%u]",
+				 ((numInBatch > 0) ? "," : ""), uuid_str.str, (events[numInBatch].isFound ? "found" : "lost"),
+				 (unsigned)(now_unix - ((now_us - events[numInBatch].time_us) / 1000000)));
+		event_str[sizeof(event_str)-1] = 0;
+
+		if( (strlen(notiPayload) + strlen(event_str) + PRESENCE_TRAILER_SIZE_BYTES) > maxSize_bytes ) break;
+		if( !cxa_stringUtils_concat(notiPayload, event_str, sizeof(notiPayload)) ) return;
+	}
+	if( numInBatch == 0 ) return;
+	if( !cxa_stringUtils_concat(notiPayload, "]}", sizeof(notiPayload)) ) return;
+
+	cxa_criticalSection_enter();
+	bmriIn->isPresenceBatchInFlight = true;
+	bmriIn->presenceBatch_numEvents = numInBatch;
+	bmriIn->presenceBatch_numDropped = numDropped;
+	cxa_criticalSection_exit();
+
+	// refused...try again next iteration
+	if( publish_withCallback(bmriIn, "onBeaconPresenceBatch", OVR_PUBLISHSCHEDULER_CLASS_PRESENCE, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE,
+							 notiPayload, strlen(notiPayload), cb_onPresenceBatchDone, (void*)bmriIn) == 0 )
+	{
+		cxa_criticalSection_enter();
+		bmriIn->isPresenceBatchInFlight = false;
+		cxa_criticalSection_exit();
+	}
+}
+
+
+static void cb_onPresenceBatchDone(bool wasPublishedIn, void* userVarIn)
 {
 	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
 	cxa_assert(bmriIn);
 
+	cxa_criticalSection_enter();
+	if( wasPublishedIn )
+	{
+		// release what we sent...less any of it that was displaced while it was out
+		uint32_t numDisplaced = bmriIn->numPresenceDropped - bmriIn->presenceBatch_numDropped;
+		size_t numToRelease = (bmriIn->presenceBatch_numEvents > numDisplaced) ? (bmriIn->presenceBatch_numEvents - numDisplaced) : 0;
+		bmriIn->pendingPresence_first = (bmriIn->pendingPresence_first + numToRelease) % OVR_BEACONMANAGER_RPCINTERFACE_MAXNUM_PENDING_PRESENCE;
+		bmriIn->pendingPresence_count -= numToRelease;
+	}
+	// otherwise the events are still queued and go out in the next batch
+	bmriIn->isPresenceBatchInFlight = false;
+	cxa_criticalSection_exit();
+}
+
+
+static bool isQueryMatch(ovr_beaconManager_rpcInterface_query_t *const queryIn, ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpdate_t *const lastUpdateIn)
+{
+	cxa_assert(queryIn);
 	cxa_assert(beaconProxyIn);
+	cxa_assert(lastUpdateIn);
 
-	if( !cxa_sntpClient_isClockSet() ) return;
+	if( ovr_beaconUpdate_getRssi(lastUpdateIn) < queryIn->minRssi ) return false;
+
+	if( (queryIn->seenWithin_s > 0) &&
+		(ovr_beaconProxy_getTimeSinceLastUpdate_ms(beaconProxyIn) > ((uint32_t)queryIn->seenWithin_s * 1000)) ) return false;
+
+	// same byte order as setFilter entries
+	if( (queryIn->idPrefixLen_bytes > 0) &&
+		(memcmp(ovr_beaconProxy_getEui48(beaconProxyIn)->bytes, queryIn->idPrefix, queryIn->idPrefixLen_bytes) != 0) ) return false;
+
+	if( queryIn->flags & OVR_BEACONMANAGER_RPCINTERFACE_QUERYFLAG_HASEVENTS )
+	{
+		bool hasAnyEvents = false;
+		for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
+		{
+			if( ovr_beaconProxy_hasPendingAccelEvent(beaconProxyIn, (ovr_beaconProxy_accelEventType_t)i) ) hasAnyEvents = true;
+		}
+		if( !hasAnyEvents ) return false;
+	}
+
+	return true;
+}
+
+
+static void takeSnapshot(ovr_beaconManager_rpcInterface_t *const bmriIn)
+{
+	cxa_assert(bmriIn);
+
+	// copy out only what we report so the table is walked once, without
+	// holding anything up, and the pages agree with each other
+	size_t numRecords = 0;
+	cxa_array_iterate(ovr_beaconManager_getKnownBeacons(bmriIn->bm), currBeacon, ovr_beaconProxy_t)
+	{
+		if( currBeacon == NULL ) continue;
+		if( numRecords >= bmriIn->snapshot_maxNumRecords ) break;
+
+		ovr_beaconUpdate_t* lastUpdate = ovr_beaconProxy_getLastUpdate(currBeacon);
+		if( (lastUpdate == NULL) || !isQueryMatch(&bmriIn->query, currBeacon, lastUpdate) ) continue;
+
+		ovr_beaconManager_rpcInterface_beaconRecord_t* currRecord = &bmriIn->snapshot[numRecords++];
+		currRecord->eui48 = *ovr_beaconProxy_getEui48(currBeacon);
+		currRecord->rssi = ovr_beaconUpdate_getRssi(lastUpdate);
+		currRecord->batt_pcnt100 = ovr_beaconUpdate_getBattery_pcnt100(lastUpdate);
+		currRecord->batt_mv = (uint16_t)(ovr_beaconUpdate_getBattery_v(lastUpdate) * 1000.0);
+		currRecord->temp_c10 = (int16_t)(ovr_beaconUpdate_getTemp_c(lastUpdate) * 10.0);
+		currRecord->light_255 = ovr_beaconUpdate_getLight_255(lastUpdate);
+		currRecord->isCharging = ovr_beaconUpdate_getIsCharging(lastUpdate);
+		currRecord->devStatus = ovr_beaconUpdate_getDeviceStatus(lastUpdate);
+		currRecord->lastSeen_ms = ovr_beaconProxy_getTimeSinceLastUpdate_ms(currBeacon);
+
+		// peeked, not consumed...the periodic update still reports them
+		currRecord->pendingAccelEvents = 0;
+		for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
+		{
+			if( ovr_beaconProxy_hasPendingAccelEvent(currBeacon, (ovr_beaconProxy_accelEventType_t)i) ) currRecord->pendingAccelEvents |= (1 << i);
+		}
+	}
+
+	bmriIn->snapshot_numRecords = numRecords;
+	bmriIn->snapshotTime_us = cxa_timeBase_getCount_us();
+	// 0 is reserved so a cursor of 0 always means 'new snapshot'
+	if( ++bmriIn->snapshotId == 0 ) bmriIn->snapshotId = 1;
+	bmriIn->query_startIndex = 0;
+	bmriIn->query_currIndex = 0;
+
+	__atomic_store_n(&bmriIn->queryState, OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_STREAMING, __ATOMIC_RELEASE);
+}
+
+
+static void publishQueryResults(ovr_beaconManager_rpcInterface_t *const bmriIn)
+{
+	cxa_assert(bmriIn);
+
+	if( __atomic_load_n(&bmriIn->queryState, __ATOMIC_ACQUIRE) != OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_STREAMING ) return;
+
+	ovr_beaconManager_rpcInterface_query_t* query = &bmriIn->query;
+	size_t endIndex = bmriIn->snapshot_numRecords;
+	if( (query->maxNumBeacons > 0) && ((bmriIn->query_startIndex + query->maxNumBeacons) < endIndex) ) endIndex = bmriIn->query_startIndex + query->maxNumBeacons;
+
+	// rebase the snapshot's ages onto the wall clock
+	uint32_t snapshotTime_unix = cxa_sntpClient_getUnixTimeStamp() - ((cxa_timeBase_getCount_us() - bmriIn->snapshotTime_us) / 1000000);
+
+	// whatever is left of the message once the topic is accounted for
+	size_t maxSize_bytes = ovr_publishScheduler_getMaxPayloadSize_bytes(bmriIn->rpcNode, "onBeacons");
+
+	for( size_t i = 0; i < QUERY_MAXNUM_PAGES_PER_ITERATION; i++ )
+	{
+		// the topic already names the gateway
+		char notiPayload[UPDATE_MAX_PAYLOAD_BYTES] = "";
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), "{\"queryId\":%u,\"numMatches\":%u,\"offset\":%u,\"beacons\":[",
+													query->queryId, (unsigned)bmriIn->snapshot_numRecords, (unsigned)bmriIn->query_currIndex) ) return;
+
+		size_t nextIndex = bmriIn->query_currIndex;
+		for( ; nextIndex < endIndex; nextIndex++ )
+		{
+			char record_str[QUERY_RECORD_MAXSIZE_BYTES];
+			if( !formatRecord(bmriIn, &bmriIn->snapshot[nextIndex], (nextIndex == bmriIn->query_currIndex), snapshotTime_unix, record_str, sizeof(record_str)) ) return;
+
+			if( (strlen(notiPayload) + strlen(record_str) + QUERY_TRAILER_SIZE_BYTES) > maxSize_bytes ) break;
+			if( !cxa_stringUtils_concat(notiPayload, record_str, sizeof(notiPayload)) ) return;
+		}
+
+		// not even one record fits alongside our topic...we'd never get anywhere
+		if( (nextIndex == bmriIn->query_currIndex) && (nextIndex < endIndex) )
+		{
+			__atomic_store_n(&bmriIn->queryState, OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_IDLE, __ATOMIC_RELEASE);
+			return;
+		}
+
+		// the cursor picks up where this page left off (0 once every match has been sent)
+		bool isLast = (nextIndex == endIndex);
+		uint32_t nextCursor = (nextIndex < bmriIn->snapshot_numRecords) ? (((uint32_t)bmriIn->snapshotId << 16) | nextIndex) : 0;
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), "],\"isLast\":%d,\"nextCursor\":%u}", isLast, (unsigned)nextCursor) ) return;
+
+		// try again next iteration
+		if( publish(bmriIn, "onBeacons", OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, notiPayload, strlen(notiPayload)) == 0 ) return;
+
+		bmriIn->query_currIndex = nextIndex;
+		if( isLast )
+		{
+			__atomic_store_n(&bmriIn->queryState, OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_IDLE, __ATOMIC_RELEASE);
+			return;
+		}
+	}
+}
+
+
+static bool formatRecord(ovr_beaconManager_rpcInterface_t *const bmriIn, ovr_beaconManager_rpcInterface_beaconRecord_t *const recordIn, bool isFirstIn,
+						 uint32_t snapshotTime_unixIn, char *const recordOut, size_t maxSize_bytesIn)
+{
+	cxa_assert(bmriIn);
+	cxa_assert(recordIn);
+	cxa_assert(recordOut);
+
+	uint16_t fieldMask = bmriIn->query.fieldMask;
+
+	// positional so a few fit in each message: [beaconId, then each requested field in fieldMask bit order]
+	// (battery is two values, pcnt and volts...fields the beacon doesn't have are null)
+	cxa_eui48_string_t uuid_str;
+	cxa_eui48_toString(&recordIn->eui48, &uuid_str);
+	recordOut[0] = 0;
+	if( !cxa_stringUtils_concat_formattedString(recordOut, maxSize_bytesIn, "%s[\"%s\"", (isFirstIn ? "" : ","), uuid_str.str) ) return false;
+
+	if( fieldMask & OVR_BEACONMANAGER_RPCINTERFACE_FIELD_RSSI )
+	{
+		if( !cxa_stringUtils_concat_formattedString(recordOut, maxSize_bytesIn, ",%d", recordIn->rssi) ) return false;
+	}
+
+	if( fieldMask & OVR_BEACONMANAGER_RPCINTERFACE_FIELD_LASTSEEN )
+	{
+		if( !cxa_stringUtils_concat_formattedString(recordOut, maxSize_bytesIn, ",%u", (unsigned)(snapshotTime_unixIn - (recordIn->lastSeen_ms / 1000))) ) return false;
+	}
+
+	if( fieldMask & OVR_BEACONMANAGER_RPCINTERFACE_FIELD_BATTERY )
+	{
+		if( !cxa_stringUtils_concat_formattedString(recordOut, maxSize_bytesIn, ",%d,%0.2f", recordIn->batt_pcnt100, recordIn->batt_mv / 1000.0) ) return false;
+	}
+
+	if( fieldMask & OVR_BEACONMANAGER_RPCINTERFACE_FIELD_ISCHARGING )
+	{
+		if( !cxa_stringUtils_concat_formattedString(recordOut, maxSize_bytesIn, ",%d", recordIn->isCharging) ) return false;
+	}
+
+	if( fieldMask & OVR_BEACONMANAGER_RPCINTERFACE_FIELD_TEMP )
+	{
+		bool retVal = recordIn->devStatus.isTempEnabled ?
+				cxa_stringUtils_concat_formattedString(recordOut, maxSize_bytesIn, ",%.1f", recordIn->temp_c10 / 10.0) :
+				cxa_stringUtils_concat(recordOut, ",null", maxSize_bytesIn);
+		if( !retVal ) return false;
+	}
+
+	if( fieldMask & OVR_BEACONMANAGER_RPCINTERFACE_FIELD_LIGHT )
+	{
+		bool retVal = recordIn->devStatus.isLightEnabled ?
+				cxa_stringUtils_concat_formattedString(recordOut, maxSize_bytesIn, ",%d", recordIn->light_255) :
+				cxa_stringUtils_concat(recordOut, ",null", maxSize_bytesIn);
+		if( !retVal ) return false;
+	}
+
+	// events: bit per ovr_beaconProxy_accelEventType_t
+	if( fieldMask & OVR_BEACONMANAGER_RPCINTERFACE_FIELD_EVENTS )
+	{
+		bool retVal = recordIn->devStatus.isAccelEnabled ?
+				cxa_stringUtils_concat_formattedString(recordOut, maxSize_bytesIn, ",%d", recordIn->pendingAccelEvents) :
+				cxa_stringUtils_concat(recordOut, ",null", maxSize_bytesIn);
+		if( !retVal ) return false;
+	}
+
+	return cxa_stringUtils_concat(recordOut, "]", maxSize_bytesIn);
+}
+
+
+static void beaconCb_onBeaconFound(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn)
+{
+	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
+	cxa_assert(bmriIn);
+
+	cxa_assert(beaconProxyIn);
 
 	ovr_beaconUpdate_t* lastUpdate = ovr_beaconProxy_getLastUpdate(beaconProxyIn);
 	if( lastUpdate == NULL ) return;
 
+	// held until it can be given a real timestamp
+	if( queuePresence(bmriIn, beaconProxyIn, true) ) return;
+
 	// get our individual strings together
 	char* gatewayUniqueId = cxa_uniqueId_getHexString();
 
@@ -167,7 +929,7 @@ static void beaconCb_onBeaconFound(ovr_beaconProxy_t *const beaconProxyIn, void*
 	if( !cxa_stringUtils_concat(notiPayload, uuid_str.str, sizeof(notiPayload)) ) return;
 	if( !cxa_stringUtils_concat(notiPayload, "\"}", sizeof(notiPayload)) ) return;
 
-	cxa_mqtt_rpc_node_publishNotification(bmriIn->rpcNode, "onBeaconFound", CXA_MQTT_QOS_ATMOST_ONCE, notiPayload, strlen(notiPayload));
+	publish(bmriIn, "onBeaconFound", OVR_PUBLISHSCHEDULER_CLASS_PRESENCE, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, notiPayload, strlen(notiPayload));
 }
 
 
@@ -178,11 +940,12 @@ static void beaconCb_onBeaconLost(ovr_beaconProxy_t *const beaconProxyIn, void*
 
 	cxa_assert(beaconProxyIn);
 
-	if( !cxa_sntpClient_isClockSet() ) return;
-
 	ovr_beaconUpdate_t* lastUpdate = ovr_beaconProxy_getLastUpdate(beaconProxyIn);
 	if( lastUpdate == NULL ) return;
 
+	// held until it can be given a real timestamp
+	if( queuePresence(bmriIn, beaconProxyIn, false) ) return;
+
 	// get our individual strings together
 	char* gatewayUniqueId = cxa_uniqueId_getHexString();
 
@@ -203,5 +966,193 @@ static void beaconCb_onBeaconLost(ovr_beaconProxy_t *const beaconProxyIn, void*
 	if( !cxa_stringUtils_concat(notiPayload, uuid_str.str, sizeof(notiPayload)) ) return;
 	if( !cxa_stringUtils_concat(notiPayload, "\"}", sizeof(notiPayload)) ) return;
 
-	cxa_mqtt_rpc_node_publishNotification(bmriIn->rpcNode, "onBeaconLost", CXA_MQTT_QOS_ATMOST_ONCE, notiPayload, strlen(notiPayload));
+	publish(bmriIn, "onBeaconLost", OVR_PUBLISHSCHEDULER_CLASS_PRESENCE, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, notiPayload, strlen(notiPayload));
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setFilter(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
+	cxa_assert(bmriIn);
+
+	// params: [mode:1][flags:1][eui48:6]...
+	// large lists may be sent across multiple calls using the append flag
+	uint8_t mode;
+	uint8_t flags;
+	if( !cxa_linkedField_get_uint8(paramsIn, 0, mode) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint8(paramsIn, 1, flags) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( mode > OVR_BEACONFILTER_MODE_DENY ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	size_t numEntryBytes = cxa_linkedField_getSize_bytes(paramsIn) - SETFILTER_HEADER_SIZE_BYTES;
+	if( (numEntryBytes % EUI48_SIZE_BYTES) != 0 ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	uint8_t* rawEntries = (numEntryBytes > 0) ? cxa_linkedField_get_pointerToIndex(paramsIn, SETFILTER_HEADER_SIZE_BYTES) : NULL;
+
+	ovr_beaconFilter_t* filter = ovr_beaconManager_getFilter(bmriIn->bm);
+	if( !ovr_beaconFilter_setEntries(filter, (ovr_beaconFilter_mode_t)mode, rawEntries, numEntryBytes / EUI48_SIZE_BYTES, (flags & SETFILTER_FLAG_APPEND)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( (flags & SETFILTER_FLAG_SAVE) && !ovr_beaconFilter_save(filter) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getFilter(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
+	cxa_assert(bmriIn);
+
+	// response: [mode:1][numEntries:2]
+	ovr_beaconFilter_t* filter = ovr_beaconManager_getFilter(bmriIn->bm);
+	if( !cxa_linkedField_append_uint8(responseParamsIn, (uint8_t)ovr_beaconFilter_getMode(filter)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint16LE(responseParamsIn, (uint16_t)ovr_beaconFilter_getNumEntries(filter)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setCapacities(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
+	cxa_assert(bmriIn);
+
+	// params: [maxNumBeacons:2][rxFifoSize:2][maxNumListeners:2]
+	// only takes effect after a reboot
+	ovr_beaconManager_capacities_t newCaps;
+	if( !cxa_linkedField_get_uint16LE(paramsIn, 0, newCaps.maxNumBeacons) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint16LE(paramsIn, 2, newCaps.rxFifoSize_elems) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint16LE(paramsIn, 4, newCaps.maxNumListeners) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	if( !ovr_beaconManager_saveCapacities(bmriIn->bm, newCaps) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getCapacities(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
+	cxa_assert(bmriIn);
+
+	// response: [maxNumBeacons:2][rxFifoSize:2][maxNumListeners:2]
+	//			 then for the hot and cold tiers: [arenaSize:4][arenaUsed:4][isPsram:1]
+	ovr_beaconManager_capacities_t caps = ovr_beaconManager_getCapacities(bmriIn->bm);
+	if( !cxa_linkedField_append_uint16LE(responseParamsIn, caps.maxNumBeacons) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint16LE(responseParamsIn, caps.rxFifoSize_elems) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint16LE(responseParamsIn, caps.maxNumListeners) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	ovr_beaconManager_memTier_t tiers[] = { OVR_BEACONMANAGER_MEMTIER_HOT, OVR_BEACONMANAGER_MEMTIER_COLD };
+	for( size_t i = 0; i < (sizeof(tiers)/sizeof(*tiers)); i++ )
+	{
+		ovr_memArena_t* arena = ovr_beaconManager_getMemArena(bmriIn->bm, tiers[i]);
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, (uint32_t)ovr_memArena_getSize_bytes(arena)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, (uint32_t)ovr_memArena_getUsed_bytes(arena)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint8(responseParamsIn, (ovr_memArena_getRegion(arena) == OVR_MEMARENA_REGION_PSRAM)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	}
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setReportPolicy(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
+	cxa_assert(bmriIn);
+
+	// params: [policy:1][budget_bytesPerPeriod:4][rrShare_pcnt:1]
+	// a budget of 0 reports every beacon every period
+	uint8_t policy;
+	uint32_t budget_bytes;
+	uint8_t rrShare_pcnt;
+	if( !cxa_linkedField_get_uint8(paramsIn, 0, policy) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint32LE(paramsIn, 1, budget_bytes) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint8(paramsIn, 5, rrShare_pcnt) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	if( !ovr_reportSelector_setPolicy(&bmriIn->reportSelector, (ovr_reportSelector_policy_t)policy, budget_bytes, rrShare_pcnt) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	if( !cxa_nvsManager_set_uint32(NVS_KEY_REPORT_POLICY, policy) ||
+		!cxa_nvsManager_set_uint32(NVS_KEY_REPORT_BUDGET, budget_bytes) ||
+		!cxa_nvsManager_set_uint32(NVS_KEY_REPORT_RRSHARE, rrShare_pcnt) ||
+		!cxa_nvsManager_commit() ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getReportPolicy(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
+	cxa_assert(bmriIn);
+
+	// response: [policy:1][budget_bytesPerPeriod:4][rrShare_pcnt:1]
+	//			 then for the last period: [numReported:2][numDeferred:2][numBytes:4]
+	if( !cxa_linkedField_append_uint8(responseParamsIn, ovr_reportSelector_getPolicy(&bmriIn->reportSelector)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, ovr_reportSelector_getBudget_bytes(&bmriIn->reportSelector)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint8(responseParamsIn, ovr_reportSelector_getRrShare_pcnt(&bmriIn->reportSelector)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint16LE(responseParamsIn, bmriIn->reportStats.numReported) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint16LE(responseParamsIn, bmriIn->reportStats.numDeferred) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, bmriIn->reportStats.numBytes) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getBeacons(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconManager_rpcInterface_t* bmriIn = (ovr_beaconManager_rpcInterface_t*)userVarIn;
+	cxa_assert(bmriIn);
+
+	// params: [cursor:4][maxNumBeacons:2][fieldMask:2][minRssi:1][seenWithin_s:2][flags:1][idPrefix:0-6]
+	// response: [queryId:2]...matches follow as onBeacons notifications carrying that id
+	//
+	// a cursor of 0 snapshots the table through the filters, a nextCursor from a
+	// previous page continues through that same snapshot (the filters are ignored)
+	//
+	// each onBeacons page: {"queryId", "numMatches", "offset", "beacons":[[...]...], "isLast", "nextCursor"}
+	// with as many records (see formatRecord) as fit in a single message
+	uint32_t cursor;
+	uint16_t maxNumBeacons;
+	uint16_t fieldMask;
+	uint8_t minRssi_raw;
+	uint16_t seenWithin_s;
+	uint8_t flags;
+	if( !cxa_linkedField_get_uint32LE(paramsIn, 0, cursor) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint16LE(paramsIn, 4, maxNumBeacons) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint16LE(paramsIn, 6, fieldMask) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint8(paramsIn, 8, minRssi_raw) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint16LE(paramsIn, 9, seenWithin_s) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint8(paramsIn, 11, flags) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	size_t idPrefixLen_bytes = cxa_linkedField_getSize_bytes(paramsIn) - QUERY_HEADER_SIZE_BYTES;
+	if( idPrefixLen_bytes > EUI48_SIZE_BYTES ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	if( bmriIn->snapshot == NULL ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	// one query at a time
+	if( __atomic_load_n(&bmriIn->queryState, __ATOMIC_ACQUIRE) != OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_IDLE ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	ovr_beaconManager_rpcInterface_query_t* query = &bmriIn->query;
+	if( cursor != 0 )
+	{
+		size_t startIndex = cursor & 0xFFFF;
+		if( ((cursor >> 16) != bmriIn->snapshotId) || (startIndex >= bmriIn->snapshot_numRecords) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+		bmriIn->query_startIndex = startIndex;
+		bmriIn->query_currIndex = startIndex;
+	}
+	else
+	{
+		query->minRssi = (int8_t)minRssi_raw;
+		query->seenWithin_s = seenWithin_s;
+		query->flags = flags;
+		query->idPrefixLen_bytes = idPrefixLen_bytes;
+		if( idPrefixLen_bytes > 0 ) memcpy(query->idPrefix, cxa_linkedField_get_pointerToIndex(paramsIn, QUERY_HEADER_SIZE_BYTES), idPrefixLen_bytes);
+	}
+	query->maxNumBeacons = maxNumBeacons;
+	query->fieldMask = fieldMask;
+	query->queryId = bmriIn->nextQueryId++;
+	if( bmriIn->nextQueryId == 0 ) bmriIn->nextQueryId = 1;
+
+	if( !cxa_linkedField_append_uint16LE(responseParamsIn, query->queryId) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	__atomic_store_n(&bmriIn->queryState, ((cursor != 0) ? OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_STREAMING : OVR_BEACONMANAGER_RPCINTERFACE_QUERYSTATE_SNAPSHOT_REQUESTED), __ATOMIC_RELEASE);
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
 }
@@ -22,6 +22,9 @@
 #include <cxa_assert.h>
 #include <cxa_config.h>
 #include <cxa_criticalSection.h>
+#include <cxa_timeBase.h>
+
+#include <ovr_config.h>
 
 
 #define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
@@ -29,22 +32,52 @@
 
 
 // ******** local macro definitions ********
-#ifndef OVR_BEACONPROXY_LOSTTIMEOUT_MS
-	#define OVR_BEACONPROXY_LOSTTIMEOUT_MS			60000
+#ifndef OVR_BEACONPROXY_LOSTTIMEOUT_MIN_MS
+	#define OVR_BEACONPROXY_LOSTTIMEOUT_MIN_MS		10000
+#endif
+
+#ifndef OVR_BEACONPROXY_LOSTTIMEOUT_MAX_MS
+	#define OVR_BEACONPROXY_LOSTTIMEOUT_MAX_MS		300000
+#endif
+
+#ifndef OVR_BEACONPROXY_LOST_NUMMISSEDADVERTS
+	#define OVR_BEACONPROXY_LOST_NUMMISSEDADVERTS	5
+#endif
+
+#ifndef OVR_BEACONPROXY_MINNUM_INTERVAL_SAMPLES
+	#define OVR_BEACONPROXY_MINNUM_INTERVAL_SAMPLES	3
 #endif
 
 
+// checkpoint record layout...the advert comes first, in its over-the-air format
+#define CHECKPOINT_ADVERT_SIZE_BYTES			15
+#define CHECKPOINT_OFFSET_RSSI					15
+#define CHECKPOINT_OFFSET_NUMINTERVALSAMPLES	16
+#define CHECKPOINT_OFFSET_INTERVAL_AVG			18
+#define CHECKPOINT_OFFSET_INTERVAL_DEV			22
+#define CHECKPOINT_OFFSET_ACCELCOUNTS			26
+
+
 // ******** local type definitions ********
 
 
 // ******** local function prototypes ********
+static void getHistorySample(ovr_beaconUpdate_t *const updateIn, ovr_beaconHistory_sample_t *const sampleOut);
+static void recordAccelEvents(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconProxy_accelStatus_t prevStatusIn, ovr_beaconProxy_accelStatus_t newStatusIn);
+static void recordAggregates(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconHistory_sample_t *const sampleIn);
+static void updateAggregate(ovr_beaconProxy_aggregate_t *const aggIn, bool isFirstIn, int16_t valueIn);
+static bool isAccelEventSet(ovr_beaconProxy_accelStatus_t statusIn, ovr_beaconProxy_accelEventType_t typeIn);
+static void putUint16LE(uint8_t *const bufIn, uint16_t valIn);
+static void putUint32LE(uint8_t *const bufIn, uint32_t valIn);
+static uint16_t getUint16LE(uint8_t *const bufIn);
+static uint32_t getUint32LE(uint8_t *const bufIn);
 
 
 // ********  local variable declarations *********
 
 
 // ******** global function implementations ********
-bool ovr_beaconProxy_init(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpdate_t *const updateIn)
+bool ovr_beaconProxy_init(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpdate_t *const updateIn, ovr_beaconHistory_arena_t *const historyArenaIn)
 {
 	cxa_assert(beaconProxyIn);
 	cxa_assert(updateIn);
@@ -53,7 +86,26 @@ bool ovr_beaconProxy_init(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpda
 	// pointers shouldn't change...even after updates
 	memcpy(&beaconProxyIn->lastUpdate, updateIn, sizeof(beaconProxyIn->lastUpdate));
 
-	beaconProxyIn->cachedAccelStatus = ovr_beaconUpdate_getAccelStatus(&beaconProxyIn->lastUpdate);
+	// anything set in our first update counts as a new event
+	memset(&beaconProxyIn->accelEvents, 0, sizeof(beaconProxyIn->accelEvents));
+	ovr_beaconProxy_accelStatus_t noEvents = { false, false, false, false };
+	recordAccelEvents(beaconProxyIn, noEvents, ovr_beaconUpdate_getAccelStatus(&beaconProxyIn->lastUpdate));
+
+	// no rule has seen us yet
+	memset(beaconProxyIn->ruleStates, 0, sizeof(beaconProxyIn->ruleStates));
+
+	// we don't know anything about our advertising cadence yet
+	memset(&beaconProxyIn->cadence, 0, sizeof(beaconProxyIn->cadence));
+	beaconProxyIn->rssiSmoothed_q4 = (int16_t)beaconProxyIn->lastUpdate.rssi_dBm * 16;
+
+	// our first update becomes the base of our history
+	ovr_beaconHistory_sample_t firstSample;
+	getHistorySample(&beaconProxyIn->lastUpdate, &firstSample);
+	ovr_beaconHistory_init(&beaconProxyIn->history, historyArenaIn, &firstSample);
+
+	// ...and opens our first reporting window
+	memset(&beaconProxyIn->aggregates, 0, sizeof(beaconProxyIn->aggregates));
+	recordAggregates(beaconProxyIn, &firstSample);
 
 	// last but not least, start our timeDiff
 	cxa_timeDiff_init(&beaconProxyIn->td_lastUpdate);
@@ -62,6 +114,54 @@ bool ovr_beaconProxy_init(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpda
 }
 
 
+bool ovr_beaconProxy_initFromCheckpoint(ovr_beaconProxy_t *const beaconProxyIn, uint8_t *const recordIn, size_t recordSize_bytesIn, ovr_beaconHistory_arena_t *const historyArenaIn)
+{
+	cxa_assert(beaconProxyIn);
+	cxa_assert(recordIn);
+
+	if( recordSize_bytesIn != OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES ) return false;
+
+	// reuse the advert parser so the record can't drift from the live path
+	cxa_fixedByteBuffer_t fbb_advert;
+	cxa_fixedByteBuffer_init_inPlace(&fbb_advert, CHECKPOINT_ADVERT_SIZE_BYTES, recordIn, CHECKPOINT_ADVERT_SIZE_BYTES);
+
+	ovr_beaconUpdate_t restoredUpdate;
+	if( !ovr_beaconUpdate_init(&restoredUpdate, (int8_t)recordIn[CHECKPOINT_OFFSET_RSSI], &fbb_advert) ) return false;
+	restoredUpdate.rxTime_us = cxa_timeBase_getCount_us();
+
+	if( !ovr_beaconProxy_init(beaconProxyIn, &restoredUpdate, historyArenaIn) ) return false;
+
+	// a restored cadence means a sensible lost timeout right away
+	beaconProxyIn->cadence.numIntervalSamples = getUint16LE(&recordIn[CHECKPOINT_OFFSET_NUMINTERVALSAMPLES]);
+	beaconProxyIn->cadence.advertInterval_avg_ms = getUint32LE(&recordIn[CHECKPOINT_OFFSET_INTERVAL_AVG]);
+	beaconProxyIn->cadence.advertInterval_dev_ms = getUint32LE(&recordIn[CHECKPOINT_OFFSET_INTERVAL_DEV]);
+
+	// init counted anything set in the restored advert as new...replace that with
+	// what was actually pending (timestamps restart since we can't know the gap)
+	ovr_beaconProxy_accelStatus_t currStatus = ovr_beaconUpdate_getAccelStatus(&beaconProxyIn->lastUpdate);
+	uint32_t now_us = cxa_timeBase_getCount_us();
+	for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
+	{
+		ovr_beaconProxy_accelEventStats_t* currStats = &beaconProxyIn->accelEvents.events[i];
+
+		currStats->count = getUint16LE(&recordIn[CHECKPOINT_OFFSET_ACCELCOUNTS + (2 * i)]);
+		currStats->hasOccurred = (currStats->count > 0) || isAccelEventSet(currStatus, i);
+		currStats->first_us = now_us;
+		currStats->last_us = now_us;
+	}
+
+	return true;
+}
+
+
+void ovr_beaconProxy_deinit(ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(beaconProxyIn);
+
+	ovr_beaconHistory_deinit(&beaconProxyIn->history);
+}
+
+
 ovr_beaconProxy_devType_t ovr_beaconProxy_getDeviceType(ovr_beaconProxy_t *const beaconProxyIn)
 {
 	cxa_assert(beaconProxyIn);
@@ -86,19 +186,156 @@ ovr_beaconUpdate_t* ovr_beaconProxy_getLastUpdate(ovr_beaconProxy_t *const beaco
 }
 
 
-ovr_beaconProxy_accelStatus_t ovr_beaconProxy_checkAndResetAccelStatus(ovr_beaconProxy_t *const beaconProxyIn)
+int8_t ovr_beaconProxy_getSmoothedRssi(ovr_beaconProxy_t *const beaconProxyIn)
 {
 	cxa_assert(beaconProxyIn);
 
-	ovr_beaconProxy_accelStatus_t cachedStatus = beaconProxyIn->cachedAccelStatus;
+	// round to the nearest dBm (rssi is always negative in practice)
+	int16_t rssi_q4 = beaconProxyIn->rssiSmoothed_q4;
+	return (int8_t)((rssi_q4 < 0) ? ((rssi_q4 - 8) / 16) : ((rssi_q4 + 8) / 16));
+}
 
-	ovr_beaconUpdate_t* lastUpdate = ovr_beaconProxy_getLastUpdate(beaconProxyIn);
-	if( lastUpdate != NULL )
+
+ovr_beaconProxy_accelEvents_t ovr_beaconProxy_checkAndResetAccelEvents(ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(beaconProxyIn);
+
+	// events are recorded from the bluetooth thread (see recordAccelEvents)...a count
+	// and its times are always taken together
+	ovr_beaconProxy_accelEvents_t retVal;
+	cxa_criticalSection_enter();
+	ovr_beaconProxy_accelStatus_t currStatus = ovr_beaconUpdate_getAccelStatus(&beaconProxyIn->lastUpdate);
+	for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
 	{
-		beaconProxyIn->cachedAccelStatus = ovr_beaconUpdate_getAccelStatus(lastUpdate);
+		ovr_beaconProxy_accelEventStats_t* currStats = &beaconProxyIn->accelEvents.events[i];
+
+		retVal.events[i] = *currStats;
+		retVal.events[i].hasOccurred = currStats->hasOccurred || (currStats->count > 0);
+		currStats->hasOccurred = isAccelEventSet(currStatus, i);
+		__atomic_store_n(&currStats->count, 0, __ATOMIC_RELAXED);
 	}
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+bool ovr_beaconProxy_hasPendingAccelEvent(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconProxy_accelEventType_t typeIn)
+{
+	cxa_assert(beaconProxyIn);
+	cxa_assert(typeIn < OVR_BEACONPROXY_NUM_ACCELEVENTS);
 
-	return cachedStatus;
+	return (__atomic_load_n(&beaconProxyIn->accelEvents.events[typeIn].count, __ATOMIC_RELAXED) > 0);
+}
+
+
+ovr_beaconProxy_aggregates_t ovr_beaconProxy_takeAggregates(ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(beaconProxyIn);
+
+	// the btle thread records while the network thread reports
+	cxa_criticalSection_enter();
+	ovr_beaconProxy_aggregates_t retVal = beaconProxyIn->aggregates;
+	memset(&beaconProxyIn->aggregates, 0, sizeof(beaconProxyIn->aggregates));
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+ovr_beaconProxy_aggregates_t ovr_beaconProxy_getAggregates(ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(beaconProxyIn);
+
+	cxa_criticalSection_enter();
+	ovr_beaconProxy_aggregates_t retVal = beaconProxyIn->aggregates;
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+int8_t ovr_beaconProxy_getRssiQuantile(ovr_beaconProxy_aggregates_t *const aggregatesIn, uint8_t quantile_pcntIn)
+{
+	cxa_assert(aggregatesIn);
+
+	int8_t retVal = aggregatesIn->fields[OVR_BEACONPROXY_AGGFIELD_RSSI].last;
+#if OVR_BEACONPROXY_RSSISKETCH_NUMBINS > 0
+	if( aggregatesIn->count == 0 ) return retVal;
+	if( quantile_pcntIn > 100 ) quantile_pcntIn = 100;
+
+	// rank of the sample we're after (1-based)
+	uint32_t targetRank = ((uint32_t)aggregatesIn->count * quantile_pcntIn + 99) / 100;
+	if( targetRank == 0 ) targetRank = 1;
+
+	uint32_t cumCount = 0;
+	for( size_t i = 0; i < OVR_BEACONPROXY_RSSISKETCH_NUMBINS; i++ )
+	{
+		cumCount += aggregatesIn->rssiBins[i];
+		if( cumCount >= targetRank )
+		{
+			// middle of the bin, but never outside what we actually saw
+			int16_t binMid = OVR_BEACONPROXY_RSSISKETCH_FLOOR_DBM + (i * OVR_BEACONPROXY_RSSISKETCH_BINWIDTH_DB) + (OVR_BEACONPROXY_RSSISKETCH_BINWIDTH_DB / 2);
+			if( binMid < aggregatesIn->fields[OVR_BEACONPROXY_AGGFIELD_RSSI].min ) binMid = aggregatesIn->fields[OVR_BEACONPROXY_AGGFIELD_RSSI].min;
+			if( binMid > aggregatesIn->fields[OVR_BEACONPROXY_AGGFIELD_RSSI].max ) binMid = aggregatesIn->fields[OVR_BEACONPROXY_AGGFIELD_RSSI].max;
+			retVal = binMid;
+			break;
+		}
+	}
+#endif
+	return retVal;
+}
+
+
+size_t ovr_beaconProxy_drainHistory(ovr_beaconProxy_t *const beaconProxyIn, uint8_t *const bufOut, size_t maxSize_bytesIn, size_t *const numSamplesOut)
+{
+	cxa_assert(beaconProxyIn);
+	cxa_assert(bufOut);
+
+	// history is appended from the bluetooth thread
+	cxa_criticalSection_enter();
+	size_t retVal = ovr_beaconHistory_drainBatch(&beaconProxyIn->history, cxa_timeDiff_getElapsedTime_ms(&beaconProxyIn->td_lastUpdate),
+												 bufOut, maxSize_bytesIn, numSamplesOut);
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+void ovr_beaconProxy_writeCheckpoint(ovr_beaconProxy_t *const beaconProxyIn, uint8_t *const recordOut)
+{
+	cxa_assert(beaconProxyIn);
+	cxa_assert(recordOut);
+
+	ovr_beaconUpdate_t* lastUpdate = &beaconProxyIn->lastUpdate;
+
+	recordOut[0] = lastUpdate->devType;
+	memcpy(&recordOut[1], lastUpdate->uuid.bytes, sizeof(lastUpdate->uuid.bytes));
+	recordOut[7] = lastUpdate->status_raw;
+	recordOut[8] = lastUpdate->batt_pcnt100;
+	putUint16LE(&recordOut[9], lastUpdate->currTemp_deciDegC);
+	recordOut[11] = lastUpdate->light_255;
+	recordOut[12] = lastUpdate->accelStatus_raw;
+	putUint16LE(&recordOut[13], lastUpdate->batt_mv);
+	recordOut[CHECKPOINT_OFFSET_RSSI] = (uint8_t)lastUpdate->rssi_dBm;
+
+	putUint16LE(&recordOut[CHECKPOINT_OFFSET_NUMINTERVALSAMPLES], beaconProxyIn->cadence.numIntervalSamples);
+	putUint32LE(&recordOut[CHECKPOINT_OFFSET_INTERVAL_AVG], beaconProxyIn->cadence.advertInterval_avg_ms);
+	putUint32LE(&recordOut[CHECKPOINT_OFFSET_INTERVAL_DEV], beaconProxyIn->cadence.advertInterval_dev_ms);
+
+	// counts are reset from the network thread
+	for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
+	{
+		putUint16LE(&recordOut[CHECKPOINT_OFFSET_ACCELCOUNTS + (2 * i)], __atomic_load_n(&beaconProxyIn->accelEvents.events[i].count, __ATOMIC_RELAXED));
+	}
+}
+
+
+uint8_t* ovr_beaconProxy_getRuleStates(ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(beaconProxyIn);
+
+	return beaconProxyIn->ruleStates;
 }
 
 
@@ -107,15 +344,40 @@ void ovr_beaconProxy_update(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUp
 	cxa_assert(beaconProxyIn);
 	cxa_assert(updateIn);
 
+	ovr_beaconProxy_accelStatus_t prevAccelStatus = ovr_beaconUpdate_getAccelStatus(&beaconProxyIn->lastUpdate);
 	memcpy(&beaconProxyIn->lastUpdate, updateIn, sizeof(beaconProxyIn->lastUpdate));
+	beaconProxyIn->rssiSmoothed_q4 += (((int16_t)updateIn->rssi_dBm * 16) - beaconProxyIn->rssiSmoothed_q4) / (1 << OVR_BEACONPROXY_RSSISMOOTHING_SHIFT);
+
+	// track how often we're actually hearing from this beacon
+	uint32_t timeSinceLastUpdate_ms = cxa_timeDiff_getElapsedTime_ms(&beaconProxyIn->td_lastUpdate);
+	ovr_beaconProxy_cadence_addInterval(&beaconProxyIn->cadence, timeSinceLastUpdate_ms);
+
+	// record the sample
+	ovr_beaconHistory_sample_t newSample;
+	getHistorySample(updateIn, &newSample);
+	cxa_criticalSection_enter();
+	ovr_beaconHistory_append(&beaconProxyIn->history, &newSample, timeSinceLastUpdate_ms);
+	recordAggregates(beaconProxyIn, &newSample);
 	cxa_timeDiff_setStartTime_now(&beaconProxyIn->td_lastUpdate);
+	cxa_criticalSection_exit();
 
-	// latch each status bit to 1 if needed
-	ovr_beaconProxy_accelStatus_t newStatus = ovr_beaconUpdate_getAccelStatus(updateIn);
-	if( !beaconProxyIn->cachedAccelStatus.hasOccurred_1tap ) beaconProxyIn->cachedAccelStatus.hasOccurred_1tap = newStatus.hasOccurred_1tap;
-	if( !beaconProxyIn->cachedAccelStatus.hasOccurred_2tap ) beaconProxyIn->cachedAccelStatus.hasOccurred_2tap = newStatus.hasOccurred_2tap;
-	if( !beaconProxyIn->cachedAccelStatus.hasOccurred_activity ) beaconProxyIn->cachedAccelStatus.hasOccurred_activity = newStatus.hasOccurred_activity;
-	if( !beaconProxyIn->cachedAccelStatus.hasOccurred_freeFall ) beaconProxyIn->cachedAccelStatus.hasOccurred_freeFall = newStatus.hasOccurred_freeFall;
+	recordAccelEvents(beaconProxyIn, prevAccelStatus, ovr_beaconUpdate_getAccelStatus(updateIn));
+}
+
+
+uint32_t ovr_beaconProxy_getTimeSinceLastUpdate_ms(ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(beaconProxyIn);
+
+	return cxa_timeDiff_getElapsedTime_ms(&beaconProxyIn->td_lastUpdate);
+}
+
+
+uint32_t ovr_beaconProxy_getLostTimeout_ms(ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(beaconProxyIn);
+
+	return ovr_beaconProxy_cadence_getLostTimeout_ms(&beaconProxyIn->cadence);
 }
 
 
@@ -123,8 +385,192 @@ bool ovr_beaconProxy_hasTimedOut(ovr_beaconProxy_t *const beaconProxyIn)
 {
 	cxa_assert(beaconProxyIn);
 
-	return cxa_timeDiff_isElapsed_ms(&beaconProxyIn->td_lastUpdate, OVR_BEACONPROXY_LOSTTIMEOUT_MS);
+	return cxa_timeDiff_isElapsed_ms(&beaconProxyIn->td_lastUpdate, ovr_beaconProxy_getLostTimeout_ms(beaconProxyIn));
+}
+
+
+ovr_beaconProxy_cadence_t ovr_beaconProxy_getCadence(ovr_beaconProxy_t *const beaconProxyIn)
+{
+	cxa_assert(beaconProxyIn);
+
+	return beaconProxyIn->cadence;
+}
+
+
+void ovr_beaconProxy_setCadence(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconProxy_cadence_t *const cadenceIn)
+{
+	cxa_assert(beaconProxyIn);
+	cxa_assert(cadenceIn);
+
+	beaconProxyIn->cadence = *cadenceIn;
+}
+
+
+void ovr_beaconProxy_cadence_addInterval(ovr_beaconProxy_cadence_t *const cadenceIn, uint32_t interval_msIn)
+{
+	cxa_assert(cadenceIn);
+
+	// don't let a single huge gap swamp our average
+	if( interval_msIn > OVR_BEACONPROXY_LOSTTIMEOUT_MAX_MS ) interval_msIn = OVR_BEACONPROXY_LOSTTIMEOUT_MAX_MS;
+
+	if( cadenceIn->numIntervalSamples == 0 )
+	{
+		cadenceIn->advertInterval_avg_ms = interval_msIn;
+		cadenceIn->advertInterval_dev_ms = interval_msIn / 2;
+	}
+	else
+	{
+		// integer EWMAs (1/8 for the average, 1/4 for the deviation)
+		int32_t err_ms = (int32_t)interval_msIn - (int32_t)cadenceIn->advertInterval_avg_ms;
+		int32_t absErr_ms = (err_ms < 0) ? -err_ms : err_ms;
+
+		cadenceIn->advertInterval_avg_ms = (int32_t)cadenceIn->advertInterval_avg_ms + (err_ms / 8);
+		cadenceIn->advertInterval_dev_ms = (int32_t)cadenceIn->advertInterval_dev_ms + ((absErr_ms - (int32_t)cadenceIn->advertInterval_dev_ms) / 4);
+	}
+
+	if( cadenceIn->numIntervalSamples < UINT16_MAX ) cadenceIn->numIntervalSamples++;
+}
+
+
+uint32_t ovr_beaconProxy_cadence_getLostTimeout_ms(ovr_beaconProxy_cadence_t *const cadenceIn)
+{
+	cxa_assert(cadenceIn);
+
+	// used until we've observed enough of the beacon's advertising cadence
+	if( cadenceIn->numIntervalSamples < OVR_BEACONPROXY_MINNUM_INTERVAL_SAMPLES ) return ovr_config_get(OVR_CONFIG_ID_LOSTTIMEOUT_MS);
+
+	// the average interval is measured between _received_ adverts, so it already
+	// accounts for our reception ratio...add some margin for jitter (a la TCP RTO)
+	uint32_t timeout_ms = (OVR_BEACONPROXY_LOST_NUMMISSEDADVERTS * cadenceIn->advertInterval_avg_ms) +
+						  (4 * cadenceIn->advertInterval_dev_ms);
+
+	if( timeout_ms < OVR_BEACONPROXY_LOSTTIMEOUT_MIN_MS ) timeout_ms = OVR_BEACONPROXY_LOSTTIMEOUT_MIN_MS;
+	if( timeout_ms > OVR_BEACONPROXY_LOSTTIMEOUT_MAX_MS ) timeout_ms = OVR_BEACONPROXY_LOSTTIMEOUT_MAX_MS;
+
+	return timeout_ms;
 }
 
 
 // ******** local function implementations ********
+static void getHistorySample(ovr_beaconUpdate_t *const updateIn, ovr_beaconHistory_sample_t *const sampleOut)
+{
+	cxa_assert(updateIn);
+	cxa_assert(sampleOut);
+
+	sampleOut->rssi_dBm = updateIn->rssi_dBm;
+	sampleOut->temp_deciDegC = updateIn->currTemp_deciDegC;
+	sampleOut->light_255 = updateIn->light_255;
+	sampleOut->batt_pcnt100 = updateIn->batt_pcnt100;
+	sampleOut->batt_mv = updateIn->batt_mv;
+}
+
+
+static void recordAccelEvents(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconProxy_accelStatus_t prevStatusIn, ovr_beaconProxy_accelStatus_t newStatusIn)
+{
+	cxa_assert(beaconProxyIn);
+
+	for( size_t i = 0; i < OVR_BEACONPROXY_NUM_ACCELEVENTS; i++ )
+	{
+		if( !isAccelEventSet(newStatusIn, i) ) continue;
+
+		ovr_beaconProxy_accelEventStats_t* currStats = &beaconProxyIn->accelEvents.events[i];
+		uint32_t now_us = cxa_timeBase_getCount_us();
+
+		// the network thread takes the count and its times together
+		cxa_criticalSection_enter();
+		currStats->hasOccurred = true;
+
+		// beacons hold each status bit across several adverts...only count rising edges
+		if( !isAccelEventSet(prevStatusIn, i) && (currStats->count < UINT16_MAX) )
+		{
+			if( currStats->count == 0 ) currStats->first_us = now_us;
+			currStats->last_us = now_us;
+			__atomic_store_n(&currStats->count, currStats->count + 1, __ATOMIC_RELAXED);
+		}
+		cxa_criticalSection_exit();
+	}
+}
+
+
+static void recordAggregates(ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconHistory_sample_t *const sampleIn)
+{
+	cxa_assert(beaconProxyIn);
+	cxa_assert(sampleIn);
+
+	ovr_beaconProxy_aggregates_t* aggs = &beaconProxyIn->aggregates;
+	if( aggs->count == UINT16_MAX ) return;
+	bool isFirst = (aggs->count == 0);
+
+	updateAggregate(&aggs->fields[OVR_BEACONPROXY_AGGFIELD_RSSI], isFirst, sampleIn->rssi_dBm);
+	updateAggregate(&aggs->fields[OVR_BEACONPROXY_AGGFIELD_TEMP], isFirst, (int16_t)sampleIn->temp_deciDegC);
+	updateAggregate(&aggs->fields[OVR_BEACONPROXY_AGGFIELD_LIGHT], isFirst, sampleIn->light_255);
+	updateAggregate(&aggs->fields[OVR_BEACONPROXY_AGGFIELD_BATTMV], isFirst, (sampleIn->batt_mv > INT16_MAX) ? INT16_MAX : sampleIn->batt_mv);
+
+#if OVR_BEACONPROXY_RSSISKETCH_NUMBINS > 0
+	// out-of-range values land in the end bins
+	int32_t binIndex = (sampleIn->rssi_dBm - OVR_BEACONPROXY_RSSISKETCH_FLOOR_DBM) / OVR_BEACONPROXY_RSSISKETCH_BINWIDTH_DB;
+	if( binIndex < 0 ) binIndex = 0;
+	if( binIndex >= OVR_BEACONPROXY_RSSISKETCH_NUMBINS ) binIndex = OVR_BEACONPROXY_RSSISKETCH_NUMBINS - 1;
+	aggs->rssiBins[binIndex]++;
+#endif
+
+	aggs->count++;
+}
+
+
+static void updateAggregate(ovr_beaconProxy_aggregate_t *const aggIn, bool isFirstIn, int16_t valueIn)
+{
+	cxa_assert(aggIn);
+
+	if( isFirstIn || (valueIn < aggIn->min) ) aggIn->min = valueIn;
+	if( isFirstIn || (valueIn > aggIn->max) ) aggIn->max = valueIn;
+	aggIn->last = valueIn;
+	aggIn->sum += valueIn;
+}
+
+
+static bool isAccelEventSet(ovr_beaconProxy_accelStatus_t statusIn, ovr_beaconProxy_accelEventType_t typeIn)
+{
+	switch( typeIn )
+	{
+		case OVR_BEACONPROXY_ACCELEVENT_ACTIVITY:
+			return statusIn.hasOccurred_activity;
+
+		case OVR_BEACONPROXY_ACCELEVENT_1TAP:
+			return statusIn.hasOccurred_1tap;
+
+		case OVR_BEACONPROXY_ACCELEVENT_2TAP:
+			return statusIn.hasOccurred_2tap;
+
+		case OVR_BEACONPROXY_ACCELEVENT_FREEFALL:
+			return statusIn.hasOccurred_freeFall;
+	}
+
+	return false;
+}
+
+
+static void putUint16LE(uint8_t *const bufIn, uint16_t valIn)
+{
+	bufIn[0] = (uint8_t)valIn;
+	bufIn[1] = (uint8_t)(valIn >> 8);
+}
+
+
+static void putUint32LE(uint8_t *const bufIn, uint32_t valIn)
+{
+	putUint16LE(&bufIn[0], (uint16_t)valIn);
+	putUint16LE(&bufIn[2], (uint16_t)(valIn >> 16));
+}
+
+
+static uint16_t getUint16LE(uint8_t *const bufIn)
+{
+	return (uint16_t)bufIn[0] | ((uint16_t)bufIn[1] << 8);
+}
+
+
+static uint32_t getUint32LE(uint8_t *const bufIn)
+{
+	return (uint32_t)getUint16LE(&bufIn[0]) | ((uint32_t)getUint16LE(&bufIn[2]) << 16);
+}
@@ -0,0 +1,721 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_beaconRules.h"
+
+
+// ******** includes ********
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_criticalSection.h>
+#include <cxa_nvsManager.h>
+#include <cxa_runLoop.h>
+#include <cxa_sntpClient.h>
+#include <cxa_stringUtils.h>
+#include <cxa_timeBase.h>
+#include <cxa_uniqueId.h>
+
+#include <ovr_beaconManager.h>
+#include <ovr_publishScheduler.h>
+
+#define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
+#include <cxa_logger_implementation.h>
+
+
+// ******** local macro definitions ********
+#define OPCODE_FIELD					0x01		// [fieldId:1]
+#define OPCODE_CONST					0x02		// [value:2 LE]
+#define OPCODE_GT						0x10
+#define OPCODE_GE						0x11
+#define OPCODE_LT						0x12
+#define OPCODE_LE						0x13
+#define OPCODE_EQ						0x14
+#define OPCODE_NE						0x15
+#define OPCODE_AND						0x20
+#define OPCODE_OR						0x21
+#define OPCODE_NOT						0x22
+
+#define STACK_MAXDEPTH					8
+
+// per-beacon state byte: consecutive matches and whether we've already alerted
+#define RULESTATE_COUNT_MASK			0x7F
+#define RULESTATE_LATCHED				0x80
+
+// bump whenever the opcodes or field ids change
+#define BYTECODE_VERSION				1
+#define NVS_KEY_VERSION					"br_ver"
+#define NVS_KEY_USEDMASK				"br_used"
+#define NVS_KEY_RULES					"br_rules"
+
+#define ALERT_MAX_PAYLOAD_BYTES			192
+#define SETRULE_HEADER_SIZE_BYTES		1
+
+#if OVR_BEACONRULES_MAXNUM_RULES > 32
+	#error "matched rules are tracked in a uint32_t"
+#endif
+
+
+// ******** local type definitions ********
+typedef enum
+{
+	FIELD_TEMP_C,
+	FIELD_BATT_PCNT100,
+	FIELD_BATT_MV,
+	FIELD_LIGHT_255,
+	FIELD_RSSI,
+	FIELD_ISCHARGING,
+	FIELD_ACTIVITY,
+	FIELD_1TAP,
+	FIELD_2TAP,
+	FIELD_FREEFALL,
+}fieldId_t;
+
+
+typedef struct
+{
+	const char* name;
+	fieldId_t id;
+	float scale;				// text value -> bytecode constant
+	bool isFlag;
+}fieldDescriptor_t;
+
+
+typedef struct
+{
+	const char* name;
+	uint8_t opcode;
+}operatorDescriptor_t;
+
+
+// ******** local function prototypes ********
+static void cb_onRunLoopUpdate(void* userVarIn);
+static void beaconCb_onBeaconUpdate(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn);
+
+static void applyPendingChange(ovr_beaconRules_t *const brIn);
+static void publishAlert(ovr_beaconRules_t *const brIn, ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpdate_t *const updateIn, uint8_t ruleIdIn);
+static bool queueChange(ovr_beaconRules_t *const brIn, ovr_beaconRules_rule_t *const ruleIn, bool isRemovalIn);
+
+static void loadFromNvs(ovr_beaconRules_t *const brIn);
+static bool saveToNvs(ovr_beaconRules_t *const brIn);
+static bool isRuleValid(ovr_beaconRules_rule_t *const ruleIn);
+
+static bool emit(ovr_beaconRules_rule_t *const ruleIn, uint8_t byteIn);
+static const fieldDescriptor_t* getFieldDescriptor(const char *const nameIn);
+static int32_t getFieldValue(ovr_beaconUpdate_t *const updateIn, uint8_t fieldIdIn);
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setRule(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_removeRule(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getRules(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getRuleStats(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+static const fieldDescriptor_t fields[] =
+{
+	{ "temp_c",			FIELD_TEMP_C,		10.0,	false },
+	{ "batt_pcnt100",	FIELD_BATT_PCNT100,	1.0,	false },
+	{ "batt_mv",		FIELD_BATT_MV,		1.0,	false },
+	{ "light_255",		FIELD_LIGHT_255,	1.0,	false },
+	{ "rssi",			FIELD_RSSI,			1.0,	false },
+	{ "isCharging",		FIELD_ISCHARGING,	1.0,	true },
+	{ "activity",		FIELD_ACTIVITY,		1.0,	true },
+	{ "1tap",			FIELD_1TAP,			1.0,	true },
+	{ "2tap",			FIELD_2TAP,			1.0,	true },
+	{ "freeFall",		FIELD_FREEFALL,		1.0,	true },
+};
+
+
+static const operatorDescriptor_t operators[] =
+{
+	{ ">",	OPCODE_GT },
+	{ ">=",	OPCODE_GE },
+	{ "<",	OPCODE_LT },
+	{ "<=",	OPCODE_LE },
+	{ "==",	OPCODE_EQ },
+	{ "!=",	OPCODE_NE },
+};
+
+
+// ******** global function implementations ********
+void ovr_beaconRules_init(ovr_beaconRules_t *const brIn, ovr_beaconManager_t *const bmIn, cxa_mqtt_rpc_node_t *const rootNodeIn, int btleThreadIdIn)
+{
+	cxa_assert(brIn);
+	cxa_assert(bmIn);
+	cxa_assert(rootNodeIn);
+
+	brIn->bm = bmIn;
+	brIn->hasPendingChange = false;
+	memset(brIn->isRuleUsed, 0, sizeof(brIn->isRuleUsed));
+	memset(&brIn->stats, 0, sizeof(brIn->stats));
+
+	cxa_logger_init(&brIn->logger, "beaconRules");
+
+	loadFromNvs(brIn);
+
+	// found beacons are evaluated too (their first update may already be alarming)
+	ovr_beaconManager_addListener(bmIn, beaconCb_onBeaconUpdate, beaconCb_onBeaconUpdate, NULL, (void*)brIn);
+
+	cxa_mqtt_rpc_node_init_formattedString(&brIn->rpcNode, rootNodeIn, "rules");
+	cxa_mqtt_rpc_node_addMethod(&brIn->rpcNode, "setRule", rpcMethodCb_setRule, (void*)brIn);
+	cxa_mqtt_rpc_node_addMethod(&brIn->rpcNode, "removeRule", rpcMethodCb_removeRule, (void*)brIn);
+	cxa_mqtt_rpc_node_addMethod(&brIn->rpcNode, "getRules", rpcMethodCb_getRules, (void*)brIn);
+	cxa_mqtt_rpc_node_addMethod(&brIn->rpcNode, "getRuleStats", rpcMethodCb_getRuleStats, (void*)brIn);
+
+	cxa_runLoop_addEntry(btleThreadIdIn, cb_onRunLoopUpdate, (void*)brIn);
+}
+
+
+bool ovr_beaconRules_setRule(ovr_beaconRules_t *const brIn, uint8_t idIn, const char *const textIn)
+{
+	cxa_assert(brIn);
+	cxa_assert(textIn);
+
+	if( idIn >= OVR_BEACONRULES_MAXNUM_RULES ) return false;
+
+	ovr_beaconRules_rule_t newRule;
+	if( !ovr_beaconRules_compile(textIn, idIn, &newRule) )
+	{
+		cxa_logger_warn(&brIn->logger, "rule %d doesn't compile: '%s'", idIn, textIn);
+		return false;
+	}
+
+	return queueChange(brIn, &newRule, false);
+}
+
+
+bool ovr_beaconRules_removeRule(ovr_beaconRules_t *const brIn, uint8_t idIn)
+{
+	cxa_assert(brIn);
+
+	if( idIn >= OVR_BEACONRULES_MAXNUM_RULES ) return false;
+
+	ovr_beaconRules_rule_t oldRule = { .id = idIn };
+	return queueChange(brIn, &oldRule, true);
+}
+
+
+size_t ovr_beaconRules_getRules(ovr_beaconRules_t *const brIn, ovr_beaconRules_rule_t *const rulesOut, size_t maxNumRulesIn)
+{
+	cxa_assert(brIn);
+	cxa_assert(rulesOut);
+
+	size_t numRules = 0;
+	cxa_criticalSection_enter();
+	for( size_t i = 0; (i < OVR_BEACONRULES_MAXNUM_RULES) && (numRules < maxNumRulesIn); i++ )
+	{
+		if( brIn->isRuleUsed[i] ) rulesOut[numRules++] = brIn->rules[i];
+	}
+	cxa_criticalSection_exit();
+
+	return numRules;
+}
+
+
+ovr_beaconRules_stats_t ovr_beaconRules_getStats(ovr_beaconRules_t *const brIn)
+{
+	cxa_assert(brIn);
+
+	ovr_beaconRules_stats_t retVal;
+	retVal.numUpdates = __atomic_load_n(&brIn->stats.numUpdates, __ATOMIC_RELAXED);
+	retVal.numEvaluations = __atomic_load_n(&brIn->stats.numEvaluations, __ATOMIC_RELAXED);
+	retVal.numAlerts = __atomic_load_n(&brIn->stats.numAlerts, __ATOMIC_RELAXED);
+	retVal.numPublishFailures = __atomic_load_n(&brIn->stats.numPublishFailures, __ATOMIC_RELAXED);
+	retVal.evalTime_total_us = __atomic_load_n(&brIn->stats.evalTime_total_us, __ATOMIC_RELAXED);
+	retVal.evalTime_max_us = __atomic_load_n(&brIn->stats.evalTime_max_us, __ATOMIC_RELAXED);
+	return retVal;
+}
+
+
+bool ovr_beaconRules_compile(const char *const textIn, uint8_t idIn, ovr_beaconRules_rule_t *const ruleOut)
+{
+	cxa_assert(textIn);
+	cxa_assert(ruleOut);
+
+	if( strlen(textIn) > OVR_BEACONRULES_MAXLEN_TEXT ) return false;
+
+	memset(ruleOut, 0, sizeof(*ruleOut));
+	ruleOut->id = idIn;
+	ruleOut->numConsecutive = 1;
+
+	// tokenize a copy
+	char text[OVR_BEACONRULES_MAXLEN_TEXT+1];
+	strcpy(text, textIn);
+	char* savePtr = NULL;
+	char* currTok = strtok_r(text, " ", &savePtr);
+
+	uint8_t pendingJoin = 0;
+	while( true )
+	{
+		// term: [not] <flag> | [not] <field> <op> <number>
+		bool shouldNegate = false;
+		if( (currTok != NULL) && (strcmp(currTok, "not") == 0) )
+		{
+			shouldNegate = true;
+			currTok = strtok_r(NULL, " ", &savePtr);
+		}
+		if( currTok == NULL ) return false;
+
+		const fieldDescriptor_t* field = getFieldDescriptor(currTok);
+		if( field == NULL ) return false;
+		if( !emit(ruleOut, OPCODE_FIELD) || !emit(ruleOut, field->id) ) return false;
+
+		if( !field->isFlag )
+		{
+			char* opTok = strtok_r(NULL, " ", &savePtr);
+			char* valueTok = strtok_r(NULL, " ", &savePtr);
+			if( (opTok == NULL) || (valueTok == NULL) ) return false;
+
+			uint8_t opcode = 0;
+			for( size_t i = 0; i < (sizeof(operators)/sizeof(*operators)); i++ )
+			{
+				if( strcmp(opTok, operators[i].name) == 0 ) opcode = operators[i].opcode;
+			}
+			if( opcode == 0 ) return false;
+
+			char* endPtr = NULL;
+			float value = strtof(valueTok, &endPtr);
+			if( (endPtr == valueTok) || (*endPtr != 0) ) return false;
+
+			long scaledValue = lroundf(value * field->scale);
+			if( (scaledValue < INT16_MIN) || (scaledValue > INT16_MAX) ) return false;
+
+			if( !emit(ruleOut, OPCODE_CONST) ||
+				!emit(ruleOut, (uint8_t)(scaledValue & 0xFF)) ||
+				!emit(ruleOut, (uint8_t)((scaledValue >> 8) & 0xFF)) ||
+				!emit(ruleOut, opcode) ) return false;
+		}
+
+		if( shouldNegate && !emit(ruleOut, OPCODE_NOT) ) return false;
+		if( (pendingJoin != 0) && !emit(ruleOut, pendingJoin) ) return false;
+
+		// joiner, trailing 'for', or the end
+		currTok = strtok_r(NULL, " ", &savePtr);
+		if( currTok == NULL ) break;
+
+		if( strcmp(currTok, "and") == 0 ) pendingJoin = OPCODE_AND;
+		else if( strcmp(currTok, "or") == 0 ) pendingJoin = OPCODE_OR;
+		else if( strcmp(currTok, "for") == 0 )
+		{
+			char* countTok = strtok_r(NULL, " ", &savePtr);
+			if( countTok == NULL ) return false;
+
+			char* endPtr = NULL;
+			long numConsecutive = strtol(countTok, &endPtr, 10);
+			if( (endPtr == countTok) || (*endPtr != 0) ) return false;
+			if( (numConsecutive < 1) || (numConsecutive > OVR_BEACONRULES_MAXNUM_CONSECUTIVE) ) return false;
+			ruleOut->numConsecutive = numConsecutive;
+
+			// 'for' must be last
+			if( strtok_r(NULL, " ", &savePtr) != NULL ) return false;
+			break;
+		}
+		else return false;
+
+		currTok = strtok_r(NULL, " ", &savePtr);
+	}
+
+	return true;
+}
+
+
+bool ovr_beaconRules_evaluate(ovr_beaconRules_rule_t *const ruleIn, ovr_beaconUpdate_t *const updateIn)
+{
+	cxa_assert(ruleIn);
+	cxa_assert(updateIn);
+
+	int32_t stack[STACK_MAXDEPTH];
+	size_t depth = 0;
+
+	// everything is bounds-checked since bytecode may come from nvs
+	size_t pc = 0;
+	while( pc < ruleIn->codeSize_bytes )
+	{
+		uint8_t opcode = ruleIn->code[pc++];
+
+		if( opcode == OPCODE_FIELD )
+		{
+			if( (pc >= ruleIn->codeSize_bytes) || (depth >= STACK_MAXDEPTH) ) return false;
+			stack[depth++] = getFieldValue(updateIn, ruleIn->code[pc++]);
+			continue;
+		}
+		else if( opcode == OPCODE_CONST )
+		{
+			if( ((pc + 1) >= ruleIn->codeSize_bytes) || (depth >= STACK_MAXDEPTH) ) return false;
+			stack[depth++] = (int16_t)(ruleIn->code[pc] | (ruleIn->code[pc+1] << 8));
+			pc += 2;
+			continue;
+		}
+		else if( opcode == OPCODE_NOT )
+		{
+			if( depth < 1 ) return false;
+			stack[depth-1] = !stack[depth-1];
+			continue;
+		}
+
+		// everything else is binary
+		if( depth < 2 ) return false;
+		int32_t rhs = stack[--depth];
+		int32_t lhs = stack[depth-1];
+		switch( opcode )
+		{
+			case OPCODE_GT:		stack[depth-1] = (lhs > rhs); break;
+			case OPCODE_GE:		stack[depth-1] = (lhs >= rhs); break;
+			case OPCODE_LT:		stack[depth-1] = (lhs < rhs); break;
+			case OPCODE_LE:		stack[depth-1] = (lhs <= rhs); break;
+			case OPCODE_EQ:		stack[depth-1] = (lhs == rhs); break;
+			case OPCODE_NE:		stack[depth-1] = (lhs != rhs); break;
+			case OPCODE_AND:	stack[depth-1] = (lhs && rhs); break;
+			case OPCODE_OR:		stack[depth-1] = (lhs || rhs); break;
+			default:
+				return false;
+		}
+	}
+
+	return (depth == 1) && (stack[0] != 0);
+}
+
+
+// ******** local function implementations ********
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	ovr_beaconRules_t* brIn = (ovr_beaconRules_t*)userVarIn;
+	cxa_assert(brIn);
+
+	if( __atomic_load_n(&brIn->hasPendingChange, __ATOMIC_ACQUIRE) ) applyPendingChange(brIn);
+}
+
+
+static void beaconCb_onBeaconUpdate(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn)
+{
+	ovr_beaconRules_t* brIn = (ovr_beaconRules_t*)userVarIn;
+	cxa_assert(brIn);
+	cxa_assert(beaconProxyIn);
+
+	// alerts without a timestamp are useless upstream
+	if( !cxa_sntpClient_isClockSet() ) return;
+
+	ovr_beaconUpdate_t* lastUpdate = ovr_beaconProxy_getLastUpdate(beaconProxyIn);
+	if( lastUpdate == NULL ) return;
+	uint8_t* ruleStates = ovr_beaconProxy_getRuleStates(beaconProxyIn);
+
+	// evaluate everything first so publishing doesn't count against eval time
+	uint32_t alertMask = 0;
+	uint32_t numEvaluations = 0;
+	uint32_t startTime_us = cxa_timeBase_getCount_us();
+	for( size_t i = 0; i < OVR_BEACONRULES_MAXNUM_RULES; i++ )
+	{
+		if( !brIn->isRuleUsed[i] ) continue;
+		numEvaluations++;
+
+		if( !ovr_beaconRules_evaluate(&brIn->rules[i], lastUpdate) )
+		{
+			// re-arm
+			ruleStates[i] = 0;
+			continue;
+		}
+		if( ruleStates[i] & RULESTATE_LATCHED ) continue;
+
+		uint8_t count = (ruleStates[i] & RULESTATE_COUNT_MASK) + 1;
+		if( count >= brIn->rules[i].numConsecutive )
+		{
+			ruleStates[i] = RULESTATE_LATCHED;
+			alertMask |= (1UL << i);
+		}
+		else
+		{
+			ruleStates[i] = count;
+		}
+	}
+	uint32_t evalTime_us = cxa_timeBase_getCount_us() - startTime_us;
+
+	__atomic_fetch_add(&brIn->stats.numUpdates, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&brIn->stats.numEvaluations, numEvaluations, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&brIn->stats.evalTime_total_us, evalTime_us, __ATOMIC_RELAXED);
+	if( evalTime_us > __atomic_load_n(&brIn->stats.evalTime_max_us, __ATOMIC_RELAXED) ) __atomic_store_n(&brIn->stats.evalTime_max_us, evalTime_us, __ATOMIC_RELAXED);
+
+	for( size_t i = 0; (i < OVR_BEACONRULES_MAXNUM_RULES) && (alertMask != 0); i++ )
+	{
+		if( alertMask & (1UL << i) ) publishAlert(brIn, beaconProxyIn, lastUpdate, i);
+	}
+}
+
+
+static void applyPendingChange(ovr_beaconRules_t *const brIn)
+{
+	cxa_assert(brIn);
+
+	cxa_criticalSection_enter();
+	uint8_t id = brIn->pendingRule.id;
+	if( brIn->isPendingRemoval )
+	{
+		brIn->isRuleUsed[id] = false;
+	}
+	else
+	{
+		brIn->rules[id] = brIn->pendingRule;
+		brIn->isRuleUsed[id] = true;
+	}
+	__atomic_store_n(&brIn->hasPendingChange, false, __ATOMIC_RELEASE);
+	cxa_criticalSection_exit();
+
+	// whatever the previous occupant of this slot had counted no longer applies
+	cxa_array_iterate(ovr_beaconManager_getKnownBeacons(brIn->bm), currProxy, ovr_beaconProxy_t)
+	{
+		if( currProxy == NULL ) continue;
+		ovr_beaconProxy_getRuleStates(currProxy)[id] = 0;
+	}
+
+	cxa_logger_info(&brIn->logger, "rule %d %s", id, brIn->isRuleUsed[id] ? "set" : "removed");
+	if( !saveToNvs(brIn) ) cxa_logger_warn(&brIn->logger, "failed to save rules");
+}
+
+
+static void publishAlert(ovr_beaconRules_t *const brIn, ovr_beaconProxy_t *const beaconProxyIn, ovr_beaconUpdate_t *const updateIn, uint8_t ruleIdIn)
+{
+	cxa_assert(brIn);
+	cxa_assert(beaconProxyIn);
+	cxa_assert(updateIn);
+
+	char notiPayload[ALERT_MAX_PAYLOAD_BYTES] = "{";
+	bool wasFormed = false;
+	do
+	{
+		char* gatewayUniqueId = cxa_uniqueId_getHexString();
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), "\"gatewayId\":\"%s\"", gatewayUniqueId) ) break;
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"timestamp\":%d", cxa_sntpClient_getUnixTimeStamp()) ) break;
+
+		cxa_eui48_string_t uuid_str;
+		cxa_eui48_toString(ovr_beaconProxy_getEui48(beaconProxyIn), &uuid_str);
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"beaconId\":\"%s\"", uuid_str.str) ) break;
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"ruleId\":%d", ruleIdIn) ) break;
+
+		// enough context to act on without waiting for the next beacon update
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"rssi\":%d", ovr_beaconUpdate_getRssi(updateIn)) ) break;
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"temp_c\":%.1f", ovr_beaconUpdate_getTemp_c(updateIn)) ) break;
+		if( !cxa_stringUtils_concat_formattedString(notiPayload, sizeof(notiPayload), ",\"batt_pcnt100\":%d", ovr_beaconUpdate_getBattery_pcnt100(updateIn)) ) break;
+
+		if( !cxa_stringUtils_concat(notiPayload, "}", sizeof(notiPayload)) ) break;
+		wasFormed = true;
+	} while( false );
+
+	if( wasFormed && ovr_publishScheduler_publish(&brIn->rpcNode, "onAlert", OVR_PUBLISHSCHEDULER_CLASS_ALERT, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, notiPayload, strlen(notiPayload)) )
+	{
+		__atomic_fetch_add(&brIn->stats.numAlerts, 1, __ATOMIC_RELAXED);
+	}
+	else
+	{
+		__atomic_fetch_add(&brIn->stats.numPublishFailures, 1, __ATOMIC_RELAXED);
+	}
+}
+
+
+static bool queueChange(ovr_beaconRules_t *const brIn, ovr_beaconRules_rule_t *const ruleIn, bool isRemovalIn)
+{
+	cxa_assert(brIn);
+	cxa_assert(ruleIn);
+
+	bool retVal = false;
+	cxa_criticalSection_enter();
+	if( !brIn->hasPendingChange )
+	{
+		brIn->pendingRule = *ruleIn;
+		brIn->isPendingRemoval = isRemovalIn;
+		__atomic_store_n(&brIn->hasPendingChange, true, __ATOMIC_RELEASE);
+		retVal = true;
+	}
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+static void loadFromNvs(ovr_beaconRules_t *const brIn)
+{
+	cxa_assert(brIn);
+
+	uint32_t version;
+	uint32_t usedMask;
+	if( !cxa_nvsManager_get_uint32(NVS_KEY_VERSION, &version) ||
+		!cxa_nvsManager_get_uint32(NVS_KEY_USEDMASK, &usedMask) ) return;
+	if( version != BYTECODE_VERSION )
+	{
+		cxa_logger_warn(&brIn->logger, "discarding rules from bytecode v%d", (int)version);
+		return;
+	}
+
+	size_t actualSize_bytes;
+	if( !cxa_nvsManager_get_blob(NVS_KEY_RULES, (uint8_t*)brIn->rules, sizeof(brIn->rules), &actualSize_bytes) ||
+		(actualSize_bytes != sizeof(brIn->rules)) ) return;
+
+	size_t numRules = 0;
+	for( size_t i = 0; i < OVR_BEACONRULES_MAXNUM_RULES; i++ )
+	{
+		if( !(usedMask & (1UL << i)) ) continue;
+		if( (brIn->rules[i].id != i) || !isRuleValid(&brIn->rules[i]) ) continue;
+
+		brIn->isRuleUsed[i] = true;
+		numRules++;
+	}
+	cxa_logger_info(&brIn->logger, "loaded %d rules", (int)numRules);
+}
+
+
+static bool saveToNvs(ovr_beaconRules_t *const brIn)
+{
+	cxa_assert(brIn);
+
+	uint32_t usedMask = 0;
+	for( size_t i = 0; i < OVR_BEACONRULES_MAXNUM_RULES; i++ )
+	{
+		if( brIn->isRuleUsed[i] ) usedMask |= (1UL << i);
+	}
+
+	if( !cxa_nvsManager_set_blob(NVS_KEY_RULES, (uint8_t*)brIn->rules, sizeof(brIn->rules)) ) return false;
+	if( !cxa_nvsManager_set_uint32(NVS_KEY_USEDMASK, usedMask) ) return false;
+	if( !cxa_nvsManager_set_uint32(NVS_KEY_VERSION, BYTECODE_VERSION) ) return false;
+	return cxa_nvsManager_commit();
+}
+
+
+static bool isRuleValid(ovr_beaconRules_rule_t *const ruleIn)
+{
+	cxa_assert(ruleIn);
+
+	return (ruleIn->codeSize_bytes > 0) && (ruleIn->codeSize_bytes <= OVR_BEACONRULES_MAXSIZE_BYTECODE) &&
+		   (ruleIn->numConsecutive >= 1) && (ruleIn->numConsecutive <= OVR_BEACONRULES_MAXNUM_CONSECUTIVE);
+}
+
+
+static bool emit(ovr_beaconRules_rule_t *const ruleIn, uint8_t byteIn)
+{
+	cxa_assert(ruleIn);
+
+	if( ruleIn->codeSize_bytes >= OVR_BEACONRULES_MAXSIZE_BYTECODE ) return false;
+	ruleIn->code[ruleIn->codeSize_bytes++] = byteIn;
+	return true;
+}
+
+
+static const fieldDescriptor_t* getFieldDescriptor(const char *const nameIn)
+{
+	cxa_assert(nameIn);
+
+	for( size_t i = 0; i < (sizeof(fields)/sizeof(*fields)); i++ )
+	{
+		if( strcmp(nameIn, fields[i].name) == 0 ) return &fields[i];
+	}
+	return NULL;
+}
+
+
+static int32_t getFieldValue(ovr_beaconUpdate_t *const updateIn, uint8_t fieldIdIn)
+{
+	cxa_assert(updateIn);
+
+	switch( fieldIdIn )
+	{
+		case FIELD_TEMP_C:			return updateIn->currTemp_deciDegC;
+		case FIELD_BATT_PCNT100:	return ovr_beaconUpdate_getBattery_pcnt100(updateIn);
+		case FIELD_BATT_MV:			return updateIn->batt_mv;
+		case FIELD_LIGHT_255:		return ovr_beaconUpdate_getLight_255(updateIn);
+		case FIELD_RSSI:			return ovr_beaconUpdate_getRssi(updateIn);
+		case FIELD_ISCHARGING:		return ovr_beaconUpdate_getIsCharging(updateIn);
+		case FIELD_ACTIVITY:		return updateIn->accelStatus.hasOccurred_activity;
+		case FIELD_1TAP:			return updateIn->accelStatus.hasOccurred_1tap;
+		case FIELD_2TAP:			return updateIn->accelStatus.hasOccurred_2tap;
+		case FIELD_FREEFALL:		return updateIn->accelStatus.hasOccurred_freeFall;
+		default:					return 0;
+	}
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setRule(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconRules_t* brIn = (ovr_beaconRules_t*)userVarIn;
+	cxa_assert(brIn);
+
+	// params: [id:1][text...]
+	uint8_t id;
+	if( !cxa_linkedField_get_uint8(paramsIn, 0, id) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( id >= OVR_BEACONRULES_MAXNUM_RULES ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	size_t textLen = cxa_linkedField_getSize_bytes(paramsIn) - SETRULE_HEADER_SIZE_BYTES;
+	if( (textLen == 0) || (textLen > OVR_BEACONRULES_MAXLEN_TEXT) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	char text[OVR_BEACONRULES_MAXLEN_TEXT+1];
+	memcpy(text, cxa_linkedField_get_pointerToIndex(paramsIn, SETRULE_HEADER_SIZE_BYTES), textLen);
+	text[textLen] = 0;
+
+	ovr_beaconRules_rule_t scratch;
+	if( !ovr_beaconRules_compile(text, id, &scratch) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	return ovr_beaconRules_setRule(brIn, id, text) ? CXA_MQTT_RPC_METHODRETVAL_SUCCESS : CXA_MQTT_RPC_METHODRETVAL_FAIL;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_removeRule(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconRules_t* brIn = (ovr_beaconRules_t*)userVarIn;
+	cxa_assert(brIn);
+
+	// params: [id:1]
+	uint8_t id;
+	if( !cxa_linkedField_get_uint8(paramsIn, 0, id) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( id >= OVR_BEACONRULES_MAXNUM_RULES ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	return ovr_beaconRules_removeRule(brIn, id) ? CXA_MQTT_RPC_METHODRETVAL_SUCCESS : CXA_MQTT_RPC_METHODRETVAL_FAIL;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getRules(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconRules_t* brIn = (ovr_beaconRules_t*)userVarIn;
+	cxa_assert(brIn);
+
+	// response: [numRules:1] then per rule [id:1][numConsecutive:1][codeSize:1]
+	ovr_beaconRules_rule_t rules[OVR_BEACONRULES_MAXNUM_RULES];
+	size_t numRules = ovr_beaconRules_getRules(brIn, rules, OVR_BEACONRULES_MAXNUM_RULES);
+
+	if( !cxa_linkedField_append_uint8(responseParamsIn, numRules) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	for( size_t i = 0; i < numRules; i++ )
+	{
+		if( !cxa_linkedField_append_uint8(responseParamsIn, rules[i].id) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint8(responseParamsIn, rules[i].numConsecutive) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint8(responseParamsIn, rules[i].codeSize_bytes) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	}
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getRuleStats(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_beaconRules_t* brIn = (ovr_beaconRules_t*)userVarIn;
+	cxa_assert(brIn);
+
+	// response: [numUpdates:4][numEvaluations:4][numAlerts:4][numPublishFailures:4][evalTime_total_us:4][evalTime_max_us:4]
+	ovr_beaconRules_stats_t stats = ovr_beaconRules_getStats(brIn);
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numUpdates) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numEvaluations) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numAlerts) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numPublishFailures) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.evalTime_total_us) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.evalTime_max_us) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
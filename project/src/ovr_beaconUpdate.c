@@ -118,6 +118,14 @@ ovr_beaconProxy_accelStatus_t ovr_beaconUpdate_getAccelStatus(ovr_beaconUpdate_t
 }
 
 
+uint8_t ovr_beaconUpdate_getAccelStatusByte(ovr_beaconUpdate_t *const updateIn)
+{
+	cxa_assert(updateIn);
+
+	return updateIn->accelStatus_raw;
+}
+
+
 uint8_t ovr_beaconUpdate_getBattery_pcnt100(ovr_beaconUpdate_t *const updateIn)
 {
 	cxa_assert(updateIn);
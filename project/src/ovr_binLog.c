@@ -0,0 +1,185 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_binLog.h"
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_ioStream.h>
+#include <cxa_runLoop.h>
+#include <cxa_timeBase.h>
+
+
+// ******** local macro definitions ********
+#define SLOT_INDEX_MASK					(OVR_BINLOG_NUM_SLOTS - 1)
+#define MAXNUM_ENTRIES_PER_ITERATION	4
+#define LINE_MAXSIZE_BYTES				160
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	uint32_t sequence;
+	ovr_binLog_entry_t entry;
+}slot_t;
+
+
+typedef struct
+{
+	const char* module;
+	const char* format;
+}formatDescriptor_t;
+
+
+// ******** local function prototypes ********
+static void cb_onRunLoopUpdate(void* userVarIn);
+
+
+// ********  local variable declarations *********
+#define FORMAT_DESCRIPTOR(idIn, moduleIn, fmtIn)		{ moduleIn, fmtIn },
+static const formatDescriptor_t formats[] = { OVR_BINLOG_FORMATS(FORMAT_DESCRIPTOR) };
+
+// indexed by CXA_LOG_LEVEL_*
+static const char* levelStrs[] = { "", "ERROR", "WARN", "INFO", "DEBUG", "TRACE" };
+
+static slot_t slots[OVR_BINLOG_NUM_SLOTS];
+static uint32_t writePos;
+static uint32_t readPos;
+static uint32_t numDropped;
+
+
+// ******** global function implementations ********
+void ovr_binLog_init(int threadIdIn)
+{
+	// each slot's sequence tells producers and the consumer whose turn it is
+	for( uint32_t i = 0; i < OVR_BINLOG_NUM_SLOTS; i++ )
+	{
+		__atomic_store_n(&slots[i].sequence, i, __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&writePos, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&readPos, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&numDropped, 0, __ATOMIC_RELAXED);
+
+	cxa_runLoop_addEntry(threadIdIn, cb_onRunLoopUpdate, NULL);
+}
+
+
+void ovr_binLog_write(uint8_t levelIn, ovr_binLog_fmtId_t fmtIdIn, const uint32_t *const argsIn, size_t numArgsIn)
+{
+	cxa_assert(argsIn);
+	cxa_assert(numArgsIn <= OVR_BINLOG_MAXNUM_ARGS);
+
+	// claim a slot (bounded multi-producer queue)
+	slot_t* slot;
+	uint32_t pos = __atomic_load_n(&writePos, __ATOMIC_RELAXED);
+	while( true )
+	{
+		slot = &slots[pos & SLOT_INDEX_MASK];
+		int32_t diff = (int32_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - pos);
+		if( diff == 0 )
+		{
+			if( __atomic_compare_exchange_n(&writePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) ) break;
+		}
+		else if( diff < 0 )
+		{
+			// full...never block the caller
+			__atomic_fetch_add(&numDropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+		else
+		{
+			pos = __atomic_load_n(&writePos, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->entry.timestamp_ms = cxa_timeBase_getCount_us() / 1000;
+	slot->entry.fmtId = fmtIdIn;
+	slot->entry.level = levelIn;
+	slot->entry.numArgs = numArgsIn;
+	memcpy(slot->entry.args, argsIn, numArgsIn * sizeof(*argsIn));
+
+	// publish it to the consumer
+	__atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+}
+
+
+bool ovr_binLog_read(ovr_binLog_entry_t *const entryOut)
+{
+	cxa_assert(entryOut);
+
+	uint32_t pos = __atomic_load_n(&readPos, __ATOMIC_RELAXED);
+	slot_t* slot = &slots[pos & SLOT_INDEX_MASK];
+	if( __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != (pos + 1) ) return false;
+
+	*entryOut = slot->entry;
+
+	// hand the slot back to the producers for the next lap
+	__atomic_store_n(&slot->sequence, pos + OVR_BINLOG_NUM_SLOTS, __ATOMIC_RELEASE);
+	__atomic_store_n(&readPos, pos + 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+
+void ovr_binLog_format(ovr_binLog_entry_t *const entryIn, char *const bufferOut, size_t maxSize_bytesIn)
+{
+	cxa_assert(entryIn);
+	cxa_assert(bufferOut);
+
+	if( entryIn->fmtId >= OVR_BINLOG_NUM_FMTIDS )
+	{
+		snprintf(bufferOut, maxSize_bytesIn, "%d [binLog] unknown format %d", (int)entryIn->timestamp_ms, entryIn->fmtId);
+		return;
+	}
+	const formatDescriptor_t* desc = &formats[entryIn->fmtId];
+
+	// unused args are zeroed so surplus conversions are harmless
+	uint32_t args[OVR_BINLOG_MAXNUM_ARGS] = {0};
+	memcpy(args, entryIn->args, entryIn->numArgs * sizeof(*args));
+
+	const char* levelStr = (entryIn->level < (sizeof(levelStrs)/sizeof(*levelStrs))) ? levelStrs[entryIn->level] : "";
+	int prefixLen = snprintf(bufferOut, maxSize_bytesIn, "%d [%s] %s ", (int)entryIn->timestamp_ms, desc->module, levelStr);
+	if( (prefixLen < 0) || ((size_t)prefixLen >= maxSize_bytesIn) ) return;
+
+	snprintf(&bufferOut[prefixLen], maxSize_bytesIn - prefixLen, desc->format,
+			 args[0], args[1], args[2], args[3], args[4],
+			 args[5], args[6], args[7], args[8], args[9]);
+}
+
+
+uint32_t ovr_binLog_getNumDropped(void)
+{
+	return __atomic_load_n(&numDropped, __ATOMIC_RELAXED);
+}
+
+
+// ******** local function implementations ********
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	cxa_ioStream_t* ioStream = cxa_logger_getGlobalIoStream();
+	if( ioStream == NULL ) return;
+
+	// bounded so we don't hog our (low priority) thread
+	ovr_binLog_entry_t currEntry;
+	for( int i = 0; (i < MAXNUM_ENTRIES_PER_ITERATION) && ovr_binLog_read(&currEntry); i++ )
+	{
+		char line[LINE_MAXSIZE_BYTES];
+		ovr_binLog_format(&currEntry, line, sizeof(line));
+		cxa_ioStream_writeLine(ioStream, line);
+	}
+}
@@ -0,0 +1,275 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_config.h"
+
+
+// ******** includes ********
+#include <stdio.h>
+
+#include <cxa_assert.h>
+#include <cxa_console.h>
+#include <cxa_criticalSection.h>
+#include <cxa_nvsManager.h>
+
+
+// ******** local macro definitions ********
+#ifndef OVR_CONFIG_DEFAULT_UPDATE_PERIOD_MS
+	#define OVR_CONFIG_DEFAULT_UPDATE_PERIOD_MS			60000
+#endif
+
+#ifndef OVR_CONFIG_DEFAULT_CHECKIN_PERIOD_MS
+	#define OVR_CONFIG_DEFAULT_CHECKIN_PERIOD_MS		60000
+#endif
+
+#ifndef OVR_CONFIG_DEFAULT_SENSORREAD_PERIOD_MS
+	#define OVR_CONFIG_DEFAULT_SENSORREAD_PERIOD_MS		60000
+#endif
+
+#ifndef OVR_CONFIG_DEFAULT_SCANCHECK_PERIOD_MS
+	#define OVR_CONFIG_DEFAULT_SCANCHECK_PERIOD_MS		10000
+#endif
+
+#ifndef OVR_CONFIG_DEFAULT_LOSTTIMEOUT_MS
+	#define OVR_CONFIG_DEFAULT_LOSTTIMEOUT_MS			60000
+#endif
+
+#define NVS_KEY_PROFILE							"cfg_profile"
+#define SET_ENTRY_SIZE_BYTES					5
+#define LINE_MAXSIZE_BYTES						80
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static bool isInRange(ovr_config_id_t idIn, uint32_t valueIn);
+static void loadValues(void);
+static bool saveValues(void);
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_get(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_set(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setProfile(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+
+static void consoleCb_config(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+// profiles: { default, low latency, low bandwidth }
+static const ovr_config_entryInfo_t entryInfos[OVR_CONFIG_NUM_IDS] =
+{
+	{ "updatePeriod_ms",		"cfg_updPeriod",	5000,	3600000,	{ OVR_CONFIG_DEFAULT_UPDATE_PERIOD_MS,		10000,	300000 } },
+	{ "checkinPeriod_ms",		"cfg_chkPeriod",	10000,	3600000,	{ OVR_CONFIG_DEFAULT_CHECKIN_PERIOD_MS,		30000,	300000 } },
+	{ "sensorReadPeriod_ms",	"cfg_snsPeriod",	5000,	3600000,	{ OVR_CONFIG_DEFAULT_SENSORREAD_PERIOD_MS,	15000,	300000 } },
+	{ "scanCheckPeriod_ms",		"cfg_scanPeriod",	1000,	60000,		{ OVR_CONFIG_DEFAULT_SCANCHECK_PERIOD_MS,	5000,	30000 } },
+	{ "lostTimeout_ms",			"cfg_lostTimeout",	10000,	300000,		{ OVR_CONFIG_DEFAULT_LOSTTIMEOUT_MS,		30000,	180000 } },
+};
+
+static bool isInit = false;
+
+static cxa_mqtt_rpc_node_t rpcNode;
+
+static uint32_t values[OVR_CONFIG_NUM_IDS];
+static uint8_t profile;
+
+
+// ******** global function implementations ********
+void ovr_config_init(cxa_mqtt_rpc_node_t *const rootNodeIn)
+{
+	loadValues();
+	__atomic_store_n(&isInit, true, __ATOMIC_RELEASE);
+
+	if( rootNodeIn != NULL )
+	{
+		cxa_mqtt_rpc_node_init_formattedString(&rpcNode, rootNodeIn, "config");
+		cxa_mqtt_rpc_node_addMethod(&rpcNode, "get", rpcMethodCb_get, NULL);
+		cxa_mqtt_rpc_node_addMethod(&rpcNode, "set", rpcMethodCb_set, NULL);
+		cxa_mqtt_rpc_node_addMethod(&rpcNode, "setProfile", rpcMethodCb_setProfile, NULL);
+	}
+
+	cxa_console_addCommand("config", "lists runtime config", NULL, 0, consoleCb_config, NULL);
+}
+
+
+uint32_t ovr_config_get(ovr_config_id_t idIn)
+{
+	cxa_assert(idIn < OVR_CONFIG_NUM_IDS);
+
+	if( !__atomic_load_n(&isInit, __ATOMIC_ACQUIRE) ) return entryInfos[idIn].profileValues[OVR_CONFIG_PROFILE_DEFAULT];
+	return __atomic_load_n(&values[idIn], __ATOMIC_RELAXED);
+}
+
+
+bool ovr_config_set(const ovr_config_id_t *const idsIn, const uint32_t *const valuesIn, size_t numValuesIn)
+{
+	cxa_assert(idsIn);
+	cxa_assert(valuesIn);
+
+	for( size_t i = 0; i < numValuesIn; i++ )
+	{
+		if( !isInRange(idsIn[i], valuesIn[i]) ) return false;
+	}
+
+	cxa_criticalSection_enter();
+	for( size_t i = 0; i < numValuesIn; i++ )
+	{
+		__atomic_store_n(&values[idsIn[i]], valuesIn[i], __ATOMIC_RELAXED);
+	}
+	profile = OVR_CONFIG_PROFILE_CUSTOM;
+	cxa_criticalSection_exit();
+
+	return saveValues();
+}
+
+
+bool ovr_config_applyProfile(ovr_config_profile_t profileIn)
+{
+	if( profileIn >= OVR_CONFIG_PROFILE_CUSTOM ) return false;
+
+	cxa_criticalSection_enter();
+	for( size_t i = 0; i < OVR_CONFIG_NUM_IDS; i++ )
+	{
+		__atomic_store_n(&values[i], entryInfos[i].profileValues[profileIn], __ATOMIC_RELAXED);
+	}
+	profile = profileIn;
+	cxa_criticalSection_exit();
+
+	return saveValues();
+}
+
+
+ovr_config_profile_t ovr_config_getProfile(void)
+{
+	return (ovr_config_profile_t)profile;
+}
+
+
+const ovr_config_entryInfo_t* ovr_config_getEntryInfo(ovr_config_id_t idIn)
+{
+	return (idIn < OVR_CONFIG_NUM_IDS) ? &entryInfos[idIn] : NULL;
+}
+
+
+// ******** local function implementations ********
+static bool isInRange(ovr_config_id_t idIn, uint32_t valueIn)
+{
+	if( idIn >= OVR_CONFIG_NUM_IDS ) return false;
+	return (valueIn >= entryInfos[idIn].min) && (valueIn <= entryInfos[idIn].max);
+}
+
+
+static void loadValues(void)
+{
+	uint32_t profile_raw;
+	if( !cxa_nvsManager_get_uint32(NVS_KEY_PROFILE, &profile_raw) || (profile_raw > OVR_CONFIG_PROFILE_CUSTOM) ) profile_raw = OVR_CONFIG_PROFILE_DEFAULT;
+	profile = profile_raw;
+
+	// presets come from the firmware (so they can be retuned by an update)...only custom values are read back
+	for( size_t i = 0; i < OVR_CONFIG_NUM_IDS; i++ )
+	{
+		uint32_t value = entryInfos[i].profileValues[(profile == OVR_CONFIG_PROFILE_CUSTOM) ? OVR_CONFIG_PROFILE_DEFAULT : profile];
+
+		uint32_t value_raw;
+		if( (profile == OVR_CONFIG_PROFILE_CUSTOM) &&
+			cxa_nvsManager_get_uint32(entryInfos[i].nvsKey, &value_raw) &&
+			isInRange((ovr_config_id_t)i, value_raw) ) value = value_raw;
+
+		values[i] = value;
+	}
+}
+
+
+static bool saveValues(void)
+{
+	for( size_t i = 0; i < OVR_CONFIG_NUM_IDS; i++ )
+	{
+		if( !cxa_nvsManager_set_uint32(entryInfos[i].nvsKey, ovr_config_get((ovr_config_id_t)i)) ) return false;
+	}
+	if( !cxa_nvsManager_set_uint32(NVS_KEY_PROFILE, profile) ) return false;
+
+	// one commit so a reboot sees all of the new values or none of them
+	return cxa_nvsManager_commit();
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_get(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	// response: [profile:1][numIds:1] then for each id: [value:4][min:4][max:4]
+	if( !cxa_linkedField_append_uint8(responseParamsIn, profile) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint8(responseParamsIn, OVR_CONFIG_NUM_IDS) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	for( size_t i = 0; i < OVR_CONFIG_NUM_IDS; i++ )
+	{
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, ovr_config_get((ovr_config_id_t)i)) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, entryInfos[i].min) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, entryInfos[i].max) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	}
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_set(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	// params: [id:1][value:4]...
+	// all or nothing (out of range values fail the whole call)
+	size_t size_bytes = cxa_linkedField_getSize_bytes(paramsIn);
+	if( (size_bytes == 0) || ((size_bytes % SET_ENTRY_SIZE_BYTES) != 0) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	size_t numValues = size_bytes / SET_ENTRY_SIZE_BYTES;
+	if( numValues > OVR_CONFIG_NUM_IDS ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	ovr_config_id_t ids[OVR_CONFIG_NUM_IDS];
+	uint32_t newValues[OVR_CONFIG_NUM_IDS];
+	for( size_t i = 0; i < numValues; i++ )
+	{
+		uint8_t id;
+		if( !cxa_linkedField_get_uint8(paramsIn, (i * SET_ENTRY_SIZE_BYTES), id) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+		if( !cxa_linkedField_get_uint32LE(paramsIn, (i * SET_ENTRY_SIZE_BYTES) + 1, newValues[i]) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+		ids[i] = (ovr_config_id_t)id;
+
+		if( !isInRange(ids[i], newValues[i]) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	}
+
+	return ovr_config_set(ids, newValues, numValues) ? CXA_MQTT_RPC_METHODRETVAL_SUCCESS : CXA_MQTT_RPC_METHODRETVAL_FAIL;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setProfile(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	// params: [profile:1]
+	uint8_t newProfile;
+	if( !cxa_linkedField_get_uint8(paramsIn, 0, newProfile) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( newProfile >= OVR_CONFIG_PROFILE_CUSTOM ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	return ovr_config_applyProfile((ovr_config_profile_t)newProfile) ? CXA_MQTT_RPC_METHODRETVAL_SUCCESS : CXA_MQTT_RPC_METHODRETVAL_FAIL;
+}
+
+
+static void consoleCb_config(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn)
+{
+	static const char* profileNames[] = { "default", "lowLatency", "lowBandwidth", "custom" };
+
+	char line[LINE_MAXSIZE_BYTES];
+	snprintf(line, sizeof(line), "profile: %s", profileNames[profile]);
+	cxa_ioStream_writeLine(ioStreamIn, line);
+
+	for( size_t i = 0; i < OVR_CONFIG_NUM_IDS; i++ )
+	{
+		snprintf(line, sizeof(line), "%-20s %8u  [%u - %u]", entryInfos[i].name, (unsigned)ovr_config_get((ovr_config_id_t)i),
+				 (unsigned)entryInfos[i].min, (unsigned)entryInfos[i].max);
+		cxa_ioStream_writeLine(ioStreamIn, line);
+	}
+}
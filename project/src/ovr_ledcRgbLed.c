@@ -0,0 +1,296 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_ledcRgbLed.h"
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_criticalSection.h>
+#include <cxa_runLoop.h>
+
+
+// ******** local macro definitions ********
+#define SPEED_MODE							LEDC_HIGH_SPEED_MODE
+#define DUTY_RESOLUTION						LEDC_TIMER_8_BIT
+#define DUTY_MAX							255
+
+// leave the peripheral time to finish one fade before we start the next
+#define FADE_TIME_PCNT						80
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void cb_onRunLoopUpdate(void* userVarIn);
+
+static void applyRequest(ovr_ledcRgbLed_t *const ledIn, ovr_ledcRgbLed_request_t *const reqIn);
+static void updateBlink(ovr_ledcRgbLed_t *const ledIn);
+static void updateActivity(ovr_ledcRgbLed_t *const ledIn);
+
+static void writeRgb(ovr_ledcRgbLed_t *const ledIn, const uint8_t *const rgbIn);
+static void fadeToRgb(ovr_ledcRgbLed_t *const ledIn, const uint8_t *const rgbIn, uint32_t fadeTime_msIn);
+static uint32_t getDuty(ovr_ledcRgbLed_t *const ledIn, uint8_t valueIn);
+
+
+// ********  local variable declarations *********
+static bool isPeripheralInit = false;
+
+
+// ******** global function implementations ********
+bool ovr_ledcRgbLed_init(ovr_ledcRgbLed_t *const ledIn, int gpioNum_rIn, int gpioNum_gIn, int gpioNum_bIn, bool isInvertedIn,
+						 ledc_channel_t firstChannelIn, int threadIdIn)
+{
+	cxa_assert(ledIn);
+	cxa_assert((firstChannelIn + OVR_LEDCRGBLED_NUM_CHANNELS) <= LEDC_CHANNEL_MAX);
+
+	// save our references
+	ledIn->isInverted = isInvertedIn;
+
+	// setup our internal state
+	memset(&ledIn->request, 0, sizeof(ledIn->request));
+	ledIn->request.mode = OVR_LEDCRGBLED_MODE_SOLID;
+	ledIn->isRequestPending = false;
+	ledIn->current = ledIn->request;
+	cxa_timeDiff_init(&ledIn->td_phase);
+	ledIn->isPhaseOn = true;
+
+	// the timer and fade service are shared by every led
+	if( !isPeripheralInit )
+	{
+		ledc_timer_config_t timerConfig;
+		memset(&timerConfig, 0, sizeof(timerConfig));
+		timerConfig.speed_mode = SPEED_MODE;
+		timerConfig.duty_resolution = DUTY_RESOLUTION;
+		timerConfig.timer_num = OVR_LEDCRGBLED_TIMER;
+		timerConfig.freq_hz = OVR_LEDCRGBLED_FREQ_HZ;
+		if( ledc_timer_config(&timerConfig) != ESP_OK ) return false;
+		if( ledc_fade_func_install(0) != ESP_OK ) return false;
+
+		isPeripheralInit = true;
+	}
+
+	// start with the led off
+	int gpioNums[OVR_LEDCRGBLED_NUM_CHANNELS] = {gpioNum_rIn, gpioNum_gIn, gpioNum_bIn};
+	for( size_t i = 0; i < OVR_LEDCRGBLED_NUM_CHANNELS; i++ )
+	{
+		ledIn->channels[i] = firstChannelIn + i;
+
+		ledc_channel_config_t channelConfig;
+		memset(&channelConfig, 0, sizeof(channelConfig));
+		channelConfig.gpio_num = gpioNums[i];
+		channelConfig.speed_mode = SPEED_MODE;
+		channelConfig.channel = ledIn->channels[i];
+		channelConfig.intr_type = LEDC_INTR_DISABLE;
+		channelConfig.timer_sel = OVR_LEDCRGBLED_TIMER;
+		channelConfig.duty = getDuty(ledIn, 0);
+		if( ledc_channel_config(&channelConfig) != ESP_OK ) return false;
+	}
+
+	cxa_runLoop_addEntry(threadIdIn, cb_onRunLoopUpdate, (void*)ledIn);
+
+	return true;
+}
+
+
+void ovr_ledcRgbLed_setRgb(ovr_ledcRgbLed_t *const ledIn, uint8_t rIn, uint8_t gIn, uint8_t bIn)
+{
+	cxa_assert(ledIn);
+
+	cxa_criticalSection_enter();
+	ledIn->request.mode = OVR_LEDCRGBLED_MODE_SOLID;
+	ledIn->request.rgb[0] = rIn;
+	ledIn->request.rgb[1] = gIn;
+	ledIn->request.rgb[2] = bIn;
+	ledIn->isRequestPending = true;
+	cxa_criticalSection_exit();
+}
+
+
+void ovr_ledcRgbLed_blink(ovr_ledcRgbLed_t *const ledIn, uint8_t rIn, uint8_t gIn, uint8_t bIn, uint16_t onPeriod_msIn, uint16_t offPeriod_msIn)
+{
+	cxa_assert(ledIn);
+
+	cxa_criticalSection_enter();
+	ledIn->request.mode = OVR_LEDCRGBLED_MODE_BLINK;
+	ledIn->request.rgb[0] = rIn;
+	ledIn->request.rgb[1] = gIn;
+	ledIn->request.rgb[2] = bIn;
+	ledIn->request.onPeriod_ms = onPeriod_msIn;
+	ledIn->request.offPeriod_ms = offPeriod_msIn;
+	ledIn->isRequestPending = true;
+	cxa_criticalSection_exit();
+}
+
+
+void ovr_ledcRgbLed_setActivity(ovr_ledcRgbLed_t *const ledIn, uint8_t depthIn, uint16_t period_msIn)
+{
+	cxa_assert(ledIn);
+
+	cxa_criticalSection_enter();
+	ledIn->request.activityDepth_255 = depthIn;
+	ledIn->request.activityPeriod_ms = period_msIn;
+	ledIn->isRequestPending = true;
+	cxa_criticalSection_exit();
+}
+
+
+void ovr_ledcRgbLed_forceRgb(ovr_ledcRgbLed_t *const ledIn, uint8_t rIn, uint8_t gIn, uint8_t bIn)
+{
+	cxa_assert(ledIn);
+
+	uint8_t rgb[OVR_LEDCRGBLED_NUM_CHANNELS] = {rIn, gIn, bIn};
+	writeRgb(ledIn, rgb);
+}
+
+
+// ******** local function implementations ********
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	ovr_ledcRgbLed_t* ledIn = (ovr_ledcRgbLed_t*)userVarIn;
+	cxa_assert(ledIn);
+
+	// pick up anything requested from other threads
+	ovr_ledcRgbLed_request_t req;
+	bool isRequestPending;
+	cxa_criticalSection_enter();
+	req = ledIn->request;
+	isRequestPending = ledIn->isRequestPending;
+	ledIn->isRequestPending = false;
+	cxa_criticalSection_exit();
+	if( isRequestPending ) applyRequest(ledIn, &req);
+
+	switch( ledIn->current.mode )
+	{
+		case OVR_LEDCRGBLED_MODE_SOLID:
+			updateActivity(ledIn);
+			break;
+
+		case OVR_LEDCRGBLED_MODE_BLINK:
+			updateBlink(ledIn);
+			break;
+	}
+}
+
+
+static void applyRequest(ovr_ledcRgbLed_t *const ledIn, ovr_ledcRgbLed_request_t *const reqIn)
+{
+	cxa_assert(ledIn);
+	cxa_assert(reqIn);
+
+	bool didLookChange = (reqIn->mode != ledIn->current.mode) ||
+						 (memcmp(reqIn->rgb, ledIn->current.rgb, sizeof(reqIn->rgb)) != 0) ||
+						 (reqIn->onPeriod_ms != ledIn->current.onPeriod_ms) ||
+						 (reqIn->offPeriod_ms != ledIn->current.offPeriod_ms);
+
+	ledIn->current = *reqIn;
+
+	// activity changes alone take effect at the next phase (so a dip always fades back up)
+	if( !didLookChange ) return;
+
+	// start over, fully lit
+	writeRgb(ledIn, ledIn->current.rgb);
+	ledIn->isPhaseOn = true;
+	cxa_timeDiff_setStartTime_now(&ledIn->td_phase);
+}
+
+
+static void updateBlink(ovr_ledcRgbLed_t *const ledIn)
+{
+	cxa_assert(ledIn);
+
+	if( ledIn->isPhaseOn && cxa_timeDiff_isElapsed_ms(&ledIn->td_phase, ledIn->current.onPeriod_ms) )
+	{
+		uint8_t off[OVR_LEDCRGBLED_NUM_CHANNELS] = {0, 0, 0};
+		writeRgb(ledIn, off);
+		ledIn->isPhaseOn = false;
+		cxa_timeDiff_setStartTime_now(&ledIn->td_phase);
+	}
+	else if( !ledIn->isPhaseOn && cxa_timeDiff_isElapsed_ms(&ledIn->td_phase, ledIn->current.offPeriod_ms) )
+	{
+		writeRgb(ledIn, ledIn->current.rgb);
+		ledIn->isPhaseOn = true;
+		cxa_timeDiff_setStartTime_now(&ledIn->td_phase);
+	}
+}
+
+
+static void updateActivity(ovr_ledcRgbLed_t *const ledIn)
+{
+	cxa_assert(ledIn);
+
+	// each period is split between fading down and fading back up
+	uint32_t halfPeriod_ms = ledIn->current.activityPeriod_ms / 2;
+	uint32_t fadeTime_ms = (halfPeriod_ms * FADE_TIME_PCNT) / 100;
+	if( !cxa_timeDiff_isElapsed_ms(&ledIn->td_phase, halfPeriod_ms) ) return;
+
+	if( ledIn->isPhaseOn )
+	{
+		// only start a dip if there's still activity to show
+		if( ledIn->current.activityDepth_255 == 0 ) return;
+
+		uint8_t dimmed[OVR_LEDCRGBLED_NUM_CHANNELS];
+		for( size_t i = 0; i < OVR_LEDCRGBLED_NUM_CHANNELS; i++ )
+		{
+			dimmed[i] = (ledIn->current.rgb[i] * (DUTY_MAX - ledIn->current.activityDepth_255)) / DUTY_MAX;
+		}
+		fadeToRgb(ledIn, dimmed, fadeTime_ms);
+		ledIn->isPhaseOn = false;
+	}
+	else
+	{
+		fadeToRgb(ledIn, ledIn->current.rgb, fadeTime_ms);
+		ledIn->isPhaseOn = true;
+	}
+	cxa_timeDiff_setStartTime_now(&ledIn->td_phase);
+}
+
+
+static void writeRgb(ovr_ledcRgbLed_t *const ledIn, const uint8_t *const rgbIn)
+{
+	cxa_assert(ledIn);
+	cxa_assert(rgbIn);
+
+	for( size_t i = 0; i < OVR_LEDCRGBLED_NUM_CHANNELS; i++ )
+	{
+		ledc_set_duty(SPEED_MODE, ledIn->channels[i], getDuty(ledIn, rgbIn[i]));
+		ledc_update_duty(SPEED_MODE, ledIn->channels[i]);
+	}
+}
+
+
+static void fadeToRgb(ovr_ledcRgbLed_t *const ledIn, const uint8_t *const rgbIn, uint32_t fadeTime_msIn)
+{
+	cxa_assert(ledIn);
+	cxa_assert(rgbIn);
+
+	// the peripheral steps the duty from here on, we don't need to come back until the next phase
+	for( size_t i = 0; i < OVR_LEDCRGBLED_NUM_CHANNELS; i++ )
+	{
+		ledc_set_fade_with_time(SPEED_MODE, ledIn->channels[i], getDuty(ledIn, rgbIn[i]), fadeTime_msIn);
+		ledc_fade_start(SPEED_MODE, ledIn->channels[i], LEDC_FADE_NO_WAIT);
+	}
+}
+
+
+static uint32_t getDuty(ovr_ledcRgbLed_t *const ledIn, uint8_t valueIn)
+{
+	cxa_assert(ledIn);
+
+	return ledIn->isInverted ? (DUTY_MAX - valueIn) : valueIn;
+}
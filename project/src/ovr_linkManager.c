@@ -0,0 +1,271 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_linkManager.h"
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_event_loop.h"
+#include "tcpip_adapter.h"
+#include "lwip/netif.h"
+
+#include <cxa_assert.h>
+#include <cxa_console.h>
+#include <cxa_criticalSection.h>
+#include <cxa_fixedFifo.h>
+#include <cxa_mqtt_client.h>
+#include <cxa_mqtt_connectionManager.h>
+#include <cxa_runLoop.h>
+#include <cxa_timeBase.h>
+
+#define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
+#include <cxa_logger_implementation.h>
+
+
+// ******** local macro definitions ********
+#define LINE_MAXSIZE_BYTES						80
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	uint8_t link;
+	uint8_t event;
+	ip4_addr_t ip;								///< only for OVR_LINKSELECTOR_EVENT_GOTIP
+}linkEvent_t;
+
+
+// ******** local function prototypes ********
+static esp_err_t espCb_onEvent(void *ctxIn, system_event_t *eventIn);
+static void cb_onRunLoopUpdate(void* userVarIn);
+
+static void onActiveLinkChanged(void);
+static uint32_t getNow_ms(void);
+
+static void consoleCb_link(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+static ovr_linkSelector_t linkSelector;
+static ovr_linkSelector_link_t activeLink = OVR_LINKSELECTOR_LINK_NONE;
+static ovr_linkSelector_stats_t stats;
+
+// filled on the esp event task, drained on our thread
+static cxa_fixedFifo_t eventQueue;
+static linkEvent_t eventQueue_raw[OVR_LINKMANAGER_MAXNUM_QUEUED_EVENTS];
+static uint32_t numEventsDropped = 0;
+
+static system_event_cb_t prevEventCb = NULL;
+
+static uint32_t clock_ms = 0;
+static uint32_t clockLast_us = 0;
+
+static cxa_logger_t logger;
+
+
+// ******** global function implementations ********
+void ovr_linkManager_init(int threadIdIn)
+{
+	cxa_logger_init(&logger, "linkManager");
+
+	ovr_linkSelector_init(&linkSelector, OVR_LINKMANAGER_PREFERRED_LINK);
+	stats = ovr_linkSelector_getStats(&linkSelector);
+	cxa_fixedFifo_init(&eventQueue, CXA_FF_ON_FULL_DROP, sizeof(*eventQueue_raw), (void *const)eventQueue_raw, sizeof(eventQueue_raw));
+	clockLast_us = cxa_timeBase_getCount_us();
+
+	// the event loop only takes one callback so we chain to whoever was there before
+	// (note that their context can't be recovered, they'll see ours)
+	prevEventCb = esp_event_loop_set_cb(espCb_onEvent, NULL);
+
+	cxa_runLoop_addEntry(threadIdIn, cb_onRunLoopUpdate, NULL);
+	cxa_console_addCommand("link", "uplink state and stats", NULL, 0, consoleCb_link, NULL);
+}
+
+
+ovr_linkSelector_link_t ovr_linkManager_getActiveLink(void)
+{
+	return __atomic_load_n(&activeLink, __ATOMIC_RELAXED);
+}
+
+
+ovr_linkSelector_stats_t ovr_linkManager_getStats(void)
+{
+	cxa_criticalSection_enter();
+	ovr_linkSelector_stats_t retVal = stats;
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+// ******** local function implementations ********
+static esp_err_t espCb_onEvent(void *ctxIn, system_event_t *eventIn)
+{
+	linkEvent_t linkEvent;
+	memset(&linkEvent, 0, sizeof(linkEvent));
+	bool isLinkEvent = true;
+	switch( eventIn->event_id )
+	{
+		case SYSTEM_EVENT_ETH_CONNECTED:
+			linkEvent.link = OVR_LINKSELECTOR_LINK_ETH;
+			linkEvent.event = OVR_LINKSELECTOR_EVENT_LINKUP;
+			break;
+
+		case SYSTEM_EVENT_ETH_DISCONNECTED:
+		case SYSTEM_EVENT_ETH_STOP:
+			linkEvent.link = OVR_LINKSELECTOR_LINK_ETH;
+			linkEvent.event = OVR_LINKSELECTOR_EVENT_LINKDOWN;
+			break;
+
+		case SYSTEM_EVENT_ETH_GOT_IP:
+			linkEvent.link = OVR_LINKSELECTOR_LINK_ETH;
+			linkEvent.event = OVR_LINKSELECTOR_EVENT_GOTIP;
+			linkEvent.ip = eventIn->event_info.got_ip.ip_info.ip;
+			break;
+
+		case SYSTEM_EVENT_STA_CONNECTED:
+			linkEvent.link = OVR_LINKSELECTOR_LINK_WIFI;
+			linkEvent.event = OVR_LINKSELECTOR_EVENT_LINKUP;
+			break;
+
+		case SYSTEM_EVENT_STA_DISCONNECTED:
+		case SYSTEM_EVENT_STA_STOP:
+			linkEvent.link = OVR_LINKSELECTOR_LINK_WIFI;
+			linkEvent.event = OVR_LINKSELECTOR_EVENT_LINKDOWN;
+			break;
+
+		case SYSTEM_EVENT_STA_GOT_IP:
+			linkEvent.link = OVR_LINKSELECTOR_LINK_WIFI;
+			linkEvent.event = OVR_LINKSELECTOR_EVENT_GOTIP;
+			linkEvent.ip = eventIn->event_info.got_ip.ip_info.ip;
+			break;
+
+		case SYSTEM_EVENT_STA_LOST_IP:
+			linkEvent.link = OVR_LINKSELECTOR_LINK_WIFI;
+			linkEvent.event = OVR_LINKSELECTOR_EVENT_LOSTIP;
+			break;
+
+		default:
+			isLinkEvent = false;
+			break;
+	}
+
+	if( isLinkEvent )
+	{
+		cxa_criticalSection_enter();
+		if( !cxa_fixedFifo_queue(&eventQueue, (void*)&linkEvent) ) numEventsDropped++;
+		cxa_criticalSection_exit();
+	}
+
+	return (prevEventCb != NULL) ? prevEventCb(ctxIn, eventIn) : ESP_OK;
+}
+
+
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	uint32_t now_ms = getNow_ms();
+	bool didProcessEvents = false;
+	bool didActiveLinkChange = false;
+
+	linkEvent_t linkEvent;
+	while( true )
+	{
+		cxa_criticalSection_enter();
+		bool hasEvent = cxa_fixedFifo_dequeue(&eventQueue, (void*)&linkEvent);
+		cxa_criticalSection_exit();
+		if( !hasEvent ) break;
+		didProcessEvents = true;
+
+		if( linkEvent.event == OVR_LINKSELECTOR_EVENT_GOTIP )
+		{
+			cxa_logger_info(&logger, "%s got ip " IPSTR, ovr_linkSelector_getLinkName(linkEvent.link), IP2STR(&linkEvent.ip));
+		}
+		if( ovr_linkSelector_onEvent(&linkSelector, linkEvent.link, linkEvent.event, now_ms) ) didActiveLinkChange = true;
+	}
+
+	// fail back once the preferred link has been usable long enough
+	if( ovr_linkSelector_update(&linkSelector, now_ms) ) didActiveLinkChange = true;
+
+	if( didProcessEvents || didActiveLinkChange )
+	{
+		cxa_criticalSection_enter();
+		stats = ovr_linkSelector_getStats(&linkSelector);
+		cxa_criticalSection_exit();
+	}
+	if( didActiveLinkChange ) onActiveLinkChanged();
+}
+
+
+static void onActiveLinkChanged(void)
+{
+	ovr_linkSelector_link_t newLink = ovr_linkSelector_getActiveLink(&linkSelector);
+	__atomic_store_n(&activeLink, newLink, __ATOMIC_RELAXED);
+
+	if( newLink != OVR_LINKSELECTOR_LINK_NONE )
+	{
+		// route everything over the new link
+		struct netif* newNetif = NULL;
+		tcpip_adapter_if_t newIf = (newLink == OVR_LINKSELECTOR_LINK_ETH) ? TCPIP_ADAPTER_IF_ETH : TCPIP_ADAPTER_IF_STA;
+		if( (tcpip_adapter_get_netif(newIf, (void**)&newNetif) == ESP_OK) && (newNetif != NULL) ) netif_set_default(newNetif);
+
+		cxa_logger_info(&logger, "uplink is now %s", ovr_linkSelector_getLinkName(newLink));
+	}
+	else cxa_logger_warn(&logger, "no usable uplink");
+
+	// the mqtt connection is tied to the old link's address, reconnect now rather than waiting for keepalives
+	cxa_mqtt_client_t* mqttC = cxa_mqtt_connManager_getMqttClient();
+	if( (mqttC != NULL) && cxa_mqtt_client_isConnected(mqttC) ) cxa_mqtt_client_disconnect(mqttC);
+}
+
+
+static uint32_t getNow_ms(void)
+{
+	// our own millisecond clock so it doesn't wrap with the microsecond timebase
+	uint32_t curr_us = cxa_timeBase_getCount_us();
+	uint32_t elapsed_us = curr_us - clockLast_us;
+	clock_ms += elapsed_us / 1000;
+	clockLast_us = curr_us - (elapsed_us % 1000);
+
+	return clock_ms;
+}
+
+
+static void consoleCb_link(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn)
+{
+	char line[LINE_MAXSIZE_BYTES];
+
+	snprintf(line, sizeof(line), "active: %s", ovr_linkSelector_getLinkName(ovr_linkManager_getActiveLink()));
+	cxa_ioStream_writeLine(ioStreamIn, line);
+
+	for( size_t i = 0; i < OVR_LINKSELECTOR_NUM_LINKS; i++ )
+	{
+		snprintf(line, sizeof(line), "%-5s up:%d ip:%d%s", ovr_linkSelector_getLinkName(i),
+				 linkSelector.links[i].isUp, linkSelector.links[i].hasIp,
+				 (i == OVR_LINKMANAGER_PREFERRED_LINK) ? "  (preferred)" : "");
+		cxa_ioStream_writeLine(ioStreamIn, line);
+	}
+
+	ovr_linkSelector_stats_t currStats = ovr_linkManager_getStats();
+	snprintf(line, sizeof(line), "changes: %u  failovers: %u  outages: %u  dropped: %u",
+			 (unsigned)currStats.numLinkChanges, (unsigned)currStats.numFailovers, (unsigned)currStats.numOutages,
+			 (unsigned)__atomic_load_n(&numEventsDropped, __ATOMIC_RELAXED));
+	cxa_ioStream_writeLine(ioStreamIn, line);
+	snprintf(line, sizeof(line), "failover latency: %ums last, %ums max",
+			 (unsigned)currStats.lastFailoverLatency_ms, (unsigned)currStats.maxFailoverLatency_ms);
+	cxa_ioStream_writeLine(ioStreamIn, line);
+}
@@ -0,0 +1,205 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_linkSelector.h"
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_assert.h>
+
+
+// ******** local macro definitions ********
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static bool selectLink(ovr_linkSelector_t *const lsIn, uint32_t now_msIn);
+static ovr_linkSelector_link_t chooseLink(ovr_linkSelector_t *const lsIn, uint32_t now_msIn);
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void ovr_linkSelector_init(ovr_linkSelector_t *const lsIn, ovr_linkSelector_link_t preferredLinkIn)
+{
+	cxa_assert(lsIn);
+	cxa_assert(preferredLinkIn < OVR_LINKSELECTOR_NUM_LINKS);
+
+	// save our references
+	lsIn->preferredLink = preferredLinkIn;
+
+	// setup our internal state
+	lsIn->activeLink = OVR_LINKSELECTOR_LINK_NONE;
+	memset(lsIn->links, 0, sizeof(lsIn->links));
+	lsIn->isFailingOver = false;
+	lsIn->lostLink = OVR_LINKSELECTOR_LINK_NONE;
+	lsIn->lostTime_ms = 0;
+	memset(&lsIn->stats, 0, sizeof(lsIn->stats));
+}
+
+
+bool ovr_linkSelector_onEvent(ovr_linkSelector_t *const lsIn, ovr_linkSelector_link_t linkIn, ovr_linkSelector_event_t eventIn, uint32_t now_msIn)
+{
+	cxa_assert(lsIn);
+	cxa_assert(linkIn < OVR_LINKSELECTOR_NUM_LINKS);
+
+	lsIn->stats.numEvents++;
+
+	ovr_linkSelector_linkState_t* currLink = &lsIn->links[linkIn];
+	bool wasUsable = ovr_linkSelector_isLinkUsable(lsIn, linkIn);
+	switch( eventIn )
+	{
+		case OVR_LINKSELECTOR_EVENT_LINKUP:
+			currLink->isUp = true;
+			break;
+
+		case OVR_LINKSELECTOR_EVENT_LINKDOWN:
+			currLink->isUp = false;
+			currLink->hasIp = false;
+			break;
+
+		case OVR_LINKSELECTOR_EVENT_GOTIP:
+			currLink->hasIp = true;
+			break;
+
+		case OVR_LINKSELECTOR_EVENT_LOSTIP:
+			currLink->hasIp = false;
+			break;
+	}
+	if( !wasUsable && ovr_linkSelector_isLinkUsable(lsIn, linkIn) ) currLink->usableSince_ms = now_msIn;
+
+	return selectLink(lsIn, now_msIn);
+}
+
+
+bool ovr_linkSelector_update(ovr_linkSelector_t *const lsIn, uint32_t now_msIn)
+{
+	cxa_assert(lsIn);
+
+	return selectLink(lsIn, now_msIn);
+}
+
+
+ovr_linkSelector_link_t ovr_linkSelector_getActiveLink(ovr_linkSelector_t *const lsIn)
+{
+	cxa_assert(lsIn);
+
+	return lsIn->activeLink;
+}
+
+
+bool ovr_linkSelector_isLinkUsable(ovr_linkSelector_t *const lsIn, ovr_linkSelector_link_t linkIn)
+{
+	cxa_assert(lsIn);
+	if( linkIn >= OVR_LINKSELECTOR_NUM_LINKS ) return false;
+
+	return lsIn->links[linkIn].isUp && lsIn->links[linkIn].hasIp;
+}
+
+
+ovr_linkSelector_stats_t ovr_linkSelector_getStats(ovr_linkSelector_t *const lsIn)
+{
+	cxa_assert(lsIn);
+
+	return lsIn->stats;
+}
+
+
+const char* ovr_linkSelector_getLinkName(ovr_linkSelector_link_t linkIn)
+{
+	switch( linkIn )
+	{
+		case OVR_LINKSELECTOR_LINK_ETH:
+			return "eth";
+
+		case OVR_LINKSELECTOR_LINK_WIFI:
+			return "wifi";
+
+		default:
+			return "none";
+	}
+}
+
+
+// ******** local function implementations ********
+static bool selectLink(ovr_linkSelector_t *const lsIn, uint32_t now_msIn)
+{
+	cxa_assert(lsIn);
+
+	ovr_linkSelector_link_t prevLink = lsIn->activeLink;
+	ovr_linkSelector_link_t nextLink = chooseLink(lsIn, now_msIn);
+	if( nextLink == prevLink ) return false;
+
+	lsIn->activeLink = nextLink;
+	lsIn->stats.numLinkChanges++;
+
+	// failing back to the preferred link doesn't count as losing one
+	if( (prevLink != OVR_LINKSELECTOR_LINK_NONE) && !ovr_linkSelector_isLinkUsable(lsIn, prevLink) )
+	{
+		lsIn->isFailingOver = true;
+		lsIn->lostLink = prevLink;
+		lsIn->lostTime_ms = now_msIn;
+	}
+
+	if( nextLink == OVR_LINKSELECTOR_LINK_NONE )
+	{
+		if( prevLink != OVR_LINKSELECTOR_LINK_NONE ) lsIn->stats.numOutages++;
+	}
+	else if( lsIn->isFailingOver )
+	{
+		// the lost link coming back isn't a failover
+		if( nextLink != lsIn->lostLink )
+		{
+			uint32_t latency_ms = now_msIn - lsIn->lostTime_ms;
+			lsIn->stats.numFailovers++;
+			lsIn->stats.lastFailoverLatency_ms = latency_ms;
+			if( latency_ms > lsIn->stats.maxFailoverLatency_ms ) lsIn->stats.maxFailoverLatency_ms = latency_ms;
+		}
+		lsIn->isFailingOver = false;
+	}
+
+	return true;
+}
+
+
+static ovr_linkSelector_link_t chooseLink(ovr_linkSelector_t *const lsIn, uint32_t now_msIn)
+{
+	cxa_assert(lsIn);
+
+	ovr_linkSelector_link_t prefLink = lsIn->preferredLink;
+	if( ovr_linkSelector_isLinkUsable(lsIn, lsIn->activeLink) )
+	{
+		if( lsIn->activeLink == prefLink ) return prefLink;
+
+		// stay where we are until the preferred link has proven itself
+		if( ovr_linkSelector_isLinkUsable(lsIn, prefLink) &&
+			((now_msIn - lsIn->links[prefLink].usableSince_ms) >= OVR_LINKSELECTOR_FAILBACK_HOLDOFF_MS) ) return prefLink;
+
+		return lsIn->activeLink;
+	}
+
+	// nothing active (or just lost it), take the best we've got right now
+	if( ovr_linkSelector_isLinkUsable(lsIn, prefLink) ) return prefLink;
+	for( size_t i = 0; i < OVR_LINKSELECTOR_NUM_LINKS; i++ )
+	{
+		if( ovr_linkSelector_isLinkUsable(lsIn, i) ) return i;
+	}
+	return OVR_LINKSELECTOR_LINK_NONE;
+}
@@ -0,0 +1,396 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_loadGenerator.h"
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_fixedByteBuffer.h>
+#include <cxa_runLoop.h>
+
+#define CXA_LOG_LEVEL			CXA_LOG_LEVEL_TRACE
+#include <cxa_logger_implementation.h>
+
+
+// ******** local macro definitions ********
+#ifndef OVR_LOADGENERATOR_DEFAULT_NUMBEACONS
+	#define OVR_LOADGENERATOR_DEFAULT_NUMBEACONS		32
+#endif
+
+#ifndef OVR_LOADGENERATOR_DEFAULT_DURATION_MS
+	#define OVR_LOADGENERATOR_DEFAULT_DURATION_MS		600000
+#endif
+
+#define ADVERT_SIZE_BYTES					15
+#define NOISE_SIZE_BYTES					3
+#define RSSI_MIN_DBM						-100
+#define RSSI_MAX_DBM						-30
+#define DEVSTATUS_ALLSENSORSENABLED			0x07
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static uint32_t nextRandom(ovr_loadGenerator_t *const lgIn);
+static uint32_t randomRange(ovr_loadGenerator_t *const lgIn, uint32_t minIn, uint32_t maxIn);
+static uint32_t randomAround(ovr_loadGenerator_t *const lgIn, uint32_t meanIn);
+
+static void injectBeaconAdvert(ovr_loadGenerator_t *const lgIn, ovr_loadGenerator_beacon_t *const beaconIn);
+static void injectNoiseAdvert(ovr_loadGenerator_t *const lgIn);
+static void finishRun(ovr_loadGenerator_t *const lgIn);
+
+static void cb_onRunLoopUpdate(void* userVarIn);
+static void beaconCb_onBeaconFound(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn);
+static void beaconCb_onBeaconLost(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void ovr_loadGenerator_init(ovr_loadGenerator_t *const lgIn, ovr_beaconManager_t *const bmIn, int threadIdIn)
+{
+	cxa_assert(lgIn);
+	cxa_assert(bmIn);
+
+	lgIn->bm = bmIn;
+	lgIn->isRunning = false;
+	cxa_timeDiff_init(&lgIn->td_run);
+	memset(&lgIn->report, 0, sizeof(lgIn->report));
+
+	cxa_logger_init(&lgIn->logger, "loadGenerator");
+
+	ovr_beaconManager_addListener(lgIn->bm, beaconCb_onBeaconFound, NULL, beaconCb_onBeaconLost, (void*)lgIn);
+
+	// must run on the same thread as the manager's ingest
+	cxa_runLoop_addEntry(threadIdIn, cb_onRunLoopUpdate, (void*)lgIn);
+}
+
+
+void ovr_loadGenerator_getDefaultScenario(ovr_loadGenerator_scenario_t *const scenarioOut)
+{
+	cxa_assert(scenarioOut);
+
+	scenarioOut->seed = 1;
+	scenarioOut->numBeacons = OVR_LOADGENERATOR_DEFAULT_NUMBEACONS;
+	scenarioOut->duration_ms = OVR_LOADGENERATOR_DEFAULT_DURATION_MS;
+	scenarioOut->advertInterval_min_ms = 500;
+	scenarioOut->advertInterval_max_ms = 2000;
+	scenarioOut->rssiWalkStep_dBm = 2;
+	scenarioOut->meanDwell_ms = 120000;
+	scenarioOut->meanAbsence_ms = 60000;
+	scenarioOut->accelEventRate_perMille = 5;
+	scenarioOut->noiseRate_perSec = 20;
+}
+
+
+bool ovr_loadGenerator_start(ovr_loadGenerator_t *const lgIn, ovr_loadGenerator_scenario_t *const scenarioIn)
+{
+	cxa_assert(lgIn);
+	cxa_assert(scenarioIn);
+
+	if( lgIn->isRunning ) return false;
+	if( (scenarioIn->numBeacons > OVR_LOADGENERATOR_MAXNUM_BEACONS) ||
+		(scenarioIn->advertInterval_min_ms == 0) ||
+		(scenarioIn->advertInterval_min_ms > scenarioIn->advertInterval_max_ms) ) return false;
+
+	lgIn->scenario = *scenarioIn;
+	// xorshift can't start from zero
+	lgIn->rngState = (scenarioIn->seed != 0) ? scenarioIn->seed : 1;
+	lgIn->scenarioTime_ms = 0;
+	lgIn->numNoiseDue = 0;
+
+	// everything about the fleet derives from the seed
+	for( uint16_t i = 0; i < lgIn->scenario.numBeacons; i++ )
+	{
+		ovr_loadGenerator_beacon_t* currBeacon = &lgIn->beacons[i];
+
+		// locally administered addresses so they can't collide with real beacons
+		currBeacon->uuid.bytes[0] = 0x02;
+		currBeacon->uuid.bytes[1] = 'L';
+		currBeacon->uuid.bytes[2] = 'G';
+		currBeacon->uuid.bytes[3] = (uint8_t)lgIn->scenario.seed;
+		currBeacon->uuid.bytes[4] = (uint8_t)(i >> 8);
+		currBeacon->uuid.bytes[5] = (uint8_t)i;
+
+		currBeacon->isPresent = true;
+		currBeacon->advertInterval_ms = randomRange(lgIn, lgIn->scenario.advertInterval_min_ms, lgIn->scenario.advertInterval_max_ms);
+		currBeacon->nextAdvert_ms = randomRange(lgIn, 0, currBeacon->advertInterval_ms);
+		currBeacon->nextChurn_ms = (lgIn->scenario.meanDwell_ms != 0) ? randomAround(lgIn, lgIn->scenario.meanDwell_ms) : UINT32_MAX;
+		currBeacon->rssi_dBm = (int8_t)randomRange(lgIn, 0, RSSI_MAX_DBM - RSSI_MIN_DBM) + RSSI_MIN_DBM;
+		currBeacon->accelStatus = 0;
+	}
+
+	memset(&lgIn->report, 0, sizeof(lgIn->report));
+	lgIn->startPipelineStats = ovr_beaconManager_getPipelineStats(lgIn->bm);
+	lgIn->startPublishStats = ovr_beaconManager_getPublishStats(lgIn->bm);
+	cxa_timeDiff_setStartTime_now(&lgIn->td_run);
+	lgIn->isRunning = true;
+
+	cxa_logger_info(&lgIn->logger, "started  seed: %d  beacons: %d", (int)lgIn->scenario.seed, lgIn->scenario.numBeacons);
+	return true;
+}
+
+
+void ovr_loadGenerator_stop(ovr_loadGenerator_t *const lgIn)
+{
+	cxa_assert(lgIn);
+
+	if( !lgIn->isRunning ) return;
+	finishRun(lgIn);
+}
+
+
+bool ovr_loadGenerator_isRunning(ovr_loadGenerator_t *const lgIn)
+{
+	cxa_assert(lgIn);
+
+	return lgIn->isRunning;
+}
+
+
+ovr_loadGenerator_report_t ovr_loadGenerator_getReport(ovr_loadGenerator_t *const lgIn)
+{
+	cxa_assert(lgIn);
+
+	ovr_loadGenerator_report_t retVal = lgIn->report;
+	if( lgIn->isRunning )
+	{
+		// fill in the live values...all counters wrap, so differences are still valid
+		ovr_beaconManager_pipelineStats_t currPipelineStats = ovr_beaconManager_getPipelineStats(lgIn->bm);
+		ovr_beaconManager_rpcInterface_publishStats_t currPublishStats = ovr_beaconManager_getPublishStats(lgIn->bm);
+
+		retVal.duration_ms = lgIn->scenarioTime_ms;
+		retVal.pipeline.numAdvertsRx = currPipelineStats.numAdvertsRx - lgIn->startPipelineStats.numAdvertsRx;
+		retVal.pipeline.numAdvertsAccepted = currPipelineStats.numAdvertsAccepted - lgIn->startPipelineStats.numAdvertsAccepted;
+		retVal.pipeline.numAdvertsFiltered = currPipelineStats.numAdvertsFiltered - lgIn->startPipelineStats.numAdvertsFiltered;
+		retVal.pipeline.numAdvertsDropped = currPipelineStats.numAdvertsDropped - lgIn->startPipelineStats.numAdvertsDropped;
+		retVal.pipeline.numUpdatesProcessed = currPipelineStats.numUpdatesProcessed - lgIn->startPipelineStats.numUpdatesProcessed;
+		retVal.pipeline.queueLatency_total_us = currPipelineStats.queueLatency_total_us - lgIn->startPipelineStats.queueLatency_total_us;
+		retVal.pipeline.queueLatency_max_us = currPipelineStats.queueLatency_max_us;
+		retVal.pipeline.processTime_total_us = currPipelineStats.processTime_total_us - lgIn->startPipelineStats.processTime_total_us;
+		retVal.pipeline.processTime_max_us = currPipelineStats.processTime_max_us;
+		retVal.publish.numPublishes = currPublishStats.numPublishes - lgIn->startPublishStats.numPublishes;
+		retVal.publish.numBytes = currPublishStats.numBytes - lgIn->startPublishStats.numBytes;
+		retVal.publish.numFailures = currPublishStats.numFailures - lgIn->startPublishStats.numFailures;
+	}
+	return retVal;
+}
+
+
+void ovr_loadGenerator_writeReport(ovr_loadGenerator_t *const lgIn, cxa_ioStream_t *const ioStreamIn)
+{
+	cxa_assert(lgIn);
+	cxa_assert(ioStreamIn);
+
+	ovr_loadGenerator_report_t report = ovr_loadGenerator_getReport(lgIn);
+
+	uint32_t numIngested = report.numAdverts + report.numNoiseAdverts;
+	uint32_t dropRate_ppm = (numIngested > 0) ? (uint32_t)(((uint64_t)report.pipeline.numAdvertsDropped * 1000000) / numIngested) : 0;
+	uint32_t duration_ms = (report.duration_ms > 0) ? report.duration_ms : 1;
+
+	char line[512];
+	snprintf(line, sizeof(line),
+			 "{\"seed\":%u,\"running\":%d,\"beacons\":%u,\"duration_ms\":%u,"
+			 "\"adverts\":%u,\"noise\":%u,\"accepted\":%u,\"processed\":%u,\"dropped\":%u,\"dropRate_ppm\":%u,"
+			 "\"joins\":%u,\"leaves\":%u,\"found\":%u,\"lost\":%u,"
+			 "\"publishes\":%u,\"pubBytes\":%u,\"pubFailures\":%u,\"publishesPerMin\":%u,\"bytesPerMin\":%u,"
+			 "\"queueLatencyMax_us\":%u,\"processTime_us\":%u,\"processTimeMax_us\":%u}",
+			 (unsigned)lgIn->scenario.seed, lgIn->isRunning, (unsigned)lgIn->scenario.numBeacons, (unsigned)report.duration_ms,
+			 (unsigned)report.numAdverts, (unsigned)report.numNoiseAdverts, (unsigned)report.numAccepted,
+			 (unsigned)report.pipeline.numUpdatesProcessed, (unsigned)report.pipeline.numAdvertsDropped, (unsigned)dropRate_ppm,
+			 (unsigned)report.numJoins, (unsigned)report.numLeaves, (unsigned)report.numFound, (unsigned)report.numLost,
+			 (unsigned)report.publish.numPublishes, (unsigned)report.publish.numBytes, (unsigned)report.publish.numFailures,
+			 (unsigned)(((uint64_t)report.publish.numPublishes * 60000) / duration_ms),
+			 (unsigned)(((uint64_t)report.publish.numBytes * 60000) / duration_ms),
+			 (unsigned)report.pipeline.queueLatency_max_us,
+			 (unsigned)report.pipeline.processTime_total_us, (unsigned)report.pipeline.processTime_max_us);
+	cxa_ioStream_writeLine(ioStreamIn, line);
+}
+
+
+// ******** local function implementations ********
+static uint32_t nextRandom(ovr_loadGenerator_t *const lgIn)
+{
+	cxa_assert(lgIn);
+
+	// xorshift32
+	uint32_t x = lgIn->rngState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	lgIn->rngState = x;
+	return x;
+}
+
+
+static uint32_t randomRange(ovr_loadGenerator_t *const lgIn, uint32_t minIn, uint32_t maxIn)
+{
+	cxa_assert(lgIn);
+
+	if( maxIn <= minIn ) return minIn;
+	return minIn + (nextRandom(lgIn) % (maxIn - minIn + 1));
+}
+
+
+static uint32_t randomAround(ovr_loadGenerator_t *const lgIn, uint32_t meanIn)
+{
+	cxa_assert(lgIn);
+
+	// uniform over [mean/2, 3*mean/2]
+	return randomRange(lgIn, meanIn / 2, meanIn + (meanIn / 2));
+}
+
+
+static void injectBeaconAdvert(ovr_loadGenerator_t *const lgIn, ovr_loadGenerator_beacon_t *const beaconIn)
+{
+	cxa_assert(lgIn);
+	cxa_assert(beaconIn);
+
+	// random walk the signal strength
+	int rssi = beaconIn->rssi_dBm + (int)randomRange(lgIn, 0, 2 * lgIn->scenario.rssiWalkStep_dBm) - lgIn->scenario.rssiWalkStep_dBm;
+	if( rssi < RSSI_MIN_DBM ) rssi = RSSI_MIN_DBM;
+	if( rssi > RSSI_MAX_DBM ) rssi = RSSI_MAX_DBM;
+	beaconIn->rssi_dBm = (int8_t)rssi;
+
+	// events are only held for a single advert so each one is a fresh rising edge
+	beaconIn->accelStatus = (randomRange(lgIn, 0, 999) < lgIn->scenario.accelEventRate_perMille) ? (1 << randomRange(lgIn, 0, 3)) : 0;
+
+	uint16_t temp_deciDegC = (uint16_t)randomRange(lgIn, 180, 260);
+	uint16_t batt_mv = (uint16_t)randomRange(lgIn, 2900, 3000);
+	uint8_t advert[ADVERT_SIZE_BYTES] = {
+			OVR_BEACONPROXY_DEVTYPE_BEACON_V1,
+			beaconIn->uuid.bytes[0], beaconIn->uuid.bytes[1], beaconIn->uuid.bytes[2],
+			beaconIn->uuid.bytes[3], beaconIn->uuid.bytes[4], beaconIn->uuid.bytes[5],
+			DEVSTATUS_ALLSENSORSENABLED,
+			(uint8_t)randomRange(lgIn, 80, 100),
+			(uint8_t)temp_deciDegC, (uint8_t)(temp_deciDegC >> 8),
+			(uint8_t)randomRange(lgIn, 0, 255),
+			beaconIn->accelStatus,
+			(uint8_t)batt_mv, (uint8_t)(batt_mv >> 8)
+	};
+
+	cxa_fixedByteBuffer_t fbb_advert;
+	cxa_fixedByteBuffer_init_inPlace(&fbb_advert, sizeof(advert), advert, sizeof(advert));
+
+	lgIn->report.numAdverts++;
+	if( ovr_beaconManager_injectAdvert(lgIn->bm, beaconIn->rssi_dBm, &fbb_advert) ) lgIn->report.numAccepted++;
+}
+
+
+static void injectNoiseAdvert(ovr_loadGenerator_t *const lgIn)
+{
+	cxa_assert(lgIn);
+
+	// too short to parse...exercises the reject path
+	uint8_t noise[NOISE_SIZE_BYTES] = { (uint8_t)nextRandom(lgIn), (uint8_t)nextRandom(lgIn), (uint8_t)nextRandom(lgIn) };
+
+	cxa_fixedByteBuffer_t fbb_noise;
+	cxa_fixedByteBuffer_init_inPlace(&fbb_noise, sizeof(noise), noise, sizeof(noise));
+
+	lgIn->report.numNoiseAdverts++;
+	ovr_beaconManager_injectAdvert(lgIn->bm, RSSI_MIN_DBM, &fbb_noise);
+}
+
+
+static void finishRun(ovr_loadGenerator_t *const lgIn)
+{
+	cxa_assert(lgIn);
+
+	// freeze the live values into the stored report
+	lgIn->report = ovr_loadGenerator_getReport(lgIn);
+	lgIn->isRunning = false;
+
+	cxa_logger_info(&lgIn->logger, "done  adverts: %d  dropped: %d  found: %d  lost: %d  publishes: %d",
+					(int)lgIn->report.numAdverts, (int)lgIn->report.pipeline.numAdvertsDropped,
+					(int)lgIn->report.numFound, (int)lgIn->report.numLost, (int)lgIn->report.publish.numPublishes);
+}
+
+
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	ovr_loadGenerator_t* lgIn = (ovr_loadGenerator_t*)userVarIn;
+	cxa_assert(lgIn);
+
+	if( !lgIn->isRunning ) return;
+
+	// catch up to the time base (the same one the manager's timers use)
+	uint32_t targetTime_ms = cxa_timeDiff_getElapsedTime_ms(&lgIn->td_run);
+	if( targetTime_ms > lgIn->scenario.duration_ms ) targetTime_ms = lgIn->scenario.duration_ms;
+
+	for( uint16_t i = 0; i < lgIn->scenario.numBeacons; i++ )
+	{
+		ovr_loadGenerator_beacon_t* currBeacon = &lgIn->beacons[i];
+
+		// join / leave churn
+		while( (lgIn->scenario.meanDwell_ms != 0) && (currBeacon->nextChurn_ms <= targetTime_ms) )
+		{
+			currBeacon->isPresent = !currBeacon->isPresent;
+			if( currBeacon->isPresent )
+			{
+				lgIn->report.numJoins++;
+				currBeacon->nextAdvert_ms = currBeacon->nextChurn_ms;
+				currBeacon->nextChurn_ms += randomAround(lgIn, lgIn->scenario.meanDwell_ms);
+			}
+			else
+			{
+				lgIn->report.numLeaves++;
+				currBeacon->nextChurn_ms += randomAround(lgIn, lgIn->scenario.meanAbsence_ms);
+			}
+		}
+		if( !currBeacon->isPresent ) continue;
+
+		// adverts with +/- 10% jitter
+		while( currBeacon->nextAdvert_ms <= targetTime_ms )
+		{
+			injectBeaconAdvert(lgIn, currBeacon);
+			currBeacon->nextAdvert_ms += randomAround(lgIn, currBeacon->advertInterval_ms) / 5 + (currBeacon->advertInterval_ms * 4) / 5;
+		}
+	}
+
+	// background noise
+	uint32_t numNoiseDue = (uint32_t)(((uint64_t)targetTime_ms * lgIn->scenario.noiseRate_perSec) / 1000);
+	while( lgIn->numNoiseDue < numNoiseDue )
+	{
+		injectNoiseAdvert(lgIn);
+		lgIn->numNoiseDue++;
+	}
+
+	lgIn->scenarioTime_ms = targetTime_ms;
+	if( targetTime_ms >= lgIn->scenario.duration_ms ) finishRun(lgIn);
+}
+
+
+static void beaconCb_onBeaconFound(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn)
+{
+	ovr_loadGenerator_t* lgIn = (ovr_loadGenerator_t*)userVarIn;
+	cxa_assert(lgIn);
+
+	if( lgIn->isRunning ) lgIn->report.numFound++;
+}
+
+
+static void beaconCb_onBeaconLost(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn)
+{
+	ovr_loadGenerator_t* lgIn = (ovr_loadGenerator_t*)userVarIn;
+	cxa_assert(lgIn);
+
+	if( lgIn->isRunning ) lgIn->report.numLost++;
+}
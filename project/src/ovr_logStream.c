@@ -0,0 +1,367 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_logStream.h"
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_criticalSection.h>
+#include <cxa_logger_header.h>
+#include <cxa_runLoop.h>
+
+#include <ovr_publishScheduler.h>
+
+
+// ******** local macro definitions ********
+#define MESSAGE_MAXSIZE_BYTES					200
+#define MAXNUM_LINES_PER_MESSAGE				8
+#define DEFAULT_MINLEVEL						CXA_LOG_LEVEL_WARN
+#define SETFILTER_HEADER_SIZE_BYTES				2
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static bool ioStreamCb_writeBytes(void* buffIn, size_t bufferSize_bytesIn, void *const userVarIn);
+static cxa_ioStream_readStatus_t ioStreamCb_readByte(uint8_t *const byteOut, void *const userVarIn);
+
+static void finishLine(ovr_logStream_t *const lsIn);
+static uint8_t getLineLevel(const char *const lineIn);
+static void publishQueuedLines(ovr_logStream_t *const lsIn);
+
+static void cb_onRunLoopUpdate(void* userVarIn);
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setLogFilter(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getLogStats(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+// searched for in each line, most important first
+static const char* levelTokens[] = { " ERROR", " WARN", " INFO", " DEBUG", " TRACE" };
+static const uint8_t levelValues[] = { CXA_LOG_LEVEL_ERROR, CXA_LOG_LEVEL_WARN, CXA_LOG_LEVEL_INFO, CXA_LOG_LEVEL_DEBUG, CXA_LOG_LEVEL_TRACE };
+
+
+// ******** global function implementations ********
+void ovr_logStream_init(ovr_logStream_t *const lsIn, cxa_mqtt_rpc_node_t *const rootNodeIn, int threadIdIn)
+{
+	cxa_assert(lsIn);
+	cxa_assert(rootNodeIn);
+
+	lsIn->isEnabled = false;
+	lsIn->minLevel = DEFAULT_MINLEVEL;
+	lsIn->moduleFilter[0] = 0;
+	lsIn->lineBuffer_len = 0;
+	lsIn->nextSequence = 0;
+	lsIn->numBackoffPeriods = 1;
+	lsIn->numPeriodsToSkip = 0;
+	memset(lsIn->slots, 0, sizeof(lsIn->slots));
+	memset(&lsIn->stats, 0, sizeof(lsIn->stats));
+	cxa_timeDiff_init(&lsIn->td_publish);
+
+	// interpose on the logger's output
+	lsIn->ioStream_downstream = cxa_logger_getGlobalIoStream();
+	cxa_ioStream_init(&lsIn->ioStream);
+	cxa_ioStream_bind(&lsIn->ioStream, ioStreamCb_readByte, ioStreamCb_writeBytes, (void*)lsIn);
+	cxa_logger_setGlobalIoStream(&lsIn->ioStream);
+
+	// setup our rpc node
+	cxa_mqtt_rpc_node_init_formattedString(&lsIn->rpcNode, rootNodeIn, "diagnostics");
+	cxa_mqtt_rpc_node_addMethod(&lsIn->rpcNode, "setLogFilter", rpcMethodCb_setLogFilter, (void*)lsIn);
+	cxa_mqtt_rpc_node_addMethod(&lsIn->rpcNode, "getLogStats", rpcMethodCb_getLogStats, (void*)lsIn);
+
+	cxa_runLoop_addEntry(threadIdIn, cb_onRunLoopUpdate, (void*)lsIn);
+}
+
+
+void ovr_logStream_setFilter(ovr_logStream_t *const lsIn, bool isEnabledIn, uint8_t minLevelIn, const char *const moduleFilterIn)
+{
+	cxa_assert(lsIn);
+
+	cxa_criticalSection_enter();
+	lsIn->isEnabled = isEnabledIn;
+	lsIn->minLevel = minLevelIn;
+	lsIn->moduleFilter[0] = 0;
+	if( moduleFilterIn != NULL )
+	{
+		strncpy(lsIn->moduleFilter, moduleFilterIn, OVR_LOGSTREAM_MODULEFILTER_MAXLEN);
+		lsIn->moduleFilter[OVR_LOGSTREAM_MODULEFILTER_MAXLEN] = 0;
+	}
+
+	// don't hold on to lines nobody asked for
+	if( !isEnabledIn )
+	{
+		for( size_t i = 0; i < OVR_LOGSTREAM_NUM_SLOTS; i++ ) lsIn->slots[i].isUsed = false;
+		lsIn->lineBuffer_len = 0;
+	}
+	cxa_criticalSection_exit();
+}
+
+
+ovr_logStream_stats_t ovr_logStream_getStats(ovr_logStream_t *const lsIn)
+{
+	cxa_assert(lsIn);
+
+	cxa_criticalSection_enter();
+	ovr_logStream_stats_t retVal = lsIn->stats;
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+// ******** local function implementations ********
+static bool ioStreamCb_writeBytes(void* buffIn, size_t bufferSize_bytesIn, void *const userVarIn)
+{
+	ovr_logStream_t* lsIn = (ovr_logStream_t*)userVarIn;
+	cxa_assert(lsIn);
+
+	// local output is never affected by streaming
+	bool retVal = (lsIn->ioStream_downstream != NULL) ? cxa_ioStream_writeBytes(lsIn->ioStream_downstream, buffIn, bufferSize_bytesIn) : true;
+
+	if( !lsIn->isEnabled ) return retVal;
+
+	cxa_criticalSection_enter();
+	for( size_t i = 0; i < bufferSize_bytesIn; i++ )
+	{
+		char currChar = ((char*)buffIn)[i];
+		if( (currChar == '\r') || (currChar == '\n') )
+		{
+			finishLine(lsIn);
+		}
+		else if( lsIn->lineBuffer_len < (sizeof(lsIn->lineBuffer) - 1) )
+		{
+			// overlong lines are truncated
+			lsIn->lineBuffer[lsIn->lineBuffer_len++] = currChar;
+		}
+	}
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+static cxa_ioStream_readStatus_t ioStreamCb_readByte(uint8_t *const byteOut, void *const userVarIn)
+{
+	ovr_logStream_t* lsIn = (ovr_logStream_t*)userVarIn;
+	cxa_assert(lsIn);
+
+	return CXA_IOSTREAM_READSTAT_NODATA;
+}
+
+
+static void finishLine(ovr_logStream_t *const lsIn)
+{
+	cxa_assert(lsIn);
+
+	// must be called from within a critical section
+	if( lsIn->lineBuffer_len == 0 ) return;
+	lsIn->lineBuffer[lsIn->lineBuffer_len] = 0;
+	size_t lineLen = lsIn->lineBuffer_len;
+	lsIn->lineBuffer_len = 0;
+
+	uint8_t level = getLineLevel(lsIn->lineBuffer);
+	if( (level > lsIn->minLevel) ||
+		((lsIn->moduleFilter[0] != 0) && (strstr(lsIn->lineBuffer, lsIn->moduleFilter) == NULL)) )
+	{
+		lsIn->stats.numLinesFiltered++;
+		return;
+	}
+
+	// find a free slot...or the least important (then oldest) line to displace
+	ovr_logStream_slot_t* targetSlot = NULL;
+	for( size_t i = 0; i < OVR_LOGSTREAM_NUM_SLOTS; i++ )
+	{
+		ovr_logStream_slot_t* currSlot = &lsIn->slots[i];
+		if( !currSlot->isUsed )
+		{
+			targetSlot = currSlot;
+			break;
+		}
+		if( (targetSlot == NULL) ||
+			(currSlot->level > targetSlot->level) ||
+			((currSlot->level == targetSlot->level) && ((int32_t)(currSlot->sequence - targetSlot->sequence) < 0)) )
+		{
+			targetSlot = currSlot;
+		}
+	}
+	if( targetSlot->isUsed )
+	{
+		lsIn->stats.numLinesDropped++;
+
+		// the newcomer is less important than anything we're holding
+		if( level > targetSlot->level ) return;
+	}
+
+	targetSlot->isUsed = true;
+	targetSlot->level = level;
+	targetSlot->len = lineLen;
+	targetSlot->sequence = lsIn->nextSequence++;
+	memcpy(targetSlot->text, lsIn->lineBuffer, lineLen);
+	lsIn->stats.numLinesQueued++;
+}
+
+
+static uint8_t getLineLevel(const char *const lineIn)
+{
+	cxa_assert(lineIn);
+
+	for( size_t i = 0; i < (sizeof(levelTokens)/sizeof(*levelTokens)); i++ )
+	{
+		if( strstr(lineIn, levelTokens[i]) != NULL ) return levelValues[i];
+	}
+
+	// unrecognized lines are treated as informational
+	return CXA_LOG_LEVEL_INFO;
+}
+
+
+static void publishQueuedLines(ovr_logStream_t *const lsIn)
+{
+	cxa_assert(lsIn);
+
+	size_t budget_bytes = OVR_LOGSTREAM_MAXBYTES_PER_PERIOD;
+	while( budget_bytes > 0 )
+	{
+		// collect the oldest lines that fit into a single message
+		char payload[MESSAGE_MAXSIZE_BYTES];
+		size_t payloadSize_bytes = 0;
+		uint32_t sentSequences[MAXNUM_LINES_PER_MESSAGE];
+		size_t numLines = 0;
+
+		cxa_criticalSection_enter();
+		while( numLines < MAXNUM_LINES_PER_MESSAGE )
+		{
+			ovr_logStream_slot_t* oldestSlot = NULL;
+			for( size_t i = 0; i < OVR_LOGSTREAM_NUM_SLOTS; i++ )
+			{
+				ovr_logStream_slot_t* currSlot = &lsIn->slots[i];
+				if( !currSlot->isUsed ) continue;
+				if( (numLines > 0) && ((int32_t)(currSlot->sequence - sentSequences[numLines-1]) <= 0) ) continue;
+				if( (oldestSlot == NULL) || ((int32_t)(currSlot->sequence - oldestSlot->sequence) < 0) ) oldestSlot = currSlot;
+			}
+			if( oldestSlot == NULL ) break;
+
+			size_t neededSize_bytes = oldestSlot->len + ((numLines > 0) ? 1 : 0);
+			if( ((payloadSize_bytes + neededSize_bytes) > sizeof(payload)) || ((payloadSize_bytes + neededSize_bytes) > budget_bytes) ) break;
+
+			if( numLines > 0 ) payload[payloadSize_bytes++] = '\n';
+			memcpy(&payload[payloadSize_bytes], oldestSlot->text, oldestSlot->len);
+			payloadSize_bytes += oldestSlot->len;
+			sentSequences[numLines++] = oldestSlot->sequence;
+		}
+		cxa_criticalSection_exit();
+
+		if( numLines == 0 ) return;
+
+		// publish outside the critical section...logging may happen in here
+		if( !ovr_publishScheduler_publish(&lsIn->rpcNode, "onLog", OVR_PUBLISHSCHEDULER_CLASS_DIAGNOSTICS, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, payload, payloadSize_bytes) )
+		{
+			// uplink is struggling...back off and let the ring shed low-level lines
+			cxa_criticalSection_enter();
+			lsIn->stats.numPublishFailures++;
+			cxa_criticalSection_exit();
+
+			lsIn->numPeriodsToSkip = lsIn->numBackoffPeriods;
+			if( lsIn->numBackoffPeriods < OVR_LOGSTREAM_MAXNUM_BACKOFF_PERIODS ) lsIn->numBackoffPeriods *= 2;
+			return;
+		}
+		lsIn->numBackoffPeriods = 1;
+		budget_bytes -= payloadSize_bytes;
+
+		// release what we sent (unless it was displaced in the meantime)
+		cxa_criticalSection_enter();
+		for( size_t i = 0; i < OVR_LOGSTREAM_NUM_SLOTS; i++ )
+		{
+			ovr_logStream_slot_t* currSlot = &lsIn->slots[i];
+			if( !currSlot->isUsed ) continue;
+			for( size_t j = 0; j < numLines; j++ )
+			{
+				if( currSlot->sequence == sentSequences[j] )
+				{
+					currSlot->isUsed = false;
+					lsIn->stats.numLinesPublished++;
+					break;
+				}
+			}
+		}
+		cxa_criticalSection_exit();
+	}
+}
+
+
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	ovr_logStream_t* lsIn = (ovr_logStream_t*)userVarIn;
+	cxa_assert(lsIn);
+
+	if( !lsIn->isEnabled ) return;
+	if( !cxa_timeDiff_isElapsed_recurring_ms(&lsIn->td_publish, OVR_LOGSTREAM_PUBLISH_PERIOD_MS) ) return;
+
+	if( lsIn->numPeriodsToSkip > 0 )
+	{
+		lsIn->numPeriodsToSkip--;
+		return;
+	}
+
+	publishQueuedLines(lsIn);
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setLogFilter(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_logStream_t* lsIn = (ovr_logStream_t*)userVarIn;
+	cxa_assert(lsIn);
+
+	// params: [isEnabled:1][minLevel:1][moduleName...]
+	uint8_t isEnabled;
+	uint8_t minLevel;
+	if( !cxa_linkedField_get_uint8(paramsIn, 0, isEnabled) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint8(paramsIn, 1, minLevel) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( minLevel > CXA_LOG_LEVEL_TRACE ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	size_t moduleLen = cxa_linkedField_getSize_bytes(paramsIn) - SETFILTER_HEADER_SIZE_BYTES;
+	if( moduleLen > OVR_LOGSTREAM_MODULEFILTER_MAXLEN ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	char moduleFilter[OVR_LOGSTREAM_MODULEFILTER_MAXLEN+1] = "";
+	if( moduleLen > 0 ) memcpy(moduleFilter, cxa_linkedField_get_pointerToIndex(paramsIn, SETFILTER_HEADER_SIZE_BYTES), moduleLen);
+	moduleFilter[moduleLen] = 0;
+
+	ovr_logStream_setFilter(lsIn, (isEnabled != 0), minLevel, moduleFilter);
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getLogStats(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	ovr_logStream_t* lsIn = (ovr_logStream_t*)userVarIn;
+	cxa_assert(lsIn);
+
+	// response: [isEnabled:1][minLevel:1][queued:4][filtered:4][dropped:4][published:4][publishFailures:4]
+	ovr_logStream_stats_t stats = ovr_logStream_getStats(lsIn);
+	if( !cxa_linkedField_append_uint8(responseParamsIn, lsIn->isEnabled) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint8(responseParamsIn, lsIn->minLevel) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numLinesQueued) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numLinesFiltered) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numLinesDropped) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numLinesPublished) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numPublishFailures) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
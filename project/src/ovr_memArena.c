@@ -0,0 +1,156 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_memArena.h"
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <esp_heap_caps.h>
+
+#include <cxa_assert.h>
+
+
+// ******** local macro definitions ********
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static uint32_t getHeapCaps(ovr_memArena_region_t regionIn);
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+bool ovr_memArena_init(ovr_memArena_t *const arenaIn, size_t size_bytesIn, ovr_memArena_region_t preferredRegionIn)
+{
+	cxa_assert(arenaIn);
+
+	arenaIn->buffer = NULL;
+	arenaIn->size_bytes = 0;
+	arenaIn->used_bytes = 0;
+	arenaIn->isSealed = false;
+
+	if( (preferredRegionIn == OVR_MEMARENA_REGION_PSRAM) && (getHeapCaps(OVR_MEMARENA_REGION_PSRAM) != 0) )
+	{
+		arenaIn->buffer = heap_caps_malloc(size_bytesIn, getHeapCaps(OVR_MEMARENA_REGION_PSRAM));
+		arenaIn->region = OVR_MEMARENA_REGION_PSRAM;
+	}
+	if( arenaIn->buffer == NULL )
+	{
+		arenaIn->buffer = heap_caps_malloc(size_bytesIn, getHeapCaps(OVR_MEMARENA_REGION_INTERNAL));
+		arenaIn->region = OVR_MEMARENA_REGION_INTERNAL;
+	}
+	if( arenaIn->buffer == NULL ) return false;
+
+	arenaIn->size_bytes = size_bytesIn;
+	return true;
+}
+
+
+void ovr_memArena_deinit(ovr_memArena_t *const arenaIn)
+{
+	cxa_assert(arenaIn);
+
+	if( arenaIn->buffer != NULL ) heap_caps_free(arenaIn->buffer);
+	arenaIn->buffer = NULL;
+	arenaIn->size_bytes = 0;
+	arenaIn->used_bytes = 0;
+}
+
+
+void* ovr_memArena_alloc(ovr_memArena_t *const arenaIn, size_t size_bytesIn)
+{
+	cxa_assert(arenaIn);
+	cxa_assert(!arenaIn->isSealed);
+
+	size_t alignedSize_bytes = OVR_MEMARENA_ALIGN(size_bytesIn);
+	if( (arenaIn->buffer == NULL) || (alignedSize_bytes > (arenaIn->size_bytes - arenaIn->used_bytes)) ) return NULL;
+
+	void* retVal = &arenaIn->buffer[arenaIn->used_bytes];
+	arenaIn->used_bytes += alignedSize_bytes;
+
+	memset(retVal, 0, alignedSize_bytes);
+	return retVal;
+}
+
+
+void ovr_memArena_seal(ovr_memArena_t *const arenaIn)
+{
+	cxa_assert(arenaIn);
+
+	arenaIn->isSealed = true;
+}
+
+
+size_t ovr_memArena_getSize_bytes(ovr_memArena_t *const arenaIn)
+{
+	cxa_assert(arenaIn);
+
+	return arenaIn->size_bytes;
+}
+
+
+size_t ovr_memArena_getUsed_bytes(ovr_memArena_t *const arenaIn)
+{
+	cxa_assert(arenaIn);
+
+	return arenaIn->used_bytes;
+}
+
+
+ovr_memArena_region_t ovr_memArena_getRegion(ovr_memArena_t *const arenaIn)
+{
+	cxa_assert(arenaIn);
+
+	return arenaIn->region;
+}
+
+
+size_t ovr_memArena_getFreeHeap_bytes(ovr_memArena_region_t regionIn)
+{
+	uint32_t caps = getHeapCaps(regionIn);
+	return (caps != 0) ? heap_caps_get_free_size(caps) : 0;
+}
+
+
+size_t ovr_memArena_getLargestFreeBlock_bytes(ovr_memArena_region_t regionIn)
+{
+	uint32_t caps = getHeapCaps(regionIn);
+	return (caps != 0) ? heap_caps_get_largest_free_block(caps) : 0;
+}
+
+
+// ******** local function implementations ********
+static uint32_t getHeapCaps(ovr_memArena_region_t regionIn)
+{
+	switch( regionIn )
+	{
+		case OVR_MEMARENA_REGION_PSRAM:
+#if CONFIG_SPIRAM_SUPPORT
+			return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+#else
+			return 0;
+#endif
+
+		case OVR_MEMARENA_REGION_INTERNAL:
+		default:
+			return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+	}
+}
@@ -0,0 +1,717 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_publishScheduler.h"
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_criticalSection.h>
+#include <cxa_mqtt_client.h>
+#include <cxa_mqtt_connectionManager.h>
+#include <cxa_nvsManager.h>
+#include <cxa_runLoop.h>
+#include <cxa_timeBase.h>
+
+#include <ovr_ackWindow.h>
+#include <ovr_memArena.h>
+
+// no logging in here...the log stream publishes through us
+
+
+// ******** local macro definitions ********
+#define MAXNUM_PUBLISHES_PER_ITERATION			8
+#define MAXNUM_ATTEMPTS							3
+
+#define NVS_KEY_ACKED_CLASSES					"ps_ackMask"
+#define NVS_KEY_ACK_WINDOW						"ps_ackWindow"
+#define NVS_KEY_ACK_TIMEOUT						"ps_ackTimeout"
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	bool isUsed;
+	bool isFilling;								///< payload is being copied in...not ready to go (or be replaced) yet
+	bool isInFlight;							///< being published (or awaiting an ack)...no longer coalescable or displaceable
+	bool isAwaitingAck;
+	bool hasBeenSent;
+	uint8_t class;
+	uint8_t numAttempts;
+
+	cxa_mqtt_rpc_node_t* node;
+	const char* name;
+	uint64_t coalesceKey;
+
+	uint32_t sequence;							///< fifo order within a class
+	uint32_t enqueueTime_us;
+
+	uint8_t* payload;							///< fixed slot in the payload arena
+	uint16_t payloadSize_bytes;
+
+	ovr_publishScheduler_cb_onDone_t cb_onDone;
+	void* cb_userVar;
+}entry_t;
+
+
+/**
+ * A released entry's callback, to be called once out of the critical section
+ */
+typedef struct
+{
+	ovr_publishScheduler_cb_onDone_t cb;
+	void* userVar;
+	bool wasPublished;
+}doneNotice_t;
+
+
+// ******** local function prototypes ********
+static entry_t* getEntryToDisplace(ovr_publishScheduler_class_t classIn);
+static void fillEntry(entry_t *const entryIn, void *const payloadIn, size_t payloadSize_bytesIn);
+static doneNotice_t releaseEntry(entry_t *const entryIn, bool wasPublishedIn);
+static void notifyDone(doneNotice_t *const noticeIn);
+static void refillTokens(void);
+static bool isAcked(ovr_publishScheduler_class_t classIn);
+static void loadDelivery(void);
+static bool publishEntry(entry_t *const entryIn, size_t cost_bytesIn, bool isQos1In);
+
+static void mqttCb_onConnect(cxa_mqtt_client_t *const clientIn, void* userVarIn);
+static void mqttCb_onPingResp(cxa_mqtt_client_t *const clientIn, void* userVarIn);
+
+static void cb_onRunLoopUpdate(void* userVarIn);
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setShaping(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setDelivery(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getPublisherStats(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+static bool isInit = false;
+
+static cxa_mqtt_rpc_node_t rpcNode;
+static ovr_memArena_t arena;
+
+static entry_t entries[OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES];
+static uint32_t nextSequence;
+static uint16_t depth;
+static uint16_t depth_highWater;
+static uint32_t delay_highWater_ms;
+
+static ovr_publishScheduler_classStats_t classStats[OVR_PUBLISHSCHEDULER_NUM_CLASSES];
+
+// token bucket (only touched on the network thread once initialized)
+static uint32_t rate_bytesPerSec;
+static uint32_t burst_bytes;
+static uint32_t tokens_bytes;
+static uint32_t lastRefillTime_us;
+
+// at-least-once delivery (window only touched on the network thread)
+static uint8_t ackedClassMask;
+static ovr_ackWindow_t ackWindow;
+
+
+// ******** global function implementations ********
+void ovr_publishScheduler_init(cxa_mqtt_rpc_node_t *const rootNodeIn, int threadIdIn)
+{
+	cxa_assert(rootNodeIn);
+
+	// payloads are big and rarely touched...keep them out of internal RAM if we can
+	size_t payloadSize_bytes = OVR_MEMARENA_ALIGN(OVR_PUBLISHSCHEDULER_MAXSIZE_PAYLOAD_BYTES);
+	if( !ovr_memArena_init(&arena, OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES * payloadSize_bytes, OVR_MEMARENA_REGION_PSRAM) ) return;
+
+	memset(entries, 0, sizeof(entries));
+	for( size_t i = 0; i < OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES; i++ )
+	{
+		entries[i].payload = ovr_memArena_alloc(&arena, OVR_PUBLISHSCHEDULER_MAXSIZE_PAYLOAD_BYTES);
+		cxa_assert(entries[i].payload);
+	}
+	nextSequence = 0;
+	depth = 0;
+	depth_highWater = 0;
+	delay_highWater_ms = 0;
+	memset(classStats, 0, sizeof(classStats));
+
+	rate_bytesPerSec = OVR_PUBLISHSCHEDULER_RATE_BYTESPERSEC;
+	burst_bytes = OVR_PUBLISHSCHEDULER_BURST_BYTES;
+	tokens_bytes = burst_bytes;
+	lastRefillTime_us = cxa_timeBase_getCount_us();
+
+	ackedClassMask = 0;
+	ovr_ackWindow_init(&ackWindow, OVR_PUBLISHSCHEDULER_ACKWINDOW_SIZE, OVR_PUBLISHSCHEDULER_ACKTIMEOUT_MS);
+	loadDelivery();
+
+	// setup our rpc node
+	cxa_mqtt_rpc_node_init_formattedString(&rpcNode, rootNodeIn, "publisher");
+	cxa_mqtt_rpc_node_addMethod(&rpcNode, "setShaping", rpcMethodCb_setShaping, NULL);
+	cxa_mqtt_rpc_node_addMethod(&rpcNode, "setDelivery", rpcMethodCb_setDelivery, NULL);
+	cxa_mqtt_rpc_node_addMethod(&rpcNode, "getPublisherStats", rpcMethodCb_getPublisherStats, NULL);
+
+	// acked classes are released by the keepalive, anything still unacked
+	// when the connection dropped is resent once it's back
+	cxa_mqtt_client_t *mqttC = cxa_mqtt_connManager_getMqttClient();
+	if( mqttC != NULL ) cxa_mqtt_client_addListener(mqttC, mqttCb_onConnect, NULL, NULL, mqttCb_onPingResp, NULL);
+
+	cxa_runLoop_addEntry(threadIdIn, cb_onRunLoopUpdate, NULL);
+
+	__atomic_store_n(&isInit, true, __ATOMIC_RELEASE);
+}
+
+
+bool ovr_publishScheduler_publish(cxa_mqtt_rpc_node_t *const nodeIn, const char *const nameIn,
+								  ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn,
+								  void *const payloadIn, size_t payloadSize_bytesIn)
+{
+	return ovr_publishScheduler_publish_withCallback(nodeIn, nameIn, classIn, coalesceKeyIn, payloadIn, payloadSize_bytesIn, NULL, NULL);
+}
+
+
+bool ovr_publishScheduler_publish_withCallback(cxa_mqtt_rpc_node_t *const nodeIn, const char *const nameIn,
+											   ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn,
+											   void *const payloadIn, size_t payloadSize_bytesIn,
+											   ovr_publishScheduler_cb_onDone_t cbIn, void* userVarIn)
+{
+	cxa_assert(nodeIn);
+	cxa_assert(nameIn);
+	cxa_assert(classIn < OVR_PUBLISHSCHEDULER_NUM_CLASSES);
+	cxa_assert(payloadIn || (payloadSize_bytesIn == 0));
+
+	if( !__atomic_load_n(&isInit, __ATOMIC_ACQUIRE) )
+	{
+		bool wasPublished = cxa_mqtt_rpc_node_publishNotification(nodeIn, (char*)nameIn, CXA_MQTT_QOS_ATMOST_ONCE, payloadIn, payloadSize_bytesIn);
+		if( wasPublished && (cbIn != NULL) ) cbIn(true, userVarIn);
+		return wasPublished;
+	}
+
+	ovr_publishScheduler_classStats_t* currStats = &classStats[classIn];
+
+	// it would only fail to publish later (after the producer has let go of its data)
+	if( payloadSize_bytesIn > ovr_publishScheduler_getMaxPayloadSize_bytes(nodeIn, nameIn) )
+	{
+		cxa_criticalSection_enter();
+		currStats->numDropped++;
+		cxa_criticalSection_exit();
+		return false;
+	}
+
+	cxa_criticalSection_enter();
+
+	// a newer reading supersedes one still waiting (it keeps its place in line)
+	if( coalesceKeyIn != OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE )
+	{
+		for( size_t i = 0; i < OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES; i++ )
+		{
+			entry_t* currEntry = &entries[i];
+			if( !currEntry->isUsed || currEntry->isFilling || currEntry->isInFlight || (currEntry->cb_onDone != NULL) ) continue;
+			if( (currEntry->class != classIn) || (currEntry->coalesceKey != coalesceKeyIn) ||
+				(currEntry->node != nodeIn) || (strcmp(currEntry->name, nameIn) != 0) ) continue;
+
+			currEntry->isFilling = true;
+			currEntry->numAttempts = 0;
+			currEntry->cb_onDone = cbIn;
+			currEntry->cb_userVar = userVarIn;
+			currStats->numCoalesced++;
+			cxa_criticalSection_exit();
+
+			fillEntry(currEntry, payloadIn, payloadSize_bytesIn);
+			return true;
+		}
+	}
+
+	doneNotice_t displacedNotice = { .cb = NULL };
+	entry_t* targetEntry = NULL;
+	for( size_t i = 0; i < OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES; i++ )
+	{
+		if( !entries[i].isUsed )
+		{
+			targetEntry = &entries[i];
+			break;
+		}
+	}
+	if( targetEntry == NULL )
+	{
+		targetEntry = getEntryToDisplace(classIn);
+		if( targetEntry == NULL )
+		{
+			currStats->numDropped++;
+			cxa_criticalSection_exit();
+			return false;
+		}
+		classStats[targetEntry->class].numDropped++;
+		displacedNotice = releaseEntry(targetEntry, false);
+	}
+
+	targetEntry->isUsed = true;
+	targetEntry->isFilling = true;
+	targetEntry->isInFlight = false;
+	targetEntry->isAwaitingAck = false;
+	targetEntry->hasBeenSent = false;
+	targetEntry->class = classIn;
+	targetEntry->numAttempts = 0;
+	targetEntry->node = nodeIn;
+	targetEntry->name = nameIn;
+	targetEntry->coalesceKey = coalesceKeyIn;
+	targetEntry->sequence = nextSequence++;
+	targetEntry->enqueueTime_us = cxa_timeBase_getCount_us();
+	targetEntry->cb_onDone = cbIn;
+	targetEntry->cb_userVar = userVarIn;
+
+	currStats->depth++;
+	currStats->numEnqueued++;
+	depth++;
+	if( depth > depth_highWater ) depth_highWater = depth;
+	cxa_criticalSection_exit();
+
+	notifyDone(&displacedNotice);
+	fillEntry(targetEntry, payloadIn, payloadSize_bytesIn);
+	return true;
+}
+
+
+size_t ovr_publishScheduler_getMaxPayloadSize_bytes(cxa_mqtt_rpc_node_t *const nodeIn, const char *const nameIn)
+{
+	cxa_assert(nodeIn);
+	cxa_assert(nameIn);
+
+	// topic is "<node path>/<name>" where the path is every node's name from the root down, '/' separated
+	size_t topicLen_bytes = strlen(nameIn);
+	for( cxa_mqtt_rpc_node_t* currNode = nodeIn; currNode != NULL; currNode = currNode->parentNode )
+	{
+		topicLen_bytes += strlen(currNode->name) + 1;
+	}
+
+	return (topicLen_bytes < OVR_PUBLISHSCHEDULER_MAXSIZE_PAYLOAD_BYTES) ? (OVR_PUBLISHSCHEDULER_MAXSIZE_PAYLOAD_BYTES - topicLen_bytes) : 0;
+}
+
+
+uint64_t ovr_publishScheduler_getCoalesceKey(cxa_eui48_t *const eui48In)
+{
+	cxa_assert(eui48In);
+
+	// the top bit keeps it from ever colliding with COALESCEKEY_NONE
+	uint64_t retVal = (1ULL << 63);
+	for( size_t i = 0; i < sizeof(eui48In->bytes); i++ )
+	{
+		retVal |= ((uint64_t)eui48In->bytes[i]) << (8 * i);
+	}
+	return retVal;
+}
+
+
+void ovr_publishScheduler_setShaping(uint32_t rate_bytesPerSecIn, uint32_t burst_bytesIn)
+{
+	cxa_criticalSection_enter();
+	rate_bytesPerSec = rate_bytesPerSecIn;
+	burst_bytes = burst_bytesIn;
+	if( tokens_bytes > burst_bytes ) tokens_bytes = burst_bytes;
+	cxa_criticalSection_exit();
+}
+
+
+bool ovr_publishScheduler_setDelivery(uint8_t ackedClassMaskIn, size_t windowSizeIn, uint32_t ackTimeout_msIn)
+{
+	if( ackedClassMaskIn >= (1 << OVR_PUBLISHSCHEDULER_NUM_CLASSES) ) return false;
+
+	cxa_criticalSection_enter();
+	bool retVal = ovr_ackWindow_configure(&ackWindow, windowSizeIn, ackTimeout_msIn);
+	if( retVal ) ackedClassMask = ackedClassMaskIn;
+	cxa_criticalSection_exit();
+	if( !retVal ) return false;
+
+	return cxa_nvsManager_set_uint32(NVS_KEY_ACKED_CLASSES, ackedClassMaskIn) &&
+		   cxa_nvsManager_set_uint32(NVS_KEY_ACK_WINDOW, windowSizeIn) &&
+		   cxa_nvsManager_set_uint32(NVS_KEY_ACK_TIMEOUT, ackTimeout_msIn) &&
+		   cxa_nvsManager_commit();
+}
+
+
+ovr_publishScheduler_classStats_t ovr_publishScheduler_getClassStats(ovr_publishScheduler_class_t classIn)
+{
+	cxa_assert(classIn < OVR_PUBLISHSCHEDULER_NUM_CLASSES);
+
+	cxa_criticalSection_enter();
+	ovr_publishScheduler_classStats_t retVal = classStats[classIn];
+	cxa_criticalSection_exit();
+
+	return retVal;
+}
+
+
+void ovr_publishScheduler_takeHighWater(uint16_t *const maxDepthOut, uint32_t *const maxDelay_msOut)
+{
+	cxa_criticalSection_enter();
+	if( maxDepthOut != NULL ) *maxDepthOut = depth_highWater;
+	if( maxDelay_msOut != NULL ) *maxDelay_msOut = delay_highWater_ms;
+	depth_highWater = depth;
+	delay_highWater_ms = 0;
+	cxa_criticalSection_exit();
+}
+
+
+// ******** local function implementations ********
+static entry_t* getEntryToDisplace(ovr_publishScheduler_class_t classIn)
+{
+	// must be called from within a critical section
+
+	// the newest entry of the least important class below the newcomer's
+	entry_t* retVal = NULL;
+	for( size_t i = 0; i < OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES; i++ )
+	{
+		entry_t* currEntry = &entries[i];
+		if( !currEntry->isUsed || currEntry->isFilling || currEntry->isInFlight || (currEntry->class <= classIn) ) continue;
+
+		if( (retVal == NULL) ||
+			(currEntry->class > retVal->class) ||
+			((currEntry->class == retVal->class) && ((int32_t)(currEntry->sequence - retVal->sequence) > 0)) )
+		{
+			retVal = currEntry;
+		}
+	}
+	return retVal;
+}
+
+
+static void fillEntry(entry_t *const entryIn, void *const payloadIn, size_t payloadSize_bytesIn)
+{
+	cxa_assert(entryIn);
+
+	// the entry is ours while it's filling (nobody publishes, replaces or displaces it)
+	// so the (possibly PSRAM) copy can happen outside the critical section
+	memcpy(entryIn->payload, payloadIn, payloadSize_bytesIn);
+
+	cxa_criticalSection_enter();
+	entryIn->payloadSize_bytes = payloadSize_bytesIn;
+	entryIn->isFilling = false;
+	cxa_criticalSection_exit();
+}
+
+
+static doneNotice_t releaseEntry(entry_t *const entryIn, bool wasPublishedIn)
+{
+	cxa_assert(entryIn);
+
+	// must be called from within a critical section
+	doneNotice_t retVal = { .cb = entryIn->cb_onDone, .userVar = entryIn->cb_userVar, .wasPublished = wasPublishedIn };
+
+	entryIn->isUsed = false;
+	entryIn->isFilling = false;
+	entryIn->isInFlight = false;
+	entryIn->isAwaitingAck = false;
+	entryIn->hasBeenSent = false;
+	entryIn->cb_onDone = NULL;
+	entryIn->cb_userVar = NULL;
+	classStats[entryIn->class].depth--;
+	depth--;
+
+	return retVal;
+}
+
+
+static void notifyDone(doneNotice_t *const noticeIn)
+{
+	cxa_assert(noticeIn);
+
+	// must be called from outside a critical section
+	if( noticeIn->cb != NULL ) noticeIn->cb(noticeIn->wasPublished, noticeIn->userVar);
+}
+
+
+static void refillTokens(void)
+{
+	uint32_t now_us = cxa_timeBase_getCount_us();
+	uint32_t elapsed_us = now_us - lastRefillTime_us;
+
+	uint64_t newTokens_bytes = ((uint64_t)elapsed_us * rate_bytesPerSec) / 1000000;
+	if( (tokens_bytes + newTokens_bytes) >= burst_bytes )
+	{
+		tokens_bytes = burst_bytes;
+		lastRefillTime_us = now_us;
+	}
+	else if( newTokens_bytes > 0 )
+	{
+		// only advance by what we credited so fractional bytes carry over
+		tokens_bytes += newTokens_bytes;
+		lastRefillTime_us += (uint32_t)((newTokens_bytes * 1000000) / rate_bytesPerSec);
+	}
+}
+
+
+static bool isAcked(ovr_publishScheduler_class_t classIn)
+{
+	return (ackedClassMask & (1 << classIn)) != 0;
+}
+
+
+static void loadDelivery(void)
+{
+	uint32_t mask_raw;
+	uint32_t windowSize_raw;
+	uint32_t ackTimeout_raw;
+	if( !cxa_nvsManager_get_uint32(NVS_KEY_ACKED_CLASSES, &mask_raw) ||
+		!cxa_nvsManager_get_uint32(NVS_KEY_ACK_WINDOW, &windowSize_raw) ||
+		!cxa_nvsManager_get_uint32(NVS_KEY_ACK_TIMEOUT, &ackTimeout_raw) ) return;
+
+	// invalid settings leave every class at most-once
+	if( mask_raw >= (1 << OVR_PUBLISHSCHEDULER_NUM_CLASSES) ) return;
+	if( !ovr_ackWindow_configure(&ackWindow, windowSize_raw, ackTimeout_raw) ) return;
+	ackedClassMask = mask_raw;
+}
+
+
+static bool publishEntry(entry_t *const entryIn, size_t cost_bytesIn, bool isQos1In)
+{
+	cxa_assert(entryIn);
+
+	// the payload can't change underneath us while we're in flight
+	bool wasPublished = cxa_mqtt_rpc_node_publishNotification(entryIn->node, (char*)entryIn->name,
+															  (isQos1In ? CXA_MQTT_QOS_ATLEAST_ONCE : CXA_MQTT_QOS_ATMOST_ONCE),
+															  entryIn->payload, entryIn->payloadSize_bytes);
+
+	doneNotice_t notice = { .cb = NULL };
+	cxa_criticalSection_enter();
+	ovr_publishScheduler_classStats_t* currStats = &classStats[entryIn->class];
+	if( wasPublished )
+	{
+		tokens_bytes = (tokens_bytes > cost_bytesIn) ? (tokens_bytes - cost_bytesIn) : 0;
+
+		// resends don't count again
+		if( !entryIn->hasBeenSent )
+		{
+			entryIn->hasBeenSent = true;
+
+			uint32_t delay_ms = (cxa_timeBase_getCount_us() - entryIn->enqueueTime_us) / 1000;
+			currStats->numPublished++;
+			currStats->delay_total_ms += delay_ms;
+			if( delay_ms > currStats->delay_max_ms ) currStats->delay_max_ms = delay_ms;
+			if( delay_ms > delay_highWater_ms ) delay_highWater_ms = delay_ms;
+		}
+
+		if( entryIn->isAwaitingAck )
+		{
+			// resent...still waiting on the keepalive to confirm it
+		}
+		else if( isQos1In && ovr_ackWindow_open(&ackWindow, entryIn, cxa_timeBase_getCount_us() / 1000) )
+		{
+			entryIn->isAwaitingAck = true;
+		}
+		else
+		{
+			// (a window shrunk since we checked it means the broker has it, we just don't wait to confirm it)
+			notice = releaseEntry(entryIn, true);
+		}
+	}
+	else if( entryIn->isAwaitingAck )
+	{
+		// stays in the window...the ack timeout (or reconnect) brings it back around
+	}
+	else if( ++entryIn->numAttempts >= MAXNUM_ATTEMPTS )
+	{
+		currStats->numFailed++;
+		notice = releaseEntry(entryIn, false);
+	}
+	else
+	{
+		entryIn->isInFlight = false;
+	}
+	cxa_criticalSection_exit();
+	notifyDone(&notice);
+
+	return wasPublished;
+}
+
+
+static void cb_onRunLoopUpdate(void* userVarIn)
+{
+	for( size_t numPublished = 0; numPublished < MAXNUM_PUBLISHES_PER_ITERATION; numPublished++ )
+	{
+		cxa_criticalSection_enter();
+		if( rate_bytesPerSec != 0 ) refillTokens();
+
+		// resends go first and aren't held back by the bucket (there's at most a window's worth)
+		uint32_t now_ms = cxa_timeBase_getCount_us() / 1000;
+		void* expiredEntry;
+		entry_t* resendEntry = ovr_ackWindow_getNextResend(&ackWindow, now_ms, &expiredEntry);
+		if( expiredEntry != NULL )
+		{
+			classStats[((entry_t*)expiredEntry)->class].numFailed++;
+			doneNotice_t notice = releaseEntry(expiredEntry, false);
+			cxa_criticalSection_exit();
+			notifyDone(&notice);
+			continue;
+		}
+		if( resendEntry != NULL )
+		{
+			cxa_criticalSection_exit();
+
+			// uplink is struggling...try again next iteration
+			if( !publishEntry(resendEntry, resendEntry->payloadSize_bytes, true) ) return;
+			continue;
+		}
+
+		// most important class first, oldest first within it
+		bool hasAckRoom = ovr_ackWindow_hasRoom(&ackWindow);
+		entry_t* nextEntry = NULL;
+		for( size_t i = 0; i < OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES; i++ )
+		{
+			entry_t* currEntry = &entries[i];
+			if( !currEntry->isUsed || currEntry->isFilling || currEntry->isInFlight ) continue;
+
+			// a full window holds back acked classes only
+			if( !hasAckRoom && isAcked(currEntry->class) ) continue;
+
+			if( (nextEntry == NULL) ||
+				(currEntry->class < nextEntry->class) ||
+				((currEntry->class == nextEntry->class) && ((int32_t)(currEntry->sequence - nextEntry->sequence) < 0)) )
+			{
+				nextEntry = currEntry;
+			}
+		}
+		if( nextEntry == NULL )
+		{
+			cxa_criticalSection_exit();
+			return;
+		}
+
+		// anything bigger than the burst waits for a full bucket
+		size_t cost_bytes = 0;
+		if( rate_bytesPerSec != 0 )
+		{
+			cost_bytes = (nextEntry->payloadSize_bytes < burst_bytes) ? nextEntry->payloadSize_bytes : burst_bytes;
+			if( tokens_bytes < cost_bytes )
+			{
+				cxa_criticalSection_exit();
+				return;
+			}
+		}
+		nextEntry->isInFlight = true;
+		bool isQos1 = isAcked(nextEntry->class);
+		cxa_criticalSection_exit();
+
+		if( !publishEntry(nextEntry, cost_bytes, isQos1) ) return;
+	}
+}
+
+
+static void mqttCb_onConnect(cxa_mqtt_client_t *const clientIn, void* userVarIn)
+{
+	cxa_criticalSection_enter();
+	ovr_ackWindow_markAllForResend(&ackWindow);
+	cxa_criticalSection_exit();
+}
+
+
+static void mqttCb_onPingResp(cxa_mqtt_client_t *const clientIn, void* userVarIn)
+{
+	cxa_criticalSection_enter();
+	ovr_ackWindow_onPingResp(&ackWindow);
+	cxa_criticalSection_exit();
+
+	// each released entry's callback is called outside the critical section
+	while( true )
+	{
+		cxa_criticalSection_enter();
+		entry_t* ackedEntry = ovr_ackWindow_getNextAcked(&ackWindow, cxa_timeBase_getCount_us() / 1000);
+		if( ackedEntry == NULL )
+		{
+			cxa_criticalSection_exit();
+			return;
+		}
+		doneNotice_t notice = releaseEntry(ackedEntry, true);
+		cxa_criticalSection_exit();
+		notifyDone(&notice);
+	}
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setShaping(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	// params: [rate_bytesPerSec:4][burst_bytes:4]  (rate of 0 disables shaping)
+	uint32_t rate;
+	uint32_t burst;
+	if( !cxa_linkedField_get_uint32LE(paramsIn, 0, rate) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint32LE(paramsIn, 4, burst) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( (rate != 0) && (burst == 0) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	ovr_publishScheduler_setShaping(rate, burst);
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_setDelivery(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	// params: [ackedClassMask:1][windowSize:1][ackTimeout_ms:4]
+	uint8_t ackedClassMask_new;
+	uint8_t windowSize;
+	uint32_t ackTimeout_ms;
+	if( !cxa_linkedField_get_uint8(paramsIn, 0, ackedClassMask_new) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint8(paramsIn, 1, windowSize) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+	if( !cxa_linkedField_get_uint32LE(paramsIn, 2, ackTimeout_ms) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+
+	return ovr_publishScheduler_setDelivery(ackedClassMask_new, windowSize, ackTimeout_ms) ? CXA_MQTT_RPC_METHODRETVAL_SUCCESS : CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS;
+}
+
+
+static cxa_mqtt_rpc_methodRetVal_t rpcMethodCb_getPublisherStats(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn)
+{
+	// response: [rate_bytesPerSec:4][burst_bytes:4][tokens_bytes:4]
+	//           then per class (alert, presence, telemetry, diagnostics):
+	//           [depth:2][enqueued:4][published:4][coalesced:4][dropped:4][failed:4][avgDelay_ms:4][maxDelay_ms:4]
+	//           then [ackedClassMask:1][windowSize:1][numInFlight:1][ackTimeout_ms:4]
+	//                [opened:4][acked:4][resends:4][expired:4][maxAckTime_ms:4]
+	cxa_criticalSection_enter();
+	uint32_t rate = rate_bytesPerSec;
+	uint32_t burst = burst_bytes;
+	uint32_t tokens = tokens_bytes;
+	uint8_t mask = ackedClassMask;
+	uint8_t windowSize = ovr_ackWindow_getSize(&ackWindow);
+	uint8_t numInFlight = ovr_ackWindow_getNumInFlight(&ackWindow);
+	uint32_t ackTimeout_ms = ovr_ackWindow_getAckTimeout_ms(&ackWindow);
+	ovr_ackWindow_stats_t ackStats = ovr_ackWindow_getStats(&ackWindow);
+	cxa_criticalSection_exit();
+
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, rate) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, burst) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, tokens) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	for( size_t i = 0; i < OVR_PUBLISHSCHEDULER_NUM_CLASSES; i++ )
+	{
+		ovr_publishScheduler_classStats_t stats = ovr_publishScheduler_getClassStats(i);
+		uint32_t avgDelay_ms = (stats.numPublished > 0) ? (stats.delay_total_ms / stats.numPublished) : 0;
+
+		if( !cxa_linkedField_append_uint16LE(responseParamsIn, stats.depth) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numEnqueued) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numPublished) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numCoalesced) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numDropped) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.numFailed) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, avgDelay_ms) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+		if( !cxa_linkedField_append_uint32LE(responseParamsIn, stats.delay_max_ms) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	}
+
+	if( !cxa_linkedField_append_uint8(responseParamsIn, mask) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint8(responseParamsIn, windowSize) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint8(responseParamsIn, numInFlight) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, ackTimeout_ms) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, ackStats.numOpened) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, ackStats.numAcked) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, ackStats.numResends) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, ackStats.numExpired) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+	if( !cxa_linkedField_append_uint32LE(responseParamsIn, ackStats.ackTime_max_ms) ) return CXA_MQTT_RPC_METHODRETVAL_FAIL;
+
+	return CXA_MQTT_RPC_METHODRETVAL_SUCCESS;
+}
+
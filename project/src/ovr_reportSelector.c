@@ -0,0 +1,255 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "ovr_reportSelector.h"
+
+
+// ******** includes ********
+#include <cxa_assert.h>
+
+
+// ******** local macro definitions ********
+#define REPORTSIZE_EWMA_SHIFT			3
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void siftDown(ovr_reportSelector_t *const rsIn, size_t indexIn);
+static void siftUp(ovr_reportSelector_t *const rsIn, size_t indexIn);
+static bool isInTopK(ovr_reportSelector_t *const rsIn, uint16_t indexIn);
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void ovr_reportSelector_init(ovr_reportSelector_t *const rsIn)
+{
+	cxa_assert(rsIn);
+
+	rsIn->policy = OVR_REPORTSELECTOR_POLICY_CLOSEST;
+	rsIn->budget_bytes = 0;
+	rsIn->rrShare_pcnt = OVR_REPORTSELECTOR_DEFAULT_RRSHARE_PCNT;
+
+	rsIn->reportSize_avg_bytes = OVR_REPORTSELECTOR_INITIAL_REPORTSIZE_BYTES;
+	rsIn->rrCursor = 0;
+
+	rsIn->numBeacons = 0;
+	rsIn->numTopKSlots = 0;
+	rsIn->numRrSlots = 0;
+	rsIn->heapSize = 0;
+}
+
+
+bool ovr_reportSelector_setPolicy(ovr_reportSelector_t *const rsIn, ovr_reportSelector_policy_t policyIn, uint32_t budget_bytesIn, uint8_t rrShare_pcntIn)
+{
+	cxa_assert(rsIn);
+
+	if( policyIn > OVR_REPORTSELECTOR_POLICY_MOSTCHANGED ) return false;
+	if( rrShare_pcntIn > 100 ) return false;
+
+	rsIn->policy = policyIn;
+	rsIn->budget_bytes = budget_bytesIn;
+	rsIn->rrShare_pcnt = rrShare_pcntIn;
+	return true;
+}
+
+
+ovr_reportSelector_policy_t ovr_reportSelector_getPolicy(ovr_reportSelector_t *const rsIn)
+{
+	cxa_assert(rsIn);
+
+	return rsIn->policy;
+}
+
+
+uint32_t ovr_reportSelector_getBudget_bytes(ovr_reportSelector_t *const rsIn)
+{
+	cxa_assert(rsIn);
+
+	return rsIn->budget_bytes;
+}
+
+
+uint8_t ovr_reportSelector_getRrShare_pcnt(ovr_reportSelector_t *const rsIn)
+{
+	cxa_assert(rsIn);
+
+	return rsIn->rrShare_pcnt;
+}
+
+
+bool ovr_reportSelector_isUnlimited(ovr_reportSelector_t *const rsIn)
+{
+	cxa_assert(rsIn);
+
+	return (rsIn->budget_bytes == 0);
+}
+
+
+void ovr_reportSelector_beginCycle(ovr_reportSelector_t *const rsIn, size_t numBeaconsIn)
+{
+	cxa_assert(rsIn);
+
+	rsIn->numBeacons = numBeaconsIn;
+	rsIn->heapSize = 0;
+
+	// always at least one slot so a tiny budget still makes progress
+	size_t numSlots = (rsIn->reportSize_avg_bytes > 0) ? (rsIn->budget_bytes / rsIn->reportSize_avg_bytes) : 1;
+	if( numSlots < 1 ) numSlots = 1;
+	if( numSlots > OVR_REPORTSELECTOR_MAXNUM_SLOTS ) numSlots = OVR_REPORTSELECTOR_MAXNUM_SLOTS;
+	if( numSlots > numBeaconsIn ) numSlots = numBeaconsIn;
+
+	// if everyone fits there's nothing to prioritize
+	if( (rsIn->policy == OVR_REPORTSELECTOR_POLICY_ROUNDROBIN) || (numSlots == numBeaconsIn) )
+	{
+		rsIn->numRrSlots = numSlots;
+	}
+	else
+	{
+		// round up so a non-zero share always gets a slot
+		rsIn->numRrSlots = ((numSlots * rsIn->rrShare_pcnt) + 99) / 100;
+	}
+	rsIn->numTopKSlots = numSlots - rsIn->numRrSlots;
+}
+
+
+void ovr_reportSelector_offer(ovr_reportSelector_t *const rsIn, uint16_t indexIn, int32_t scoreIn)
+{
+	cxa_assert(rsIn);
+
+	if( rsIn->numTopKSlots == 0 ) return;
+
+	if( rsIn->heapSize < rsIn->numTopKSlots )
+	{
+		rsIn->heap[rsIn->heapSize].score = scoreIn;
+		rsIn->heap[rsIn->heapSize].index = indexIn;
+		rsIn->heapSize++;
+		siftUp(rsIn, rsIn->heapSize - 1);
+	}
+	else if( scoreIn > rsIn->heap[0].score )
+	{
+		// displaces the weakest of our current top-K
+		rsIn->heap[0].score = scoreIn;
+		rsIn->heap[0].index = indexIn;
+		siftDown(rsIn, 0);
+	}
+}
+
+
+size_t ovr_reportSelector_endCycle(ovr_reportSelector_t *const rsIn, uint16_t *const indicesOut, size_t maxNumIndicesIn)
+{
+	cxa_assert(rsIn);
+	cxa_assert(indicesOut);
+
+	// heapsort in place (leaves the heap in descending score order)
+	size_t heapSize = rsIn->heapSize;
+	while( rsIn->heapSize > 1 )
+	{
+		ovr_reportSelector_candidate_t tmp = rsIn->heap[0];
+		rsIn->heap[0] = rsIn->heap[rsIn->heapSize - 1];
+		rsIn->heap[rsIn->heapSize - 1] = tmp;
+		rsIn->heapSize--;
+		siftDown(rsIn, 0);
+	}
+	rsIn->heapSize = heapSize;
+
+	size_t numIndices = 0;
+	for( size_t i = 0; (i < rsIn->heapSize) && (numIndices < maxNumIndicesIn); i++ )
+	{
+		indicesOut[numIndices++] = rsIn->heap[i].index;
+	}
+
+	// everyone else takes turns
+	if( rsIn->numBeacons == 0 ) return numIndices;
+	if( rsIn->rrCursor >= rsIn->numBeacons ) rsIn->rrCursor = 0;
+
+	size_t startIndex = rsIn->rrCursor;
+	size_t numRrPicked = 0;
+	for( size_t i = 0; (i < rsIn->numBeacons) && (numRrPicked < rsIn->numRrSlots) && (numIndices < maxNumIndicesIn); i++ )
+	{
+		uint16_t currIndex = (startIndex + i) % rsIn->numBeacons;
+		if( isInTopK(rsIn, currIndex) ) continue;
+
+		indicesOut[numIndices++] = currIndex;
+		numRrPicked++;
+		rsIn->rrCursor = (currIndex + 1) % rsIn->numBeacons;
+	}
+
+	return numIndices;
+}
+
+
+void ovr_reportSelector_recordReportSize(ovr_reportSelector_t *const rsIn, size_t size_bytesIn)
+{
+	cxa_assert(rsIn);
+
+	int32_t diff = (int32_t)size_bytesIn - (int32_t)rsIn->reportSize_avg_bytes;
+	rsIn->reportSize_avg_bytes += diff / (1 << REPORTSIZE_EWMA_SHIFT);
+	if( rsIn->reportSize_avg_bytes == 0 ) rsIn->reportSize_avg_bytes = 1;
+}
+
+
+// ******** local function implementations ********
+static void siftDown(ovr_reportSelector_t *const rsIn, size_t indexIn)
+{
+	cxa_assert(rsIn);
+
+	while( true )
+	{
+		size_t smallest = indexIn;
+		size_t left = (2 * indexIn) + 1;
+		size_t right = left + 1;
+		if( (left < rsIn->heapSize) && (rsIn->heap[left].score < rsIn->heap[smallest].score) ) smallest = left;
+		if( (right < rsIn->heapSize) && (rsIn->heap[right].score < rsIn->heap[smallest].score) ) smallest = right;
+		if( smallest == indexIn ) return;
+
+		ovr_reportSelector_candidate_t tmp = rsIn->heap[indexIn];
+		rsIn->heap[indexIn] = rsIn->heap[smallest];
+		rsIn->heap[smallest] = tmp;
+		indexIn = smallest;
+	}
+}
+
+
+static void siftUp(ovr_reportSelector_t *const rsIn, size_t indexIn)
+{
+	cxa_assert(rsIn);
+
+	while( indexIn > 0 )
+	{
+		size_t parent = (indexIn - 1) / 2;
+		if( rsIn->heap[parent].score <= rsIn->heap[indexIn].score ) return;
+
+		ovr_reportSelector_candidate_t tmp = rsIn->heap[indexIn];
+		rsIn->heap[indexIn] = rsIn->heap[parent];
+		rsIn->heap[parent] = tmp;
+		indexIn = parent;
+	}
+}
+
+
+static bool isInTopK(ovr_reportSelector_t *const rsIn, uint16_t indexIn)
+{
+	cxa_assert(rsIn);
+
+	for( size_t i = 0; i < rsIn->heapSize; i++ )
+	{
+		if( rsIn->heap[i].index == indexIn ) return true;
+	}
+	return false;
+}
@@ -0,0 +1,92 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "testRunner.h"
+
+
+// ******** includes ********
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <stubHal.h>
+
+
+// ******** local macro definitions ********
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+
+
+// ********  local variable declarations *********
+static jmp_buf failJmp;
+
+
+// ******** global function implementations ********
+int main(int argc, char** argv)
+{
+	const char* onlyTest = (argc > 1) ? argv[1] : NULL;
+
+	size_t numRun = 0;
+	size_t numFailed = 0;
+	for( const testRunner_test_t* currTest = testRunner_tests; currTest->fn != NULL; currTest++ )
+	{
+		if( (onlyTest != NULL) && (strcmp(onlyTest, currTest->name) != 0) ) continue;
+
+		stubHal_reset();
+		numRun++;
+		if( setjmp(failJmp) == 0 )
+		{
+			currTest->fn();
+			printf("PASS %s\n", currTest->name);
+		}
+		else
+		{
+			printf("FAIL %s\n", currTest->name);
+			numFailed++;
+		}
+		fflush(stdout);
+	}
+
+	printf("%zu tests, %zu failed\n", numRun, numFailed);
+	return ((numRun == 0) || (numFailed > 0)) ? 1 : 0;
+}
+
+
+void testRunner_fail(const char *const fileIn, int lineIn, const char *const fmtIn, ...)
+{
+	printf("%s:%d: ", fileIn, lineIn);
+
+	va_list varArgs;
+	va_start(varArgs, fmtIn);
+	vprintf(fmtIn, varArgs);
+	va_end(varArgs);
+	printf("\n");
+
+	longjmp(failJmp, 1);
+}
+
+
+void testRunner_report(const char *const benchIn, const char *const keyIn, double valueIn)
+{
+	printf("BENCH %s %s %.3f\n", benchIn, keyIn, valueIn);
+}
+
+
+// ******** local function implementations ********
@@ -0,0 +1,88 @@
+/**
+ * @file
+ * Minimal runner for the host tests. Each test executable defines a
+ * NULL-terminated testRunner_tests[] table; main() resets the stub HAL before
+ * every test and returns non-zero if any of them failed. An optional test name
+ * on the command line runs just that test.
+ *
+ * Benchmarks print their results through testRunner_report so they can be
+ * picked out of the ctest log ("BENCH <bench> <key> <value>").
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef TESTRUNNER_H_
+#define TESTRUNNER_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#define TESTRUNNER_TEST(fnIn)					{ #fnIn, fnIn }
+#define TESTRUNNER_END							{ NULL, NULL }
+
+#define TEST_ASSERT(condIn)																\
+	do { if( !(condIn) ) testRunner_fail(__FILE__, __LINE__, "%s", #condIn); } while(0)
+
+#define TEST_ASSERT_EQUAL_INT(expectedIn, actualIn)										\
+	do {																				\
+		long long expected_ = (long long)(expectedIn);									\
+		long long actual_ = (long long)(actualIn);										\
+		if( expected_ != actual_ )														\
+			testRunner_fail(__FILE__, __LINE__, "%s: expected %lld, got %lld", #actualIn, expected_, actual_);	\
+	} while(0)
+
+#define TEST_ASSERT_EQUAL_STRING(expectedIn, actualIn)									\
+	do {																				\
+		const char* expected_ = (expectedIn);											\
+		const char* actual_ = (actualIn);												\
+		if( (actual_ == NULL) || (strcmp(expected_, actual_) != 0) )					\
+			testRunner_fail(__FILE__, __LINE__, "%s: expected \"%s\", got \"%s\"", #actualIn, expected_, (actual_ != NULL) ? actual_ : "(null)");	\
+	} while(0)
+
+
+// ******** global type definitions *********
+typedef void (*testRunner_testFn_t)(void);
+
+
+typedef struct
+{
+	const char* name;
+	testRunner_testFn_t fn;
+}testRunner_test_t;
+
+
+// ******** global function prototypes ********
+/**
+ * Provided by each test executable
+ */
+extern const testRunner_test_t testRunner_tests[];
+
+
+/**
+ * Aborts the current test (does not return)
+ */
+void testRunner_fail(const char *const fileIn, int lineIn, const char *const fmtIn, ...) __attribute__((noreturn, format(printf, 3, 4)));
+
+
+/**
+ * Records a benchmark or simulation result
+ */
+void testRunner_report(const char *const benchIn, const char *const keyIn, double valueIn);
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file
+ * Host stand-in for the openCXA array
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_ARRAY_H_
+#define CXA_ARRAY_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#define cxa_array_iterate(arrIn, elemVarNameIn, elemTypeIn) \
+	for( elemTypeIn* elemVarNameIn = (elemTypeIn*)cxa_array_get_noBoundsCheck((arrIn), 0); \
+		 elemVarNameIn < (elemTypeIn*)cxa_array_get_noBoundsCheck((arrIn), cxa_array_getSize_elems(arrIn)); \
+		 elemVarNameIn++ )
+
+
+// ******** global type definitions *********
+typedef struct
+{
+	size_t datatypeSize_bytes;
+	size_t maxNumElements;
+	size_t insertIndex;
+	void* bufferLoc;
+}cxa_array_t;
+
+
+// ******** global function prototypes ********
+void cxa_array_init(cxa_array_t *const arrIn, size_t datatypeSize_bytesIn, void *const bufferLocIn, size_t bufferMaxSize_bytesIn);
+
+bool cxa_array_append(cxa_array_t *const arrIn, void *const itemLocIn);
+void* cxa_array_append_empty(cxa_array_t *const arrIn);
+
+bool cxa_array_remove(cxa_array_t *const arrIn, void *const itemLocIn);
+bool cxa_array_remove_atIndex(cxa_array_t *const arrIn, size_t indexIn);
+
+void* cxa_array_get(cxa_array_t *const arrIn, size_t indexIn);
+void* cxa_array_get_noBoundsCheck(cxa_array_t *const arrIn, size_t indexIn);
+
+size_t cxa_array_getSize_elems(cxa_array_t *const arrIn);
+size_t cxa_array_getMaxSize_elems(cxa_array_t *const arrIn);
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file
+ * Host stand-in for the openCXA assert. A failed assertion prints where
+ * it happened and aborts the test executable.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_ASSERT_H_
+#define CXA_ASSERT_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+
+
+// ******** global macro definitions ********
+// bare blocks like openCXA's (some callers leave off the trailing semicolon)
+#define cxa_assert(condIn)							if( !(condIn) ) { cxa_assert_impl(#condIn, __FILE__, __LINE__); }
+#define cxa_assert_msg(condIn, msgIn)				if( !(condIn) ) { cxa_assert_impl((msgIn), __FILE__, __LINE__); }
+#define cxa_assert_failWithMsg(msgIn)				cxa_assert_impl((msgIn), __FILE__, __LINE__)
+
+
+// ******** global type definitions *********
+
+
+// ******** global function prototypes ********
+void cxa_assert_impl(const char *const msgIn, const char *const fileIn, int lineIn) __attribute__((noreturn));
+
+#endif
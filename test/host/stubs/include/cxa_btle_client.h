@@ -0,0 +1,107 @@
+/**
+ * @file
+ * Host stand-in for the openCXA btle client. Nothing is received unless a
+ * test injects it (see stubHal_btle_injectManData).
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_BTLE_CLIENT_H_
+#define CXA_BTLE_CLIENT_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <cxa_array.h>
+#include <cxa_eui48.h>
+#include <cxa_fixedByteBuffer.h>
+
+
+// ******** global macro definitions ********
+#define CXA_BTLE_ADVPACKET_MAXNUM_FIELDS			4
+
+
+// ******** global type definitions *********
+typedef struct cxa_btle_client cxa_btle_client_t;
+
+
+typedef enum
+{
+	CXA_BTLE_ADVFIELDTYPE_FLAGS = 0x01,
+	CXA_BTLE_ADVFIELDTYPE_MAN_DATA = 0xFF
+}cxa_btle_advFieldType_t;
+
+
+typedef struct
+{
+	uint16_t companyId;
+	cxa_fixedByteBuffer_t manBytes;
+}cxa_btle_advField_manData_t;
+
+
+typedef struct
+{
+	uint8_t length;
+	cxa_btle_advFieldType_t type;
+	cxa_btle_advField_manData_t asManufacturerData;
+}cxa_btle_advField_t;
+
+
+typedef struct
+{
+	cxa_eui48_t addr;
+	int8_t rssi;
+
+	cxa_array_t advFields;
+	cxa_btle_advField_t advFields_raw[CXA_BTLE_ADVPACKET_MAXNUM_FIELDS];
+}cxa_btle_advPacket_t;
+
+
+typedef void (*cxa_btle_client_cb_onReady_t)(cxa_btle_client_t *const btlecIn, void* userVarIn);
+typedef void (*cxa_btle_client_cb_onFailedInit_t)(cxa_btle_client_t *const btlecIn, bool willAutoRetryIn, void* userVarIn);
+typedef void (*cxa_btle_client_cb_onScanStart_t)(bool wasSuccessfulIn, void* userVarIn);
+typedef void (*cxa_btle_client_cb_onAdvertRx_t)(cxa_btle_advPacket_t* packetIn, void* userVarIn);
+
+
+struct cxa_btle_client
+{
+	bool isReady;
+	bool isScanning;
+
+	cxa_btle_client_cb_onReady_t cb_onReady;
+	cxa_btle_client_cb_onFailedInit_t cb_onFailedInit;
+	void* listener_userVar;
+
+	cxa_btle_client_cb_onAdvertRx_t cb_onAdvertRx;
+	void* scan_userVar;
+};
+
+
+// ******** global function prototypes ********
+void cxa_btle_client_addListener(cxa_btle_client_t *const btlecIn,
+								 cxa_btle_client_cb_onReady_t cb_onReadyIn,
+								 cxa_btle_client_cb_onFailedInit_t cb_onFailedInitIn,
+								 void *const userVarIn);
+
+bool cxa_btle_client_isReady(cxa_btle_client_t *const btlecIn);
+bool cxa_btle_client_isScanning(cxa_btle_client_t *const btlecIn);
+
+void cxa_btle_client_startScan_passive(cxa_btle_client_t *const btlecIn,
+									   cxa_btle_client_cb_onScanStart_t cb_scanStartIn,
+									   cxa_btle_client_cb_onAdvertRx_t cb_advRxIn,
+									   void *const userVarIn);
+
+#endif
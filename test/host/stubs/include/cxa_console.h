@@ -0,0 +1,57 @@
+/**
+ * @file
+ * Host stand-in for the openCXA console. Commands are only recorded so
+ * tests can check what's registered and invoke them (see stubHal_console_*).
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_CONSOLE_H_
+#define CXA_CONSOLE_H_
+
+
+// ******** includes ********
+#include <stddef.h>
+
+#include <cxa_array.h>
+#include <cxa_config.h>
+#include <cxa_ioStream.h>
+
+
+// ******** global macro definitions ********
+#ifndef CXA_CONSOLE_MAXNUM_COMMANDS
+	#define CXA_CONSOLE_MAXNUM_COMMANDS		16
+#endif
+
+
+// ******** global type definitions *********
+typedef struct
+{
+	const char* name;
+	const char* description;
+}cxa_console_argDescriptor_t;
+
+
+typedef void (*cxa_console_command_cb_t)(cxa_array_t *const argsIn, cxa_ioStream_t *const ioStreamIn, void* userVarIn);
+
+
+// ******** global function prototypes ********
+/**
+ * Asserts if more than CXA_CONSOLE_MAXNUM_COMMANDS are added (as on target)
+ */
+void cxa_console_addCommand(const char* commandIn, const char* descriptionIn,
+							cxa_console_argDescriptor_t* argDescsIn, size_t numArgsIn,
+							cxa_console_command_cb_t cbIn, void* userVarIn);
+
+#endif
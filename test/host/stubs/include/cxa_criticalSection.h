@@ -0,0 +1,37 @@
+/**
+ * @file
+ * Host stand-in for the openCXA critical section. Tests are single threaded
+ * so this only tracks nesting (see stubHal_getCriticalSectionDepth).
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_CRITICALSECTION_H_
+#define CXA_CRITICALSECTION_H_
+
+
+// ******** includes ********
+
+
+// ******** global macro definitions ********
+
+
+// ******** global type definitions *********
+
+
+// ******** global function prototypes ********
+void cxa_criticalSection_enter(void);
+void cxa_criticalSection_exit(void);
+
+#endif
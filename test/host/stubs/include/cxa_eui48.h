@@ -0,0 +1,51 @@
+/**
+ * @file
+ * Host stand-in for the openCXA eui48
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_EUI48_H_
+#define CXA_EUI48_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <cxa_fixedByteBuffer.h>
+
+
+// ******** global macro definitions ********
+
+
+// ******** global type definitions *********
+typedef struct
+{
+	uint8_t bytes[6];
+}cxa_eui48_t;
+
+
+typedef struct
+{
+	char str[18];
+}cxa_eui48_string_t;
+
+
+// ******** global function prototypes ********
+bool cxa_eui48_initFromBuffer(cxa_eui48_t *const uuidIn, cxa_fixedByteBuffer_t *const fbbIn, size_t indexIn);
+bool cxa_eui48_isEqual(cxa_eui48_t *const uuid1In, cxa_eui48_t *const uuid2In);
+void cxa_eui48_toString(cxa_eui48_t *const uuidIn, cxa_eui48_string_t *const strOut);
+
+#endif
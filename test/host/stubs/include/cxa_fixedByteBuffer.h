@@ -0,0 +1,55 @@
+/**
+ * @file
+ * Host stand-in for the openCXA fixedByteBuffer (the subset the gateway uses)
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_FIXEDBYTEBUFFER_H_
+#define CXA_FIXEDBYTEBUFFER_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#define cxa_fixedByteBuffer_get_uint8(fbbIn, indexIn, uint8Out)			cxa_fixedByteBuffer_get((fbbIn), (indexIn), (uint8_t*)&(uint8Out), 1)
+#define cxa_fixedByteBuffer_get_uint16LE(fbbIn, indexIn, uint16Out)		cxa_fixedByteBuffer_get((fbbIn), (indexIn), (uint8_t*)&(uint16Out), 2)
+#define cxa_fixedByteBuffer_get_uint32LE(fbbIn, indexIn, uint32Out)		cxa_fixedByteBuffer_get((fbbIn), (indexIn), (uint8_t*)&(uint32Out), 4)
+
+
+// ******** global type definitions *********
+typedef struct
+{
+	uint8_t* buffer;
+	size_t currSize_bytes;
+	size_t maxSize_bytes;
+}cxa_fixedByteBuffer_t;
+
+
+// ******** global function prototypes ********
+void cxa_fixedByteBuffer_init_inPlace(cxa_fixedByteBuffer_t *const fbbIn, size_t currSize_bytesIn, void *const bufferIn, size_t maxSize_bytesIn);
+
+/**
+ * Multi-byte values are little endian (as is the host)
+ */
+bool cxa_fixedByteBuffer_get(cxa_fixedByteBuffer_t *const fbbIn, size_t indexIn, uint8_t *const valOut, size_t numBytesIn);
+
+uint8_t* cxa_fixedByteBuffer_get_pointerToIndex(cxa_fixedByteBuffer_t *const fbbIn, size_t indexIn);
+size_t cxa_fixedByteBuffer_getSize_bytes(cxa_fixedByteBuffer_t *const fbbIn);
+
+#endif
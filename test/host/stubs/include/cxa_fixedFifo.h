@@ -0,0 +1,66 @@
+/**
+ * @file
+ * Host stand-in for the openCXA fixedFifo
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_FIXEDFIFO_H_
+#define CXA_FIXEDFIFO_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+
+
+// ******** global type definitions *********
+typedef enum
+{
+	CXA_FF_ON_FULL_DROP,
+	CXA_FF_ON_FULL_DEQUEUE
+}cxa_fixedFifo_onFullAction_t;
+
+
+typedef struct
+{
+	cxa_fixedFifo_onFullAction_t onFullAction;
+	size_t datatypeSize_bytes;
+	size_t maxNumElements;
+	size_t insertIndex;
+	size_t removeIndex;
+	size_t numElements;
+	uint8_t* bufferLoc;
+}cxa_fixedFifo_t;
+
+
+// ******** global function prototypes ********
+void cxa_fixedFifo_init(cxa_fixedFifo_t *const fifoIn, cxa_fixedFifo_onFullAction_t onFullActionIn, size_t datatypeSize_bytesIn, void *const bufferLocIn, size_t bufferMaxSize_bytesIn);
+
+bool cxa_fixedFifo_queue(cxa_fixedFifo_t *const fifoIn, void *const elemIn);
+bool cxa_fixedFifo_dequeue(cxa_fixedFifo_t *const fifoIn, void *const elemOut);
+
+/**
+ * @return the number of contiguous elements available at elemsOut
+ */
+size_t cxa_fixedFifo_bulkDequeue_peek(cxa_fixedFifo_t *const fifoIn, void** elemsOut);
+bool cxa_fixedFifo_bulkDequeue(cxa_fixedFifo_t *const fifoIn, size_t numElemsIn);
+
+size_t cxa_fixedFifo_getSize_elems(cxa_fixedFifo_t *const fifoIn);
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file
+ * Host stand-in for the openCXA ioStream
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_IOSTREAM_H_
+#define CXA_IOSTREAM_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+
+
+// ******** global type definitions *********
+typedef enum
+{
+	CXA_IOSTREAM_READSTAT_NODATA,
+	CXA_IOSTREAM_READSTAT_GOTDATA,
+	CXA_IOSTREAM_READSTAT_ERROR
+}cxa_ioStream_readStatus_t;
+
+
+typedef cxa_ioStream_readStatus_t (*cxa_ioStream_cb_readByte_t)(uint8_t *const byteOut, void *const userVarIn);
+typedef bool (*cxa_ioStream_cb_writeBytes_t)(void* buffIn, size_t bufferSize_bytesIn, void *const userVarIn);
+
+
+typedef struct
+{
+	cxa_ioStream_cb_readByte_t cb_readByte;
+	cxa_ioStream_cb_writeBytes_t cb_writeBytes;
+	void* userVar;
+}cxa_ioStream_t;
+
+
+// ******** global function prototypes ********
+void cxa_ioStream_init(cxa_ioStream_t *const ioStreamIn);
+void cxa_ioStream_bind(cxa_ioStream_t *const ioStreamIn, cxa_ioStream_cb_readByte_t readCbIn, cxa_ioStream_cb_writeBytes_t writeCbIn, void *const userVarIn);
+
+bool cxa_ioStream_writeBytes(cxa_ioStream_t *const ioStreamIn, void* buffIn, size_t bufferSize_bytesIn);
+bool cxa_ioStream_writeString(cxa_ioStream_t *const ioStreamIn, const char *const stringIn);
+bool cxa_ioStream_writeLine(cxa_ioStream_t *const ioStreamIn, const char *const stringIn);
+
+#endif
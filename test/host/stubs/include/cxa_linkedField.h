@@ -0,0 +1,57 @@
+/**
+ * @file
+ * Host stand-in for the openCXA linkedField. Here it's a flat view of a
+ * caller-supplied buffer, which is all the rpc methods need.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_LINKEDFIELD_H_
+#define CXA_LINKEDFIELD_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#define cxa_linkedField_get_uint8(lfIn, indexIn, uint8Out)			cxa_linkedField_get((lfIn), (indexIn), (uint8_t*)&(uint8Out), 1)
+#define cxa_linkedField_get_uint16LE(lfIn, indexIn, uint16Out)		cxa_linkedField_get((lfIn), (indexIn), (uint8_t*)&(uint16Out), 2)
+#define cxa_linkedField_get_uint32LE(lfIn, indexIn, uint32Out)		cxa_linkedField_get((lfIn), (indexIn), (uint8_t*)&(uint32Out), 4)
+
+
+// ******** global type definitions *********
+typedef struct
+{
+	uint8_t* buffer;
+	size_t currSize_bytes;
+	size_t maxSize_bytes;
+}cxa_linkedField_t;
+
+
+// ******** global function prototypes ********
+void cxa_linkedField_init_inPlace(cxa_linkedField_t *const lfIn, size_t currSize_bytesIn, void *const bufferIn, size_t maxSize_bytesIn);
+
+bool cxa_linkedField_get(cxa_linkedField_t *const lfIn, size_t indexIn, uint8_t *const valOut, size_t numBytesIn);
+uint8_t* cxa_linkedField_get_pointerToIndex(cxa_linkedField_t *const lfIn, size_t indexIn);
+size_t cxa_linkedField_getSize_bytes(cxa_linkedField_t *const lfIn);
+
+bool cxa_linkedField_append(cxa_linkedField_t *const lfIn, const uint8_t *const valIn, size_t numBytesIn);
+bool cxa_linkedField_append_uint8(cxa_linkedField_t *const lfIn, uint8_t valIn);
+bool cxa_linkedField_append_uint16LE(cxa_linkedField_t *const lfIn, uint16_t valIn);
+bool cxa_linkedField_append_uint32LE(cxa_linkedField_t *const lfIn, uint32_t valIn);
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file
+ * Host stand-in for the openCXA logger. Lines are written to the global
+ * ioStream as "<ms> [<name>] <LEVEL> <message>".
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_LOGGER_HEADER_H_
+#define CXA_LOGGER_HEADER_H_
+
+
+// ******** includes ********
+#include <stdint.h>
+
+#include <cxa_ioStream.h>
+
+
+// ******** global macro definitions ********
+#define CXA_LOG_LEVEL_NONE					0
+#define CXA_LOG_LEVEL_ERROR					1
+#define CXA_LOG_LEVEL_WARN					2
+#define CXA_LOG_LEVEL_INFO					3
+#define CXA_LOG_LEVEL_DEBUG					4
+#define CXA_LOG_LEVEL_TRACE					5
+
+#define CXA_LOGGER_MAXLEN_NAME				24
+
+
+// ******** global type definitions *********
+typedef struct
+{
+	char name[CXA_LOGGER_MAXLEN_NAME+1];
+}cxa_logger_t;
+
+
+// ******** global function prototypes ********
+void cxa_logger_init(cxa_logger_t *const loggerIn, const char *const nameIn);
+
+void cxa_logger_setGlobalIoStream(cxa_ioStream_t *const ioStreamIn);
+cxa_ioStream_t* cxa_logger_getGlobalIoStream(void);
+
+void cxa_logger_log_formattedString(cxa_logger_t *const loggerIn, uint8_t levelIn, const char *const formatIn, ...) __attribute__((format(printf, 3, 4)));
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * @file
+ * Host stand-in for the openCXA logger implementation. Define CXA_LOG_LEVEL
+ * before including to compile out less important messages.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_LOGGER_IMPLEMENTATION_H_
+#define CXA_LOGGER_IMPLEMENTATION_H_
+
+
+// ******** includes ********
+#include <cxa_logger_header.h>
+
+
+// ******** global macro definitions ********
+#ifndef CXA_LOG_LEVEL
+	#define CXA_LOG_LEVEL		CXA_LOG_LEVEL_INFO
+#endif
+
+#if CXA_LOG_LEVEL >= CXA_LOG_LEVEL_ERROR
+	#define cxa_logger_error(loggerIn, ...)		cxa_logger_log_formattedString((loggerIn), CXA_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+	#define cxa_logger_error(loggerIn, ...)
+#endif
+
+#if CXA_LOG_LEVEL >= CXA_LOG_LEVEL_WARN
+	#define cxa_logger_warn(loggerIn, ...)		cxa_logger_log_formattedString((loggerIn), CXA_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+	#define cxa_logger_warn(loggerIn, ...)
+#endif
+
+#if CXA_LOG_LEVEL >= CXA_LOG_LEVEL_INFO
+	#define cxa_logger_info(loggerIn, ...)		cxa_logger_log_formattedString((loggerIn), CXA_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+	#define cxa_logger_info(loggerIn, ...)
+#endif
+
+#if CXA_LOG_LEVEL >= CXA_LOG_LEVEL_DEBUG
+	#define cxa_logger_debug(loggerIn, ...)		cxa_logger_log_formattedString((loggerIn), CXA_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+	#define cxa_logger_debug(loggerIn, ...)
+#endif
+
+#if CXA_LOG_LEVEL >= CXA_LOG_LEVEL_TRACE
+	#define cxa_logger_trace(loggerIn, ...)		cxa_logger_log_formattedString((loggerIn), CXA_LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+	#define cxa_logger_trace(loggerIn, ...)
+#endif
+
+#endif
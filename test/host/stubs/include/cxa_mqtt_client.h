@@ -0,0 +1,94 @@
+/**
+ * @file
+ * Host stand-in for the openCXA mqtt client. Connection state is set by the
+ * test (stubHal_mqtt_setConnected) and listeners are called as on target.
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_MQTT_CLIENT_H_
+#define CXA_MQTT_CLIENT_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cxa_config.h>
+
+
+// ******** global macro definitions ********
+#ifndef CXA_MQTT_CLIENT_MAXNUM_LISTENERS
+	#define CXA_MQTT_CLIENT_MAXNUM_LISTENERS		4
+#endif
+
+
+// ******** global type definitions *********
+typedef struct cxa_mqtt_client cxa_mqtt_client_t;
+
+
+typedef enum
+{
+	CXA_MQTT_QOS_ATMOST_ONCE = 0,
+	CXA_MQTT_QOS_ATLEAST_ONCE = 1,
+	CXA_MQTT_QOS_EXACTLY_ONCE = 2
+}cxa_mqtt_qosLevel_t;
+
+
+typedef enum
+{
+	CXA_MQTT_CLIENT_CONNECTFAILREASON_NETWORK,
+	CXA_MQTT_CLIENT_CONNECTFAILREASON_AUTH,
+	CXA_MQTT_CLIENT_CONNECTFAILREASON_TIMEOUT
+}cxa_mqtt_client_connectFailureReason_t;
+
+
+typedef void (*cxa_mqtt_client_cb_onConnect_t)(cxa_mqtt_client_t *const clientIn, void* userVarIn);
+typedef void (*cxa_mqtt_client_cb_onConnectFailed_t)(cxa_mqtt_client_t *const clientIn, cxa_mqtt_client_connectFailureReason_t reasonIn, void* userVarIn);
+typedef void (*cxa_mqtt_client_cb_onDisconnect_t)(cxa_mqtt_client_t *const clientIn, void* userVarIn);
+typedef void (*cxa_mqtt_client_cb_onPingRespRx_t)(cxa_mqtt_client_t *const clientIn, void* userVarIn);
+
+
+typedef struct
+{
+	cxa_mqtt_client_cb_onConnect_t cb_onConnect;
+	cxa_mqtt_client_cb_onConnectFailed_t cb_onConnectFailed;
+	cxa_mqtt_client_cb_onDisconnect_t cb_onDisconnect;
+	cxa_mqtt_client_cb_onPingRespRx_t cb_onPingRespRx;
+	void* userVar;
+}cxa_mqtt_client_listenerEntry_t;
+
+
+struct cxa_mqtt_client
+{
+	bool isConnected;
+
+	cxa_mqtt_client_listenerEntry_t listeners[CXA_MQTT_CLIENT_MAXNUM_LISTENERS];
+	size_t numListeners;
+};
+
+
+// ******** global function prototypes ********
+void cxa_mqtt_client_addListener(cxa_mqtt_client_t *const clientIn,
+								 cxa_mqtt_client_cb_onConnect_t cb_onConnectIn,
+								 cxa_mqtt_client_cb_onConnectFailed_t cb_onConnectFailIn,
+								 cxa_mqtt_client_cb_onDisconnect_t cb_onDisconnectIn,
+								 cxa_mqtt_client_cb_onPingRespRx_t cb_onPingRespRxIn,
+								 void *const userVarIn);
+
+bool cxa_mqtt_client_isConnected(cxa_mqtt_client_t *const clientIn);
+void cxa_mqtt_client_disconnect(cxa_mqtt_client_t *const clientIn);
+
+#endif
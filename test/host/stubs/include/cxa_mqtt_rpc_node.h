@@ -0,0 +1,90 @@
+/**
+ * @file
+ * Host stand-in for the openCXA mqtt rpc node. Notifications are encoded
+ * the way the message factory would size them and anything that doesn't fit
+ * a CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES message fails to publish.
+ * Everything that does publish is captured for the test to inspect
+ * (see stubHal_getPublication).
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_MQTT_RPC_NODE_H_
+#define CXA_MQTT_RPC_NODE_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cxa_config.h>
+#include <cxa_linkedField.h>
+#include <cxa_mqtt_client.h>
+
+
+// ******** global macro definitions ********
+#ifndef CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES
+	#define CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES	256
+#endif
+
+#define CXA_MQTT_RPC_NODE_MAXLEN_NAME					24
+#define CXA_MQTT_RPC_NODE_MAXNUM_METHODS				16
+
+
+// ******** global type definitions *********
+typedef struct cxa_mqtt_rpc_node cxa_mqtt_rpc_node_t;
+
+
+typedef enum
+{
+	CXA_MQTT_RPC_METHODRETVAL_SUCCESS,
+	CXA_MQTT_RPC_METHODRETVAL_FAIL,
+	CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS
+}cxa_mqtt_rpc_methodRetVal_t;
+
+
+typedef cxa_mqtt_rpc_methodRetVal_t (*cxa_mqtt_rpc_cb_method_t)(cxa_mqtt_rpc_node_t *const nodeIn, cxa_linkedField_t *const paramsIn, cxa_linkedField_t *const responseParamsIn, void* userVarIn);
+
+
+typedef struct
+{
+	char name[CXA_MQTT_RPC_NODE_MAXLEN_NAME+1];
+	cxa_mqtt_rpc_cb_method_t cb;
+	void* userVar;
+}cxa_mqtt_rpc_node_methodEntry_t;
+
+
+struct cxa_mqtt_rpc_node
+{
+	cxa_mqtt_rpc_node_t* parentNode;
+	char name[CXA_MQTT_RPC_NODE_MAXLEN_NAME+1];
+
+	cxa_mqtt_rpc_node_methodEntry_t methods[CXA_MQTT_RPC_NODE_MAXNUM_METHODS];
+	size_t numMethods;
+};
+
+
+// ******** global function prototypes ********
+void cxa_mqtt_rpc_node_init_formattedString(cxa_mqtt_rpc_node_t *const nodeIn, cxa_mqtt_rpc_node_t *const parentNodeIn, const char *nameFmtIn, ...) __attribute__((format(printf, 3, 4)));
+
+void cxa_mqtt_rpc_node_addMethod(cxa_mqtt_rpc_node_t *const nodeIn, char *const nameIn, cxa_mqtt_rpc_cb_method_t cbIn, void *const userVarIn);
+
+/**
+ * Publishes to "<node path>/<notiName>"
+ * @return false if disconnected or the message doesn't fit
+ */
+bool cxa_mqtt_rpc_node_publishNotification(cxa_mqtt_rpc_node_t *const nodeIn, char *const notiNameIn, cxa_mqtt_qosLevel_t qosIn, void *const payloadIn, size_t payloadLen_bytesIn);
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * @file
+ * Host stand-in for the openCXA runLoop. Nothing runs on its own, tests
+ * step each thread with cxa_runLoop_iterate (or stubHal_run_ms).
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_RUNLOOP_H_
+#define CXA_RUNLOOP_H_
+
+
+// ******** includes ********
+#include <cxa_config.h>
+
+
+// ******** global macro definitions ********
+#ifndef CXA_RUNLOOP_MAXNUM_ENTRIES
+	#define CXA_RUNLOOP_MAXNUM_ENTRIES		40
+#endif
+
+
+// ******** global type definitions *********
+typedef void (*cxa_runLoop_cb_update_t)(void* userVarIn);
+
+
+// ******** global function prototypes ********
+void cxa_runLoop_addEntry(int threadIdIn, cxa_runLoop_cb_update_t cbIn, void *const userVarIn);
+void cxa_runLoop_iterate(int threadIdIn);
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file
+ * Host stand-in for the openCXA stringUtils
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef CXA_STRINGUTILS_H_
+#define CXA_STRINGUTILS_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+
+
+// ******** global macro definitions ********
+
+
+// ******** global type definitions *********
+
+
+// ******** global function prototypes ********
+/**
+ * @return false (leaving targetStrIn untouched) if sourceStrIn doesn't fit
+ */
+bool cxa_stringUtils_concat(char *targetStrIn, const char *sourceStrIn, size_t targetSize_bytesIn);
+bool cxa_stringUtils_concat_formattedString(char *targetStrIn, size_t targetSize_bytesIn, const char *formatIn, ...) __attribute__((format(printf, 3, 4)));
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * @file
+ * Host stand-in for the esp-idf capability-based heap. Internal RAM and
+ * PSRAM are modelled as separate budgets (STUBHAL_HEAP_*_SIZE_BYTES).
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef ESP_HEAP_CAPS_H_
+#define ESP_HEAP_CAPS_H_
+
+
+// ******** includes ********
+#include <stddef.h>
+#include <stdint.h>
+
+
+// ******** global macro definitions ********
+#define MALLOC_CAP_8BIT						(1 << 2)
+#define MALLOC_CAP_SPIRAM					(1 << 10)
+#define MALLOC_CAP_INTERNAL					(1 << 11)
+
+
+// ******** global type definitions *********
+
+
+// ******** global function prototypes ********
+void* heap_caps_malloc(size_t sizeIn, uint32_t capsIn);
+void heap_caps_free(void* ptrIn);
+size_t heap_caps_get_free_size(uint32_t capsIn);
+size_t heap_caps_get_largest_free_block(uint32_t capsIn);
+
+#endif
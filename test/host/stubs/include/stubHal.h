@@ -0,0 +1,210 @@
+/**
+ * @file
+ * Test-side controls for the host stand-ins of the openCXA and esp-idf
+ * services: a virtual clock, manual runLoop stepping, sntp, mqtt connection
+ * state and publish capture, rpc method invocation, the console and the
+ * simulated btle radio.
+ *
+ * Call stubHal_reset before each test (the test runner does this).
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef STUBHAL_H_
+#define STUBHAL_H_
+
+
+// ******** includes ********
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cxa_btle_client.h>
+#include <cxa_mqtt_rpc_node.h>
+
+
+// ******** global macro definitions ********
+#define STUBHAL_UNIQUEID						"240ac4123456"
+
+// where the virtual clock starts after a reset
+#define STUBHAL_START_TIME_US					1000000
+
+#define STUBHAL_MAXNUM_THREADS					4
+#define STUBHAL_MAXSIZE_TOPIC					96
+
+#define STUBHAL_HEAP_INTERNAL_SIZE_BYTES		(160 * 1024)
+#define STUBHAL_HEAP_PSRAM_SIZE_BYTES			(4 * 1024 * 1024)
+
+// PSRAM stand-in: the esp32's direct-mapped cache in front of quad-spi PSRAM
+#define STUBHAL_HEAP_PSRAM_CACHE_SIZE_BYTES		(32 * 1024)
+#define STUBHAL_HEAP_PSRAM_CACHELINE_SIZE_BYTES	32
+#define STUBHAL_HEAP_PSRAM_MISSPENALTY_NS		600
+#define STUBHAL_HEAP_MAXNUM_PSRAM_ALLOCS		32
+
+
+// ******** global type definitions *********
+/**
+ * One successfully published notification
+ */
+typedef struct
+{
+	char topic[STUBHAL_MAXSIZE_TOPIC];
+	uint8_t payload[CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES];
+	size_t payloadSize_bytes;
+
+	// as the message factory would encode it (header + topic + payload)
+	size_t messageSize_bytes;
+	uint8_t qos;
+
+	uint32_t time_us;
+}stubHal_publication_t;
+
+
+// ******** global function prototypes ********
+/**
+ * Clears all stub state, restarts the virtual clock at STUBHAL_START_TIME_US,
+ * unsets the sntp clock and leaves mqtt connected
+ */
+void stubHal_reset(void);
+
+
+/**
+ * As stubHal_reset but nvs survives (eg. to pick up saved capacities)
+ */
+void stubHal_reboot(void);
+
+
+/**
+ * Virtual clock
+ */
+void stubHal_advanceTime_us(uint32_t usIn);
+void stubHal_advanceTime_ms(uint32_t msIn);
+
+
+/**
+ * Steps every thread's runLoop once (threads 0..STUBHAL_MAXNUM_THREADS-1)
+ */
+void stubHal_iterateAll(void);
+
+
+/**
+ * Alternately advances the clock by step_msIn and iterates every thread
+ * until duration_msIn has passed
+ */
+void stubHal_run_ms(uint32_t duration_msIn, uint32_t step_msIn);
+
+
+/**
+ * Sets the sntp clock (it then follows the virtual clock)
+ */
+void stubHal_setUnixTime(uint32_t unixTimeIn);
+
+
+/**
+ * @return the number of unbalanced cxa_criticalSection_enter calls
+ */
+int stubHal_getCriticalSectionDepth(void);
+
+
+/**
+ * mqtt
+ */
+cxa_mqtt_rpc_node_t* stubHal_getRootNode(void);
+void stubHal_mqtt_setConnected(bool isConnectedIn);
+
+// the next numPublishesIn publishes fail (as if the client's queue were full)
+void stubHal_mqtt_failNextPublishes(size_t numPublishesIn);
+
+size_t stubHal_getNumPublications(void);
+stubHal_publication_t* stubHal_getPublication(size_t indexIn);
+void stubHal_clearPublications(void);
+
+// @return the first publication at or after *indexInOut whose topic ends in "/<nameIn>" (NULL if none)
+stubHal_publication_t* stubHal_findPublication(const char *const nameIn, size_t *const indexInOut);
+size_t stubHal_countPublications(const char *const nameIn);
+
+// publishes refused because the encoded message was too large
+size_t stubHal_getNumOversizedPublishes(void);
+
+/**
+ * Keepalive stand-in: while connected, the client sends a PINGREQ every
+ * period_msIn (once the previous one has been answered) and the broker's
+ * PINGRESP arrives respDelay_msIn plus up to respJitter_msIn later, except
+ * for respLossPcntIn percent that never arrive. PINGRESPs are delivered to
+ * the client's listeners from stubHal_iterateAll and an outstanding PINGREQ
+ * is forgotten on disconnect. Reset to no keepalive (period of 0).
+ */
+void stubHal_mqtt_setKeepAlive(uint32_t period_msIn, uint32_t respDelay_msIn, uint32_t respJitter_msIn, uint8_t respLossPcntIn);
+size_t stubHal_mqtt_getNumPingResps(void);
+
+/**
+ * Invokes an rpc method as if a request had arrived
+ * @param nodePathIn path below the root node ("" for the root, "publisher" etc)
+ */
+cxa_mqtt_rpc_methodRetVal_t stubHal_callMethod(const char *const nodePathIn, const char *const methodNameIn,
+											   const void *const paramsIn, size_t paramsSize_bytesIn,
+											   uint8_t *const responseOut, size_t responseMaxSize_bytesIn, size_t *const responseSize_bytesOut);
+
+
+/**
+ * console
+ */
+size_t stubHal_console_getNumCommands(void);
+bool stubHal_console_hasCommand(const char *const commandIn);
+
+
+/**
+ * btle
+ */
+void stubHal_btle_init(cxa_btle_client_t *const btlecIn);
+void stubHal_btle_setReady(cxa_btle_client_t *const btlecIn);
+
+/**
+ * Delivers an advert with a single manufacturer data field (if scanning)
+ * @return true if it was delivered
+ */
+bool stubHal_btle_injectManData(cxa_btle_client_t *const btlecIn, int8_t rssi_dBmIn, uint16_t companyIdIn, uint8_t *const dataIn, size_t dataSize_bytesIn);
+
+
+/**
+ * heap
+ */
+typedef void (*stubHal_heap_cb_onAlloc_t)(void* userVarIn);
+
+size_t stubHal_heap_getNumAllocated_bytes(uint32_t capsIn);
+
+/**
+ * Called at the start of every allocation (e.g. to run another thread's
+ * work part way through an update). Cleared by stubHal_reset.
+ */
+void stubHal_heap_setOnAlloc(stubHal_heap_cb_onAlloc_t cbIn, void* userVarIn);
+
+/**
+ * Size of a region until the next reset/reboot (eg. 0 for a board without PSRAM)
+ */
+void stubHal_heap_setRegionSize_bytes(uint32_t capsIn, size_t size_bytesIn);
+
+/**
+ * PSRAM latency stand-in. Host loads and stores can't be intercepted, so
+ * code under test reports the bytes it reads or writes. Touches of PSRAM
+ * allocations go through a model of the cache and each line fill costs
+ * STUBHAL_HEAP_PSRAM_MISSPENALTY_NS. Touches of internal RAM are free.
+ * Cleared (cold cache, no misses) by stubHal_reset.
+ */
+void stubHal_heap_touch(const void *const ptrIn, size_t size_bytesIn);
+size_t stubHal_heap_getNumPsramMisses(void);
+uint64_t stubHal_heap_getPsramStall_ns(void);
+void stubHal_heap_clearPsramCache(void);
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <cxa_btle_client.h>
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_assert.h>
+
+#include "stubHal.h"
+
+
+// ******** local macro definitions ********
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void stubHal_btle_init(cxa_btle_client_t *const btlecIn)
+{
+	cxa_assert(btlecIn);
+
+	memset(btlecIn, 0, sizeof(*btlecIn));
+}
+
+
+void stubHal_btle_setReady(cxa_btle_client_t *const btlecIn)
+{
+	cxa_assert(btlecIn);
+
+	btlecIn->isReady = true;
+	if( btlecIn->cb_onReady != NULL ) btlecIn->cb_onReady(btlecIn, btlecIn->listener_userVar);
+}
+
+
+bool stubHal_btle_injectManData(cxa_btle_client_t *const btlecIn, int8_t rssi_dBmIn, uint16_t companyIdIn, uint8_t *const dataIn, size_t dataSize_bytesIn)
+{
+	cxa_assert(btlecIn);
+	cxa_assert(dataIn);
+
+	if( !btlecIn->isScanning || (btlecIn->cb_onAdvertRx == NULL) ) return false;
+
+	cxa_btle_advPacket_t packet;
+	memset(&packet, 0, sizeof(packet));
+	packet.rssi = rssi_dBmIn;
+	cxa_array_init(&packet.advFields, sizeof(*packet.advFields_raw), packet.advFields_raw, sizeof(packet.advFields_raw));
+
+	cxa_btle_advField_t* manField = cxa_array_append_empty(&packet.advFields);
+	cxa_assert(manField);
+	manField->length = dataSize_bytesIn + 3;
+	manField->type = CXA_BTLE_ADVFIELDTYPE_MAN_DATA;
+	manField->asManufacturerData.companyId = companyIdIn;
+	cxa_fixedByteBuffer_init_inPlace(&manField->asManufacturerData.manBytes, dataSize_bytesIn, dataIn, dataSize_bytesIn);
+
+	btlecIn->cb_onAdvertRx(&packet, btlecIn->scan_userVar);
+	return true;
+}
+
+
+void cxa_btle_client_addListener(cxa_btle_client_t *const btlecIn,
+								 cxa_btle_client_cb_onReady_t cb_onReadyIn,
+								 cxa_btle_client_cb_onFailedInit_t cb_onFailedInitIn,
+								 void *const userVarIn)
+{
+	cxa_assert(btlecIn);
+
+	// one listener is all the gateway needs
+	btlecIn->cb_onReady = cb_onReadyIn;
+	btlecIn->cb_onFailedInit = cb_onFailedInitIn;
+	btlecIn->listener_userVar = userVarIn;
+}
+
+
+bool cxa_btle_client_isReady(cxa_btle_client_t *const btlecIn)
+{
+	cxa_assert(btlecIn);
+
+	return btlecIn->isReady;
+}
+
+
+bool cxa_btle_client_isScanning(cxa_btle_client_t *const btlecIn)
+{
+	cxa_assert(btlecIn);
+
+	return btlecIn->isScanning;
+}
+
+
+void cxa_btle_client_startScan_passive(cxa_btle_client_t *const btlecIn,
+									   cxa_btle_client_cb_onScanStart_t cb_scanStartIn,
+									   cxa_btle_client_cb_onAdvertRx_t cb_advRxIn,
+									   void *const userVarIn)
+{
+	cxa_assert(btlecIn);
+
+	btlecIn->isScanning = btlecIn->isReady;
+	if( btlecIn->isScanning )
+	{
+		btlecIn->cb_onAdvertRx = cb_advRxIn;
+		btlecIn->scan_userVar = userVarIn;
+	}
+	if( cb_scanStartIn != NULL ) cb_scanStartIn(btlecIn->isScanning, userVarIn);
+}
+
+
+// ******** local function implementations ********
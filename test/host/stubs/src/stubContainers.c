@@ -0,0 +1,396 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <cxa_array.h>
+#include <cxa_eui48.h>
+#include <cxa_fixedByteBuffer.h>
+#include <cxa_fixedFifo.h>
+#include <cxa_linkedField.h>
+#include <cxa_stringUtils.h>
+
+
+// ******** includes ********
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+
+
+// ******** local macro definitions ********
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+	#error "the fixedByteBuffer/linkedField stand-ins assume a little endian host"
+#endif
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+void cxa_array_init(cxa_array_t *const arrIn, size_t datatypeSize_bytesIn, void *const bufferLocIn, size_t bufferMaxSize_bytesIn)
+{
+	cxa_assert(arrIn);
+	cxa_assert(datatypeSize_bytesIn > 0);
+	cxa_assert(bufferLocIn || (bufferMaxSize_bytesIn == 0));
+
+	arrIn->datatypeSize_bytes = datatypeSize_bytesIn;
+	arrIn->maxNumElements = bufferMaxSize_bytesIn / datatypeSize_bytesIn;
+	arrIn->insertIndex = 0;
+	arrIn->bufferLoc = bufferLocIn;
+}
+
+
+bool cxa_array_append(cxa_array_t *const arrIn, void *const itemLocIn)
+{
+	cxa_assert(arrIn);
+	cxa_assert(itemLocIn);
+
+	void* newItem = cxa_array_append_empty(arrIn);
+	if( newItem == NULL ) return false;
+
+	memcpy(newItem, itemLocIn, arrIn->datatypeSize_bytes);
+	return true;
+}
+
+
+void* cxa_array_append_empty(cxa_array_t *const arrIn)
+{
+	cxa_assert(arrIn);
+
+	if( arrIn->insertIndex >= arrIn->maxNumElements ) return NULL;
+	return cxa_array_get_noBoundsCheck(arrIn, arrIn->insertIndex++);
+}
+
+
+bool cxa_array_remove(cxa_array_t *const arrIn, void *const itemLocIn)
+{
+	cxa_assert(arrIn);
+
+	for( size_t i = 0; i < arrIn->insertIndex; i++ )
+	{
+		if( cxa_array_get_noBoundsCheck(arrIn, i) == itemLocIn ) return cxa_array_remove_atIndex(arrIn, i);
+	}
+	return false;
+}
+
+
+bool cxa_array_remove_atIndex(cxa_array_t *const arrIn, size_t indexIn)
+{
+	cxa_assert(arrIn);
+
+	if( indexIn >= arrIn->insertIndex ) return false;
+
+	// shift everything after it down (order is preserved)
+	uint8_t* item = cxa_array_get_noBoundsCheck(arrIn, indexIn);
+	memmove(item, item + arrIn->datatypeSize_bytes, (arrIn->insertIndex - indexIn - 1) * arrIn->datatypeSize_bytes);
+	arrIn->insertIndex--;
+	return true;
+}
+
+
+void* cxa_array_get(cxa_array_t *const arrIn, size_t indexIn)
+{
+	cxa_assert(arrIn);
+
+	return (indexIn < arrIn->insertIndex) ? cxa_array_get_noBoundsCheck(arrIn, indexIn) : NULL;
+}
+
+
+void* cxa_array_get_noBoundsCheck(cxa_array_t *const arrIn, size_t indexIn)
+{
+	cxa_assert(arrIn);
+
+	return (uint8_t*)arrIn->bufferLoc + (indexIn * arrIn->datatypeSize_bytes);
+}
+
+
+size_t cxa_array_getSize_elems(cxa_array_t *const arrIn)
+{
+	cxa_assert(arrIn);
+
+	return arrIn->insertIndex;
+}
+
+
+size_t cxa_array_getMaxSize_elems(cxa_array_t *const arrIn)
+{
+	cxa_assert(arrIn);
+
+	return arrIn->maxNumElements;
+}
+
+
+void cxa_fixedFifo_init(cxa_fixedFifo_t *const fifoIn, cxa_fixedFifo_onFullAction_t onFullActionIn, size_t datatypeSize_bytesIn, void *const bufferLocIn, size_t bufferMaxSize_bytesIn)
+{
+	cxa_assert(fifoIn);
+	cxa_assert(datatypeSize_bytesIn > 0);
+	cxa_assert(bufferLocIn);
+
+	fifoIn->onFullAction = onFullActionIn;
+	fifoIn->datatypeSize_bytes = datatypeSize_bytesIn;
+	fifoIn->maxNumElements = bufferMaxSize_bytesIn / datatypeSize_bytesIn;
+	fifoIn->insertIndex = 0;
+	fifoIn->removeIndex = 0;
+	fifoIn->numElements = 0;
+	fifoIn->bufferLoc = bufferLocIn;
+	cxa_assert(fifoIn->maxNumElements > 0);
+}
+
+
+bool cxa_fixedFifo_queue(cxa_fixedFifo_t *const fifoIn, void *const elemIn)
+{
+	cxa_assert(fifoIn);
+	cxa_assert(elemIn);
+
+	if( fifoIn->numElements == fifoIn->maxNumElements )
+	{
+		if( fifoIn->onFullAction == CXA_FF_ON_FULL_DROP ) return false;
+		cxa_fixedFifo_bulkDequeue(fifoIn, 1);
+	}
+
+	memcpy(&fifoIn->bufferLoc[fifoIn->insertIndex * fifoIn->datatypeSize_bytes], elemIn, fifoIn->datatypeSize_bytes);
+	fifoIn->insertIndex = (fifoIn->insertIndex + 1) % fifoIn->maxNumElements;
+	fifoIn->numElements++;
+	return true;
+}
+
+
+bool cxa_fixedFifo_dequeue(cxa_fixedFifo_t *const fifoIn, void *const elemOut)
+{
+	cxa_assert(fifoIn);
+
+	if( fifoIn->numElements == 0 ) return false;
+
+	if( elemOut != NULL ) memcpy(elemOut, &fifoIn->bufferLoc[fifoIn->removeIndex * fifoIn->datatypeSize_bytes], fifoIn->datatypeSize_bytes);
+	return cxa_fixedFifo_bulkDequeue(fifoIn, 1);
+}
+
+
+size_t cxa_fixedFifo_bulkDequeue_peek(cxa_fixedFifo_t *const fifoIn, void** elemsOut)
+{
+	cxa_assert(fifoIn);
+	cxa_assert(elemsOut);
+
+	*elemsOut = &fifoIn->bufferLoc[fifoIn->removeIndex * fifoIn->datatypeSize_bytes];
+
+	// only up to where the buffer wraps
+	size_t numToEnd = fifoIn->maxNumElements - fifoIn->removeIndex;
+	return (fifoIn->numElements < numToEnd) ? fifoIn->numElements : numToEnd;
+}
+
+
+bool cxa_fixedFifo_bulkDequeue(cxa_fixedFifo_t *const fifoIn, size_t numElemsIn)
+{
+	cxa_assert(fifoIn);
+
+	if( numElemsIn > fifoIn->numElements ) return false;
+
+	fifoIn->removeIndex = (fifoIn->removeIndex + numElemsIn) % fifoIn->maxNumElements;
+	fifoIn->numElements -= numElemsIn;
+	return true;
+}
+
+
+size_t cxa_fixedFifo_getSize_elems(cxa_fixedFifo_t *const fifoIn)
+{
+	cxa_assert(fifoIn);
+
+	return fifoIn->numElements;
+}
+
+
+void cxa_fixedByteBuffer_init_inPlace(cxa_fixedByteBuffer_t *const fbbIn, size_t currSize_bytesIn, void *const bufferIn, size_t maxSize_bytesIn)
+{
+	cxa_assert(fbbIn);
+	cxa_assert(bufferIn || (maxSize_bytesIn == 0));
+	cxa_assert(currSize_bytesIn <= maxSize_bytesIn);
+
+	fbbIn->buffer = bufferIn;
+	fbbIn->currSize_bytes = currSize_bytesIn;
+	fbbIn->maxSize_bytes = maxSize_bytesIn;
+}
+
+
+bool cxa_fixedByteBuffer_get(cxa_fixedByteBuffer_t *const fbbIn, size_t indexIn, uint8_t *const valOut, size_t numBytesIn)
+{
+	cxa_assert(fbbIn);
+	cxa_assert(valOut);
+
+	if( (indexIn + numBytesIn) > fbbIn->currSize_bytes ) return false;
+
+	memcpy(valOut, &fbbIn->buffer[indexIn], numBytesIn);
+	return true;
+}
+
+
+uint8_t* cxa_fixedByteBuffer_get_pointerToIndex(cxa_fixedByteBuffer_t *const fbbIn, size_t indexIn)
+{
+	cxa_assert(fbbIn);
+
+	return (indexIn <= fbbIn->currSize_bytes) ? &fbbIn->buffer[indexIn] : NULL;
+}
+
+
+size_t cxa_fixedByteBuffer_getSize_bytes(cxa_fixedByteBuffer_t *const fbbIn)
+{
+	cxa_assert(fbbIn);
+
+	return fbbIn->currSize_bytes;
+}
+
+
+void cxa_linkedField_init_inPlace(cxa_linkedField_t *const lfIn, size_t currSize_bytesIn, void *const bufferIn, size_t maxSize_bytesIn)
+{
+	cxa_assert(lfIn);
+	cxa_assert(bufferIn || (maxSize_bytesIn == 0));
+	cxa_assert(currSize_bytesIn <= maxSize_bytesIn);
+
+	lfIn->buffer = bufferIn;
+	lfIn->currSize_bytes = currSize_bytesIn;
+	lfIn->maxSize_bytes = maxSize_bytesIn;
+}
+
+
+bool cxa_linkedField_get(cxa_linkedField_t *const lfIn, size_t indexIn, uint8_t *const valOut, size_t numBytesIn)
+{
+	cxa_assert(lfIn);
+	cxa_assert(valOut);
+
+	if( (indexIn + numBytesIn) > lfIn->currSize_bytes ) return false;
+
+	memcpy(valOut, &lfIn->buffer[indexIn], numBytesIn);
+	return true;
+}
+
+
+uint8_t* cxa_linkedField_get_pointerToIndex(cxa_linkedField_t *const lfIn, size_t indexIn)
+{
+	cxa_assert(lfIn);
+
+	return (indexIn <= lfIn->currSize_bytes) ? &lfIn->buffer[indexIn] : NULL;
+}
+
+
+size_t cxa_linkedField_getSize_bytes(cxa_linkedField_t *const lfIn)
+{
+	cxa_assert(lfIn);
+
+	return lfIn->currSize_bytes;
+}
+
+
+bool cxa_linkedField_append(cxa_linkedField_t *const lfIn, const uint8_t *const valIn, size_t numBytesIn)
+{
+	cxa_assert(lfIn);
+	cxa_assert(valIn || (numBytesIn == 0));
+
+	if( (lfIn->currSize_bytes + numBytesIn) > lfIn->maxSize_bytes ) return false;
+
+	memcpy(&lfIn->buffer[lfIn->currSize_bytes], valIn, numBytesIn);
+	lfIn->currSize_bytes += numBytesIn;
+	return true;
+}
+
+
+bool cxa_linkedField_append_uint8(cxa_linkedField_t *const lfIn, uint8_t valIn)
+{
+	return cxa_linkedField_append(lfIn, &valIn, sizeof(valIn));
+}
+
+
+bool cxa_linkedField_append_uint16LE(cxa_linkedField_t *const lfIn, uint16_t valIn)
+{
+	return cxa_linkedField_append(lfIn, (uint8_t*)&valIn, sizeof(valIn));
+}
+
+
+bool cxa_linkedField_append_uint32LE(cxa_linkedField_t *const lfIn, uint32_t valIn)
+{
+	return cxa_linkedField_append(lfIn, (uint8_t*)&valIn, sizeof(valIn));
+}
+
+
+bool cxa_eui48_initFromBuffer(cxa_eui48_t *const uuidIn, cxa_fixedByteBuffer_t *const fbbIn, size_t indexIn)
+{
+	cxa_assert(uuidIn);
+	cxa_assert(fbbIn);
+
+	return cxa_fixedByteBuffer_get(fbbIn, indexIn, uuidIn->bytes, sizeof(uuidIn->bytes));
+}
+
+
+bool cxa_eui48_isEqual(cxa_eui48_t *const uuid1In, cxa_eui48_t *const uuid2In)
+{
+	cxa_assert(uuid1In);
+	cxa_assert(uuid2In);
+
+	return (memcmp(uuid1In->bytes, uuid2In->bytes, sizeof(uuid1In->bytes)) == 0);
+}
+
+
+void cxa_eui48_toString(cxa_eui48_t *const uuidIn, cxa_eui48_string_t *const strOut)
+{
+	cxa_assert(uuidIn);
+	cxa_assert(strOut);
+
+	snprintf(strOut->str, sizeof(strOut->str), "%02x:%02x:%02x:%02x:%02x:%02x",
+			 uuidIn->bytes[0], uuidIn->bytes[1], uuidIn->bytes[2], uuidIn->bytes[3], uuidIn->bytes[4], uuidIn->bytes[5]);
+}
+
+
+bool cxa_stringUtils_concat(char *targetStrIn, const char *sourceStrIn, size_t targetSize_bytesIn)
+{
+	cxa_assert(targetStrIn);
+	cxa_assert(sourceStrIn);
+
+	size_t targetLen = strlen(targetStrIn);
+	size_t sourceLen = strlen(sourceStrIn);
+	if( (targetLen + sourceLen + 1) > targetSize_bytesIn ) return false;
+
+	memcpy(&targetStrIn[targetLen], sourceStrIn, sourceLen + 1);
+	return true;
+}
+
+
+bool cxa_stringUtils_concat_formattedString(char *targetStrIn, size_t targetSize_bytesIn, const char *formatIn, ...)
+{
+	cxa_assert(targetStrIn);
+	cxa_assert(formatIn);
+
+	size_t targetLen = strlen(targetStrIn);
+	if( targetLen >= targetSize_bytesIn ) return false;
+
+	va_list varArgs;
+	va_start(varArgs, formatIn);
+	int numWritten = vsnprintf(&targetStrIn[targetLen], targetSize_bytesIn - targetLen, formatIn, varArgs);
+	va_end(varArgs);
+
+	// leave the target as it was if it didn't fit
+	if( (numWritten < 0) || ((size_t)numWritten >= (targetSize_bytesIn - targetLen)) )
+	{
+		targetStrIn[targetLen] = 0;
+		return false;
+	}
+	return true;
+}
+
+
+// ******** local function implementations ********
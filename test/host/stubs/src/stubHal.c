@@ -0,0 +1,290 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include "stubHal.h"
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_console.h>
+#include <cxa_criticalSection.h>
+#include <cxa_runLoop.h>
+#include <cxa_sntpClient.h>
+#include <cxa_timeBase.h>
+#include <cxa_timeDiff.h>
+#include <cxa_uniqueId.h>
+
+#include "stubHal_internal.h"
+
+
+// ******** local macro definitions ********
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	int threadId;
+	cxa_runLoop_cb_update_t cb;
+	void* userVar;
+}runLoopEntry_t;
+
+
+typedef struct
+{
+	const char* command;
+	cxa_console_command_cb_t cb;
+	void* userVar;
+}consoleEntry_t;
+
+
+// ******** local function prototypes ********
+
+
+// ********  local variable declarations *********
+static uint32_t clock_us;
+
+static bool isUnixTimeSet;
+static uint32_t unixTimeBase;
+static uint32_t unixTimeBase_us;
+
+static runLoopEntry_t runLoopEntries[CXA_RUNLOOP_MAXNUM_ENTRIES];
+static size_t numRunLoopEntries;
+
+static consoleEntry_t consoleEntries[CXA_CONSOLE_MAXNUM_COMMANDS];
+static size_t numConsoleEntries;
+
+static int criticalSectionDepth;
+
+
+// ******** global function implementations ********
+void stubHal_reset(void)
+{
+	stubHal_reboot();
+	stubHal_internal_resetNvs();
+}
+
+
+void stubHal_reboot(void)
+{
+	clock_us = STUBHAL_START_TIME_US;
+	isUnixTimeSet = false;
+	numRunLoopEntries = 0;
+	numConsoleEntries = 0;
+	criticalSectionDepth = 0;
+
+	stubHal_internal_resetLogger();
+	stubHal_internal_resetMqtt();
+	stubHal_internal_resetHeap();
+}
+
+
+void stubHal_advanceTime_us(uint32_t usIn)
+{
+	clock_us += usIn;
+}
+
+
+void stubHal_advanceTime_ms(uint32_t msIn)
+{
+	clock_us += msIn * 1000;
+}
+
+
+void stubHal_iterateAll(void)
+{
+	stubHal_internal_mqtt_updateKeepAlive();
+	for( int i = 0; i < STUBHAL_MAXNUM_THREADS; i++ ) cxa_runLoop_iterate(i);
+}
+
+
+void stubHal_run_ms(uint32_t duration_msIn, uint32_t step_msIn)
+{
+	cxa_assert(step_msIn > 0);
+
+	for( uint32_t elapsed_ms = 0; elapsed_ms < duration_msIn; elapsed_ms += step_msIn )
+	{
+		stubHal_advanceTime_ms(step_msIn);
+		stubHal_iterateAll();
+	}
+}
+
+
+void stubHal_setUnixTime(uint32_t unixTimeIn)
+{
+	isUnixTimeSet = true;
+	unixTimeBase = unixTimeIn;
+	unixTimeBase_us = clock_us;
+}
+
+
+int stubHal_getCriticalSectionDepth(void)
+{
+	return criticalSectionDepth;
+}
+
+
+size_t stubHal_console_getNumCommands(void)
+{
+	return numConsoleEntries;
+}
+
+
+bool stubHal_console_hasCommand(const char *const commandIn)
+{
+	cxa_assert(commandIn);
+
+	for( size_t i = 0; i < numConsoleEntries; i++ )
+	{
+		if( strcmp(consoleEntries[i].command, commandIn) == 0 ) return true;
+	}
+	return false;
+}
+
+
+uint32_t cxa_timeBase_getCount_us(void)
+{
+	return clock_us;
+}
+
+
+void cxa_timeDiff_init(cxa_timeDiff_t *const tdIn)
+{
+	cxa_assert(tdIn);
+
+	cxa_timeDiff_setStartTime_now(tdIn);
+}
+
+
+void cxa_timeDiff_setStartTime_now(cxa_timeDiff_t *const tdIn)
+{
+	cxa_assert(tdIn);
+
+	tdIn->startTime_us = clock_us;
+}
+
+
+uint32_t cxa_timeDiff_getElapsedTime_ms(cxa_timeDiff_t *const tdIn)
+{
+	cxa_assert(tdIn);
+
+	return (clock_us - tdIn->startTime_us) / 1000;
+}
+
+
+bool cxa_timeDiff_isElapsed_ms(cxa_timeDiff_t *const tdIn, uint32_t msIn)
+{
+	cxa_assert(tdIn);
+
+	return cxa_timeDiff_getElapsedTime_ms(tdIn) >= msIn;
+}
+
+
+bool cxa_timeDiff_isElapsed_recurring_ms(cxa_timeDiff_t *const tdIn, uint32_t msIn)
+{
+	cxa_assert(tdIn);
+
+	if( !cxa_timeDiff_isElapsed_ms(tdIn, msIn) ) return false;
+
+	cxa_timeDiff_setStartTime_now(tdIn);
+	return true;
+}
+
+
+void cxa_runLoop_addEntry(int threadIdIn, cxa_runLoop_cb_update_t cbIn, void *const userVarIn)
+{
+	cxa_assert(cbIn);
+	cxa_assert((threadIdIn >= 0) && (threadIdIn < STUBHAL_MAXNUM_THREADS));
+	cxa_assert_msg(numRunLoopEntries < CXA_RUNLOOP_MAXNUM_ENTRIES, "too many runLoop entries");
+
+	runLoopEntry_t* newEntry = &runLoopEntries[numRunLoopEntries++];
+	newEntry->threadId = threadIdIn;
+	newEntry->cb = cbIn;
+	newEntry->userVar = userVarIn;
+}
+
+
+void cxa_runLoop_iterate(int threadIdIn)
+{
+	// entries may be added while we're iterating
+	for( size_t i = 0; i < numRunLoopEntries; i++ )
+	{
+		if( runLoopEntries[i].threadId == threadIdIn ) runLoopEntries[i].cb(runLoopEntries[i].userVar);
+	}
+	cxa_assert_msg(criticalSectionDepth == 0, "runLoop entry left a critical section open");
+}
+
+
+bool cxa_sntpClient_isClockSet(void)
+{
+	return isUnixTimeSet;
+}
+
+
+uint32_t cxa_sntpClient_getUnixTimeStamp(void)
+{
+	if( !isUnixTimeSet ) return 0;
+
+	return unixTimeBase + ((clock_us - unixTimeBase_us) / 1000000);
+}
+
+
+char* cxa_uniqueId_getHexString(void)
+{
+	static char uniqueId[] = STUBHAL_UNIQUEID;
+	return uniqueId;
+}
+
+
+void cxa_criticalSection_enter(void)
+{
+	criticalSectionDepth++;
+}
+
+
+void cxa_criticalSection_exit(void)
+{
+	cxa_assert_msg(criticalSectionDepth > 0, "unbalanced critical section exit");
+	criticalSectionDepth--;
+}
+
+
+void cxa_assert_impl(const char *const msgIn, const char *const fileIn, int lineIn)
+{
+	fprintf(stderr, "ASSERT %s:%d: %s\n", fileIn, lineIn, msgIn);
+	fflush(stderr);
+	abort();
+}
+
+
+void cxa_console_addCommand(const char* commandIn, const char* descriptionIn,
+							cxa_console_argDescriptor_t* argDescsIn, size_t numArgsIn,
+							cxa_console_command_cb_t cbIn, void* userVarIn)
+{
+	cxa_assert(commandIn);
+	cxa_assert(cbIn);
+	cxa_assert_msg(numConsoleEntries < CXA_CONSOLE_MAXNUM_COMMANDS, "too many console commands");
+
+	consoleEntry_t* newEntry = &consoleEntries[numConsoleEntries++];
+	newEntry->command = commandIn;
+	newEntry->cb = cbIn;
+	newEntry->userVar = userVarIn;
+}
+
+
+// ******** local function implementations ********
@@ -0,0 +1,40 @@
+/**
+ * @file
+ * Reset hooks shared between the stub translation units
+ *
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#ifndef STUBHAL_INTERNAL_H_
+#define STUBHAL_INTERNAL_H_
+
+
+// ******** includes ********
+
+
+// ******** global macro definitions ********
+
+
+// ******** global type definitions *********
+
+
+// ******** global function prototypes ********
+void stubHal_internal_resetLogger(void);
+void stubHal_internal_resetNvs(void);
+void stubHal_internal_resetMqtt(void);
+void stubHal_internal_resetHeap(void);
+
+void stubHal_internal_mqtt_updateKeepAlive(void);
+
+#endif
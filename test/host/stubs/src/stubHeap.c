@@ -0,0 +1,224 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <esp_heap_caps.h>
+
+
+// ******** includes ********
+#include <stdlib.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+
+#include "stubHal.h"
+#include "stubHal_internal.h"
+
+
+// ******** local macro definitions ********
+#define PSRAM_CACHE_NUMLINES			(STUBHAL_HEAP_PSRAM_CACHE_SIZE_BYTES / STUBHAL_HEAP_PSRAM_CACHELINE_SIZE_BYTES)
+
+
+// ******** local type definitions ********
+// prepended to every allocation so it can be accounted for on free
+typedef struct
+{
+	size_t size_bytes;
+	uint32_t caps;
+	uint32_t padding[2];
+}allocHeader_t;
+
+
+typedef struct
+{
+	uintptr_t start;
+	size_t size_bytes;
+}psramAlloc_t;
+
+
+// ******** local function prototypes ********
+static size_t* getAllocatedCounter(uint32_t capsIn);
+static size_t getRegionSize_bytes(uint32_t capsIn);
+static bool isInPsram(uintptr_t addrIn);
+
+
+// ********  local variable declarations *********
+static size_t numAllocated_internal_bytes;
+static size_t numAllocated_psram_bytes;
+static size_t regionSize_internal_bytes;
+static size_t regionSize_psram_bytes;
+
+static psramAlloc_t psramAllocs[STUBHAL_HEAP_MAXNUM_PSRAM_ALLOCS];
+static size_t numPsramAllocs;
+
+// line address + 1 held by each cache line (0 when empty)
+static uintptr_t psramCacheTags[PSRAM_CACHE_NUMLINES];
+static size_t numPsramMisses;
+
+static stubHal_heap_cb_onAlloc_t cb_onAlloc;
+static void* cb_onAlloc_userVar;
+
+
+// ******** global function implementations ********
+void stubHal_internal_resetHeap(void)
+{
+	// allocations from a previous test are leaked rather than tracked
+	numAllocated_internal_bytes = 0;
+	numAllocated_psram_bytes = 0;
+	regionSize_internal_bytes = STUBHAL_HEAP_INTERNAL_SIZE_BYTES;
+	regionSize_psram_bytes = STUBHAL_HEAP_PSRAM_SIZE_BYTES;
+	numPsramAllocs = 0;
+	cb_onAlloc = NULL;
+	cb_onAlloc_userVar = NULL;
+
+	stubHal_heap_clearPsramCache();
+	numPsramMisses = 0;
+}
+
+
+size_t stubHal_heap_getNumAllocated_bytes(uint32_t capsIn)
+{
+	return *getAllocatedCounter(capsIn);
+}
+
+
+void stubHal_heap_setOnAlloc(stubHal_heap_cb_onAlloc_t cbIn, void* userVarIn)
+{
+	cb_onAlloc = cbIn;
+	cb_onAlloc_userVar = userVarIn;
+}
+
+
+void stubHal_heap_setRegionSize_bytes(uint32_t capsIn, size_t size_bytesIn)
+{
+	if( capsIn & MALLOC_CAP_SPIRAM ) regionSize_psram_bytes = size_bytesIn;
+	else regionSize_internal_bytes = size_bytesIn;
+}
+
+
+void stubHal_heap_touch(const void *const ptrIn, size_t size_bytesIn)
+{
+	if( (size_bytesIn == 0) || !isInPsram((uintptr_t)ptrIn) ) return;
+
+	uintptr_t firstLine = (uintptr_t)ptrIn / STUBHAL_HEAP_PSRAM_CACHELINE_SIZE_BYTES;
+	uintptr_t lastLine = ((uintptr_t)ptrIn + size_bytesIn - 1) / STUBHAL_HEAP_PSRAM_CACHELINE_SIZE_BYTES;
+	for( uintptr_t currLine = firstLine; currLine <= lastLine; currLine++ )
+	{
+		uintptr_t* tag = &psramCacheTags[currLine % PSRAM_CACHE_NUMLINES];
+		if( *tag == (currLine + 1) ) continue;
+
+		*tag = currLine + 1;
+		numPsramMisses++;
+	}
+}
+
+
+size_t stubHal_heap_getNumPsramMisses(void)
+{
+	return numPsramMisses;
+}
+
+
+uint64_t stubHal_heap_getPsramStall_ns(void)
+{
+	return (uint64_t)numPsramMisses * STUBHAL_HEAP_PSRAM_MISSPENALTY_NS;
+}
+
+
+void stubHal_heap_clearPsramCache(void)
+{
+	memset(psramCacheTags, 0, sizeof(psramCacheTags));
+}
+
+
+void* heap_caps_malloc(size_t sizeIn, uint32_t capsIn)
+{
+	if( cb_onAlloc != NULL ) cb_onAlloc(cb_onAlloc_userVar);
+
+	size_t* allocated = getAllocatedCounter(capsIn);
+	if( (*allocated + sizeIn) > getRegionSize_bytes(capsIn) ) return NULL;
+
+	allocHeader_t* header = malloc(sizeof(*header) + sizeIn);
+	if( header == NULL ) return NULL;
+	header->size_bytes = sizeIn;
+	header->caps = capsIn;
+	*allocated += sizeIn;
+
+	if( capsIn & MALLOC_CAP_SPIRAM )
+	{
+		cxa_assert(numPsramAllocs < STUBHAL_HEAP_MAXNUM_PSRAM_ALLOCS);
+		psramAllocs[numPsramAllocs].start = (uintptr_t)(header + 1);
+		psramAllocs[numPsramAllocs].size_bytes = sizeIn;
+		numPsramAllocs++;
+	}
+
+	return header + 1;
+}
+
+
+void heap_caps_free(void* ptrIn)
+{
+	if( ptrIn == NULL ) return;
+
+	allocHeader_t* header = ((allocHeader_t*)ptrIn) - 1;
+	size_t* allocated = getAllocatedCounter(header->caps);
+	*allocated = (header->size_bytes <= *allocated) ? (*allocated - header->size_bytes) : 0;
+
+	for( size_t i = 0; i < numPsramAllocs; i++ )
+	{
+		if( psramAllocs[i].start != (uintptr_t)ptrIn ) continue;
+		psramAllocs[i] = psramAllocs[--numPsramAllocs];
+		break;
+	}
+
+	free(header);
+}
+
+
+size_t heap_caps_get_free_size(uint32_t capsIn)
+{
+	size_t regionSize_bytes = getRegionSize_bytes(capsIn);
+	size_t allocated_bytes = *getAllocatedCounter(capsIn);
+	return (allocated_bytes < regionSize_bytes) ? (regionSize_bytes - allocated_bytes) : 0;
+}
+
+
+size_t heap_caps_get_largest_free_block(uint32_t capsIn)
+{
+	// no fragmentation on the host
+	return heap_caps_get_free_size(capsIn);
+}
+
+
+// ******** local function implementations ********
+static size_t* getAllocatedCounter(uint32_t capsIn)
+{
+	return (capsIn & MALLOC_CAP_SPIRAM) ? &numAllocated_psram_bytes : &numAllocated_internal_bytes;
+}
+
+
+static size_t getRegionSize_bytes(uint32_t capsIn)
+{
+	return (capsIn & MALLOC_CAP_SPIRAM) ? regionSize_psram_bytes : regionSize_internal_bytes;
+}
+
+
+static bool isInPsram(uintptr_t addrIn)
+{
+	for( size_t i = 0; i < numPsramAllocs; i++ )
+	{
+		if( (addrIn >= psramAllocs[i].start) && (addrIn < (psramAllocs[i].start + psramAllocs[i].size_bytes)) ) return true;
+	}
+	return false;
+}
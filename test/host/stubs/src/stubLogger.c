@@ -0,0 +1,141 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <cxa_ioStream.h>
+#include <cxa_logger_header.h>
+
+
+// ******** includes ********
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_timeBase.h>
+
+#include "stubHal_internal.h"
+
+
+// ******** local macro definitions ********
+#define LINE_MAXSIZE_BYTES				160
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+
+
+// ********  local variable declarations *********
+static cxa_ioStream_t* globalIoStream;
+
+// indexed by CXA_LOG_LEVEL_*
+static const char* levelStrs[] = { "", "ERROR", "WARN", "INFO", "DEBUG", "TRACE" };
+
+
+// ******** global function implementations ********
+void stubHal_internal_resetLogger(void)
+{
+	globalIoStream = NULL;
+}
+
+
+void cxa_ioStream_init(cxa_ioStream_t *const ioStreamIn)
+{
+	cxa_assert(ioStreamIn);
+
+	ioStreamIn->cb_readByte = NULL;
+	ioStreamIn->cb_writeBytes = NULL;
+	ioStreamIn->userVar = NULL;
+}
+
+
+void cxa_ioStream_bind(cxa_ioStream_t *const ioStreamIn, cxa_ioStream_cb_readByte_t readCbIn, cxa_ioStream_cb_writeBytes_t writeCbIn, void *const userVarIn)
+{
+	cxa_assert(ioStreamIn);
+
+	ioStreamIn->cb_readByte = readCbIn;
+	ioStreamIn->cb_writeBytes = writeCbIn;
+	ioStreamIn->userVar = userVarIn;
+}
+
+
+bool cxa_ioStream_writeBytes(cxa_ioStream_t *const ioStreamIn, void* buffIn, size_t bufferSize_bytesIn)
+{
+	cxa_assert(ioStreamIn);
+
+	if( ioStreamIn->cb_writeBytes == NULL ) return false;
+	return ioStreamIn->cb_writeBytes(buffIn, bufferSize_bytesIn, ioStreamIn->userVar);
+}
+
+
+bool cxa_ioStream_writeString(cxa_ioStream_t *const ioStreamIn, const char *const stringIn)
+{
+	cxa_assert(stringIn);
+
+	return cxa_ioStream_writeBytes(ioStreamIn, (void*)stringIn, strlen(stringIn));
+}
+
+
+bool cxa_ioStream_writeLine(cxa_ioStream_t *const ioStreamIn, const char *const stringIn)
+{
+	return cxa_ioStream_writeString(ioStreamIn, stringIn) && cxa_ioStream_writeString(ioStreamIn, "\r\n");
+}
+
+
+void cxa_logger_init(cxa_logger_t *const loggerIn, const char *const nameIn)
+{
+	cxa_assert(loggerIn);
+	cxa_assert(nameIn);
+
+	strncpy(loggerIn->name, nameIn, CXA_LOGGER_MAXLEN_NAME);
+	loggerIn->name[CXA_LOGGER_MAXLEN_NAME] = 0;
+}
+
+
+void cxa_logger_setGlobalIoStream(cxa_ioStream_t *const ioStreamIn)
+{
+	globalIoStream = ioStreamIn;
+}
+
+
+cxa_ioStream_t* cxa_logger_getGlobalIoStream(void)
+{
+	return globalIoStream;
+}
+
+
+void cxa_logger_log_formattedString(cxa_logger_t *const loggerIn, uint8_t levelIn, const char *const formatIn, ...)
+{
+	cxa_assert(loggerIn);
+	cxa_assert(formatIn);
+
+	if( globalIoStream == NULL ) return;
+
+	char line[LINE_MAXSIZE_BYTES];
+	const char* levelStr = (levelIn < (sizeof(levelStrs)/sizeof(*levelStrs))) ? levelStrs[levelIn] : "";
+	int prefixLen = snprintf(line, sizeof(line), "%u [%s] %s ", (unsigned)(cxa_timeBase_getCount_us() / 1000), loggerIn->name, levelStr);
+	if( (prefixLen < 0) || ((size_t)prefixLen >= sizeof(line)) ) return;
+
+	va_list varArgs;
+	va_start(varArgs, formatIn);
+	vsnprintf(&line[prefixLen], sizeof(line) - prefixLen, formatIn, varArgs);
+	va_end(varArgs);
+
+	cxa_ioStream_writeLine(globalIoStream, line);
+}
+
+
+// ******** local function implementations ********
@@ -0,0 +1,472 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <cxa_mqtt_client.h>
+#include <cxa_mqtt_connectionManager.h>
+#include <cxa_mqtt_rpc_node.h>
+#include <cxa_mqtt_rpc_node_root.h>
+
+
+// ******** includes ********
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cxa_assert.h>
+#include <cxa_timeBase.h>
+
+#include "stubHal.h"
+#include "stubHal_internal.h"
+
+
+// ******** local macro definitions ********
+#define MAXNUM_NODES					32
+#define PARAMS_MAXSIZE_BYTES			256
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void registerNode(cxa_mqtt_rpc_node_t *const nodeIn);
+static size_t getNodePath(cxa_mqtt_rpc_node_t *const nodeIn, char *const pathOut, size_t maxSize_bytesIn);
+static cxa_mqtt_rpc_node_t* findNode(const char *const relPathIn);
+static size_t getEncodedMessageSize_bytes(size_t topicLenIn, cxa_mqtt_qosLevel_t qosIn, size_t payloadSize_bytesIn);
+static uint32_t keepAliveRand(void);
+
+
+// ********  local variable declarations *********
+static cxa_mqtt_client_t client;
+static cxa_mqtt_rpc_node_root_t rootNode;
+
+static cxa_mqtt_rpc_node_t* nodes[MAXNUM_NODES];
+static size_t numNodes;
+
+static stubHal_publication_t* publications;
+static size_t numPublications;
+static size_t maxNumPublications;
+
+static size_t numPublishesToFail;
+static size_t numOversizedPublishes;
+
+static uint32_t keepAlive_period_ms;
+static uint32_t keepAlive_respDelay_ms;
+static uint32_t keepAlive_respJitter_ms;
+static uint8_t keepAlive_respLossPcnt;
+static uint32_t keepAlive_lcgState;
+static bool isPingOutstanding;
+static bool isPingRespLost;
+static uint32_t lastPingReqTime_us;
+static uint32_t pingRespDueTime_us;
+static size_t numPingResps;
+
+
+// ******** global function implementations ********
+void stubHal_internal_resetMqtt(void)
+{
+	memset(&client, 0, sizeof(client));
+	client.isConnected = true;
+
+	numNodes = 0;
+	cxa_mqtt_rpc_node_root_init(&rootNode, &client, true, "%s", STUBHAL_UNIQUEID);
+
+	numPublications = 0;
+	numPublishesToFail = 0;
+	numOversizedPublishes = 0;
+
+	keepAlive_period_ms = 0;
+	keepAlive_respDelay_ms = 0;
+	keepAlive_respJitter_ms = 0;
+	keepAlive_respLossPcnt = 0;
+	keepAlive_lcgState = 1;
+	isPingOutstanding = false;
+	lastPingReqTime_us = cxa_timeBase_getCount_us();
+	numPingResps = 0;
+}
+
+
+void stubHal_internal_mqtt_updateKeepAlive(void)
+{
+	if( !client.isConnected || (keepAlive_period_ms == 0) ) return;
+	uint32_t now_us = cxa_timeBase_getCount_us();
+
+	if( isPingOutstanding )
+	{
+		if( (int32_t)(now_us - pingRespDueTime_us) < 0 ) return;
+		isPingOutstanding = false;
+		if( isPingRespLost ) return;
+
+		numPingResps++;
+		for( size_t i = 0; i < client.numListeners; i++ )
+		{
+			cxa_mqtt_client_listenerEntry_t* currListener = &client.listeners[i];
+			if( currListener->cb_onPingRespRx != NULL ) currListener->cb_onPingRespRx(&client, currListener->userVar);
+		}
+		return;
+	}
+
+	// only one PINGREQ outstanding at a time
+	if( (now_us - lastPingReqTime_us) < (keepAlive_period_ms * 1000) ) return;
+	lastPingReqTime_us = now_us;
+
+	uint32_t delay_ms = keepAlive_respDelay_ms + ((keepAlive_respJitter_ms > 0) ? (keepAliveRand() % (keepAlive_respJitter_ms + 1)) : 0);
+	isPingOutstanding = true;
+	isPingRespLost = (keepAliveRand() % 100) < keepAlive_respLossPcnt;
+	pingRespDueTime_us = now_us + (delay_ms * 1000);
+}
+
+
+cxa_mqtt_rpc_node_t* stubHal_getRootNode(void)
+{
+	return &rootNode.super;
+}
+
+
+void stubHal_mqtt_setConnected(bool isConnectedIn)
+{
+	if( isConnectedIn == client.isConnected ) return;
+	client.isConnected = isConnectedIn;
+
+	// an outstanding PINGREQ goes down with the connection
+	isPingOutstanding = false;
+	lastPingReqTime_us = cxa_timeBase_getCount_us();
+
+	for( size_t i = 0; i < client.numListeners; i++ )
+	{
+		cxa_mqtt_client_listenerEntry_t* currListener = &client.listeners[i];
+		if( isConnectedIn && (currListener->cb_onConnect != NULL) ) currListener->cb_onConnect(&client, currListener->userVar);
+		if( !isConnectedIn && (currListener->cb_onDisconnect != NULL) ) currListener->cb_onDisconnect(&client, currListener->userVar);
+	}
+}
+
+
+void stubHal_mqtt_failNextPublishes(size_t numPublishesIn)
+{
+	numPublishesToFail = numPublishesIn;
+}
+
+
+size_t stubHal_getNumPublications(void)
+{
+	return numPublications;
+}
+
+
+stubHal_publication_t* stubHal_getPublication(size_t indexIn)
+{
+	return (indexIn < numPublications) ? &publications[indexIn] : NULL;
+}
+
+
+void stubHal_clearPublications(void)
+{
+	numPublications = 0;
+}
+
+
+stubHal_publication_t* stubHal_findPublication(const char *const nameIn, size_t *const indexInOut)
+{
+	cxa_assert(nameIn);
+
+	size_t nameLen = strlen(nameIn);
+	for( size_t i = (indexInOut != NULL) ? *indexInOut : 0; i < numPublications; i++ )
+	{
+		size_t topicLen = strlen(publications[i].topic);
+		if( (topicLen > nameLen) &&
+			(publications[i].topic[topicLen - nameLen - 1] == '/') &&
+			(strcmp(&publications[i].topic[topicLen - nameLen], nameIn) == 0) )
+		{
+			if( indexInOut != NULL ) *indexInOut = i;
+			return &publications[i];
+		}
+	}
+	return NULL;
+}
+
+
+size_t stubHal_countPublications(const char *const nameIn)
+{
+	size_t retVal = 0;
+	for( size_t i = 0; stubHal_findPublication(nameIn, &i) != NULL; i++ ) retVal++;
+	return retVal;
+}
+
+
+size_t stubHal_getNumOversizedPublishes(void)
+{
+	return numOversizedPublishes;
+}
+
+
+void stubHal_mqtt_setKeepAlive(uint32_t period_msIn, uint32_t respDelay_msIn, uint32_t respJitter_msIn, uint8_t respLossPcntIn)
+{
+	cxa_assert(respLossPcntIn <= 100);
+
+	keepAlive_period_ms = period_msIn;
+	keepAlive_respDelay_ms = respDelay_msIn;
+	keepAlive_respJitter_ms = respJitter_msIn;
+	keepAlive_respLossPcnt = respLossPcntIn;
+}
+
+
+size_t stubHal_mqtt_getNumPingResps(void)
+{
+	return numPingResps;
+}
+
+
+cxa_mqtt_rpc_methodRetVal_t stubHal_callMethod(const char *const nodePathIn, const char *const methodNameIn,
+											   const void *const paramsIn, size_t paramsSize_bytesIn,
+											   uint8_t *const responseOut, size_t responseMaxSize_bytesIn, size_t *const responseSize_bytesOut)
+{
+	cxa_assert(methodNameIn);
+	cxa_assert(paramsSize_bytesIn <= PARAMS_MAXSIZE_BYTES);
+
+	cxa_mqtt_rpc_node_t* node = findNode(nodePathIn);
+	cxa_assert_msg(node, "no such rpc node");
+
+	for( size_t i = 0; i < node->numMethods; i++ )
+	{
+		cxa_mqtt_rpc_node_methodEntry_t* currMethod = &node->methods[i];
+		if( strcmp(currMethod->name, methodNameIn) != 0 ) continue;
+
+		uint8_t params_raw[PARAMS_MAXSIZE_BYTES];
+		if( paramsSize_bytesIn > 0 ) memcpy(params_raw, paramsIn, paramsSize_bytesIn);
+		cxa_linkedField_t params;
+		cxa_linkedField_init_inPlace(&params, paramsSize_bytesIn, params_raw, sizeof(params_raw));
+
+		uint8_t response_raw[PARAMS_MAXSIZE_BYTES];
+		cxa_linkedField_t response;
+		cxa_linkedField_init_inPlace(&response, 0, (responseOut != NULL) ? responseOut : response_raw,
+									 (responseOut != NULL) ? responseMaxSize_bytesIn : sizeof(response_raw));
+
+		cxa_mqtt_rpc_methodRetVal_t retVal = currMethod->cb(node, &params, &response, currMethod->userVar);
+		if( responseSize_bytesOut != NULL ) *responseSize_bytesOut = cxa_linkedField_getSize_bytes(&response);
+		return retVal;
+	}
+
+	cxa_assert_failWithMsg("no such rpc method");
+}
+
+
+void cxa_mqtt_client_addListener(cxa_mqtt_client_t *const clientIn,
+								 cxa_mqtt_client_cb_onConnect_t cb_onConnectIn,
+								 cxa_mqtt_client_cb_onConnectFailed_t cb_onConnectFailIn,
+								 cxa_mqtt_client_cb_onDisconnect_t cb_onDisconnectIn,
+								 cxa_mqtt_client_cb_onPingRespRx_t cb_onPingRespRxIn,
+								 void *const userVarIn)
+{
+	cxa_assert(clientIn);
+	cxa_assert_msg(clientIn->numListeners < CXA_MQTT_CLIENT_MAXNUM_LISTENERS, "too many mqtt listeners");
+
+	cxa_mqtt_client_listenerEntry_t* newListener = &clientIn->listeners[clientIn->numListeners++];
+	newListener->cb_onConnect = cb_onConnectIn;
+	newListener->cb_onConnectFailed = cb_onConnectFailIn;
+	newListener->cb_onDisconnect = cb_onDisconnectIn;
+	newListener->cb_onPingRespRx = cb_onPingRespRxIn;
+	newListener->userVar = userVarIn;
+}
+
+
+bool cxa_mqtt_client_isConnected(cxa_mqtt_client_t *const clientIn)
+{
+	cxa_assert(clientIn);
+
+	return clientIn->isConnected;
+}
+
+
+void cxa_mqtt_client_disconnect(cxa_mqtt_client_t *const clientIn)
+{
+	cxa_assert(clientIn == &client);
+
+	stubHal_mqtt_setConnected(false);
+}
+
+
+cxa_mqtt_client_t* cxa_mqtt_connManager_getMqttClient(void)
+{
+	return &client;
+}
+
+
+void cxa_mqtt_rpc_node_root_init(cxa_mqtt_rpc_node_root_t *const nodeIn, cxa_mqtt_client_t *const clientIn, bool reportStateIn, const char *nameFmtIn, ...)
+{
+	cxa_assert(nodeIn);
+	cxa_assert(clientIn);
+	cxa_assert(nameFmtIn);
+
+	memset(nodeIn, 0, sizeof(*nodeIn));
+	nodeIn->client = clientIn;
+
+	va_list varArgs;
+	va_start(varArgs, nameFmtIn);
+	vsnprintf(nodeIn->super.name, sizeof(nodeIn->super.name), nameFmtIn, varArgs);
+	va_end(varArgs);
+
+	registerNode(&nodeIn->super);
+}
+
+
+void cxa_mqtt_rpc_node_init_formattedString(cxa_mqtt_rpc_node_t *const nodeIn, cxa_mqtt_rpc_node_t *const parentNodeIn, const char *nameFmtIn, ...)
+{
+	cxa_assert(nodeIn);
+	cxa_assert(parentNodeIn);
+	cxa_assert(nameFmtIn);
+
+	memset(nodeIn, 0, sizeof(*nodeIn));
+	nodeIn->parentNode = parentNodeIn;
+
+	va_list varArgs;
+	va_start(varArgs, nameFmtIn);
+	vsnprintf(nodeIn->name, sizeof(nodeIn->name), nameFmtIn, varArgs);
+	va_end(varArgs);
+
+	registerNode(nodeIn);
+}
+
+
+void cxa_mqtt_rpc_node_addMethod(cxa_mqtt_rpc_node_t *const nodeIn, char *const nameIn, cxa_mqtt_rpc_cb_method_t cbIn, void *const userVarIn)
+{
+	cxa_assert(nodeIn);
+	cxa_assert(nameIn);
+	cxa_assert(cbIn);
+	cxa_assert_msg(nodeIn->numMethods < CXA_MQTT_RPC_NODE_MAXNUM_METHODS, "too many rpc methods");
+
+	cxa_mqtt_rpc_node_methodEntry_t* newMethod = &nodeIn->methods[nodeIn->numMethods++];
+	strncpy(newMethod->name, nameIn, CXA_MQTT_RPC_NODE_MAXLEN_NAME);
+	newMethod->name[CXA_MQTT_RPC_NODE_MAXLEN_NAME] = 0;
+	newMethod->cb = cbIn;
+	newMethod->userVar = userVarIn;
+}
+
+
+bool cxa_mqtt_rpc_node_publishNotification(cxa_mqtt_rpc_node_t *const nodeIn, char *const notiNameIn, cxa_mqtt_qosLevel_t qosIn, void *const payloadIn, size_t payloadLen_bytesIn)
+{
+	cxa_assert(nodeIn);
+	cxa_assert(notiNameIn);
+	cxa_assert(payloadIn || (payloadLen_bytesIn == 0));
+
+	if( !client.isConnected ) return false;
+	if( numPublishesToFail > 0 )
+	{
+		numPublishesToFail--;
+		return false;
+	}
+
+	char topic[STUBHAL_MAXSIZE_TOPIC];
+	size_t topicLen = getNodePath(nodeIn, topic, sizeof(topic));
+	int numWritten = snprintf(&topic[topicLen], sizeof(topic) - topicLen, "/%s", notiNameIn);
+	cxa_assert((numWritten > 0) && ((size_t)numWritten < (sizeof(topic) - topicLen)));
+	topicLen += numWritten;
+
+	// the message factory can't build anything bigger than this
+	size_t messageSize_bytes = getEncodedMessageSize_bytes(topicLen, qosIn, payloadLen_bytesIn);
+	if( messageSize_bytes > CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES )
+	{
+		numOversizedPublishes++;
+		return false;
+	}
+
+	if( numPublications == maxNumPublications )
+	{
+		maxNumPublications = (maxNumPublications == 0) ? 64 : (2 * maxNumPublications);
+		publications = realloc(publications, maxNumPublications * sizeof(*publications));
+		cxa_assert(publications);
+	}
+	stubHal_publication_t* newPub = &publications[numPublications++];
+	memcpy(newPub->topic, topic, topicLen + 1);
+	memcpy(newPub->payload, payloadIn, payloadLen_bytesIn);
+	newPub->payloadSize_bytes = payloadLen_bytesIn;
+	newPub->messageSize_bytes = messageSize_bytes;
+	newPub->qos = qosIn;
+	newPub->time_us = cxa_timeBase_getCount_us();
+
+	return true;
+}
+
+
+// ******** local function implementations ********
+static void registerNode(cxa_mqtt_rpc_node_t *const nodeIn)
+{
+	cxa_assert(nodeIn);
+
+	// modules are re-initialized between tests, don't register the same node twice
+	for( size_t i = 0; i < numNodes; i++ )
+	{
+		if( nodes[i] == nodeIn ) return;
+	}
+	cxa_assert_msg(numNodes < MAXNUM_NODES, "too many rpc nodes");
+	nodes[numNodes++] = nodeIn;
+}
+
+
+static size_t getNodePath(cxa_mqtt_rpc_node_t *const nodeIn, char *const pathOut, size_t maxSize_bytesIn)
+{
+	cxa_assert(nodeIn);
+	cxa_assert(pathOut);
+
+	size_t pathLen = 0;
+	if( nodeIn->parentNode != NULL )
+	{
+		pathLen = getNodePath(nodeIn->parentNode, pathOut, maxSize_bytesIn);
+		cxa_assert((pathLen + 1) < maxSize_bytesIn);
+		pathOut[pathLen++] = '/';
+	}
+
+	size_t nameLen = strlen(nodeIn->name);
+	cxa_assert((pathLen + nameLen) < maxSize_bytesIn);
+	memcpy(&pathOut[pathLen], nodeIn->name, nameLen + 1);
+
+	return pathLen + nameLen;
+}
+
+
+static cxa_mqtt_rpc_node_t* findNode(const char *const relPathIn)
+{
+	char targetPath[STUBHAL_MAXSIZE_TOPIC];
+	snprintf(targetPath, sizeof(targetPath), "%s%s%s", rootNode.super.name,
+			 ((relPathIn != NULL) && (relPathIn[0] != 0)) ? "/" : "", (relPathIn != NULL) ? relPathIn : "");
+
+	for( size_t i = 0; i < numNodes; i++ )
+	{
+		char currPath[STUBHAL_MAXSIZE_TOPIC];
+		getNodePath(nodes[i], currPath, sizeof(currPath));
+		if( strcmp(currPath, targetPath) == 0 ) return nodes[i];
+	}
+	return NULL;
+}
+
+
+static size_t getEncodedMessageSize_bytes(size_t topicLenIn, cxa_mqtt_qosLevel_t qosIn, size_t payloadSize_bytesIn)
+{
+	// variable header (topic length + topic + packet id for qos > 0) and payload
+	size_t remainingLength = 2 + topicLenIn + ((qosIn != CXA_MQTT_QOS_ATMOST_ONCE) ? 2 : 0) + payloadSize_bytesIn;
+
+	// fixed header: control byte + variable length encoding of the above
+	size_t numLengthBytes = 1;
+	for( size_t currLength = remainingLength; currLength > 127; currLength /= 128 ) numLengthBytes++;
+
+	return 1 + numLengthBytes + remainingLength;
+}
+
+
+static uint32_t keepAliveRand(void)
+{
+	// deterministic so a run can be reproduced
+	keepAlive_lcgState = (keepAlive_lcgState * 1103515245) + 12345;
+	return keepAlive_lcgState >> 16;
+}
@@ -0,0 +1,132 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <cxa_nvsManager.h>
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_assert.h>
+
+#include "stubHal_internal.h"
+
+
+// ******** local macro definitions ********
+#define KEY_MAXLEN						15
+#define MAXNUM_KEYS						256
+#define BLOB_MAXSIZE_BYTES				4000
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	char key[KEY_MAXLEN+1];
+	uint8_t value[BLOB_MAXSIZE_BYTES];
+	size_t size_bytes;
+}nvsEntry_t;
+
+
+// ******** local function prototypes ********
+static nvsEntry_t* getEntry(const char *const keyIn, bool shouldCreateIn);
+
+
+// ********  local variable declarations *********
+static nvsEntry_t entries[MAXNUM_KEYS];
+static size_t numEntries;
+
+
+// ******** global function implementations ********
+void stubHal_internal_resetNvs(void)
+{
+	numEntries = 0;
+}
+
+
+bool cxa_nvsManager_get_uint32(const char *const keyIn, uint32_t *const valueOut)
+{
+	cxa_assert(valueOut);
+
+	nvsEntry_t* entry = getEntry(keyIn, false);
+	if( (entry == NULL) || (entry->size_bytes != sizeof(*valueOut)) ) return false;
+
+	memcpy(valueOut, entry->value, sizeof(*valueOut));
+	return true;
+}
+
+
+bool cxa_nvsManager_set_uint32(const char *const keyIn, uint32_t valueIn)
+{
+	nvsEntry_t* entry = getEntry(keyIn, true);
+	if( entry == NULL ) return false;
+
+	memcpy(entry->value, &valueIn, sizeof(valueIn));
+	entry->size_bytes = sizeof(valueIn);
+	return true;
+}
+
+
+bool cxa_nvsManager_get_blob(const char *const keyIn, uint8_t *const valueOut, size_t maxOutputSize_bytesIn, size_t *const actualOutputSize_bytesOut)
+{
+	cxa_assert(valueOut);
+
+	nvsEntry_t* entry = getEntry(keyIn, false);
+	if( (entry == NULL) || (entry->size_bytes > maxOutputSize_bytesIn) ) return false;
+
+	memcpy(valueOut, entry->value, entry->size_bytes);
+	if( actualOutputSize_bytesOut != NULL ) *actualOutputSize_bytesOut = entry->size_bytes;
+	return true;
+}
+
+
+bool cxa_nvsManager_set_blob(const char *const keyIn, uint8_t *const valueIn, size_t blobSize_bytesIn)
+{
+	cxa_assert(valueIn || (blobSize_bytesIn == 0));
+
+	// same limit as a single esp32 nvs blob page
+	if( blobSize_bytesIn > BLOB_MAXSIZE_BYTES ) return false;
+
+	nvsEntry_t* entry = getEntry(keyIn, true);
+	if( entry == NULL ) return false;
+
+	memcpy(entry->value, valueIn, blobSize_bytesIn);
+	entry->size_bytes = blobSize_bytesIn;
+	return true;
+}
+
+
+bool cxa_nvsManager_commit(void)
+{
+	return true;
+}
+
+
+// ******** local function implementations ********
+static nvsEntry_t* getEntry(const char *const keyIn, bool shouldCreateIn)
+{
+	cxa_assert(keyIn);
+	cxa_assert_msg(strlen(keyIn) <= KEY_MAXLEN, "nvs key too long");
+
+	for( size_t i = 0; i < numEntries; i++ )
+	{
+		if( strcmp(entries[i].key, keyIn) == 0 ) return &entries[i];
+	}
+	if( !shouldCreateIn || (numEntries == MAXNUM_KEYS) ) return NULL;
+
+	nvsEntry_t* newEntry = &entries[numEntries++];
+	strcpy(newEntry->key, keyIn);
+	newEntry->size_bytes = 0;
+	return newEntry;
+}
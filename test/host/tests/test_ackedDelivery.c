@@ -0,0 +1,308 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_mqtt_rpc_node.h>
+#include <stubHal.h>
+
+#include <ovr_publishScheduler.h>
+
+
+// ******** local macro definitions ********
+#define THREADID_NETWORK				1
+
+#define NODE_NAME						"beacons"
+#define NOTI_NAME						"onBeaconPresence"
+
+#define ACKED_CLASSES					(1 << OVR_PUBLISHSCHEDULER_CLASS_PRESENCE)
+
+#define BENCH_NUMMESSAGES				200
+#define BENCH_KEEPALIVE_MS				100
+#define BENCH_PINGRESPDELAY_MS			20
+#define BENCH_PINGRESPJITTER_MS			20
+#define BENCH_ACKTIMEOUT_MS				500
+#define BENCH_MAXDURATION_MS			(5 * 60 * 1000)
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	uint32_t elapsed_ms;
+	size_t numDone;
+	size_t numDelivered;				///< distinct messages the broker received
+	size_t numPublishes;
+	size_t numResends;					///< publishes of a message the broker already had
+}benchResult_t;
+
+
+// ******** local function prototypes ********
+static void setupScheduler(uint8_t ackedClassMaskIn, size_t windowSizeIn, uint32_t ackTimeout_msIn);
+static bool publishNumbered(ovr_publishScheduler_class_t classIn, unsigned int numberIn);
+static void runBench(size_t windowSizeIn, uint8_t lossPcntIn, benchResult_t *const resultOut);
+
+static void cb_onDone(bool wasPublishedIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+static cxa_mqtt_rpc_node_t node;
+
+static size_t numDone;
+static size_t numDonePublished;
+
+
+// ******** global function implementations ********
+static void test_ackedClassIsReleasedByKeepAlive(void)
+{
+	setupScheduler(ACKED_CLASSES, 4, 10000);
+	stubHal_mqtt_setKeepAlive(1000, 100, 0, 0);
+
+	TEST_ASSERT(publishNumbered(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE, 1));
+	TEST_ASSERT(publishNumbered(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, 2));
+	stubHal_iterateAll();
+
+	TEST_ASSERT_EQUAL_INT(2, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_QOS_ATLEAST_ONCE, stubHal_getPublication(0)->qos);
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_QOS_ATMOST_ONCE, stubHal_getPublication(1)->qos);
+
+	// telemetry is gone as soon as it's sent, presence waits for the second PINGRESP
+	TEST_ASSERT_EQUAL_INT(1, numDone);
+	TEST_ASSERT_EQUAL_INT(1, ovr_publishScheduler_getClassStats(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE).depth);
+	stubHal_run_ms(1500, 10);
+	TEST_ASSERT_EQUAL_INT(1, stubHal_mqtt_getNumPingResps());
+	TEST_ASSERT_EQUAL_INT(1, numDone);
+
+	stubHal_run_ms(700, 10);
+	TEST_ASSERT_EQUAL_INT(2, stubHal_mqtt_getNumPingResps());
+	TEST_ASSERT_EQUAL_INT(2, numDone);
+	TEST_ASSERT_EQUAL_INT(2, numDonePublished);
+	TEST_ASSERT_EQUAL_INT(0, ovr_publishScheduler_getClassStats(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE).depth);
+	TEST_ASSERT_EQUAL_INT(2, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getCriticalSectionDepth());
+}
+
+
+static void test_pingRespToEarlierPingReqDoesNotConfirm(void)
+{
+	setupScheduler(ACKED_CLASSES, 4, 10000);
+	stubHal_mqtt_setKeepAlive(1000, 500, 0, 0);
+
+	// a PINGREQ goes out at 1000ms and is answered at 1500ms...publish in between
+	stubHal_run_ms(1200, 10);
+	TEST_ASSERT(publishNumbered(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE, 1));
+	stubHal_run_ms(400, 10);
+	TEST_ASSERT_EQUAL_INT(1, stubHal_mqtt_getNumPingResps());
+	TEST_ASSERT_EQUAL_INT(0, numDone);
+
+	// the next one was sent after it
+	stubHal_run_ms(1000, 10);
+	TEST_ASSERT_EQUAL_INT(2, stubHal_mqtt_getNumPingResps());
+	TEST_ASSERT_EQUAL_INT(1, numDonePublished);
+}
+
+
+static void test_unconfirmedIsResentOnTimeout(void)
+{
+	setupScheduler(ACKED_CLASSES, 4, 2500);
+	stubHal_mqtt_setKeepAlive(500, 50, 0, 100);
+
+	TEST_ASSERT(publishNumbered(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE, 1));
+	stubHal_run_ms(2400, 10);
+	TEST_ASSERT_EQUAL_INT(1, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT(0, stubHal_mqtt_getNumPingResps());
+	TEST_ASSERT_EQUAL_INT(0, numDone);
+
+	// the ack timeout brings it back around
+	stubHal_mqtt_setKeepAlive(500, 50, 0, 0);
+	stubHal_run_ms(200, 10);
+	TEST_ASSERT_EQUAL_INT(2, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT(0, numDone);
+
+	stubHal_run_ms(1200, 10);
+	TEST_ASSERT_EQUAL_INT(1, numDonePublished);
+	TEST_ASSERT_EQUAL_INT(2, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT(1, ovr_publishScheduler_getClassStats(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE).numPublished);
+}
+
+
+static void test_unconfirmedIsResentOnReconnect(void)
+{
+	setupScheduler(ACKED_CLASSES, 4, 60000);
+	stubHal_mqtt_setKeepAlive(1000, 100, 0, 0);
+
+	TEST_ASSERT(publishNumbered(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE, 1));
+	stubHal_iterateAll();
+	TEST_ASSERT_EQUAL_INT(1, stubHal_getNumPublications());
+
+	// dropped before the keepalive could confirm it
+	stubHal_run_ms(500, 10);
+	stubHal_mqtt_setConnected(false);
+	stubHal_run_ms(2000, 10);
+	TEST_ASSERT_EQUAL_INT(1, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT(0, stubHal_mqtt_getNumPingResps());
+	TEST_ASSERT_EQUAL_INT(0, numDone);
+
+	// resent as soon as it's back (well before the ack timeout)
+	stubHal_mqtt_setConnected(true);
+	stubHal_iterateAll();
+	TEST_ASSERT_EQUAL_INT(2, stubHal_getNumPublications());
+
+	stubHal_run_ms(2200, 10);
+	TEST_ASSERT_EQUAL_INT(1, numDonePublished);
+	TEST_ASSERT_EQUAL_INT(2, stubHal_getNumPublications());
+}
+
+
+static void test_fullWindowHoldsBackAckedClassesOnly(void)
+{
+	setupScheduler(ACKED_CLASSES, 2, 60000);
+	stubHal_mqtt_setKeepAlive(1000, 100, 0, 0);
+
+	for( unsigned int i = 0; i < 3; i++ ) TEST_ASSERT(publishNumbered(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE, i));
+	TEST_ASSERT(publishNumbered(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, 3));
+	stubHal_iterateAll();
+
+	// two presence in flight, the third waits but telemetry goes
+	TEST_ASSERT_EQUAL_INT(3, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT(1, stubHal_countPublications(NOTI_NAME "Telemetry"));
+
+	// confirming the first two makes room
+	stubHal_run_ms(1500, 10);
+	TEST_ASSERT_EQUAL_INT(3, stubHal_getNumPublications());
+	stubHal_run_ms(700, 10);
+	TEST_ASSERT_EQUAL_INT(4, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT(3, numDonePublished);
+	stubHal_run_ms(2000, 10);
+	TEST_ASSERT_EQUAL_INT(4, numDonePublished);
+}
+
+
+static void test_throughputByWindowSize(void)
+{
+	static const uint8_t lossPcnts[] = { 0, 5, 20 };
+	static const size_t windowSizes[] = { 1, 2, 4, 8, 16 };
+
+	for( size_t i = 0; i < sizeof(lossPcnts); i++ )
+	{
+		uint32_t prevThroughput = 0;
+		for( size_t j = 0; j < (sizeof(windowSizes) / sizeof(*windowSizes)); j++ )
+		{
+			benchResult_t result;
+			runBench(windowSizes[j], lossPcnts[i], &result);
+
+			// everything reaches the broker at least once and is released only once confirmed
+			TEST_ASSERT_EQUAL_INT(BENCH_NUMMESSAGES, result.numDone);
+			TEST_ASSERT_EQUAL_INT(BENCH_NUMMESSAGES, result.numDelivered);
+			TEST_ASSERT_EQUAL_INT(BENCH_NUMMESSAGES, numDonePublished);
+			if( lossPcnts[i] == 0 ) TEST_ASSERT_EQUAL_INT(0, result.numResends);
+
+			uint32_t throughput = (BENCH_NUMMESSAGES * 1000) / result.elapsed_ms;
+			char key[32];
+			snprintf(key, sizeof(key), "loss%d_window%d_msgsPerSec", lossPcnts[i], (int)windowSizes[j]);
+			testRunner_report("ackedDelivery", key, throughput);
+			snprintf(key, sizeof(key), "loss%d_window%d_resends", lossPcnts[i], (int)windowSizes[j]);
+			testRunner_report("ackedDelivery", key, result.numResends);
+
+			// a bigger window keeps more of the round trip busy
+			if( lossPcnts[i] == 0 ) TEST_ASSERT(throughput > prevThroughput);
+			prevThroughput = throughput;
+		}
+	}
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_ackedClassIsReleasedByKeepAlive),
+	TESTRUNNER_TEST(test_pingRespToEarlierPingReqDoesNotConfirm),
+	TESTRUNNER_TEST(test_unconfirmedIsResentOnTimeout),
+	TESTRUNNER_TEST(test_unconfirmedIsResentOnReconnect),
+	TESTRUNNER_TEST(test_fullWindowHoldsBackAckedClassesOnly),
+	TESTRUNNER_TEST(test_throughputByWindowSize),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupScheduler(uint8_t ackedClassMaskIn, size_t windowSizeIn, uint32_t ackTimeout_msIn)
+{
+	cxa_mqtt_rpc_node_t* rootNode = stubHal_getRootNode();
+	ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+	cxa_mqtt_rpc_node_init_formattedString(&node, rootNode, NODE_NAME);
+
+	// only the window and the broker limit throughput
+	ovr_publishScheduler_setShaping(0, 0);
+	TEST_ASSERT(ovr_publishScheduler_setDelivery(ackedClassMaskIn, windowSizeIn, ackTimeout_msIn));
+
+	numDone = 0;
+	numDonePublished = 0;
+}
+
+
+static bool publishNumbered(ovr_publishScheduler_class_t classIn, unsigned int numberIn)
+{
+	char payload[32];
+	int payloadLen = snprintf(payload, sizeof(payload), "{\"n\":%u}", numberIn);
+
+	return ovr_publishScheduler_publish_withCallback(&node, (classIn == OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY) ? NOTI_NAME "Telemetry" : NOTI_NAME,
+													 classIn, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, payload, payloadLen, cb_onDone, NULL);
+}
+
+
+static void runBench(size_t windowSizeIn, uint8_t lossPcntIn, benchResult_t *const resultOut)
+{
+	stubHal_reset();
+	setupScheduler(ACKED_CLASSES, windowSizeIn, BENCH_ACKTIMEOUT_MS);
+	stubHal_mqtt_setKeepAlive(BENCH_KEEPALIVE_MS, BENCH_PINGRESPDELAY_MS, BENCH_PINGRESPJITTER_MS, lossPcntIn);
+
+	// the producer keeps the queue topped up
+	unsigned int numQueued = 0;
+	uint32_t elapsed_ms = 0;
+	for( ; (numDone < BENCH_NUMMESSAGES) && (elapsed_ms < BENCH_MAXDURATION_MS); elapsed_ms++ )
+	{
+		while( (numQueued < BENCH_NUMMESSAGES) && publishNumbered(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE, numQueued) ) numQueued++;
+		stubHal_run_ms(1, 1);
+	}
+
+	static bool isDelivered[BENCH_NUMMESSAGES];
+	memset(isDelivered, 0, sizeof(isDelivered));
+	memset(resultOut, 0, sizeof(*resultOut));
+	for( size_t i = 0; i < stubHal_getNumPublications(); i++ )
+	{
+		stubHal_publication_t* currPub = stubHal_getPublication(i);
+		unsigned int number;
+		TEST_ASSERT(sscanf((char*)currPub->payload, "{\"n\":%u}", &number) == 1);
+		TEST_ASSERT(number < BENCH_NUMMESSAGES);
+
+		if( isDelivered[number] ) resultOut->numResends++;
+		else resultOut->numDelivered++;
+		isDelivered[number] = true;
+	}
+	resultOut->elapsed_ms = elapsed_ms;
+	resultOut->numDone = numDone;
+	resultOut->numPublishes = stubHal_getNumPublications();
+}
+
+
+static void cb_onDone(bool wasPublishedIn, void* userVarIn)
+{
+	numDone++;
+	if( wasPublishedIn ) numDonePublished++;
+}
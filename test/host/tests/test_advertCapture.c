@@ -0,0 +1,345 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <cxa_btle_client.h>
+#include <cxa_ioStream.h>
+#include <stubHal.h>
+
+#include <ovr_advertCapture.h>
+#include <ovr_beaconManager.h>
+#include <ovr_config.h>
+#include <ovr_publishScheduler.h>
+
+
+// ******** local macro definitions ********
+#define COMPANY_ID						0x04A2
+#define UNIX_TIME						1500000000
+
+// as ovr_beaconGateway runs them
+#define THREADID_NETWORK				1
+#define THREADID_BLUETOOTH				3
+
+#define ADVERT_SIZE_BYTES				15
+#define MAXSIZE_DUMP_BYTES				4096
+
+// a busy hall: every tag advertising about once a second, plus some
+// adverts that carry our company id but don't parse
+#define HALL_NUMTAGS					300
+#define HALL_DURATION_MS				30000
+#define HALL_INTERVAL_MS				1000
+#define HALL_NOISE_PCNT					10
+#define HALL_MAXNUM_BEACONS				320
+#define HALL_RXFIFO_SIZE_ELEMS			32
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void setupPipeline(void);
+static void makeAdvert(uint16_t tagIdIn, uint8_t *const advertOut);
+static size_t buildHallTrace(void);
+static uint32_t nextRandom(void);
+
+static double getTime_s(void);
+
+static bool ioCb_writeBytes(void* buffIn, size_t bufferSize_bytesIn, void *const userVarIn);
+
+
+// ********  local variable declarations *********
+static cxa_btle_client_t btleClient;
+static ovr_beaconManager_t beaconManager;
+static ovr_advertCapture_t capture;
+
+static char dump[MAXSIZE_DUMP_BYTES];
+static size_t dumpSize_bytes;
+
+static uint32_t randomState;
+
+
+// ******** global function implementations ********
+static void test_capturesWhatTheRadioHears(void)
+{
+	setupPipeline();
+	ovr_advertCapture_start(&capture);
+
+	uint8_t advert[ADVERT_SIZE_BYTES];
+	for( int i = 0; i < 3; i++ )
+	{
+		if( i > 0 ) stubHal_run_ms(100, 10);
+		makeAdvert(i, advert);
+		TEST_ASSERT(stubHal_btle_injectManData(&btleClient, -60 - i, COMPANY_ID, advert, sizeof(advert)));
+		stubHal_iterateAll();
+	}
+
+	// other manufacturers never reach the manager
+	TEST_ASSERT(stubHal_btle_injectManData(&btleClient, -50, 0x004C, advert, sizeof(advert)));
+	stubHal_iterateAll();
+
+	ovr_advertCapture_stop(&capture);
+	TEST_ASSERT_EQUAL_INT(3, ovr_advertCapture_getNumRecords(&capture));
+
+	// stopped...nothing more is recorded
+	TEST_ASSERT(stubHal_btle_injectManData(&btleClient, -60, COMPANY_ID, advert, sizeof(advert)));
+	stubHal_iterateAll();
+	TEST_ASSERT_EQUAL_INT(3, ovr_advertCapture_getNumRecords(&capture));
+
+	cxa_ioStream_t ioStream;
+	cxa_ioStream_init(&ioStream);
+	cxa_ioStream_bind(&ioStream, NULL, ioCb_writeBytes, NULL);
+	ovr_advertCapture_dump(&capture, &ioStream);
+
+	// header, then [rxTime LE][rssi][numBytes][data] per record
+	char* firstLine = dump;
+	char* secondRecord = strstr(dump, "\r\n") + 2;
+	secondRecord = strstr(secondRecord, "\r\n") + 2;
+	TEST_ASSERT(strncmp(firstLine, "ovrCapture v1 3\r\n", 17) == 0);
+	TEST_ASSERT(strncmp(&firstLine[17], "00000000C40F00001122330000", 26) == 0);
+	TEST_ASSERT(strncmp(secondRecord, "64000000C30F00001122330001", 26) == 0);
+}
+
+
+static void test_ringKeepsNewestRecords(void)
+{
+	setupPipeline();
+	ovr_advertCapture_start(&capture);
+
+	// well past the ring's capacity
+	uint8_t advert[ADVERT_SIZE_BYTES];
+	size_t recordSize_bytes = OVR_ADVERTCAPTURE_RECORDHEADER_SIZE_BYTES + sizeof(advert);
+	size_t bufferSize_bytes = ovr_memArena_getUsed_bytes(ovr_advertCapture_getMemArena(&capture));
+	uint32_t numAdded = (2 * bufferSize_bytes) / recordSize_bytes;
+	for( uint32_t i = 0; i < numAdded; i++ )
+	{
+		makeAdvert(i, advert);
+		TEST_ASSERT(ovr_advertCapture_addRecord(&capture, i, -70, advert, sizeof(advert)));
+	}
+
+	uint32_t numKept = ovr_advertCapture_getNumRecords(&capture);
+	TEST_ASSERT(numKept < numAdded);
+	TEST_ASSERT(numKept >= ((bufferSize_bytes / recordSize_bytes) - 1));
+
+	// oversized adverts are refused rather than truncated
+	uint8_t oversized[OVR_ADVERTCAPTURE_MAXDATA_SIZE_BYTES + 1] = {0};
+	TEST_ASSERT(!ovr_advertCapture_addRecord(&capture, numAdded, -70, oversized, sizeof(oversized)));
+
+	// replaying the lot (at max speed) sees only the newest, in order
+	TEST_ASSERT(ovr_advertCapture_startReplay(&capture, OVR_ADVERTCAPTURE_SPEED_MAX));
+	TEST_ASSERT(!ovr_advertCapture_addRecord(&capture, numAdded, -70, advert, sizeof(advert)));
+	while( ovr_advertCapture_isReplaying(&capture) ) stubHal_iterateAll();
+
+	ovr_advertCapture_replayReport_t report = ovr_advertCapture_getLastReplayReport(&capture);
+	TEST_ASSERT_EQUAL_INT(numKept, report.numRecords);
+	TEST_ASSERT_EQUAL_INT(numKept, report.numInjected + report.numRejected);
+}
+
+
+static void test_replayFollowsCaptureTime(void)
+{
+	setupPipeline();
+	ovr_advertCapture_start(&capture);
+
+	// one advert a second for 10 seconds
+	uint8_t advert[ADVERT_SIZE_BYTES];
+	makeAdvert(1, advert);
+	for( uint32_t i = 0; i < 10; i++ )
+	{
+		TEST_ASSERT(ovr_advertCapture_addRecord(&capture, 5000 + (i * 1000), -60, advert, sizeof(advert)));
+	}
+
+	// at 10x, the first 5 seconds of capture take half a second
+	TEST_ASSERT(ovr_advertCapture_startReplay(&capture, 10));
+	TEST_ASSERT(ovr_advertCapture_isReplaying(&capture));
+	stubHal_run_ms(450, 10);
+	TEST_ASSERT(ovr_advertCapture_isReplaying(&capture));
+	TEST_ASSERT_EQUAL_INT(5, ovr_advertCapture_getLastReplayReport(&capture).numInjected);
+
+	stubHal_run_ms(500, 10);
+	TEST_ASSERT(!ovr_advertCapture_isReplaying(&capture));
+
+	ovr_advertCapture_replayReport_t report = ovr_advertCapture_getLastReplayReport(&capture);
+	TEST_ASSERT_EQUAL_INT(10, report.numInjected);
+	TEST_ASSERT_EQUAL_INT(0, report.numRejected);
+	TEST_ASSERT_EQUAL_INT(10, report.pipeline.numAdvertsRx);
+	TEST_ASSERT(report.duration_ms >= 900);
+	TEST_ASSERT(report.duration_ms <= 910);
+}
+
+
+static void test_replayHallTrace(void)
+{
+	static const uint16_t speeds[] = {1, 10, OVR_ADVERTCAPTURE_SPEED_MAX};
+
+	for( size_t i = 0; i < (sizeof(speeds) / sizeof(*speeds)); i++ )
+	{
+		// size the manager for the hall (capacities are picked up at boot)
+		stubHal_reset();
+		setupPipeline();
+		ovr_beaconManager_capacities_t caps = ovr_beaconManager_getCapacities(&beaconManager);
+		caps.maxNumBeacons = HALL_MAXNUM_BEACONS;
+		caps.rxFifoSize_elems = HALL_RXFIFO_SIZE_ELEMS;
+		TEST_ASSERT(ovr_beaconManager_saveCapacities(&beaconManager, caps));
+		stubHal_reboot();
+		setupPipeline();
+		stubHal_setUnixTime(UNIX_TIME);
+		TEST_ASSERT_EQUAL_INT(HALL_RXFIFO_SIZE_ELEMS, ovr_beaconManager_getCapacities(&beaconManager).rxFifoSize_elems);
+
+		size_t numNoise = buildHallTrace();
+		size_t numRecords = ovr_advertCapture_getNumRecords(&capture);
+
+		double startTime_s = getTime_s();
+		TEST_ASSERT(ovr_advertCapture_startReplay(&capture, speeds[i]));
+		while( ovr_advertCapture_isReplaying(&capture) ) stubHal_run_ms(1, 1);
+		double cpuTime_s = getTime_s() - startTime_s;
+
+		ovr_advertCapture_replayReport_t report = ovr_advertCapture_getLastReplayReport(&capture);
+		TEST_ASSERT_EQUAL_INT(numRecords, report.numInjected + report.numRejected);
+		TEST_ASSERT(report.numRejected >= numNoise);
+		TEST_ASSERT_EQUAL_INT(numRecords, report.pipeline.numAdvertsRx);
+		// real time is paced by the capture, max speed by the fifo...neither drops
+		if( speeds[i] != 10 ) TEST_ASSERT_EQUAL_INT(0, report.pipeline.numAdvertsDropped);
+
+		uint32_t numProcessed = (report.pipeline.numUpdatesProcessed > 0) ? report.pipeline.numUpdatesProcessed : 1;
+		char key[32];
+		if( speeds[i] == OVR_ADVERTCAPTURE_SPEED_MAX ) strcpy(key, "speedMax_");
+		else snprintf(key, sizeof(key), "speed%dx_", speeds[i]);
+		char* keyEnd = &key[strlen(key)];
+
+		strcpy(keyEnd, "numAdverts");
+		testRunner_report("advertReplay", key, report.numRecords);
+		strcpy(keyEnd, "numDropped");
+		testRunner_report("advertReplay", key, report.pipeline.numAdvertsDropped);
+		strcpy(keyEnd, "numRejected");
+		testRunner_report("advertReplay", key, report.numRejected);
+		strcpy(keyEnd, "duration_ms");
+		testRunner_report("advertReplay", key, report.duration_ms);
+		strcpy(keyEnd, "queueLatencyAvg_us");
+		testRunner_report("advertReplay", key, (double)report.pipeline.queueLatency_total_us / numProcessed);
+		strcpy(keyEnd, "queueLatencyMax_us");
+		testRunner_report("advertReplay", key, report.pipeline.queueLatency_max_us);
+		// the virtual clock doesn't move while the manager works, so cpu is host wall-clock
+		strcpy(keyEnd, "cpuPerAdvert_us");
+		testRunner_report("advertReplay", key, (cpuTime_s * 1e6) / numRecords);
+	}
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_capturesWhatTheRadioHears),
+	TESTRUNNER_TEST(test_ringKeepsNewestRecords),
+	TESTRUNNER_TEST(test_replayFollowsCaptureTime),
+	TESTRUNNER_TEST(test_replayHallTrace),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupPipeline(void)
+{
+	cxa_mqtt_rpc_node_t* rootNode = stubHal_getRootNode();
+
+	ovr_config_init(rootNode);
+	ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+
+	stubHal_btle_init(&btleClient);
+	ovr_beaconManager_init(&beaconManager, &btleClient, rootNode, THREADID_BLUETOOTH, THREADID_NETWORK);
+	ovr_advertCapture_init(&capture, &beaconManager, THREADID_BLUETOOTH);
+	stubHal_btle_setReady(&btleClient);
+	stubHal_iterateAll();
+
+	dumpSize_bytes = 0;
+	memset(dump, 0, sizeof(dump));
+}
+
+
+static void makeAdvert(uint16_t tagIdIn, uint8_t *const advertOut)
+{
+	uint8_t advert[ADVERT_SIZE_BYTES] =
+	{
+		0x00,									// devType
+		0x00, 0x11, 0x22, 0x33, (uint8_t)(tagIdIn >> 8), (uint8_t)tagIdIn,	// eui48
+		0x00,									// status
+		80,										// battery %
+		0xE1, 0x00,								// 22.5degC
+		0x40,									// light
+		0x00,									// accel status
+		0x0C, 0x0E								// 3596mV
+	};
+	memcpy(advertOut, advert, sizeof(advert));
+}
+
+
+static size_t buildHallTrace(void)
+{
+	randomState = 1;
+	ovr_advertCapture_start(&capture);
+
+	// each tag advertises in a random 10ms slot, HALL_INTERVAL_MS apart on average
+	size_t numNoise = 0;
+	for( uint32_t currTime_ms = 0; currTime_ms < HALL_DURATION_MS; currTime_ms += 10 )
+	{
+		for( uint16_t tagId = 0; tagId < HALL_NUMTAGS; tagId++ )
+		{
+			if( (nextRandom() % (HALL_INTERVAL_MS / 10)) != 0 ) continue;
+
+			uint8_t advert[ADVERT_SIZE_BYTES];
+			makeAdvert(tagId, advert);
+			int8_t rssi_dBm = -50 - (int8_t)(nextRandom() % 45);
+
+			bool isNoise = (nextRandom() % 100) < HALL_NOISE_PCNT;
+			TEST_ASSERT(ovr_advertCapture_addRecord(&capture, currTime_ms, rssi_dBm, advert, isNoise ? 3 : sizeof(advert)));
+			if( isNoise ) numNoise++;
+		}
+	}
+
+	ovr_advertCapture_stop(&capture);
+	return numNoise;
+}
+
+
+static uint32_t nextRandom(void)
+{
+	randomState = (randomState * 1103515245) + 12345;
+	return (randomState >> 16) & 0x7FFF;
+}
+
+
+static double getTime_s(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+
+static bool ioCb_writeBytes(void* buffIn, size_t bufferSize_bytesIn, void *const userVarIn)
+{
+	// keep the start of the dump (the tests only look at the first few lines)
+	size_t numToCopy = sizeof(dump) - 1 - dumpSize_bytes;
+	if( numToCopy > bufferSize_bytesIn ) numToCopy = bufferSize_bytesIn;
+
+	memcpy(&dump[dumpSize_bytes], buffIn, numToCopy);
+	dumpSize_bytes += numToCopy;
+	return true;
+}
@@ -0,0 +1,311 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_btle_client.h>
+#include <stubHal.h>
+
+#include <ovr_beaconManager.h>
+#include <ovr_beaconProxy.h>
+#include <ovr_config.h>
+
+
+// ******** local macro definitions ********
+#define COMPANY_ID						0x04A2
+#define THREADID_BLUETOOTH				3
+
+#define NEWCOMER_ID						0xF0
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void setupManager(ovr_beaconManager_evictPolicy_t policyIn);
+static void fillTable(int8_t rssi_dBmIn);
+static void injectAdvert(uint8_t idIn, int8_t rssi_dBmIn);
+static void hearBeacon(uint8_t idIn, int8_t rssi_dBmIn);
+static bool isKnown(uint8_t idIn);
+static void assertIndexIsSorted(void);
+static uint32_t nextRandom(void);
+
+static void beaconCb_onLost(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+static cxa_btle_client_t btleClient;
+static ovr_beaconManager_t beaconManager;
+
+static size_t maxNumBeacons;
+static uint32_t numLost;
+static uint8_t lastLostId;
+static uint32_t randomState;
+
+
+// ******** global function implementations ********
+static void test_weakestIsEvictedForStrongerNewcomer(void)
+{
+	setupManager(OVR_BEACONMANAGER_EVICTPOLICY_WEAKEST);
+
+	// -60, -61, ... so id 0 is the strongest
+	for( size_t i = 0; i < maxNumBeacons; i++ ) hearBeacon(i, -60 - i);
+	int8_t weakestRssi = -60 - (maxNumBeacons - 1);
+
+	hearBeacon(NEWCOMER_ID, weakestRssi + OVR_BEACONMANAGER_EVICT_MINRSSIMARGIN_DBM);
+
+	TEST_ASSERT_EQUAL_INT(1, numLost);
+	TEST_ASSERT_EQUAL_INT(maxNumBeacons - 1, lastLostId);
+	TEST_ASSERT(isKnown(NEWCOMER_ID));
+	TEST_ASSERT_EQUAL_INT(1, ovr_beaconManager_getAdmissionStats(&beaconManager).numEvictions);
+	assertIndexIsSorted();
+}
+
+
+static void test_weakestNeedsMargin(void)
+{
+	setupManager(OVR_BEACONMANAGER_EVICTPOLICY_WEAKEST);
+	fillTable(-70);
+
+	// not clearly stronger...don't churn
+	hearBeacon(NEWCOMER_ID, -70 + OVR_BEACONMANAGER_EVICT_MINRSSIMARGIN_DBM - 1);
+
+	TEST_ASSERT_EQUAL_INT(0, numLost);
+	TEST_ASSERT(!isKnown(NEWCOMER_ID));
+	TEST_ASSERT(ovr_beaconManager_getAdmissionStats(&beaconManager).numRejected > 0);
+	TEST_ASSERT_EQUAL_INT(0, ovr_beaconManager_getAdmissionStats(&beaconManager).numEvictions);
+}
+
+
+static void test_weakestIgnoresSingleFade(void)
+{
+	setupManager(OVR_BEACONMANAGER_EVICTPOLICY_WEAKEST);
+
+	// everyone settles, id 0 is comfortably the strongest
+	for( int round = 0; round < 20; round++ )
+	{
+		for( size_t i = 0; i < maxNumBeacons; i++ )
+		{
+			injectAdvert(i, (i == 0) ? -55 : -70);
+			stubHal_iterateAll();
+		}
+		stubHal_run_ms(1000, 10);
+	}
+
+	// ...then one of its adverts fades badly
+	injectAdvert(0, -95);
+	stubHal_iterateAll();
+	TEST_ASSERT(ovr_beaconProxy_getSmoothedRssi((ovr_beaconProxy_t*)cxa_array_get(ovr_beaconManager_getKnownBeacons(&beaconManager), 0)) > -70);
+
+	hearBeacon(NEWCOMER_ID, -60);
+
+	TEST_ASSERT_EQUAL_INT(1, numLost);
+	TEST_ASSERT(lastLostId != 0);
+	TEST_ASSERT(isKnown(0));
+	assertIndexIsSorted();
+}
+
+
+static void test_indexStaysSortedUnderChurn(void)
+{
+	setupManager(OVR_BEACONMANAGER_EVICTPOLICY_WEAKEST);
+	fillTable(-70);
+
+	for( int i = 0; i < 5000; i++ )
+	{
+		injectAdvert(nextRandom() % maxNumBeacons, -40 - (int8_t)(nextRandom() % 60));
+		stubHal_iterateAll();
+	}
+	assertIndexIsSorted();
+
+	// and after removals shift everything around
+	hearBeacon(NEWCOMER_ID, -30);
+	hearBeacon(NEWCOMER_ID + 1, -30);
+	TEST_ASSERT_EQUAL_INT(2, numLost);
+	assertIndexIsSorted();
+}
+
+
+static void test_stalestIsEvictedOnceQuiet(void)
+{
+	setupManager(OVR_BEACONMANAGER_EVICTPOLICY_STALEST);
+	fillTable(-70);
+
+	// everyone is recent...nobody to evict
+	hearBeacon(NEWCOMER_ID, -50);
+	TEST_ASSERT_EQUAL_INT(0, numLost);
+	TEST_ASSERT(!isKnown(NEWCOMER_ID));
+
+	// id 3 goes quiet while everyone else keeps talking
+	for( uint32_t elapsed_ms = 0; elapsed_ms <= OVR_BEACONMANAGER_EVICT_MINSTALE_MS; elapsed_ms += 1000 )
+	{
+		for( size_t i = 0; i < maxNumBeacons; i++ )
+		{
+			if( i == 3 ) continue;
+			injectAdvert(i, -70);
+			stubHal_iterateAll();
+		}
+		stubHal_run_ms(1000, 10);
+	}
+
+	hearBeacon(NEWCOMER_ID, -90);
+	TEST_ASSERT_EQUAL_INT(1, numLost);
+	TEST_ASSERT_EQUAL_INT(3, lastLostId);
+	TEST_ASSERT(isKnown(NEWCOMER_ID));
+	assertIndexIsSorted();
+}
+
+
+static void test_noneDropsNewcomers(void)
+{
+	setupManager(OVR_BEACONMANAGER_EVICTPOLICY_NONE);
+	fillTable(-90);
+
+	hearBeacon(NEWCOMER_ID, -30);
+
+	TEST_ASSERT_EQUAL_INT(0, numLost);
+	TEST_ASSERT(!isKnown(NEWCOMER_ID));
+	TEST_ASSERT(ovr_beaconManager_getAdmissionStats(&beaconManager).numRejected > 0);
+}
+
+
+static void test_heldTableDefersEviction(void)
+{
+	setupManager(OVR_BEACONMANAGER_EVICTPOLICY_WEAKEST);
+	fillTable(-90);
+
+	// another thread walking the table...nothing may shift under it
+	TEST_ASSERT(ovr_beaconManager_holdKnownBeacons(&beaconManager));
+	hearBeacon(NEWCOMER_ID, -30);
+
+	TEST_ASSERT_EQUAL_INT(0, numLost);
+	TEST_ASSERT(!isKnown(NEWCOMER_ID));
+	TEST_ASSERT(ovr_beaconManager_getAdmissionStats(&beaconManager).numDeferred > 0);
+	TEST_ASSERT_EQUAL_INT(0, ovr_beaconManager_getAdmissionStats(&beaconManager).numEvictions);
+
+	// released...admitted as usual
+	ovr_beaconManager_releaseKnownBeacons(&beaconManager);
+	hearBeacon(NEWCOMER_ID, -30);
+
+	TEST_ASSERT_EQUAL_INT(1, numLost);
+	TEST_ASSERT(isKnown(NEWCOMER_ID));
+	assertIndexIsSorted();
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_weakestIsEvictedForStrongerNewcomer),
+	TESTRUNNER_TEST(test_weakestNeedsMargin),
+	TESTRUNNER_TEST(test_weakestIgnoresSingleFade),
+	TESTRUNNER_TEST(test_indexStaysSortedUnderChurn),
+	TESTRUNNER_TEST(test_stalestIsEvictedOnceQuiet),
+	TESTRUNNER_TEST(test_noneDropsNewcomers),
+	TESTRUNNER_TEST(test_heldTableDefersEviction),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupManager(ovr_beaconManager_evictPolicy_t policyIn)
+{
+	ovr_config_init(NULL);
+
+	stubHal_btle_init(&btleClient);
+	ovr_beaconManager_init(&beaconManager, &btleClient, NULL, THREADID_BLUETOOTH, THREADID_BLUETOOTH);
+	ovr_beaconManager_addListener(&beaconManager, NULL, NULL, beaconCb_onLost, NULL);
+	ovr_beaconManager_setEvictPolicy(&beaconManager, policyIn);
+	stubHal_btle_setReady(&btleClient);
+	stubHal_iterateAll();
+
+	maxNumBeacons = ovr_beaconManager_getCapacities(&beaconManager).maxNumBeacons;
+	TEST_ASSERT(maxNumBeacons < NEWCOMER_ID);
+	numLost = 0;
+	lastLostId = 0xFF;
+	randomState = 0x2545F491;
+}
+
+
+static void fillTable(int8_t rssi_dBmIn)
+{
+	for( size_t i = 0; i < maxNumBeacons; i++ ) hearBeacon(i, rssi_dBmIn);
+	TEST_ASSERT_EQUAL_INT(maxNumBeacons, cxa_array_getSize_elems(ovr_beaconManager_getKnownBeacons(&beaconManager)));
+}
+
+
+static void injectAdvert(uint8_t idIn, int8_t rssi_dBmIn)
+{
+	uint8_t advert[] = { 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, idIn, 0x00, 80, 0xE1, 0x00, 0x40, 0x00, 0x0C, 0x0E };
+	TEST_ASSERT(stubHal_btle_injectManData(&btleClient, rssi_dBmIn, COMPANY_ID, advert, sizeof(advert)));
+}
+
+
+static void hearBeacon(uint8_t idIn, int8_t rssi_dBmIn)
+{
+	for( int i = 0; i < OVR_BEACONMANAGER_FOUND_NUMADVERTS; i++ )
+	{
+		injectAdvert(idIn, rssi_dBmIn);
+		stubHal_run_ms(100, 10);
+	}
+}
+
+
+static bool isKnown(uint8_t idIn)
+{
+	cxa_array_iterate(ovr_beaconManager_getKnownBeacons(&beaconManager), currProxy, ovr_beaconProxy_t)
+	{
+		if( ovr_beaconProxy_getEui48(currProxy)->bytes[5] == idIn ) return true;
+	}
+	return false;
+}
+
+
+static void assertIndexIsSorted(void)
+{
+	cxa_array_t* knownBeacons = ovr_beaconManager_getKnownBeacons(&beaconManager);
+	size_t numProxies = cxa_array_getSize_elems(knownBeacons);
+
+	int8_t prevRssi = INT8_MIN;
+	for( size_t pos = 0; pos < numProxies; pos++ )
+	{
+		uint16_t proxyIndex = beaconManager.rssiIndex[pos];
+		TEST_ASSERT(proxyIndex < numProxies);
+		TEST_ASSERT_EQUAL_INT(pos, beaconManager.rssiIndexPos[proxyIndex]);
+
+		int8_t currRssi = ovr_beaconProxy_getSmoothedRssi((ovr_beaconProxy_t*)cxa_array_get(knownBeacons, proxyIndex));
+		TEST_ASSERT(currRssi >= prevRssi);
+		prevRssi = currRssi;
+	}
+}
+
+
+static uint32_t nextRandom(void)
+{
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+
+static void beaconCb_onLost(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn)
+{
+	numLost++;
+	lastLostId = ovr_beaconProxy_getEui48(beaconProxyIn)->bytes[5];
+}
@@ -0,0 +1,245 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <string.h>
+#include <time.h>
+
+#include <esp_heap_caps.h>
+#include <stubHal.h>
+
+#include <ovr_beaconFilter.h>
+
+
+// ******** local macro definitions ********
+#define EUI48_SIZE_BYTES				6
+
+#define BENCH_NUM_ENTRIES				10000
+#define BENCH_NUM_LOOKUPS				1000000
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void makeId(uint32_t seedIn, uint8_t *const bytesOut);
+static bool isAccepted(uint32_t seedIn);
+static size_t getNumAllocated_bytes(void);
+static double getTime_s(void);
+
+static void heapCb_checkDuringUpdate(void* userVarIn);
+
+
+// ********  local variable declarations *********
+static ovr_beaconFilter_t filter;
+static uint8_t rawEntries[BENCH_NUM_ENTRIES * EUI48_SIZE_BYTES];
+static int numChecksDuringUpdate;
+
+
+// ******** global function implementations ********
+static void test_disabledAcceptsEverything(void)
+{
+	ovr_beaconFilter_init(&filter);
+
+	TEST_ASSERT_EQUAL_INT(OVR_BEACONFILTER_MODE_DISABLED, ovr_beaconFilter_getMode(&filter));
+	TEST_ASSERT(isAccepted(1));
+
+	makeId(1, rawEntries);
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_DISABLED, rawEntries, 1, false));
+	TEST_ASSERT(isAccepted(1));
+	TEST_ASSERT(isAccepted(2));
+}
+
+
+static void test_allowAndDeny(void)
+{
+	ovr_beaconFilter_init(&filter);
+	for( uint32_t i = 0; i < 10; i++ ) makeId(i, &rawEntries[i * EUI48_SIZE_BYTES]);
+
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_ALLOW, rawEntries, 10, false));
+	TEST_ASSERT(isAccepted(0));
+	TEST_ASSERT(isAccepted(9));
+	TEST_ASSERT(!isAccepted(10));
+
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_DENY, rawEntries, 10, false));
+	TEST_ASSERT(!isAccepted(0));
+	TEST_ASSERT(!isAccepted(9));
+	TEST_ASSERT(isAccepted(10));
+}
+
+
+static void test_appendAndDedupe(void)
+{
+	ovr_beaconFilter_init(&filter);
+	for( uint32_t i = 0; i < 10; i++ ) makeId(i, &rawEntries[i * EUI48_SIZE_BYTES]);
+
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_ALLOW, rawEntries, 6, false));
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_ALLOW, &rawEntries[4 * EUI48_SIZE_BYTES], 6, true));
+
+	TEST_ASSERT_EQUAL_INT(10, ovr_beaconFilter_getNumEntries(&filter));
+	for( uint32_t i = 0; i < 10; i++ ) TEST_ASSERT(isAccepted(i));
+}
+
+
+static void test_tooManyKeepsCurrentList(void)
+{
+	ovr_beaconFilter_init(&filter);
+	makeId(1, rawEntries);
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_DENY, rawEntries, 1, false));
+
+	TEST_ASSERT(!ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_ALLOW, rawEntries, OVR_BEACONFILTER_MAXNUM_ENTRIES + 1, false));
+	TEST_ASSERT_EQUAL_INT(OVR_BEACONFILTER_MODE_DENY, ovr_beaconFilter_getMode(&filter));
+	TEST_ASSERT(!isAccepted(1));
+	TEST_ASSERT(isAccepted(2));
+}
+
+
+static void test_updateDoesNotDisturbReceivePath(void)
+{
+	ovr_beaconFilter_init(&filter);
+	makeId(1, rawEntries);
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_DENY, rawEntries, 1, false));
+
+	// adverts arriving part way through the next update still see the complete old list
+	numChecksDuringUpdate = 0;
+	stubHal_heap_setOnAlloc(heapCb_checkDuringUpdate, NULL);
+	for( uint32_t i = 0; i < 100; i++ ) makeId(i, &rawEntries[i * EUI48_SIZE_BYTES]);
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_ALLOW, rawEntries, 100, false));
+	stubHal_heap_setOnAlloc(NULL, NULL);
+	TEST_ASSERT(numChecksDuringUpdate > 0);
+
+	TEST_ASSERT(isAccepted(1));
+	TEST_ASSERT(isAccepted(2));
+	TEST_ASSERT(!isAccepted(100));
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getCriticalSectionDepth());
+}
+
+
+static void test_savedListIsRestored(void)
+{
+	ovr_beaconFilter_init(&filter);
+	for( uint32_t i = 0; i < 1000; i++ ) makeId(i, &rawEntries[i * EUI48_SIZE_BYTES]);
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_ALLOW, rawEntries, 1000, false));
+	TEST_ASSERT(ovr_beaconFilter_save(&filter));
+
+	ovr_beaconFilter_t restoredFilter;
+	ovr_beaconFilter_init(&restoredFilter);
+	TEST_ASSERT_EQUAL_INT(OVR_BEACONFILTER_MODE_ALLOW, ovr_beaconFilter_getMode(&restoredFilter));
+	TEST_ASSERT_EQUAL_INT(1000, ovr_beaconFilter_getNumEntries(&restoredFilter));
+
+	uint8_t id[EUI48_SIZE_BYTES];
+	makeId(999, id);
+	TEST_ASSERT(ovr_beaconFilter_isAccepted(&restoredFilter, (cxa_eui48_t*)id));
+	makeId(1000, id);
+	TEST_ASSERT(!ovr_beaconFilter_isAccepted(&restoredFilter, (cxa_eui48_t*)id));
+}
+
+
+static void bench_10kEntries(void)
+{
+	ovr_beaconFilter_init(&filter);
+	for( uint32_t i = 0; i < BENCH_NUM_ENTRIES; i++ ) makeId(i, &rawEntries[i * EUI48_SIZE_BYTES]);
+
+	size_t startAllocated_bytes = getNumAllocated_bytes();
+	double startTime_s = getTime_s();
+	TEST_ASSERT(ovr_beaconFilter_setEntries(&filter, OVR_BEACONFILTER_MODE_ALLOW, rawEntries, BENCH_NUM_ENTRIES, false));
+	double setTime_s = getTime_s() - startTime_s;
+	size_t table_bytes = getNumAllocated_bytes() - startAllocated_bytes;
+
+	TEST_ASSERT_EQUAL_INT(BENCH_NUM_ENTRIES, ovr_beaconFilter_getNumEntries(&filter));
+	TEST_ASSERT(table_bytes <= (BENCH_NUM_ENTRIES * 4));
+
+	// half listed, half not
+	uint32_t numAccepted = 0;
+	startTime_s = getTime_s();
+	for( uint32_t i = 0; i < BENCH_NUM_LOOKUPS; i++ )
+	{
+		if( isAccepted((i & 1) ? (i % BENCH_NUM_ENTRIES) : (BENCH_NUM_ENTRIES + i)) ) numAccepted++;
+	}
+	double lookupTime_s = getTime_s() - startTime_s;
+
+	// every listed id hits and (barring a hash collision) nothing else does
+	uint32_t numFalseAccepts = numAccepted - (BENCH_NUM_LOOKUPS / 2);
+	TEST_ASSERT(numAccepted >= (BENCH_NUM_LOOKUPS / 2));
+	TEST_ASSERT(numFalseAccepts <= 10);
+
+	testRunner_report("beaconFilter", "numEntries", BENCH_NUM_ENTRIES);
+	testRunner_report("beaconFilter", "table_bytes", table_bytes);
+	testRunner_report("beaconFilter", "bytesPerEntry", (double)table_bytes / BENCH_NUM_ENTRIES);
+	testRunner_report("beaconFilter", "setEntries_ms", setTime_s * 1e3);
+	testRunner_report("beaconFilter", "lookup_ns", (lookupTime_s * 1e9) / BENCH_NUM_LOOKUPS);
+	testRunner_report("beaconFilter", "falseAccepts", numFalseAccepts);
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_disabledAcceptsEverything),
+	TESTRUNNER_TEST(test_allowAndDeny),
+	TESTRUNNER_TEST(test_appendAndDedupe),
+	TESTRUNNER_TEST(test_tooManyKeepsCurrentList),
+	TESTRUNNER_TEST(test_updateDoesNotDisturbReceivePath),
+	TESTRUNNER_TEST(test_savedListIsRestored),
+	TESTRUNNER_TEST(bench_10kEntries),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void makeId(uint32_t seedIn, uint8_t *const bytesOut)
+{
+	// sequential ids, like a batch of beacons off the line
+	bytesOut[0] = 0x00;
+	bytesOut[1] = 0x11;
+	bytesOut[2] = (uint8_t)(seedIn >> 24);
+	bytesOut[3] = (uint8_t)(seedIn >> 16);
+	bytesOut[4] = (uint8_t)(seedIn >> 8);
+	bytesOut[5] = (uint8_t)seedIn;
+}
+
+
+static bool isAccepted(uint32_t seedIn)
+{
+	cxa_eui48_t id;
+	makeId(seedIn, id.bytes);
+	return ovr_beaconFilter_isAccepted(&filter, &id);
+}
+
+
+static size_t getNumAllocated_bytes(void)
+{
+	return stubHal_heap_getNumAllocated_bytes(MALLOC_CAP_SPIRAM) + stubHal_heap_getNumAllocated_bytes(MALLOC_CAP_INTERNAL);
+}
+
+
+static double getTime_s(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+
+static void heapCb_checkDuringUpdate(void* userVarIn)
+{
+	// still the old deny list...not deny-all
+	numChecksDuringUpdate++;
+	TEST_ASSERT(!isAccepted(1));
+	TEST_ASSERT(isAccepted(2));
+	TEST_ASSERT(isAccepted(50));
+}
@@ -0,0 +1,331 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <ovr_beaconHistory.h>
+
+
+// ******** local macro definitions ********
+#define NUM_SLICES						4
+#define MAXNUM_SAMPLES					(OVR_BEACONHISTORY_SLICESIZE_BYTES / 2)
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void setupArena(void);
+static uint32_t nextRandom(void);
+static ovr_beaconHistory_sample_t randomWalk(ovr_beaconHistory_sample_t *const prevIn);
+static void assertSamplesEqual(ovr_beaconHistory_sample_t *const expectedIn, ovr_beaconHistory_sample_t *const actualIn);
+
+
+// ********  local variable declarations *********
+static ovr_beaconHistory_arena_t arena;
+static uint8_t arena_buffer[NUM_SLICES * OVR_BEACONHISTORY_SLICESIZE_BYTES];
+static bool arena_isSliceUsed[NUM_SLICES];
+
+static uint32_t randomState;
+
+static const ovr_beaconHistory_sample_t typicalSample = { .rssi_dBm = -70, .temp_deciDegC = 215, .light_255 = 40, .batt_pcnt100 = 90, .batt_mv = 2950 };
+
+
+// ******** global function implementations ********
+static void test_roundTrip(void)
+{
+	setupArena();
+
+	ovr_beaconHistory_t hist;
+	ovr_beaconHistory_sample_t first = typicalSample;
+	ovr_beaconHistory_init(&hist, &arena, &first);
+
+	ovr_beaconHistory_sample_t expected[MAXNUM_SAMPLES];
+	uint32_t expectedDts_ms[MAXNUM_SAMPLES];
+	ovr_beaconHistory_sample_t prev = first;
+	size_t numAppended = 0;
+	for( ; numAppended < 20; numAppended++ )
+	{
+		expected[numAppended] = randomWalk(&prev);
+		expectedDts_ms[numAppended] = 1000 + 10 * (nextRandom() % 50);
+		ovr_beaconHistory_append(&hist, &expected[numAppended], expectedDts_ms[numAppended]);
+		prev = expected[numAppended];
+	}
+	TEST_ASSERT_EQUAL_INT(0, ovr_beaconHistory_getNumDropped(&hist));
+	TEST_ASSERT_EQUAL_INT(numAppended, ovr_beaconHistory_getNumSamples(&hist));
+
+	uint8_t batch[256];
+	size_t numDrained;
+	size_t batchSize_bytes = ovr_beaconHistory_drainBatch(&hist, 1230, batch, sizeof(batch), &numDrained);
+	TEST_ASSERT(batchSize_bytes > 0);
+	TEST_ASSERT_EQUAL_INT(numAppended, numDrained);
+	TEST_ASSERT_EQUAL_INT(0, ovr_beaconHistory_getNumSamples(&hist));
+
+	ovr_beaconHistory_sample_t decoded[MAXNUM_SAMPLES];
+	uint32_t decodedDts_ms[MAXNUM_SAMPLES];
+	uint32_t ageOfLast_ms;
+	TEST_ASSERT_EQUAL_INT(numAppended, ovr_beaconHistory_decodeBatch(batch, batchSize_bytes, decoded, decodedDts_ms, MAXNUM_SAMPLES, &ageOfLast_ms));
+	for( size_t i = 0; i < numAppended; i++ )
+	{
+		assertSamplesEqual(&expected[i], &decoded[i]);
+		TEST_ASSERT_EQUAL_INT(expectedDts_ms[i], decodedDts_ms[i]);
+	}
+	TEST_ASSERT_EQUAL_INT(1230, ageOfLast_ms);
+}
+
+
+static void test_zigzagExtremes(void)
+{
+	setupArena();
+
+	// every field swings across its full range (deltas of both signs, multi-byte varints)
+	ovr_beaconHistory_sample_t samples[] =
+	{
+		{ .rssi_dBm = -128, .temp_deciDegC = 0, .light_255 = 0, .batt_pcnt100 = 0, .batt_mv = 0 },
+		{ .rssi_dBm = 127, .temp_deciDegC = 0xFFFF, .light_255 = 255, .batt_pcnt100 = 100, .batt_mv = 0xFFFF },
+		{ .rssi_dBm = -128, .temp_deciDegC = 0, .light_255 = 0, .batt_pcnt100 = 0, .batt_mv = 0 },
+		{ .rssi_dBm = -1, .temp_deciDegC = 0x8000, .light_255 = 128, .batt_pcnt100 = 1, .batt_mv = 0x7FFF },
+		{ .rssi_dBm = 0, .temp_deciDegC = 0x7FFF, .light_255 = 127, .batt_pcnt100 = 1, .batt_mv = 0x8000 },
+	};
+	size_t numSamples = sizeof(samples) / sizeof(*samples);
+
+	ovr_beaconHistory_t hist;
+	ovr_beaconHistory_sample_t first = typicalSample;
+	ovr_beaconHistory_init(&hist, &arena, &first);
+	for( size_t i = 0; i < numSamples; i++ ) ovr_beaconHistory_append(&hist, &samples[i], 0);
+
+	uint8_t batch[256];
+	size_t batchSize_bytes = ovr_beaconHistory_drainBatch(&hist, 0, batch, sizeof(batch), NULL);
+
+	ovr_beaconHistory_sample_t decoded[8];
+	TEST_ASSERT_EQUAL_INT(numSamples, ovr_beaconHistory_decodeBatch(batch, batchSize_bytes, decoded, NULL, 8, NULL));
+	for( size_t i = 0; i < numSamples; i++ ) assertSamplesEqual(&samples[i], &decoded[i]);
+}
+
+
+static void test_bytesPerSample(void)
+{
+	setupArena();
+
+	// a beacon sitting still: rssi jitters, everything else drifts occasionally
+	ovr_beaconHistory_t hist;
+	ovr_beaconHistory_sample_t prev = typicalSample;
+	ovr_beaconHistory_init(&hist, &arena, &prev);
+
+	size_t numAppended = 0;
+	while( ovr_beaconHistory_getNumDropped(&hist) == 0 )
+	{
+		ovr_beaconHistory_sample_t curr = randomWalk(&prev);
+		ovr_beaconHistory_append(&hist, &curr, 1000);
+		prev = curr;
+		numAppended++;
+	}
+	size_t numHeld = ovr_beaconHistory_getNumSamples(&hist);
+	double bytesPerSample = (double)OVR_BEACONHISTORY_SLICESIZE_BYTES / numHeld;
+	testRunner_report("beaconHistory", "samplesPerSlice", numHeld);
+	testRunner_report("beaconHistory", "bytesPerSample", bytesPerSample);
+
+	// raw samples are 7 bytes + a timestamp
+	TEST_ASSERT(bytesPerSample <= 5.0);
+	TEST_ASSERT_EQUAL_INT(numAppended, numHeld + ovr_beaconHistory_getNumDropped(&hist));
+
+	// an unchanged sample is just [dt][fieldMask]
+	ovr_beaconHistory_t quietHist;
+	ovr_beaconHistory_sample_t quiet = typicalSample;
+	ovr_beaconHistory_init(&quietHist, &arena, &quiet);
+	for( size_t i = 0; i < (2 * MAXNUM_SAMPLES); i++ ) ovr_beaconHistory_append(&quietHist, &quiet, 1000);
+	TEST_ASSERT_EQUAL_INT(OVR_BEACONHISTORY_SLICESIZE_BYTES / 2, ovr_beaconHistory_getNumSamples(&quietHist));
+}
+
+
+static void test_overflowKeepsNewest(void)
+{
+	setupArena();
+
+	ovr_beaconHistory_t hist;
+	ovr_beaconHistory_sample_t prev = typicalSample;
+	ovr_beaconHistory_init(&hist, &arena, &prev);
+
+	ovr_beaconHistory_sample_t appended[500];
+	for( size_t i = 0; i < 500; i++ )
+	{
+		appended[i] = randomWalk(&prev);
+		ovr_beaconHistory_append(&hist, &appended[i], 2000);
+		prev = appended[i];
+	}
+	size_t numHeld = ovr_beaconHistory_getNumSamples(&hist);
+	TEST_ASSERT(numHeld > 0);
+	TEST_ASSERT_EQUAL_INT(500, numHeld + ovr_beaconHistory_getNumDropped(&hist));
+
+	// what's left decodes to exactly the newest samples (the base was carried forward)
+	uint8_t batch[OVR_BEACONHISTORY_BATCHHEADER_MAXSIZE_BYTES + OVR_BEACONHISTORY_SLICESIZE_BYTES];
+	size_t numDrained;
+	size_t batchSize_bytes = ovr_beaconHistory_drainBatch(&hist, 0, batch, sizeof(batch), &numDrained);
+	TEST_ASSERT_EQUAL_INT(numHeld, numDrained);
+
+	ovr_beaconHistory_sample_t decoded[MAXNUM_SAMPLES];
+	uint32_t ageOfLast_ms;
+	TEST_ASSERT_EQUAL_INT(numHeld, ovr_beaconHistory_decodeBatch(batch, batchSize_bytes, decoded, NULL, MAXNUM_SAMPLES, &ageOfLast_ms));
+	for( size_t i = 0; i < numHeld; i++ ) assertSamplesEqual(&appended[500 - numHeld + i], &decoded[i]);
+	TEST_ASSERT_EQUAL_INT(0, ageOfLast_ms);
+}
+
+
+static void test_partialDrainsRespectBufferSize(void)
+{
+	setupArena();
+
+	ovr_beaconHistory_t hist;
+	ovr_beaconHistory_sample_t prev = typicalSample;
+	ovr_beaconHistory_init(&hist, &arena, &prev);
+
+	ovr_beaconHistory_sample_t appended[MAXNUM_SAMPLES];
+	size_t numAppended = 0;
+	while( numAppended < MAXNUM_SAMPLES )
+	{
+		ovr_beaconHistory_sample_t curr = randomWalk(&prev);
+		ovr_beaconHistory_append(&hist, &curr, 500);
+		if( ovr_beaconHistory_getNumDropped(&hist) > 0 ) break;
+		appended[numAppended++] = curr;
+		prev = curr;
+	}
+	size_t numHeld = ovr_beaconHistory_getNumSamples(&hist);
+	size_t numOffset = (numAppended + 1) - numHeld;
+
+	// too small for even the header
+	uint8_t batch[OVR_BEACONHISTORY_BATCHHEADER_MAXSIZE_BYTES + 16];
+	TEST_ASSERT_EQUAL_INT(0, ovr_beaconHistory_drainBatch(&hist, 0, batch, OVR_BEACONHISTORY_BATCHHEADER_MAXSIZE_BYTES, NULL));
+	TEST_ASSERT_EQUAL_INT(numHeld, ovr_beaconHistory_getNumSamples(&hist));
+
+	// small batches, each self-contained, together give back every sample in order
+	size_t numRecovered = 0;
+	size_t numBatches = 0;
+	while( ovr_beaconHistory_getNumSamples(&hist) > 0 )
+	{
+		size_t numDrained;
+		size_t batchSize_bytes = ovr_beaconHistory_drainBatch(&hist, 0, batch, sizeof(batch), &numDrained);
+		TEST_ASSERT(batchSize_bytes > 0);
+		TEST_ASSERT(batchSize_bytes <= sizeof(batch));
+		numBatches++;
+
+		ovr_beaconHistory_sample_t decoded[MAXNUM_SAMPLES];
+		TEST_ASSERT_EQUAL_INT(numDrained, ovr_beaconHistory_decodeBatch(batch, batchSize_bytes, decoded, NULL, MAXNUM_SAMPLES, NULL));
+		for( size_t i = 0; i < numDrained; i++ )
+		{
+			size_t appendedIndex = numOffset + numRecovered + i;
+			if( appendedIndex < numAppended ) assertSamplesEqual(&appended[appendedIndex], &decoded[i]);
+		}
+		numRecovered += numDrained;
+	}
+	TEST_ASSERT_EQUAL_INT(numHeld, numRecovered);
+	TEST_ASSERT(numBatches > 1);
+}
+
+
+static void test_worstCaseHeaderFitsCap(void)
+{
+	setupArena();
+
+	ovr_beaconHistory_sample_t extreme = { .rssi_dBm = -128, .temp_deciDegC = 0xFFFF, .light_255 = 255, .batt_pcnt100 = 255, .batt_mv = 0xFFFF };
+	ovr_beaconHistory_t hist;
+	ovr_beaconHistory_init(&hist, &arena, &extreme);
+
+	// a single unchanged record is 2 bytes with a 1-unit dt
+	ovr_beaconHistory_append(&hist, &extreme, OVR_BEACONHISTORY_TIMERESOLUTION_MS);
+
+	uint8_t batch[OVR_BEACONHISTORY_BATCHHEADER_MAXSIZE_BYTES + 2];
+	size_t batchSize_bytes = ovr_beaconHistory_drainBatch(&hist, UINT32_MAX, batch, sizeof(batch), NULL);
+	TEST_ASSERT(batchSize_bytes > 0);
+	TEST_ASSERT(batchSize_bytes <= sizeof(batch));
+}
+
+
+static void test_exhaustedArena(void)
+{
+	setupArena();
+
+	ovr_beaconHistory_t hists[NUM_SLICES + 1];
+	ovr_beaconHistory_sample_t sample = typicalSample;
+	for( size_t i = 0; i < (NUM_SLICES + 1); i++ ) ovr_beaconHistory_init(&hists[i], &arena, &sample);
+
+	// the last one has no slice but is still usable
+	ovr_beaconHistory_append(&hists[NUM_SLICES], &sample, 1000);
+	TEST_ASSERT_EQUAL_INT(0, ovr_beaconHistory_getNumSamples(&hists[NUM_SLICES]));
+
+	// a freed slice can be reclaimed
+	ovr_beaconHistory_deinit(&hists[0]);
+	ovr_beaconHistory_init(&hists[NUM_SLICES], &arena, &sample);
+	ovr_beaconHistory_append(&hists[NUM_SLICES], &sample, 1000);
+	TEST_ASSERT_EQUAL_INT(1, ovr_beaconHistory_getNumSamples(&hists[NUM_SLICES]));
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_roundTrip),
+	TESTRUNNER_TEST(test_zigzagExtremes),
+	TESTRUNNER_TEST(test_bytesPerSample),
+	TESTRUNNER_TEST(test_overflowKeepsNewest),
+	TESTRUNNER_TEST(test_partialDrainsRespectBufferSize),
+	TESTRUNNER_TEST(test_worstCaseHeaderFitsCap),
+	TESTRUNNER_TEST(test_exhaustedArena),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupArena(void)
+{
+	ovr_beaconHistory_arena_init(&arena, arena_buffer, arena_isSliceUsed, NUM_SLICES);
+	randomState = 0x2545F491;
+}
+
+
+static uint32_t nextRandom(void)
+{
+	// xorshift32, so runs are repeatable
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+
+static ovr_beaconHistory_sample_t randomWalk(ovr_beaconHistory_sample_t *const prevIn)
+{
+	ovr_beaconHistory_sample_t retVal = *prevIn;
+
+	retVal.rssi_dBm += (int)(nextRandom() % 7) - 3;
+	if( (nextRandom() % 4) == 0 ) retVal.temp_deciDegC += (int)(nextRandom() % 3) - 1;
+	if( (nextRandom() % 8) == 0 ) retVal.light_255 += (int)(nextRandom() % 5) - 2;
+	if( (nextRandom() % 64) == 0 ) retVal.batt_pcnt100--;
+	if( (nextRandom() % 16) == 0 ) retVal.batt_mv -= nextRandom() % 4;
+
+	return retVal;
+}
+
+
+static void assertSamplesEqual(ovr_beaconHistory_sample_t *const expectedIn, ovr_beaconHistory_sample_t *const actualIn)
+{
+	TEST_ASSERT_EQUAL_INT(expectedIn->rssi_dBm, actualIn->rssi_dBm);
+	TEST_ASSERT_EQUAL_INT(expectedIn->temp_deciDegC, actualIn->temp_deciDegC);
+	TEST_ASSERT_EQUAL_INT(expectedIn->light_255, actualIn->light_255);
+	TEST_ASSERT_EQUAL_INT(expectedIn->batt_pcnt100, actualIn->batt_pcnt100);
+	TEST_ASSERT_EQUAL_INT(expectedIn->batt_mv, actualIn->batt_mv);
+}
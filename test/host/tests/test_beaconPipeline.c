@@ -0,0 +1,288 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_btle_client.h>
+#include <cxa_sntpClient.h>
+#include <stubHal.h>
+
+#include <ovr_beaconManager.h>
+#include <ovr_config.h>
+#include <ovr_publishScheduler.h>
+
+
+// ******** local macro definitions ********
+#define COMPANY_ID						0x04A2
+#define UNIX_TIME						1500000000
+
+// as ovr_beaconGateway runs them
+#define THREADID_NETWORK				1
+#define THREADID_BLUETOOTH				3
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void setupPipeline(void);
+static void injectAdvert(uint8_t lastEuiByteIn, int8_t rssi_dBmIn);
+static void injectAdvert_withStatus(uint8_t lastEuiByteIn, int8_t rssi_dBmIn, uint8_t statusIn, uint8_t accelStatusIn);
+static void hearBeacon(uint8_t lastEuiByteIn, int8_t rssi_dBmIn);
+static void hearBeacons(uint8_t firstEuiByteIn, size_t numBeaconsIn);
+static size_t countHeldEvents(const char *const eventIn);
+
+
+// ********  local variable declarations *********
+static cxa_btle_client_t btleClient;
+static ovr_beaconManager_t beaconManager;
+
+
+// ******** global function implementations ********
+static void test_advertIsFoundAndReported(void)
+{
+	setupPipeline();
+	stubHal_setUnixTime(UNIX_TIME);
+
+	hearBeacon(0x01, -60);
+	stubHal_run_ms(100, 10);
+
+	TEST_ASSERT_EQUAL_INT(1, cxa_array_getSize_elems(ovr_beaconManager_getKnownBeacons(&beaconManager)));
+	stubHal_publication_t* foundPub = stubHal_findPublication("onBeaconFound", NULL);
+	TEST_ASSERT(foundPub != NULL);
+	TEST_ASSERT(strstr((char*)foundPub->payload, "\"beaconId\":\"00:11:22:33:44:01\"") != NULL);
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getNumOversizedPublishes());
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getCriticalSectionDepth());
+}
+
+
+static void test_foundIsHeldUntilClockIsSet(void)
+{
+	setupPipeline();
+
+	hearBeacon(0x02, -60);
+	stubHal_run_ms(1000, 10);
+	TEST_ASSERT_EQUAL_INT(0, stubHal_countPublications("onBeaconFound"));
+
+	stubHal_setUnixTime(UNIX_TIME);
+	stubHal_run_ms(1000, 10);
+	TEST_ASSERT(stubHal_getNumPublications() > 0);
+}
+
+
+static void test_silentBeaconIsLost(void)
+{
+	setupPipeline();
+	stubHal_setUnixTime(UNIX_TIME);
+
+	hearBeacon(0x03, -60);
+	stubHal_run_ms(100, 10);
+	TEST_ASSERT_EQUAL_INT(1, cxa_array_getSize_elems(ovr_beaconManager_getKnownBeacons(&beaconManager)));
+
+	// never heard from again
+	stubHal_run_ms(ovr_config_get(OVR_CONFIG_ID_LOSTTIMEOUT_MS) + 5000, 100);
+	TEST_ASSERT_EQUAL_INT(0, cxa_array_getSize_elems(ovr_beaconManager_getKnownBeacons(&beaconManager)));
+}
+
+
+static void test_reportsFitSingleMessage(void)
+{
+	setupPipeline();
+	stubHal_setUnixTime(UNIX_TIME);
+
+	// every field enabled and at its widest (charging, all sensors, every accel event)
+	for( int i = 0; i < 65; i++ )
+	{
+		injectAdvert_withStatus(0xFE, -100, 0x87, 0x0F);
+		stubHal_run_ms(1000, 10);
+	}
+
+	size_t updateIndex = 0;
+	stubHal_publication_t* updatePub = stubHal_findPublication("onBeaconUpdate", &updateIndex);
+	TEST_ASSERT(updatePub != NULL);
+	TEST_ASSERT(strstr((char*)updatePub->payload, "\"accel\":15") != NULL);
+
+	// the window rides along: [n, rssiMin, rssiMax, rssiMean, rssiMedian, batt..., temp..., light...]
+	char* agg = strstr((char*)updatePub->payload, "\"agg\":[");
+	TEST_ASSERT(agg != NULL);
+	TEST_ASSERT(strstr(agg, ",-100,-100,-100,") != NULL);
+	TEST_ASSERT(strstr(agg, "null") == NULL);
+	TEST_ASSERT_EQUAL_INT(0, stubHal_countPublications("onBeaconAggregates"));
+
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getNumOversizedPublishes());
+	TEST_ASSERT_EQUAL_INT(0, ovr_beaconManager_getPublishStats(&beaconManager).numFailures);
+	TEST_ASSERT_EQUAL_INT(0, ovr_publishScheduler_getClassStats(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY).numDropped);
+}
+
+
+static void test_heldPresenceFitsMessages(void)
+{
+	setupPipeline();
+
+	hearBeacons(0x10, OVR_BEACONMANAGER_MAXNUM_BEACONS);
+	stubHal_setUnixTime(UNIX_TIME);
+	stubHal_run_ms(2000, 10);
+
+	// every event made it out once, in as few messages as fit
+	TEST_ASSERT_EQUAL_INT(OVR_BEACONMANAGER_MAXNUM_BEACONS, countHeldEvents("\"found\""));
+	TEST_ASSERT(stubHal_countPublications("onBeaconPresenceBatch") < OVR_BEACONMANAGER_MAXNUM_BEACONS);
+	TEST_ASSERT_EQUAL_INT(0, stubHal_countPublications("onBeaconFound"));
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getNumOversizedPublishes());
+	TEST_ASSERT_EQUAL_INT(0, ovr_beaconManager_getPublishStats(&beaconManager).numFailures);
+}
+
+
+static void test_failedBatchKeepsItsEvents(void)
+{
+	setupPipeline();
+
+	hearBeacons(0x20, 4);
+	stubHal_setUnixTime(UNIX_TIME);
+
+	// the scheduler gives the first batch up after repeated failures
+	stubHal_mqtt_failNextPublishes(3);
+	stubHal_run_ms(2000, 10);
+	TEST_ASSERT(ovr_publishScheduler_getClassStats(OVR_PUBLISHSCHEDULER_CLASS_PRESENCE).numFailed > 0);
+
+	// ...but its events were still queued and went out in a later one
+	TEST_ASSERT_EQUAL_INT(4, countHeldEvents("\"found\""));
+	for( uint8_t i = 0; i < 4; i++ )
+	{
+		char beaconId[32];
+		snprintf(beaconId, sizeof(beaconId), "\"00:11:22:33:44:%02x\"", 0x20 + i);
+		TEST_ASSERT_EQUAL_INT(1, countHeldEvents(beaconId));
+	}
+
+	// and new events go straight out again
+	hearBeacon(0x30, -60);
+	stubHal_run_ms(100, 10);
+	TEST_ASSERT_EQUAL_INT(1, stubHal_countPublications("onBeaconFound"));
+}
+
+
+static void test_disconnectedBatchIsResent(void)
+{
+	setupPipeline();
+
+	hearBeacons(0x40, 2);
+	stubHal_mqtt_setConnected(false);
+	stubHal_setUnixTime(UNIX_TIME);
+	stubHal_run_ms(5000, 10);
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getNumPublications());
+
+	stubHal_mqtt_setConnected(true);
+	stubHal_run_ms(1000, 10);
+	TEST_ASSERT_EQUAL_INT(2, countHeldEvents("\"found\""));
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_advertIsFoundAndReported),
+	TESTRUNNER_TEST(test_foundIsHeldUntilClockIsSet),
+	TESTRUNNER_TEST(test_silentBeaconIsLost),
+	TESTRUNNER_TEST(test_reportsFitSingleMessage),
+	TESTRUNNER_TEST(test_heldPresenceFitsMessages),
+	TESTRUNNER_TEST(test_failedBatchKeepsItsEvents),
+	TESTRUNNER_TEST(test_disconnectedBatchIsResent),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupPipeline(void)
+{
+	cxa_mqtt_rpc_node_t* rootNode = stubHal_getRootNode();
+
+	ovr_config_init(rootNode);
+	ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+
+	stubHal_btle_init(&btleClient);
+	ovr_beaconManager_init(&beaconManager, &btleClient, rootNode, THREADID_BLUETOOTH, THREADID_NETWORK);
+	stubHal_btle_setReady(&btleClient);
+	stubHal_iterateAll();
+}
+
+
+static void injectAdvert(uint8_t lastEuiByteIn, int8_t rssi_dBmIn)
+{
+	injectAdvert_withStatus(lastEuiByteIn, rssi_dBmIn, 0x00, 0x00);
+}
+
+
+static void injectAdvert_withStatus(uint8_t lastEuiByteIn, int8_t rssi_dBmIn, uint8_t statusIn, uint8_t accelStatusIn)
+{
+	uint8_t advert[] =
+	{
+		0x00,									// devType
+		0x00, 0x11, 0x22, 0x33, 0x44, lastEuiByteIn,	// eui48
+		statusIn,								// status
+		80,										// battery %
+		0xE1, 0x00,								// 22.5degC
+		0x40,									// light
+		accelStatusIn,							// accel status
+		0x0C, 0x0E								// 3596mV
+	};
+	TEST_ASSERT(stubHal_btle_injectManData(&btleClient, rssi_dBmIn, COMPANY_ID, advert, sizeof(advert)));
+}
+
+
+static void hearBeacon(uint8_t lastEuiByteIn, int8_t rssi_dBmIn)
+{
+	// enough adverts in a row to be found
+	for( int i = 0; i < OVR_BEACONMANAGER_FOUND_NUMADVERTS; i++ )
+	{
+		if( i > 0 ) stubHal_run_ms(1000, 10);
+		injectAdvert(lastEuiByteIn, rssi_dBmIn);
+	}
+}
+
+
+static void hearBeacons(uint8_t firstEuiByteIn, size_t numBeaconsIn)
+{
+	// all of them within the same second (the rx fifo is small)
+	for( int i = 0; i < OVR_BEACONMANAGER_FOUND_NUMADVERTS; i++ )
+	{
+		if( i > 0 ) stubHal_run_ms(1000, 10);
+		for( size_t j = 0; j < numBeaconsIn; j++ )
+		{
+			injectAdvert(firstEuiByteIn + j, -60);
+			stubHal_iterateAll();
+		}
+	}
+}
+
+
+static size_t countHeldEvents(const char *const eventIn)
+{
+	size_t retVal = 0;
+	size_t index = 0;
+	stubHal_publication_t* currPub;
+	while( (currPub = stubHal_findPublication("onBeaconPresenceBatch", &index)) != NULL )
+	{
+		char payload[sizeof(currPub->payload) + 1];
+		memcpy(payload, currPub->payload, currPub->payloadSize_bytes);
+		payload[currPub->payloadSize_bytes] = 0;
+
+		for( char* match = strstr(payload, eventIn); match != NULL; match = strstr(match + 1, eventIn) ) retVal++;
+		index++;
+	}
+	return retVal;
+}
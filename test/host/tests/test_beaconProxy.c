@@ -0,0 +1,183 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_fixedByteBuffer.h>
+#include <cxa_timeBase.h>
+#include <stubHal.h>
+
+#include <ovr_beaconProxy.h>
+#include <ovr_beaconUpdate.h>
+#include <ovr_config.h>
+
+
+// ******** local macro definitions ********
+#define ACCEL_FREEFALL					(1 << 3)
+#define ACCEL_1TAP						(1 << 1)
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static ovr_beaconUpdate_t makeUpdate(int8_t rssi_dBmIn, uint8_t accelStatusIn);
+static void receive(ovr_beaconProxy_t *const proxyIn, int8_t rssi_dBmIn, uint8_t accelStatusIn);
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+static void test_accelEventsCountRisingEdges(void)
+{
+	ovr_config_init(NULL);
+
+	ovr_beaconUpdate_t firstUpdate = makeUpdate(-60, 0);
+	ovr_beaconProxy_t proxy;
+	ovr_beaconProxy_init(&proxy, &firstUpdate, NULL);
+
+	// a tap held across three adverts is one tap
+	stubHal_advanceTime_ms(1000);
+	uint32_t firstTap_us = cxa_timeBase_getCount_us();
+	receive(&proxy, -60, ACCEL_1TAP);
+	stubHal_advanceTime_ms(1000);
+	receive(&proxy, -60, ACCEL_1TAP);
+	stubHal_advanceTime_ms(1000);
+	receive(&proxy, -60, ACCEL_1TAP);
+	stubHal_advanceTime_ms(1000);
+	receive(&proxy, -60, 0);
+	stubHal_advanceTime_ms(1000);
+	uint32_t secondTap_us = cxa_timeBase_getCount_us();
+	receive(&proxy, -60, ACCEL_1TAP);
+
+	TEST_ASSERT(ovr_beaconProxy_hasPendingAccelEvent(&proxy, OVR_BEACONPROXY_ACCELEVENT_1TAP));
+	TEST_ASSERT(!ovr_beaconProxy_hasPendingAccelEvent(&proxy, OVR_BEACONPROXY_ACCELEVENT_FREEFALL));
+
+	ovr_beaconProxy_accelEvents_t events = ovr_beaconProxy_checkAndResetAccelEvents(&proxy);
+	ovr_beaconProxy_accelEventStats_t* tapStats = &events.events[OVR_BEACONPROXY_ACCELEVENT_1TAP];
+	TEST_ASSERT_EQUAL_INT(2, tapStats->count);
+	TEST_ASSERT(tapStats->hasOccurred);
+	TEST_ASSERT_EQUAL_INT(firstTap_us, tapStats->first_us);
+	TEST_ASSERT_EQUAL_INT(secondTap_us, tapStats->last_us);
+	TEST_ASSERT_EQUAL_INT(0, events.events[OVR_BEACONPROXY_ACCELEVENT_FREEFALL].count);
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getCriticalSectionDepth());
+}
+
+
+static void test_accelResetStartsNewWindow(void)
+{
+	ovr_config_init(NULL);
+
+	ovr_beaconUpdate_t firstUpdate = makeUpdate(-60, ACCEL_FREEFALL);
+	ovr_beaconProxy_t proxy;
+	ovr_beaconProxy_init(&proxy, &firstUpdate, NULL);
+
+	// set in the very first advert counts
+	TEST_ASSERT(ovr_beaconProxy_hasPendingAccelEvent(&proxy, OVR_BEACONPROXY_ACCELEVENT_FREEFALL));
+	ovr_beaconProxy_accelEvents_t events = ovr_beaconProxy_checkAndResetAccelEvents(&proxy);
+	TEST_ASSERT_EQUAL_INT(1, events.events[OVR_BEACONPROXY_ACCELEVENT_FREEFALL].count);
+
+	// still latched by the beacon but no new edge
+	stubHal_advanceTime_ms(1000);
+	receive(&proxy, -60, ACCEL_FREEFALL);
+	TEST_ASSERT(!ovr_beaconProxy_hasPendingAccelEvent(&proxy, OVR_BEACONPROXY_ACCELEVENT_FREEFALL));
+	events = ovr_beaconProxy_checkAndResetAccelEvents(&proxy);
+	TEST_ASSERT_EQUAL_INT(0, events.events[OVR_BEACONPROXY_ACCELEVENT_FREEFALL].count);
+	TEST_ASSERT(events.events[OVR_BEACONPROXY_ACCELEVENT_FREEFALL].hasOccurred);
+
+	// once it clears, hasOccurred follows
+	stubHal_advanceTime_ms(1000);
+	receive(&proxy, -60, 0);
+	ovr_beaconProxy_checkAndResetAccelEvents(&proxy);
+	events = ovr_beaconProxy_checkAndResetAccelEvents(&proxy);
+	TEST_ASSERT(!events.events[OVR_BEACONPROXY_ACCELEVENT_FREEFALL].hasOccurred);
+
+	// a new window's first time is its own, not the previous window's
+	stubHal_advanceTime_ms(5000);
+	uint32_t newFall_us = cxa_timeBase_getCount_us();
+	receive(&proxy, -60, ACCEL_FREEFALL);
+	events = ovr_beaconProxy_checkAndResetAccelEvents(&proxy);
+	TEST_ASSERT_EQUAL_INT(1, events.events[OVR_BEACONPROXY_ACCELEVENT_FREEFALL].count);
+	TEST_ASSERT_EQUAL_INT(newFall_us, events.events[OVR_BEACONPROXY_ACCELEVENT_FREEFALL].first_us);
+}
+
+
+static void test_accelCountsSurviveCheckpoint(void)
+{
+	ovr_config_init(NULL);
+
+	ovr_beaconUpdate_t firstUpdate = makeUpdate(-60, 0);
+	ovr_beaconProxy_t proxy;
+	ovr_beaconProxy_init(&proxy, &firstUpdate, NULL);
+	for( int i = 0; i < 3; i++ )
+	{
+		stubHal_advanceTime_ms(1000);
+		receive(&proxy, -60, ACCEL_1TAP);
+		stubHal_advanceTime_ms(1000);
+		receive(&proxy, -60, 0);
+	}
+
+	uint8_t record[OVR_BEACONPROXY_CHECKPOINT_SIZE_BYTES];
+	ovr_beaconProxy_writeCheckpoint(&proxy, record);
+
+	ovr_beaconProxy_t restored;
+	TEST_ASSERT(ovr_beaconProxy_initFromCheckpoint(&restored, record, sizeof(record), NULL));
+	ovr_beaconProxy_accelEvents_t events = ovr_beaconProxy_checkAndResetAccelEvents(&restored);
+	TEST_ASSERT_EQUAL_INT(3, events.events[OVR_BEACONPROXY_ACCELEVENT_1TAP].count);
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_accelEventsCountRisingEdges),
+	TESTRUNNER_TEST(test_accelResetStartsNewWindow),
+	TESTRUNNER_TEST(test_accelCountsSurviveCheckpoint),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static ovr_beaconUpdate_t makeUpdate(int8_t rssi_dBmIn, uint8_t accelStatusIn)
+{
+	uint8_t advert[] =
+	{
+		0x00,									// devType
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55,		// eui48
+		0x00,									// status
+		80,										// battery %
+		0xE1, 0x00,								// 22.5degC
+		0x40,									// light
+		accelStatusIn,
+		0x0C, 0x0E								// 3596mV
+	};
+	cxa_fixedByteBuffer_t fbb;
+	cxa_fixedByteBuffer_init_inPlace(&fbb, sizeof(advert), advert, sizeof(advert));
+
+	ovr_beaconUpdate_t retVal;
+	TEST_ASSERT(ovr_beaconUpdate_init(&retVal, rssi_dBmIn, &fbb));
+	return retVal;
+}
+
+
+static void receive(ovr_beaconProxy_t *const proxyIn, int8_t rssi_dBmIn, uint8_t accelStatusIn)
+{
+	ovr_beaconUpdate_t update = makeUpdate(rssi_dBmIn, accelStatusIn);
+	ovr_beaconProxy_update(proxyIn, &update);
+}
@@ -0,0 +1,308 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cxa_btle_client.h>
+#include <stubHal.h>
+
+#include <ovr_beaconManager.h>
+#include <ovr_beaconManager_rpcInterface.h>
+#include <ovr_config.h>
+#include <ovr_publishScheduler.h>
+
+
+// ******** local macro definitions ********
+#define COMPANY_ID						0x04A2
+#define UNIX_TIME						1500000000
+
+// as ovr_beaconGateway runs them
+#define THREADID_NETWORK				1
+#define THREADID_BLUETOOTH				3
+
+#define NUM_BEACONS						12
+#define FIELDMASK_ALL					0x7F
+#define MAXNUM_PAGES					32
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	unsigned queryId;
+	unsigned numMatches;
+	unsigned offset;
+	unsigned numRecords;
+	unsigned isLast;
+	unsigned long nextCursor;
+}page_t;
+
+
+// ******** local function prototypes ********
+static void setupQuery(void);
+static void hearBeacons(uint8_t firstEuiByteIn, size_t numBeaconsIn, int8_t rssi_dBmIn);
+static uint16_t getBeacons(uint32_t cursorIn, uint16_t maxNumBeaconsIn, uint16_t fieldMaskIn, int8_t minRssiIn);
+static size_t collectPages(uint16_t queryIdIn, page_t *const pagesOut, uint8_t *const timesSeenOut);
+static unsigned long getMember(const char *const payloadIn, const char *const nameIn);
+
+
+// ********  local variable declarations *********
+static cxa_btle_client_t btleClient;
+static ovr_beaconManager_t beaconManager;
+
+
+// ******** global function implementations ********
+static void test_pagesFitSingleMessage(void)
+{
+	setupQuery();
+
+	uint16_t queryId = getBeacons(0, 0, FIELDMASK_ALL, INT8_MIN);
+	stubHal_run_ms(1000, 10);
+
+	page_t pages[MAXNUM_PAGES];
+	uint8_t timesSeen[256] = {0};
+	size_t numPages = collectPages(queryId, pages, timesSeen);
+
+	// every field of every beacon doesn't fit in one message...but each page does
+	TEST_ASSERT(numPages > 1);
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getNumOversizedPublishes());
+
+	unsigned numRecords = 0;
+	for( size_t i = 0; i < numPages; i++ )
+	{
+		TEST_ASSERT_EQUAL_INT(NUM_BEACONS, pages[i].numMatches);
+		TEST_ASSERT_EQUAL_INT(numRecords, pages[i].offset);
+		TEST_ASSERT(pages[i].numRecords > 0);
+		TEST_ASSERT_EQUAL_INT((i == (numPages - 1)), pages[i].isLast);
+		numRecords += pages[i].numRecords;
+	}
+	TEST_ASSERT_EQUAL_INT(NUM_BEACONS, numRecords);
+	TEST_ASSERT_EQUAL_INT(0, pages[numPages-1].nextCursor);
+	for( int i = 1; i <= NUM_BEACONS; i++ ) TEST_ASSERT_EQUAL_INT(1, timesSeen[i]);
+}
+
+
+static void test_cursorContinuesSnapshot(void)
+{
+	setupQuery();
+
+	uint8_t timesSeen[256] = {0};
+	page_t pages[MAXNUM_PAGES];
+
+	// five at a time through the same snapshot
+	uint32_t cursor = 0;
+	unsigned numRecords = 0;
+	for( size_t numQueries = 0; numQueries < 3; numQueries++ )
+	{
+		uint16_t queryId = getBeacons(cursor, 5, OVR_BEACONMANAGER_RPCINTERFACE_FIELD_RSSI, INT8_MIN);
+		stubHal_run_ms(1000, 10);
+
+		size_t numPages = collectPages(queryId, pages, timesSeen);
+		TEST_ASSERT(numPages > 0);
+		TEST_ASSERT_EQUAL_INT(numRecords, pages[0].offset);
+		for( size_t i = 0; i < numPages; i++ ) numRecords += pages[i].numRecords;
+
+		page_t* lastPage = &pages[numPages-1];
+		TEST_ASSERT_EQUAL_INT(1, lastPage->isLast);
+		cursor = lastPage->nextCursor;
+
+		// new beacons don't show up part way through
+		if( numQueries == 0 ) hearBeacons(0x80, 2, -60);
+	}
+	TEST_ASSERT_EQUAL_INT(NUM_BEACONS, numRecords);
+	TEST_ASSERT_EQUAL_INT(0, cursor);
+	for( int i = 1; i <= NUM_BEACONS; i++ ) TEST_ASSERT_EQUAL_INT(1, timesSeen[i]);
+	TEST_ASSERT_EQUAL_INT(0, timesSeen[0x80]);
+}
+
+
+static void test_staleCursorIsRejected(void)
+{
+	setupQuery();
+
+	uint16_t queryId = getBeacons(0, 5, OVR_BEACONMANAGER_RPCINTERFACE_FIELD_RSSI, INT8_MIN);
+	stubHal_run_ms(1000, 10);
+	page_t pages[MAXNUM_PAGES];
+	uint8_t timesSeen[256] = {0};
+	size_t numPages = collectPages(queryId, pages, timesSeen);
+	TEST_ASSERT(numPages > 0);
+	uint32_t cursor = pages[numPages-1].nextCursor;
+	TEST_ASSERT(cursor != 0);
+
+	// a new snapshot invalidates it
+	queryId = getBeacons(0, 5, OVR_BEACONMANAGER_RPCINTERFACE_FIELD_RSSI, INT8_MIN);
+	stubHal_run_ms(1000, 10);
+	numPages = collectPages(queryId, pages, timesSeen);
+	TEST_ASSERT(numPages > 0);
+	uint32_t newCursor = pages[numPages-1].nextCursor;
+	TEST_ASSERT((newCursor >> 16) != (cursor >> 16));
+
+	uint8_t params[12] = { cursor & 0xFF, (cursor >> 8) & 0xFF, (cursor >> 16) & 0xFF, (cursor >> 24) & 0xFF, 5, 0, 1, 0, (uint8_t)INT8_MIN, 0, 0, 0 };
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS, stubHal_callMethod("", "getBeacons", params, sizeof(params), NULL, 0, NULL));
+
+	// as does running off the end of the (current) snapshot
+	uint32_t pastEndCursor = (newCursor & 0xFFFF0000) | NUM_BEACONS;
+	for( size_t i = 0; i < 4; i++ ) params[i] = (pastEndCursor >> (8 * i)) & 0xFF;
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS, stubHal_callMethod("", "getBeacons", params, sizeof(params), NULL, 0, NULL));
+
+	// while the current one carries on
+	for( size_t i = 0; i < 4; i++ ) params[i] = (newCursor >> (8 * i)) & 0xFF;
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_RPC_METHODRETVAL_SUCCESS, stubHal_callMethod("", "getBeacons", params, sizeof(params), NULL, 0, NULL));
+}
+
+
+static void test_filtersApplyToSnapshot(void)
+{
+	setupQuery();
+	hearBeacons(0x40, 3, -90);
+
+	uint16_t queryId = getBeacons(0, 0, FIELDMASK_ALL, -70);
+	stubHal_run_ms(1000, 10);
+
+	page_t pages[MAXNUM_PAGES];
+	uint8_t timesSeen[256] = {0};
+	size_t numPages = collectPages(queryId, pages, timesSeen);
+	TEST_ASSERT(numPages > 0);
+	TEST_ASSERT_EQUAL_INT(NUM_BEACONS, pages[0].numMatches);
+	for( int i = 0; i < 3; i++ ) TEST_ASSERT_EQUAL_INT(0, timesSeen[0x40 + i]);
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_pagesFitSingleMessage),
+	TESTRUNNER_TEST(test_cursorContinuesSnapshot),
+	TESTRUNNER_TEST(test_staleCursorIsRejected),
+	TESTRUNNER_TEST(test_filtersApplyToSnapshot),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupQuery(void)
+{
+	cxa_mqtt_rpc_node_t* rootNode = stubHal_getRootNode();
+
+	ovr_config_init(rootNode);
+	ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+
+	stubHal_btle_init(&btleClient);
+	ovr_beaconManager_init(&beaconManager, &btleClient, rootNode, THREADID_BLUETOOTH, THREADID_NETWORK);
+	stubHal_btle_setReady(&btleClient);
+	stubHal_iterateAll();
+
+	stubHal_setUnixTime(UNIX_TIME);
+	hearBeacons(0x01, NUM_BEACONS, -60);
+	stubHal_run_ms(1000, 10);
+	stubHal_clearPublications();
+}
+
+
+static void hearBeacons(uint8_t firstEuiByteIn, size_t numBeaconsIn, int8_t rssi_dBmIn)
+{
+	for( int i = 0; i < OVR_BEACONMANAGER_FOUND_NUMADVERTS; i++ )
+	{
+		if( i > 0 ) stubHal_run_ms(1000, 10);
+		for( size_t j = 0; j < numBeaconsIn; j++ )
+		{
+			// every field enabled and at its widest
+			uint8_t advert[] =
+			{
+				0x00,											// devType
+				0x00, 0x11, 0x22, 0x33, 0x44, firstEuiByteIn + j,	// eui48
+				0x87,											// charging, accel/temp/light enabled
+				100,											// battery %
+				0x83, 0xFF,										// -12.5degC
+				0xFF,											// light
+				0x0F,											// every accel event
+				0x0C, 0x0E										// 3596mV
+			};
+			TEST_ASSERT(stubHal_btle_injectManData(&btleClient, rssi_dBmIn, COMPANY_ID, advert, sizeof(advert)));
+			stubHal_iterateAll();
+		}
+	}
+}
+
+
+static uint16_t getBeacons(uint32_t cursorIn, uint16_t maxNumBeaconsIn, uint16_t fieldMaskIn, int8_t minRssiIn)
+{
+	// [cursor:4][maxNumBeacons:2][fieldMask:2][minRssi:1][seenWithin_s:2][flags:1]
+	uint8_t params[] =
+	{
+		cursorIn & 0xFF, (cursorIn >> 8) & 0xFF, (cursorIn >> 16) & 0xFF, (cursorIn >> 24) & 0xFF,
+		maxNumBeaconsIn & 0xFF, maxNumBeaconsIn >> 8,
+		fieldMaskIn & 0xFF, fieldMaskIn >> 8,
+		(uint8_t)minRssiIn,
+		0, 0,
+		0
+	};
+
+	uint8_t response[2];
+	size_t responseSize_bytes = 0;
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_RPC_METHODRETVAL_SUCCESS, stubHal_callMethod("", "getBeacons", params, sizeof(params), response, sizeof(response), &responseSize_bytes));
+	TEST_ASSERT_EQUAL_INT(2, responseSize_bytes);
+
+	return response[0] | (response[1] << 8);
+}
+
+
+static size_t collectPages(uint16_t queryIdIn, page_t *const pagesOut, uint8_t *const timesSeenOut)
+{
+	size_t numPages = 0;
+	size_t index = 0;
+	stubHal_publication_t* currPub;
+	while( (currPub = stubHal_findPublication("onBeacons", &index)) != NULL )
+	{
+		index++;
+
+		char payload[sizeof(currPub->payload) + 1];
+		memcpy(payload, currPub->payload, currPub->payloadSize_bytes);
+		payload[currPub->payloadSize_bytes] = 0;
+		if( getMember(payload, "queryId") != queryIdIn ) continue;
+
+		TEST_ASSERT(numPages < MAXNUM_PAGES);
+		page_t* currPage = &pagesOut[numPages++];
+		currPage->queryId = queryIdIn;
+		currPage->numMatches = getMember(payload, "numMatches");
+		currPage->offset = getMember(payload, "offset");
+		currPage->isLast = getMember(payload, "isLast");
+		currPage->nextCursor = getMember(payload, "nextCursor");
+
+		// records are positional arrays starting with the beaconId
+		currPage->numRecords = 0;
+		for( char* match = strstr(payload, "[\"00:11:22:33:44:"); match != NULL; match = strstr(match + 1, "[\"00:11:22:33:44:") )
+		{
+			currPage->numRecords++;
+			timesSeenOut[strtoul(match + strlen("[\"00:11:22:33:44:"), NULL, 16)]++;
+		}
+	}
+	return numPages;
+}
+
+
+static unsigned long getMember(const char *const payloadIn, const char *const nameIn)
+{
+	char key[32];
+	snprintf(key, sizeof(key), "\"%s\":", nameIn);
+	char* match = strstr(payloadIn, key);
+	TEST_ASSERT(match != NULL);
+
+	return strtoul(match + strlen(key), NULL, 10);
+}
@@ -0,0 +1,304 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <string.h>
+#include <time.h>
+
+#include <cxa_btle_client.h>
+#include <stubHal.h>
+
+#include <ovr_beaconManager.h>
+#include <ovr_beaconRules.h>
+#include <ovr_config.h>
+#include <ovr_publishScheduler.h>
+
+
+// ******** local macro definitions ********
+#define COMPANY_ID						0x04A2
+#define UNIX_TIME						1500000000
+
+// as ovr_beaconGateway runs them
+#define THREADID_NETWORK				1
+#define THREADID_BLUETOOTH				3
+
+#define BENCH_NUMRULES					100
+#define BENCH_NUMBEACONS				500
+#define BENCH_NUMPASSES					20
+#define BENCH_STATE_LATCHED				0xFF
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void setupPipeline(void);
+static void injectAdvert(int16_t temp_deciDegCIn);
+static void makeUpdate(ovr_beaconUpdate_t *const updateOut);
+static bool evaluate(const char *const textIn, ovr_beaconUpdate_t *const updateIn);
+
+static double getTime_s(void);
+
+
+// ********  local variable declarations *********
+static cxa_btle_client_t btleClient;
+static ovr_beaconManager_t beaconManager;
+static ovr_beaconRules_t rules;
+
+static const char* benchRuleTexts[] =
+{
+	"temp_c > 8 for 2",
+	"freeFall",
+	"batt_pcnt100 < 10",
+	"rssi > -50 and not isCharging",
+	"temp_c >= 30 or temp_c < 2 for 3",
+	"light_255 > 200 and activity",
+};
+
+
+// ******** global function implementations ********
+static void test_compileAcceptsGrammarOnly(void)
+{
+	ovr_beaconRules_rule_t rule;
+
+	TEST_ASSERT(ovr_beaconRules_compile("freeFall", 0, &rule));
+	TEST_ASSERT_EQUAL_INT(1, rule.numConsecutive);
+	TEST_ASSERT(ovr_beaconRules_compile("temp_c > 8 for 2", 3, &rule));
+	TEST_ASSERT_EQUAL_INT(3, rule.id);
+	TEST_ASSERT_EQUAL_INT(2, rule.numConsecutive);
+	TEST_ASSERT(ovr_beaconRules_compile("not isCharging and batt_mv <= 2500 or 2tap", 0, &rule));
+	TEST_ASSERT(rule.codeSize_bytes <= OVR_BEACONRULES_MAXSIZE_BYTECODE);
+
+	TEST_ASSERT(!ovr_beaconRules_compile("", 0, &rule));
+	TEST_ASSERT(!ovr_beaconRules_compile("temp_c >", 0, &rule));
+	TEST_ASSERT(!ovr_beaconRules_compile("temp_c ~ 8", 0, &rule));
+	TEST_ASSERT(!ovr_beaconRules_compile("humidity > 8", 0, &rule));
+	TEST_ASSERT(!ovr_beaconRules_compile("temp_c > eight", 0, &rule));
+	TEST_ASSERT(!ovr_beaconRules_compile("and freeFall", 0, &rule));
+	TEST_ASSERT(!ovr_beaconRules_compile("freeFall for 0", 0, &rule));
+	TEST_ASSERT(!ovr_beaconRules_compile("freeFall for 128", 0, &rule));
+	TEST_ASSERT(!ovr_beaconRules_compile("freeFall for 2 and activity", 0, &rule));
+
+	// bounded by the bytecode, not just the text
+	TEST_ASSERT(!ovr_beaconRules_compile("temp_c > 1 and temp_c > 2 and temp_c > 3 and temp_c > 4 and temp_c > 5", 0, &rule));
+}
+
+
+static void test_evaluateFollowsFieldsLeftToRight(void)
+{
+	ovr_beaconUpdate_t update;
+	makeUpdate(&update);
+
+	update.currTemp_deciDegC = 81;
+	TEST_ASSERT(evaluate("temp_c > 8", &update));
+	update.currTemp_deciDegC = 80;
+	TEST_ASSERT(!evaluate("temp_c > 8", &update));
+	TEST_ASSERT(evaluate("temp_c >= 8", &update));
+	TEST_ASSERT(evaluate("temp_c == 8", &update));
+
+	update.rssi_dBm = -45;
+	TEST_ASSERT(evaluate("rssi > -50 and not isCharging", &update));
+	update.devStatus.isCharging = true;
+	TEST_ASSERT(!evaluate("rssi > -50 and not isCharging", &update));
+
+	// (freeFall or isCharging) and activity...no precedence
+	update.accelStatus.hasOccurred_freeFall = true;
+	TEST_ASSERT(!evaluate("freeFall or isCharging and activity", &update));
+	update.accelStatus.hasOccurred_activity = true;
+	TEST_ASSERT(evaluate("freeFall or isCharging and activity", &update));
+}
+
+
+static void test_alertFiresOnceThenRearms(void)
+{
+	setupPipeline();
+	TEST_ASSERT(ovr_beaconRules_setRule(&rules, 0, "temp_c > 8 for 2"));
+	stubHal_iterateAll();
+
+	// found (and evaluated) once enough adverts arrive, then alerts on the second warm update
+	for( int i = 0; i < OVR_BEACONMANAGER_FOUND_NUMADVERTS + 5; i++ )
+	{
+		injectAdvert(225);
+		stubHal_run_ms(1000, 10);
+	}
+	TEST_ASSERT_EQUAL_INT(1, stubHal_countPublications("onAlert"));
+
+	// a cool update re-arms it
+	injectAdvert(50);
+	stubHal_run_ms(1000, 10);
+	injectAdvert(225);
+	stubHal_run_ms(1000, 10);
+	TEST_ASSERT_EQUAL_INT(1, stubHal_countPublications("onAlert"));
+	injectAdvert(225);
+	stubHal_run_ms(1000, 10);
+	TEST_ASSERT_EQUAL_INT(2, stubHal_countPublications("onAlert"));
+
+	ovr_beaconRules_stats_t stats = ovr_beaconRules_getStats(&rules);
+	TEST_ASSERT_EQUAL_INT(2, stats.numAlerts);
+	TEST_ASSERT_EQUAL_INT(stats.numUpdates, stats.numEvaluations);
+}
+
+
+static void test_evaluationCostIsBounded(void)
+{
+	static ovr_beaconRules_rule_t benchRules[BENCH_NUMRULES];
+	static ovr_beaconUpdate_t updates[BENCH_NUMBEACONS];
+	static uint8_t states[BENCH_NUMBEACONS][BENCH_NUMRULES];
+
+	size_t numBenchRuleTexts = sizeof(benchRuleTexts) / sizeof(*benchRuleTexts);
+	for( size_t i = 0; i < BENCH_NUMRULES; i++ )
+	{
+		TEST_ASSERT(ovr_beaconRules_compile(benchRuleTexts[i % numBenchRuleTexts], i, &benchRules[i]));
+		TEST_ASSERT(benchRules[i].codeSize_bytes <= OVR_BEACONRULES_MAXSIZE_BYTECODE);
+	}
+
+	// spread values so every rule matches some of the time
+	for( size_t i = 0; i < BENCH_NUMBEACONS; i++ )
+	{
+		ovr_beaconUpdate_t* currUpdate = &updates[i];
+		makeUpdate(currUpdate);
+		currUpdate->rssi_dBm = -40 - (i % 60);
+		currUpdate->currTemp_deciDegC = (i * 7) % 400;
+		currUpdate->batt_pcnt100 = i % 101;
+		currUpdate->batt_mv = 2400 + (i % 700);
+		currUpdate->light_255 = (i * 13) % 256;
+		currUpdate->devStatus.isCharging = ((i % 5) == 0);
+		currUpdate->accelStatus.hasOccurred_activity = ((i % 3) == 0);
+		currUpdate->accelStatus.hasOccurred_freeFall = ((i % 50) == 0);
+	}
+	memset(states, 0, sizeof(states));
+
+	// same consecutive/latch handling as the update path, minus publishing
+	uint32_t numMatches = 0;
+	uint32_t numAlerts = 0;
+	double startTime_s = getTime_s();
+	for( size_t k = 0; k < BENCH_NUMPASSES; k++ )
+	{
+		for( size_t j = 0; j < BENCH_NUMBEACONS; j++ )
+		{
+			for( size_t i = 0; i < BENCH_NUMRULES; i++ )
+			{
+				if( !ovr_beaconRules_evaluate(&benchRules[i], &updates[j]) )
+				{
+					states[j][i] = 0;
+					continue;
+				}
+				numMatches++;
+				if( states[j][i] == BENCH_STATE_LATCHED ) continue;
+
+				uint8_t count = states[j][i] + 1;
+				if( count >= benchRules[i].numConsecutive )
+				{
+					states[j][i] = BENCH_STATE_LATCHED;
+					numAlerts++;
+				}
+				else
+				{
+					states[j][i] = count;
+				}
+			}
+		}
+	}
+	double elapsed_s = getTime_s() - startTime_s;
+
+	// every rule matched somewhere and each match alerted at most once
+	TEST_ASSERT(numMatches > 0);
+	TEST_ASSERT(numAlerts <= numMatches);
+	for( size_t i = 0; i < BENCH_NUMRULES; i++ )
+	{
+		bool hasMatched = false;
+		for( size_t j = 0; (j < BENCH_NUMBEACONS) && !hasMatched; j++ ) hasMatched = ovr_beaconRules_evaluate(&benchRules[i], &updates[j]);
+		TEST_ASSERT(hasMatched);
+	}
+
+	double numUpdates = (double)BENCH_NUMPASSES * BENCH_NUMBEACONS;
+	testRunner_report("beaconRules", "perUpdate_us", (elapsed_s * 1e6) / numUpdates);
+	testRunner_report("beaconRules", "perRule_ns", (elapsed_s * 1e9) / (numUpdates * BENCH_NUMRULES));
+	testRunner_report("beaconRules", "matchRate_pcnt", (numMatches * 100.0) / (numUpdates * BENCH_NUMRULES));
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_compileAcceptsGrammarOnly),
+	TESTRUNNER_TEST(test_evaluateFollowsFieldsLeftToRight),
+	TESTRUNNER_TEST(test_alertFiresOnceThenRearms),
+	TESTRUNNER_TEST(test_evaluationCostIsBounded),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupPipeline(void)
+{
+	cxa_mqtt_rpc_node_t* rootNode = stubHal_getRootNode();
+
+	ovr_config_init(rootNode);
+	ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+
+	stubHal_btle_init(&btleClient);
+	ovr_beaconManager_init(&beaconManager, &btleClient, rootNode, THREADID_BLUETOOTH, THREADID_NETWORK);
+	ovr_beaconRules_init(&rules, &beaconManager, rootNode, THREADID_BLUETOOTH);
+	stubHal_btle_setReady(&btleClient);
+	stubHal_setUnixTime(UNIX_TIME);
+	stubHal_iterateAll();
+}
+
+
+static void injectAdvert(int16_t temp_deciDegCIn)
+{
+	uint8_t advert[] =
+	{
+		0x00,									// devType
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x01,		// eui48
+		0x07,									// status (all sensors enabled)
+		80,										// battery %
+		(uint8_t)temp_deciDegCIn, (uint8_t)(temp_deciDegCIn >> 8),
+		0x40,									// light
+		0x00,									// accel status
+		0x0C, 0x0E								// 3596mV
+	};
+	TEST_ASSERT(stubHal_btle_injectManData(&btleClient, -60, COMPANY_ID, advert, sizeof(advert)));
+}
+
+
+static void makeUpdate(ovr_beaconUpdate_t *const updateOut)
+{
+	memset(updateOut, 0, sizeof(*updateOut));
+	updateOut->rssi_dBm = -70;
+	updateOut->currTemp_deciDegC = 215;
+	updateOut->batt_pcnt100 = 90;
+	updateOut->batt_mv = 2950;
+	updateOut->light_255 = 128;
+}
+
+
+static bool evaluate(const char *const textIn, ovr_beaconUpdate_t *const updateIn)
+{
+	ovr_beaconRules_rule_t rule;
+	TEST_ASSERT(ovr_beaconRules_compile(textIn, 0, &rule));
+	return ovr_beaconRules_evaluate(&rule, updateIn);
+}
+
+
+static double getTime_s(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + (now.tv_nsec / 1e9);
+}
@@ -0,0 +1,203 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <ovr_linkSelector.h>
+
+
+// ******** local macro definitions ********
+#define ETH								OVR_LINKSELECTOR_LINK_ETH
+#define WIFI							OVR_LINKSELECTOR_LINK_WIFI
+#define NONE							OVR_LINKSELECTOR_LINK_NONE
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void bringUp(ovr_linkSelector_t *const lsIn, ovr_linkSelector_link_t linkIn, uint32_t now_msIn);
+
+
+// ********  local variable declarations *********
+
+
+// ******** global function implementations ********
+static void test_firstUsableLinkIsSelected(void)
+{
+	ovr_linkSelector_t ls;
+	ovr_linkSelector_init(&ls, ETH);
+	TEST_ASSERT_EQUAL_INT(NONE, ovr_linkSelector_getActiveLink(&ls));
+
+	// up without an address isn't usable
+	TEST_ASSERT(!ovr_linkSelector_onEvent(&ls, WIFI, OVR_LINKSELECTOR_EVENT_LINKUP, 0));
+	TEST_ASSERT(ovr_linkSelector_onEvent(&ls, WIFI, OVR_LINKSELECTOR_EVENT_GOTIP, 10));
+	TEST_ASSERT_EQUAL_INT(WIFI, ovr_linkSelector_getActiveLink(&ls));
+}
+
+
+static void test_failoverToStandby(void)
+{
+	ovr_linkSelector_t ls;
+	ovr_linkSelector_init(&ls, ETH);
+	bringUp(&ls, ETH, 0);
+	bringUp(&ls, WIFI, 0);
+	TEST_ASSERT_EQUAL_INT(ETH, ovr_linkSelector_getActiveLink(&ls));
+
+	TEST_ASSERT(ovr_linkSelector_onEvent(&ls, ETH, OVR_LINKSELECTOR_EVENT_LINKDOWN, 1000));
+	TEST_ASSERT_EQUAL_INT(WIFI, ovr_linkSelector_getActiveLink(&ls));
+
+	ovr_linkSelector_stats_t stats = ovr_linkSelector_getStats(&ls);
+	TEST_ASSERT_EQUAL_INT(1, stats.numFailovers);
+	TEST_ASSERT_EQUAL_INT(0, stats.numOutages);
+	TEST_ASSERT_EQUAL_INT(0, stats.lastFailoverLatency_ms);
+}
+
+
+static void test_failoverLatencyWhenStandbyIsLate(void)
+{
+	ovr_linkSelector_t ls;
+	ovr_linkSelector_init(&ls, ETH);
+	bringUp(&ls, ETH, 0);
+	ovr_linkSelector_onEvent(&ls, WIFI, OVR_LINKSELECTOR_EVENT_LINKUP, 0);
+
+	// wifi is associated but still waiting on dhcp
+	TEST_ASSERT(ovr_linkSelector_onEvent(&ls, ETH, OVR_LINKSELECTOR_EVENT_LINKDOWN, 1000));
+	TEST_ASSERT_EQUAL_INT(NONE, ovr_linkSelector_getActiveLink(&ls));
+	TEST_ASSERT_EQUAL_INT(1, ovr_linkSelector_getStats(&ls).numOutages);
+
+	TEST_ASSERT(ovr_linkSelector_onEvent(&ls, WIFI, OVR_LINKSELECTOR_EVENT_GOTIP, 3500));
+	TEST_ASSERT_EQUAL_INT(WIFI, ovr_linkSelector_getActiveLink(&ls));
+
+	ovr_linkSelector_stats_t stats = ovr_linkSelector_getStats(&ls);
+	TEST_ASSERT_EQUAL_INT(1, stats.numFailovers);
+	TEST_ASSERT_EQUAL_INT(2500, stats.lastFailoverLatency_ms);
+	TEST_ASSERT_EQUAL_INT(2500, stats.maxFailoverLatency_ms);
+}
+
+
+static void test_lostLinkReturningIsNotAFailover(void)
+{
+	ovr_linkSelector_t ls;
+	ovr_linkSelector_init(&ls, ETH);
+	bringUp(&ls, ETH, 0);
+
+	ovr_linkSelector_onEvent(&ls, ETH, OVR_LINKSELECTOR_EVENT_LOSTIP, 1000);
+	TEST_ASSERT_EQUAL_INT(NONE, ovr_linkSelector_getActiveLink(&ls));
+	ovr_linkSelector_onEvent(&ls, ETH, OVR_LINKSELECTOR_EVENT_GOTIP, 2000);
+	TEST_ASSERT_EQUAL_INT(ETH, ovr_linkSelector_getActiveLink(&ls));
+
+	ovr_linkSelector_stats_t stats = ovr_linkSelector_getStats(&ls);
+	TEST_ASSERT_EQUAL_INT(0, stats.numFailovers);
+	TEST_ASSERT_EQUAL_INT(1, stats.numOutages);
+}
+
+
+static void test_failbackWaitsForHoldoff(void)
+{
+	ovr_linkSelector_t ls;
+	ovr_linkSelector_init(&ls, ETH);
+	bringUp(&ls, ETH, 0);
+	bringUp(&ls, WIFI, 0);
+	ovr_linkSelector_onEvent(&ls, ETH, OVR_LINKSELECTOR_EVENT_LINKDOWN, 1000);
+	TEST_ASSERT_EQUAL_INT(WIFI, ovr_linkSelector_getActiveLink(&ls));
+
+	// the preferred link comes back...we stay on wifi until it's proven itself
+	bringUp(&ls, ETH, 2000);
+	TEST_ASSERT_EQUAL_INT(WIFI, ovr_linkSelector_getActiveLink(&ls));
+	TEST_ASSERT(!ovr_linkSelector_update(&ls, 2000 + OVR_LINKSELECTOR_FAILBACK_HOLDOFF_MS - 1));
+	TEST_ASSERT_EQUAL_INT(WIFI, ovr_linkSelector_getActiveLink(&ls));
+
+	TEST_ASSERT(ovr_linkSelector_update(&ls, 2000 + OVR_LINKSELECTOR_FAILBACK_HOLDOFF_MS));
+	TEST_ASSERT_EQUAL_INT(ETH, ovr_linkSelector_getActiveLink(&ls));
+
+	// failing back isn't a failover
+	ovr_linkSelector_stats_t stats = ovr_linkSelector_getStats(&ls);
+	TEST_ASSERT_EQUAL_INT(1, stats.numFailovers);
+	TEST_ASSERT_EQUAL_INT(3, stats.numLinkChanges);
+}
+
+
+static void test_flappingPreferredLinkDoesNotBounce(void)
+{
+	ovr_linkSelector_t ls;
+	ovr_linkSelector_init(&ls, ETH);
+	bringUp(&ls, ETH, 0);
+	bringUp(&ls, WIFI, 0);
+	ovr_linkSelector_onEvent(&ls, ETH, OVR_LINKSELECTOR_EVENT_LINKDOWN, 1000);
+
+	// a bad cable: up for a second, down for a second, for a minute
+	uint32_t now_ms = 1000;
+	for( int i = 0; i < 30; i++ )
+	{
+		now_ms += 1000;
+		bringUp(&ls, ETH, now_ms);
+		ovr_linkSelector_update(&ls, now_ms + 500);
+		now_ms += 1000;
+		ovr_linkSelector_onEvent(&ls, ETH, OVR_LINKSELECTOR_EVENT_LINKDOWN, now_ms);
+		TEST_ASSERT_EQUAL_INT(WIFI, ovr_linkSelector_getActiveLink(&ls));
+	}
+
+	ovr_linkSelector_stats_t stats = ovr_linkSelector_getStats(&ls);
+	TEST_ASSERT_EQUAL_INT(2, stats.numLinkChanges);
+	TEST_ASSERT_EQUAL_INT(1, stats.numFailovers);
+	testRunner_report("linkFlap", "numLinkChanges", stats.numLinkChanges);
+
+	// and once it settles we go back
+	bringUp(&ls, ETH, now_ms);
+	TEST_ASSERT(ovr_linkSelector_update(&ls, now_ms + OVR_LINKSELECTOR_FAILBACK_HOLDOFF_MS));
+	TEST_ASSERT_EQUAL_INT(ETH, ovr_linkSelector_getActiveLink(&ls));
+}
+
+
+static void test_standbyLossWhileOnPreferred(void)
+{
+	ovr_linkSelector_t ls;
+	ovr_linkSelector_init(&ls, ETH);
+	bringUp(&ls, ETH, 0);
+	bringUp(&ls, WIFI, 0);
+
+	TEST_ASSERT(!ovr_linkSelector_onEvent(&ls, WIFI, OVR_LINKSELECTOR_EVENT_LINKDOWN, 1000));
+	TEST_ASSERT_EQUAL_INT(ETH, ovr_linkSelector_getActiveLink(&ls));
+
+	// with nothing to fail over to, losing eth is an outage
+	TEST_ASSERT(ovr_linkSelector_onEvent(&ls, ETH, OVR_LINKSELECTOR_EVENT_LINKDOWN, 2000));
+	TEST_ASSERT_EQUAL_INT(NONE, ovr_linkSelector_getActiveLink(&ls));
+	TEST_ASSERT_EQUAL_INT(1, ovr_linkSelector_getStats(&ls).numOutages);
+	TEST_ASSERT_EQUAL_INT(0, ovr_linkSelector_getStats(&ls).numFailovers);
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_firstUsableLinkIsSelected),
+	TESTRUNNER_TEST(test_failoverToStandby),
+	TESTRUNNER_TEST(test_failoverLatencyWhenStandbyIsLate),
+	TESTRUNNER_TEST(test_lostLinkReturningIsNotAFailover),
+	TESTRUNNER_TEST(test_failbackWaitsForHoldoff),
+	TESTRUNNER_TEST(test_flappingPreferredLinkDoesNotBounce),
+	TESTRUNNER_TEST(test_standbyLossWhileOnPreferred),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void bringUp(ovr_linkSelector_t *const lsIn, ovr_linkSelector_link_t linkIn, uint32_t now_msIn)
+{
+	ovr_linkSelector_onEvent(lsIn, linkIn, OVR_LINKSELECTOR_EVENT_LINKUP, now_msIn);
+	ovr_linkSelector_onEvent(lsIn, linkIn, OVR_LINKSELECTOR_EVENT_GOTIP, now_msIn);
+}
@@ -0,0 +1,273 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_btle_client.h>
+#include <cxa_ioStream.h>
+#include <cxa_timeBase.h>
+#include <stubHal.h>
+
+#include <ovr_beaconManager.h>
+#include <ovr_config.h>
+#include <ovr_loadGenerator.h>
+#include <ovr_publishScheduler.h>
+
+
+// ******** local macro definitions ********
+#define UNIX_TIME						1500000000
+
+// as ovr_beaconGateway runs them
+#define THREADID_NETWORK				1
+#define THREADID_BLUETOOTH				3
+
+#define MAXSIZE_JSON_BYTES				1024
+
+// the bluetooth thread gets to run this often while the sweep is loaded
+#define SWEEP_STEP_MS					100
+#define SWEEP_NUMBEACONS				64
+#define SWEEP_DURATION_MS				600000
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void setupPipeline(ovr_beaconManager_capacities_t *const capsIn);
+static ovr_loadGenerator_report_t runScenario(ovr_loadGenerator_scenario_t *const scenarioIn, uint32_t step_msIn);
+
+static bool ioCb_writeBytes(void* buffIn, size_t bufferSize_bytesIn, void *const userVarIn);
+
+
+// ********  local variable declarations *********
+static cxa_btle_client_t btleClient;
+static ovr_beaconManager_t beaconManager;
+static ovr_loadGenerator_t loadGenerator;
+
+static char json[MAXSIZE_JSON_BYTES];
+static size_t jsonSize_bytes;
+
+
+// ******** global function implementations ********
+static void test_sameSeedSameReport(void)
+{
+	ovr_loadGenerator_scenario_t scenario;
+	ovr_loadGenerator_getDefaultScenario(&scenario);
+	scenario.duration_ms = 120000;
+
+	setupPipeline(NULL);
+	ovr_loadGenerator_report_t firstReport = runScenario(&scenario, 10);
+
+	stubHal_reset();
+	setupPipeline(NULL);
+	ovr_loadGenerator_report_t secondReport = runScenario(&scenario, 10);
+
+	TEST_ASSERT(firstReport.numAdverts > 0);
+	TEST_ASSERT_EQUAL_INT(firstReport.numAdverts, secondReport.numAdverts);
+	TEST_ASSERT_EQUAL_INT(firstReport.numNoiseAdverts, secondReport.numNoiseAdverts);
+	TEST_ASSERT_EQUAL_INT(firstReport.numAccepted, secondReport.numAccepted);
+	TEST_ASSERT_EQUAL_INT(firstReport.numJoins, secondReport.numJoins);
+	TEST_ASSERT_EQUAL_INT(firstReport.numFound, secondReport.numFound);
+	TEST_ASSERT_EQUAL_INT(firstReport.publish.numPublishes, secondReport.publish.numPublishes);
+	TEST_ASSERT_EQUAL_INT(firstReport.publish.numBytes, secondReport.publish.numBytes);
+
+	// ...and a different seed gives a different fleet
+	stubHal_reset();
+	setupPipeline(NULL);
+	scenario.seed = 2;
+	ovr_loadGenerator_report_t otherReport = runScenario(&scenario, 10);
+	TEST_ASSERT(otherReport.numAdverts != firstReport.numAdverts);
+}
+
+
+static void test_scenarioRunsOnManagerTime(void)
+{
+	ovr_loadGenerator_scenario_t scenario;
+	ovr_loadGenerator_getDefaultScenario(&scenario);
+	scenario.numBeacons = OVR_BEACONMANAGER_MAXNUM_BEACONS;
+	scenario.duration_ms = 60000;
+	scenario.meanDwell_ms = 0;
+
+	setupPipeline(NULL);
+	uint32_t startTime_ms = cxa_timeBase_getCount_us() / 1000;
+	ovr_loadGenerator_report_t report = runScenario(&scenario, 10);
+	uint32_t elapsed_ms = (cxa_timeBase_getCount_us() / 1000) - startTime_ms;
+
+	// the scenario took exactly as long on the manager's clock as it says it did
+	TEST_ASSERT_EQUAL_INT(scenario.duration_ms, report.duration_ms);
+	TEST_ASSERT(elapsed_ms >= scenario.duration_ms);
+	TEST_ASSERT(elapsed_ms <= scenario.duration_ms + 10);
+
+	// every beacon advertises at least every advertInterval_max_ms (+10%)
+	uint32_t minNumAdverts = scenario.numBeacons * (scenario.duration_ms / ((scenario.advertInterval_max_ms * 11) / 10));
+	uint32_t maxNumAdverts = scenario.numBeacons * ((scenario.duration_ms / ((scenario.advertInterval_min_ms * 9) / 10)) + 1);
+	TEST_ASSERT(report.numAdverts >= minNumAdverts);
+	TEST_ASSERT(report.numAdverts <= maxNumAdverts);
+	TEST_ASSERT_EQUAL_INT((scenario.duration_ms / 1000) * scenario.noiseRate_perSec, report.numNoiseAdverts);
+
+	// no churn and room for all...everyone is found once and nobody is lost
+	TEST_ASSERT_EQUAL_INT(scenario.numBeacons, report.numFound);
+	TEST_ASSERT_EQUAL_INT(0, report.numLost);
+	TEST_ASSERT_EQUAL_INT(0, report.pipeline.numAdvertsDropped);
+	TEST_ASSERT_EQUAL_INT(report.numAdverts + report.numNoiseAdverts, report.pipeline.numAdvertsRx);
+}
+
+
+static void test_churnIsFoundAndLost(void)
+{
+	ovr_loadGenerator_scenario_t scenario;
+	ovr_loadGenerator_getDefaultScenario(&scenario);
+	scenario.numBeacons = 16;
+	scenario.duration_ms = 1800000;
+	scenario.meanDwell_ms = 240000;
+	scenario.meanAbsence_ms = 3 * ovr_config_get(OVR_CONFIG_ID_LOSTTIMEOUT_MS);
+
+	setupPipeline(NULL);
+	ovr_loadGenerator_report_t report = runScenario(&scenario, 100);
+
+	TEST_ASSERT(report.numLeaves > 0);
+	TEST_ASSERT(report.numJoins > 0);
+
+	// leavers are lost (unless the scenario ended first) and rejoiners found again
+	TEST_ASSERT(report.numLost > 0);
+	TEST_ASSERT(report.numLost <= report.numLeaves);
+	TEST_ASSERT(report.numFound > scenario.numBeacons);
+	TEST_ASSERT(report.numFound <= scenario.numBeacons + report.numJoins);
+
+	cxa_ioStream_t ioStream;
+	cxa_ioStream_init(&ioStream);
+	cxa_ioStream_bind(&ioStream, NULL, ioCb_writeBytes, NULL);
+	jsonSize_bytes = 0;
+	memset(json, 0, sizeof(json));
+	ovr_loadGenerator_writeReport(&loadGenerator, &ioStream);
+
+	char expected[64];
+	TEST_ASSERT(json[0] == '{');
+	TEST_ASSERT(strstr(json, "\"running\":0,") != NULL);
+	snprintf(expected, sizeof(expected), "\"lost\":%u,", (unsigned)report.numLost);
+	TEST_ASSERT(strstr(json, expected) != NULL);
+	snprintf(expected, sizeof(expected), "\"duration_ms\":%u,", (unsigned)scenario.duration_ms);
+	TEST_ASSERT(strstr(json, expected) != NULL);
+}
+
+
+static void test_capacitySweep(void)
+{
+	static const uint16_t tableSizes[] = {16, 32, 64};
+	static const uint16_t fifoSizes[] = {4, 8, 16};
+
+	ovr_loadGenerator_scenario_t scenario;
+	ovr_loadGenerator_getDefaultScenario(&scenario);
+	scenario.numBeacons = SWEEP_NUMBEACONS;
+	scenario.duration_ms = SWEEP_DURATION_MS;
+
+	for( size_t i = 0; i < (sizeof(tableSizes) / sizeof(*tableSizes)); i++ )
+	{
+		for( size_t j = 0; j < (sizeof(fifoSizes) / sizeof(*fifoSizes)); j++ )
+		{
+			ovr_beaconManager_capacities_t caps = {
+					.maxNumBeacons = tableSizes[i],
+					.rxFifoSize_elems = fifoSizes[j],
+					.maxNumListeners = OVR_BEACONMANAGER_MAXNUM_LISTENERS
+			};
+			stubHal_reset();
+			setupPipeline(&caps);
+			TEST_ASSERT_EQUAL_INT(tableSizes[i], ovr_beaconManager_getCapacities(&beaconManager).maxNumBeacons);
+
+			ovr_loadGenerator_report_t report = runScenario(&scenario, SWEEP_STEP_MS);
+			uint32_t numIngested = report.numAdverts + report.numNoiseAdverts;
+			TEST_ASSERT_EQUAL_INT(numIngested, report.pipeline.numAdvertsRx);
+
+			char key[48];
+			int prefixLen = snprintf(key, sizeof(key), "beacons%d_fifo%d_", tableSizes[i], fifoSizes[j]);
+
+			snprintf(&key[prefixLen], sizeof(key) - prefixLen, "advertsPerSec");
+			testRunner_report("loadGenerator", key, (numIngested * 1000.0) / report.duration_ms);
+			snprintf(&key[prefixLen], sizeof(key) - prefixLen, "dropRate_ppm");
+			testRunner_report("loadGenerator", key, (report.pipeline.numAdvertsDropped * 1e6) / numIngested);
+			snprintf(&key[prefixLen], sizeof(key) - prefixLen, "found");
+			testRunner_report("loadGenerator", key, report.numFound);
+			snprintf(&key[prefixLen], sizeof(key) - prefixLen, "lost");
+			testRunner_report("loadGenerator", key, report.numLost);
+			snprintf(&key[prefixLen], sizeof(key) - prefixLen, "publishes");
+			testRunner_report("loadGenerator", key, report.publish.numPublishes);
+			snprintf(&key[prefixLen], sizeof(key) - prefixLen, "bytesPerMin");
+			testRunner_report("loadGenerator", key, (report.publish.numBytes * 60000.0) / report.duration_ms);
+		}
+	}
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_sameSeedSameReport),
+	TESTRUNNER_TEST(test_scenarioRunsOnManagerTime),
+	TESTRUNNER_TEST(test_churnIsFoundAndLost),
+	TESTRUNNER_TEST(test_capacitySweep),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupPipeline(ovr_beaconManager_capacities_t *const capsIn)
+{
+	cxa_mqtt_rpc_node_t* rootNode = stubHal_getRootNode();
+
+	// capacities are picked up at boot
+	if( capsIn != NULL )
+	{
+		ovr_config_init(rootNode);
+		ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+		stubHal_btle_init(&btleClient);
+		ovr_beaconManager_init(&beaconManager, &btleClient, rootNode, THREADID_BLUETOOTH, THREADID_NETWORK);
+		TEST_ASSERT(ovr_beaconManager_saveCapacities(&beaconManager, *capsIn));
+		stubHal_reboot();
+	}
+
+	ovr_config_init(rootNode);
+	ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+
+	stubHal_btle_init(&btleClient);
+	ovr_beaconManager_init(&beaconManager, &btleClient, rootNode, THREADID_BLUETOOTH, THREADID_NETWORK);
+	ovr_loadGenerator_init(&loadGenerator, &beaconManager, THREADID_BLUETOOTH);
+	stubHal_btle_setReady(&btleClient);
+	stubHal_setUnixTime(UNIX_TIME);
+	stubHal_iterateAll();
+}
+
+
+static ovr_loadGenerator_report_t runScenario(ovr_loadGenerator_scenario_t *const scenarioIn, uint32_t step_msIn)
+{
+	TEST_ASSERT(ovr_loadGenerator_start(&loadGenerator, scenarioIn));
+	while( ovr_loadGenerator_isRunning(&loadGenerator) ) stubHal_run_ms(step_msIn, step_msIn);
+
+	return ovr_loadGenerator_getReport(&loadGenerator);
+}
+
+
+static bool ioCb_writeBytes(void* buffIn, size_t bufferSize_bytesIn, void *const userVarIn)
+{
+	size_t numToCopy = sizeof(json) - 1 - jsonSize_bytes;
+	if( numToCopy > bufferSize_bytesIn ) numToCopy = bufferSize_bytesIn;
+
+	memcpy(&json[jsonSize_bytes], buffIn, numToCopy);
+	jsonSize_bytes += numToCopy;
+	return true;
+}
@@ -0,0 +1,438 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_ioStream.h>
+#include <cxa_logger_header.h>
+#include <stubHal.h>
+
+#include <ovr_logStream.h>
+
+#define OVR_BINLOG_LEVEL				CXA_LOG_LEVEL_TRACE
+#include <ovr_binLog.h>
+
+#define CXA_LOG_LEVEL					CXA_LOG_LEVEL_TRACE
+#include <cxa_logger_implementation.h>
+
+
+// ******** local macro definitions ********
+// as ovr_beaconGateway runs them
+#define THREADID_NETWORK				1
+#define THREADID_UI						2
+
+#define MAXNUM_LINES					64
+#define LINE_MAXSIZE_BYTES				OVR_LOGSTREAM_LINE_MAXSIZE_BYTES
+
+// rpc getLogStats response
+#define LOGSTATS_SIZE_BYTES				22
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void setupLogStream(uint8_t minLevelIn);
+static void runPeriods(size_t numPeriodsIn);
+static size_t collectLines(void);
+static int findLine(const char *const textIn);
+static bool isStreamed(const char *const textIn);
+static size_t getLineIndex(const char *const textIn);
+static void setLogFilter(bool isEnabledIn, uint8_t minLevelIn, const char *const moduleIn);
+static ovr_logStream_stats_t getLogStats(void);
+
+static bool ioStreamCb_writeBytes(void* buffIn, size_t bufferSize_bytesIn, void *const userVarIn);
+static cxa_ioStream_readStatus_t ioStreamCb_readByte(uint8_t *const byteOut, void *const userVarIn);
+
+
+// ********  local variable declarations *********
+static ovr_logStream_t logStream;
+static cxa_logger_t logger;
+static cxa_logger_t logger_rules;
+
+// what the uart would have printed
+static cxa_ioStream_t ioStream_local;
+static size_t numLocalLines;
+
+// every streamed line so far, in the order they were published
+static char lines[MAXNUM_LINES][LINE_MAXSIZE_BYTES];
+static size_t numLines;
+
+
+// ******** global function implementations ********
+static void test_linesKeepTheirOrder(void)
+{
+	setupLogStream(CXA_LOG_LEVEL_INFO);
+
+	for( int i = 0; i < 10; i++ ) cxa_logger_info(&logger, "line %02d", i);
+	runPeriods(1);
+
+	TEST_ASSERT_EQUAL_INT(10, collectLines());
+	for( int i = 0; i < 10; i++ )
+	{
+		char text[16];
+		snprintf(text, sizeof(text), "line %02d", i);
+		TEST_ASSERT_EQUAL_INT(i, getLineIndex(text));
+	}
+
+	// batched into messages, still echoed locally
+	TEST_ASSERT(stubHal_countPublications("onLog") < 10);
+	TEST_ASSERT_EQUAL_INT(10, numLocalLines);
+	TEST_ASSERT_EQUAL_INT(10, getLogStats().numLinesPublished);
+}
+
+
+static void test_filtersChangeAtRuntime(void)
+{
+	setupLogStream(CXA_LOG_LEVEL_INFO);
+
+	// off by default
+	setLogFilter(false, CXA_LOG_LEVEL_INFO, "");
+	cxa_logger_error(&logger, "while disabled");
+	runPeriods(1);
+	TEST_ASSERT_EQUAL_INT(0, stubHal_countPublications("onLog"));
+	TEST_ASSERT_EQUAL_INT(1, numLocalLines);
+
+	setLogFilter(true, CXA_LOG_LEVEL_WARN, "");
+	cxa_logger_warn(&logger, "warn kept");
+	cxa_logger_info(&logger, "info filtered");
+	setLogFilter(true, CXA_LOG_LEVEL_DEBUG, "rules");
+	cxa_logger_debug(&logger_rules, "rules debug kept");
+	cxa_logger_error(&logger, "other module filtered");
+	runPeriods(1);
+
+	collectLines();
+	TEST_ASSERT(isStreamed("warn kept"));
+	TEST_ASSERT(isStreamed("rules debug kept"));
+	TEST_ASSERT(!isStreamed("while disabled"));
+	TEST_ASSERT(!isStreamed("info filtered"));
+	TEST_ASSERT(!isStreamed("other module filtered"));
+
+	ovr_logStream_stats_t stats = getLogStats();
+	TEST_ASSERT_EQUAL_INT(2, stats.numLinesQueued);
+	TEST_ASSERT_EQUAL_INT(2, stats.numLinesFiltered);
+	TEST_ASSERT_EQUAL_INT(5, numLocalLines);
+
+	// a level beyond TRACE is refused
+	uint8_t params[] = { 1, CXA_LOG_LEVEL_TRACE + 1 };
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_RPC_METHODRETVAL_FAIL_INVALIDPARAMS, stubHal_callMethod("diagnostics", "setLogFilter", params, sizeof(params), NULL, 0, NULL));
+}
+
+
+static void test_lowestLevelsDroppedFirst(void)
+{
+	setupLogStream(CXA_LOG_LEVEL_TRACE);
+	TEST_ASSERT_EQUAL_INT(32, OVR_LOGSTREAM_NUM_SLOTS);
+
+	// fill the ring before the first publish
+	for( int i = 0; i < 8; i++ ) cxa_logger_debug(&logger, "debug %d", i);
+	for( int i = 0; i < 8; i++ ) cxa_logger_info(&logger, "info %d", i);
+	for( int i = 0; i < 8; i++ ) cxa_logger_warn(&logger, "warn %d", i);
+	for( int i = 0; i < 8; i++ ) cxa_logger_error(&logger, "error %d", i);
+	TEST_ASSERT_EQUAL_INT(0, getLogStats().numLinesDropped);
+
+	// displaces every debug line, then the oldest infos...
+	for( int i = 8; i < 16; i++ ) cxa_logger_warn(&logger, "warn %d", i);
+	for( int i = 8; i < 12; i++ ) cxa_logger_info(&logger, "info %d", i);
+
+	// ...and a line less important than everything held doesn't get in
+	cxa_logger_trace(&logger, "trace");
+	TEST_ASSERT_EQUAL_INT(13, getLogStats().numLinesDropped);
+
+	runPeriods(8);
+	TEST_ASSERT_EQUAL_INT(OVR_LOGSTREAM_NUM_SLOTS, collectLines());
+	TEST_ASSERT(!isStreamed("trace"));
+	for( int i = 0; i < 8; i++ )
+	{
+		char text[16];
+		snprintf(text, sizeof(text), "debug %d", i);
+		TEST_ASSERT(!isStreamed(text));
+		snprintf(text, sizeof(text), "info %d", i);
+		TEST_ASSERT(isStreamed(text) == (i >= 4));
+	}
+
+	// what survived still goes out in the order it was logged
+	static const char* expectedOrder[] = { "info 4", "info 7", "warn 0", "warn 7", "error 0", "error 7", "warn 8", "warn 15", "info 8", "info 11" };
+	for( size_t i = 1; i < (sizeof(expectedOrder)/sizeof(*expectedOrder)); i++ )
+	{
+		TEST_ASSERT(getLineIndex(expectedOrder[i-1]) < getLineIndex(expectedOrder[i]));
+	}
+}
+
+
+static void test_bytesCappedPerPeriod(void)
+{
+	setupLogStream(CXA_LOG_LEVEL_INFO);
+
+	// ~6x what may go out in one period
+	for( int i = 0; i < 30; i++ ) cxa_logger_info(&logger, "line %02d padded out to about a hundred bytes ....................................", i);
+
+	size_t numPeriods = 0;
+	size_t numPublished = 0;
+	while( numPublished < 30 )
+	{
+		TEST_ASSERT(numPeriods < 30);
+		stubHal_clearPublications();
+		runPeriods(1);
+		numPeriods++;
+
+		size_t numBytes = 0;
+		size_t index = 0;
+		stubHal_publication_t* currPub;
+		while( (currPub = stubHal_findPublication("onLog", &index)) != NULL )
+		{
+			index++;
+			numBytes += currPub->payloadSize_bytes;
+		}
+		TEST_ASSERT(numBytes > 0);
+		TEST_ASSERT(numBytes <= OVR_LOGSTREAM_MAXBYTES_PER_PERIOD);
+
+		numPublished = getLogStats().numLinesPublished;
+	}
+	testRunner_report("bytesCappedPerPeriod", "periodsToDrain", numPeriods);
+	TEST_ASSERT(numPeriods >= ((30 * 100) / OVR_LOGSTREAM_MAXBYTES_PER_PERIOD));
+	TEST_ASSERT_EQUAL_INT(0, getLogStats().numLinesDropped);
+}
+
+
+static void test_congestionBacksOff(void)
+{
+	setupLogStream(CXA_LOG_LEVEL_INFO);
+
+	cxa_logger_info(&logger, "stuck");
+	stubHal_mqtt_setConnected(false);
+
+	// fails in periods 1, 3 and 6 (skipping 1, then 2, then 4)
+	runPeriods(10);
+	TEST_ASSERT_EQUAL_INT(3, getLogStats().numPublishFailures);
+
+	// while backed off, the ring sheds info for errors
+	for( int i = 0; i < 40; i++ )
+	{
+		if( (i % 8) == 0 ) cxa_logger_error(&logger, "error %d", i / 8);
+		else cxa_logger_info(&logger, "info %d", i);
+	}
+	TEST_ASSERT(getLogStats().numLinesDropped > 0);
+
+	stubHal_mqtt_setConnected(true);
+	runPeriods(20);
+	collectLines();
+	for( int i = 0; i < 5; i++ )
+	{
+		char text[16];
+		snprintf(text, sizeof(text), "error %d", i);
+		TEST_ASSERT(isStreamed(text));
+	}
+	TEST_ASSERT_EQUAL_INT(OVR_LOGSTREAM_NUM_SLOTS, numLines);
+
+	// once through, a single period's backoff again
+	stubHal_mqtt_setConnected(false);
+	cxa_logger_info(&logger, "stuck again");
+	runPeriods(3);
+	TEST_ASSERT_EQUAL_INT(5, getLogStats().numPublishFailures);
+}
+
+
+static void test_binLogRingKeepsOldest(void)
+{
+	ovr_binLog_init(THREADID_UI);
+
+	// nothing drains it while we write
+	for( uint32_t i = 0; i < OVR_BINLOG_NUM_SLOTS + 6; i++ ) ovr_binLog_info(BEACONQUEUED, 0, i, -60);
+	TEST_ASSERT_EQUAL_INT(6, ovr_binLog_getNumDropped());
+
+	ovr_binLog_entry_t entry;
+	for( uint32_t i = 0; i < OVR_BINLOG_NUM_SLOTS; i++ )
+	{
+		TEST_ASSERT(ovr_binLog_read(&entry));
+		TEST_ASSERT_EQUAL_INT(OVR_BINLOG_FMTID_BEACONQUEUED, entry.fmtId);
+		TEST_ASSERT_EQUAL_INT(CXA_LOG_LEVEL_INFO, entry.level);
+		TEST_ASSERT_EQUAL_INT(i, entry.args[1]);
+	}
+	TEST_ASSERT(!ovr_binLog_read(&entry));
+
+	char line[160];
+	entry.args[0] = 0x0011;
+	entry.args[1] = 0x22334455;
+	entry.args[2] = (uint32_t)-60;
+	ovr_binLog_format(&entry, line, sizeof(line));
+	TEST_ASSERT(strstr(line, "[beaconManager] INFO queued '001122334455'  rssi: -60") != NULL);
+}
+
+
+static void test_binLogLinesCarryTheirLevel(void)
+{
+	setupLogStream(CXA_LOG_LEVEL_INFO);
+	ovr_binLog_init(THREADID_UI);
+
+	ovr_binLog_warn(BEACONQUEUED, 0, 1, -61);
+	ovr_binLog_debug(BEACONQUEUED, 0, 2, -62);
+	ovr_binLog_info(BEACONQUEUED, 0, 3, -63);
+	runPeriods(1);
+
+	// formatted later on the ui thread, filtered by their own level
+	collectLines();
+	TEST_ASSERT_EQUAL_INT(2, numLines);
+	TEST_ASSERT(getLineIndex("rssi: -61") < getLineIndex("rssi: -63"));
+	TEST_ASSERT(!isStreamed("rssi: -62"));
+	TEST_ASSERT_EQUAL_INT(1, getLogStats().numLinesFiltered);
+	TEST_ASSERT_EQUAL_INT(3, numLocalLines);
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_linesKeepTheirOrder),
+	TESTRUNNER_TEST(test_filtersChangeAtRuntime),
+	TESTRUNNER_TEST(test_lowestLevelsDroppedFirst),
+	TESTRUNNER_TEST(test_bytesCappedPerPeriod),
+	TESTRUNNER_TEST(test_congestionBacksOff),
+	TESTRUNNER_TEST(test_binLogRingKeepsOldest),
+	TESTRUNNER_TEST(test_binLogLinesCarryTheirLevel),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupLogStream(uint8_t minLevelIn)
+{
+	numLocalLines = 0;
+	numLines = 0;
+
+	cxa_ioStream_init(&ioStream_local);
+	cxa_ioStream_bind(&ioStream_local, ioStreamCb_readByte, ioStreamCb_writeBytes, NULL);
+	cxa_logger_setGlobalIoStream(&ioStream_local);
+
+	cxa_logger_init(&logger, "test");
+	cxa_logger_init(&logger_rules, "rules");
+
+	// no publish scheduler: each notification goes out as it's published
+	ovr_logStream_init(&logStream, stubHal_getRootNode(), THREADID_NETWORK);
+	ovr_logStream_setFilter(&logStream, true, minLevelIn, NULL);
+}
+
+
+static void runPeriods(size_t numPeriodsIn)
+{
+	stubHal_run_ms(numPeriodsIn * OVR_LOGSTREAM_PUBLISH_PERIOD_MS, 10);
+}
+
+
+static size_t collectLines(void)
+{
+	size_t numNewLines = 0;
+	size_t index = 0;
+	stubHal_publication_t* currPub;
+	while( (currPub = stubHal_findPublication("onLog", &index)) != NULL )
+	{
+		index++;
+
+		// one line per row
+		char payload[sizeof(currPub->payload) + 1];
+		memcpy(payload, currPub->payload, currPub->payloadSize_bytes);
+		payload[currPub->payloadSize_bytes] = 0;
+		for( char* currLine = strtok(payload, "\n"); currLine != NULL; currLine = strtok(NULL, "\n") )
+		{
+			TEST_ASSERT(numLines < MAXNUM_LINES);
+			TEST_ASSERT(strlen(currLine) < LINE_MAXSIZE_BYTES);
+			strcpy(lines[numLines++], currLine);
+			numNewLines++;
+		}
+	}
+	stubHal_clearPublications();
+
+	return numNewLines;
+}
+
+
+static int findLine(const char *const textIn)
+{
+	size_t textLen = strlen(textIn);
+	for( size_t i = 0; i < numLines; i++ )
+	{
+		// whole message only ("info 1" isn't "info 12")
+		size_t lineLen = strlen(lines[i]);
+		if( (lineLen >= textLen) && (strcmp(&lines[i][lineLen - textLen], textIn) == 0) &&
+			((lineLen == textLen) || (lines[i][lineLen - textLen - 1] == ' ')) ) return i;
+	}
+	return -1;
+}
+
+
+static bool isStreamed(const char *const textIn)
+{
+	return (findLine(textIn) >= 0);
+}
+
+
+static size_t getLineIndex(const char *const textIn)
+{
+	int retVal = findLine(textIn);
+	if( retVal < 0 ) testRunner_fail(__FILE__, __LINE__, "'%s' wasn't streamed", textIn);
+	return retVal;
+}
+
+
+static void setLogFilter(bool isEnabledIn, uint8_t minLevelIn, const char *const moduleIn)
+{
+	// [isEnabled:1][minLevel:1][moduleName...]
+	uint8_t params[2 + OVR_LOGSTREAM_MODULEFILTER_MAXLEN] = { isEnabledIn, minLevelIn };
+	size_t moduleLen = strlen(moduleIn);
+	memcpy(&params[2], moduleIn, moduleLen);
+
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_RPC_METHODRETVAL_SUCCESS, stubHal_callMethod("diagnostics", "setLogFilter", params, 2 + moduleLen, NULL, 0, NULL));
+}
+
+
+static ovr_logStream_stats_t getLogStats(void)
+{
+	// [isEnabled:1][minLevel:1][queued:4][filtered:4][dropped:4][published:4][publishFailures:4]
+	uint8_t response[LOGSTATS_SIZE_BYTES];
+	size_t responseSize_bytes = 0;
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_RPC_METHODRETVAL_SUCCESS, stubHal_callMethod("diagnostics", "getLogStats", NULL, 0, response, sizeof(response), &responseSize_bytes));
+	TEST_ASSERT_EQUAL_INT(sizeof(response), responseSize_bytes);
+
+	uint32_t values[5];
+	for( size_t i = 0; i < 5; i++ )
+	{
+		uint8_t* currValue = &response[2 + (i * 4)];
+		values[i] = currValue[0] | (currValue[1] << 8) | (currValue[2] << 16) | ((uint32_t)currValue[3] << 24);
+	}
+
+	ovr_logStream_stats_t retVal = { values[0], values[1], values[2], values[3], values[4] };
+	TEST_ASSERT_EQUAL_INT(retVal.numLinesPublished, ovr_logStream_getStats(&logStream).numLinesPublished);
+	return retVal;
+}
+
+
+static bool ioStreamCb_writeBytes(void* buffIn, size_t bufferSize_bytesIn, void *const userVarIn)
+{
+	for( size_t i = 0; i < bufferSize_bytesIn; i++ )
+	{
+		if( ((char*)buffIn)[i] == '\n' ) numLocalLines++;
+	}
+	return true;
+}
+
+
+static cxa_ioStream_readStatus_t ioStreamCb_readByte(uint8_t *const byteOut, void *const userVarIn)
+{
+	return CXA_IOSTREAM_READSTAT_NODATA;
+}
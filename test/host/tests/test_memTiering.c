@@ -0,0 +1,299 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <cxa_btle_client.h>
+#include <esp_heap_caps.h>
+#include <stubHal.h>
+
+#include <ovr_beaconHistory.h>
+#include <ovr_beaconManager.h>
+#include <ovr_config.h>
+#include <ovr_memArena.h>
+#include <ovr_publishScheduler.h>
+
+
+// ******** local macro definitions ********
+// as ovr_beaconGateway runs them
+#define THREADID_NETWORK				1
+#define THREADID_BLUETOOTH				3
+
+// twice the PSRAM cache's worth of slices, appended round-robin as adverts arrive
+#define BENCH_NUMHISTORIES				512
+#define BENCH_NUMSAMPLES_PER_HISTORY	16
+#define BENCH_SAMPLE_INTERVAL_MS		1000
+#define BENCH_DRAINBUFFER_SIZE_BYTES	160
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	uint32_t numAppended;
+	double append_s;
+	size_t appendMisses;
+
+	uint32_t numDrained;
+	double drain_s;
+	size_t drainMisses;
+}historyResult_t;
+
+
+// ******** local function prototypes ********
+static bool tryNumBeacons(uint16_t numBeaconsIn, bool hasPsramIn);
+static uint16_t findMaxNumBeacons(bool hasPsramIn);
+static void bootGateway(void);
+
+static bool runHistory(ovr_memArena_region_t regionIn, historyResult_t *const resultOut);
+static void touchSlice(ovr_beaconHistory_t *const histIn, size_t offsetIn, size_t numBytesIn);
+static void reportHistory(const char *const tierIn, historyResult_t *const resultIn);
+
+static double getTime_s(void);
+
+
+// ********  local variable declarations *********
+static cxa_btle_client_t btleClient;
+static ovr_beaconManager_t beaconManager;
+
+
+// ******** global function implementations ********
+static void test_tieredHoldsMoreBeacons(void)
+{
+	uint16_t maxAllInternal = findMaxNumBeacons(false);
+	TEST_ASSERT(tryNumBeacons(maxAllInternal, false));
+	TEST_ASSERT_EQUAL_INT(OVR_MEMARENA_REGION_INTERNAL,
+						  ovr_memArena_getRegion(ovr_beaconManager_getMemArena(&beaconManager, OVR_BEACONMANAGER_MEMTIER_COLD)));
+
+	uint16_t maxTiered = findMaxNumBeacons(true);
+	TEST_ASSERT(tryNumBeacons(maxTiered, true));
+	TEST_ASSERT_EQUAL_INT(OVR_MEMARENA_REGION_INTERNAL,
+						  ovr_memArena_getRegion(ovr_beaconManager_getMemArena(&beaconManager, OVR_BEACONMANAGER_MEMTIER_HOT)));
+	TEST_ASSERT_EQUAL_INT(OVR_MEMARENA_REGION_PSRAM,
+						  ovr_memArena_getRegion(ovr_beaconManager_getMemArena(&beaconManager, OVR_BEACONMANAGER_MEMTIER_COLD)));
+	size_t tieredInternal_bytes = stubHal_heap_getNumAllocated_bytes(MALLOC_CAP_INTERNAL);
+
+	// moving the history out is worth a slice per beacon of internal RAM
+	TEST_ASSERT(maxTiered > maxAllInternal);
+
+	testRunner_report("memTiering", "allInternal_maxNumBeacons", maxAllInternal);
+	testRunner_report("memTiering", "tiered_maxNumBeacons", maxTiered);
+	testRunner_report("memTiering", "tiered_internalUsed_bytes", tieredInternal_bytes);
+	testRunner_report("memTiering", "tiered_psramUsed_bytes", stubHal_heap_getNumAllocated_bytes(MALLOC_CAP_SPIRAM));
+}
+
+
+static void test_historyThroughputByTier(void)
+{
+	historyResult_t internalResult;
+	TEST_ASSERT(runHistory(OVR_MEMARENA_REGION_INTERNAL, &internalResult));
+	historyResult_t psramResult;
+	TEST_ASSERT(runHistory(OVR_MEMARENA_REGION_PSRAM, &psramResult));
+
+	// same work either way
+	TEST_ASSERT_EQUAL_INT(internalResult.numAppended, psramResult.numAppended);
+	TEST_ASSERT_EQUAL_INT(internalResult.numDrained, psramResult.numDrained);
+	TEST_ASSERT(psramResult.numDrained > 0);
+
+	// internal RAM never stalls...PSRAM does, but a batched drain reuses each line it fills
+	TEST_ASSERT_EQUAL_INT(0, internalResult.appendMisses + internalResult.drainMisses);
+	TEST_ASSERT(psramResult.appendMisses > 0);
+	TEST_ASSERT(psramResult.drainMisses < psramResult.numDrained);
+
+	reportHistory("internal", &internalResult);
+	reportHistory("psram", &psramResult);
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_tieredHoldsMoreBeacons),
+	TESTRUNNER_TEST(test_historyThroughputByTier),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static bool tryNumBeacons(uint16_t numBeaconsIn, bool hasPsramIn)
+{
+	// capacities are picked up at boot (and fall back to the defaults if they don't fit)
+	stubHal_reset();
+	bootGateway();
+	ovr_beaconManager_capacities_t caps = ovr_beaconManager_getCapacities(&beaconManager);
+	caps.maxNumBeacons = numBeaconsIn;
+	if( !ovr_beaconManager_saveCapacities(&beaconManager, caps) ) return false;
+
+	stubHal_reboot();
+	if( !hasPsramIn ) stubHal_heap_setRegionSize_bytes(MALLOC_CAP_SPIRAM, 0);
+	bootGateway();
+
+	return (ovr_beaconManager_getCapacities(&beaconManager).maxNumBeacons == numBeaconsIn);
+}
+
+
+static uint16_t findMaxNumBeacons(bool hasPsramIn)
+{
+	uint16_t fits = OVR_BEACONMANAGER_MAXNUM_BEACONS;
+	uint16_t doesntFit = OVR_BEACONMANAGER_MAXNUM_BEACONS_LIMIT + 1;
+	TEST_ASSERT(tryNumBeacons(fits, hasPsramIn));
+
+	while( (doesntFit - fits) > 1 )
+	{
+		uint16_t mid = fits + ((doesntFit - fits) / 2);
+		if( tryNumBeacons(mid, hasPsramIn) ) fits = mid;
+		else doesntFit = mid;
+	}
+	return fits;
+}
+
+
+static void bootGateway(void)
+{
+	cxa_mqtt_rpc_node_t* rootNode = stubHal_getRootNode();
+
+	// up to and including the manager, as the gateway boots (the capacity
+	// found is what the manager can take of the internal RAM left at that point)
+	ovr_config_init(rootNode);
+	ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+
+	stubHal_btle_init(&btleClient);
+	ovr_beaconManager_init(&beaconManager, &btleClient, rootNode, THREADID_BLUETOOTH, THREADID_NETWORK);
+}
+
+
+static bool runHistory(ovr_memArena_region_t regionIn, historyResult_t *const resultOut)
+{
+	stubHal_reset();
+
+	// mirror the manager's layout...only the slices move between tiers
+	size_t histories_size_bytes = BENCH_NUMHISTORIES * sizeof(ovr_beaconHistory_t);
+	size_t isSliceUsed_size_bytes = BENCH_NUMHISTORIES * sizeof(bool);
+	size_t slices_size_bytes = BENCH_NUMHISTORIES * OVR_BEACONHISTORY_SLICESIZE_BYTES;
+
+	ovr_memArena_t arena_hot;
+	ovr_memArena_t arena_slices;
+	if( !ovr_memArena_init(&arena_hot, OVR_MEMARENA_ALIGN(histories_size_bytes) + OVR_MEMARENA_ALIGN(isSliceUsed_size_bytes), OVR_MEMARENA_REGION_INTERNAL) ) return false;
+	if( !ovr_memArena_init(&arena_slices, slices_size_bytes, regionIn) || (ovr_memArena_getRegion(&arena_slices) != regionIn) ) return false;
+
+	ovr_beaconHistory_t* histories = ovr_memArena_alloc(&arena_hot, histories_size_bytes);
+	bool* isSliceUsed = ovr_memArena_alloc(&arena_hot, isSliceUsed_size_bytes);
+	uint8_t* slices = ovr_memArena_alloc(&arena_slices, slices_size_bytes);
+	TEST_ASSERT(histories && isSliceUsed && slices);
+
+	ovr_beaconHistory_arena_t historyArena;
+	ovr_beaconHistory_arena_init(&historyArena, slices, isSliceUsed, BENCH_NUMHISTORIES);
+
+	ovr_beaconHistory_sample_t currSample = { .rssi_dBm = -60, .temp_deciDegC = 215, .light_255 = 128, .batt_pcnt100 = 90, .batt_mv = 2950 };
+	for( size_t i = 0; i < BENCH_NUMHISTORIES; i++ ) ovr_beaconHistory_init(&histories[i], &historyArena, &currSample);
+	stubHal_heap_clearPsramCache();
+
+	// round-robin across beacons, just like adverts arrive (worst case for the cache)
+	memset(resultOut, 0, sizeof(*resultOut));
+	size_t startMisses = stubHal_heap_getNumPsramMisses();
+	double startTime_s = getTime_s();
+	for( size_t j = 0; j < BENCH_NUMSAMPLES_PER_HISTORY; j++ )
+	{
+		for( size_t i = 0; i < BENCH_NUMHISTORIES; i++ )
+		{
+			ovr_beaconHistory_t* currHist = &histories[i];
+			size_t prevReadIndex = currHist->readIndex;
+			size_t prevEnd = currHist->readIndex + currHist->size_bytes;
+
+			currSample.rssi_dBm = -60 - (int8_t)((i + j) % 20);
+			currSample.light_255 = (uint8_t)(i * 7 + j);
+			ovr_beaconHistory_append(currHist, &currSample, BENCH_SAMPLE_INTERVAL_MS);
+			resultOut->numAppended++;
+
+			// dropping the oldest reads its header, then the new record is written
+			size_t numDropped_bytes = (currHist->readIndex + OVR_BEACONHISTORY_SLICESIZE_BYTES - prevReadIndex) % OVR_BEACONHISTORY_SLICESIZE_BYTES;
+			size_t currEnd = currHist->readIndex + currHist->size_bytes;
+			touchSlice(currHist, prevReadIndex, numDropped_bytes);
+			touchSlice(currHist, prevEnd, (currEnd + OVR_BEACONHISTORY_SLICESIZE_BYTES - prevEnd) % OVR_BEACONHISTORY_SLICESIZE_BYTES);
+		}
+	}
+	resultOut->append_s = getTime_s() - startTime_s;
+	resultOut->appendMisses = stubHal_heap_getNumPsramMisses() - startMisses;
+
+	// drained a beacon at a time in batches, like the rpc interface does
+	startMisses = stubHal_heap_getNumPsramMisses();
+	startTime_s = getTime_s();
+	for( size_t i = 0; i < BENCH_NUMHISTORIES; i++ )
+	{
+		ovr_beaconHistory_t* currHist = &histories[i];
+		uint8_t batch[BENCH_DRAINBUFFER_SIZE_BYTES];
+		size_t numSamples;
+		for( ;; )
+		{
+			size_t prevReadIndex = currHist->readIndex;
+			size_t prevSize_bytes = currHist->size_bytes;
+			if( ovr_beaconHistory_drainBatch(currHist, 0, batch, sizeof(batch), &numSamples) == 0 ) break;
+
+			touchSlice(currHist, prevReadIndex, prevSize_bytes - currHist->size_bytes);
+			resultOut->numDrained += numSamples;
+		}
+	}
+	resultOut->drain_s = getTime_s() - startTime_s;
+	resultOut->drainMisses = stubHal_heap_getNumPsramMisses() - startMisses;
+
+	ovr_memArena_deinit(&arena_slices);
+	ovr_memArena_deinit(&arena_hot);
+	return true;
+}
+
+
+static void touchSlice(ovr_beaconHistory_t *const histIn, size_t offsetIn, size_t numBytesIn)
+{
+	// slices are rings...at most two runs
+	size_t startIndex = offsetIn % OVR_BEACONHISTORY_SLICESIZE_BYTES;
+	size_t numFirst_bytes = OVR_BEACONHISTORY_SLICESIZE_BYTES - startIndex;
+	if( numFirst_bytes > numBytesIn ) numFirst_bytes = numBytesIn;
+
+	stubHal_heap_touch(&histIn->buffer[startIndex], numFirst_bytes);
+	stubHal_heap_touch(histIn->buffer, numBytesIn - numFirst_bytes);
+}
+
+
+static void reportHistory(const char *const tierIn, historyResult_t *const resultIn)
+{
+	double appendStall_s = (resultIn->appendMisses * (double)STUBHAL_HEAP_PSRAM_MISSPENALTY_NS) / 1e9;
+	double drainStall_s = (resultIn->drainMisses * (double)STUBHAL_HEAP_PSRAM_MISSPENALTY_NS) / 1e9;
+
+	char key[48];
+	snprintf(key, sizeof(key), "%s_appendMissesPerSample", tierIn);
+	testRunner_report("memTiering", key, (double)resultIn->appendMisses / resultIn->numAppended);
+	snprintf(key, sizeof(key), "%s_drainMissesPerSample", tierIn);
+	testRunner_report("memTiering", key, (double)resultIn->drainMisses / resultIn->numDrained);
+
+	// host time plus the modelled PSRAM stall
+	snprintf(key, sizeof(key), "%s_appendsPerSec", tierIn);
+	testRunner_report("memTiering", key, resultIn->numAppended / (resultIn->append_s + appendStall_s));
+	snprintf(key, sizeof(key), "%s_drainedPerSec", tierIn);
+	testRunner_report("memTiering", key, resultIn->numDrained / (resultIn->drain_s + drainStall_s));
+	snprintf(key, sizeof(key), "%s_stallPerSample_ns", tierIn);
+	testRunner_report("memTiering", key, ((appendStall_s + drainStall_s) * 1e9) / resultIn->numAppended);
+}
+
+
+static double getTime_s(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + (now.tv_nsec / 1e9);
+}
@@ -0,0 +1,293 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <string.h>
+
+#include <cxa_btle_client.h>
+#include <stubHal.h>
+
+#include <ovr_beaconManager.h>
+#include <ovr_beaconProxy.h>
+#include <ovr_config.h>
+
+
+// ******** local macro definitions ********
+#define COMPANY_ID						0x04A2
+#define THREADID_BLUETOOTH				3
+
+#define SIM_STEP_MS						50
+#define SIM_HOUR_MS						(60 * 60 * 1000)
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	uint8_t id;
+	uint32_t interval_ms;
+	uint8_t reception_pcnt;
+
+	uint32_t nextAdvert_ms;
+	uint32_t firstHeard_ms;
+	uint32_t lastHeard_ms;
+	bool hasBeenHeard;
+}simBeacon_t;
+
+
+typedef struct
+{
+	uint32_t numFound;
+	uint32_t numLost;
+	uint32_t lastFound_ms;
+	uint32_t lastLost_ms;
+}presenceCounts_t;
+
+
+// ******** local function prototypes ********
+static void setupManager(void);
+static void simBeacon_init(simBeacon_t *const beaconIn, uint8_t idIn, uint32_t interval_msIn, uint8_t reception_pcntIn);
+static void simulate(simBeacon_t *const beaconIn, uint32_t duration_msIn, bool isInRangeIn);
+static uint32_t nextRandom(void);
+
+static void beaconCb_onFound(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn);
+static void beaconCb_onLost(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn);
+
+
+// ********  local variable declarations *********
+static cxa_btle_client_t btleClient;
+static ovr_beaconManager_t beaconManager;
+
+static presenceCounts_t counts;
+static uint32_t simTime_ms;
+static uint32_t randomState;
+
+
+// ******** global function implementations ********
+static void test_strayAdvertIsNotFound(void)
+{
+	setupManager();
+
+	// heard once as it passes by at the edge of range
+	simBeacon_t beacon;
+	simBeacon_init(&beacon, 1, 1000, 100);
+	simulate(&beacon, 1000, true);
+	simulate(&beacon, 120000, false);
+
+	TEST_ASSERT_EQUAL_INT(0, counts.numFound);
+	TEST_ASSERT_EQUAL_INT(0, counts.numLost);
+}
+
+
+static void test_foundLatency(void)
+{
+	setupManager();
+
+	simBeacon_t beacon;
+	simBeacon_init(&beacon, 1, 1000, 100);
+	simulate(&beacon, 10000, true);
+
+	// found on the OVR_BEACONMANAGER_FOUND_NUMADVERTS'th advert
+	TEST_ASSERT_EQUAL_INT(1, counts.numFound);
+	uint32_t latency_ms = counts.lastFound_ms - beacon.firstHeard_ms;
+	testRunner_report("presence", "foundLatency_ms", latency_ms);
+	// (plus advertising jitter and the runLoop step it's processed on)
+	TEST_ASSERT(latency_ms <= ((OVR_BEACONMANAGER_FOUND_NUMADVERTS - 1) * (beacon.interval_ms + 10)) + (2 * SIM_STEP_MS));
+}
+
+
+static void test_lostLatency(void)
+{
+	setupManager();
+
+	simBeacon_t beacon;
+	simBeacon_init(&beacon, 1, 2000, 100);
+	simulate(&beacon, 120000, true);
+	TEST_ASSERT_EQUAL_INT(1, counts.numFound);
+
+	ovr_beaconProxy_t* proxy = (ovr_beaconProxy_t*)cxa_array_get(ovr_beaconManager_getKnownBeacons(&beaconManager), 0);
+	TEST_ASSERT(proxy != NULL);
+	uint32_t lostTimeout_ms = ovr_beaconProxy_getLostTimeout_ms(proxy);
+
+	// it walks away
+	simulate(&beacon, 5 * 60000, false);
+	TEST_ASSERT_EQUAL_INT(1, counts.numLost);
+
+	uint32_t latency_ms = counts.lastLost_ms - beacon.lastHeard_ms;
+	testRunner_report("presence", "lostTimeout_ms", lostTimeout_ms);
+	testRunner_report("presence", "lostLatency_ms", latency_ms);
+	TEST_ASSERT(latency_ms >= lostTimeout_ms);
+	TEST_ASSERT(latency_ms <= (lostTimeout_ms + 2 * SIM_STEP_MS));
+
+	// well inside the default used before the cadence is known
+	TEST_ASSERT(lostTimeout_ms < ovr_config_get(OVR_CONFIG_ID_LOSTTIMEOUT_MS));
+}
+
+
+static void test_refoundBeaconKeepsCadence(void)
+{
+	setupManager();
+
+	simBeacon_t beacon;
+	simBeacon_init(&beacon, 1, 1000, 100);
+	simulate(&beacon, 60000, true);
+	ovr_beaconProxy_t* proxy = (ovr_beaconProxy_t*)cxa_array_get(ovr_beaconManager_getKnownBeacons(&beaconManager), 0);
+	uint32_t learnedTimeout_ms = ovr_beaconProxy_getLostTimeout_ms(proxy);
+
+	simulate(&beacon, 60000, false);
+	TEST_ASSERT_EQUAL_INT(1, counts.numLost);
+
+	// back in range...it's re-found with what we learned last time rather than the default
+	simulate(&beacon, 5000, true);
+	TEST_ASSERT_EQUAL_INT(2, counts.numFound);
+	proxy = (ovr_beaconProxy_t*)cxa_array_get(ovr_beaconManager_getKnownBeacons(&beaconManager), 0);
+	TEST_ASSERT(proxy != NULL);
+	TEST_ASSERT(ovr_beaconProxy_getCadence(proxy).numIntervalSamples > 10);
+	TEST_ASSERT_EQUAL_INT(learnedTimeout_ms, ovr_beaconProxy_getLostTimeout_ms(proxy));
+}
+
+
+static void test_weakBeaconDoesNotFlap(void)
+{
+	static const uint8_t reception_pcnts[] = { 20, 35, 50, 80 };
+
+	for( size_t i = 0; i < sizeof(reception_pcnts); i++ )
+	{
+		stubHal_reset();
+		setupManager();
+
+		// a beacon that never moves, heard only some of the time
+		simBeacon_t beacon;
+		simBeacon_init(&beacon, 1, 1000, reception_pcnts[i]);
+		simulate(&beacon, SIM_HOUR_MS, true);
+
+		char key[32];
+		snprintf(key, sizeof(key), "flapsPerHour_rx%d", reception_pcnts[i]);
+		testRunner_report("presence", key, counts.numLost);
+
+		// found once and (at worst) the odd long run of misses at poor reception
+		TEST_ASSERT_EQUAL_INT(counts.numFound, counts.numLost + 1);
+		TEST_ASSERT(counts.numLost <= ((reception_pcnts[i] < 35) ? 2 : 1));
+	}
+}
+
+
+static void test_intermittentBeaconNeedsConsecutiveAdverts(void)
+{
+	setupManager();
+
+	// one advert every couple of minutes never adds up to being found
+	simBeacon_t beacon;
+	simBeacon_init(&beacon, 1, 1000, 100);
+	for( int i = 0; i < 5; i++ )
+	{
+		simulate(&beacon, 1000, true);
+		simulate(&beacon, ovr_config_get(OVR_CONFIG_ID_LOSTTIMEOUT_MS) + 10000, false);
+	}
+	TEST_ASSERT_EQUAL_INT(0, counts.numFound);
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_strayAdvertIsNotFound),
+	TESTRUNNER_TEST(test_foundLatency),
+	TESTRUNNER_TEST(test_lostLatency),
+	TESTRUNNER_TEST(test_refoundBeaconKeepsCadence),
+	TESTRUNNER_TEST(test_weakBeaconDoesNotFlap),
+	TESTRUNNER_TEST(test_intermittentBeaconNeedsConsecutiveAdverts),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupManager(void)
+{
+	ovr_config_init(NULL);
+
+	stubHal_btle_init(&btleClient);
+	ovr_beaconManager_init(&beaconManager, &btleClient, NULL, THREADID_BLUETOOTH, THREADID_BLUETOOTH);
+	ovr_beaconManager_addListener(&beaconManager, beaconCb_onFound, NULL, beaconCb_onLost, NULL);
+	stubHal_btle_setReady(&btleClient);
+	stubHal_iterateAll();
+
+	memset(&counts, 0, sizeof(counts));
+	simTime_ms = 0;
+	randomState = 0x9E3779B9;
+}
+
+
+static void simBeacon_init(simBeacon_t *const beaconIn, uint8_t idIn, uint32_t interval_msIn, uint8_t reception_pcntIn)
+{
+	beaconIn->id = idIn;
+	beaconIn->interval_ms = interval_msIn;
+	beaconIn->reception_pcnt = reception_pcntIn;
+	beaconIn->nextAdvert_ms = simTime_ms;
+	beaconIn->firstHeard_ms = 0;
+	beaconIn->lastHeard_ms = 0;
+	beaconIn->hasBeenHeard = false;
+}
+
+
+static void simulate(simBeacon_t *const beaconIn, uint32_t duration_msIn, bool isInRangeIn)
+{
+	uint32_t endTime_ms = simTime_ms + duration_msIn;
+	while( simTime_ms < endTime_ms )
+	{
+		if( simTime_ms >= beaconIn->nextAdvert_ms )
+		{
+			if( isInRangeIn && ((nextRandom() % 100) < beaconIn->reception_pcnt) )
+			{
+				uint8_t advert[] = { 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, beaconIn->id, 0x00, 80, 0xE1, 0x00, 0x40, 0x00, 0x0C, 0x0E };
+				TEST_ASSERT(stubHal_btle_injectManData(&btleClient, -80, COMPANY_ID, advert, sizeof(advert)));
+				if( !beaconIn->hasBeenHeard ) beaconIn->firstHeard_ms = simTime_ms;
+				beaconIn->lastHeard_ms = simTime_ms;
+				beaconIn->hasBeenHeard = true;
+			}
+			// advertising events are randomly delayed by up to 10ms
+			beaconIn->nextAdvert_ms += beaconIn->interval_ms + (nextRandom() % 10);
+		}
+
+		stubHal_advanceTime_ms(SIM_STEP_MS);
+		simTime_ms += SIM_STEP_MS;
+		stubHal_iterateAll();
+	}
+}
+
+
+static uint32_t nextRandom(void)
+{
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+
+static void beaconCb_onFound(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn)
+{
+	counts.numFound++;
+	counts.lastFound_ms = simTime_ms;
+}
+
+
+static void beaconCb_onLost(ovr_beaconProxy_t *const beaconProxyIn, void* userVarIn)
+{
+	counts.numLost++;
+	counts.lastLost_ms = simTime_ms;
+}
@@ -0,0 +1,164 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <string.h>
+
+#include <cxa_mqtt_rpc_node.h>
+#include <stubHal.h>
+
+#include <ovr_publishScheduler.h>
+
+
+// ******** local macro definitions ********
+#define THREADID_NETWORK				1
+
+#define NODE_NAME						"beacons"
+#define NOTI_NAME						"onBeaconUpdate"
+
+
+// ******** local type definitions ********
+
+
+// ******** local function prototypes ********
+static void setupScheduler(void);
+static bool publishFilled(ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn, char fillIn, size_t size_bytesIn);
+
+
+// ********  local variable declarations *********
+static cxa_mqtt_rpc_node_t node;
+static uint8_t payload[2 * CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES];
+
+
+// ******** global function implementations ********
+static void test_maxPayloadAccountsForTopic(void)
+{
+	setupScheduler();
+
+	// "<root>/beacons/onBeaconUpdate"
+	size_t topicLen = strlen(stubHal_getRootNode()->name) + 1 + strlen(NODE_NAME) + 1 + strlen(NOTI_NAME);
+	size_t maxSize_bytes = ovr_publishScheduler_getMaxPayloadSize_bytes(&node, NOTI_NAME);
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES - OVR_PUBLISHSCHEDULER_MESSAGE_OVERHEAD_BYTES - topicLen, maxSize_bytes);
+
+	// the biggest we accept actually fits
+	TEST_ASSERT(publishFilled(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, 'a', maxSize_bytes));
+	stubHal_iterateAll();
+	TEST_ASSERT_EQUAL_INT(1, stubHal_countPublications(NOTI_NAME));
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getNumOversizedPublishes());
+	TEST_ASSERT(stubHal_getPublication(0)->messageSize_bytes <= CXA_MQTT_MESSAGEFACTORY_MESSAGE_SIZE_BYTES);
+}
+
+
+static void test_oversizedPayloadIsRefused(void)
+{
+	setupScheduler();
+
+	size_t maxSize_bytes = ovr_publishScheduler_getMaxPayloadSize_bytes(&node, NOTI_NAME);
+	TEST_ASSERT(!publishFilled(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, 'a', maxSize_bytes + 1));
+
+	// refused up front rather than retried and failed
+	stubHal_run_ms(1000, 10);
+	ovr_publishScheduler_classStats_t stats = ovr_publishScheduler_getClassStats(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY);
+	TEST_ASSERT_EQUAL_INT(0, stats.numEnqueued);
+	TEST_ASSERT_EQUAL_INT(1, stats.numDropped);
+	TEST_ASSERT_EQUAL_INT(0, stats.numFailed);
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT(0, stubHal_getCriticalSectionDepth());
+}
+
+
+static void test_coalescedEntryKeepsItsPlace(void)
+{
+	setupScheduler();
+
+	// queued up before the network thread gets a chance to run
+	TEST_ASSERT(publishFilled(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, 42, 'a', 32));
+	TEST_ASSERT(publishFilled(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, 'b', 32));
+	TEST_ASSERT(publishFilled(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, 42, 'c', 32));
+	stubHal_iterateAll();
+
+	TEST_ASSERT_EQUAL_INT(2, stubHal_getNumPublications());
+	TEST_ASSERT_EQUAL_INT('c', stubHal_getPublication(0)->payload[0]);
+	TEST_ASSERT_EQUAL_INT('b', stubHal_getPublication(1)->payload[0]);
+	TEST_ASSERT_EQUAL_INT(1, ovr_publishScheduler_getClassStats(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY).numCoalesced);
+}
+
+
+static void test_uncoalescedEntriesAreAllDelivered(void)
+{
+	setupScheduler();
+
+	// one-shot state goes without a key so none of it is replaced
+	for( int i = 0; i < 3; i++ )
+	{
+		TEST_ASSERT(publishFilled(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, 'a' + i, 32));
+	}
+	stubHal_iterateAll();
+
+	TEST_ASSERT_EQUAL_INT(3, stubHal_getNumPublications());
+	for( size_t i = 0; i < 3; i++ ) TEST_ASSERT_EQUAL_INT('a' + i, stubHal_getPublication(i)->payload[0]);
+	TEST_ASSERT_EQUAL_INT(0, ovr_publishScheduler_getClassStats(OVR_PUBLISHSCHEDULER_CLASS_TELEMETRY).numCoalesced);
+}
+
+
+static void test_fullQueueDisplacesLowerPriority(void)
+{
+	setupScheduler();
+
+	for( size_t i = 0; i < OVR_PUBLISHSCHEDULER_MAXNUM_ENTRIES; i++ )
+	{
+		TEST_ASSERT(publishFilled(OVR_PUBLISHSCHEDULER_CLASS_DIAGNOSTICS, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, 'd', 16));
+	}
+	TEST_ASSERT(!publishFilled(OVR_PUBLISHSCHEDULER_CLASS_DIAGNOSTICS, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, 'd', 16));
+	TEST_ASSERT(publishFilled(OVR_PUBLISHSCHEDULER_CLASS_ALERT, OVR_PUBLISHSCHEDULER_COALESCEKEY_NONE, 'a', 16));
+
+	// the alert jumps the queue
+	stubHal_iterateAll();
+	TEST_ASSERT(stubHal_getNumPublications() > 0);
+	TEST_ASSERT_EQUAL_INT('a', stubHal_getPublication(0)->payload[0]);
+	TEST_ASSERT_EQUAL_INT(2, ovr_publishScheduler_getClassStats(OVR_PUBLISHSCHEDULER_CLASS_DIAGNOSTICS).numDropped);
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_maxPayloadAccountsForTopic),
+	TESTRUNNER_TEST(test_oversizedPayloadIsRefused),
+	TESTRUNNER_TEST(test_coalescedEntryKeepsItsPlace),
+	TESTRUNNER_TEST(test_uncoalescedEntriesAreAllDelivered),
+	TESTRUNNER_TEST(test_fullQueueDisplacesLowerPriority),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void setupScheduler(void)
+{
+	cxa_mqtt_rpc_node_t* rootNode = stubHal_getRootNode();
+	ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+	cxa_mqtt_rpc_node_init_formattedString(&node, rootNode, NODE_NAME);
+}
+
+
+static bool publishFilled(ovr_publishScheduler_class_t classIn, uint64_t coalesceKeyIn, char fillIn, size_t size_bytesIn)
+{
+	TEST_ASSERT(size_bytesIn <= sizeof(payload));
+	memset(payload, fillIn, size_bytesIn);
+
+	return ovr_publishScheduler_publish(&node, NOTI_NAME, classIn, coalesceKeyIn, payload, size_bytesIn);
+}
@@ -0,0 +1,416 @@
+/**
+ * @copyright 2017 opencxa.org
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Christopher Armenio
+ */
+#include <testRunner.h>
+
+
+// ******** includes ********
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cxa_btle_client.h>
+#include <stubHal.h>
+
+#include <ovr_beaconManager.h>
+#include <ovr_beaconManager_rpcInterface.h>
+#include <ovr_config.h>
+#include <ovr_publishScheduler.h>
+#include <ovr_reportSelector.h>
+
+
+// ******** local macro definitions ********
+#define COMPANY_ID						0x04A2
+#define UNIX_TIME						1500000000
+
+// as ovr_beaconGateway runs them
+#define THREADID_NETWORK				1
+#define THREADID_BLUETOOTH				3
+
+// adverts are heard this often (well inside the lost timeout)
+#define HEAR_PERIOD_MS					10000
+
+// beacon i is heard at RSSI_CLOSEST - (i * RSSI_STEP)
+#define RSSI_CLOSEST					-40
+#define RSSI_STEP						3
+
+// few enough that an unlimited period fits the publish scheduler's queue
+#define NUM_BEACONS						8
+
+// periods for the slot estimate to settle on the actual report size
+#define NUM_WARMUP_PERIODS				16
+
+#define SIM_NUMBEACONS					500
+#define SIM_NUMCYCLES					200
+
+
+// ******** local type definitions ********
+typedef struct
+{
+	uint8_t coverage_pcnt;					///< beacons reported at least once
+	size_t numCyclesToFullCoverage;			///< 0 if never reached
+	size_t maxStaleness_cycles;				///< longest any beacon went unreported
+}simResult_t;
+
+
+typedef struct
+{
+	uint8_t policy;
+	uint32_t budget_bytes;
+	uint8_t rrShare_pcnt;
+	unsigned numReported;
+	unsigned numDeferred;
+	unsigned numBytes;
+}reportPolicy_t;
+
+
+// ******** local function prototypes ********
+static void simulate(ovr_reportSelector_policy_t policyIn, uint32_t budget_bytesIn, uint8_t rrShare_pcntIn, simResult_t *const resultOut);
+static int32_t getSimScore(ovr_reportSelector_policy_t policyIn, size_t indexIn, uint32_t *const lcgStateIn);
+
+static void setupPipeline(void);
+static void runPeriod(void);
+static size_t countReportsByBeacon(uint8_t *const timesReportedOut);
+static void setReportPolicy(uint8_t policyIn, uint32_t budget_bytesIn, uint8_t rrShare_pcntIn);
+static reportPolicy_t getReportPolicy(void);
+
+
+// ********  local variable declarations *********
+static cxa_btle_client_t btleClient;
+static ovr_beaconManager_t beaconManager;
+
+static ovr_reportSelector_t selector;
+static uint16_t indices[OVR_REPORTSELECTOR_MAXNUM_SLOTS];
+static uint32_t lastReported[SIM_NUMBEACONS];
+
+
+// ******** global function implementations ********
+static void test_topKThenRoundRobin(void)
+{
+	ovr_reportSelector_init(&selector);
+
+	// 4 slots at the initial report size estimate: 3 by score and 1 round-robin
+	TEST_ASSERT(ovr_reportSelector_setPolicy(&selector, OVR_REPORTSELECTOR_POLICY_CLOSEST, 4 * OVR_REPORTSELECTOR_INITIAL_REPORTSIZE_BYTES, 25));
+
+	for( uint16_t cycle = 0; cycle < 3; cycle++ )
+	{
+		ovr_reportSelector_beginCycle(&selector, 10);
+		for( uint16_t i = 0; i < 10; i++ ) ovr_reportSelector_offer(&selector, i, i);
+		TEST_ASSERT_EQUAL_INT(4, ovr_reportSelector_endCycle(&selector, indices, OVR_REPORTSELECTOR_MAXNUM_SLOTS));
+
+		// best first, then the next in turn
+		TEST_ASSERT_EQUAL_INT(9, indices[0]);
+		TEST_ASSERT_EQUAL_INT(8, indices[1]);
+		TEST_ASSERT_EQUAL_INT(7, indices[2]);
+		TEST_ASSERT_EQUAL_INT(cycle, indices[3]);
+	}
+
+	TEST_ASSERT(!ovr_reportSelector_setPolicy(&selector, OVR_REPORTSELECTOR_POLICY_MOSTCHANGED + 1, 0, 25));
+	TEST_ASSERT(!ovr_reportSelector_setPolicy(&selector, OVR_REPORTSELECTOR_POLICY_CLOSEST, 0, 101));
+}
+
+
+static void test_everyoneFitsInTableOrder(void)
+{
+	ovr_reportSelector_init(&selector);
+	TEST_ASSERT(ovr_reportSelector_isUnlimited(&selector));
+
+	// once every beacon fits there's nothing to prioritize
+	TEST_ASSERT(ovr_reportSelector_setPolicy(&selector, OVR_REPORTSELECTOR_POLICY_CLOSEST, 8 * OVR_REPORTSELECTOR_INITIAL_REPORTSIZE_BYTES, 0));
+	TEST_ASSERT(!ovr_reportSelector_isUnlimited(&selector));
+
+	ovr_reportSelector_beginCycle(&selector, 6);
+	for( uint16_t i = 0; i < 6; i++ ) ovr_reportSelector_offer(&selector, i, i);
+	TEST_ASSERT_EQUAL_INT(6, ovr_reportSelector_endCycle(&selector, indices, OVR_REPORTSELECTOR_MAXNUM_SLOTS));
+	for( uint16_t i = 0; i < 6; i++ ) TEST_ASSERT_EQUAL_INT(i, indices[i]);
+
+	// and a budget too small for one report still makes progress
+	TEST_ASSERT(ovr_reportSelector_setPolicy(&selector, OVR_REPORTSELECTOR_POLICY_ROUNDROBIN, 1, 0));
+	ovr_reportSelector_beginCycle(&selector, 6);
+	TEST_ASSERT_EQUAL_INT(1, ovr_reportSelector_endCycle(&selector, indices, OVR_REPORTSELECTOR_MAXNUM_SLOTS));
+}
+
+
+static void test_coverageVsBudget(void)
+{
+	// fractions of what it would take to report everyone every cycle
+	static const uint8_t budgetDivisors[] = { 32, 16, 8, 4 };
+	static const struct
+	{
+		ovr_reportSelector_policy_t policy;
+		uint8_t rrShare_pcnt;
+		const char* name;
+	}configs[] =
+	{
+		{ OVR_REPORTSELECTOR_POLICY_ROUNDROBIN, 0, "roundRobin" },
+		{ OVR_REPORTSELECTOR_POLICY_CLOSEST, OVR_REPORTSELECTOR_DEFAULT_RRSHARE_PCNT, "closest" },
+		{ OVR_REPORTSELECTOR_POLICY_MOSTCHANGED, OVR_REPORTSELECTOR_DEFAULT_RRSHARE_PCNT, "mostChanged" },
+		{ OVR_REPORTSELECTOR_POLICY_CLOSEST, 0, "closestNoRr" }
+	};
+
+	for( size_t i = 0; i < (sizeof(configs)/sizeof(*configs)); i++ )
+	{
+		size_t prevNumCyclesToFull = SIM_NUMCYCLES + 1;
+		for( size_t j = 0; j < sizeof(budgetDivisors); j++ )
+		{
+			uint32_t budget_bytes = (SIM_NUMBEACONS * OVR_REPORTSELECTOR_INITIAL_REPORTSIZE_BYTES) / budgetDivisors[j];
+
+			simResult_t result;
+			simulate(configs[i].policy, budget_bytes, configs[i].rrShare_pcnt, &result);
+
+			char key[48];
+			snprintf(key, sizeof(key), "%s_1/%d_coverage_pcnt", configs[i].name, budgetDivisors[j]);
+			testRunner_report("coverageVsBudget", key, result.coverage_pcnt);
+			snprintf(key, sizeof(key), "%s_1/%d_cyclesToFull", configs[i].name, budgetDivisors[j]);
+			testRunner_report("coverageVsBudget", key, result.numCyclesToFullCoverage);
+			snprintf(key, sizeof(key), "%s_1/%d_maxStale_cycles", configs[i].name, budgetDivisors[j]);
+			testRunner_report("coverageVsBudget", key, result.maxStaleness_cycles);
+
+			// without a round-robin share the same closest beacons win every cycle
+			if( configs[i].rrShare_pcnt == 0 && configs[i].policy != OVR_REPORTSELECTOR_POLICY_ROUNDROBIN )
+			{
+				TEST_ASSERT(result.coverage_pcnt < 100);
+				TEST_ASSERT_EQUAL_INT(0, result.numCyclesToFullCoverage);
+				continue;
+			}
+
+			// everyone else is eventually reported...and sooner with more budget
+			TEST_ASSERT_EQUAL_INT(100, result.coverage_pcnt);
+			TEST_ASSERT(result.numCyclesToFullCoverage > 0);
+			TEST_ASSERT(result.numCyclesToFullCoverage <= prevNumCyclesToFull);
+			TEST_ASSERT(result.maxStaleness_cycles <= SIM_NUMCYCLES);
+			prevNumCyclesToFull = result.numCyclesToFullCoverage;
+		}
+	}
+}
+
+
+static void test_budgetHoldsThroughRpc(void)
+{
+	setupPipeline();
+
+	// unlimited to start: everyone, every period
+	runPeriod();
+	reportPolicy_t rp = getReportPolicy();
+	TEST_ASSERT_EQUAL_INT(0, rp.budget_bytes);
+	TEST_ASSERT_EQUAL_INT(NUM_BEACONS, rp.numReported);
+	TEST_ASSERT_EQUAL_INT(0, rp.numDeferred);
+	unsigned reportSize_bytes = rp.numBytes / rp.numReported;
+
+	// room for about half of them
+	uint32_t budget_bytes = (NUM_BEACONS / 2) * reportSize_bytes;
+	setReportPolicy(OVR_REPORTSELECTOR_POLICY_CLOSEST, budget_bytes, 25);
+	rp = getReportPolicy();
+	TEST_ASSERT_EQUAL_INT(OVR_REPORTSELECTOR_POLICY_CLOSEST, rp.policy);
+	TEST_ASSERT_EQUAL_INT(budget_bytes, rp.budget_bytes);
+	TEST_ASSERT_EQUAL_INT(25, rp.rrShare_pcnt);
+
+	uint8_t timesReported[NUM_BEACONS] = {0};
+	for( size_t i = 0; i < NUM_WARMUP_PERIODS + (2 * NUM_BEACONS); i++ )
+	{
+		stubHal_clearPublications();
+		runPeriod();
+
+		rp = getReportPolicy();
+		TEST_ASSERT(rp.numReported > 0);
+		TEST_ASSERT(rp.numReported < NUM_BEACONS);
+		TEST_ASSERT_EQUAL_INT(NUM_BEACONS, rp.numReported + rp.numDeferred);
+
+		// enforced against what was sent (the last report may run over)
+		TEST_ASSERT(rp.numBytes < (budget_bytes + (2 * reportSize_bytes)));
+
+		if( i == NUM_WARMUP_PERIODS ) memset(timesReported, 0, sizeof(timesReported));
+		TEST_ASSERT_EQUAL_INT(rp.numReported, countReportsByBeacon(timesReported));
+	}
+
+	// the closest every period, everyone else in turn
+	TEST_ASSERT_EQUAL_INT(2 * NUM_BEACONS, timesReported[0]);
+	for( size_t i = 0; i < NUM_BEACONS; i++ ) TEST_ASSERT(timesReported[i] > 0);
+	TEST_ASSERT(timesReported[NUM_BEACONS-1] < (2 * NUM_BEACONS));
+
+	// a budget of 0 goes back to everyone
+	setReportPolicy(OVR_REPORTSELECTOR_POLICY_CLOSEST, 0, 25);
+	runPeriod();
+	TEST_ASSERT_EQUAL_INT(NUM_BEACONS, getReportPolicy().numReported);
+}
+
+
+const testRunner_test_t testRunner_tests[] =
+{
+	TESTRUNNER_TEST(test_topKThenRoundRobin),
+	TESTRUNNER_TEST(test_everyoneFitsInTableOrder),
+	TESTRUNNER_TEST(test_coverageVsBudget),
+	TESTRUNNER_TEST(test_budgetHoldsThroughRpc),
+	TESTRUNNER_END
+};
+
+
+// ******** local function implementations ********
+static void simulate(ovr_reportSelector_policy_t policyIn, uint32_t budget_bytesIn, uint8_t rrShare_pcntIn, simResult_t *const resultOut)
+{
+	memset(resultOut, 0, sizeof(*resultOut));
+	memset(lastReported, 0, sizeof(lastReported));		// cycle number, 0 for never
+
+	ovr_reportSelector_init(&selector);
+	TEST_ASSERT(ovr_reportSelector_setPolicy(&selector, policyIn, budget_bytesIn, rrShare_pcntIn));
+
+	uint32_t lcgState = 1;
+	size_t numCovered = 0;
+	for( size_t cycle = 1; cycle <= SIM_NUMCYCLES; cycle++ )
+	{
+		ovr_reportSelector_beginCycle(&selector, SIM_NUMBEACONS);
+		for( size_t i = 0; i < SIM_NUMBEACONS; i++ ) ovr_reportSelector_offer(&selector, i, getSimScore(policyIn, i, &lcgState));
+		size_t numIndices = ovr_reportSelector_endCycle(&selector, indices, OVR_REPORTSELECTOR_MAXNUM_SLOTS);
+
+		// same budget enforcement as the live reporter
+		uint32_t numBytes = 0;
+		for( size_t i = 0; (i < numIndices) && (numBytes < budget_bytesIn); i++ )
+		{
+			if( lastReported[indices[i]] == 0 ) numCovered++;
+			lastReported[indices[i]] = cycle;
+			ovr_reportSelector_recordReportSize(&selector, OVR_REPORTSELECTOR_INITIAL_REPORTSIZE_BYTES);
+			numBytes += OVR_REPORTSELECTOR_INITIAL_REPORTSIZE_BYTES;
+		}
+
+		for( size_t i = 0; i < SIM_NUMBEACONS; i++ )
+		{
+			size_t staleness = cycle - lastReported[i];
+			if( staleness > resultOut->maxStaleness_cycles ) resultOut->maxStaleness_cycles = staleness;
+		}
+		if( (numCovered == SIM_NUMBEACONS) && (resultOut->numCyclesToFullCoverage == 0) ) resultOut->numCyclesToFullCoverage = cycle;
+	}
+	resultOut->coverage_pcnt = (numCovered * 100) / SIM_NUMBEACONS;
+}
+
+
+static int32_t getSimScore(ovr_reportSelector_policy_t policyIn, size_t indexIn, uint32_t *const lcgStateIn)
+{
+	// closest: a fixed spread of rssis (-30 to -119 dBm)
+	if( policyIn != OVR_REPORTSELECTOR_POLICY_MOSTCHANGED ) return -30 - (int32_t)((indexIn * 37) % 90);
+
+	// most changed: readings wander randomly from cycle to cycle
+	*lcgStateIn = (*lcgStateIn * 1103515245) + 12345;
+	return (*lcgStateIn >> 16) % 64;
+}
+
+
+static void setupPipeline(void)
+{
+	cxa_mqtt_rpc_node_t* rootNode = stubHal_getRootNode();
+
+	ovr_config_init(rootNode);
+	ovr_publishScheduler_init(rootNode, THREADID_NETWORK);
+
+	stubHal_btle_init(&btleClient);
+	ovr_beaconManager_init(&beaconManager, &btleClient, rootNode, THREADID_BLUETOOTH, THREADID_NETWORK);
+	stubHal_btle_setReady(&btleClient);
+	stubHal_iterateAll();
+
+	stubHal_setUnixTime(UNIX_TIME);
+	for( int i = 0; i < OVR_BEACONMANAGER_FOUND_NUMADVERTS; i++ ) runPeriod();
+
+	// updates otherwise go out on a period's last step and are sent in the next
+	stubHal_run_ms(HEAR_PERIOD_MS / 2, 100);
+	TEST_ASSERT_EQUAL_INT(NUM_BEACONS, cxa_array_getSize_elems(ovr_beaconManager_getKnownBeacons(&beaconManager)));
+	stubHal_clearPublications();
+}
+
+
+static void runPeriod(void)
+{
+	uint32_t period_ms = ovr_config_get(OVR_CONFIG_ID_UPDATE_PERIOD_MS);
+	for( uint32_t elapsed_ms = 0; elapsed_ms < period_ms; elapsed_ms += HEAR_PERIOD_MS )
+	{
+		for( size_t i = 0; i < NUM_BEACONS; i++ )
+		{
+			uint8_t advert[] =
+			{
+				0x00,											// devType
+				0x00, 0x11, 0x22, 0x33, 0x44, i,				// eui48
+				0x00,											// nothing enabled
+				100,											// battery %
+				0x00, 0x00,										// temp
+				0x00,											// light
+				0x00,											// accel events
+				0x0C, 0x0E										// 3596mV
+			};
+			TEST_ASSERT(stubHal_btle_injectManData(&btleClient, RSSI_CLOSEST - (int8_t)(i * RSSI_STEP), COMPANY_ID, advert, sizeof(advert)));
+			stubHal_iterateAll();
+		}
+		stubHal_run_ms(HEAR_PERIOD_MS, 100);
+	}
+}
+
+
+static size_t countReportsByBeacon(uint8_t *const timesReportedOut)
+{
+	size_t numReports = 0;
+	size_t index = 0;
+	stubHal_publication_t* currPub;
+	while( (currPub = stubHal_findPublication("onBeaconUpdate", &index)) != NULL )
+	{
+		index++;
+
+		char payload[sizeof(currPub->payload) + 1];
+		memcpy(payload, currPub->payload, currPub->payloadSize_bytes);
+		payload[currPub->payloadSize_bytes] = 0;
+
+		// each beacon is heard at its own rssi
+		char* rssi_str = strstr(payload, "\"rssi\":");
+		TEST_ASSERT(rssi_str != NULL);
+		long rssi = strtol(rssi_str + strlen("\"rssi\":"), NULL, 10);
+		TEST_ASSERT(((RSSI_CLOSEST - rssi) % RSSI_STEP) == 0);
+
+		size_t beaconIndex = (RSSI_CLOSEST - rssi) / RSSI_STEP;
+		TEST_ASSERT(beaconIndex < NUM_BEACONS);
+		timesReportedOut[beaconIndex]++;
+		numReports++;
+	}
+	return numReports;
+}
+
+
+static void setReportPolicy(uint8_t policyIn, uint32_t budget_bytesIn, uint8_t rrShare_pcntIn)
+{
+	// [policy:1][budget_bytesPerPeriod:4][rrShare_pcnt:1]
+	uint8_t params[] =
+	{
+		policyIn,
+		budget_bytesIn & 0xFF, (budget_bytesIn >> 8) & 0xFF, (budget_bytesIn >> 16) & 0xFF, (budget_bytesIn >> 24) & 0xFF,
+		rrShare_pcntIn
+	};
+
+	size_t responseSize_bytes = 0;
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_RPC_METHODRETVAL_SUCCESS, stubHal_callMethod("", "setReportPolicy", params, sizeof(params), NULL, 0, &responseSize_bytes));
+}
+
+
+static reportPolicy_t getReportPolicy(void)
+{
+	// [policy:1][budget_bytesPerPeriod:4][rrShare_pcnt:1][numReported:2][numDeferred:2][numBytes:4]
+	uint8_t response[14];
+	size_t responseSize_bytes = 0;
+	TEST_ASSERT_EQUAL_INT(CXA_MQTT_RPC_METHODRETVAL_SUCCESS, stubHal_callMethod("", "getReportPolicy", NULL, 0, response, sizeof(response), &responseSize_bytes));
+	TEST_ASSERT_EQUAL_INT(sizeof(response), responseSize_bytes);
+
+	reportPolicy_t retVal;
+	retVal.policy = response[0];
+	retVal.budget_bytes = response[1] | (response[2] << 8) | (response[3] << 16) | ((uint32_t)response[4] << 24);
+	retVal.rrShare_pcnt = response[5];
+	retVal.numReported = response[6] | (response[7] << 8);
+	retVal.numDeferred = response[8] | (response[9] << 8);
+	retVal.numBytes = response[10] | (response[11] << 8) | (response[12] << 16) | ((uint32_t)response[13] << 24);
+	return retVal;
+}